@@ -0,0 +1,28 @@
+project "bench"
+    kind            "ConsoleApp"
+    language        "C"
+    cdialect        "C17"
+    systemversion   "latest"
+    warnings        "extra"
+    -- 
+    location        (".")
+    targetdir       (OUTPUT_BIN_DIR_PATH)
+    objdir          (OUTPUT_OBJ_DIR_PATH)
+    -- 
+    files {
+        "src/**.h",
+        "src/**.c",
+    }
+    -- 
+    includedirs {
+        "src",
+        PROJECTS_DIR_PATH .. "vanec/include",
+    }
+    -- 
+    links {
+        "vanec"
+    }
+    -- 
+    debugargs { 
+        "--functions", "2000", "--reps", "5", "--output", ("\"" .. OUTPUT_DIR_PATH .. "bench.json" .. "\""),
+    }
\ No newline at end of file
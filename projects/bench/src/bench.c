@@ -0,0 +1,77 @@
+#include "bench.h"
+
+#include <stdlib.h>
+
+bool bench_check_diagnostics(BenchContext* ctx) {
+    if (ctx->diag->msgs.items_count == 0) {
+        return true;
+    }
+
+    diagnostic_engine_print_all(ctx->diag);
+    diagnostic_engine_clear(ctx->diag);
+    printf("Error: the generated source is not accepted by the compiler.\n");
+    return false;
+}
+
+u64 bench_measure_begin(BenchContext* ctx) {
+    if (ctx->has_perf_counters) {
+        perf_counters_start(&ctx->perf);
+    }
+    return profiler_now_ns();
+}
+
+void bench_measure_end(BenchContext* ctx, BenchSample* sample, const u64 start_ns) {
+    sample->duration_ns = profiler_now_ns() - start_ns;
+    if (ctx->has_perf_counters) {
+        perf_counters_stop(&ctx->perf, &sample->counters);
+    }
+}
+
+static int compare_u64(const void* lhs, const void* rhs) {
+    const u64 a = *(const u64*)lhs;
+    const u64 b = *(const u64*)rhs;
+    return (a > b) - (a < b);
+}
+
+u64 bench_sort_durations(u64* durations, const u32 count) {
+    qsort(durations, count, sizeof(u64), &compare_u64);
+
+    const u32 mid = count / 2;
+    return (count % 2 == 1) ? durations[mid] : (durations[mid - 1] + durations[mid]) / 2;
+}
+
+double per_second(const u64 count, const u64 ns) {
+    return ns == 0 ? 0.0 : (double)count * 1e9 / (double)ns;
+}
+
+double get_ipc(const PerfCounterValues* counters) {
+    if (!counters->valid[PERF_COUNTER_CYCLES] || !counters->valid[PERF_COUNTER_INSTRUCTIONS] || counters->values[PERF_COUNTER_CYCLES] == 0) {
+        return -1.0;
+    }
+    return (double)counters->values[PERF_COUNTER_INSTRUCTIONS] / (double)counters->values[PERF_COUNTER_CYCLES];
+}
+
+double get_counter_per_item(const PerfCounterValues* counters, const PerfCounterKind kind, const u64 count) {
+    if (!counters->valid[kind] || count == 0) {
+        return -1.0;
+    }
+    return (double)counters->values[kind] / (double)count;
+}
+
+void print_ratio(const double value) {
+    if (value < 0.0) {
+        printf(" %12s", "n/a");
+    }
+    else {
+        printf(" %12.4f", value);
+    }
+}
+
+void write_json_ratio(FILE* handle, const double value) {
+    if (value < 0.0) {
+        fputs("null", handle);
+    }
+    else {
+        fprintf(handle, "%.6f", value);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "vanec/vanec.h"
+
+#include <stdio.h>
+
+#include "generator/source_generator.h"
+#include "perf/perf_counters.h"
+
+typedef struct {
+    SourceGeneratorOptions generator;
+
+    u32 warmup_count;
+    u32 repetitions_count;
+    u64 stream_chunk_capacity;
+    u32 vm_kernel_size;
+    u32 native_kernel_size;
+    bool use_perf_counters;
+
+    char* output_filepath;
+    char* source_filepath;
+    char* label;
+    char* cc;
+} BenchOptions;
+
+// One measured run of a phase over the whole generated program.
+typedef struct {
+    u64 duration_ns;
+    u64 tokens_count;
+    u64 nodes_count;
+    u64 functions_count;
+    u64 cfg_nodes_count;
+
+    PerfCounterValues counters;
+} BenchSample;
+
+typedef struct {
+    DiagnosticEngine* diag;
+    Stream* stream;
+    Lexer* lexer;
+    ASTParser* ast_parser;
+
+    PerfCounters perf;
+    bool has_perf_counters;
+
+    const char* source;
+    u64 source_size;
+} BenchContext;
+
+// Prints and clears the diagnostics of the compiled source. Returns false if there were any.
+bool bench_check_diagnostics(BenchContext* ctx);
+
+// Starts the wall clock and the hardware counters of one measured region.
+u64 bench_measure_begin(BenchContext* ctx);
+
+void bench_measure_end(BenchContext* ctx, BenchSample* sample, const u64 start_ns);
+
+// Sorts the durations of the measured runs and returns their median.
+u64 bench_sort_durations(u64* durations, const u32 count);
+
+double per_second(const u64 count, const u64 ns);
+
+// Hardware counter ratios, negative when the counters are unavailable.
+double get_ipc(const PerfCounterValues* counters);
+
+double get_counter_per_item(const PerfCounterValues* counters, const PerfCounterKind kind, const u64 count);
+
+void print_ratio(const double value);
+
+void write_json_ratio(FILE* handle, const double value);
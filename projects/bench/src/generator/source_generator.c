@@ -0,0 +1,297 @@
+#include "generator/source_generator.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "vanec/utils/string_builder.h"
+
+typedef struct {
+    const SourceGeneratorOptions* options;
+    StringBuilder sb;
+    u64 state;
+    u32 function_index;
+    u32 loop_depth;
+} SourceGenerator;
+
+static const char* binary_ops[] = {
+    "+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>",
+};
+
+static const char* compare_ops[] = {
+    "<", "<=", ">", ">=", "==", "!=",
+};
+
+static const char* assign_ops[] = {
+    "=", "+=", "-=", "*=", "/=", "%=", "|=", "&=", "^=",
+};
+
+static const char* comment_words[] = {
+    "compute", "the", "next", "value", "of", "loop", "counter", "digits", "sum", "check",
+};
+
+#define ARRAY_COUNT(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+SourceGeneratorOptions source_generator_default_options(void) {
+    return (SourceGeneratorOptions) {
+        .seed = 0x5eed,
+        .functions_count = 1000,
+        .statements_count = 6,
+        .nesting_depth = 3,
+        .expression_length = 4,
+        .comment_density = 10,
+        .identifier_length = 6,
+        .variables_count = 6,
+        .string_literal_length = 16,
+    };
+}
+
+// xorshift64*, good enough and identical on every platform.
+static u64 next_random(SourceGenerator* gen) {
+    gen->state ^= gen->state >> 12;
+    gen->state ^= gen->state << 25;
+    gen->state ^= gen->state >> 27;
+    return gen->state * 0x2545F4914F6CDD1Dull;
+}
+
+static u32 next_random_below(SourceGenerator* gen, const u32 bound) {
+    assert(bound != 0);
+    return (u32)(next_random(gen) % bound);
+}
+
+static void append_indent(SourceGenerator* gen, const u32 depth) {
+    for (u32 i = 0; i < depth; ++i) {
+        string_builder_append_str_right(&gen->sb, "    ");
+    }
+}
+
+static void append_identifier(SourceGenerator* gen, const char prefix, const u32 index) {
+    char buf[32] = { 0 };
+    i32 len = snprintf(buf, sizeof(buf), "%c%ld", prefix, index);
+    assert(len > 0);
+
+    string_builder_append_str_right(&gen->sb, buf);
+
+    for (u32 i = (u32)len; i < gen->options->identifier_length; ++i) {
+        string_builder_append_char_right(&gen->sb, i == (u32)len ? '_' : (char)('a' + (i % 26)));
+    }
+}
+
+static void append_variable(SourceGenerator* gen) {
+    append_identifier(gen, 'v', next_random_below(gen, gen->options->variables_count));
+}
+
+static void append_comment(SourceGenerator* gen, const u32 depth) {
+    if (next_random_below(gen, 100) >= gen->options->comment_density) {
+        return;
+    }
+
+    const bool is_block = next_random_below(gen, 4) == 0;
+    const u32 words = 3 + next_random_below(gen, 8);
+
+    append_indent(gen, depth);
+    string_builder_append_str_right(&gen->sb, is_block ? "/* " : "// ");
+    for (u32 i = 0; i < words; ++i) {
+        string_builder_append_str_right(&gen->sb, comment_words[next_random_below(gen, ARRAY_COUNT(comment_words))]);
+        string_builder_append_char_right(&gen->sb, ' ');
+    }
+    string_builder_append_str_right(&gen->sb, is_block ? "*/\n" : "\n");
+}
+
+static void append_operand(SourceGenerator* gen) {
+    switch (next_random_below(gen, 8)) {
+    case 0: { string_builder_append_format(&gen->sb, "%ld", next_random_below(gen, 1000)); } break;
+    case 1: { string_builder_append_format(&gen->sb, "0x%lX", next_random_below(gen, 0x10000)); } break;
+    case 2: {
+        string_builder_append_char_right(&gen->sb, '(');
+        append_variable(gen);
+        string_builder_append_format(&gen->sb, " + %ld)", 1 + next_random_below(gen, 9));
+    } break;
+    default: { append_variable(gen); } break;
+    };
+}
+
+static void append_expression(SourceGenerator* gen, const u32 length) {
+    append_operand(gen);
+    for (u32 i = 0; i < length; ++i) {
+        string_builder_append_format(&gen->sb, " %s ", binary_ops[next_random_below(gen, ARRAY_COUNT(binary_ops))]);
+        append_operand(gen);
+    }
+}
+
+static void append_condition(SourceGenerator* gen) {
+    const u32 length = gen->options->expression_length / 2;
+
+    string_builder_append_char_right(&gen->sb, '(');
+    append_expression(gen, length);
+    string_builder_append_format(&gen->sb, " %s ", compare_ops[next_random_below(gen, ARRAY_COUNT(compare_ops))]);
+    append_operand(gen);
+    string_builder_append_char_right(&gen->sb, ')');
+}
+
+static void append_block(SourceGenerator* gen, const u32 depth);
+
+static void append_statement(SourceGenerator* gen, const u32 depth) {
+    append_comment(gen, depth);
+
+    const bool can_nest = depth <= gen->options->nesting_depth;
+    const u32 kind = next_random_below(gen, can_nest ? 10 : 6);
+
+    append_indent(gen, depth);
+
+    switch (kind) {
+    case 0:
+    case 1:
+    case 2: {
+        append_variable(gen);
+        string_builder_append_format(&gen->sb, " %s ", assign_ops[next_random_below(gen, ARRAY_COUNT(assign_ops))]);
+        append_expression(gen, gen->options->expression_length);
+        string_builder_append_str_right(&gen->sb, ";\n");
+    } break;
+    case 3: {
+        string_builder_append_str_right(&gen->sb, "++");
+        append_variable(gen);
+        string_builder_append_str_right(&gen->sb, ";\n");
+    } break;
+    case 4: {
+        if (gen->options->string_literal_length == 0) {
+            append_variable(gen);
+            string_builder_append_str_right(&gen->sb, " = ");
+            append_expression(gen, gen->options->expression_length);
+            string_builder_append_str_right(&gen->sb, ";\n");
+            break;
+        }
+
+        string_builder_append_str_right(&gen->sb, "printf(\"");
+        for (u32 i = 0; i < gen->options->string_literal_length; ++i) {
+            string_builder_append_char_right(&gen->sb, (char)('a' + next_random_below(gen, 26)));
+        }
+        string_builder_append_str_right(&gen->sb, " %d\\n\", ");
+        append_variable(gen);
+        string_builder_append_str_right(&gen->sb, ");\n");
+    } break;
+    case 5: {
+        // Calls only go backwards, so every callee is defined above.
+        if (gen->function_index == 0) {
+            string_builder_append_str_right(&gen->sb, "--");
+            append_variable(gen);
+            string_builder_append_str_right(&gen->sb, ";\n");
+            break;
+        }
+
+        append_variable(gen);
+        string_builder_append_str_right(&gen->sb, " = ");
+        append_identifier(gen, 'f', next_random_below(gen, gen->function_index));
+        string_builder_append_char_right(&gen->sb, '(');
+        append_variable(gen);
+        string_builder_append_str_right(&gen->sb, ", ");
+        append_variable(gen);
+        string_builder_append_str_right(&gen->sb, ");\n");
+    } break;
+    case 6:
+    case 7: {
+        string_builder_append_str_right(&gen->sb, "if ");
+        append_condition(gen);
+        string_builder_append_str_right(&gen->sb, " then\n");
+        append_block(gen, depth + 1);
+
+        if (gen->loop_depth > 0 && next_random_below(gen, 4) == 0) {
+            append_indent(gen, depth + 1);
+            string_builder_append_str_right(&gen->sb, "break\n");
+        }
+
+        if (next_random_below(gen, 2) == 0) {
+            append_indent(gen, depth);
+            string_builder_append_str_right(&gen->sb, "else\n");
+            append_block(gen, depth + 1);
+        }
+
+        append_indent(gen, depth);
+        string_builder_append_str_right(&gen->sb, "end if\n");
+    } break;
+    case 8: {
+        string_builder_append_str_right(&gen->sb, "while ");
+        append_condition(gen);
+        string_builder_append_char_right(&gen->sb, '\n');
+
+        ++gen->loop_depth;
+        append_block(gen, depth + 1);
+        --gen->loop_depth;
+
+        append_indent(gen, depth);
+        string_builder_append_str_right(&gen->sb, "wend\n");
+    } break;
+    case 9: {
+        string_builder_append_str_right(&gen->sb, "do\n");
+
+        ++gen->loop_depth;
+        append_block(gen, depth + 1);
+        --gen->loop_depth;
+
+        append_indent(gen, depth);
+        string_builder_append_str_right(&gen->sb, "loop until ");
+        append_condition(gen);
+        string_builder_append_char_right(&gen->sb, '\n');
+    } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+}
+
+static void append_block(SourceGenerator* gen, const u32 depth) {
+    const u32 count = 1 + next_random_below(gen, gen->options->statements_count);
+    for (u32 i = 0; i < count; ++i) {
+        append_statement(gen, depth);
+    }
+}
+
+static void append_function(SourceGenerator* gen) {
+    string_builder_append_str_right(&gen->sb, "function ");
+    append_identifier(gen, 'f', gen->function_index);
+    string_builder_append_str_right(&gen->sb, "(");
+    append_identifier(gen, 'v', 0);
+    string_builder_append_str_right(&gen->sb, " as int, ");
+    append_identifier(gen, 'v', 1);
+    string_builder_append_str_right(&gen->sb, " as int) as int\n");
+
+    if (gen->options->variables_count > 2) {
+        string_builder_append_str_right(&gen->sb, "    dim ");
+        for (u32 i = 2; i < gen->options->variables_count; ++i) {
+            if (i != 2) {
+                string_builder_append_str_right(&gen->sb, ", ");
+            }
+            append_identifier(gen, 'v', i);
+        }
+        string_builder_append_str_right(&gen->sb, " as int\n");
+    }
+
+    for (u32 i = 0; i < gen->options->statements_count; ++i) {
+        append_statement(gen, 1);
+    }
+
+    string_builder_append_str_right(&gen->sb, "    return(");
+    append_expression(gen, gen->options->expression_length);
+    string_builder_append_str_right(&gen->sb, ");\nend function\n\n");
+}
+
+char* generate_vane_source(const SourceGeneratorOptions* options) {
+    assert(options != NULL);
+    assert(options->variables_count >= 2 && options->statements_count > 0);
+
+    SourceGenerator gen = {
+        .options = options,
+        .sb = string_builder_create(),
+        .state = options->seed == 0 ? 0x9E3779B97F4A7C15ull : options->seed,
+        .function_index = 0,
+        .loop_depth = 0,
+    };
+
+    for (gen.function_index = 0; gen.function_index < options->functions_count; ++gen.function_index) {
+        append_function(&gen);
+    }
+
+    char* source = string_builder_get_str(&gen.sb);
+    string_builder_free(&gen.sb);
+
+    return source;
+}
\ No newline at end of file
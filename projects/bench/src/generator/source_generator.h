@@ -0,0 +1,22 @@
+#pragma once
+
+#include "vanec/utils/defines.h"
+
+typedef struct {
+    u64 seed;
+
+    u32 functions_count;
+    u32 statements_count;       // statements per block
+    u32 nesting_depth;          // max depth of nested if/while/do blocks
+    u32 expression_length;      // binary operators per expression
+    u32 comment_density;        // percent of statements preceded by a comment
+    u32 identifier_length;      // min length of generated identifiers
+    u32 variables_count;        // locals declared by every function
+    u32 string_literal_length;  // length of printf format literals, 0 to skip them
+} SourceGeneratorOptions;
+
+SourceGeneratorOptions source_generator_default_options(void);
+
+// Deterministically generates a Vane program accepted by the ast parser.
+// The same options always produce the same source.
+char* generate_vane_source(const SourceGeneratorOptions* options);
\ No newline at end of file
@@ -0,0 +1,660 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "native/native_bench.h"
+#include "vm/vm_bench.h"
+
+#define DEFAULT_WARMUP_COUNT        2
+#define DEFAULT_REPETITIONS_COUNT   5
+#define DEFAULT_VM_KERNEL_SIZE      20000
+#define DEFAULT_NATIVE_KERNEL_SIZE  2000000
+
+typedef enum {
+    BENCH_PHASE_LEX,
+    BENCH_PHASE_PARSE,
+    BENCH_PHASE_CFG,
+    BENCH_PHASE_PIPELINE,
+    BENCH_PHASES_COUNT,
+} BenchPhase;
+
+static const char* bench_phase_names[BENCH_PHASES_COUNT] = {
+    "lex", "parse", "cfg", "stream",
+};
+
+typedef struct {
+    BenchPhase phase;
+
+    u64 min_ns;
+    u64 median_ns;
+    double mean_ns;
+
+    // Mean over the measured runs.
+    PerfCounterValues counters;
+
+    BenchSample last;
+} BenchResult;
+
+#define PRINT(msg, ...) printf(msg "\n", ##__VA_ARGS__)
+#define PRINT_ERROR_AND_EXIT(code, msg, ...)    \
+printf("Error: "msg"\n", ##__VA_ARGS__);        \
+error_exit(code)
+
+static void print_usage(const char* path) {
+    PRINT("Usage: %s [options...]", path);
+    PRINT("");
+    PRINT("Generator options:");
+    PRINT("  --functions <number>       - number of generated functions.");
+    PRINT("  --stmts <number>           - statements per block.");
+    PRINT("  --depth <number>           - max nesting depth of if/while/do blocks.");
+    PRINT("  --expr_len <number>        - binary operators per expression.");
+    PRINT("  --comment_density <number> - percent of statements preceded by a comment.");
+    PRINT("  --ident_len <number>       - min length of identifiers.");
+    PRINT("  --vars <number>            - locals per function (at least 2).");
+    PRINT("  --string_len <number>      - length of string literals, 0 to skip them.");
+    PRINT("  --seed <number>            - generator seed.");
+    PRINT("");
+    PRINT("Run options:");
+    PRINT("  --warmup <number>          - unmeasured runs of every phase.");
+    PRINT("  --reps <number>            - measured runs of every phase.");
+    PRINT("  --chunk_cap <number>       - set stream chunk capacity.");
+    PRINT("  --vm_n <number>            - loop bound of the interpreter kernel, 0 to skip it.");
+    PRINT("  --native_n <number>        - loop bound of the native kernel, 0 to skip the register allocators.");
+    PRINT("  --cc <command>             - C compiler that links the native kernel in a temporary directory to time its runs.");
+    PRINT("  --no-perf                  - don't read hardware performance counters.");
+    PRINT("  --output <filepath>        - write results as JSON.");
+    PRINT("  --dump <filepath>          - write the generated source.");
+    PRINT("  --label <string>           - label stored in the JSON results.");
+}
+
+static u64 parse_number_arg(const int argc, char** argv, int* index) {
+    if (*index + 1 >= argc) {
+        PRINT_ERROR_AND_EXIT(-1, "The argument for the \"%s\" option was not provided", argv[*index]);
+    }
+    return strtoull(argv[++*index], NULL, 0);
+}
+
+static char* parse_string_arg(const int argc, char** argv, int* index) {
+    if (*index + 1 >= argc) {
+        PRINT_ERROR_AND_EXIT(-1, "The argument for the \"%s\" option was not provided", argv[*index]);
+    }
+    return str_dup(argv[++*index]);
+}
+
+static void bench_options_parse_args(BenchOptions* options, int argc, char** argv) {
+    options->generator = source_generator_default_options();
+    options->warmup_count = DEFAULT_WARMUP_COUNT;
+    options->repetitions_count = DEFAULT_REPETITIONS_COUNT;
+    options->stream_chunk_capacity = MAX_STREAM_CHUNK_CAPACITY;
+    options->vm_kernel_size = DEFAULT_VM_KERNEL_SIZE;
+    options->native_kernel_size = DEFAULT_NATIVE_KERNEL_SIZE;
+    options->use_perf_counters = true;
+    options->output_filepath = NULL;
+    options->source_filepath = NULL;
+    options->label = NULL;
+    options->cc = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+
+        if      (str_eq(arg, "--functions"))        { options->generator.functions_count = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--stmts"))            { options->generator.statements_count = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--depth"))            { options->generator.nesting_depth = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--expr_len"))         { options->generator.expression_length = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--comment_density")) { options->generator.comment_density = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--ident_len"))        { options->generator.identifier_length = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--vars"))             { options->generator.variables_count = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--string_len"))       { options->generator.string_literal_length = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--seed"))             { options->generator.seed = parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--warmup"))           { options->warmup_count = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--reps"))             { options->repetitions_count = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--chunk_cap"))        { options->stream_chunk_capacity = parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--vm_n"))             { options->vm_kernel_size = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--native_n"))         { options->native_kernel_size = (u32)parse_number_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--no-perf"))          { options->use_perf_counters = false; }
+        else if (str_eq(arg, "--output"))           { str_free(options->output_filepath); options->output_filepath = parse_string_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--dump"))             { str_free(options->source_filepath); options->source_filepath = parse_string_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--label"))            { str_free(options->label); options->label = parse_string_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--cc"))               { str_free(options->cc); options->cc = parse_string_arg(argc, argv, &i); }
+        else if (str_eq(arg, "--help"))             { print_usage(argv[0]); exit(0); }
+        else {
+            print_usage(argv[0]);
+            PRINT_ERROR_AND_EXIT(-1, "Unknown option \"%s\".", arg);
+        }
+    }
+
+    if (options->generator.variables_count < 2) {
+        PRINT_ERROR_AND_EXIT(-1, "The \"--vars\" option must be at least 2.");
+    }
+    if (options->generator.statements_count == 0) {
+        PRINT_ERROR_AND_EXIT(-1, "The \"--stmts\" option must be at least 1.");
+    }
+    if (options->repetitions_count == 0) {
+        PRINT_ERROR_AND_EXIT(-1, "The \"--reps\" option must be at least 1.");
+    }
+}
+
+static void bench_options_free(BenchOptions* options) {
+    str_free(options->output_filepath);
+    str_free(options->source_filepath);
+    str_free(options->label);
+    str_free(options->cc);
+
+    options->output_filepath = NULL;
+    options->source_filepath = NULL;
+    options->label = NULL;
+    options->cc = NULL;
+}
+
+static u64 count_ast_nodes(const ASTNode* node);
+
+static u64 count_ast_nodes_in_vector(const Vector* nodes) {
+    u64 count = 0;
+    for (u64 i = 0; i < nodes->items_count; ++i) {
+        count += count_ast_nodes(vector_get_ref(nodes, i));
+    }
+    return count;
+}
+
+static u64 count_ast_nodes(const ASTNode* node) {
+    if (node == NULL) {
+        return 0;
+    }
+
+    switch (node->kind) {
+    case AST_FUNCSIGN_NODE: {
+        return 1 + count_ast_nodes(node->as.funcsign->id)
+            + count_ast_nodes_in_vector(&node->as.funcsign->args)
+            + count_ast_nodes(node->as.funcsign->typeref);
+    }
+    case AST_ARGDEF_NODE: {
+        return 1 + count_ast_nodes(node->as.argdef->id) + count_ast_nodes(node->as.argdef->typeref);
+    }
+    case AST_FUNCDEF_NODE: {
+        return 1 + count_ast_nodes(node->as.funcdef->funcsign) + count_ast_nodes_in_vector(&node->as.funcdef->stmts);
+    }
+    case AST_CUSTOM_TYPEREF_NODE: {
+        return 1 + count_ast_nodes(node->as.custom_typeref->id);
+    }
+    case AST_ARRAY_TYPEREF_NODE: {
+        return 1 + count_ast_nodes(node->as.array_typeref->typeref);
+    }
+    case AST_VARDECL_STMT_NODE: {
+        return 1 + count_ast_nodes_in_vector(&node->as.vardecl_stmt->ids) + count_ast_nodes(node->as.vardecl_stmt->typeref);
+    }
+    case AST_CONDITION_STMT_NODE: {
+        return 1 + count_ast_nodes(node->as.condition_stmt->expr)
+            + count_ast_nodes_in_vector(&node->as.condition_stmt->then_branch)
+            + count_ast_nodes_in_vector(&node->as.condition_stmt->else_branch);
+    }
+    case AST_WHILE_STMT_NODE:
+    case AST_DO_WHILE_STMT_NODE: {
+        return 1 + count_ast_nodes(node->as.while_stmt->expr) + count_ast_nodes_in_vector(&node->as.while_stmt->stmts);
+    }
+    case AST_EXPRESSION_STMT_NODE:
+    case AST_RETURN_STMT_NODE: {
+        return 1 + count_ast_nodes(node->as.expression_stmt->expr);
+    }
+    case AST_BINARY_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.binary_expr->lhs) + count_ast_nodes(node->as.binary_expr->rhs);
+    }
+    case AST_UNARY_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.unary_expr->rhs);
+    }
+    case AST_BRACES_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.braces_expr->expr);
+    }
+    case AST_CALL_OR_INDEXER_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.call_or_indexer_expr->callee) + count_ast_nodes_in_vector(&node->as.call_or_indexer_expr->args);
+    }
+    case AST_PLACE_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.place_expr->id);
+    }
+    case AST_TERNARY_EXPR_NODE: {
+        return 1 + count_ast_nodes(node->as.ternary_expr->expr)
+            + count_ast_nodes(node->as.ternary_expr->then_expr)
+            + count_ast_nodes(node->as.ternary_expr->else_expr);
+    }
+    default: {
+        return 1;
+    }
+    };
+}
+
+static void bench_context_set_source(BenchContext* ctx) {
+    stream_set_source(ctx->stream, STREAM_STRING_SOURCE, ctx->source);
+    lexer_set_source_stream(ctx->lexer, ctx->stream);
+}
+
+// Parses every function of the source. Returns false if the parser gave up.
+static bool parse_functions(BenchContext* ctx, Vector* functions) {
+    while (!is_ast_parser_done(ctx->ast_parser)) {
+        ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ctx->ast_parser);
+        if (funcdef == NULL) {
+            ast_parser_skip_to_the_end_of_a_file(ctx->ast_parser);
+            return false;
+        }
+        vector_push_back(functions, &funcdef);
+    }
+    return true;
+}
+
+static bool run_lex_phase(BenchContext* ctx, BenchSample* sample) {
+    bench_context_set_source(ctx);
+
+    u64 tokens_count = 0;
+    TokenKind token_kind = TOKEN_UNKNOWN;
+
+    const u64 start_ns = bench_measure_begin(ctx);
+    while (token_kind != TOKEN_END_OF_FILE) {
+        Token token = lexer_parse_next_token(ctx->lexer);
+        token_kind = token.kind;
+        token_free(&token);
+        ++tokens_count;
+    }
+    bench_measure_end(ctx, sample, start_ns);
+    sample->tokens_count = tokens_count;
+
+    return bench_check_diagnostics(ctx);
+}
+
+static bool run_parse_phase(BenchContext* ctx, BenchSample* sample) {
+    bench_context_set_source(ctx);
+
+    Vector functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ASTNode*), &ast_node_free, true);
+
+    const u64 start_ns = bench_measure_begin(ctx);
+    bool result = parse_functions(ctx, &functions);
+    bench_measure_end(ctx, sample, start_ns);
+
+    sample->tokens_count = ctx->ast_parser->ts.count;
+    sample->functions_count = functions.items_count;
+    sample->nodes_count = count_ast_nodes_in_vector(&functions);
+
+    vector_free(&functions);
+    ast_parser_clear(ctx->ast_parser);
+
+    return result && bench_check_diagnostics(ctx);
+}
+
+static bool run_cfg_phase(BenchContext* ctx, BenchSample* sample) {
+    bench_context_set_source(ctx);
+
+    Vector functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ASTNode*), &ast_node_free, true);
+
+    bool result = parse_functions(ctx, &functions);
+
+    sample->tokens_count = ctx->ast_parser->ts.count;
+    sample->functions_count = functions.items_count;
+    sample->nodes_count = count_ast_nodes_in_vector(&functions);
+    sample->cfg_nodes_count = 0;
+
+    const u64 start_ns = bench_measure_begin(ctx);
+    CFGContext* cfg_context = cfg_context_create(ctx->diag);
+    for (u64 i = 0; result && i < functions.items_count; ++i) {
+        const ASTNode* funcdef = vector_get_ref(&functions, i);
+
+        cfg_context_clear(cfg_context);
+        if (build_cfg_for_function(cfg_context, funcdef) == CFG_NULL_NODE) {
+            result = false;
+        }
+        sample->cfg_nodes_count += cfg_context_get_nodes_count(cfg_context);
+    }
+    cfg_context_free(cfg_context);
+    bench_measure_end(ctx, sample, start_ns);
+
+    vector_free(&functions);
+    ast_parser_clear(ctx->ast_parser);
+
+    return result && bench_check_diagnostics(ctx);
+}
+
+// Parse, cfg and release every function before parsing the next one, like the testbed "cfg" command does.
+static bool run_pipeline_phase(BenchContext* ctx, BenchSample* sample) {
+    bench_context_set_source(ctx);
+
+    bool result = true;
+
+    const u64 start_ns = bench_measure_begin(ctx);
+    CFGContext* cfg_context = cfg_context_create(ctx->diag);
+    while (result && !is_ast_parser_done(ctx->ast_parser)) {
+        ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ctx->ast_parser);
+        if (funcdef == NULL) {
+            ast_parser_skip_to_the_end_of_a_file(ctx->ast_parser);
+            result = false;
+            break;
+        }
+
+        cfg_context_clear(cfg_context);
+        if (build_cfg_for_function(cfg_context, funcdef) == CFG_NULL_NODE) {
+            result = false;
+        }
+        sample->cfg_nodes_count += cfg_context_get_nodes_count(cfg_context);
+
+        ast_node_free(funcdef);
+        ast_parser_release_consumed_tokens(ctx->ast_parser);
+
+        ++sample->functions_count;
+    }
+    cfg_context_free(cfg_context);
+    bench_measure_end(ctx, sample, start_ns);
+
+    sample->tokens_count = ctx->ast_parser->ts.count;
+    ast_parser_clear(ctx->ast_parser);
+
+    return result && bench_check_diagnostics(ctx);
+}
+
+static bool run_phase(BenchContext* ctx, const BenchPhase phase, BenchSample* sample) {
+    *sample = (BenchSample){ 0 };
+
+    switch (phase) {
+    case BENCH_PHASE_LEX:      { return run_lex_phase(ctx, sample); }
+    case BENCH_PHASE_PARSE:    { return run_parse_phase(ctx, sample); }
+    case BENCH_PHASE_CFG:      { return run_cfg_phase(ctx, sample); }
+    case BENCH_PHASE_PIPELINE: { return run_pipeline_phase(ctx, sample); }
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+    return false;
+}
+
+static bool measure_phase(BenchContext* ctx, const BenchOptions* options, const BenchPhase phase, BenchResult* result) {
+    BenchSample sample = { 0 };
+
+    for (u32 i = 0; i < options->warmup_count; ++i) {
+        if (!run_phase(ctx, phase, &sample)) {
+            return false;
+        }
+    }
+
+    u64* durations = malloc(options->repetitions_count * sizeof(u64));
+    assert(durations != NULL);
+
+    PerfCounterValues counters = { 0 };
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        counters.valid[i] = ctx->has_perf_counters;
+    }
+
+    u64 total_ns = 0;
+    for (u32 i = 0; i < options->repetitions_count; ++i) {
+        if (!run_phase(ctx, phase, &sample)) {
+            free(durations);
+            return false;
+        }
+        durations[i] = sample.duration_ns;
+        total_ns += sample.duration_ns;
+        perf_counter_values_add(&counters, &sample.counters);
+    }
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        counters.values[i] /= options->repetitions_count;
+    }
+
+    result->phase = phase;
+    result->median_ns = bench_sort_durations(durations, options->repetitions_count);
+    result->min_ns = durations[0];
+    result->mean_ns = (double)total_ns / (double)options->repetitions_count;
+    result->counters = counters;
+    result->last = sample;
+
+    free(durations);
+    return true;
+}
+
+static void print_result(const BenchContext* ctx, const BenchResult* result) {
+    const u64 ns = result->median_ns;
+
+    printf("  %-6s %12.3f %12.3f %12.3f %10.2f %14.0f %14.0f %12.0f\n",
+        bench_phase_names[result->phase],
+        (double)result->min_ns / 1e6,
+        (double)result->median_ns / 1e6,
+        result->mean_ns / 1e6,
+        per_second(ctx->source_size, ns) / (1024.0 * 1024.0),
+        per_second(result->last.tokens_count, ns),
+        per_second(result->last.nodes_count, ns),
+        result->last.functions_count == 0 ? 0.0 : (double)ns / (double)result->last.functions_count
+    );
+}
+
+static const PerfCounterKind per_item_counters[] = {
+    PERF_COUNTER_BRANCH_MISSES, PERF_COUNTER_L1D_MISSES, PERF_COUNTER_LLC_MISSES,
+};
+
+#define PER_ITEM_COUNTERS_COUNT (sizeof(per_item_counters) / sizeof(per_item_counters[0]))
+
+static void print_counters(const BenchResult* results, const u32 count) {
+    printf("\n  %-6s %12s %12s %12s %12s %12s %12s %12s\n", "phase", "IPC",
+        "brmiss/tok", "l1dmiss/tok", "llcmiss/tok", "brmiss/node", "l1dmiss/node", "llcmiss/node");
+
+    for (u32 i = 0; i < count; ++i) {
+        const BenchResult* result = &results[i];
+
+        printf("  %-6s", bench_phase_names[result->phase]);
+        print_ratio(get_ipc(&result->counters));
+        for (u32 j = 0; j < PER_ITEM_COUNTERS_COUNT; ++j) {
+            print_ratio(get_counter_per_item(&result->counters, per_item_counters[j], result->last.tokens_count));
+        }
+        for (u32 j = 0; j < PER_ITEM_COUNTERS_COUNT; ++j) {
+            print_ratio(get_counter_per_item(&result->counters, per_item_counters[j], result->last.nodes_count));
+        }
+        printf("\n");
+    }
+}
+
+static void write_counters_json(FILE* handle, const BenchResult* result) {
+    const PerfCounterValues* counters = &result->counters;
+
+    fputs("\"counters\": {", handle);
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        fprintf(handle, "%s\"%s\": ", i == 0 ? "" : ", ", get_perf_counter_name((PerfCounterKind)i));
+        if (counters->valid[i]) {
+            fprintf(handle, "%llu", counters->values[i]);
+        }
+        else {
+            fputs("null", handle);
+        }
+    }
+
+    fputs("}, \"ipc\": ", handle);
+    write_json_ratio(handle, get_ipc(counters));
+
+    fputs(", \"per_token\": {", handle);
+    for (u32 i = 0; i < PER_ITEM_COUNTERS_COUNT; ++i) {
+        fprintf(handle, "%s\"%s\": ", i == 0 ? "" : ", ", get_perf_counter_name(per_item_counters[i]));
+        write_json_ratio(handle, get_counter_per_item(counters, per_item_counters[i], result->last.tokens_count));
+    }
+
+    fputs("}, \"per_node\": {", handle);
+    for (u32 i = 0; i < PER_ITEM_COUNTERS_COUNT; ++i) {
+        fprintf(handle, "%s\"%s\": ", i == 0 ? "" : ", ", get_perf_counter_name(per_item_counters[i]));
+        write_json_ratio(handle, get_counter_per_item(counters, per_item_counters[i], result->last.nodes_count));
+    }
+    fputs("}", handle);
+}
+
+static bool write_results_file(const char* filepath, const BenchOptions* options, const BenchContext* ctx, const BenchResult* results, const u32 count, const VMBenchResult* vm, const VMBenchResult* vm_quick, const VMBenchResult* vm_jit, const NativeBenchResult* native, const u32 native_count) {
+    FILE* file = NULL;
+    i32 status = fopen_s(&file, filepath, "wb");
+    if (status != 0 || file == NULL) {
+        printf("Error: failed to open file \"%s\".\n", filepath);
+        return false;
+    }
+
+    const SourceGeneratorOptions* gen = &options->generator;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"label\": \"%s\",\n", options->label == NULL ? "" : options->label);
+    fprintf(file, "  \"generator\": {\"seed\": %llu, \"functions\": %ld, \"stmts\": %ld, \"depth\": %ld, \"expr_len\": %ld, "
+        "\"comment_density\": %ld, \"ident_len\": %ld, \"vars\": %ld, \"string_len\": %ld},\n",
+        gen->seed, gen->functions_count, gen->statements_count, gen->nesting_depth, gen->expression_length,
+        gen->comment_density, gen->identifier_length, gen->variables_count, gen->string_literal_length
+    );
+    fprintf(file, "  \"warmup\": %ld,\n", options->warmup_count);
+    fprintf(file, "  \"reps\": %ld,\n", options->repetitions_count);
+    fprintf(file, "  \"chunk_cap\": %lld,\n", options->stream_chunk_capacity);
+    fprintf(file, "  \"source_bytes\": %lld,\n", ctx->source_size);
+    fprintf(file, "  \"perf_counters\": %s,\n", ctx->has_perf_counters ? "true" : "false");
+    if (vm != NULL) {
+        write_vm_json(file, "vm", vm);
+    }
+    if (vm_quick != NULL) {
+        write_vm_json(file, "vm_quick", vm_quick);
+    }
+    if (vm_jit != NULL) {
+        write_vm_json(file, "vm_jit", vm_jit);
+    }
+    for (u32 i = 0; i < native_count; ++i) {
+        write_native_json(file, &native[i]);
+    }
+    fprintf(file, "  \"phases\": [\n");
+
+    for (u32 i = 0; i < count; ++i) {
+        const BenchResult* result = &results[i];
+        const u64 ns = result->median_ns;
+
+        fprintf(file, "    {\"name\": \"%s\", \"min_ns\": %llu, \"median_ns\": %llu, \"mean_ns\": %.1f, "
+            "\"tokens\": %llu, \"nodes\": %llu, \"functions\": %llu, \"cfg_nodes\": %llu, "
+            "\"mb_per_s\": %.3f, \"tokens_per_s\": %.1f, \"nodes_per_s\": %.1f, \"ns_per_function\": %.1f, ",
+            bench_phase_names[result->phase], result->min_ns, result->median_ns, result->mean_ns,
+            result->last.tokens_count, result->last.nodes_count, result->last.functions_count, result->last.cfg_nodes_count,
+            per_second(ctx->source_size, ns) / (1024.0 * 1024.0),
+            per_second(result->last.tokens_count, ns),
+            per_second(result->last.nodes_count, ns),
+            result->last.functions_count == 0 ? 0.0 : (double)ns / (double)result->last.functions_count
+        );
+        write_counters_json(file, result);
+        fprintf(file, "}%s\n", i + 1 < count ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+
+    printf("Saved results to \"%s\".\n", filepath);
+
+    return true;
+}
+
+static bool write_source_file(const char* filepath, const char* source, const u64 size) {
+    FILE* file = NULL;
+    i32 status = fopen_s(&file, filepath, "wb");
+    if (status != 0 || file == NULL) {
+        printf("Error: failed to open file \"%s\".\n", filepath);
+        return false;
+    }
+
+    fwrite(source, 1, size, file);
+    fclose(file);
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = { 0 };
+    bench_options_parse_args(&options, argc, argv);
+
+    char* source = generate_vane_source(&options.generator);
+
+    BenchContext ctx = {
+        .diag = diagnostic_engine_create(),
+        .stream = stream_create(),
+        .lexer = NULL,
+        .ast_parser = NULL,
+        .source = source,
+        .source_size = str_len(source),
+    };
+    ctx.lexer = lexer_create(options.stream_chunk_capacity, ctx.diag);
+    ctx.ast_parser = ast_parser_create(ctx.lexer, ctx.diag);
+
+    if (options.use_perf_counters) {
+        ctx.has_perf_counters = perf_counters_open(&ctx.perf);
+        if (!ctx.has_perf_counters) {
+            printf("Hardware performance counters are unavailable, only wall clock time is measured.\n");
+        }
+    }
+
+    if (options.source_filepath != NULL) {
+        write_source_file(options.source_filepath, source, ctx.source_size);
+    }
+
+    printf("Generated %ld functions, %.3f MB (seed %llu), %ld warmup + %ld measured runs.\n",
+        options.generator.functions_count,
+        (double)ctx.source_size / (1024.0 * 1024.0),
+        options.generator.seed,
+        options.warmup_count,
+        options.repetitions_count
+    );
+    printf("  %-6s %12s %12s %12s %10s %14s %14s %12s\n", "phase", "min, ms", "median, ms", "mean, ms", "MB/s", "tokens/s", "nodes/s", "ns/func");
+
+    BenchResult results[BENCH_PHASES_COUNT] = { 0 };
+    u32 results_count = 0;
+    int exit_code = 0;
+
+    for (u32 phase = 0; phase < BENCH_PHASES_COUNT; ++phase) {
+        if (!measure_phase(&ctx, &options, (BenchPhase)phase, &results[results_count])) {
+            exit_code = -1;
+            break;
+        }
+        print_result(&ctx, &results[results_count++]);
+    }
+
+    if (ctx.has_perf_counters) {
+        print_counters(results, results_count);
+    }
+
+    VMBenchResult vm_result = { 0 };
+    VMBenchResult vm_quick_result = { 0 };
+    VMBenchResult vm_jit_result = { 0 };
+    const bool has_vm_result = exit_code == 0 && options.vm_kernel_size != 0;
+    if (has_vm_result) {
+        if (measure_vm(&ctx, &options, false, false, &vm_result)
+            && measure_vm(&ctx, &options, true, false, &vm_quick_result)
+            && measure_vm(&ctx, &options, false, true, &vm_jit_result)) {
+            // The native code dispatches nothing, its rates are the ones of the bytecode it stands for.
+            vm_jit_result.instructions_count = vm_result.instructions_count;
+
+            print_vm_header(&options, &vm_result);
+            print_vm_result("vm", &vm_result);
+            print_vm_result("quick", &vm_quick_result);
+            print_vm_result("jit", &vm_jit_result);
+        }
+        else {
+            exit_code = -1;
+        }
+    }
+
+    NativeBenchResult native_results[] = {
+        { .name = "linear", .allocator = REG_ALLOCATOR_LINEAR_SCAN },
+        { .name = "graph", .allocator = REG_ALLOCATOR_GRAPH_COLORING },
+    };
+    const u32 native_count = exit_code == 0 && options.native_kernel_size != 0 ? 2 : 0;
+    for (u32 i = 0; i < native_count && exit_code == 0; ++i) {
+        exit_code = measure_native(&ctx, &options, &native_results[i]) ? 0 : -1;
+    }
+    if (native_count > 0 && exit_code == 0) {
+        print_native_header(&options);
+        for (u32 i = 0; i < native_count; ++i) {
+            print_native_result(&native_results[i]);
+        }
+    }
+
+    if (exit_code == 0 && options.output_filepath != NULL) {
+        write_results_file(options.output_filepath, &options, &ctx, results, results_count,
+            has_vm_result ? &vm_result : NULL, has_vm_result ? &vm_quick_result : NULL, has_vm_result ? &vm_jit_result : NULL,
+            native_results, native_count);
+    }
+
+    if (ctx.has_perf_counters) {
+        perf_counters_close(&ctx.perf);
+    }
+
+    ast_parser_free(ctx.ast_parser);
+    lexer_free(ctx.lexer);
+    stream_free(ctx.stream);
+    diagnostic_engine_free(ctx.diag);
+    str_free(source);
+    bench_options_free(&options);
+    return exit_code;
+}
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "native/native_bench.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#define NATIVE_EXE_EXT ".exe"
+#else
+#include <unistd.h>
+#define NATIVE_EXE_EXT ""
+#endif
+
+// Keeps more values live in the loops than there are registers, the result is the exit code so the run prints nothing.
+static const char* native_kernel_format =
+    "function power(base as long, exp as int) as long\n"
+    "    dim result as long\n"
+    "    dim i as int\n"
+    "    result = 1;\n"
+    "    i = 0;\n"
+    "    while (i < exp)\n"
+    "        result *= base;\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(result);\n"
+    "end function\n"
+    "\n"
+    "function is_armstrong(num as long) as int\n"
+    "    dim rest, sum as long\n"
+    "    dim digits as int\n"
+    "    digits = 0;\n"
+    "    rest = num;\n"
+    "    while (rest != 0)\n"
+    "        rest /= 10;\n"
+    "        ++digits;\n"
+    "    wend\n"
+    "    sum = 0;\n"
+    "    rest = num;\n"
+    "    while (rest != 0)\n"
+    "        sum += power(rest % 10, digits);\n"
+    "        rest /= 10;\n"
+    "    wend\n"
+    "    return(sum == num);\n"
+    "end function\n"
+    "\n"
+    "function mix(n as int) as long\n"
+    "    dim a, b, c, d, e, f, g, h, p, q, r, s, t, u as long\n"
+    "    dim i as int\n"
+    "    a = 1; b = 2; c = 3; d = 5; e = 7; f = 11; g = 13; h = 17;\n"
+    "    p = 19; q = 23; r = 29; s = 31; t = 37; u = 41;\n"
+    "    i = 0;\n"
+    "    while (i < n)\n"
+    "        a = (a * 3 + b) % 1000003;\n"
+    "        b = (b * 5 + c - a) % 1000033;\n"
+    "        c = (c * 7 + d + i) % 1000037;\n"
+    "        d = (d * 11 + e - b) % 1000039;\n"
+    "        e = (e * 13 + f + c) % 1000081;\n"
+    "        f = (f * 17 + g - d) % 1000099;\n"
+    "        g = (g * 19 + h + e) % 1000117;\n"
+    "        h = (h * 23 + p - f) % 1000121;\n"
+    "        p = (p * 29 + q + g) % 1000133;\n"
+    "        q = (q * 31 + r - h) % 1000151;\n"
+    "        r = (r * 37 + s + p) % 1000159;\n"
+    "        s = (s * 41 + t - q) % 1000171;\n"
+    "        t = (t * 43 + u + r) % 1000183;\n"
+    "        u = (u * 47 + a - s) % 1000187;\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(a + b + c + d + e + f + g + h + p + q + r + s + t + u);\n"
+    "end function\n"
+    "\n"
+    "function main(args as string()) as int\n"
+    "    dim i, count as int\n"
+    "    count = 0;\n"
+    "    i = 1;\n"
+    "    while (i < %ld / 10)\n"
+    "        count += is_armstrong(i);\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(count + mix(%ld) < 0);\n"
+    "end function\n";
+
+static u64 count_x64_instructions(const StringBuilder* text) {
+    u64 count = 0;
+    const u64 length = string_builder_get_len(text);
+    for (u64 i = 0; i + 1 < length; ++i) {
+        count += string_builder_get_char(text, i) == '\t' && string_builder_get_char(text, i + 1) != '.'
+            && (i == 0 || string_builder_get_char(text, i - 1) == '\n');
+    }
+    return count;
+}
+
+// Compiles every function of the source after the passes of "compile --opt_level 1" with the allocator,
+// the duration only counts the backend.
+static bool compile_native(BenchContext* ctx, const char* source, const RegAllocator allocator, X64Module* module, NativeBenchResult* result, u64* duration_ns) {
+    bool is_ok = true;
+    CFGContext* cfg_context = cfg_context_create(ctx->diag);
+
+    for (u32 pass = 0; pass < 2 && is_ok; ++pass) {
+        stream_set_source(ctx->stream, STREAM_STRING_SOURCE, source);
+        lexer_set_source_stream(ctx->lexer, ctx->stream);
+
+        while (is_ok && !is_ast_parser_done(ctx->ast_parser)) {
+            ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ctx->ast_parser);
+            if (funcdef == NULL) {
+                ast_parser_skip_to_the_end_of_a_file(ctx->ast_parser);
+                is_ok = false;
+                break;
+            }
+
+            const struct ASTFuncSignData* funcsign = funcdef->as.funcdef->funcsign->as.funcsign;
+            const char* name = funcsign->id->as.identifier->value;
+
+            if (pass == 0) {
+                x64_module_declare_function(module, name, (u32)funcsign->args.items_count);
+            }
+            else {
+                cfg_context_clear(cfg_context);
+                is_ok = build_cfg_for_function(cfg_context, funcdef) != CFG_NULL_NODE;
+                if (is_ok) {
+                    optimize_function(cfg_context, true, name);
+
+                    const u64 start_ns = profiler_now_ns();
+                    is_ok = compile_x64_function(module, cfg_context, name, funcdef->loc, allocator);
+                    *duration_ns += profiler_now_ns() - start_ns;
+
+                    result->spilled_count += module->allocation.spilled_count;
+                    result->split_count += module->allocation.split_count;
+                    result->slots_count += module->allocation.slots_count;
+                }
+            }
+
+            ast_node_free(funcdef);
+            ast_parser_release_consumed_tokens(ctx->ast_parser);
+        }
+        ast_parser_clear(ctx->ast_parser);
+    }
+
+    cfg_context_free(cfg_context);
+    return bench_check_diagnostics(ctx) && is_ok;
+}
+
+// The kernel is built in the temporary directory, under names of its own for every process and allocator.
+static char* get_temp_dirpath(void) {
+#ifdef _WIN32
+    char path[MAX_PATH + 1] = { 0 };
+    const DWORD length = GetTempPathA(sizeof(path), path);
+    return str_dup(length > 0 && length < sizeof(path) ? path : ".\\");
+#else
+    const char* dirpath = getenv("TMPDIR");
+    if (dirpath == NULL || dirpath[0] == '\0') {
+        dirpath = "/tmp";
+    }
+    return dirpath[str_len(dirpath) - 1] == '/' ? str_dup(dirpath) : str_format("%s/", dirpath);
+#endif
+}
+
+// cmd.exe drops the first and the last quote of a command that starts with one, so the whole command is quoted once more.
+static bool run_command(const char* command) {
+#ifdef _WIN32
+    char* quoted_command = str_format("\"%s\"", command);
+    const int status = system(quoted_command);
+    str_free(quoted_command);
+    return status == 0;
+#else
+    return system(command) == 0;
+#endif
+}
+
+// Links the assembly of the kernel with the C compiler and times whole runs of the executable.
+static bool run_native_kernel(const BenchOptions* options, const X64Module* module, NativeBenchResult* result) {
+    char* dirpath = get_temp_dirpath();
+    char* asm_filepath = str_format("%svane_bench_%llu_%s.s", dirpath, (u64)getpid(), result->name);
+    char* exe_filepath = str_format("%svane_bench_%llu_%s%s", dirpath, (u64)getpid(), result->name, NATIVE_EXE_EXT);
+    char* build_command = str_format("%s -o \"%s\" \"%s\"", options->cc, exe_filepath, asm_filepath);
+    char* run_command_line = str_format("\"%s\"", exe_filepath);
+
+    FILE* handle = NULL;
+    bool is_ok = fopen_s(&handle, asm_filepath, "wb") == 0 && handle != NULL;
+    if (is_ok) {
+        write_x64_module(handle, module);
+        fclose(handle);
+        is_ok = run_command(build_command);
+    }
+    if (!is_ok) {
+        printf("Error: failed to build \"%s\" with \"%s\".\n", exe_filepath, build_command);
+    }
+
+    u64* durations = malloc(options->repetitions_count * sizeof(u64));
+    assert(durations != NULL);
+
+    for (u32 i = 0; is_ok && i < options->warmup_count + options->repetitions_count; ++i) {
+        const u64 start_ns = profiler_now_ns();
+        is_ok = run_command(run_command_line);
+        if (i >= options->warmup_count) {
+            durations[i - options->warmup_count] = profiler_now_ns() - start_ns;
+        }
+    }
+
+    if (is_ok) {
+        result->run_median_ns = bench_sort_durations(durations, options->repetitions_count);
+        result->run_min_ns = durations[0];
+    }
+
+    // Either file may be missing when the build failed.
+    remove(exe_filepath);
+    remove(asm_filepath);
+
+    free(durations);
+    str_free(run_command_line);
+    str_free(build_command);
+    str_free(exe_filepath);
+    str_free(asm_filepath);
+    str_free(dirpath);
+    return is_ok;
+}
+
+bool measure_native(BenchContext* ctx, const BenchOptions* options, NativeBenchResult* result) {
+    u64* durations = malloc(options->repetitions_count * sizeof(u64));
+    assert(durations != NULL);
+
+    bool is_ok = true;
+    for (u32 i = 0; is_ok && i < options->warmup_count + options->repetitions_count; ++i) {
+        X64Module module = x64_module_create(ctx->diag);
+        NativeBenchResult run = *result;
+        u64 duration_ns = 0;
+
+        is_ok = compile_native(ctx, ctx->source, result->allocator, &module, &run, &duration_ns);
+        if (is_ok && i >= options->warmup_count) {
+            durations[i - options->warmup_count] = duration_ns;
+        }
+        if (is_ok && i + 1 == options->warmup_count + options->repetitions_count) {
+            *result = run;
+            result->functions_count = module.functions_count;
+            result->code_size = count_x64_instructions(&module.text);
+        }
+        x64_module_free(&module);
+    }
+
+    if (is_ok) {
+        result->median_ns = bench_sort_durations(durations, options->repetitions_count);
+        result->min_ns = durations[0];
+    }
+    free(durations);
+
+    char* kernel_source = str_format(native_kernel_format, options->native_kernel_size, options->native_kernel_size);
+    X64Module module = x64_module_create(ctx->diag);
+    NativeBenchResult kernel = { .allocator = result->allocator };
+    u64 duration_ns = 0;
+
+    is_ok = is_ok && compile_native(ctx, kernel_source, result->allocator, &module, &kernel, &duration_ns);
+    if (is_ok) {
+        result->kernel_spilled_count = kernel.spilled_count;
+        result->kernel_code_size = count_x64_instructions(&module.text);
+    }
+    if (is_ok && options->cc != NULL) {
+        is_ok = run_native_kernel(options, &module, result);
+    }
+
+    x64_module_free(&module);
+    str_free(kernel_source);
+    return is_ok;
+}
+
+void print_native_header(const BenchOptions* options) {
+    printf("\nRegister allocation (native kernel n = %ld%s):\n", options->native_kernel_size, options->cc == NULL ? ", not run without --cc" : "");
+    printf("  %-6s %12s %12s %10s %10s %10s %10s %12s %10s %10s %12s %12s\n", "", "min, ms", "median, ms", "ns/func",
+        "spilled", "split", "slots", "instrs", "k.spilled", "k.instrs", "run min, ms", "run med, ms");
+}
+
+void print_native_result(const NativeBenchResult* result) {
+    printf("  %-6s %12.3f %12.3f %10.0f %10llu %10llu %10llu %12llu %10llu %10llu %12.3f %12.3f\n",
+        result->name,
+        (double)result->min_ns / 1e6,
+        (double)result->median_ns / 1e6,
+        result->functions_count == 0 ? 0.0 : (double)result->median_ns / (double)result->functions_count,
+        result->spilled_count,
+        result->split_count,
+        result->slots_count,
+        result->code_size,
+        result->kernel_spilled_count,
+        result->kernel_code_size,
+        (double)result->run_min_ns / 1e6,
+        (double)result->run_median_ns / 1e6
+    );
+}
+
+void write_native_json(FILE* handle, const NativeBenchResult* result) {
+    fprintf(handle, "  \"native_%s\": {\"min_ns\": %llu, \"median_ns\": %llu, \"functions\": %llu, \"spilled\": %llu, "
+        "\"split\": %llu, \"slots\": %llu, \"instructions\": %llu, \"kernel_spilled\": %llu, \"kernel_instructions\": %llu, "
+        "\"run_min_ns\": %llu, \"run_median_ns\": %llu},\n",
+        result->name, result->min_ns, result->median_ns, result->functions_count, result->spilled_count,
+        result->split_count, result->slots_count, result->code_size, result->kernel_spilled_count, result->kernel_code_size,
+        result->run_min_ns, result->run_median_ns
+    );
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "bench.h"
+
+typedef struct {
+    const char* name;
+    RegAllocator allocator;
+
+    // Compiling the generated functions to assembly, from the liveness to the text.
+    u64 min_ns;
+    u64 median_ns;
+    u64 functions_count;
+
+    // Summed over the functions of the generated program, then of the kernel.
+    u64 spilled_count;
+    u64 split_count;
+    u64 slots_count;
+    u64 code_size;          // instructions of the assembly
+    u64 kernel_spilled_count;
+    u64 kernel_code_size;
+
+    // The kernel linked by the C compiler, 0 when there is none.
+    u64 run_min_ns;
+    u64 run_median_ns;
+} NativeBenchResult;
+
+// The allocations are compared over the generated functions, which are only compiled, and over the kernel,
+// which is also run when there is a C compiler to link it.
+bool measure_native(BenchContext* ctx, const BenchOptions* options, NativeBenchResult* result);
+
+void print_native_header(const BenchOptions* options);
+
+void print_native_result(const NativeBenchResult* result);
+
+void write_native_json(FILE* handle, const NativeBenchResult* result);
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "perf/perf_counters.h"
+
+#include <assert.h>
+
+#if defined(__linux__)
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+static const char* perf_counter_names[PERF_COUNTERS_COUNT] = {
+    "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses",
+};
+
+const char* get_perf_counter_name(const PerfCounterKind kind) {
+    assert(kind < PERF_COUNTERS_COUNT);
+    return perf_counter_names[kind];
+}
+
+#if defined(__linux__)
+
+typedef struct {
+    u32 type;
+    u64 config;
+} PerfCounterConfig;
+
+static const PerfCounterConfig perf_counter_configs[PERF_COUNTERS_COUNT] = {
+    [PERF_COUNTER_CYCLES]           = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_COUNTER_INSTRUCTIONS]     = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [PERF_COUNTER_BRANCH_MISSES]    = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    [PERF_COUNTER_L1D_MISSES]       = {
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    },
+    [PERF_COUNTER_LLC_MISSES]       = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+};
+
+static i32 open_perf_counter(const PerfCounterConfig* config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = config->type;
+    attr.config = config->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Every counter is opened on its own instead of as a group,
+    // so one unsupported event doesn't take the others down with it.
+    return (i32)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool perf_counters_open(PerfCounters* counters) {
+    assert(counters != NULL);
+
+    counters->available_count = 0;
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        counters->fds[i] = open_perf_counter(&perf_counter_configs[i]);
+        counters->available[i] = counters->fds[i] >= 0;
+
+        if (counters->available[i]) {
+            ++counters->available_count;
+        }
+    }
+
+    return counters->available_count > 0;
+}
+
+void perf_counters_close(PerfCounters* counters) {
+    assert(counters != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        if (counters->available[i]) {
+            close(counters->fds[i]);
+        }
+        counters->fds[i] = -1;
+        counters->available[i] = false;
+    }
+    counters->available_count = 0;
+}
+
+void perf_counters_start(PerfCounters* counters) {
+    assert(counters != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        if (counters->available[i]) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        if (counters->available[i]) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void perf_counters_stop(PerfCounters* counters, PerfCounterValues* values) {
+    assert(counters != NULL && values != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        if (counters->available[i]) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        values->values[i] = 0;
+        values->valid[i] = false;
+
+        if (!counters->available[i]) {
+            continue;
+        }
+
+        // value, time enabled, time running
+        u64 data[3] = { 0 };
+        if (read(counters->fds[i], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) {
+            continue;
+        }
+
+        // The kernel multiplexes counters when there are more events than hardware slots,
+        // scale the value up to the whole enabled time.
+        values->values[i] = data[2] < data[1]
+            ? (u64)((double)data[0] * (double)data[1] / (double)data[2])
+            : data[0];
+        values->valid[i] = true;
+    }
+}
+
+#else
+
+bool perf_counters_open(PerfCounters* counters) {
+    assert(counters != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        counters->fds[i] = -1;
+        counters->available[i] = false;
+    }
+    counters->available_count = 0;
+
+    return false;
+}
+
+void perf_counters_close(PerfCounters* counters) {
+    assert(counters != NULL);
+    counters->available_count = 0;
+}
+
+void perf_counters_start(PerfCounters* counters) {
+    assert(counters != NULL);
+}
+
+void perf_counters_stop(PerfCounters* counters, PerfCounterValues* values) {
+    assert(counters != NULL && values != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        values->values[i] = 0;
+        values->valid[i] = false;
+    }
+}
+
+#endif
+
+void perf_counter_values_add(PerfCounterValues* dst, const PerfCounterValues* src) {
+    assert(dst != NULL && src != NULL);
+
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        dst->values[i] += src->values[i];
+        dst->valid[i] = dst->valid[i] && src->valid[i];
+    }
+}
\ No newline at end of file
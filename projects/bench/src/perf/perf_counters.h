@@ -0,0 +1,39 @@
+#pragma once
+
+#include "vanec/utils/defines.h"
+
+typedef enum {
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_L1D_MISSES,
+    PERF_COUNTER_LLC_MISSES,
+    PERF_COUNTERS_COUNT,
+} PerfCounterKind;
+
+typedef struct {
+    i32 fds[PERF_COUNTERS_COUNT];
+    bool available[PERF_COUNTERS_COUNT];
+    u32 available_count;
+} PerfCounters;
+
+typedef struct {
+    u64 values[PERF_COUNTERS_COUNT];
+    bool valid[PERF_COUNTERS_COUNT];
+} PerfCounterValues;
+
+const char* get_perf_counter_name(const PerfCounterKind kind);
+
+// Opens every counter the platform allows. Counters that can't be opened
+// (no perf_event_open, perf_event_paranoid, virtual machines, non linux builds)
+// are just marked unavailable, so the caller can always use the rest of the api.
+// Returns false if no counter is available.
+bool perf_counters_open(PerfCounters* counters);
+
+void perf_counters_close(PerfCounters* counters);
+
+void perf_counters_start(PerfCounters* counters);
+
+void perf_counters_stop(PerfCounters* counters, PerfCounterValues* values);
+
+void perf_counter_values_add(PerfCounterValues* dst, const PerfCounterValues* src);
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "vm/vm_bench.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static const char* vm_kernel_source =
+    "function collatz_steps(n as long) as int\n"
+    "    dim steps as int\n"
+    "    steps = 0;\n"
+    "    while (n != 1)\n"
+    "        if (n % 2 == 0) then\n"
+    "            n = n / 2;\n"
+    "        else\n"
+    "            n = 3 * n + 1;\n"
+    "        end if\n"
+    "        ++steps;\n"
+    "    wend\n"
+    "    return(steps);\n"
+    "end function\n"
+    "\n"
+    "function gcd(a as int, b as int) as int\n"
+    "    dim t as int\n"
+    "    while (b != 0)\n"
+    "        t = a % b;\n"
+    "        a = b;\n"
+    "        b = t;\n"
+    "    wend\n"
+    "    return(a);\n"
+    "end function\n"
+    "\n"
+    "function kernel(n as int) as int\n"
+    "    dim i, sum as int\n"
+    "    i = 1;\n"
+    "    sum = 0;\n"
+    "    while (i <= n)\n"
+    "        sum += collatz_steps(i) + gcd(i, 360);\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(sum);\n"
+    "end function\n";
+
+// Compiles the kernel with the passes the "run" command of the testbed applies with "--optimize".
+static bool compile_vm_kernel(BenchContext* ctx, BCModule* module) {
+    stream_set_source(ctx->stream, STREAM_STRING_SOURCE, vm_kernel_source);
+    lexer_set_source_stream(ctx->lexer, ctx->stream);
+
+    bool result = true;
+
+    CFGContext* cfg_context = cfg_context_create(ctx->diag);
+    while (result && !is_ast_parser_done(ctx->ast_parser)) {
+        ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ctx->ast_parser);
+        if (funcdef == NULL) {
+            ast_parser_skip_to_the_end_of_a_file(ctx->ast_parser);
+            result = false;
+            break;
+        }
+
+        cfg_context_clear(cfg_context);
+        if (build_cfg_for_function(cfg_context, funcdef) != CFG_NULL_NODE) {
+            const char* name = funcdef->as.funcdef->funcsign->as.funcsign->id->as.identifier->value;
+            optimize_function(cfg_context, false, name);
+
+            result = compile_bytecode_function(module, cfg_context, name, funcdef->loc) != BC_NULL_FUNCTION;
+        }
+        else {
+            result = false;
+        }
+
+        ast_node_free(funcdef);
+        ast_parser_release_consumed_tokens(ctx->ast_parser);
+    }
+    cfg_context_free(cfg_context);
+    ast_parser_clear(ctx->ast_parser);
+
+    result = result && bc_module_link(module);
+    return bench_check_diagnostics(ctx) && result;
+}
+
+bool measure_vm(BenchContext* ctx, const BenchOptions* options, const bool quicken, const bool use_jit, VMBenchResult* result) {
+    BCModule module = bc_module_create(ctx->diag);
+    if (!compile_vm_kernel(ctx, &module)) {
+        bc_module_free(&module);
+        return false;
+    }
+
+    if (quicken) {
+        for (u32 i = 0; i < bc_module_get_functions_count(&module); ++i) {
+            quicken_bytecode_function(bc_module_get_function(&module, i));
+        }
+    }
+
+    const u32 kernel = bc_module_find_function(&module, "kernel");
+    assert(kernel != BC_NULL_FUNCTION);
+
+    VM vm = vm_create(&module, stdout, VM_DEFAULT_STACK_SIZE, VM_DEFAULT_MAX_FRAMES);
+    const i64 arg = options->vm_kernel_size;
+
+    JIT jit = { 0 };
+    if (use_jit) {
+        jit = jit_create(&module, 0, JIT_DEFAULT_CODE_CAPACITY);
+        vm.jit = &jit;
+    }
+
+    bool is_ok = true;
+    for (u32 i = 0; is_ok && i < options->warmup_count; ++i) {
+        is_ok = vm_call(&vm, kernel, &arg, 1, &result->value) == VM_STATUS_OK;
+    }
+
+    u64* durations = malloc(options->repetitions_count * sizeof(u64));
+    assert(durations != NULL);
+
+    PerfCounterValues counters = { 0 };
+    for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+        counters.valid[i] = ctx->has_perf_counters;
+    }
+
+    u64 total_ns = 0;
+    for (u32 i = 0; is_ok && i < options->repetitions_count; ++i) {
+        BenchSample sample = { 0 };
+        const u64 executed_count = vm.executed_count;
+
+        const u64 start_ns = bench_measure_begin(ctx);
+        is_ok = vm_call(&vm, kernel, &arg, 1, &result->value) == VM_STATUS_OK;
+        bench_measure_end(ctx, &sample, start_ns);
+
+        durations[i] = sample.duration_ns;
+        total_ns += sample.duration_ns;
+        result->instructions_count = vm.executed_count - executed_count;
+        perf_counter_values_add(&counters, &sample.counters);
+    }
+
+    if (is_ok) {
+        for (u32 i = 0; i < PERF_COUNTERS_COUNT; ++i) {
+            counters.values[i] /= options->repetitions_count;
+        }
+
+        result->median_ns = bench_sort_durations(durations, options->repetitions_count);
+        result->min_ns = durations[0];
+        result->mean_ns = (double)total_ns / (double)options->repetitions_count;
+        result->counters = counters;
+
+        result->code_size = 0;
+        for (u32 i = 0; i < bc_module_get_functions_count(&module); ++i) {
+            result->code_size += (u32)bc_module_get_function(&module, i)->code.items_count;
+        }
+    }
+    else {
+        printf("Error: the interpreter kernel failed with \"%s\".\n", get_vm_status_text(vm.status));
+    }
+
+    free(durations);
+    if (use_jit) {
+        jit_free(&jit);
+    }
+    vm_free(&vm);
+    bc_module_free(&module);
+    return is_ok;
+}
+
+void print_vm_header(const BenchOptions* options, const VMBenchResult* result) {
+    printf("\nInterpreter kernel (n = %ld): %u bytecode instructions, result %lld.\n",
+        options->vm_kernel_size, (unsigned)result->code_size, result->value);
+    printf("  %-6s %12s %12s %12s %14s %14s %10s %12s\n", "", "min, ms", "median, ms", "mean, ms", "instructions", "instrs/s", "ns/instr", "brmiss/instr");
+}
+
+void print_vm_result(const char* name, const VMBenchResult* result) {
+    const u64 ns = result->median_ns;
+
+    printf("  %-6s %12.3f %12.3f %12.3f %14llu %14.0f %10.3f",
+        name,
+        (double)result->min_ns / 1e6,
+        (double)result->median_ns / 1e6,
+        result->mean_ns / 1e6,
+        result->instructions_count,
+        per_second(result->instructions_count, ns),
+        result->instructions_count == 0 ? 0.0 : (double)ns / (double)result->instructions_count
+    );
+    print_ratio(get_counter_per_item(&result->counters, PERF_COUNTER_BRANCH_MISSES, result->instructions_count));
+    printf("\n");
+}
+
+void write_vm_json(FILE* handle, const char* key, const VMBenchResult* result) {
+    const u64 ns = result->median_ns;
+
+    fprintf(handle, "  \"%s\": {\"min_ns\": %llu, \"median_ns\": %llu, \"mean_ns\": %.1f, \"instructions\": %llu, "
+        "\"code_size\": %lu, \"instructions_per_s\": %.1f, \"ns_per_instruction\": %.4f, \"branch_misses_per_instruction\": ",
+        key, result->min_ns, result->median_ns, result->mean_ns, result->instructions_count, result->code_size,
+        per_second(result->instructions_count, ns),
+        result->instructions_count == 0 ? 0.0 : (double)ns / (double)result->instructions_count
+    );
+    write_json_ratio(handle, get_counter_per_item(&result->counters, PERF_COUNTER_BRANCH_MISSES, result->instructions_count));
+    fputs("},\n", handle);
+}
\ No newline at end of file
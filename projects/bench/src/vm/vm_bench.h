@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bench.h"
+
+// The interpreter runs a fixed loop heavy kernel, the generated functions are not meant to be executed.
+typedef struct {
+    u64 min_ns;
+    u64 median_ns;
+    double mean_ns;
+    u64 instructions_count;     // bytecode instructions dispatched by one run
+    u32 code_size;              // bytecode instructions of the module
+    i64 value;
+
+    PerfCounterValues counters;
+} VMBenchResult;
+
+// Every run calls the kernel once, the dispatch overhead is the time per executed instruction.
+// The quickened kernel runs the same code with superinstructions and width specialized arithmetic,
+// the jitted one runs it as native code compiled on the first call.
+bool measure_vm(BenchContext* ctx, const BenchOptions* options, const bool quicken, const bool use_jit, VMBenchResult* result);
+
+void print_vm_header(const BenchOptions* options, const VMBenchResult* result);
+
+void print_vm_result(const char* name, const VMBenchResult* result);
+
+void write_vm_json(FILE* handle, const char* key, const VMBenchResult* result);
@@ -1,7 +1,10 @@
 #include "vanec/vanec.h"
 
+#include <stdint.h>
 #include <stdio.h>
 
+#define VM_PROFILE_TOP_COUNT 12
+
 static bool set_source_file(Lexer* lexer, Stream* stream, const char* filepath) {
     printf("File - \"%s\".\n", filepath);
     if (!is_file_exists(filepath)) {
@@ -23,11 +26,44 @@ static bool set_source_file(Lexer* lexer, Stream* stream, const char* filepath)
     return true;
 }
 
+static const char* get_funcdef_name(const ASTNode* funcdef) {
+    if (funcdef == NULL) {
+        return "<invalid function>";
+    }
+    return funcdef->as.funcdef->funcsign->as.funcsign->id->as.identifier->value;
+}
+
+// The IR passes shared by the commands, selected by the options.
+// The optimizations put the function in SSA form themselves, '--ssa' alone only builds it for the output.
+static void run_ir_passes(CFGContext* cfg_context, const CompilerOptions* options, const ASTNode* funcdef, const bool lower_divisions) {
+    if (options->opt_level >= COMPILER_OPT_LEVEL_PASSES) {
+        optimize_function(cfg_context, lower_divisions, get_funcdef_name(funcdef));
+    }
+    else if (options->output_ssa) {
+        PROFILE_SCOPE_BEGIN(ssa);
+        construct_ssa(cfg_context);
+        PROFILE_SCOPE_END(ssa, "ssa", get_funcdef_name(funcdef));
+    }
+}
+
+// The optimizing tier spends the time of the graph coloring on the functions with loops, where the copies and the
+// spills it saves run the most, the others keep the linear scan.
+static RegAllocator select_reg_allocator(CFGContext* cfg_context, const CompilerOptions* options) {
+    if (options->opt_level >= COMPILER_OPT_LEVEL_FULL && loop_forest_get_loops_count(cfg_context_get_loop_forest(cfg_context)) > 0) {
+        return REG_ALLOCATOR_GRAPH_COLORING;
+    }
+    return REG_ALLOCATOR_LINEAR_SCAN;
+}
+
 int main(int argc, char** argv) {
     CompilerOptions options = { 0 };
 
     compiler_options_init(&options);
     compiler_options_parse_args(&options, argc, argv);
+
+    if (options.time_report || options.trace_filepath != NULL) {
+        profiler_enable();
+    }
     
     //
     DiagnosticEngine* diag = diagnostic_engine_create();
@@ -45,10 +81,14 @@ int main(int argc, char** argv) {
                 continue;
             }
 
+            PROFILE_SCOPE_BEGIN(file);
+
             TokenKind token_kind = TOKEN_UNKNOWN;
             u64 tok_num = 0;
             while (token_kind != TOKEN_END_OF_FILE) {
+                PROFILE_SCOPE_BEGIN(lex);
                 Token token = lexer_parse_next_token(lexer);
+                PROFILE_SCOPE_ACCUMULATE(lex, "lex", "lexer_parse_next_token");
 
                 char* tok_str = token_to_str(&token);
                 printf("#%lld (%ld,%ld): %s\n", ++tok_num, token.loc.start.row, token.loc.start.col, tok_str);
@@ -58,6 +98,8 @@ int main(int argc, char** argv) {
                 token_free(&token);
             }
 
+            PROFILE_SCOPE_END(file, "file", filepath);
+
             diagnostic_engine_print_all(diag);
             diagnostic_engine_clear(diag);
         }
@@ -70,10 +112,14 @@ int main(int argc, char** argv) {
                 continue;
             }
 
+            PROFILE_SCOPE_BEGIN(file);
+
             Vector functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ASTNode*), &ast_node_free, true);
 
             while (!is_ast_parser_done(ast_parser)) {
+                PROFILE_SCOPE_BEGIN(parse);
                 ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+                PROFILE_SCOPE_END(parse, "parse", get_funcdef_name(funcdef));
 
                 if (funcdef != NULL) {
                     vector_push_back(&functions, &funcdef);
@@ -87,7 +133,11 @@ int main(int argc, char** argv) {
 
             char* output_filepath = str_concat(filepath, ".dot");
 
+            PROFILE_SCOPE_BEGIN(dot);
             write_ast_dot_file(output_filepath, &functions);
+            PROFILE_SCOPE_END(dot, "dot", filepath);
+
+            PROFILE_SCOPE_END(file, "file", filepath);
 
             diagnostic_engine_print_all(diag);
             diagnostic_engine_clear(diag);
@@ -111,58 +161,364 @@ int main(int argc, char** argv) {
             dirpath = get_dirpath(filepath);
             filename = get_filename(filepath);
 
-            Vector ast_functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ASTNode*), &ast_node_free, true);
+            char* output_filepath_tmp = options.output_dir == NULL
+                ? str_format("%s%s", dirpath, filename)
+                : str_format("%s/%s", options.output_dir, filename);
+
+            str_free(dirpath);
+            str_free(filename);
+
+            PROFILE_SCOPE_BEGIN(file);
+
+            // Every function goes through the whole pipeline and is released before the next one is parsed,
+            // together with its tokens, so the memory is bound by the largest function instead of the file.
+            // The cfg context keeps its pools between functions.
+            CFGContext* cfg_context = cfg_context_create(diag);
 
             while (!is_ast_parser_done(ast_parser)) {
+                PROFILE_SCOPE_BEGIN(parse);
                 ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+                PROFILE_SCOPE_END(parse, "parse", get_funcdef_name(funcdef));
 
-                if (funcdef != NULL) {
-                    vector_push_back(&ast_functions, &funcdef);
-                }
                 // There is no recovery at the moment.
                 // Just skip to the end of the file.
-                else {
+                if (funcdef == NULL) {
                     ast_parser_skip_to_the_end_of_a_file(ast_parser);
+                    break;
+                }
+
+                cfg_context_clear(cfg_context);
+
+                PROFILE_SCOPE_BEGIN(cfg);
+                const u32 func_entry = build_cfg_for_function(cfg_context, funcdef);
+                PROFILE_SCOPE_END(cfg, "cfg", get_funcdef_name(funcdef));
+
+                if (func_entry != CFG_NULL_NODE && options.opt_level >= COMPILER_OPT_LEVEL_PASSES) {
+                    PROFILE_SCOPE_BEGIN(simplify);
+                    simplify_cfg(cfg_context);
+                    PROFILE_SCOPE_END(simplify, "simplify", get_funcdef_name(funcdef));
                 }
+
+                if (func_entry != CFG_NULL_NODE) {
+                    char* output_filepath = str_format("%s.%s.dot", output_filepath_tmp, get_funcdef_name(funcdef));
+
+                    PROFILE_SCOPE_BEGIN(dot);
+                    write_cfg_dot_file(output_filepath, cfg_context, cfg_context->graph.entry);
+                    PROFILE_SCOPE_END(dot, "dot", get_funcdef_name(funcdef));
+
+                    str_free(output_filepath);
+                }
+
+                ast_node_free(funcdef);
+                ast_parser_release_consumed_tokens(ast_parser);
             }
 
-            char* output_filepath_tmp = options.output_dir == NULL
-                ? str_format("%s%s", dirpath, filename)
-                : str_format("%s/%s", options.output_dir, filename);
+            cfg_context_free(cfg_context);
 
-            str_free(dirpath);
-            str_free(filename);
+            diagnostic_engine_print_all(diag);
+            diagnostic_engine_clear(diag);
 
-            for (u64 j = 0; j < ast_functions.items_count; ++j) {
-                const ASTNode* funcdef = vector_get_ref(&ast_functions, j);
+            str_free(output_filepath_tmp);
+            ast_parser_clear(ast_parser);
 
-                CFGContext* cfg_context = cfg_context_create(diag);
+            PROFILE_SCOPE_END(file, "file", filepath);
+        }
+    } break;
+    case COMPILER_COMMAND_BUILD_IR_ONLY: {
+        for (u64 i = 0; i < options.files.items_count; ++i) {
+            const char* filepath = vector_get_ref(&options.files, i);
 
-                CFGNode* func_entry = build_cfg_for_function(cfg_context, funcdef);
+            if (!set_source_file(lexer, stream, filepath)) {
+                continue;
+            }
 
-                if (func_entry == NULL) {
-                    cfg_context_free(cfg_context);
-                    continue;
+            PROFILE_SCOPE_BEGIN(file);
+
+            CFGContext* cfg_context = cfg_context_create(diag);
+
+            while (!is_ast_parser_done(ast_parser)) {
+                PROFILE_SCOPE_BEGIN(parse);
+                ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+                PROFILE_SCOPE_END(parse, "parse", get_funcdef_name(funcdef));
+
+                if (funcdef == NULL) {
+                    ast_parser_skip_to_the_end_of_a_file(ast_parser);
+                    break;
                 }
 
-                char* output_filepath = str_format("%s.%s.dot", output_filepath_tmp, funcdef->as.funcdef->funcsign->as.funcsign->id->as.identifier->value);
+                cfg_context_clear(cfg_context);
 
-                write_cfg_dot_file(output_filepath, func_entry);
+                PROFILE_SCOPE_BEGIN(cfg);
+                const u32 func_entry = build_cfg_for_function(cfg_context, funcdef);
+                PROFILE_SCOPE_END(cfg, "cfg", get_funcdef_name(funcdef));
 
-                cfg_context_free(cfg_context);
-                str_free(output_filepath);
+                if (func_entry != CFG_NULL_NODE) {
+                    run_ir_passes(cfg_context, &options, funcdef, true);
+
+                    // The optimized function is only printed in SSA form when it is asked for.
+                    if (!options.output_ssa && cfg_context->ir.is_ssa) {
+                        PROFILE_SCOPE_BEGIN(out_of_ssa);
+                        destruct_ssa(cfg_context);
+                        PROFILE_SCOPE_END(out_of_ssa, "out_of_ssa", get_funcdef_name(funcdef));
+                    }
+                    print_cfg_ir(stdout, cfg_context, get_funcdef_name(funcdef));
+                }
+
+                ast_node_free(funcdef);
+                ast_parser_release_consumed_tokens(ast_parser);
             }
 
+            cfg_context_free(cfg_context);
+
             diagnostic_engine_print_all(diag);
             diagnostic_engine_clear(diag);
 
-            vector_free(&ast_functions);
-            str_free(output_filepath_tmp);
             ast_parser_clear(ast_parser);
+
+            PROFILE_SCOPE_END(file, "file", filepath);
+        }
+    } break;
+    case COMPILER_COMMAND_RUN: {
+        const char* filepath = vector_get_ref(&options.files, 0);
+
+        if (!set_source_file(lexer, stream, filepath)) {
+            break;
+        }
+
+        PROFILE_SCOPE_BEGIN(file);
+
+        // Calls are resolved by name, so all the functions are compiled before the module is linked.
+        CFGContext* cfg_context = cfg_context_create(diag);
+        BCModule module = bc_module_create(diag);
+        bool is_valid = true;
+
+        while (!is_ast_parser_done(ast_parser)) {
+            PROFILE_SCOPE_BEGIN(parse);
+            ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+            PROFILE_SCOPE_END(parse, "parse", get_funcdef_name(funcdef));
+
+            if (funcdef == NULL) {
+                ast_parser_skip_to_the_end_of_a_file(ast_parser);
+                is_valid = false;
+                break;
+            }
+
+            cfg_context_clear(cfg_context);
+
+            PROFILE_SCOPE_BEGIN(cfg);
+            const u32 func_entry = build_cfg_for_function(cfg_context, funcdef);
+            PROFILE_SCOPE_END(cfg, "cfg", get_funcdef_name(funcdef));
+
+            if (func_entry != CFG_NULL_NODE) {
+                run_ir_passes(cfg_context, &options, funcdef, false);
+
+                PROFILE_SCOPE_BEGIN(bytecode);
+                is_valid &= compile_bytecode_function(&module, cfg_context, get_funcdef_name(funcdef), funcdef->loc) != BC_NULL_FUNCTION;
+                PROFILE_SCOPE_END(bytecode, "bytecode", get_funcdef_name(funcdef));
+            }
+            else {
+                is_valid = false;
+            }
+
+            ast_node_free(funcdef);
+            ast_parser_release_consumed_tokens(ast_parser);
+        }
+
+        cfg_context_free(cfg_context);
+
+        is_valid = is_valid && bc_module_link(&module);
+
+        diagnostic_engine_print_all(diag);
+        diagnostic_engine_clear(diag);
+
+        const u32 main_func = is_valid ? bc_module_find_function(&module, "main") : BC_NULL_FUNCTION;
+        if (is_valid && main_func == BC_NULL_FUNCTION) {
+            printf("Error: The file has no main function.\n");
+        }
+
+        if (main_func != BC_NULL_FUNCTION) {
+            if (options.opt_level >= COMPILER_OPT_LEVEL_PASSES) {
+                for (u32 i = 0; i < bc_module_get_functions_count(&module); ++i) {
+                    quicken_bytecode_function(bc_module_get_function(&module, i));
+                }
+            }
+
+            if (options.output_bytecode) {
+                for (u32 i = 0; i < bc_module_get_functions_count(&module); ++i) {
+                    print_bc_function(stdout, &module, bc_module_get_function(&module, i));
+                }
+            }
+
+            VM vm = vm_create(&module, stdout, VM_DEFAULT_STACK_SIZE, VM_DEFAULT_MAX_FRAMES);
+
+            VMProfile profile = { 0 };
+            if (options.profile_vm) {
+                profile = vm_profile_create();
+                vm.profile = &profile;
+            }
+
+            // Without the host support the jit leaves every function to the interpreter.
+            JIT jit = { 0 };
+            if (options.jit) {
+                jit = jit_create(&module, options.jit_threshold, JIT_DEFAULT_CODE_CAPACITY);
+                vm.jit = &jit;
+            }
+
+            // 'main(args as string())' gets no arguments.
+            VMArray args = { .items = NULL, .count = 0 };
+            const i64 arg = (i64)(uintptr_t)&args;
+            i64 result = 0;
+
+            PROFILE_SCOPE_BEGIN(run);
+            const VMStatus status = vm_call(&vm, main_func, &arg, 1, &result);
+            PROFILE_SCOPE_END(run, "run", "main");
+
+            if (status == VM_STATUS_OK) {
+                printf("\nmain returned %lld, %llu instructions executed.\n", result, vm.executed_count);
+                if (options.jit) {
+                    printf("%lu functions compiled to native code.\n", jit.compiled_count);
+                }
+            }
+            else {
+                printf("\nRuntime error: %s in function '%s'.\n", get_vm_status_text(status), vm.fault_function->name);
+            }
+
+            if (options.profile_vm) {
+                print_vm_profile(stdout, &profile, VM_PROFILE_TOP_COUNT);
+                vm_profile_free(&profile);
+            }
+
+            if (options.jit) {
+                jit_free(&jit);
+            }
+            vm_free(&vm);
+        }
+
+        bc_module_free(&module);
+        ast_parser_clear(ast_parser);
+
+        PROFILE_SCOPE_END(file, "file", filepath);
+    } break;
+    case COMPILER_COMMAND_COMPILE: {
+        for (u64 i = 0; i < options.files.items_count; ++i) {
+            const char* filepath = vector_get_ref(&options.files, i);
+
+            if (!set_source_file(lexer, stream, filepath)) {
+                continue;
+            }
+
+            PROFILE_SCOPE_BEGIN(file);
+
+            // A call needs the parameters of its callee, which may come later in the file,
+            // so the signatures are collected by a first pass over the file.
+            X64Module module = x64_module_create(diag);
+            bool is_valid = true;
+
+            while (!is_ast_parser_done(ast_parser)) {
+                ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+                if (funcdef == NULL) {
+                    ast_parser_skip_to_the_end_of_a_file(ast_parser);
+                    is_valid = false;
+                    break;
+                }
+
+                const struct ASTFuncSignData* funcsign = funcdef->as.funcdef->funcsign->as.funcsign;
+                x64_module_declare_function(&module, get_funcdef_name(funcdef), (u32)funcsign->args.items_count);
+
+                ast_node_free(funcdef);
+                ast_parser_release_consumed_tokens(ast_parser);
+            }
+            ast_parser_clear(ast_parser);
+
+            CFGContext* cfg_context = cfg_context_create(diag);
+
+            is_valid = is_valid && stream_set_source(stream, STREAM_FILE_SOURCE, filepath);
+            if (is_valid) {
+                lexer_set_source_stream(lexer, stream);
+            }
+
+            while (is_valid && !is_ast_parser_done(ast_parser)) {
+                PROFILE_SCOPE_BEGIN(parse);
+                ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(ast_parser);
+                PROFILE_SCOPE_END(parse, "parse", get_funcdef_name(funcdef));
+
+                if (funcdef == NULL) {
+                    ast_parser_skip_to_the_end_of_a_file(ast_parser);
+                    is_valid = false;
+                    break;
+                }
+
+                cfg_context_clear(cfg_context);
+
+                PROFILE_SCOPE_BEGIN(cfg);
+                const u32 func_entry = build_cfg_for_function(cfg_context, funcdef);
+                PROFILE_SCOPE_END(cfg, "cfg", get_funcdef_name(funcdef));
+
+                if (func_entry != CFG_NULL_NODE) {
+                    run_ir_passes(cfg_context, &options, funcdef, true);
+
+                    PROFILE_SCOPE_BEGIN(x64);
+                    const RegAllocator allocator = select_reg_allocator(cfg_context, &options);
+                    is_valid &= compile_x64_function(&module, cfg_context, get_funcdef_name(funcdef), funcdef->loc, allocator);
+                    PROFILE_SCOPE_END(x64, "x64", get_funcdef_name(funcdef));
+                }
+                else {
+                    is_valid = false;
+                }
+
+                ast_node_free(funcdef);
+                ast_parser_release_consumed_tokens(ast_parser);
+            }
+
+            cfg_context_free(cfg_context);
+
+            diagnostic_engine_print_all(diag);
+            diagnostic_engine_clear(diag);
+
+            if (is_valid && x64_module_find_declaration(&module, "main") == NULL) {
+                printf("Error: The file has no main function.\n");
+                is_valid = false;
+            }
+
+            if (is_valid) {
+                char* dirpath = get_dirpath(filepath);
+                char* filename = get_filename(filepath);
+                char* output_filepath = options.output_dir == NULL
+                    ? str_format("%s%s.s", dirpath, filename)
+                    : str_format("%s/%s.s", options.output_dir, filename);
+
+                FILE* handle = NULL;
+                const i32 status = fopen_s(&handle, output_filepath, "wb");
+                if (status == 0 && handle != NULL) {
+                    write_x64_module(handle, &module);
+                    fclose(handle);
+                    printf("Assembly written to \"%s\".\n", output_filepath);
+                }
+                else {
+                    printf("Error: Failed to open \"%s\" for writing.\n", output_filepath);
+                }
+
+                str_free(output_filepath);
+                str_free(dirpath);
+                str_free(filename);
+            }
+
+            x64_module_free(&module);
+            ast_parser_clear(ast_parser);
+
+            PROFILE_SCOPE_END(file, "file", filepath);
         }
     } break;
     };
 
+    if (options.time_report) {
+        profiler_print_time_report();
+    }
+    if (options.trace_filepath != NULL) {
+        profiler_write_trace_file(options.trace_filepath);
+    }
+    profiler_disable();
+
     ast_parser_free(ast_parser);
     lexer_free(lexer);
     stream_free(stream);
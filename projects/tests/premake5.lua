@@ -1,3 +1,8 @@
+newoption {
+    trigger         = "complexity-tests",
+    description     = "Run the wall clock complexity tests",
+}
+
 project ("tests")
     kind            ("ConsoleApp")
     language        ("C")
@@ -15,14 +20,24 @@ project ("tests")
     }
     -- 
     includedirs {
+        "src",
         PROJECTS_DIR_PATH .. "vanec/include",
         DEPENDENCIES_DIR_PATH,
     }
     -- 
+    defines {
+        ("EXAMPLES_DIR_PATH=\"" .. EXAMPLES_DIR_PATH .. "\""),
+    }
+    -- 
     links {
         "vanec",
     }
     -- 
     debugargs { 
         "--enable-mixed-units",
-    }
\ No newline at end of file
+    }
+    -- 
+    filter ("options:complexity-tests")
+        defines { "COMPLEXITY_TESTS" }
+
+    filter {}
\ No newline at end of file
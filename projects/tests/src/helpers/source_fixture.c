@@ -0,0 +1,156 @@
+#include "helpers/source_fixture.h"
+
+#include <assert.h>
+
+#include "vanec/backend/bc_compiler.h"
+#include "vanec/backend/bc_quickening.h"
+
+#define MAX_PRESERVED_ROWS_COUNT 512
+
+SourceFixture source_fixture_create(DiagnosticEngine* diag) {
+    SourceFixture fixture = { 0 };
+    fixture.ss = stream_create();
+    fixture.lexer = lexer_create(MIN_STREAM_CHUNK_CAPACITY, diag);
+    fixture.parser = ast_parser_create(fixture.lexer, diag);
+    fixture.ctx = cfg_context_create(diag);
+    fixture.funcdef = NULL;
+    return fixture;
+}
+
+void source_fixture_free(SourceFixture* fixture) {
+    if (fixture == NULL) {
+        return;
+    }
+
+    ast_node_free(fixture->funcdef);
+    cfg_context_free(fixture->ctx);
+    ast_parser_free(fixture->parser);
+    lexer_free(fixture->lexer);
+    stream_free(fixture->ss);
+}
+
+u32 source_fixture_build(SourceFixture* fixture, const char* source) {
+    assert(fixture != NULL && source != NULL);
+
+    stream_set_source(fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(fixture->lexer, fixture->ss);
+    ast_parser_clear(fixture->parser);
+
+    ast_node_free(fixture->funcdef);
+    cfg_context_clear(fixture->ctx);
+
+    fixture->funcdef = ast_parser_parse_ast_funcdef_node(fixture->parser);
+    if (fixture->funcdef == NULL) {
+        return CFG_NULL_NODE;
+    }
+    return build_cfg_for_function(fixture->ctx, fixture->funcdef);
+}
+
+const char* get_source_funcdef_name(const ASTNode* funcdef) {
+    return funcdef->as.funcdef->funcsign->as.funcsign->id->as.identifier->value;
+}
+
+u32 count_source_opcodes(const CFGContext* ctx, const IROpcode op) {
+    u32 count = 0;
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            count += cfg_context_get_instr(ctx, id, i)->op == op;
+        }
+    }
+    return count;
+}
+
+u32 count_source_loop_opcodes(CFGContext* ctx, const IROpcode op) {
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+
+    u32 count = 0;
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        if (loop_forest_get_block_loop(forest, id) == CFG_NULL_LOOP) {
+            continue;
+        }
+
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            count += cfg_context_get_instr(ctx, id, i)->op == op;
+        }
+    }
+    return count;
+}
+
+bool source_fixture_compile_bytecode(SourceFixture* fixture, BCModule* module, const StreamSourceKind kind, const char* source, const SourcePasses passes) {
+    assert(fixture != NULL && module != NULL && source != NULL);
+
+    if (!stream_set_source(fixture->ss, kind, source)) {
+        return false;
+    }
+    lexer_set_source_stream(fixture->lexer, fixture->ss);
+    ast_parser_clear(fixture->parser);
+
+    bc_module_clear(module);
+
+    bool result = true;
+    while (result && !is_ast_parser_done(fixture->parser)) {
+        ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(fixture->parser);
+        if (funcdef == NULL) {
+            result = false;
+            break;
+        }
+
+        cfg_context_clear(fixture->ctx);
+        result = build_cfg_for_function(fixture->ctx, funcdef) != CFG_NULL_NODE;
+
+        if (result && passes != NULL) {
+            passes(fixture->ctx);
+        }
+        result = result && compile_bytecode_function(module, fixture->ctx, get_source_funcdef_name(funcdef), funcdef->loc) != BC_NULL_FUNCTION;
+
+        ast_node_free(funcdef);
+    }
+
+    ast_parser_clear(fixture->parser);
+    return result && bc_module_link(module);
+}
+
+void source_fixture_quicken_module(BCModule* module) {
+    assert(module != NULL);
+
+    for (u32 i = 0; i < bc_module_get_functions_count(module); ++i) {
+        quicken_bytecode_function(bc_module_get_function(module, i));
+    }
+}
+
+VMStatus source_fixture_run_function(const BCModule* module, FILE* out, const char* name, const i64* args, const u32 count, i64* result) {
+    const u32 func = bc_module_find_function(module, name);
+    assert(func != BC_NULL_FUNCTION);
+
+    VM vm = vm_create(module, out, VM_DEFAULT_STACK_SIZE, VM_DEFAULT_MAX_FRAMES);
+    const VMStatus status = vm_call(&vm, func, args, count, result);
+    vm_free(&vm);
+
+    return status;
+}
+
+bool is_source_behavior_preserved(SourceFixture* fixture, const char* source, const char* name, const SourcePasses passes, const i64* rows, const u32 args_count, const u32 rows_count) {
+    assert(rows_count <= MAX_PRESERVED_ROWS_COUNT);
+
+    VMStatus expected_statuses[MAX_PRESERVED_ROWS_COUNT] = { 0 };
+    i64 expected_results[MAX_PRESERVED_ROWS_COUNT] = { 0 };
+
+    BCModule module = bc_module_create(NULL);
+
+    bool result = source_fixture_compile_bytecode(fixture, &module, STREAM_STRING_SOURCE, source, NULL);
+    for (u32 i = 0; result && i < rows_count; ++i) {
+        expected_statuses[i] = source_fixture_run_function(&module, stdout, name, &rows[i * args_count], args_count, &expected_results[i]);
+    }
+
+    result = result && source_fixture_compile_bytecode(fixture, &module, STREAM_STRING_SOURCE, source, passes);
+    for (u32 i = 0; result && i < rows_count; ++i) {
+        i64 value = 0;
+        const VMStatus status = source_fixture_run_function(&module, stdout, name, &rows[i * args_count], args_count, &value);
+        result = status == expected_statuses[i] && (status != VM_STATUS_OK || value == expected_results[i]);
+    }
+
+    bc_module_free(&module);
+    return result;
+}
\ No newline at end of file
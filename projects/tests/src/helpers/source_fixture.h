@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "vanec/frontend/ast/ast_parser.h"
+#include "vanec/frontend/cfg/cfg_builder.h"
+#include "vanec/backend/bytecode.h"
+#include "vanec/backend/vm.h"
+
+// The front end the tests start from: functions parsed from a string or a file into the cfg context.
+typedef struct {
+    Stream* ss;
+    Lexer* lexer;
+    ASTParser* parser;
+    CFGContext* ctx;
+    ASTNode* funcdef;       // the last one built
+} SourceFixture;
+
+// The passes a test applies to every function before it is compiled.
+typedef void (*SourcePasses)(CFGContext* ctx);
+
+// The diagnostic engine is optional and stays owned by the caller.
+SourceFixture source_fixture_create(DiagnosticEngine* diag);
+
+void source_fixture_free(SourceFixture* fixture);
+
+// Parses the first function of the source and builds its cfg, CFG_NULL_NODE when either fails.
+u32 source_fixture_build(SourceFixture* fixture, const char* source);
+
+const char* get_source_funcdef_name(const ASTNode* funcdef);
+
+// The instructions with the opcode in the blocks of the cfg.
+u32 count_source_opcodes(const CFGContext* ctx, const IROpcode op);
+
+// The instructions with the opcode inside of the loops only.
+u32 count_source_loop_opcodes(CFGContext* ctx, const IROpcode op);
+
+// Compiles every function of the source or the file into the module after the passes, which may be NULL, and links it.
+bool source_fixture_compile_bytecode(SourceFixture* fixture, BCModule* module, const StreamSourceKind kind, const char* source, const SourcePasses passes);
+
+void source_fixture_quicken_module(BCModule* module);
+
+VMStatus source_fixture_run_function(const BCModule* module, FILE* out, const char* name, const i64* args, const u32 count, i64* result);
+
+// Runs the function on every row of arguments compiled as lowered and after the passes,
+// whether the two always end with the same status and the same result.
+bool is_source_behavior_preserved(SourceFixture* fixture, const char* source, const char* name, const SourcePasses passes, const i64* rows, const u32 args_count, const u32 rows_count);
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "utest/utest.h"
+
+#include <string.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/analysis/liveness.h"
+#include "vanec/analysis/reaching_defs.h"
+#include "vanec/analysis/available_exprs.h"
+#include "vanec/transform/ssa.h"
+
+struct DataflowFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(DataflowFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(DataflowFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static const char* const SOURCE =
+    "function f(a as int, b as int) as int\n"
+    "    dim w, x, y, z as int\n"
+    "    x = a + b;\n"
+    "    z = a * b;\n"
+    "    w = b * x;\n"
+    "    if (x > 3) then\n"
+    "        a = 1;\n"
+    "    end if\n"
+    "    y = b + a;\n"
+    "    while (y > 0)\n"
+    "        --y;\n"
+    "    wend\n"
+    "    return(x + y + b * a);\n"
+    "end function\n";
+
+static u32 find_reg(const CFGContext* ctx, const char* name) {
+    for (u32 reg = 0; reg < ir_function_get_regs_count(&ctx->ir); ++reg) {
+        const u32 string = ir_function_get_reg(&ctx->ir, reg)->name;
+        if (string != IR_NULL_STRING && strcmp(ir_function_get_string(&ctx->ir, string), name) == 0) {
+            return reg;
+        }
+    }
+    return IR_NULL_REG;
+}
+
+// The block and index of the first instruction with the opcode defining the register.
+static u32 find_def(const CFGContext* ctx, const u32 reg, const IROpcode op, u32* block) {
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* instr = cfg_context_get_instr(ctx, id, i);
+            if (instr->dst == reg && instr->op == op) {
+                *block = id;
+                return node->instrs_begin + i;
+            }
+        }
+    }
+    return IR_NULL_REG;
+}
+
+static u32 get_loop_header(CFGContext* ctx, const u32 block) {
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    return loop_forest_get_loop(forest, loop_forest_get_block_loop(forest, block))->header;
+}
+
+UTEST_F(DataflowFixture, liveness) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, SOURCE), CFG_NULL_NODE);
+    CFGContext* ctx = utest_fixture->source.ctx;
+
+    const u32 a = find_reg(ctx, "a");
+    const u32 y = find_reg(ctx, "y");
+    const u32 z = find_reg(ctx, "z");
+
+    u32 if_block = CFG_NULL_NODE;
+    u32 body = CFG_NULL_NODE;
+    find_def(ctx, a, IR_OP_CONST, &if_block);
+    find_def(ctx, y, IR_OP_SUB, &body);
+    const u32 header = get_loop_header(ctx, body);
+
+    Liveness liveness = liveness_create();
+    liveness_build(&liveness, ctx);
+
+    ASSERT_FALSE(is_live_in(&liveness, if_block, a));
+    ASSERT_TRUE(is_live_out(&liveness, if_block, a));
+    ASSERT_TRUE(is_live_in(&liveness, cfg_graph_get_preds(&ctx->graph, if_block, &(u32){ 0 })[0], a));
+    ASSERT_TRUE(is_live_in(&liveness, header, y));
+    ASSERT_TRUE(is_live_out(&liveness, body, y));
+
+    // z is never read.
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        ASSERT_FALSE(is_live_in(&liveness, id, z));
+        ASSERT_FALSE(is_live_out(&liveness, id, z));
+    }
+
+    // In SSA form a phi operand is live out of its incoming block only.
+    construct_ssa(ctx);
+    liveness_build(&liveness, ctx);
+
+    const IRInstr* phi = cfg_context_get_instr(ctx, header, 0);
+    ASSERT_EQ(phi->op, IR_OP_PHI);
+    const u32* incoming = ir_function_get_list(&ctx->ir, phi->as.phi.first);
+    for (u32 i = 0; i < phi->as.phi.count; ++i) {
+        ASSERT_TRUE(is_live_out(&liveness, incoming[i * 2], incoming[i * 2 + 1]));
+        ASSERT_FALSE(is_live_in(&liveness, header, incoming[i * 2 + 1]));
+    }
+    ASSERT_FALSE(is_live_in(&liveness, header, phi->dst));
+
+    liveness_free(&liveness);
+}
+
+UTEST_F(DataflowFixture, reaching_defs) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, SOURCE), CFG_NULL_NODE);
+    CFGContext* ctx = utest_fixture->source.ctx;
+
+    const u32 y = find_reg(ctx, "y");
+
+    u32 init_block = CFG_NULL_NODE;
+    u32 add_block = CFG_NULL_NODE;
+    u32 body = CFG_NULL_NODE;
+    const u32 init = find_def(ctx, y, IR_OP_CONST, &init_block);
+    const u32 add = find_def(ctx, y, IR_OP_ADD, &add_block);
+    const u32 sub = find_def(ctx, y, IR_OP_SUB, &body);
+    const u32 header = get_loop_header(ctx, body);
+
+    ReachingDefs defs = reaching_defs_create();
+    reaching_defs_build(&defs, ctx);
+
+    u32 count = 0;
+    reaching_defs_get_reg_defs(&defs, y, &count);
+    ASSERT_EQ(count, 3);
+
+    ASSERT_TRUE(does_def_reach_block(&defs, reaching_defs_get_instr_def(&defs, init), add_block));
+    ASSERT_FALSE(does_def_reach_block(&defs, reaching_defs_get_instr_def(&defs, init), header));
+    ASSERT_TRUE(does_def_reach_block(&defs, reaching_defs_get_instr_def(&defs, add), header));
+    ASSERT_TRUE(does_def_reach_block(&defs, reaching_defs_get_instr_def(&defs, sub), header));
+    ASSERT_EQ(reaching_defs_get_def_instr(&defs, reaching_defs_get_instr_def(&defs, sub)), sub);
+
+    reaching_defs_free(&defs);
+}
+
+UTEST_F(DataflowFixture, available_exprs) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, SOURCE), CFG_NULL_NODE);
+    CFGContext* ctx = utest_fixture->source.ctx;
+
+    u32 entry_block = CFG_NULL_NODE;
+    u32 join = CFG_NULL_NODE;
+    const u32 sum = find_def(ctx, find_reg(ctx, "x"), IR_OP_ADD, &entry_block);
+    const u32 product = find_def(ctx, find_reg(ctx, "z"), IR_OP_MUL, &entry_block);
+    const u32 scaled = find_def(ctx, find_reg(ctx, "w"), IR_OP_MUL, &entry_block);
+    find_def(ctx, find_reg(ctx, "y"), IR_OP_ADD, &join);
+
+    AvailableExprs exprs = available_exprs_create();
+    available_exprs_build(&exprs, ctx);
+
+    // b + a is the same expression as a + b.
+    const u32 sum_expr = available_exprs_get_instr_expr(&exprs, sum);
+    ASSERT_EQ(available_exprs_get_instr_expr(&exprs, cfg_context_get_node(ctx, join)->instrs_begin), sum_expr);
+    ASSERT_EQ(available_exprs_get_expr_instr(&exprs, sum_expr), sum);
+
+    // a is redefined on one of the paths to the join, x and b on none.
+    const u32 succ = cfg_graph_get_succs(&ctx->graph, entry_block, &(u32){ 0 })[0];
+    ASSERT_TRUE(is_expr_available_in(&exprs, succ, sum_expr));
+    ASSERT_FALSE(is_expr_available_in(&exprs, join, sum_expr));
+    ASSERT_FALSE(is_expr_available_in(&exprs, join, available_exprs_get_instr_expr(&exprs, product)));
+    ASSERT_TRUE(is_expr_available_in(&exprs, join, available_exprs_get_instr_expr(&exprs, scaled)));
+
+    available_exprs_free(&exprs);
+}
\ No newline at end of file
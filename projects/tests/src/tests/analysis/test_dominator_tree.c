@@ -0,0 +1,185 @@
+#include "utest/utest.h"
+
+#include <stdlib.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/utils/string_builder.h"
+
+struct DominatorTreeFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(DominatorTreeFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(DominatorTreeFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+// By definition: a dominates b if b can not be reached from the entry without passing a.
+static bool is_reachable_avoiding(const CFGGraph* graph, const u32 avoid, const u32 target, bool* seen, u32* stack) {
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        seen[id] = false;
+    }
+
+    if (graph->entry == avoid) {
+        return false;
+    }
+
+    u32 top = 0;
+    stack[top++] = graph->entry;
+    seen[graph->entry] = true;
+
+    while (top > 0) {
+        const u32 id = stack[--top];
+        if (id == target) {
+            return true;
+        }
+
+        u32 count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, id, &count);
+        for (u32 i = 0; i < count; ++i) {
+            if (!seen[succs[i]] && succs[i] != avoid) {
+                seen[succs[i]] = true;
+                stack[top++] = succs[i];
+            }
+        }
+    }
+    return false;
+}
+
+static bool contains(const u32* items, const u32 count, const u32 item) {
+    for (u32 i = 0; i < count; ++i) {
+        if (items[i] == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compares the tree and the frontiers against the definitions for every pair of blocks.
+static bool check_against_definitions(CFGContext* ctx) {
+    const DominatorTree* tree = cfg_context_get_dominator_tree(ctx);
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+
+    bool* seen = malloc(nodes_count * sizeof(bool));
+    u32* stack = malloc(nodes_count * sizeof(u32));
+    bool result = true;
+
+    for (u32 a = 0; result && a < nodes_count; ++a) {
+        for (u32 b = 0; result && b < nodes_count; ++b) {
+            if (!is_cfg_node_reachable(graph, a) || !is_cfg_node_reachable(graph, b)) {
+                continue;
+            }
+
+            const bool expected = a == b || !is_reachable_avoiding(graph, a, b, seen, stack);
+            result = dominates(tree, a, b) == expected;
+
+            // b is in the frontier of a if a dominates a predecessor of b, but not b itself.
+            u32 preds_count = 0;
+            const u32* preds = cfg_graph_get_preds(graph, b, &preds_count);
+            bool in_frontier = false;
+            for (u32 i = 0; i < preds_count; ++i) {
+                in_frontier |= dominates(tree, a, preds[i]);
+            }
+            in_frontier &= !strictly_dominates(tree, a, b);
+
+            u32 frontier_count = 0;
+            const u32* frontier = dominator_tree_get_frontier(tree, a, &frontier_count);
+            result = result && contains(frontier, frontier_count, b) == in_frontier;
+        }
+    }
+
+    free(seen);
+    free(stack);
+
+    return result;
+}
+
+UTEST_F(DominatorTreeFixture, loops_and_branches) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    dim b as int\n"
+        "    while (a > 0)\n"
+        "        if (a % 3 == 0) then\n"
+        "            b += a;\n"
+        "            if (b > 100) then\n"
+        "                break\n"
+        "            end if\n"
+        "        else\n"
+        "            do\n"
+        "                --a;\n"
+        "            loop until (a % 2 == 0)\n"
+        "        end if\n"
+        "        --a;\n"
+        "    wend\n"
+        "    return(b);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+    ASSERT_TRUE(check_against_definitions(utest_fixture->source.ctx));
+
+    const DominatorTree* tree = cfg_context_get_dominator_tree(utest_fixture->source.ctx);
+    ASSERT_EQ(dominator_tree_get_idom(tree, entry), CFG_NULL_NODE);
+    ASSERT_EQ(dominator_tree_get_depth(tree, entry), 0);
+
+    u32 preorder_count = 0;
+    const u32* preorder = dominator_tree_get_preorder(tree, &preorder_count);
+    ASSERT_EQ(preorder[0], entry);
+
+    // Every block comes after its idom in preorder.
+    for (u32 i = 1; i < preorder_count; ++i) {
+        const u32 idom = dominator_tree_get_idom(tree, preorder[i]);
+        ASSERT_TRUE(strictly_dominates(tree, idom, preorder[i]));
+        ASSERT_EQ(dominator_tree_get_depth(tree, preorder[i]), dominator_tree_get_depth(tree, idom) + 1);
+    }
+}
+
+UTEST_F(DominatorTreeFixture, cache_follows_graph) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    if (a > 0) then\n"
+        "        a = 1;\n"
+        "    end if\n"
+        "    return(a);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    const DominatorTree* tree = cfg_context_get_dominator_tree(ctx);
+    ASSERT_TRUE(is_dominator_tree_valid(tree, &ctx->graph));
+
+    cfg_context_build_graph(ctx, entry);
+    ASSERT_FALSE(is_dominator_tree_valid(tree, &ctx->graph));
+    ASSERT_EQ(cfg_context_get_dominator_tree(ctx), tree);
+    ASSERT_TRUE(is_dominator_tree_valid(tree, &ctx->graph));
+    ASSERT_TRUE(check_against_definitions(ctx));
+}
+
+UTEST_F(DominatorTreeFixture, large_function) {
+    StringBuilder sb = string_builder_create();
+    string_builder_append_str_right(&sb, "function f(a as int) as int\n");
+    for (u32 i = 0; i < 2000; ++i) {
+        string_builder_append_str_right(&sb, "    while (a > 0)\n        if (a == 7) then\n            break\n        end if\n        --a;\n    wend\n");
+    }
+    string_builder_append_str_right(&sb, "    return(a);\nend function\n");
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+
+    const u32 entry = source_fixture_build(&utest_fixture->source, source);
+    ASSERT_NE(entry, CFG_NULL_NODE);
+    ASSERT_GT(cfg_context_get_nodes_count(utest_fixture->source.ctx), 10000);
+
+    const DominatorTree* tree = cfg_context_get_dominator_tree(utest_fixture->source.ctx);
+
+    // The loops are chained, so the entry of every loop dominates all the following ones.
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&utest_fixture->source.ctx->graph, &rpo_count);
+    ASSERT_TRUE(dominates(tree, rpo[1], rpo[rpo_count - 1]));
+
+    free(source);
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "utest/utest.h"
+
+#include <stdlib.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/preheaders.h"
+#include "vanec/backend/bc_compiler.h"
+
+struct LoopForestFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(LoopForestFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(LoopForestFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+// By definition: the natural loop of a header is the header and every block reaching a latch without passing it.
+static void mark_natural_loop(const CFGGraph* graph, const u32 header, const u32* latches, const u32 latches_count, bool* in_loop, u32* stack) {
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        in_loop[id] = false;
+    }
+    in_loop[header] = true;
+
+    u32 top = 0;
+    for (u32 i = 0; i < latches_count; ++i) {
+        if (!in_loop[latches[i]]) {
+            in_loop[latches[i]] = true;
+            stack[top++] = latches[i];
+        }
+    }
+
+    while (top > 0) {
+        u32 count = 0;
+        const u32* preds = cfg_graph_get_preds(graph, stack[--top], &count);
+        for (u32 i = 0; i < count; ++i) {
+            if (!in_loop[preds[i]]) {
+                in_loop[preds[i]] = true;
+                stack[top++] = preds[i];
+            }
+        }
+    }
+}
+
+static bool check_against_definitions(CFGContext* ctx) {
+    const DominatorTree* tree = cfg_context_get_dominator_tree(ctx);
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+
+    bool* in_loop = malloc(nodes_count * sizeof(bool));
+    u32* stack = malloc(nodes_count * sizeof(u32));
+    bool result = true;
+
+    for (u32 loop = 0; result && loop < loop_forest_get_loops_count(forest); ++loop) {
+        const Loop* item = loop_forest_get_loop(forest, loop);
+
+        u32 latches_count = 0;
+        const u32* latches = loop_forest_get_latches(forest, loop, &latches_count);
+        result = latches_count > 0;
+        for (u32 i = 0; i < latches_count; ++i) {
+            result = result && dominates(tree, item->header, latches[i]);
+        }
+
+        mark_natural_loop(graph, item->header, latches, latches_count, in_loop, stack);
+
+        u32 blocks_count = 0;
+        const u32* blocks = loop_forest_get_blocks(forest, loop, &blocks_count);
+        result = result && blocks[0] == item->header;
+
+        u32 expected_count = 0;
+        for (u32 id = 0; id < nodes_count; ++id) {
+            expected_count += in_loop[id];
+            result = result && loop_contains_block(forest, loop, id) == in_loop[id];
+        }
+        result = result && blocks_count == expected_count;
+
+        // An exit is outside of the loop and entered from inside of it.
+        u32 exits_count = 0;
+        const u32* exits = loop_forest_get_exits(forest, loop, &exits_count);
+        for (u32 i = 0; i < exits_count; ++i) {
+            u32 preds_count = 0;
+            const u32* preds = cfg_graph_get_preds(graph, exits[i], &preds_count);
+
+            bool entered = false;
+            for (u32 j = 0; j < preds_count; ++j) {
+                entered |= in_loop[preds[j]];
+            }
+            result = result && !in_loop[exits[i]] && entered;
+        }
+
+        if (item->parent != CFG_NULL_LOOP) {
+            result = result && loop_contains_loop(forest, item->parent, loop);
+            result = result && item->depth == loop_forest_get_loop(forest, item->parent)->depth + 1;
+        }
+    }
+
+    free(in_loop);
+    free(stack);
+
+    return result;
+}
+
+UTEST_F(LoopForestFixture, nested_loops) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    dim b as int\n"
+        "    do\n"
+        "        b += a;\n"
+        "        while (b > 3)\n"
+        "            --b;\n"
+        "            if (b == 5) then\n"
+        "                break\n"
+        "            end if\n"
+        "            while (a < b)\n"
+        "                ++a;\n"
+        "            wend\n"
+        "        wend\n"
+        "    loop until (a > b)\n"
+        "    while (a > 0)\n"
+        "        --a;\n"
+        "    wend\n"
+        "    return(b);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    ASSERT_EQ(loop_forest_get_loops_count(forest), 4);
+    ASSERT_TRUE(check_against_definitions(ctx));
+
+    u32 max_depth = 0;
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        const u32 depth = loop_forest_get_block_depth(forest, id);
+        max_depth = depth > max_depth ? depth : max_depth;
+
+        // The builder jumps from the loop entries to the header and back from the backedges.
+        if (node->kind == CFG_BACKEDGE_NODE && is_cfg_node_reachable(&ctx->graph, id)) {
+            const u32 loop = loop_forest_get_block_loop(forest, id);
+            ASSERT_NE(loop, CFG_NULL_LOOP);
+            ASSERT_EQ(cfg_context_get_terminator(ctx, id)->as.target, loop_forest_get_loop(forest, loop)->header);
+        }
+        if (node->kind == CFG_LOOP_ENTRY_NODE) {
+            const u32 header = cfg_context_get_terminator(ctx, id)->as.target;
+            const u32 loop = loop_forest_get_block_loop(forest, header);
+            ASSERT_EQ(loop_forest_get_loop(forest, loop)->preheader, id);
+        }
+    }
+    ASSERT_EQ(max_depth, 3);
+}
+
+UTEST_F(LoopForestFixture, preheader_insertion_in_ssa) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    dim i as int\n"
+        "    if (a > 0) then\n"
+        "        i = 1;\n"
+        "    end if\n"
+        "    while (i < a)\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(i);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    ASSERT_EQ(loop_forest_get_loops_count(forest), 1);
+
+    // The condition skips the loop entry, so the header is entered from two blocks.
+    const u32 header = loop_forest_get_loop(forest, 0)->header;
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        IRInstr* terminator = cfg_context_get_terminator(ctx, id);
+        if (cfg_context_get_node(ctx, id)->kind == CFG_CONDITION_NODE && !loop_contains_block(forest, 0, id)) {
+            terminator->as.branch.else_block = header;
+        }
+    }
+    cfg_context_build_graph(ctx, entry);
+    construct_ssa(ctx);
+
+    forest = cfg_context_get_loop_forest(ctx);
+    ASSERT_EQ(loop_forest_get_loop(forest, 0)->preheader, CFG_NULL_NODE);
+    ASSERT_EQ(insert_loop_preheaders(ctx), 1);
+
+    forest = cfg_context_get_loop_forest(ctx);
+    const u32 preheader = loop_forest_get_loop(forest, 0)->preheader;
+    ASSERT_NE(preheader, CFG_NULL_NODE);
+    ASSERT_TRUE(check_against_definitions(ctx));
+    ASSERT_EQ(insert_loop_preheaders(ctx), 0);
+
+    // Every phi has a pair per pred, in the order of the preds.
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(&ctx->graph, id, &preds_count);
+
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* phi = cfg_context_get_instr(ctx, id, i);
+            if (phi->op != IR_OP_PHI) {
+                break;
+            }
+
+            ASSERT_EQ(phi->as.phi.count, preds_count);
+            const u32* incoming = ir_function_get_list(&ctx->ir, phi->as.phi.first);
+            for (u32 j = 0; j < preds_count; ++j) {
+                ASSERT_EQ(incoming[j * 2], preds[j]);
+            }
+        }
+    }
+    ASSERT_EQ(cfg_context_get_instr(ctx, preheader, 0)->op, IR_OP_PHI);
+
+    destruct_ssa(ctx);
+    ASSERT_FALSE(ctx->ir.is_ssa);
+
+    // The phi moved into the preheader still starts i at 1 after the condition and at 0 when it is skipped.
+    BCModule module = bc_module_create(NULL);
+    ASSERT_NE(compile_bytecode_function(&module, ctx, "f", utest_fixture->source.funcdef->loc), BC_NULL_FUNCTION);
+    ASSERT_TRUE(bc_module_link(&module));
+
+    const i64 rows[][2] = { { 5, 5 }, { 1, 1 }, { 0, 0 }, { -3, 0 } };
+    for (u32 i = 0; i < 4; ++i) {
+        i64 result = -1;
+        EXPECT_EQ(source_fixture_run_function(&module, stdout, "f", &rows[i][0], 1, &result), VM_STATUS_OK);
+        EXPECT_EQ(result, rows[i][1]);
+    }
+    bc_module_free(&module);
+}
\ No newline at end of file
@@ -797,6 +797,115 @@ UTEST_F(ASTParserFixture, unary4) {
     ASSERT_EQ(node, NULL);
 }
 
+UTEST_F(ASTParserFixture, unary5) {
+    const char* source = "-a + b";
+    stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(utest_fixture->lexer, utest_fixture->ss);
+
+    ASTNode* node = ast_parser_parse_ast_expression_node(utest_fixture->parser, PREC_NONE);
+
+    ASSERT_NE(node, NULL);
+    ASSERT_EQ(node->kind, AST_BINARY_EXPR_NODE);
+
+    const char* op = node->as.binary_expr->op;
+    const ASTNode* lhs = node->as.binary_expr->lhs;
+    const ASTNode* rhs = node->as.binary_expr->rhs;
+
+    ASSERT_STREQ(op, "+");
+    ASSERT_NE(lhs, NULL);
+    ASSERT_EQ(lhs->kind, AST_UNARY_EXPR_NODE);
+    ASSERT_STREQ(lhs->as.unary_expr->op, "-");
+    ASSERT_PLACE(lhs->as.unary_expr->rhs, "a");
+    ASSERT_PLACE(rhs, "b");
+
+    ast_node_free(node);
+}
+
+UTEST_F(ASTParserFixture, unary6) {
+    const char* source = "!a == b";
+    stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(utest_fixture->lexer, utest_fixture->ss);
+
+    ASTNode* node = ast_parser_parse_ast_expression_node(utest_fixture->parser, PREC_NONE);
+
+    ASSERT_NE(node, NULL);
+    ASSERT_EQ(node->kind, AST_BINARY_EXPR_NODE);
+
+    const char* op = node->as.binary_expr->op;
+    const ASTNode* lhs = node->as.binary_expr->lhs;
+    const ASTNode* rhs = node->as.binary_expr->rhs;
+
+    ASSERT_STREQ(op, "==");
+    ASSERT_NE(lhs, NULL);
+    ASSERT_EQ(lhs->kind, AST_UNARY_EXPR_NODE);
+    ASSERT_STREQ(lhs->as.unary_expr->op, "!");
+    ASSERT_PLACE(lhs->as.unary_expr->rhs, "a");
+    ASSERT_PLACE(rhs, "b");
+
+    ast_node_free(node);
+}
+
+UTEST_F(ASTParserFixture, unary7) {
+    const char* source = "-f(x)";
+    stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(utest_fixture->lexer, utest_fixture->ss);
+
+    ASTNode* node = ast_parser_parse_ast_expression_node(utest_fixture->parser, PREC_NONE);
+
+    ASSERT_NE(node, NULL);
+    ASSERT_EQ(node->kind, AST_UNARY_EXPR_NODE);
+
+    const char* op = node->as.unary_expr->op;
+    const ASTNode* rhs = node->as.unary_expr->rhs;
+
+    ASSERT_STREQ(op, "-");
+    ASSERT_NE(rhs, NULL);
+    ASSERT_EQ(rhs->kind, AST_CALL_OR_INDEXER_EXPR_NODE);
+
+    const ASTNode* callee = rhs->as.call_or_indexer_expr->callee;
+    const Vector* args = &rhs->as.call_or_indexer_expr->args;
+
+    ASSERT_PLACE(callee, "f");
+    ASSERT_EQ(args->items_count, 1);
+
+    const ASTNode* arg = vector_get_ref(args, 0);
+    ASSERT_PLACE(arg, "x");
+
+    ast_node_free(node);
+}
+
+UTEST_F(ASTParserFixture, unary8) {
+    const char* source = "~a(1) * b";
+    stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(utest_fixture->lexer, utest_fixture->ss);
+
+    ASTNode* node = ast_parser_parse_ast_expression_node(utest_fixture->parser, PREC_NONE);
+
+    ASSERT_NE(node, NULL);
+    ASSERT_EQ(node->kind, AST_BINARY_EXPR_NODE);
+
+    const char* op = node->as.binary_expr->op;
+    const ASTNode* lhs = node->as.binary_expr->lhs;
+    const ASTNode* rhs = node->as.binary_expr->rhs;
+
+    ASSERT_STREQ(op, "*");
+    ASSERT_NE(lhs, NULL);
+    ASSERT_EQ(lhs->kind, AST_UNARY_EXPR_NODE);
+    ASSERT_STREQ(lhs->as.unary_expr->op, "~");
+
+    const ASTNode* operand = lhs->as.unary_expr->rhs;
+    ASSERT_NE(operand, NULL);
+    ASSERT_EQ(operand->kind, AST_CALL_OR_INDEXER_EXPR_NODE);
+    ASSERT_PLACE(operand->as.call_or_indexer_expr->callee, "a");
+    ASSERT_EQ(operand->as.call_or_indexer_expr->args.items_count, 1);
+
+    const ASTNode* arg = vector_get_ref(&operand->as.call_or_indexer_expr->args, 0);
+    ASSERT_LITERAL(arg, AST_DEC_LITERAL_NODE, "1");
+    ASSERT_PLACE(rhs, "b");
+
+    ast_node_free(node);
+}
+
 UTEST_F(ASTParserFixture, binary1) {
     const char* source = "5 - 6";
     stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
@@ -1370,6 +1479,38 @@ UTEST_F(ASTParserFixture, condition6) {
     ASSERT_EQ(node, NULL);
 }
 
+UTEST_F(ASTParserFixture, release_consumed_tokens1) {
+    const char* source = "function a()\n"
+        "end function\n"
+        "function b()\n"
+        "    dim x as int\n"
+        "end function";
+    stream_set_source(utest_fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(utest_fixture->lexer, utest_fixture->ss);
+
+    ASTNode* a = ast_parser_parse_ast_funcdef_node(utest_fixture->parser);
+    ASSERT_NE(a, NULL);
+
+    ast_parser_release_consumed_tokens(utest_fixture->parser);
+
+    // Only the last consumed token is kept.
+    ASSERT_EQ(utest_fixture->parser->ts.head, utest_fixture->parser->ts.curr);
+    ASSERT_EQ(utest_fixture->parser->ts.head->prev, NULL);
+    ASSERT_EQ(utest_fixture->parser->ts.head->token.kind, TOKEN_FUNCTION_KEYWORD);
+
+    ASTNode* b = ast_parser_parse_ast_funcdef_node(utest_fixture->parser);
+    ASSERT_NE(b, NULL);
+    ASSERT_IDENTIFIER(b->as.funcdef->funcsign->as.funcsign->id, "b");
+    ASSERT_EQ(b->as.funcdef->stmts.items_count, 1);
+
+    ast_parser_release_consumed_tokens(utest_fixture->parser);
+
+    ASSERT_TRUE(is_ast_parser_done(utest_fixture->parser));
+
+    ast_node_free(a);
+    ast_node_free(b);
+}
+
 //UTEST_F(ASTParserFixture, while_stmt_valid) {
 //    const char* source = ""
 //        "while true\n"
@@ -0,0 +1,165 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/backend/graph_coloring.h"
+
+struct GraphColoringFixture {
+    SourceFixture source;
+    LiveIntervals intervals;
+    RegAllocation allocation;
+};
+
+UTEST_F_SETUP(GraphColoringFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->intervals = live_intervals_create();
+    utest_fixture->allocation = reg_allocation_create();
+}
+
+UTEST_F_TEARDOWN(GraphColoringFixture) {
+    reg_allocation_free(&utest_fixture->allocation);
+    live_intervals_free(&utest_fixture->intervals);
+    source_fixture_free(&utest_fixture->source);
+}
+
+static bool build_source(struct GraphColoringFixture* fixture, const char* source) {
+    if (source_fixture_build(&fixture->source, source) == CFG_NULL_NODE) {
+        return false;
+    }
+
+    construct_ssa(fixture->source.ctx);
+    live_intervals_build(&fixture->intervals, fixture->source.ctx);
+    return true;
+}
+
+static RegAllocLocation get_reg_location(const struct GraphColoringFixture* fixture, const u32 reg) {
+    return reg_allocation_get_location(&fixture->allocation, reg, live_intervals_get(&fixture->intervals, reg)->start);
+}
+
+// Whether two registers that are live at the same time share a location.
+static bool has_conflicts(const struct GraphColoringFixture* fixture) {
+    const u32 count = fixture->intervals.regs_count;
+
+    for (u32 i = 0; i < count; ++i) {
+        if (!is_reg_allocated(&fixture->allocation, i)) {
+            continue;
+        }
+
+        for (u32 j = i + 1; j < count; ++j) {
+            if (is_reg_allocated(&fixture->allocation, j)
+                && is_same_reg_alloc_location(get_reg_location(fixture, i), get_reg_location(fixture, j))
+                && get_live_intervals_intersection(&fixture->intervals, i, j) != LIVE_MAX_POSITION) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+UTEST_F(GraphColoringFixture, coalesces_the_operands_of_phis) {
+    const char* source =
+        "function f(a as int, b as int) as int\n"
+        "    dim s as int\n"
+        "    s = 0;\n"
+        "    while (b > 0)\n"
+        "        s += a;\n"
+        "        --b;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n";
+
+    ASSERT_TRUE(build_source(utest_fixture, source));
+
+    const RegAllocTarget target = { .regs_count = 4, .caller_saved = 0 };
+    allocate_registers_graph_coloring(&utest_fixture->allocation, &utest_fixture->intervals, &target);
+
+    EXPECT_EQ(utest_fixture->allocation.spilled_count, 0u);
+    EXPECT_EQ(utest_fixture->allocation.split_count, 0u);
+    EXPECT_FALSE(has_conflicts(utest_fixture));
+
+    // The phis of s and b read one operand before the loop and one at its end.
+    const Vector* copies = &utest_fixture->intervals.copies;
+    ASSERT_GE(copies->items_count, 4u);
+
+    u32 max_depth = 0;
+    u32 min_depth = LIVE_MAX_POSITION;
+    for (u64 i = 0; i < copies->items_count; ++i) {
+        const LiveCopy* copy = vector_get_ref(copies, i);
+        const u32 depth = get_live_loop_depth(&utest_fixture->intervals, copy->position);
+        max_depth = depth > max_depth ? depth : max_depth;
+        min_depth = depth < min_depth ? depth : min_depth;
+
+        // Nothing constrains the copies, so none is left.
+        if (get_live_intervals_intersection(&utest_fixture->intervals, copy->dst, copy->src) == LIVE_MAX_POSITION) {
+            EXPECT_TRUE(is_same_reg_alloc_location(get_reg_location(utest_fixture, copy->dst), get_reg_location(utest_fixture, copy->src)));
+        }
+    }
+    EXPECT_EQ(min_depth, 0u);
+    EXPECT_EQ(max_depth, 1u);
+}
+
+UTEST_F(GraphColoringFixture, spills_whole_registers_without_sharing_locations) {
+    const char* source =
+        "function f(a as int, b as int, c as int, d as int) as int\n"
+        "    dim i, s as int\n"
+        "    i = 0;\n"
+        "    s = 0;\n"
+        "    while (i < a)\n"
+        "        s += a * b + c * d + i;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s + a + b + c + d);\n"
+        "end function\n";
+
+    ASSERT_TRUE(build_source(utest_fixture, source));
+
+    // Six values live over the loop, with two registers.
+    const RegAllocTarget target = { .regs_count = 2, .caller_saved = 0 };
+    allocate_registers_graph_coloring(&utest_fixture->allocation, &utest_fixture->intervals, &target);
+
+    EXPECT_GT(utest_fixture->allocation.spilled_count, 0u);
+    EXPECT_EQ(utest_fixture->allocation.split_count, 0u);
+    EXPECT_GT(utest_fixture->allocation.slots_count, 0u);
+    EXPECT_EQ(utest_fixture->allocation.used_regs, (u64)0x3);
+    EXPECT_FALSE(has_conflicts(utest_fixture));
+
+    // The registers keep their location, so there is nothing to move inside the blocks.
+    Vector moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocMove), NULL, false);
+    reg_allocation_collect_split_moves(&utest_fixture->allocation, &utest_fixture->intervals, &moves);
+    EXPECT_EQ(moves.items_count, 0u);
+    vector_free(&moves);
+}
+
+UTEST_F(GraphColoringFixture, keeps_values_across_calls_out_of_clobbered_registers) {
+    const char* source =
+        "function f(a as int, b as int) as int\n"
+        "    dim x, y as int\n"
+        "    x = a + b;\n"
+        "    y = g(a);\n"
+        "    return(x + y + b);\n"
+        "end function\n";
+
+    ASSERT_TRUE(build_source(utest_fixture, source));
+
+    // The first two registers are clobbered by the calls.
+    const RegAllocTarget target = { .regs_count = 4, .caller_saved = 0x3 };
+    allocate_registers_graph_coloring(&utest_fixture->allocation, &utest_fixture->intervals, &target);
+
+    EXPECT_FALSE(has_conflicts(utest_fixture));
+
+    u32 across_count = 0;
+    for (u32 reg = 0; reg < utest_fixture->intervals.regs_count; ++reg) {
+        if (!is_reg_allocated(&utest_fixture->allocation, reg)
+            || get_live_interval_next_call(&utest_fixture->intervals, reg, 0, LIVE_MAX_POSITION) == LIVE_MAX_POSITION) {
+            continue;
+        }
+
+        const RegAllocLocation location = get_reg_location(utest_fixture, reg);
+        EXPECT_EQ(location.kind, REG_ALLOC_REGISTER);
+        EXPECT_EQ(target.caller_saved & ((u64)1 << location.index), (u64)0);
+        ++across_count;
+    }
+
+    // x and b, in the two registers the call leaves.
+    EXPECT_EQ(across_count, 2u);
+}
\ No newline at end of file
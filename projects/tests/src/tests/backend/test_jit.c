@@ -0,0 +1,229 @@
+#include "utest/utest.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/optimize.h"
+#include "vanec/backend/jit.h"
+
+#ifndef EXAMPLES_DIR_PATH
+#define EXAMPLES_DIR_PATH "../../examples/"
+#endif
+
+struct JITFixture {
+    SourceFixture source;
+    BCModule module;
+};
+
+UTEST_F_SETUP(JITFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->module = bc_module_create(NULL);
+}
+
+UTEST_F_TEARDOWN(JITFixture) {
+    bc_module_free(&utest_fixture->module);
+    source_fixture_free(&utest_fixture->source);
+}
+
+static void optimize_for_bytecode(CFGContext* ctx) {
+    optimize_function(ctx, false, "test");
+}
+
+// Compiles every function of a source or a file into the module and links it,
+// optimized ones go through the passes of the "run" command before they are quickened.
+static bool compile_source(struct JITFixture* fixture, const StreamSourceKind kind, const char* source, const bool optimize) {
+    if (!source_fixture_compile_bytecode(&fixture->source, &fixture->module, kind, source, optimize ? &optimize_for_bytecode : NULL)) {
+        return false;
+    }
+
+    if (optimize) {
+        source_fixture_quicken_module(&fixture->module);
+    }
+    return true;
+}
+
+static VMStatus run_function(struct JITFixture* fixture, JIT* jit, FILE* out, const char* name, const i64* args, const u32 count, i64* result, const char** fault_name) {
+    const u32 func = bc_module_find_function(&fixture->module, name);
+    assert(func != BC_NULL_FUNCTION);
+
+    VM vm = vm_create(&fixture->module, out, VM_DEFAULT_STACK_SIZE, VM_DEFAULT_MAX_FRAMES);
+    vm.jit = jit;
+
+    const VMStatus status = vm_call(&vm, func, args, count, result);
+    *fault_name = status != VM_STATUS_OK ? vm.fault_function->name : NULL;
+    vm_free(&vm);
+
+    return status;
+}
+
+static bool is_same_output(FILE* lhs, FILE* rhs) {
+    rewind(lhs);
+    rewind(rhs);
+
+    char lhs_buffer[4096];
+    char rhs_buffer[4096];
+    for (;;) {
+        const size_t lhs_size = fread(lhs_buffer, 1, sizeof(lhs_buffer), lhs);
+        const size_t rhs_size = fread(rhs_buffer, 1, sizeof(rhs_buffer), rhs);
+        if (lhs_size != rhs_size || memcmp(lhs_buffer, rhs_buffer, lhs_size) != 0) {
+            return false;
+        }
+        if (lhs_size == 0) {
+            return true;
+        }
+    }
+}
+
+UTEST_F(JITFixture, matches_interpreter_on_examples) {
+    if (!is_jit_supported()) {
+        UTEST_SKIP("The host does not run native code.");
+    }
+
+    const char* examples[] = {
+        EXAMPLES_DIR_PATH "gcd.vn",
+        EXAMPLES_DIR_PATH "fizz_buzz.vn",
+        EXAMPLES_DIR_PATH "armstrong_numbers.vn",
+    };
+
+    // 'main(args as string())' gets no arguments.
+    VMArray args = { .items = NULL, .count = 0 };
+    const i64 arg = (i64)(uintptr_t)&args;
+
+    for (u32 i = 0; i < sizeof(examples) / sizeof(examples[0]); ++i) {
+        for (u32 optimize = 0; optimize < 2; ++optimize) {
+            ASSERT_TRUE(compile_source(utest_fixture, STREAM_FILE_SOURCE, examples[i], optimize));
+
+            FILE* expected_out = tmpfile();
+            FILE* out = tmpfile();
+            ASSERT_TRUE(expected_out != NULL && out != NULL);
+
+            i64 expected = 0;
+            const char* fault_name = NULL;
+            const VMStatus expected_status = run_function(utest_fixture, NULL, expected_out, "main", &arg, 1, &expected, &fault_name);
+
+            // Every function is compiled on its first call, so no bytecode runs at all.
+            JIT jit = jit_create(&utest_fixture->module, 0, JIT_DEFAULT_CODE_CAPACITY);
+            i64 result = 0;
+            const VMStatus status = run_function(utest_fixture, &jit, out, "main", &arg, 1, &result, &fault_name);
+
+            EXPECT_EQ(status, expected_status);
+            EXPECT_EQ(result, expected);
+            EXPECT_GT(jit.compiled_count, 0u);
+            EXPECT_TRUE(is_same_output(expected_out, out));
+
+            jit_free(&jit);
+            fclose(expected_out);
+            fclose(out);
+        }
+    }
+}
+
+static const char* jit_test_source =
+    "function fib(n as int) as int\n"
+    "    if (n < 2) then\n"
+    "        return(n);\n"
+    "    end if\n"
+    "    return(fib(n - 1) + fib(n - 2));\n"
+    "end function\n"
+    "\n"
+    "function inner(n as int, d as int) as int\n"
+    "    return(n / d);\n"
+    "end function\n"
+    "\n"
+    "function outer(n as int, d as int) as long\n"
+    "    dim i as int\n"
+    "    dim sum as long\n"
+    "    i = 0;\n"
+    "    sum = 0;\n"
+    "    while (i < n)\n"
+    "        sum = sum + inner(i, d) + fib(i % 5);\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(sum);\n"
+    "end function\n"
+    "\n"
+    "function deep(n as int) as int\n"
+    "    return(deep(n + 1) + 1);\n"
+    "end function\n";
+
+UTEST_F(JITFixture, tiers_up_and_traps) {
+    if (!is_jit_supported()) {
+        UTEST_SKIP("The host does not run native code.");
+    }
+
+    ASSERT_TRUE(compile_source(utest_fixture, STREAM_STRING_SOURCE, jit_test_source, true));
+
+    // The first calls of 'fib' are interpreted, the rest of the recursion runs native code.
+    JIT jit = jit_create(&utest_fixture->module, 10, JIT_DEFAULT_CODE_CAPACITY);
+    const u32 fib = bc_module_find_function(&utest_fixture->module, "fib");
+
+    i64 result = 0;
+    const char* fault_name = NULL;
+    const i64 n = 20;
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "fib", &n, 1, &result, &fault_name), VM_STATUS_OK);
+    ASSERT_EQ(result, 6765);
+    ASSERT_TRUE(jit.functions[fib] != NULL);
+
+    const i64 args[] = { 50, 3 };
+    i64 expected = 0;
+    ASSERT_EQ(run_function(utest_fixture, NULL, stdout, "outer", args, 2, &expected, &fault_name), VM_STATUS_OK);
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "outer", args, 2, &result, &fault_name), VM_STATUS_OK);
+    ASSERT_EQ(result, expected);
+
+    // The traps of the native code name the function they are in, like the interpreter does.
+    const i64 by_zero[] = { 50, 0 };
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "outer", by_zero, 2, &result, &fault_name), VM_STATUS_DIVISION_BY_ZERO);
+    ASSERT_STREQ(fault_name, "inner");
+
+    const i64 overflow[] = { -2147483647 - 1, -1 };
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "inner", overflow, 2, &result, &fault_name), VM_STATUS_DIVISION_OVERFLOW);
+    ASSERT_STREQ(fault_name, "inner");
+
+    const i64 zero = 0;
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "deep", &zero, 1, &result, &fault_name), VM_STATUS_STACK_OVERFLOW);
+    ASSERT_STREQ(fault_name, "deep");
+
+    // The failed runs leave the result of the last good one.
+    ASSERT_EQ(result, expected);
+
+    jit_free(&jit);
+}
+
+UTEST_F(JITFixture, falls_back_to_interpreter) {
+    ASSERT_TRUE(compile_source(utest_fixture, STREAM_STRING_SOURCE, jit_test_source, false));
+
+    const i64 args[] = { 40, 7 };
+    i64 expected = 0;
+    const char* fault_name = NULL;
+    ASSERT_EQ(run_function(utest_fixture, NULL, stdout, "outer", args, 2, &expected, &fault_name), VM_STATUS_OK);
+
+    // Without the room for its stubs the jit compiles nothing.
+    JIT full = jit_create(&utest_fixture->module, 0, 1);
+    i64 result = 0;
+    ASSERT_EQ(run_function(utest_fixture, &full, stdout, "outer", args, 2, &result, &fault_name), VM_STATUS_OK);
+    ASSERT_EQ(result, expected);
+    ASSERT_EQ(full.compiled_count, 0u);
+    jit_free(&full);
+
+    if (!is_jit_supported()) {
+        UTEST_SKIP("The host does not run native code.");
+    }
+
+    // The native 'outer' calls the interpreted 'inner' through the bridge, its traps unwind the native frames too.
+    JIT jit = jit_create(&utest_fixture->module, 0, JIT_DEFAULT_CODE_CAPACITY);
+    const u32 inner = bc_module_find_function(&utest_fixture->module, "inner");
+    jit.is_rejected[inner] = true;
+
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "outer", args, 2, &result, &fault_name), VM_STATUS_OK);
+    ASSERT_EQ(result, expected);
+    ASSERT_TRUE(jit.functions[inner] == NULL);
+    ASSERT_TRUE(jit.functions[bc_module_find_function(&utest_fixture->module, "outer")] != NULL);
+
+    const i64 by_zero[] = { 40, 0 };
+    ASSERT_EQ(run_function(utest_fixture, &jit, stdout, "outer", by_zero, 2, &result, &fault_name), VM_STATUS_DIVISION_BY_ZERO);
+    ASSERT_STREQ(fault_name, "inner");
+
+    jit_free(&jit);
+}
\ No newline at end of file
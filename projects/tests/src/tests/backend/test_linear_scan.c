@@ -0,0 +1,178 @@
+#include "utest/utest.h"
+
+#include <string.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/backend/linear_scan.h"
+
+struct LinearScanFixture {
+    SourceFixture source;
+    LiveIntervals intervals;
+    RegAllocation allocation;
+};
+
+UTEST_F_SETUP(LinearScanFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->intervals = live_intervals_create();
+    utest_fixture->allocation = reg_allocation_create();
+}
+
+UTEST_F_TEARDOWN(LinearScanFixture) {
+    reg_allocation_free(&utest_fixture->allocation);
+    live_intervals_free(&utest_fixture->intervals);
+    source_fixture_free(&utest_fixture->source);
+}
+
+static bool build_source(struct LinearScanFixture* fixture, const char* source) {
+    if (source_fixture_build(&fixture->source, source) == CFG_NULL_NODE) {
+        return false;
+    }
+
+    construct_ssa(fixture->source.ctx);
+    live_intervals_build(&fixture->intervals, fixture->source.ctx);
+    return true;
+}
+
+static RegAllocLocation get_interval_location(const struct LinearScanFixture* fixture, const u32 interval) {
+    const LiveInterval* it = live_intervals_get(&fixture->intervals, interval);
+    return reg_allocation_get_location(&fixture->allocation, it->reg, it->start);
+}
+
+// Whether two intervals that are live at the same time ever share a location.
+static bool has_conflicts(const struct LinearScanFixture* fixture) {
+    const u32 count = live_intervals_get_count(&fixture->intervals);
+
+    for (u32 i = 0; i < count; ++i) {
+        if (live_intervals_get(&fixture->intervals, i)->first_range == LIVE_NULL_INDEX) {
+            continue;
+        }
+
+        for (u32 j = i + 1; j < count; ++j) {
+            if (live_intervals_get(&fixture->intervals, j)->first_range == LIVE_NULL_INDEX
+                || live_intervals_get(&fixture->intervals, i)->reg == live_intervals_get(&fixture->intervals, j)->reg) {
+                continue;
+            }
+
+            if (is_same_reg_alloc_location(get_interval_location(fixture, i), get_interval_location(fixture, j))
+                && get_live_intervals_intersection(&fixture->intervals, i, j) != LIVE_MAX_POSITION) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static const char* const LOOP_SOURCE =
+    "function f(a as int, b as int) as int\n"
+    "    dim s as int\n"
+    "    s = 0;\n"
+    "    while (b > 0)\n"
+    "        s += a;\n"
+    "        --b;\n"
+    "    wend\n"
+    "    return(s);\n"
+    "end function\n";
+
+UTEST_F(LinearScanFixture, splits_intervals_between_instructions) {
+    ASSERT_TRUE(build_source(utest_fixture, LOOP_SOURCE));
+
+    LiveIntervals* intervals = &utest_fixture->intervals;
+
+    // The parameters are live from the entry, over the whole loop.
+    const LiveInterval* a = live_intervals_get(intervals, 0);
+    ASSERT_NE(a->first_range, LIVE_NULL_INDEX);
+    EXPECT_EQ(a->start, 0u);
+    EXPECT_TRUE(is_live_interval_covering(intervals, 0, 0));
+    EXPECT_EQ(live_intervals_get_count(intervals), intervals->regs_count);
+
+    const u32 end = a->end;
+    const u32 first_use = get_live_interval_next_use(intervals, 0, 0);
+    ASSERT_NE(first_use, LIVE_MAX_POSITION);
+    EXPECT_EQ(first_use % LIVE_POSITIONS_PER_INSTR, 0u);
+
+    // The uses from the split on go to the child, the parent ends at the split or before its lifetime hole.
+    const u32 position = get_live_boundary_position(first_use);
+    ASSERT_GT(position, 0u);
+
+    const u32 child = split_live_interval(intervals, 0, position);
+    EXPECT_EQ(child, intervals->regs_count);
+    EXPECT_LE(live_intervals_get(intervals, 0)->end, position);
+    EXPECT_EQ(live_intervals_get(intervals, child)->start, position);
+    EXPECT_EQ(live_intervals_get(intervals, child)->end, end);
+    EXPECT_EQ(live_intervals_get(intervals, child)->reg, 0u);
+    EXPECT_FALSE(is_live_interval_covering(intervals, 0, position));
+    EXPECT_TRUE(is_live_interval_covering(intervals, child, position));
+    EXPECT_EQ(get_live_interval_next_use(intervals, 0, 0), LIVE_MAX_POSITION);
+    EXPECT_EQ(get_live_interval_next_use(intervals, child, 0), first_use);
+}
+
+UTEST_F(LinearScanFixture, spills_without_sharing_locations) {
+    const char* source =
+        "function f(a as int, b as int, c as int, d as int) as int\n"
+        "    dim i, s as int\n"
+        "    i = 0;\n"
+        "    s = 0;\n"
+        "    while (i < a)\n"
+        "        s += a * b + c * d + i;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s + a + b + c + d);\n"
+        "end function\n";
+
+    ASSERT_TRUE(build_source(utest_fixture, source));
+
+    // Six values live over the loop, with two registers.
+    const RegAllocTarget target = { .regs_count = 2, .caller_saved = 0 };
+    allocate_registers_linear_scan(&utest_fixture->allocation, &utest_fixture->intervals, &target);
+
+    EXPECT_GT(utest_fixture->allocation.spilled_count, 0u);
+    EXPECT_GT(utest_fixture->allocation.split_count, 0u);
+    EXPECT_GT(utest_fixture->allocation.slots_count, 0u);
+    EXPECT_EQ(utest_fixture->allocation.used_regs, (u64)0x3);
+    EXPECT_FALSE(has_conflicts(utest_fixture));
+
+    // The moves of the splits are between instructions and change the location.
+    Vector moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocMove), NULL, false);
+    reg_allocation_collect_split_moves(&utest_fixture->allocation, &utest_fixture->intervals, &moves);
+    for (u64 i = 0; i < moves.items_count; ++i) {
+        const RegAllocMove* move = vector_get_ref(&moves, i);
+        EXPECT_EQ(move->position % LIVE_POSITIONS_PER_INSTR, 0u);
+        EXPECT_FALSE(is_same_reg_alloc_location(move->from, move->to));
+    }
+    vector_free(&moves);
+}
+
+UTEST_F(LinearScanFixture, keeps_values_across_calls_out_of_clobbered_registers) {
+    const char* source =
+        "function f(a as int, b as int) as int\n"
+        "    dim x, y as int\n"
+        "    x = a + b;\n"
+        "    y = g(a);\n"
+        "    return(x + y + b);\n"
+        "end function\n";
+
+    ASSERT_TRUE(build_source(utest_fixture, source));
+
+    // The first two registers are clobbered by the calls.
+    const RegAllocTarget target = { .regs_count = 4, .caller_saved = 0x3 };
+    allocate_registers_linear_scan(&utest_fixture->allocation, &utest_fixture->intervals, &target);
+
+    EXPECT_EQ(utest_fixture->intervals.calls.items_count, 1u);
+    EXPECT_FALSE(has_conflicts(utest_fixture));
+
+    u32 across_count = 0;
+    for (u32 i = 0; i < live_intervals_get_count(&utest_fixture->intervals); ++i) {
+        if (live_intervals_get(&utest_fixture->intervals, i)->first_range == LIVE_NULL_INDEX
+            || get_live_interval_next_call(&utest_fixture->intervals, i, 0, LIVE_MAX_POSITION) == LIVE_MAX_POSITION) {
+            continue;
+        }
+
+        const RegAllocLocation location = get_interval_location(utest_fixture, i);
+        EXPECT_TRUE(location.kind == REG_ALLOC_SLOT || (target.caller_saved & ((u64)1 << location.index)) == 0);
+        ++across_count;
+    }
+
+    // x and b.
+    EXPECT_EQ(across_count, 2u);
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "utest/utest.h"
+
+#include <assert.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/optimize.h"
+#include "vanec/backend/bc_quickening.h"
+
+struct QuickeningFixture {
+    SourceFixture source;
+    BCModule module;
+};
+
+UTEST_F_SETUP(QuickeningFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->module = bc_module_create(NULL);
+}
+
+UTEST_F_TEARDOWN(QuickeningFixture) {
+    bc_module_free(&utest_fixture->module);
+    source_fixture_free(&utest_fixture->source);
+}
+
+static void optimize_for_bytecode(CFGContext* ctx) {
+    optimize_function(ctx, false, "test");
+}
+
+// Compiles every function of the source with the passes of the "run" command, the quickened one is rewritten after that.
+static bool compile_source(struct QuickeningFixture* fixture, const char* source, const bool quicken) {
+    if (!source_fixture_compile_bytecode(&fixture->source, &fixture->module, STREAM_STRING_SOURCE, source, &optimize_for_bytecode)) {
+        return false;
+    }
+
+    if (quicken) {
+        source_fixture_quicken_module(&fixture->module);
+    }
+    return true;
+}
+
+static VMStatus run_function(struct QuickeningFixture* fixture, VMProfile* profile, const char* name, const i64* args, const u32 count, i64* result, u64* executed_count) {
+    const u32 func = bc_module_find_function(&fixture->module, name);
+    assert(func != BC_NULL_FUNCTION);
+
+    VM vm = vm_create(&fixture->module, stdout, VM_DEFAULT_STACK_SIZE, VM_DEFAULT_MAX_FRAMES);
+    vm.profile = profile;
+
+    const VMStatus status = vm_call(&vm, func, args, count, result);
+    *executed_count = vm.executed_count;
+    vm_free(&vm);
+
+    return status;
+}
+
+static const char* quickening_test_source =
+    "function widths(n as int, x as byte, y as char, u as uint, l as long, m as ulong) as long\n"
+    "    dim i as int\n"
+    "    dim sum as long\n"
+    "    i = 0;\n"
+    "    sum = 0;\n"
+    "    while (i < n)\n"
+    "        x = x * 3 + 7;\n"
+    "        y = y * 5 - 11;\n"
+    "        u = u * 2654435761 + 1;\n"
+    "        l = l * 6364136223846793005 + 1442695040888963407;\n"
+    "        m = m - 3;\n"
+    "        if (i % 3 == 0) then\n"
+    "            sum = sum + x + y + u;\n"
+    "        end if\n"
+    "        sum = sum - (l % 1000) + (m % 1000);\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(sum);\n"
+    "end function\n";
+
+UTEST_F(QuickeningFixture, matches_generic_results) {
+    const i64 inputs[][6] = {
+        { 0, 0, 0, 0, 0, 0 },
+        { 10, 255, -128, 4294967295, -1, 2 },
+        { 100, 17, 100, 123456789, 9223372036854775807, 1 },
+    };
+    const u32 inputs_count = sizeof(inputs) / sizeof(inputs[0]);
+
+    i64 expected[sizeof(inputs) / sizeof(inputs[0])] = { 0 };
+    u64 generic_count = 0;
+
+    ASSERT_TRUE(compile_source(utest_fixture, quickening_test_source, false));
+    for (u32 i = 0; i < inputs_count; ++i) {
+        ASSERT_EQ(run_function(utest_fixture, NULL, "widths", inputs[i], 6, &expected[i], &generic_count), VM_STATUS_OK);
+    }
+
+    // A loop iteration dispatches fewer instructions once its compares and branches are fused.
+    u64 quick_count = 0;
+    ASSERT_TRUE(compile_source(utest_fixture, quickening_test_source, true));
+    for (u32 i = 0; i < inputs_count; ++i) {
+        i64 result = 0;
+        ASSERT_EQ(run_function(utest_fixture, NULL, "widths", inputs[i], 6, &result, &quick_count), VM_STATUS_OK);
+        ASSERT_EQ(result, expected[i]);
+    }
+    ASSERT_LT(quick_count * 4, generic_count * 3);
+}
+
+static void emit_instr(BCFunction* func, const BCOpcode op, const IRType type, const u16 a, const u16 b, const u16 c) {
+    const BCInstr instr = { .op = (u8)op, .type = (u8)type, .a = a, .b = b, .c = c };
+    vector_push_back(&func->code, &instr);
+}
+
+UTEST_F(QuickeningFixture, runs_jumps_into_fused_sequences) {
+    BCFunction* func = bc_module_add_function(&utest_fixture->module, "loop", (SourceLoc) { 0 });
+
+    // 'i' starts past the step 10 that the entry jumps into the middle of the 'const, add, jmp' sequence for,
+    // then goes up by 1 while it is less than 'n'.
+    const u8 types[] = { IR_TYPE_INT, IR_TYPE_INT, IR_TYPE_INT, IR_TYPE_INT, IR_TYPE_BOOL };
+    for (u32 i = 0; i < sizeof(types); ++i) {
+        vector_push_back(&func->reg_types, &types[i]);
+    }
+    func->params_count = 1;
+    func->frame_size = sizeof(types);
+    func->ret_type = IR_TYPE_INT;
+
+    emit_instr(func, BC_OP_CONST, IR_TYPE_INT, 3, 0, 0);        // 0: i = 0
+    emit_instr(func, BC_OP_CONST, IR_TYPE_INT, 2, 10, 0);       // 1: step = 10
+    emit_instr(func, BC_OP_JMP, IR_TYPE_VOID, 0, 6, 0);         // 2: jmp @6
+    emit_instr(func, BC_OP_LT, IR_TYPE_INT, 4, 3, 0);           // 3: cond = i < n
+    emit_instr(func, BC_OP_BR_FALSE, IR_TYPE_VOID, 4, 8, 0);    // 4: br_false cond, @8
+    emit_instr(func, BC_OP_CONST, IR_TYPE_INT, 2, 1, 0);        // 5: step = 1
+    emit_instr(func, BC_OP_ADD, IR_TYPE_INT, 3, 3, 2);          // 6: i = i + step
+    emit_instr(func, BC_OP_JMP, IR_TYPE_VOID, 0, 3, 0);         // 7: jmp @3
+    emit_instr(func, BC_OP_RET, IR_TYPE_INT, 3, 0, 0);          // 8: ret i
+
+    quicken_bytecode_function(func);
+    ASSERT_TRUE(bc_module_link(&utest_fixture->module));
+
+    const BCInstr* code = (const BCInstr*)func->code.items;
+    ASSERT_EQ(code[3].op, BC_OP_LT_BR_FALSE);
+    ASSERT_EQ(code[4].op, BC_OP_BR_FALSE);
+    ASSERT_EQ(code[5].op, BC_OP_CONST_ADD_JMP);
+    ASSERT_EQ(code[6].op, BC_OP_ADD_INT);
+    ASSERT_EQ(code[7].op, BC_OP_JMP);
+
+    i64 result = 0;
+    u64 executed_count = 0;
+
+    const i64 small = 3;
+    ASSERT_EQ(run_function(utest_fixture, NULL, "loop", &small, 1, &result, &executed_count), VM_STATUS_OK);
+    ASSERT_EQ(result, 10);
+
+    const i64 large = 15;
+    ASSERT_EQ(run_function(utest_fixture, NULL, "loop", &large, 1, &result, &executed_count), VM_STATUS_OK);
+    ASSERT_EQ(result, 15);
+}
+
+UTEST_F(QuickeningFixture, profiles_dispatched_sequences) {
+    ASSERT_TRUE(compile_source(utest_fixture, quickening_test_source, false));
+
+    VMProfile profile = vm_profile_create();
+
+    i64 result = 0;
+    u64 executed_count = 0;
+    const i64 args[] = { 30, 1, 2, 3, 4, 5 };
+    ASSERT_EQ(run_function(utest_fixture, &profile, "widths", args, 6, &result, &executed_count), VM_STATUS_OK);
+
+    u64 total = 0;
+    for (u32 i = 0; i < BC_OPCODES_COUNT; ++i) {
+        total += profile.counts[i];
+    }
+    ASSERT_EQ(total, executed_count);
+
+    // The loop condition runs once per iteration and once more to leave the loop.
+    const u64 compare_branches = profile.pairs[BC_OP_LT * BC_OPCODES_COUNT + BC_OP_BR_TRUE]
+        + profile.pairs[BC_OP_LT * BC_OPCODES_COUNT + BC_OP_BR_FALSE];
+    ASSERT_EQ(compare_branches, 31u);
+
+    vm_profile_free(&profile);
+}
\ No newline at end of file
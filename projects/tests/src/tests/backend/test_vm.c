@@ -0,0 +1,126 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/optimize.h"
+
+struct VMFixture {
+    SourceFixture source;
+    BCModule module;
+};
+
+UTEST_F_SETUP(VMFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->module = bc_module_create(NULL);
+}
+
+UTEST_F_TEARDOWN(VMFixture) {
+    bc_module_free(&utest_fixture->module);
+    source_fixture_free(&utest_fixture->source);
+}
+
+// Optimized functions go through every pass, the division lowering included.
+static void optimize_all(CFGContext* ctx) {
+    optimize_function(ctx, true, "test");
+}
+
+static bool compile_source(struct VMFixture* fixture, const char* source, const bool optimize) {
+    return source_fixture_compile_bytecode(&fixture->source, &fixture->module, STREAM_STRING_SOURCE, source, optimize ? &optimize_all : NULL);
+}
+
+static const char* vm_test_source =
+    "function fib(n as int) as int\n"
+    "    if (n < 2) then\n"
+    "        return(n);\n"
+    "    end if\n"
+    "    return(fib(n - 1) + fib(n - 2));\n"
+    "end function\n"
+    "\n"
+    "function swaps(n as int) as int\n"
+    "    dim a, b, t, i as int\n"
+    "    a = 1;\n"
+    "    b = 2;\n"
+    "    i = 0;\n"
+    "    while (i < n)\n"
+    "        t = a;\n"
+    "        a = b;\n"
+    "        b = t;\n"
+    "        ++i;\n"
+    "    wend\n"
+    "    return(a * 10 + b);\n"
+    "end function\n"
+    "\n"
+    "function digits(n as int, u as uint) as long\n"
+    "    dim sum as long\n"
+    "    sum = 0;\n"
+    "    while (n != 0)\n"
+    "        sum += n % 10 + u / 7 + u % 6;\n"
+    "        n /= 10;\n"
+    "        u = u * 3 + 1;\n"
+    "    wend\n"
+    "    return(sum);\n"
+    "end function\n";
+
+UTEST_F(VMFixture, runs_recursive_calls) {
+    ASSERT_TRUE(compile_source(utest_fixture, vm_test_source, false));
+
+    i64 result = 0;
+    const i64 n = 20;
+    ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, stdout, "fib", &n, 1, &result), VM_STATUS_OK);
+    ASSERT_EQ(result, 6765);
+
+    // The swapped variables are a cycle of phis once in SSA form.
+    ASSERT_TRUE(compile_source(utest_fixture, vm_test_source, true));
+
+    const i64 odd = 5;
+    ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, stdout, "swaps", &odd, 1, &result), VM_STATUS_OK);
+    ASSERT_EQ(result, 21);
+
+    const i64 even = 4;
+    ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, stdout, "swaps", &even, 1, &result), VM_STATUS_OK);
+    ASSERT_EQ(result, 12);
+}
+
+UTEST_F(VMFixture, matches_unoptimized_results) {
+    const i64 inputs[][2] = {
+        { 0, 0 }, { 7, 1 }, { -123456, 4000000000 }, { 2147483647, 4294967295 }, { -2147483647 - 1, 13 },
+    };
+    const u32 inputs_count = sizeof(inputs) / sizeof(inputs[0]);
+
+    i64 expected[sizeof(inputs) / sizeof(inputs[0])] = { 0 };
+
+    ASSERT_TRUE(compile_source(utest_fixture, vm_test_source, false));
+    for (u32 i = 0; i < inputs_count; ++i) {
+        ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, stdout, "digits", inputs[i], 2, &expected[i]), VM_STATUS_OK);
+    }
+
+    ASSERT_TRUE(compile_source(utest_fixture, vm_test_source, true));
+    for (u32 i = 0; i < inputs_count; ++i) {
+        i64 result = 0;
+        ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, stdout, "digits", inputs[i], 2, &result), VM_STATUS_OK);
+        ASSERT_EQ(result, expected[i]);
+    }
+}
+
+UTEST_F(VMFixture, prints_and_traps) {
+    ASSERT_TRUE(compile_source(utest_fixture,
+        "function main(n as int) as int\n"
+        "    printf(\"%d|%4u|%x|%s\\n\", n, -1, 255, \"ok\");\n"
+        "    return(100 / n);\n"
+        "end function\n",
+        false
+    ));
+
+    FILE* out = tmpfile();
+    ASSERT_TRUE(out != NULL);
+
+    i64 result = 0;
+    const i64 zero = 0;
+    ASSERT_EQ(source_fixture_run_function(&utest_fixture->module, out, "main", &zero, 1, &result), VM_STATUS_DIVISION_BY_ZERO);
+
+    char buffer[64] = { 0 };
+    rewind(out);
+    ASSERT_TRUE(fgets(buffer, sizeof(buffer), out) != NULL);
+    fclose(out);
+
+    ASSERT_STREQ(buffer, "0|4294967295|ff|ok\n");
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "utest/utest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/sccp.h"
+#include "vanec/backend/x64_compiler.h"
+
+struct X64Fixture {
+    SourceFixture source;
+    X64Module module;
+};
+
+UTEST_F_SETUP(X64Fixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+    utest_fixture->module = x64_module_create(NULL);
+}
+
+UTEST_F_TEARDOWN(X64Fixture) {
+    x64_module_free(&utest_fixture->module);
+    source_fixture_free(&utest_fixture->source);
+}
+
+// Declares every function of the source, then compiles them in SSA form with constants propagated.
+static bool compile_source(struct X64Fixture* fixture, const char* source) {
+    SourceFixture* src = &fixture->source;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        stream_set_source(src->ss, STREAM_STRING_SOURCE, source);
+        lexer_set_source_stream(src->lexer, src->ss);
+
+        bool result = true;
+        while (result && !is_ast_parser_done(src->parser)) {
+            ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(src->parser);
+            if (funcdef == NULL) {
+                return false;
+            }
+
+            if (pass == 0) {
+                const u32 params_count = (u32)funcdef->as.funcdef->funcsign->as.funcsign->args.items_count;
+                x64_module_declare_function(&fixture->module, get_source_funcdef_name(funcdef), params_count);
+            }
+            else {
+                cfg_context_clear(src->ctx);
+                result = build_cfg_for_function(src->ctx, funcdef) != CFG_NULL_NODE;
+                if (result) {
+                    construct_ssa(src->ctx);
+                    propagate_constants(src->ctx);
+                }
+                result = result && compile_x64_function(&fixture->module, src->ctx, get_source_funcdef_name(funcdef), funcdef->loc, REG_ALLOCATOR_LINEAR_SCAN);
+            }
+
+            ast_node_free(funcdef);
+        }
+
+        ast_parser_clear(src->parser);
+        if (!result) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The whole file as one string, freed by the caller.
+static char* write_module(const X64Module* module) {
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        return NULL;
+    }
+
+    write_x64_module(file, module);
+    const long size = ftell(file);
+    rewind(file);
+
+    char* text = malloc((size_t)size + 1);
+    const size_t read = fread(text, 1, (size_t)size, file);
+    text[read] = '\0';
+
+    fclose(file);
+    return text;
+}
+
+UTEST_F(X64Fixture, emits_functions_with_sysv_frames) {
+    const char* source =
+        "function add(a as int, b as long) as long\n"
+        "    return(a + b);\n"
+        "end function\n"
+        "\n"
+        "function main(args as string()) as int\n"
+        "    return(add(1, 2));\n"
+        "end function\n";
+
+    ASSERT_TRUE(compile_source(utest_fixture, source));
+    ASSERT_EQ(utest_fixture->module.functions_count, 2u);
+
+    char* text = write_module(&utest_fixture->module);
+    ASSERT_TRUE(text != NULL);
+
+    // The functions are prefixed, the C 'main' of the runtime calls the one of the program.
+    EXPECT_TRUE(strstr(text, "vane_add:\n\tpushq %rbp\n\tmovq %rsp, %rbp\n") != NULL);
+    // The narrow parameter is converted in the register it gets.
+    EXPECT_TRUE(strstr(text, "\tmovq %rdi, %r10\n\tmovslq %r10d, %r10\n") != NULL);
+    EXPECT_TRUE(strstr(text, "\tcall vane_add\n") != NULL);
+    EXPECT_TRUE(strstr(text, "main:\n") != NULL);
+    EXPECT_TRUE(strstr(text, "\tcall vane_main\n") != NULL);
+    EXPECT_TRUE(strstr(text, ".note.GNU-stack") != NULL);
+
+    free(text);
+}
+
+UTEST_F(X64Fixture, rewrites_printf_formats) {
+    const char* source =
+        "function main(args as string()) as int\n"
+        "    dim u as uint\n"
+        "    dim c as char\n"
+        "    u = 7;\n"
+        "    c = 65;\n"
+        "    printf(\"%d %5u %x %c %s %% %q\\n\", -1, u, c, c, u);\n"
+        "    println(\"u = \", u);\n"
+        "    return(0);\n"
+        "end function\n";
+
+    ASSERT_TRUE(compile_source(utest_fixture, source));
+
+    char* text = write_module(&utest_fixture->module);
+    ASSERT_TRUE(text != NULL);
+
+    // Every conversion takes a 64 bit argument, a number printed with '%s' loses its width, unknown ones stay.
+    EXPECT_TRUE(strstr(text, "\t.string \"%lld %5llu %llx %c %llu %% %%q\\012\"\n") != NULL);
+    EXPECT_TRUE(strstr(text, "\t.string \"%s%llu\\012\"\n") != NULL);
+    EXPECT_TRUE(strstr(text, "\tcall printf@PLT\n") != NULL);
+
+    free(text);
+}
+
+UTEST_F(X64Fixture, reports_undefined_functions) {
+    const char* source =
+        "function main(args as string()) as int\n"
+        "    return(missing(1));\n"
+        "end function\n";
+
+    ASSERT_FALSE(compile_source(utest_fixture, source));
+    ASSERT_TRUE(x64_module_find_declaration(&utest_fixture->module, "main") != NULL);
+    ASSERT_TRUE(x64_module_find_declaration(&utest_fixture->module, "missing") == NULL);
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+
+struct CFGGraphFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(CFGGraphFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(CFGGraphFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static bool contains(const u32* items, const u32 count, const u32 item) {
+    for (u32 i = 0; i < count; ++i) {
+        if (items[i] == item) {
+            return true;
+        }
+    }
+    return false;
+}
+
+UTEST_F(CFGGraphFixture, edges_match_terminators) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    while (a > 0)\n"
+        "        if (a == 5) then\n"
+        "            break\n"
+        "        end if\n"
+        "        --a;\n"
+        "    wend\n"
+        "    return(a);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    const CFGContext* ctx = utest_fixture->source.ctx;
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+    ASSERT_EQ(cfg_graph_get_nodes_count(graph), nodes_count);
+
+    for (u32 id = 0; id < nodes_count; ++id) {
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, id);
+        ASSERT_NE(terminator, NULL);
+
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, id, &succs_count);
+
+        switch (terminator->op) {
+        case IR_OP_JMP: {
+            ASSERT_EQ(succs_count, 1);
+            ASSERT_EQ(succs[0], terminator->as.target);
+        } break;
+        case IR_OP_BR: {
+            ASSERT_EQ(succs_count, 2);
+            ASSERT_EQ(succs[0], terminator->as.branch.then_block);
+            ASSERT_EQ(succs[1], terminator->as.branch.else_block);
+        } break;
+        default: {
+            ASSERT_EQ(succs_count, 0);
+        } break;
+        };
+
+        // Every edge is in the predecessors of its target exactly once.
+        for (u32 i = 0; i < succs_count; ++i) {
+            u32 preds_count = 0;
+            const u32* preds = cfg_graph_get_preds(graph, succs[i], &preds_count);
+            ASSERT_TRUE(contains(preds, preds_count, id));
+        }
+    }
+}
+
+UTEST_F(CFGGraphFixture, reverse_post_order) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    do\n"
+        "        if (a % 2 == 0) then\n"
+        "            a = a / 2;\n"
+        "        else\n"
+        "            a = a * 3 + 1;\n"
+        "        end if\n"
+        "    loop until (a == 1)\n"
+        "    return(a);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    const CFGGraph* graph = &utest_fixture->source.ctx->graph;
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    u32 post_order_count = 0;
+    const u32* post_order = cfg_graph_get_post_order(graph, &post_order_count);
+
+    ASSERT_EQ(rpo_count, post_order_count);
+    ASSERT_EQ(rpo[0], entry);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        ASSERT_EQ(rpo[i], post_order[rpo_count - 1 - i]);
+        ASSERT_EQ(cfg_graph_get_rpo_index(graph, rpo[i]), i);
+    }
+
+    // Apart from the backedges, every edge goes forward in RPO.
+    for (u32 i = 0; i < rpo_count; ++i) {
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, rpo[i], &succs_count);
+
+        for (u32 j = 0; j < succs_count; ++j) {
+            if (cfg_context_get_node(utest_fixture->source.ctx, rpo[i])->kind != CFG_BACKEDGE_NODE) {
+                ASSERT_LT(i, cfg_graph_get_rpo_index(graph, succs[j]));
+            }
+        }
+    }
+}
+
+UTEST_F(CFGGraphFixture, visit_epochs) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    return(a);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGGraph* graph = &utest_fixture->source.ctx->graph;
+
+    cfg_graph_begin_visit(graph);
+    ASSERT_TRUE(cfg_graph_mark_visited(graph, entry));
+    ASSERT_FALSE(cfg_graph_mark_visited(graph, entry));
+    ASSERT_TRUE(is_cfg_node_visited(graph, entry));
+
+    cfg_graph_begin_visit(graph);
+    ASSERT_FALSE(is_cfg_node_visited(graph, entry));
+    ASSERT_TRUE(cfg_graph_mark_visited(graph, entry));
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+
+struct CFGLoweringFixture {
+    DiagnosticEngine* diag;
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(CFGLoweringFixture) {
+    utest_fixture->diag = diagnostic_engine_create();
+    utest_fixture->source = source_fixture_create(utest_fixture->diag);
+}
+
+UTEST_F_TEARDOWN(CFGLoweringFixture) {
+    source_fixture_free(&utest_fixture->source);
+    diagnostic_engine_free(utest_fixture->diag);
+}
+
+UTEST_F(CFGLoweringFixture, every_block_ends_with_terminator) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int) as int\n"
+        "    dim b as int\n"
+        "    while (a > 0)\n"
+        "        if (a % 2 == 0) then\n"
+        "            b += a;\n"
+        "        end if\n"
+        "        --a;\n"
+        "    wend\n"
+        "    return(b);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+    ASSERT_EQ(utest_fixture->diag->msgs.items_count, 0);
+
+    const CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(ctx->ir.params_count, 1);
+    ASSERT_EQ(ctx->ir.ret_type, IR_TYPE_INT);
+
+    u32 instrs_count = 0;
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        ASSERT_EQ(node->instrs_begin, instrs_count);
+        instrs_count += node->instrs_count;
+
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, id);
+        ASSERT_NE(terminator, NULL);
+
+        for (u32 i = 0; i + 1 < node->instrs_count; ++i) {
+            ASSERT_FALSE(is_ir_opcode_terminator(cfg_context_get_instr(ctx, id, i)->op));
+        }
+    }
+    ASSERT_EQ(instrs_count, ir_function_get_instrs_count(&ctx->ir));
+
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_RET), 1);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_BR), 2);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_REM), 1);
+}
+
+static const char* const SIDE_EFFECTS_SOURCE =
+    "function f(a as int) as int\n"
+    "    return(a + (a = 2));\n"
+    "end function\n";
+
+UTEST_F(CFGLoweringFixture, side_effects_keep_source_order) {
+    const u32 entry = source_fixture_build(&utest_fixture->source, SIDE_EFFECTS_SOURCE);
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The lhs is read before the assignment in the rhs overwrites it.
+    const CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_COPY), 1);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_ADD), 1);
+
+    const IRInstr* copy = NULL;
+    const IRInstr* add = NULL;
+    for (u32 i = 0; i < ir_function_get_instrs_count(&ctx->ir); ++i) {
+        const IRInstr* instr = ir_function_get_instr(&ctx->ir, i);
+        copy = instr->op == IR_OP_COPY ? instr : copy;
+        add = instr->op == IR_OP_ADD ? instr : add;
+    }
+    ASSERT_EQ(copy->a, 0);
+    ASSERT_EQ(add->a, copy->dst);
+    ASSERT_EQ(add->b, 0);
+
+    // And the lowered code computes 5 + 2.
+    BCModule module = bc_module_create(NULL);
+    ASSERT_TRUE(source_fixture_compile_bytecode(&utest_fixture->source, &module, STREAM_STRING_SOURCE, SIDE_EFFECTS_SOURCE, NULL));
+
+    i64 result = 0;
+    const i64 a = 5;
+    EXPECT_EQ(source_fixture_run_function(&module, stdout, "f", &a, 1, &result), VM_STATUS_OK);
+    EXPECT_EQ(result, 7);
+    bc_module_free(&module);
+}
+
+UTEST_F(CFGLoweringFixture, short_circuit_branches) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f(a as int, b as int) as int\n"
+        "    dim c as int\n"
+        "    if (a > 0 && (b > 0 || !(a > b))) then\n"
+        "        c = a < b && b < 10;\n"
+        "    end if\n"
+        "    return(a > b ? c : b);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+    ASSERT_EQ(utest_fixture->diag->msgs.items_count, 0);
+
+    // Every operand gets its own branch, the rhs is only evaluated when it decides the result.
+    const CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_LAND), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_LOR), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_SELECT), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_BR), 6);
+
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i + 1 < node->instrs_count; ++i) {
+            ASSERT_FALSE(is_ir_opcode_terminator(cfg_context_get_instr(ctx, id, i)->op));
+        }
+        ASSERT_NE(cfg_context_get_terminator(ctx, id), NULL);
+    }
+}
+
+UTEST_F(CFGLoweringFixture, undeclared_identifier) {
+    const u32 entry = source_fixture_build(&utest_fixture->source,
+        "function f() as int\n"
+        "    return(b);\n"
+        "end function\n"
+    );
+    ASSERT_EQ(entry, CFG_NULL_NODE);
+    ASSERT_EQ(utest_fixture->diag->msgs.items_count, 1);
+
+    const DiagnosticMsg* msg = vector_get_ref(&utest_fixture->diag->msgs, 0);
+    ASSERT_EQ(msg->id, ERR_UNDECLARED_IDENTIFIER);
+}
+
+UTEST_F(CFGLoweringFixture, short_circuit_skips_the_rhs) {
+    BCModule module = bc_module_create(NULL);
+    ASSERT_TRUE(source_fixture_compile_bytecode(&utest_fixture->source, &module, STREAM_STRING_SOURCE,
+        "function f(a as int) as int\n"
+        "    dim n as int\n"
+        "    if (a != 0 && 100 / a > 10) then\n"
+        "        n = 1;\n"
+        "    end if\n"
+        "    if (a == 0 || 100 % a == 0) then\n"
+        "        n += 2;\n"
+        "    end if\n"
+        "    return(a > 0 ? n : -n);\n"
+        "end function\n",
+        NULL
+    ));
+
+    // The divisions by 0 are never reached.
+    const i64 rows[][2] = { { 0, -2 }, { 5, 3 }, { 20, 2 }, { -3, 0 }, { 7, 1 } };
+    for (u32 i = 0; i < 5; ++i) {
+        i64 result = 0;
+        EXPECT_EQ(source_fixture_run_function(&module, stdout, "f", &rows[i][0], 1, &result), VM_STATUS_OK);
+        EXPECT_EQ(result, rows[i][1]);
+    }
+    bc_module_free(&module);
+}
\ No newline at end of file
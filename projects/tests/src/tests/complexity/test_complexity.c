@@ -0,0 +1,397 @@
+#include "utest/utest.h"
+
+#include <math.h>
+
+#include "vanec/frontend/ast/ast_parser.h"
+#include "vanec/frontend/cfg/cfg_builder.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/utils/profiler.h"
+#include "vanec/utils/string_builder.h"
+#include "vanec/utils/string_utils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+// Every shape is compiled at SCALES[i] * base size. The growth exponent k of t ~ n^k
+// is fitted over all scales and compared against MAX_GROWTH_EXPONENT.
+// n log n over an 8x range fits at about 1.1, quadratic at 2.0.
+#define SCALES_COUNT            4
+#define REPETITIONS_COUNT       3
+#define MAX_GROWTH_EXPONENT     1.5
+// Phases faster than that at the largest scale are dominated by timer noise.
+#define MIN_MEASURABLE_NS       (2 * 1000 * 1000)
+// Same for the memory, allocator caching hides smaller deltas.
+#define MIN_MEASURABLE_BYTES    (4 * 1024 * 1024)
+
+static const u64 SCALES[SCALES_COUNT] = { 1, 2, 4, 8 };
+
+typedef enum {
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_CFG,
+    PHASE_SSA,
+    PHASE_FREE,
+    PHASES_COUNT,
+} Phase;
+
+static const char* phase_names[PHASES_COUNT] = {
+    "lex", "parse", "cfg", "ssa", "free",
+};
+
+typedef char* (*GenerateSourceFunc)(const u64 n);
+
+struct ComplexityFixture {
+    Stream* ss;
+    Lexer* lexer;
+    ASTParser* parser;
+    DiagnosticEngine* diag;
+
+    u64 ns[PHASES_COUNT][SCALES_COUNT];
+    u64 memory[SCALES_COUNT];
+    u64 sizes[SCALES_COUNT];
+};
+
+UTEST_F_SETUP(ComplexityFixture) {
+    utest_fixture->ss = stream_create();
+    utest_fixture->diag = diagnostic_engine_create();
+    utest_fixture->lexer = lexer_create(MAX_STREAM_CHUNK_CAPACITY, utest_fixture->diag);
+    utest_fixture->parser = ast_parser_create(utest_fixture->lexer, utest_fixture->diag);
+}
+
+UTEST_F_TEARDOWN(ComplexityFixture) {
+    ast_parser_free(utest_fixture->parser);
+    lexer_free(utest_fixture->lexer);
+    diagnostic_engine_free(utest_fixture->diag);
+    stream_free(utest_fixture->ss);
+}
+
+#pragma region SHAPES
+
+// Many small functions.
+static char* generate_long_file(const u64 n) {
+    StringBuilder sb = string_builder_create();
+    for (u64 i = 0; i < n; ++i) {
+        string_builder_append_format(&sb,
+            "function f%lld(a as int, b as int) as int\n"
+            "    dim c as int\n"
+            "    c = a + b * 2;\n"
+            "    while (c > 10)\n"
+            "        if (c %% 2 == 0) then\n"
+            "            c = c / 2;\n"
+            "        else\n"
+            "            c = c - 1;\n"
+            "        end if\n"
+            "    wend\n"
+            "    return(c);\n"
+            "end function\n\n", i
+        );
+    }
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+    return source;
+}
+
+// One statement with n operands on a single line.
+static char* generate_long_line(const u64 n) {
+    StringBuilder sb = string_builder_create();
+    string_builder_append_str_right(&sb, "function main() as int\n    dim a as int\n    a = a");
+    for (u64 i = 0; i < n; ++i) {
+        string_builder_append_str_right(&sb, i % 2 == 0 ? " + 1" : " - a");
+    }
+    string_builder_append_str_right(&sb, ";\n    return(a);\nend function\n");
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+    return source;
+}
+
+// n nested if statements.
+static char* generate_deep_nesting(const u64 n) {
+    StringBuilder sb = string_builder_create();
+    string_builder_append_str_right(&sb, "function main() as int\n    dim a as int\n");
+    for (u64 i = 0; i < n; ++i) {
+        string_builder_append_str_right(&sb, "if (a < 100) then\na = a + 1;\n");
+    }
+    for (u64 i = 0; i < n; ++i) {
+        string_builder_append_str_right(&sb, "end if\n");
+    }
+    string_builder_append_str_right(&sb, "    return(a);\nend function\n");
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+    return source;
+}
+
+// One expression of n terms with mixed precedence, braces and calls, split over lines.
+static char* generate_long_expression(const u64 n) {
+    StringBuilder sb = string_builder_create();
+    string_builder_append_str_right(&sb, "function main() as int\n    dim a, b as int\n    a = b");
+    for (u64 i = 0; i < n; ++i) {
+        switch (i % 4) {
+        case 0: { string_builder_append_str_right(&sb, " * (a - 1)"); } break;
+        case 1: { string_builder_append_str_right(&sb, " + b << 2"); } break;
+        case 2: { string_builder_append_str_right(&sb, " == main(a, b)"); } break;
+        case 3: { string_builder_append_str_right(&sb, " || !a\n"); } break;
+        };
+    }
+    string_builder_append_str_right(&sb, ";\n    return(a);\nend function\n");
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+    return source;
+}
+
+// A single string literal of n characters.
+static char* generate_huge_string(const u64 n) {
+    StringBuilder sb = string_builder_create();
+    string_builder_append_str_right(&sb, "function main() as int\n    printf(\"");
+    for (u64 i = 0; i < n; ++i) {
+        string_builder_append_char_right(&sb, (i % 64 == 63) ? ' ' : (char)('a' + i % 26));
+    }
+    string_builder_append_str_right(&sb, "\\n\");\n    return(0);\nend function\n");
+    char* source = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+    return source;
+}
+
+#pragma endregion
+
+#pragma region MEASURE
+
+static u64 get_memory_usage(void) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS_EX pmc = { 0 };
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc))) {
+        return 0;
+    }
+    return (u64)pmc.PrivateUsage;
+#else
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file == NULL) {
+        return 0;
+    }
+    unsigned long long size = 0, resident = 0;
+    const int count = fscanf(file, "%llu %llu", &size, &resident);
+    fclose(file);
+    return count == 2 ? (u64)resident * (u64)sysconf(_SC_PAGESIZE) : 0;
+#endif
+}
+
+static void set_source(struct ComplexityFixture* fixture, const char* source) {
+    stream_set_source(fixture->ss, STREAM_STRING_SOURCE, source);
+    lexer_set_source_stream(fixture->lexer, fixture->ss);
+}
+
+static u64 measure_lex(struct ComplexityFixture* fixture, const char* source) {
+    set_source(fixture, source);
+
+    const u64 start_ns = profiler_now_ns();
+    TokenKind kind = TOKEN_UNKNOWN;
+    while (kind != TOKEN_END_OF_FILE) {
+        Token token = lexer_parse_next_token(fixture->lexer);
+        kind = token.kind;
+        token_free(&token);
+    }
+    return profiler_now_ns() - start_ns;
+}
+
+// Runs parse, cfg and free once, returns false if the source was rejected.
+static bool measure_pipeline(struct ComplexityFixture* fixture, const char* source, u64 ns[PHASES_COUNT], u64* memory) {
+    set_source(fixture, source);
+
+    Vector functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ASTNode*), NULL, true);
+    bool result = true;
+
+    const u64 memory_before = get_memory_usage();
+
+    u64 start_ns = profiler_now_ns();
+    while (!is_ast_parser_done(fixture->parser)) {
+        ASTNode* funcdef = ast_parser_parse_ast_funcdef_node(fixture->parser);
+        if (funcdef == NULL) {
+            result = false;
+            break;
+        }
+        vector_push_back(&functions, &funcdef);
+    }
+    ns[PHASE_PARSE] = profiler_now_ns() - start_ns;
+
+    const u64 memory_after = get_memory_usage();
+    *memory = memory_after > memory_before ? memory_after - memory_before : 0;
+
+    // SSA construction and destruction are timed separately inside the cfg loop.
+    u64 ssa_ns = 0;
+
+    start_ns = profiler_now_ns();
+    CFGContext* ctx = cfg_context_create(fixture->diag);
+    for (u64 i = 0; result && i < functions.items_count; ++i) {
+        cfg_context_clear(ctx);
+        result = build_cfg_for_function(ctx, vector_get_ref(&functions, i)) != CFG_NULL_NODE;
+
+        if (result) {
+            const u64 ssa_start_ns = profiler_now_ns();
+            construct_ssa(ctx);
+            destruct_ssa(ctx);
+            ssa_ns += profiler_now_ns() - ssa_start_ns;
+        }
+    }
+    cfg_context_free(ctx);
+    ns[PHASE_CFG] = profiler_now_ns() - start_ns - ssa_ns;
+    ns[PHASE_SSA] = ssa_ns;
+
+    start_ns = profiler_now_ns();
+    for (u64 i = 0; i < functions.items_count; ++i) {
+        ast_node_free(vector_get_ref(&functions, i));
+    }
+    ast_parser_clear(fixture->parser);
+    ns[PHASE_FREE] = profiler_now_ns() - start_ns;
+
+    vector_free(&functions);
+
+    if (fixture->diag->msgs.items_count != 0) {
+        diagnostic_engine_print_all(fixture->diag);
+        diagnostic_engine_clear(fixture->diag);
+        result = false;
+    }
+
+    return result;
+}
+
+static bool measure_shape(struct ComplexityFixture* fixture, GenerateSourceFunc generate, const u64 base) {
+    for (u32 s = 0; s < SCALES_COUNT; ++s) {
+        char* source = generate(base * SCALES[s]);
+        fixture->sizes[s] = base * SCALES[s];
+
+        for (u32 p = 0; p < PHASES_COUNT; ++p) {
+            fixture->ns[p][s] = UINT64_MAX;
+        }
+        fixture->memory[s] = 0;
+
+        // Min of the repetitions, the noise only ever adds time.
+        for (u32 r = 0; r < REPETITIONS_COUNT; ++r) {
+            u64 ns[PHASES_COUNT] = { 0 };
+            u64 memory = 0;
+
+            ns[PHASE_LEX] = measure_lex(fixture, source);
+            if (!measure_pipeline(fixture, source, ns, &memory)) {
+                str_free(source);
+                return false;
+            }
+
+            for (u32 p = 0; p < PHASES_COUNT; ++p) {
+                if (ns[p] < fixture->ns[p][s]) {
+                    fixture->ns[p][s] = ns[p];
+                }
+            }
+            if (r == 0) {
+                fixture->memory[s] = memory;
+            }
+        }
+
+        str_free(source);
+    }
+    return true;
+}
+
+// Least squares slope of log(y) over log(x).
+static double fit_growth_exponent(const u64* x, const u64* y, const u32 count) {
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+    for (u32 i = 0; i < count; ++i) {
+        const double lx = log((double)x[i]);
+        const double ly = log((double)(y[i] == 0 ? 1 : y[i]));
+        sx += lx;
+        sy += ly;
+        sxx += lx * lx;
+        sxy += lx * ly;
+    }
+    return (count * sxy - sx * sy) / (count * sxx - sx * sx);
+}
+
+#pragma endregion
+
+// The timings depend on the machine load, so the tests only run when the project is
+// generated with --complexity-tests.
+#ifdef COMPLEXITY_TESTS
+#define SKIP_UNLESS_ENABLED()
+#else
+#define SKIP_UNLESS_ENABLED() UTEST_SKIP("complexity tests are disabled, generate with --complexity-tests")
+#endif
+
+#define ASSERT_SCALES_LINEARLY(fixture, shape)                                                          \
+for (u32 p = 0; p < PHASES_COUNT; ++p) {                                                                \
+    if ((fixture)->ns[p][SCALES_COUNT - 1] < MIN_MEASURABLE_NS) {                                       \
+        continue;                                                                                       \
+    }                                                                                                   \
+    const double k = fit_growth_exponent((fixture)->sizes, (fixture)->ns[p], SCALES_COUNT);             \
+    if (k > MAX_GROWTH_EXPONENT) {                                                                      \
+        printf("  %s: \"%s\" time grows as n^%.2f\n", shape, phase_names[p], k);                        \
+    }                                                                                                   \
+    EXPECT_LE(k, MAX_GROWTH_EXPONENT);                                                                  \
+}                                                                                                       \
+if ((fixture)->memory[0] >= MIN_MEASURABLE_BYTES) {                                                     \
+    const double k = fit_growth_exponent((fixture)->sizes, (fixture)->memory, SCALES_COUNT);            \
+    if (k > MAX_GROWTH_EXPONENT) {                                                                      \
+        printf("  %s: memory grows as n^%.2f\n", shape, k);                                             \
+    }                                                                                                   \
+    EXPECT_LE(k, MAX_GROWTH_EXPONENT);                                                                  \
+}
+
+UTEST_F(ComplexityFixture, long_file) {
+    SKIP_UNLESS_ENABLED();
+
+    ASSERT_TRUE(measure_shape(utest_fixture, &generate_long_file, 1000));
+    ASSERT_SCALES_LINEARLY(utest_fixture, "long_file");
+}
+
+UTEST_F(ComplexityFixture, long_line) {
+    SKIP_UNLESS_ENABLED();
+
+    ASSERT_TRUE(measure_shape(utest_fixture, &generate_long_line, 20000));
+    ASSERT_SCALES_LINEARLY(utest_fixture, "long_line");
+}
+
+UTEST_F(ComplexityFixture, deep_nesting) {
+    SKIP_UNLESS_ENABLED();
+
+    ASSERT_TRUE(measure_shape(utest_fixture, &generate_deep_nesting, 500));
+    ASSERT_SCALES_LINEARLY(utest_fixture, "deep_nesting");
+}
+
+UTEST_F(ComplexityFixture, long_expression) {
+    SKIP_UNLESS_ENABLED();
+
+    ASSERT_TRUE(measure_shape(utest_fixture, &generate_long_expression, 10000));
+    ASSERT_SCALES_LINEARLY(utest_fixture, "long_expression");
+}
+
+UTEST_F(ComplexityFixture, string_builder_append_left) {
+    SKIP_UNLESS_ENABLED();
+
+    for (u32 s = 0; s < SCALES_COUNT; ++s) {
+        const u64 n = 1000000 * SCALES[s];
+        utest_fixture->sizes[s] = n;
+
+        StringBuilder sb = string_builder_create();
+
+        const u64 start_ns = profiler_now_ns();
+        for (u64 i = 0; i < n; ++i) {
+            string_builder_append_char_left(&sb, 'a');
+        }
+        utest_fixture->ns[PHASE_LEX][s] = profiler_now_ns() - start_ns;
+
+        ASSERT_EQ(string_builder_get_len(&sb), n);
+        string_builder_free(&sb);
+    }
+
+    const double k = fit_growth_exponent(utest_fixture->sizes, utest_fixture->ns[PHASE_LEX], SCALES_COUNT);
+    EXPECT_LE(k, MAX_GROWTH_EXPONENT);
+}
+
+UTEST_F(ComplexityFixture, huge_string) {
+    SKIP_UNLESS_ENABLED();
+
+    ASSERT_TRUE(measure_shape(utest_fixture, &generate_huge_string, 200000));
+    ASSERT_SCALES_LINEARLY(utest_fixture, "huge_string");
+}
\ No newline at end of file
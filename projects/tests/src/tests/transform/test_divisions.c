@@ -0,0 +1,464 @@
+#include "utest/utest.h"
+
+#include <stdint.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/sccp.h"
+#include "vanec/transform/divisions.h"
+
+struct DivisionsFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(DivisionsFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(DivisionsFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static u32 build_source(struct DivisionsFixture* fixture, const char* source) {
+    const u32 entry = source_fixture_build(&fixture->source, source);
+    if (entry != CFG_NULL_NODE) {
+        construct_ssa(fixture->source.ctx);
+    }
+    return entry;
+}
+
+UTEST_F(DivisionsFixture, lowers_digit_extraction) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(n as int, u as ulong) as long\n"
+        "    return(n % 10 + n / 10 + u / 7 + u % 8 + n / 4);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The unsigned remainder by 8 is a mask, the rest multiplies or shifts.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(lower_constant_divisions(ctx), 5);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_REM), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_MULH), 3);
+}
+
+UTEST_F(DivisionsFixture, tests_divisibility_without_remainder) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(n as int) as int\n"
+        "    if (n % 15 == 0) then\n"
+        "        return(1);\n"
+        "    end if\n"
+        "    return(n % 6);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The compare turns unsigned, only the remainder returned needs the quotient.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(lower_constant_divisions(ctx), 2);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_REM), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_MULH), 1);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_EQ), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_LE), 1);
+}
+
+UTEST_F(DivisionsFixture, keeps_trapping_division) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(n as int, d as int) as int\n"
+        "    return(n / 0 + n % d);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_EQ(lower_constant_divisions(ctx), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 1);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_REM), 1);
+}
+
+// A function per type, the selector picks one division, remainder or divisibility test by a constant.
+// Byte and char are divided as int, like in C, and narrowed when returned.
+static const char* const WIDTHS_SOURCE =
+    "function div_char(n as char, k as int) as char\n"
+    "    if (k == 0) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 3);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n % -7);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n / -7);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n / 4);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n % 4);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n / -2);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n / -1);\n"
+    "    end if\n"
+    "    if (k == 9) then\n"
+    "        return(n % -1);\n"
+    "    end if\n"
+    "    if (k == 10) then\n"
+    "        return(n / 127);\n"
+    "    end if\n"
+    "    if (k == 11) then\n"
+    "        return(n % 100);\n"
+    "    end if\n"
+    "    if (k == 12 && n % 5 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 13 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 14 && n % 4 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n"
+    "\n"
+    "function div_byte(n as byte, k as int) as byte\n"
+    "    if (k == 0) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 3);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n % 7);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n / 16);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n % 16);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n / 255);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n % 10);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n / 1);\n"
+    "    end if\n"
+    "    if (k == 9 && n % 5 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 10 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 11 && n % 8 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n"
+    "\n"
+    "function div_int(n as int, k as int) as int\n"
+    "    if (k == 0) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 7);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / -7);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n % -7);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n / 10);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n % 10);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n / 1000000007);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n / 2147483647);\n"
+    "    end if\n"
+    "    if (k == 9) then\n"
+    "        return(n / 4);\n"
+    "    end if\n"
+    "    if (k == 10) then\n"
+    "        return(n % 4);\n"
+    "    end if\n"
+    "    if (k == 11) then\n"
+    "        return(n / -4);\n"
+    "    end if\n"
+    "    if (k == 12) then\n"
+    "        return(n % -8);\n"
+    "    end if\n"
+    "    if (k == 13) then\n"
+    "        return(n / -1);\n"
+    "    end if\n"
+    "    if (k == 14) then\n"
+    "        return(n % -1);\n"
+    "    end if\n"
+    "    if (k == 15) then\n"
+    "        return(n / 1);\n"
+    "    end if\n"
+    "    if (k == 16 && n % 15 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 17 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 18 && n % 16 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 19 && n % -15 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n"
+    "\n"
+    "function div_uint(n as uint, k as int) as uint\n"
+    "    dim d, e as uint\n"
+    "    d = 4294967295;\n"
+    "    e = 2147483648;\n"
+    "    if (k == 0) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 7);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n / 10);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n % 10);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n / 641);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n / 16);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n % 16);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n / d);\n"
+    "    end if\n"
+    "    if (k == 9) then\n"
+    "        return(n % d);\n"
+    "    end if\n"
+    "    if (k == 10) then\n"
+    "        return(n / e);\n"
+    "    end if\n"
+    "    if (k == 11) then\n"
+    "        return(n % e);\n"
+    "    end if\n"
+    "    if (k == 12 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 13 && n % 15 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 14 && n % 7 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 15 && n % 16 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n"
+    "\n"
+    "function div_long(n as long, k as int) as long\n"
+    "    if (k == 0) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 7);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / -7);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n / 10);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n % 10);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n / 1000000000039);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n / 4);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n % 4);\n"
+    "    end if\n"
+    "    if (k == 9) then\n"
+    "        return(n / -8);\n"
+    "    end if\n"
+    "    if (k == 10) then\n"
+    "        return(n / -1);\n"
+    "    end if\n"
+    "    if (k == 11) then\n"
+    "        return(n % -1);\n"
+    "    end if\n"
+    "    if (k == 12 && n % 15 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 13 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 14 && n % 8 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n"
+    "\n"
+    "function div_ulong(n as ulong, k as int) as ulong\n"
+    "    dim d as ulong\n"
+    "    d = 18446744073709551615;\n"
+    "    if (k == 0) then\n"
+    "        return(n / 7);\n"
+    "    end if\n"
+    "    if (k == 1) then\n"
+    "        return(n % 7);\n"
+    "    end if\n"
+    "    if (k == 2) then\n"
+    "        return(n / 3);\n"
+    "    end if\n"
+    "    if (k == 3) then\n"
+    "        return(n / 10);\n"
+    "    end if\n"
+    "    if (k == 4) then\n"
+    "        return(n % 10);\n"
+    "    end if\n"
+    "    if (k == 5) then\n"
+    "        return(n / 1000000000039);\n"
+    "    end if\n"
+    "    if (k == 6) then\n"
+    "        return(n / 4294967296);\n"
+    "    end if\n"
+    "    if (k == 7) then\n"
+    "        return(n % 4294967296);\n"
+    "    end if\n"
+    "    if (k == 8) then\n"
+    "        return(n / 16);\n"
+    "    end if\n"
+    "    if (k == 9) then\n"
+    "        return(n / d);\n"
+    "    end if\n"
+    "    if (k == 10) then\n"
+    "        return(n % d);\n"
+    "    end if\n"
+    "    if (k == 11 && n % 15 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 12 && n % 6 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    if (k == 13 && n % 7 == 0) then\n"
+    "        return(1);\n"
+    "    end if\n"
+    "    return(0);\n"
+    "end function\n";
+
+#define WIDTHS_MAX_ROWS_COUNT 512
+
+static u32 lowered_count = 0;
+
+// The negative divisors are folded into constants first.
+static void lower_ssa_divisions(CFGContext* ctx) {
+    construct_ssa(ctx);
+    propagate_constants(ctx);
+    lowered_count += lower_constant_divisions(ctx);
+}
+
+// Every value against every selector, lowered and not.
+static bool is_lowering_preserving(struct DivisionsFixture* fixture, const char* name, const i64* values, const u32 values_count, const u32 selectors_count) {
+    i64 rows[WIDTHS_MAX_ROWS_COUNT][2] = { 0 };
+    u32 rows_count = 0;
+
+    for (u32 i = 0; i < values_count; ++i) {
+        for (u32 k = 0; k < selectors_count; ++k) {
+            rows[rows_count][0] = values[i];
+            rows[rows_count][1] = k;
+            ++rows_count;
+        }
+    }
+    return is_source_behavior_preserved(&fixture->source, WIDTHS_SOURCE, name, &lower_ssa_divisions, &rows[0][0], 2, rows_count);
+}
+
+UTEST_F(DivisionsFixture, signed_lowering_keeps_values) {
+    const i64 chars[] = { -128, -127, -100, -15, -8, -7, -1, 0, 1, 7, 8, 14, 15, 45, 100, 126, 127 };
+    const i64 ints[] = {
+        -2147483647 - 1, -2147483647, -2147483640, -1000000007, -123456, -15, -7, -1,
+        0, 1, 6, 7, 15, 30, 123456789, 2147483640, 2147483646, 2147483647,
+    };
+    const i64 longs[] = {
+        INT64_MIN, INT64_MIN + 1, -9223372036854775800, -1000000000039, -15, -1,
+        0, 1, 15, 1000000000039, 9223372036854775800, INT64_MAX,
+    };
+
+    lowered_count = 0;
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_char", chars, sizeof(chars) / sizeof(chars[0]), 15));
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_int", ints, sizeof(ints) / sizeof(ints[0]), 20));
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_long", longs, sizeof(longs) / sizeof(longs[0]), 15));
+    EXPECT_GT(lowered_count, 0u);
+}
+
+UTEST_F(DivisionsFixture, unsigned_lowering_keeps_values) {
+    const i64 bytes[] = { 0, 1, 6, 7, 8, 15, 16, 45, 128, 250, 252, 255 };
+    const i64 uints[] = {
+        0, 1, 6, 7, 15, 16, 641, 2147483647, 2147483648, 3000000000, 4294967290, 4294967292, 4294967294, 4294967295,
+    };
+
+    // The ulongs past INT64_MAX wrap around into the negative ones.
+    const i64 ulongs[] = { 0, 1, 7, 15, 16, 3000000000117, INT64_MAX, INT64_MIN, -16, -2, -1 };
+
+    lowered_count = 0;
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_byte", bytes, sizeof(bytes) / sizeof(bytes[0]), 12));
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_uint", uints, sizeof(uints) / sizeof(uints[0]), 16));
+    EXPECT_TRUE(is_lowering_preserving(utest_fixture, "div_ulong", ulongs, sizeof(ulongs) / sizeof(ulongs[0]), 14));
+    EXPECT_GT(lowered_count, 0u);
+}
+
+UTEST_F(DivisionsFixture, lowered_module_still_traps) {
+    BCModule module = bc_module_create(NULL);
+    ASSERT_TRUE(source_fixture_compile_bytecode(&utest_fixture->source, &module, STREAM_STRING_SOURCE, WIDTHS_SOURCE, &lower_ssa_divisions));
+
+    // The selectors of 'n / -1' and 'n % -1'.
+    i64 result = 0;
+    const i64 int_min[][2] = { { -2147483647 - 1, 13 }, { -2147483647 - 1, 14 } };
+    EXPECT_EQ(source_fixture_run_function(&module, stdout, "div_int", int_min[0], 2, &result), VM_STATUS_DIVISION_OVERFLOW);
+    EXPECT_EQ(source_fixture_run_function(&module, stdout, "div_int", int_min[1], 2, &result), VM_STATUS_DIVISION_OVERFLOW);
+
+    const i64 long_min[][2] = { { INT64_MIN, 10 }, { INT64_MAX, 10 } };
+    EXPECT_EQ(source_fixture_run_function(&module, stdout, "div_long", long_min[0], 2, &result), VM_STATUS_DIVISION_OVERFLOW);
+    EXPECT_EQ(source_fixture_run_function(&module, stdout, "div_long", long_min[1], 2, &result), VM_STATUS_OK);
+    EXPECT_EQ(result, -INT64_MAX);
+
+    bc_module_free(&module);
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/gvn.h"
+
+struct GVNFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(GVNFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(GVNFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static u32 build_source(struct GVNFixture* fixture, const char* source) {
+    const u32 entry = source_fixture_build(&fixture->source, source);
+    if (entry != CFG_NULL_NODE) {
+        construct_ssa(fixture->source.ctx);
+    }
+    return entry;
+}
+
+static const char* const REDUNDANCY_SOURCE =
+    "function f(a as int, b as int) as int\n"
+    "    dim c as int\n"
+    "    c = a * b;\n"
+    "    if (a > b) then\n"
+    "        c += b * a;\n"
+    "    else\n"
+    "        c -= b < a;\n"
+    "    end if\n"
+    "    return(c + a * b);\n"
+    "end function\n";
+
+UTEST_F(GVNFixture, removes_redundancy_across_blocks) {
+    const u32 entry = build_source(utest_fixture, REDUNDANCY_SOURCE);
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // Both products in the branches are the one of the entry, as is the compare turned around.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(eliminate_common_subexpressions(ctx), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_MUL), 1);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_GT) + count_source_opcodes(ctx, IR_OP_LT), 1);
+    ASSERT_EQ(eliminate_common_subexpressions(ctx), 0);
+}
+
+UTEST_F(GVNFixture, loads_follow_stores) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), x as int, n as int) as int\n"
+        "    dim y as int\n"
+        "    arr(n) = x;\n"
+        "    y = arr(n) + arr(n + 1) + arr(n + 1);\n"
+        "    arr(0) = y;\n"
+        "    return(y + arr(n + 1));\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The stored element is forwarded and the other one loaded again after the second store only.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    eliminate_common_subexpressions(ctx);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_LOAD_ELEM), 2);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_STORE_ELEM), 2);
+}
+
+static void eliminate_ssa_subexpressions(CFGContext* ctx) {
+    construct_ssa(ctx);
+    eliminate_common_subexpressions(ctx);
+}
+
+UTEST_F(GVNFixture, keeps_results) {
+    const i64 rows[][2] = {
+        { 0, 0 }, { 7, 3 }, { 3, 7 }, { -5, -5 }, { 2147483647, 2 }, { -65536, 65536 },
+    };
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, REDUNDANCY_SOURCE, "f", &eliminate_ssa_subexpressions, &rows[0][0], 2, 6));
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/induction.h"
+
+struct InductionFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(InductionFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(InductionFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static u32 build_source(struct InductionFixture* fixture, const char* source) {
+    const u32 entry = source_fixture_build(&fixture->source, source);
+    if (entry != CFG_NULL_NODE) {
+        construct_ssa(fixture->source.ctx);
+    }
+    return entry;
+}
+
+// Whether some constant of the function holds the value.
+static bool has_const(CFGContext* ctx, const i64 value) {
+    for (u32 i = 0; i < ir_function_get_instrs_count(&ctx->ir); ++i) {
+        const IRInstr* instr = ir_function_get_instr(&ctx->ir, i);
+        if (instr->op == IR_OP_CONST && instr->as.imm == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+UTEST_F(InductionFixture, replaces_constant_exit_test) {
+    const u32 entry = build_source(utest_fixture,
+        "function f() as int\n"
+        "    dim i as int\n"
+        "    dim s as int\n"
+        "    i = 0;\n"
+        "    while (i < 100)\n"
+        "        s += i * 4;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The test moves over to the multiple, which leaves nothing for the counter to do.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(optimize_induction_variables(ctx), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_MUL), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_PHI), 2);
+    ASSERT_TRUE(has_const(ctx, 400));
+    ASSERT_EQ(optimize_induction_variables(ctx), 0);
+}
+
+UTEST_F(InductionFixture, keeps_unknown_exit_test) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), n as int) as int\n"
+        "    dim i as int\n"
+        "    dim s as int\n"
+        "    while (i < n)\n"
+        "        s += arr((i << 1) + 1) + i * 12;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // Both products get their own variable, the counter stays for the test against the parameter.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(optimize_induction_variables(ctx), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_MUL), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_SHL), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_PHI), 4);
+}
+
+static void optimize_ssa_induction_variables(CFGContext* ctx) {
+    construct_ssa(ctx);
+    optimize_induction_variables(ctx);
+}
+
+UTEST_F(InductionFixture, keeps_results) {
+    const char* source =
+        "function f(n as int, k as int) as int\n"
+        "    dim i, s as int\n"
+        "    while (i < n)\n"
+        "        s += i * 12 + (i << 1) + i * k;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    i = 0;\n"
+        "    while (i < 100)\n"
+        "        s += i * 4;\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s + i);\n"
+        "end function\n";
+
+    // The last row wraps the products around, the reduced additions have to wrap the same.
+    const i64 rows[][2] = {
+        { 0, 0 }, { 5, 3 }, { -3, 7 }, { 1000, -2 }, { 3, 2147483647 },
+    };
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, source, "f", &optimize_ssa_induction_variables, &rows[0][0], 2, 5));
+}
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "utest/utest.h"
+
+#include <stdint.h>
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/licm.h"
+
+struct LICMFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(LICMFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(LICMFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static u32 build_source(struct LICMFixture* fixture, const char* source) {
+    const u32 entry = source_fixture_build(&fixture->source, source);
+    if (entry != CFG_NULL_NODE) {
+        construct_ssa(fixture->source.ctx);
+    }
+    return entry;
+}
+
+UTEST_F(LICMFixture, hoists_out_of_nested_loops) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), a as int, n as int) as int\n"
+        "    dim i as int\n"
+        "    dim s as int\n"
+        "    while (i < n)\n"
+        "        dim j as int\n"
+        "        while (j < n)\n"
+        "            s += (a + 1) * j + arr(2) / 3;\n"
+        "            ++j;\n"
+        "        wend\n"
+        "        printf(\"%d\", arr(0) * a);\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The sum leaves both loops. The load of the inner loop stays, as the loop may not run at all,
+    // and the division of the loaded value with it. The call of the outer loop can write the array anyway.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(move_loop_invariant_code(ctx), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_DIV), 1);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_LOAD_ELEM), 2);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_MUL), 2);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_CALL), 1);
+
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    for (u32 loop = 0; loop < loop_forest_get_loops_count(forest); ++loop) {
+        ASSERT_NE(loop_forest_get_loop(forest, loop)->preheader, CFG_NULL_NODE);
+    }
+}
+
+UTEST_F(LICMFixture, sinks_store_into_exit) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), n as int) as int\n"
+        "    dim i as int\n"
+        "    do\n"
+        "        arr(0) = i;\n"
+        "        ++i;\n"
+        "    loop until i >= n\n"
+        "    return(i);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(move_loop_invariant_code(ctx), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_STORE_ELEM), 0);
+    ASSERT_EQ(move_loop_invariant_code(ctx), 0);
+}
+
+UTEST_F(LICMFixture, keeps_load_of_loop_that_may_not_run) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), n as int) as int\n"
+        "    dim i, s as int\n"
+        "    while (i < n)\n"
+        "        s += arr(3);\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // With n <= 0 the body never reads arr(3), which may be out of range.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    move_loop_invariant_code(ctx);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_LOAD_ELEM), 1);
+}
+
+UTEST_F(LICMFixture, hoists_load_of_loop_run_at_least_once) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), n as int) as int\n"
+        "    dim i, s as int\n"
+        "    do\n"
+        "        s += arr(3);\n"
+        "        ++i;\n"
+        "    loop until i >= n\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(move_loop_invariant_code(ctx), 0);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_LOAD_ELEM), 0);
+}
+
+UTEST_F(LICMFixture, keeps_guarded_load) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), n as int) as int\n"
+        "    dim i, s as int\n"
+        "    do\n"
+        "        if (n > 3) then\n"
+        "            s += arr(3);\n"
+        "        end if\n"
+        "        ++i;\n"
+        "    loop until i >= n\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The condition guards the index, the load only runs on the branch taken.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    move_loop_invariant_code(ctx);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_LOAD_ELEM), 1);
+}
+
+UTEST_F(LICMFixture, keeps_load_after_trapping_division) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(arr as int(), a as int, n as int) as int\n"
+        "    dim i, s as int\n"
+        "    do\n"
+        "        s += 100 / a + arr(3);\n"
+        "        ++i;\n"
+        "    loop until i >= n\n"
+        "    return(s);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The division by 0 traps first, hoisting the load would trap on the index instead.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    move_loop_invariant_code(ctx);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_DIV), 1);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_LOAD_ELEM), 1);
+}
+
+static void move_ssa_invariant_code(CFGContext* ctx) {
+    construct_ssa(ctx);
+    move_loop_invariant_code(ctx);
+}
+
+UTEST_F(LICMFixture, keeps_results) {
+    const char* source =
+        "function f(a as int, n as int) as int\n"
+        "    dim i, j, s as int\n"
+        "    while (i < n)\n"
+        "        j = 0;\n"
+        "        while (j < n)\n"
+        "            s += (a + 1) * j + a / 3 + (a << 2);\n"
+        "            if (j > 100) then\n"
+        "                s += 1000 / a;\n"
+        "            end if\n"
+        "            ++j;\n"
+        "        wend\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    return(s);\n"
+        "end function\n";
+
+    // The division by the parameter is invariant but only runs past 100, where 0 has to trap.
+    const i64 rows[][2] = {
+        { 0, 0 }, { 0, 5 }, { 3, 4 }, { -7, 10 }, { 0, 102 }, { 4, 102 },
+    };
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, source, "f", &move_ssa_invariant_code, &rows[0][0], 2, 6));
+}
+
+UTEST_F(LICMFixture, keeps_results_of_loads) {
+    const char* source =
+        "function f(arr as int(), a as int, n as int) as int\n"
+        "    dim i, s as int\n"
+        "    while (i < n)\n"
+        "        s += arr(3);\n"
+        "        ++i;\n"
+        "    wend\n"
+        "    do\n"
+        "        if (a > 3) then\n"
+        "            s += arr(3) * a;\n"
+        "        end if\n"
+        "        --i;\n"
+        "    loop until i <= 0\n"
+        "    return(s);\n"
+        "end function\n";
+
+    i64 short_items[] = { 1, 2 };
+    i64 long_items[] = { 1, 2, 3, 4, 5 };
+    VMArray empty_arr = { .items = NULL, .count = 0 };
+    VMArray short_arr = { .items = short_items, .count = 2 };
+    VMArray long_arr = { .items = long_items, .count = 5 };
+
+    // Out of range reads have to trap only where the lowered code reads, never when the first loop
+    // runs no iteration or the condition of the second one skips the read.
+    const i64 rows[][3] = {
+        { (i64)(uintptr_t)&short_arr, 0, 0 },
+        { (i64)(uintptr_t)&short_arr, 2, -5 },
+        { (i64)(uintptr_t)&empty_arr, 3, 0 },
+        { (i64)(uintptr_t)&short_arr, 5, 0 },
+        { (i64)(uintptr_t)&short_arr, 0, 2 },
+        { (i64)(uintptr_t)&long_arr, 0, 3 },
+        { (i64)(uintptr_t)&long_arr, 6, 4 },
+    };
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, source, "f", &move_ssa_invariant_code, &rows[0][0], 3, 7));
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/optimize.h"
+
+struct OptimizeFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(OptimizeFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(OptimizeFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static const char* const LOOP_SOURCE =
+    "function f(a as int, b as int, n as int) as int\n"
+    "    dim s, k as int\n"
+    "    k = 3;\n"
+    "    if (k > 2) then\n"
+    "        s = k * 4;\n"
+    "    end if\n"
+    "    while (n > 0)\n"
+    "        s += (a ^ b) + n / 7 + n % 10;\n"
+    "        --n;\n"
+    "    wend\n"
+    "    return(s);\n"
+    "end function\n";
+
+static void optimize_for_hardware(CFGContext* ctx) {
+    optimize_function(ctx, true, "f");
+}
+
+static void optimize_for_bytecode(CFGContext* ctx) {
+    optimize_function(ctx, false, "f");
+}
+
+UTEST_F(OptimizeFixture, builds_ssa_for_lowered_functions) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, LOOP_SOURCE), CFG_NULL_NODE);
+
+    // The function comes straight from the lowering, as it does without '--ssa'.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_FALSE(ctx->ir.is_ssa);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_BR), 2);
+    ASSERT_EQ(count_source_loop_opcodes(ctx, IR_OP_XOR), 1);
+
+    // The constant condition is folded and its branch removed, only the loop one is left.
+    optimize_function(ctx, true, "f");
+    EXPECT_TRUE(ctx->ir.is_ssa);
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_BR), 1);
+
+    // The divisions by constants are lowered to multiplications by their magic numbers.
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 0);
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_REM), 0);
+    EXPECT_GT(count_source_opcodes(ctx, IR_OP_MULH), 0);
+
+    // The invariant xor leaves the loop.
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_XOR), 1);
+    EXPECT_EQ(count_source_loop_opcodes(ctx, IR_OP_XOR), 0);
+}
+
+UTEST_F(OptimizeFixture, keeps_divisions_for_the_bytecode) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, LOOP_SOURCE), CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    optimize_function(ctx, false, "f");
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 1);
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_REM), 1);
+    EXPECT_EQ(count_source_opcodes(ctx, IR_OP_MULH), 0);
+    EXPECT_EQ(count_source_loop_opcodes(ctx, IR_OP_XOR), 0);
+}
+
+UTEST_F(OptimizeFixture, keeps_results) {
+    const i64 rows[][3] = {
+        { 0, 0, 0 }, { 3, 5, 1 }, { -9, 4, 25 }, { 2147483647, -1, 100 }, { 12, 12, -3 },
+    };
+
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, LOOP_SOURCE, "f", &optimize_for_hardware, &rows[0][0], 3, 5));
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, LOOP_SOURCE, "f", &optimize_for_bytecode, &rows[0][0], 3, 5));
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/sccp.h"
+
+struct SCCPFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(SCCPFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(SCCPFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static u32 build_source(struct SCCPFixture* fixture, const char* source) {
+    const u32 entry = source_fixture_build(&fixture->source, source);
+    if (entry != CFG_NULL_NODE) {
+        construct_ssa(fixture->source.ctx);
+    }
+    return entry;
+}
+
+// The const defining the value of the only return, NULL when it is not a constant.
+static const IRInstr* find_returned_const(const CFGContext* ctx) {
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, id);
+        if (terminator->op != IR_OP_RET) {
+            continue;
+        }
+
+        for (u32 i = 0; i < ir_function_get_instrs_count(&ctx->ir); ++i) {
+            const IRInstr* instr = ir_function_get_instr(&ctx->ir, i);
+            if (instr->dst == terminator->a) {
+                return instr->op == IR_OP_CONST ? instr : NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+UTEST_F(SCCPFixture, loop_invariant_value) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(n as int) as int\n"
+        "    dim x as int\n"
+        "    x = 1;\n"
+        "    while (n > 0)\n"
+        "        if (x != 1) then\n"
+        "            x = 2;\n"
+        "        end if\n"
+        "        --n;\n"
+        "    wend\n"
+        "    return(x);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    // The phi of x only ever merges 1, so the assignment of 2 never runs.
+    CFGContext* ctx = utest_fixture->source.ctx;
+    ASSERT_GT(propagate_constants(ctx), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_BR), 1);
+
+    const IRInstr* result = find_returned_const(ctx);
+    ASSERT_TRUE(result != NULL);
+    ASSERT_EQ(result->as.imm, 1);
+}
+
+UTEST_F(SCCPFixture, wraps_in_the_type_width) {
+    const u32 entry = build_source(utest_fixture,
+        "function f() as int\n"
+        "    dim b as byte\n"
+        "    dim i as int\n"
+        "    b = 250;\n"
+        "    b += 10;\n"
+        "    i = 2147483647;\n"
+        "    i += 1;\n"
+        "    if (i < 0 && b == 4) then\n"
+        "        return(i >> 31);\n"
+        "    end if\n"
+        "    return(1 / 0);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    propagate_constants(ctx);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_BR), 0);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 0);
+    ASSERT_EQ(cfg_context_get_nodes_count(ctx), 1);
+
+    const IRInstr* result = find_returned_const(ctx);
+    ASSERT_TRUE(result != NULL);
+    ASSERT_EQ(result->as.imm, -1);
+}
+
+UTEST_F(SCCPFixture, keeps_trapping_division) {
+    const u32 entry = build_source(utest_fixture,
+        "function f(a as int) as int\n"
+        "    dim m as int\n"
+        "    m = -2147483647 - 1;\n"
+        "    return(m / -1 + a / 0);\n"
+        "end function\n"
+    );
+    ASSERT_NE(entry, CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    propagate_constants(ctx);
+    ASSERT_EQ(count_source_opcodes(ctx, IR_OP_DIV), 2);
+    ASSERT_TRUE(find_returned_const(ctx) == NULL);
+}
+
+static void propagate_ssa_constants(CFGContext* ctx) {
+    construct_ssa(ctx);
+    propagate_constants(ctx);
+}
+
+UTEST_F(SCCPFixture, keeps_results) {
+    const char* source =
+        "function f(a as int, b as int) as int\n"
+        "    dim x, y as int\n"
+        "    x = 3;\n"
+        "    y = x * 4;\n"
+        "    if (y > 10) then\n"
+        "        x = a + y;\n"
+        "    else\n"
+        "        x = b / 0;\n"
+        "    end if\n"
+        "    while (b > 0)\n"
+        "        x += y - 12;\n"
+        "        --b;\n"
+        "    wend\n"
+        "    return(x + a / (y - 11) + (-2147483647 - 1) / a);\n"
+        "end function\n";
+
+    // The first row divides by 0 and the last one INT_MIN by -1, both still trap after the folding.
+    const i64 rows[][2] = {
+        { 0, 0 }, { 5, 3 }, { -7, 100 }, { 2147483647, -1 }, { -1, 2 },
+    };
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, source, "f", &propagate_ssa_constants, &rows[0][0], 2, 5));
+}
\ No newline at end of file
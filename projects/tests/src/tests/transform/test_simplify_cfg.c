@@ -0,0 +1,126 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/simplify_cfg.h"
+
+struct SimplifyFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(SimplifyFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(SimplifyFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static const char* const JUMPS_SOURCE =
+    "function f(a as int, b as int) as int\n"
+    "    dim c as int\n"
+    "    while (1)\n"
+    "        if (a > b) then\n"
+    "            break\n"
+    "        end if\n"
+    "        c += a;\n"
+    "        if (c > 100) then\n"
+    "            return(c);\n"
+    "        end if\n"
+    "        ++a;\n"
+    "    wend\n"
+    "    return(a + c);\n"
+    "end function\n";
+
+UTEST_F(SimplifyFixture, removes_jump_blocks) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, JUMPS_SOURCE), CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    const u32 initial_count = cfg_context_get_nodes_count(ctx);
+
+    const u32 removed = simplify_cfg(ctx);
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+    ASSERT_EQ(initial_count - removed, nodes_count);
+    ASSERT_LT(nodes_count * 2, initial_count + 1);
+    ASSERT_EQ(ctx->graph.entry, 0);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+    ASSERT_EQ(rpo_count, nodes_count);
+
+    u32 branches_count = 0;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        ASSERT_EQ(rpo[i], i);
+
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, i);
+        ASSERT_TRUE(terminator != NULL);
+        branches_count += terminator->op == IR_OP_BR;
+
+        // Nothing is left to thread through or to merge.
+        if (terminator->op == IR_OP_JMP) {
+            ASSERT_TRUE(i == 0 || cfg_context_get_node(ctx, i)->instrs_count > 1);
+
+            u32 preds_count = 0;
+            cfg_graph_get_preds(&ctx->graph, terminator->as.target, &preds_count);
+            ASSERT_GT(preds_count, 1);
+        }
+    }
+
+    // The loop condition is constant, only the two ifs still branch.
+    ASSERT_EQ(branches_count, 2);
+    ASSERT_EQ(simplify_cfg(ctx), 0);
+}
+
+UTEST_F(SimplifyFixture, keeps_phis_in_pred_order) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, JUMPS_SOURCE), CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    construct_ssa(ctx);
+    ASSERT_GT(simplify_cfg(ctx), 0);
+
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    u32 phis_count = 0;
+    for (u32 block = 0; block < nodes_count; ++block) {
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(&ctx->graph, block, &preds_count);
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* phi = cfg_context_get_instr(ctx, block, i);
+            if (phi->op != IR_OP_PHI) {
+                break;
+            }
+            ++phis_count;
+
+            ASSERT_EQ(phi->as.phi.count, preds_count);
+            const u32* incoming = ir_function_get_list(&ctx->ir, phi->as.phi.first);
+            for (u32 j = 0; j < preds_count; ++j) {
+                ASSERT_EQ(incoming[j * 2], preds[j]);
+            }
+        }
+    }
+    ASSERT_GT(phis_count, 0);
+
+    destruct_ssa(ctx);
+    ASSERT_FALSE(ctx->ir.is_ssa);
+}
+
+static void simplify_lowered_cfg(CFGContext* ctx) {
+    simplify_cfg(ctx);
+}
+
+static void simplify_ssa_cfg(CFGContext* ctx) {
+    construct_ssa(ctx);
+    simplify_cfg(ctx);
+}
+
+UTEST_F(SimplifyFixture, keeps_results) {
+    const i64 rows[][2] = {
+        { 0, 0 }, { 3, 1 }, { 1, 50 }, { -5, 2 }, { 10, 10 }, { 60, 100 },
+    };
+
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, JUMPS_SOURCE, "f", &simplify_lowered_cfg, &rows[0][0], 2, 6));
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, JUMPS_SOURCE, "f", &simplify_ssa_cfg, &rows[0][0], 2, 6));
+}
\ No newline at end of file
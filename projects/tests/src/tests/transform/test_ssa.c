@@ -0,0 +1,143 @@
+#include "utest/utest.h"
+
+#include "helpers/source_fixture.h"
+#include "vanec/analysis/def_use.h"
+#include "vanec/transform/ssa.h"
+
+struct SSAFixture {
+    SourceFixture source;
+};
+
+UTEST_F_SETUP(SSAFixture) {
+    utest_fixture->source = source_fixture_create(NULL);
+}
+
+UTEST_F_TEARDOWN(SSAFixture) {
+    source_fixture_free(&utest_fixture->source);
+}
+
+static const char* const LOOPS_SOURCE =
+    "function f(a as int, b as int) as int\n"
+    "    dim c, t as int\n"
+    "    while (a > 0)\n"
+    "        if (a % 2 == 0) then\n"
+    "            t = a;\n"
+    "            a = b;\n"
+    "            b = t;\n"
+    "        else\n"
+    "            do\n"
+    "                c += b;\n"
+    "                --b;\n"
+    "            loop until (b < 0)\n"
+    "        end if\n"
+    "        --a;\n"
+    "    wend\n"
+    "    return(a + b + c);\n"
+    "end function\n";
+
+// A definition dominates every use, for a phi it dominates the end of the incoming block.
+static bool is_def_dominating_use(CFGContext* ctx, const DefUseChains* chains, const u32 reg, const u32 use) {
+    const DominatorTree* tree = cfg_context_get_dominator_tree(ctx);
+
+    const u32 def = def_use_chains_get_def(chains, reg);
+    if (def == IR_NULL_REG) {
+        return reg < ctx->ir.params_count;
+    }
+
+    const u32 def_block = def_use_chains_get_block(chains, def);
+    const IRInstr* instr = ir_function_get_instr(&ctx->ir, use);
+
+    if (instr->op == IR_OP_PHI) {
+        const u32* incoming = ir_function_get_list(&ctx->ir, instr->as.phi.first);
+        for (u32 i = 0; i < instr->as.phi.count; ++i) {
+            if (incoming[i * 2 + 1] == reg && !dominates(tree, def_block, incoming[i * 2])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const u32 use_block = def_use_chains_get_block(chains, use);
+    return def_block == use_block ? def < use : dominates(tree, def_block, use_block);
+}
+
+UTEST_F(SSAFixture, single_definition_dominates_uses) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, LOOPS_SOURCE), CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    construct_ssa(ctx);
+    ASSERT_TRUE(ctx->ir.is_ssa);
+
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    u32 phis_count = 0;
+    Vector defs_count = vector_create(regs_count + 1, sizeof(u32), NULL, false);
+    const u32 zero = 0;
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        vector_push_back(&defs_count, &zero);
+    }
+
+    for (u32 block = 0; block < nodes_count; ++block) {
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* instr = cfg_context_get_instr(ctx, block, i);
+            phis_count += instr->op == IR_OP_PHI;
+            if (instr->dst != IR_NULL_REG) {
+                ASSERT_EQ(++((u32*)defs_count.items)[instr->dst], 1);
+            }
+        }
+    }
+    ASSERT_GT(phis_count, 0);
+
+    DefUseChains chains = def_use_chains_create();
+    def_use_chains_build(&chains, ctx);
+
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        u32 uses_count = 0;
+        const u32* uses = def_use_chains_get_uses(&chains, reg, &uses_count);
+        for (u32 i = 0; i < uses_count; ++i) {
+            ASSERT_TRUE(is_def_dominating_use(ctx, &chains, reg, uses[i]));
+        }
+    }
+
+    def_use_chains_free(&chains);
+    vector_free(&defs_count);
+}
+
+UTEST_F(SSAFixture, destruction_removes_phis) {
+    ASSERT_NE(source_fixture_build(&utest_fixture->source, LOOPS_SOURCE), CFG_NULL_NODE);
+
+    CFGContext* ctx = utest_fixture->source.ctx;
+    construct_ssa(ctx);
+    destruct_ssa(ctx);
+    ASSERT_FALSE(ctx->ir.is_ssa);
+
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+    for (u32 block = 0; block < nodes_count; ++block) {
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+        if (!is_cfg_node_reachable(&ctx->graph, block)) {
+            continue;
+        }
+
+        ASSERT_GT(node->instrs_count, 0);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            ASSERT_NE(cfg_context_get_instr(ctx, block, i)->op, IR_OP_PHI);
+        }
+    }
+}
+
+static void construct_and_destruct_ssa(CFGContext* ctx) {
+    construct_ssa(ctx);
+    destruct_ssa(ctx);
+}
+
+UTEST_F(SSAFixture, round_trip_keeps_results) {
+    const i64 rows[][2] = {
+        { 0, 0 }, { 5, 3 }, { 8, -2 }, { 13, 7 }, { -4, 9 }, { 6, 6 },
+    };
+
+    // The phis of the swap are a cycle of parallel copies once destructed.
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, LOOPS_SOURCE, "f", &construct_ssa, &rows[0][0], 2, 6));
+    EXPECT_TRUE(is_source_behavior_preserved(&utest_fixture->source, LOOPS_SOURCE, "f", &construct_and_destruct_ssa, &rows[0][0], 2, 6));
+}
\ No newline at end of file
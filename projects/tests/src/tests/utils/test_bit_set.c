@@ -0,0 +1,49 @@
+#include "utest/utest.h"
+
+#include "vanec/utils/bit_set.h"
+
+UTEST(BitSet, operations) {
+    // Five words, so both the paired and the single word paths are taken.
+    enum { BITS_COUNT = 300, WORDS_COUNT = 5 };
+    ASSERT_EQ(bit_set_get_words_count(BITS_COUNT), WORDS_COUNT);
+
+    u64 a[WORDS_COUNT] = { 0 };
+    u64 b[WORDS_COUNT] = { 0 };
+    u64 c[WORDS_COUNT] = { 0 };
+
+    bit_set_add(a, 0);
+    bit_set_add(a, 130);
+    bit_set_add(a, 299);
+    bit_set_add(b, 130);
+    bit_set_add(b, 257);
+
+    ASSERT_TRUE(bit_set_union(b, a, WORDS_COUNT));
+    ASSERT_FALSE(bit_set_union(b, a, WORDS_COUNT));
+    ASSERT_EQ(bit_set_count(b, WORDS_COUNT), 4);
+
+    ASSERT_TRUE(bit_set_intersect(b, a, WORDS_COUNT));
+    ASSERT_TRUE(bit_set_equals(a, b, WORDS_COUNT));
+
+    // c = {257} | (a & ~{0, 299})
+    u64 gen[WORDS_COUNT] = { 0 };
+    u64 kill[WORDS_COUNT] = { 0 };
+    bit_set_add(gen, 257);
+    bit_set_add(kill, 0);
+    bit_set_add(kill, 299);
+    ASSERT_TRUE(bit_set_transfer(c, a, gen, kill, WORDS_COUNT));
+    ASSERT_FALSE(bit_set_transfer(c, a, gen, kill, WORDS_COUNT));
+
+    ASSERT_EQ(bit_set_next(c, WORDS_COUNT, 0), 130);
+    ASSERT_EQ(bit_set_next(c, WORDS_COUNT, 131), 257);
+    ASSERT_EQ(bit_set_next(c, WORDS_COUNT, 258), BIT_SET_NULL_BIT);
+
+    bit_set_remove(c, 130);
+    ASSERT_FALSE(bit_set_contains(c, 130));
+    ASSERT_TRUE(bit_set_contains(c, 257));
+
+    // A full set stops at its size.
+    bit_set_fill(c, BITS_COUNT, true);
+    ASSERT_EQ(bit_set_count(c, WORDS_COUNT), BITS_COUNT);
+    ASSERT_EQ(bit_set_next(c, WORDS_COUNT, BITS_COUNT - 1), BITS_COUNT - 1);
+    ASSERT_EQ(bit_set_next(c, WORDS_COUNT, BITS_COUNT), BIT_SET_NULL_BIT);
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "utest/utest.h"
+
+#include "vanec/utils/string_builder.h"
+#include "vanec/utils/string_utils.h"
+
+struct StringBuilderFixture {
+    StringBuilder sb;
+};
+
+UTEST_F_SETUP(StringBuilderFixture) {
+    utest_fixture->sb = string_builder_create();
+
+    ASSERT_EQ(string_builder_get_len(&utest_fixture->sb), 0);
+}
+
+UTEST_F_TEARDOWN(StringBuilderFixture) {
+    string_builder_free(&utest_fixture->sb);
+}
+
+UTEST_F(StringBuilderFixture, append_right) {
+    string_builder_append_str_right(&utest_fixture->sb, "ab");
+    string_builder_append_char_right(&utest_fixture->sb, 'c');
+    string_builder_append_str_right(&utest_fixture->sb, "");
+    string_builder_append_format(&utest_fixture->sb, "%d", 42);
+
+    char* str = string_builder_get_str(&utest_fixture->sb);
+    ASSERT_STREQ(str, "abc42");
+    ASSERT_EQ(string_builder_get_len(&utest_fixture->sb), 5);
+    str_free(str);
+}
+
+UTEST_F(StringBuilderFixture, append_left) {
+    string_builder_append_char_left(&utest_fixture->sb, 'c');
+    string_builder_append_str_left(&utest_fixture->sb, "ab");
+    string_builder_append_str_left(&utest_fixture->sb, "");
+
+    char* str = string_builder_get_str(&utest_fixture->sb);
+    ASSERT_STREQ(str, "abc");
+    ASSERT_EQ(string_builder_get_char(&utest_fixture->sb, 0), 'a');
+    str_free(str);
+}
+
+UTEST_F(StringBuilderFixture, append_both_sides) {
+    // Enough appends to regrow the gap in front of the text a few times.
+    for (u32 i = 0; i < 1000; ++i) {
+        string_builder_append_char_left(&utest_fixture->sb, (char)('a' + i % 26));
+        string_builder_append_char_right(&utest_fixture->sb, (char)('A' + i % 26));
+    }
+    string_builder_append_str_left(&utest_fixture->sb, "<<");
+    string_builder_append_str_right(&utest_fixture->sb, ">>");
+
+    ASSERT_EQ(string_builder_get_len(&utest_fixture->sb), 2004);
+
+    char* str = string_builder_get_str(&utest_fixture->sb);
+    ASSERT_EQ(str[0], '<');
+    ASSERT_EQ(str[2], (char)('a' + 999 % 26));
+    ASSERT_EQ(str[1001], 'a');
+    ASSERT_EQ(str[1002], 'A');
+    ASSERT_EQ(str[2001], (char)('A' + 999 % 26));
+    ASSERT_EQ(str[2003], '>');
+    str_free(str);
+}
\ No newline at end of file
@@ -83,6 +83,24 @@ UTEST_F(Vecu8Fixture, push_insert_at_front) {
     ASSERT_EQ(values[7], *(u8*)vector_get_ref(&utest_fixture->vec, 7));
 }
 
+UTEST_F(Vecu8Fixture, resize_and_fill) {
+    u8* items = vector_resize(&utest_fixture->vec, DEFAULT_VECTOR_CAPACITY * 3);
+
+    ASSERT_EQ(items, utest_fixture->vec.items);
+    ASSERT_EQ(utest_fixture->vec.capacity, DEFAULT_VECTOR_CAPACITY * 4);
+    ASSERT_EQ(utest_fixture->vec.items_count, DEFAULT_VECTOR_CAPACITY * 3);
+
+    u8 value = 42;
+    vector_fill(&utest_fixture->vec, &value);
+    ASSERT_EQ(value, *(u8*)vector_get_ref(&utest_fixture->vec, 0));
+    ASSERT_EQ(value, *(u8*)vector_get_ref(&utest_fixture->vec, DEFAULT_VECTOR_CAPACITY * 3 - 1));
+
+    vector_resize(&utest_fixture->vec, 1);
+    ASSERT_EQ(utest_fixture->vec.capacity, DEFAULT_VECTOR_CAPACITY * 4);
+    ASSERT_EQ(utest_fixture->vec.items_count, 1);
+    ASSERT_EQ(value, *(u8*)vector_get_ref(&utest_fixture->vec, 0));
+}
+
 struct Obj {
     u64 a;
     u64 b;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "vanec/analysis/dataflow.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Expressions computed on every path to the start and to the end of every block, a bit per distinct expression.
+// An expression is a unary, binary or compare instruction, identified by its opcode, type and operands,
+// with the operands of commutative opcodes in order. A definition of an operand kills the expression.
+typedef struct {
+    DataflowProblem problem;
+
+    Vector instr_exprs;         // u32 per instruction, the expression or IR_NULL_REG
+    Vector expr_instrs;         // u32 per expression, the first instruction computing it
+    Vector reg_expr_offsets;    // u32, registers count + 1
+    Vector reg_exprs;           // u32, the expressions reading every register
+} AvailableExprs;
+
+AvailableExprs available_exprs_create(void);
+
+void available_exprs_free(AvailableExprs* exprs);
+
+void available_exprs_clear(AvailableExprs* exprs);
+
+void available_exprs_build(AvailableExprs* exprs, const CFGContext* ctx);
+
+u32 available_exprs_get_exprs_count(const AvailableExprs* exprs);
+
+// The expression computed by the instruction, or IR_NULL_REG.
+u32 available_exprs_get_instr_expr(const AvailableExprs* exprs, const u32 instr);
+
+u32 available_exprs_get_expr_instr(const AvailableExprs* exprs, const u32 expr);
+
+bool is_expr_available_in(const AvailableExprs* exprs, const u32 block, const u32 expr);
+
+const u64* available_exprs_get_in(const AvailableExprs* exprs, const u32 block);
+
+const u64* available_exprs_get_out(const AvailableExprs* exprs, const u32 block);
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+#include "vanec/utils/bit_set.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+typedef enum {
+    DATAFLOW_FORWARD,
+    DATAFLOW_BACKWARD,
+} DataflowDirection;
+
+typedef enum {
+    DATAFLOW_UNION,         // may problems, the sets start empty
+    DATAFLOW_INTERSECTION,  // must problems, the sets start full
+} DataflowMeet;
+
+// A gen/kill bit vector problem over the blocks of one function. Forward problems meet the out sets of
+// the preds into the in set of a block and compute out = gen | (in & ~kill), backward problems meet
+// the in sets of the succs into the out set and compute in = gen | (out & ~kill).
+// The entry (forward) and the blocks without succs (backward) meet nothing, their set is empty.
+// The seed of a block is joined into its meet, for facts attached to the edges, like the uses of phis.
+// All the sets of a kind are stored in one array, block after block, and unreachable blocks keep empty sets.
+typedef struct {
+    DataflowDirection direction;
+    DataflowMeet meet;
+
+    u32 nodes_count;
+    u32 bits_count;
+    u32 words_count;        // per set
+
+    Vector in;              // u64
+    Vector out;             // u64
+    Vector gen;             // u64
+    Vector kill;            // u64
+    Vector seed;            // u64
+
+    Vector pending;         // u8 per RPO index
+    u32 visits;             // blocks evaluated by the last solve
+} DataflowProblem;
+
+DataflowProblem dataflow_problem_create(void);
+
+void dataflow_problem_free(DataflowProblem* problem);
+
+void dataflow_problem_clear(DataflowProblem* problem);
+
+// Sizes the sets for the graph and clears the gen, kill and seed sets, which the client fills before solving.
+void dataflow_problem_init(DataflowProblem* problem, const DataflowDirection direction, const DataflowMeet meet, const u32 nodes_count, const u32 bits_count);
+
+u64* dataflow_get_in(const DataflowProblem* problem, const u32 block);
+
+u64* dataflow_get_out(const DataflowProblem* problem, const u32 block);
+
+u64* dataflow_get_gen(const DataflowProblem* problem, const u32 block);
+
+u64* dataflow_get_kill(const DataflowProblem* problem, const u32 block);
+
+u64* dataflow_get_seed(const DataflowProblem* problem, const u32 block);
+
+// Round robin over the RPO (forward) or the post order (backward), only revisiting the blocks
+// whose inputs changed. On reducible graphs this converges in loop nesting depth + 2 passes.
+void dataflow_solve(DataflowProblem* problem, const CFGGraph* graph);
+
+// Numbers the registers read in some reachable block before being defined in it, including the phi operands.
+// Only those can be live across blocks, so the problems about registers use them as their bits,
+// which leaves the temporaries of single blocks out. Returns the number of global registers.
+u32 dataflow_number_global_regs(const CFGContext* ctx, Vector* reg_bits, Vector* bit_regs);
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Def-use chains of a function in SSA form, where every register has at most one definition.
+// The uses of a register are the instructions reading it in CSR form, an instruction reading
+// the register twice is listed twice. The chains are a snapshot, they are rebuilt after the pool changes.
+typedef struct {
+    Vector defs;            // u32 per register, the defining instruction, IR_NULL_REG for parameters and undefined ones
+    Vector use_offsets;     // u32, registers count + 1
+    Vector uses;            // u32, instruction indices
+    Vector instr_blocks;    // u32 per instruction, the owning block
+} DefUseChains;
+
+DefUseChains def_use_chains_create(void);
+
+void def_use_chains_free(DefUseChains* chains);
+
+void def_use_chains_clear(DefUseChains* chains);
+
+void def_use_chains_build(DefUseChains* chains, const CFGContext* ctx);
+
+u32 def_use_chains_get_def(const DefUseChains* chains, const u32 reg);
+
+const u32* def_use_chains_get_uses(const DefUseChains* chains, const u32 reg, u32* count);
+
+u32 def_use_chains_get_block(const DefUseChains* chains, const u32 instr);
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/frontend/cfg/cfg_graph.h"
+
+// Dominator tree of one function, computed with the Lengauer-Tarjan algorithm.
+// The tree is numbered with DFS intervals, so dominance queries are O(1):
+// a dominates b iff pre[a] <= pre[b] and post[b] <= post[a].
+// Unreachable blocks are not part of the tree, their idom is CFG_NULL_NODE and they dominate nothing.
+typedef struct {
+    Vector idom;            // u32 per block, CFG_NULL_NODE for the entry and unreachable blocks
+    Vector depth;           // u32 per block, 0 for the entry
+
+    Vector child_offsets;   // u32, nodes count + 1
+    Vector children;        // u32, in RPO
+
+    Vector preorder;        // u32, reachable blocks in preorder of the tree
+    Vector pre;             // u32 per block
+    Vector post;            // u32 per block
+
+    Vector frontier_offsets;// u32, nodes count + 1
+    Vector frontiers;       // u32
+
+    Vector stack;           // u32, scratch for the build
+    Vector scratch;         // u32, per block arrays of the idom computation
+
+    u32 entry;
+    u32 graph_version;      // version of the graph the tree was built for
+} DominatorTree;
+
+DominatorTree dominator_tree_create(void);
+
+void dominator_tree_free(DominatorTree* tree);
+
+void dominator_tree_clear(DominatorTree* tree);
+
+void dominator_tree_build(DominatorTree* tree, const CFGGraph* graph);
+
+bool is_dominator_tree_valid(const DominatorTree* tree, const CFGGraph* graph);
+
+u32 dominator_tree_get_idom(const DominatorTree* tree, const u32 id);
+
+u32 dominator_tree_get_depth(const DominatorTree* tree, const u32 id);
+
+const u32* dominator_tree_get_children(const DominatorTree* tree, const u32 id, u32* count);
+
+const u32* dominator_tree_get_preorder(const DominatorTree* tree, u32* count);
+
+// Blocks where the dominance of the block ends, the places for its phi nodes.
+const u32* dominator_tree_get_frontier(const DominatorTree* tree, const u32 id, u32* count);
+
+bool dominates(const DominatorTree* tree, const u32 a, const u32 b);
+
+bool strictly_dominates(const DominatorTree* tree, const u32 a, const u32 b);
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "vanec/analysis/dataflow.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Registers live at the start and at the end of every block, a bit per global register.
+// A register is live if it is read on some path before being defined again, which a register
+// only read in the block defining it never is at a block boundary.
+// In SSA form the operands of a phi are live at the end of their incoming block, not at the start of the phi block.
+typedef struct {
+    DataflowProblem problem;
+
+    Vector reg_bits;        // u32 per register, its bit or IR_NULL_REG
+    Vector bit_regs;        // u32 per bit, the register
+} Liveness;
+
+Liveness liveness_create(void);
+
+void liveness_free(Liveness* liveness);
+
+void liveness_clear(Liveness* liveness);
+
+void liveness_build(Liveness* liveness, const CFGContext* ctx);
+
+bool is_live_in(const Liveness* liveness, const u32 block, const u32 reg);
+
+bool is_live_out(const Liveness* liveness, const u32 block, const u32 reg);
+
+// The register of a bit of the live sets.
+u32 liveness_get_bit_reg(const Liveness* liveness, const u32 bit);
+
+const u64* liveness_get_live_in(const Liveness* liveness, const u32 block);
+
+const u64* liveness_get_live_out(const Liveness* liveness, const u32 block);
\ No newline at end of file
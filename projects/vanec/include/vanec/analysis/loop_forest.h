@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/frontend/cfg/cfg_graph.h"
+#include "vanec/analysis/dominator_tree.h"
+
+// Loops are addressed by their index in the forest.
+#define CFG_NULL_LOOP ((u32)-1)
+
+// A natural loop: the header dominates every block of the loop, and every block reaches
+// one of the latches without passing the header. The blocks, latches and exits are ranges
+// of the arrays of the forest.
+typedef struct {
+    u32 header;
+    u32 parent;             // CFG_NULL_LOOP for an outermost loop
+    u32 depth;              // 1 for an outermost loop
+    u32 preheader;          // the only block entering the loop, if it jumps nowhere else, or CFG_NULL_NODE
+    u32 end;                // one past the last subloop in the forest
+
+    u32 blocks_begin;       // the blocks of the loop and of its subloops
+    u32 blocks_count;
+    u32 latches_begin;      // the blocks jumping back to the header
+    u32 latches_count;
+    u32 exits_begin;        // the blocks outside of the loop the loop jumps to
+    u32 exits_count;
+} Loop;
+
+// Loop-nest forest of one function, found from the back edges of the dominator tree.
+// The loops are stored in preorder of the forest, so a loop contains exactly the loops
+// in [index, end), and the blocks of the innermost loops come last in every range.
+typedef struct {
+    Vector loops;           // Loop
+    Vector block_loops;     // u32 per block, the innermost loop or CFG_NULL_LOOP
+    Vector blocks;          // u32
+    Vector latches;         // u32
+    Vector exits;           // u32
+
+    Vector scratch;         // u32, scratch for the build
+    Vector stack;           // u32, scratch for the build
+
+    u32 entry;
+    u32 graph_version;      // version of the graph the forest was built for
+} LoopForest;
+
+LoopForest loop_forest_create(void);
+
+void loop_forest_free(LoopForest* forest);
+
+void loop_forest_clear(LoopForest* forest);
+
+void loop_forest_build(LoopForest* forest, const CFGGraph* graph, const DominatorTree* tree);
+
+bool is_loop_forest_valid(const LoopForest* forest, const CFGGraph* graph);
+
+u32 loop_forest_get_loops_count(const LoopForest* forest);
+
+const Loop* loop_forest_get_loop(const LoopForest* forest, const u32 loop);
+
+// The innermost loop of the block, CFG_NULL_LOOP outside of all loops.
+u32 loop_forest_get_block_loop(const LoopForest* forest, const u32 block);
+
+// The number of loops around the block, 0 outside of all loops.
+u32 loop_forest_get_block_depth(const LoopForest* forest, const u32 block);
+
+const u32* loop_forest_get_blocks(const LoopForest* forest, const u32 loop, u32* count);
+
+const u32* loop_forest_get_latches(const LoopForest* forest, const u32 loop, u32* count);
+
+const u32* loop_forest_get_exits(const LoopForest* forest, const u32 loop, u32* count);
+
+bool loop_contains_loop(const LoopForest* forest, const u32 outer, const u32 inner);
+
+bool loop_contains_block(const LoopForest* forest, const u32 loop, const u32 block);
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "vanec/analysis/dataflow.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Definitions reaching the start and the end of every block, a bit per instruction defining a global register.
+// A definition reaches a point if some path leads from it to the point without another definition
+// of its register. The definitions of registers only read in their own block are left out,
+// they can not reach a use in another block. The parameters are not definitions.
+typedef struct {
+    DataflowProblem problem;
+
+    Vector def_instrs;          // u32 per definition, the instruction
+    Vector instr_defs;          // u32 per instruction, the definition or IR_NULL_REG
+    Vector reg_def_offsets;     // u32, registers count + 1
+    Vector reg_defs;            // u32, the definitions of every register
+    Vector reg_bits;            // u32 per register, scratch for the global registers
+    Vector bit_regs;            // u32, scratch for the global registers
+} ReachingDefs;
+
+ReachingDefs reaching_defs_create(void);
+
+void reaching_defs_free(ReachingDefs* defs);
+
+void reaching_defs_clear(ReachingDefs* defs);
+
+void reaching_defs_build(ReachingDefs* defs, const CFGContext* ctx);
+
+u32 reaching_defs_get_defs_count(const ReachingDefs* defs);
+
+u32 reaching_defs_get_def_instr(const ReachingDefs* defs, const u32 def);
+
+u32 reaching_defs_get_instr_def(const ReachingDefs* defs, const u32 instr);
+
+const u32* reaching_defs_get_reg_defs(const ReachingDefs* defs, const u32 reg, u32* count);
+
+bool does_def_reach_block(const ReachingDefs* defs, const u32 def, const u32 block);
+
+const u64* reaching_defs_get_in(const ReachingDefs* defs, const u32 block);
+
+const u64* reaching_defs_get_out(const ReachingDefs* defs, const u32 block);
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "vanec/backend/bytecode.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Compiles the IR of one function, in SSA form or not, into a new function of the module.
+// Every virtual register gets its own slot of the frame, the blocks are laid out in reverse post-order,
+// so jumps to the next block fall through, and the phis become copies on the incoming edges.
+// Returns the index of the function or BC_NULL_FUNCTION when its registers do not fit into the 16 bit operands.
+u32 compile_bytecode_function(BCModule* module, const CFGContext* ctx, const char* name, const SourceLoc loc);
\ No newline at end of file
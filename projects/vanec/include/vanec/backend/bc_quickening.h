@@ -0,0 +1,9 @@
+#pragma once
+
+#include "vanec/backend/bytecode.h"
+
+// Rewrites the code of a function for the interpreter. Every sequence with a superinstruction gets it in place of its
+// first instruction, the longest one first, and the arithmetic left over gets the variant quickened for its width.
+// The function computes the same but dispatches fewer and cheaper instructions. Only the opcodes change, so it is done
+// once, on the code as it was compiled, before or after linking.
+void quicken_bytecode_function(BCFunction* func);
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/diagnostic/diagnostic.h"
+
+#include "vanec/ir/ir_instr.h"
+
+#define BC_NULL_REG ((u16)-1)
+#define BC_NULL_FUNCTION ((u32)-1)
+#define BC_MAX_REGS_COUNT ((u32)BC_NULL_REG)
+
+// Packs the 32 bit payload of constants, jumps and calls into the b and c operands.
+#define BC_INSTR_INDEX(instr) ((u32)(instr)->b | ((u32)(instr)->c << 16))
+// The payload of a constant, sign extended from 32 bits.
+#define BC_INSTR_IMM(instr) ((i64)(BC_INSTR_INDEX(instr) ^ 0x80000000u) - (i64)0x80000000)
+
+typedef enum {
+#define BC_OPCODE(ID, NAME) BC_OP_##ID,
+#include "vanec/backend/bytecode.def"
+    BC_OPCODES_COUNT,
+} BCOpcode;
+
+typedef enum {
+#define BC_NATIVE(ID, NAME) BC_NATIVE_##ID,
+#include "vanec/backend/bytecode.def"
+    BC_NATIVES_COUNT,
+} BCNative;
+
+// A fixed 8 byte instruction of a register machine, the registers are 16 bit slot indices of the frame.
+typedef struct {
+    u8 op;
+    u8 type;            // IRType
+    u16 a;
+    u16 b;
+    u16 c;
+} BCInstr;
+
+typedef struct {
+    u32 callee;         // a symbol until the module is linked, then a function or a native
+    u32 first;          // index into the call args of the function
+    u32 count;
+} BCCall;
+
+typedef struct {
+    char* name;
+    SourceLoc loc;
+
+    Vector code;        // BCInstr
+    Vector constants;   // i64, the ones that do not fit into 32 bits
+    Vector calls;       // BCCall
+    Vector call_args;   // u16, registers
+    Vector reg_types;   // u8, IRType per register, the arguments are converted to the ones of the parameters on the call
+
+    u32 params_count;   // the first registers are the parameters
+    u32 frame_size;     // registers count
+    IRType ret_type;
+} BCFunction;
+
+// The functions of a program, compiled one at a time and linked once all of them are known.
+// Calls name their callee by a symbol, the linker resolves it to a function or a native.
+typedef struct {
+    Vector functions;   // BCFunction
+    Vector strings;     // char*
+    Vector symbols;     // char*
+
+    DiagnosticEngine* diag;
+    bool is_linked;
+} BCModule;
+
+const char* get_bc_opcode_name(const BCOpcode op);
+
+const char* get_bc_native_name(const BCNative native);
+
+// Returns the superinstruction that runs the sequence or BC_OP_NOP when there is none.
+BCOpcode get_bc_fused_opcode(const BCOpcode* ops, const u32 count);
+
+// Returns the variant of the opcode quickened for the type or the opcode itself when there is none.
+BCOpcode get_bc_quick_opcode(const BCOpcode op, const IRType type);
+
+// Returns the opcode a superinstruction starts with or a quickened one stands for, the others are returned as they are.
+// The operands of the instruction are the ones of that opcode.
+BCOpcode get_bc_base_opcode(const BCOpcode op);
+
+bool is_bc_opcode_quick(const BCOpcode op);
+
+BCModule bc_module_create(DiagnosticEngine* diag);
+
+void bc_module_free(BCModule* module);
+
+void bc_module_clear(BCModule* module);
+
+// Appends an empty function, the pointer is invalidated by the next one.
+BCFunction* bc_module_add_function(BCModule* module, const char* name, const SourceLoc loc);
+
+BCFunction* bc_module_get_function(const BCModule* module, const u32 index);
+
+u32 bc_module_get_functions_count(const BCModule* module);
+
+// Returns BC_NULL_FUNCTION when there is no function with the name.
+u32 bc_module_find_function(const BCModule* module, const char* name);
+
+u32 bc_module_add_string(BCModule* module, const char* s);
+
+const char* bc_module_get_string(const BCModule* module, const u32 index);
+
+// Returns the index of the symbol, equal names share it.
+u32 bc_module_add_symbol(BCModule* module, const char* name);
+
+// Resolves the callees of all the calls, functions of the module come before natives of the same name.
+// Reports the unresolved ones and returns false if there were any.
+bool bc_module_link(BCModule* module);
+
+void print_bc_function(FILE* handle, const BCModule* module, const BCFunction* func);
\ No newline at end of file
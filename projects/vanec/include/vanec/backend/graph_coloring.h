@@ -0,0 +1,14 @@
+#pragma once
+
+#include "vanec/backend/reg_alloc.h"
+
+// Iterated register coalescing of George and Appel over the whole intervals, without splitting them. The interference
+// graph is kept both as a bit matrix, for the membership tests, and as adjacency lists, for the walks over the
+// neighbors. Simplification, conservative coalescing of the copies and the phi operands (Briggs, or George against
+// the precolored nodes), freezing and potential spills are interleaved until the graph is empty, then the colors are
+// assigned in the reverse order. The target registers are the precolored nodes, the intervals live across a call
+// interfere with the ones the calls clobber. A spill costs its uses weighted by the loop depth over its degree.
+// The operands can be in memory, so the spilled registers are not rewritten: they go to the slots the spilled
+// neighbors leave free and the graph is colored once. The functions with too many registers for the bit matrix
+// fall back to the linear scan.
+void allocate_registers_graph_coloring(RegAllocation* allocation, LiveIntervals* intervals, const RegAllocTarget* target);
\ No newline at end of file
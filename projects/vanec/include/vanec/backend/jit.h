@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vanec/backend/vm.h"
+
+#define JIT_DEFAULT_THRESHOLD ((u32)1000)             // calls
+#define JIT_DEFAULT_CODE_CAPACITY ((u64)(4 * MB))
+
+// The state shared by the native code and the runtime, the code reaches it through a register at fixed offsets.
+typedef struct {
+    VM* vm;
+    const i64* stack_end;
+    u64 entry_rsp;          // the native stack of the innermost entry from C, the traps unwind to it
+    u32 depth;              // the frames below the running one, interpreted and native alike
+    u32 max_frames;
+    u32 status;             // VMStatus
+    u32 fault_function;
+} JITContext;
+
+// A baseline template compiler from the bytecode of a linked module to x86-64 machine code. Every instruction
+// becomes a fixed sequence over the slots of the frame, so the native code runs on the stack of the VM and the
+// interpreter and the native code call each other freely. A function tiers up once it has been called 'threshold'
+// times. Its calls to the functions still interpreted go through a bridge, which patches the call site once the
+// callee has native code too. The code pages are never writable and executable at the same time.
+// Functions that can not be compiled, on hosts other than x86-64 or when the code pages are full, stay interpreted.
+struct JIT {
+    const BCModule* module;
+
+    u8* memory;             // the code pages, executable but not writable outside of jit_compile_function
+    u64 capacity;
+    u64 size;
+
+    const u8* entry;        // the stubs shared by all the functions, at the start of the pages
+    const u8* bridge;
+    const u8* unwind;
+
+    const u8** functions;   // the native code of every function of the module, NULL while it is interpreted
+    u32* call_counts;
+    bool* is_rejected;      // the functions left to the interpreter for good
+
+    u32 threshold;
+    u32 compiled_count;
+    JITContext context;
+};
+
+// Whether the host runs the native code, when it does not the functions stay interpreted.
+bool is_jit_supported(void);
+
+// The module must be linked. A threshold of 0 compiles the functions on their first call, like 1 does.
+JIT jit_create(const BCModule* module, const u32 threshold, const u64 capacity);
+
+void jit_free(JIT* jit);
+
+// Compiles a function, returns false when it is left to the interpreter.
+bool jit_compile_function(JIT* jit, const u32 func);
+
+// Counts a call of the function, compiles it once it reaches the threshold.
+// Returns whether the call runs native code.
+bool jit_tier_up(JIT* jit, const u32 func);
+
+// Runs the native code of a function over a frame its caller has already filled. 'depth' is the number of frames
+// below it. On a runtime error the fault function of the VM is set and the result is left unchanged.
+VMStatus jit_run(JIT* jit, VM* vm, const u32 func, i64* base, const u32 depth, i64* result);
\ No newline at end of file
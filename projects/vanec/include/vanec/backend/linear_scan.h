@@ -0,0 +1,13 @@
+#pragma once
+
+#include "vanec/backend/reg_alloc.h"
+
+// Linear scan over the live intervals in the order of their starts, with interval splitting. An interval gets
+// the register that is free the longest, its hint first, and is split where that register stops being free.
+// When none is free, the intervals whose next use is the farthest go to a spill slot up to that use, where
+// they are split again and come back for a register. The intervals live across a call never get the registers
+// the calls clobber. A register's spill slot is shared by all its pieces and reused once the register is dead.
+// The intervals are split in place, and at the end of a window of positions so that a long interval is only
+// compared with the others near the position. The cost is about linear in the number of intervals and their
+// ranges, times the number of registers.
+void allocate_registers_linear_scan(RegAllocation* allocation, LiveIntervals* intervals, const RegAllocTarget* target);
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "vanec/analysis/liveness.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+#define LIVE_NULL_INDEX ((u32)-1)
+#define LIVE_MAX_POSITION ((u32)-1)
+
+// The instructions are numbered in the reverse post-order of the blocks, every one gets four positions:
+// its operands are read at the first one, calls clobber registers at the second one and the result is written
+// at the third one. So the operands and the result of an instruction never overlap, but a register live across
+// a call always covers its clobber position. Intervals are only split between instructions.
+#define LIVE_POSITIONS_PER_INSTR 4
+
+static inline u32 get_live_use_position(const u32 index) {
+    return index * LIVE_POSITIONS_PER_INSTR;
+}
+
+static inline u32 get_live_clobber_position(const u32 index) {
+    return index * LIVE_POSITIONS_PER_INSTR + 1;
+}
+
+static inline u32 get_live_def_position(const u32 index) {
+    return index * LIVE_POSITIONS_PER_INSTR + 2;
+}
+
+// The boundary between instructions at or before a position.
+static inline u32 get_live_boundary_position(const u32 position) {
+    return position - position % LIVE_POSITIONS_PER_INSTR;
+}
+
+// The positions [from, to).
+typedef struct {
+    u32 from;
+    u32 to;
+    u32 next;           // of the same interval, LIVE_NULL_INDEX for the last one
+} LiveRange;
+
+typedef struct {
+    u32 position;
+    u32 next;
+} LiveUse;
+
+// The positions a register is live at, with lifetime holes between the ranges, and the positions it is read at.
+typedef struct {
+    u32 reg;
+    u32 first_range;    // LIVE_NULL_INDEX when the register is never live
+    u32 first_use;
+    u32 start;          // the from of the first range
+    u32 end;            // the to of the last range
+    u32 hint;           // a register it is copied from or into, IR_NULL_REG
+} LiveInterval;
+
+// A copy between two registers, or a phi operand read on an edge, at the use position it is read at.
+typedef struct {
+    u32 dst;
+    u32 src;
+    u32 position;
+} LiveCopy;
+
+// The live intervals of the registers of one function, built from the liveness of the blocks in a single
+// backward pass over the instructions. Allocators split them in place: the intervals of the registers come
+// first, indexed by the register, and the split children are appended after them.
+typedef struct {
+    Liveness liveness;
+
+    Vector intervals;       // LiveInterval
+    Vector ranges;          // LiveRange
+    Vector uses;            // LiveUse
+    Vector block_starts;    // u32 per block, the position of its first instruction, LIVE_MAX_POSITION for unreachable ones
+    Vector block_ends;      // u32 per block
+    Vector is_block_first;  // bool per laid out instruction
+    Vector calls;           // u32, the clobber positions of the calls in increasing order
+    Vector copies;          // LiveCopy, in the order of the layout
+    Vector loop_depths;     // u32 per laid out instruction, the jumps back over it
+
+    u32 regs_count;
+    u32 instrs_count;       // laid out
+} LiveIntervals;
+
+LiveIntervals live_intervals_create(void);
+
+void live_intervals_free(LiveIntervals* intervals);
+
+void live_intervals_clear(LiveIntervals* intervals);
+
+void live_intervals_build(LiveIntervals* intervals, const CFGContext* ctx);
+
+u32 live_intervals_get_count(const LiveIntervals* intervals);
+
+LiveInterval* live_intervals_get(const LiveIntervals* intervals, const u32 index);
+
+const LiveRange* live_intervals_get_range(const LiveIntervals* intervals, const u32 range);
+
+const LiveUse* live_intervals_get_use(const LiveIntervals* intervals, const u32 use);
+
+u32 live_intervals_get_block_start(const LiveIntervals* intervals, const u32 block);
+
+u32 live_intervals_get_block_end(const LiveIntervals* intervals, const u32 block);
+
+bool is_live_block_start(const LiveIntervals* intervals, const u32 position);
+
+// The number of jumps of the layout going back over the position, the loop depth of structured code.
+u32 get_live_loop_depth(const LiveIntervals* intervals, const u32 position);
+
+bool is_live_interval_covering(const LiveIntervals* intervals, const u32 interval, const u32 position);
+
+// The first position both intervals cover, LIVE_MAX_POSITION when they do not intersect.
+u32 get_live_intervals_intersection(const LiveIntervals* intervals, const u32 lhs, const u32 rhs);
+
+// The first use at or after the position, LIVE_MAX_POSITION when there is none.
+u32 get_live_interval_next_use(const LiveIntervals* intervals, const u32 interval, const u32 position);
+
+// The first clobber position of a call the interval covers in the positions [from, to), LIVE_MAX_POSITION when there is none.
+u32 get_live_interval_next_call(const LiveIntervals* intervals, const u32 interval, const u32 from, const u32 to);
+
+// Moves the ranges and the uses at and after the position into a new interval and returns it.
+// The position must be past the start of the interval and before its end.
+u32 split_live_interval(LiveIntervals* intervals, const u32 interval, const u32 position);
\ No newline at end of file
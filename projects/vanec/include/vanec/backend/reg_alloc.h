@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vanec/backend/live_intervals.h"
+
+#define REG_ALLOC_MAX_REGS 64
+
+// The allocators of the tiers: the linear scan is fast, the graph coloring spends more time on fewer copies and spills.
+typedef enum {
+    REG_ALLOCATOR_LINEAR_SCAN,
+    REG_ALLOCATOR_GRAPH_COLORING,
+} RegAllocator;
+
+// The registers an allocator hands out, numbered from 0 in the order it prefers them.
+typedef struct {
+    u32 regs_count;
+    u64 caller_saved;       // a bit per register the calls clobber
+} RegAllocTarget;
+
+typedef enum {
+    REG_ALLOC_REGISTER,
+    REG_ALLOC_SLOT,
+} RegAllocLocationKind;
+
+typedef struct {
+    RegAllocLocationKind kind;
+    u32 index;              // of the register of the target or of the spill slot
+} RegAllocLocation;
+
+// A part of the lifetime of a register in one location, up to the start of its next piece.
+typedef struct {
+    u32 reg;
+    u32 start;
+    RegAllocLocation location;
+} RegAllocPiece;
+
+// A value moved between two pieces of its register before the instruction at the position.
+typedef struct {
+    u32 position;
+    u32 reg;
+    RegAllocLocation from;
+    RegAllocLocation to;
+} RegAllocMove;
+
+// Where every register of a function lives, whichever allocator produced it.
+typedef struct {
+    Vector pieces;          // RegAllocPiece, by register and then by start
+    Vector first_pieces;    // u32 per register and one past the last, the pieces of a register are contiguous
+
+    u32 slots_count;
+    u64 used_regs;          // a bit per register of the target some piece got
+    u32 spilled_count;      // the pieces in spill slots
+    u32 split_count;        // the pieces past the first one of their register
+} RegAllocation;
+
+RegAllocation reg_allocation_create(void);
+
+void reg_allocation_free(RegAllocation* allocation);
+
+void reg_allocation_clear(RegAllocation* allocation);
+
+bool is_same_reg_alloc_location(const RegAllocLocation lhs, const RegAllocLocation rhs);
+
+// Collects the locations the allocator gave to the intervals, one per interval, into the pieces of the registers.
+void reg_allocation_build(RegAllocation* allocation, const LiveIntervals* intervals, const RegAllocLocation* locations, const u32 slots_count);
+
+// Whether the register is live anywhere, the others have no location.
+bool is_reg_allocated(const RegAllocation* allocation, const u32 reg);
+
+// The location of a register at a position it is live at.
+RegAllocLocation reg_allocation_get_location(const RegAllocation* allocation, const u32 reg, const u32 position);
+
+// The moves of the splits inside the blocks, by position. The ones at the starts of the blocks are left
+// to the edges, which also move the values of the phis.
+void reg_allocation_collect_split_moves(const RegAllocation* allocation, const LiveIntervals* intervals, Vector* moves);
\ No newline at end of file
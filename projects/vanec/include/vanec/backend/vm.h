@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "vanec/backend/bytecode.h"
+
+#define VM_DEFAULT_STACK_SIZE ((u32)(256 * KB))  // slots
+#define VM_DEFAULT_MAX_FRAMES ((u32)(16 * KB))
+
+typedef struct JIT JIT;
+
+typedef enum {
+    VM_STATUS_OK = 0,
+    VM_STATUS_DIVISION_BY_ZERO,
+    VM_STATUS_DIVISION_OVERFLOW,
+    VM_STATUS_INDEX_OUT_OF_RANGE,
+    VM_STATUS_STACK_OVERFLOW,
+} VMStatus;
+
+// The value of an array register points to one, a zero value is an empty array.
+typedef struct {
+    i64* items;
+    u64 count;
+} VMArray;
+
+// Counts the executed opcodes and the sequences of two and three of them in the order of execution,
+// the trace goes on across calls, returns and runs. The candidates for superinstructions are the most frequent sequences.
+typedef struct {
+    u64 counts[BC_OPCODES_COUNT];
+    u64* pairs;         // BC_OPCODES_COUNT^2, indexed by the first opcode
+    u64* triples;       // BC_OPCODES_COUNT^3
+    u8 last[2];         // the two previous opcodes, the latest one first
+    u32 trace_length;   // saturates at 2
+} VMProfile;
+
+// The state of a caller, saved while its callee runs.
+typedef struct {
+    const BCFunction* func;
+    const BCInstr* ret_pc;
+    i64* base;
+    u16 dst;
+    u8 type;
+} VMFrame;
+
+// Runs the functions of a linked module. The frames of all the active calls are contiguous windows of one
+// flat slot stack, a callee starts right past the slots of its caller, so a call copies nothing but the arguments.
+typedef struct {
+    const BCModule* module;
+    FILE* out;          // where the natives print
+
+    i64* stack;
+    u32 stack_size;
+    VMFrame* frames;
+    u32 max_frames;
+
+    u64 executed_count; // the instructions dispatched, summed over all the runs
+    VMProfile* profile; // the runs record their dispatches into it when it is not NULL
+    JIT* jit;           // the calls tier up to native code through it when it is not NULL
+    VMStatus status;
+    const BCFunction* fault_function;
+} VM;
+
+VM vm_create(const BCModule* module, FILE* out, const u32 stack_size, const u32 max_frames);
+
+void vm_free(VM* vm);
+
+const char* get_vm_status_text(const VMStatus status);
+
+// Runs a function of the module to its return. The arguments are converted to the types of the parameters,
+// the missing ones are zero. On a runtime error the status is returned and the result is left unchanged.
+VMStatus vm_call(VM* vm, const u32 func, const i64* args, const u32 count, i64* result);
+
+// Interprets a function over a frame its caller has already filled, the arguments converted and the rest zeroed.
+// The frames of its calls are recorded from 'first_depth' on. It is how the native code falls back to the interpreter.
+VMStatus vm_run_frame(VM* vm, const u32 func, i64* base, const u32 first_depth, i64* result);
+
+// Calls the native of a CALL_NATIVE instruction of the function with the arguments in the slots of the frame.
+i64 vm_call_native(VM* vm, const BCFunction* func, const BCInstr* instr, const i64* base);
+
+VMProfile vm_profile_create(void);
+
+void vm_profile_free(VMProfile* profile);
+
+// Prints the most frequent opcodes, pairs and triples, each with its share of all the dispatches.
+void print_vm_profile(FILE* handle, const VMProfile* profile, const u32 top_count);
\ No newline at end of file
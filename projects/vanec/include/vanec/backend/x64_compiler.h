@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "vanec/utils/string_builder.h"
+
+#include "vanec/diagnostic/diagnostic.h"
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+#include "vanec/backend/live_intervals.h"
+#include "vanec/backend/reg_alloc.h"
+
+// A function of the program, known before any of them is compiled, so a call knows its callee.
+typedef struct {
+    char* name;
+    u32 params_count;
+} X64Declaration;
+
+// The x86-64 assembly of a program for the System V ABI, in the AT&T syntax of GNU as.
+// The functions are named 'vane_<name>', so they never clash with the C library, and are called like C functions
+// of 64 bit integer arguments. The natives become calls of printf from the C library, their formats are rewritten
+// for the types of the arguments, so they print what the interpreter prints.
+typedef struct {
+    StringBuilder text;         // the compiled functions
+    Vector strings;             // char*, the literals of .rodata
+    Vector declarations;        // X64Declaration
+    u32 functions_count;        // the compiled ones, their local labels are numbered by it
+
+    LiveIntervals intervals;    // of the function being compiled, the pools are kept between functions
+    RegAllocation allocation;
+
+    DiagnosticEngine* diag;
+} X64Module;
+
+X64Module x64_module_create(DiagnosticEngine* diag);
+
+void x64_module_free(X64Module* module);
+
+void x64_module_declare_function(X64Module* module, const char* name, const u32 params_count);
+
+// Returns NULL when there is no function with the name.
+const X64Declaration* x64_module_find_declaration(const X64Module* module, const char* name);
+
+// Compiles the IR of one function, in SSA form or not, into the text of the module.
+// The virtual registers live in the registers the allocator gives them or in spill slots of the native frame,
+// rax, rcx and rdx are left as scratch registers for the instructions. The blocks are laid out in reverse post-order
+// and the phis and the splits of the intervals become parallel copies on the edges and between the instructions.
+// Returns false and reports calls of undeclared functions.
+bool compile_x64_function(X64Module* module, const CFGContext* ctx, const char* name, const SourceLoc loc, const RegAllocator allocator);
+
+// Writes the functions, the runtime and the literals as one file. The runtime is a C 'main' that calls the one
+// of the program with an empty array and a trap that prints the runtime errors like the interpreter and exits.
+void write_x64_module(FILE* handle, const X64Module* module);
\ No newline at end of file
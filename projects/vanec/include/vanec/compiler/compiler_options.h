@@ -8,15 +8,32 @@ typedef enum {
     COMPILER_COMMAND_LEX_ONLY       = 1,
     COMPILER_COMMAND_PARSE_AST_ONLY = 2,
     COMPILER_COMMAND_BUILD_CFG_ONLY = 3,
+    COMPILER_COMMAND_BUILD_IR_ONLY  = 4,
+    COMPILER_COMMAND_RUN            = 5,
+    COMPILER_COMMAND_COMPILE        = 6,
 } CompilerCommand;
 
+typedef enum {
+    COMPILER_OPT_LEVEL_NONE     = 0,
+    COMPILER_OPT_LEVEL_PASSES   = 1,    // the passes on the cfg and the ir, the quickened bytecode
+    COMPILER_OPT_LEVEL_FULL     = 2,    // also the graph coloring register allocator for the native code
+} CompilerOptLevel;
+
 typedef struct {
     Vector files;
     char* output_dir;
+    char* trace_filepath;
     
     u64 stream_chunk_capacity;
     bool output_ast;
     bool output_cfg;
+    bool time_report;
+    bool output_ssa;
+    CompilerOptLevel opt_level;
+    bool output_bytecode;
+    bool profile_vm;
+    bool jit;
+    u32 jit_threshold;
 
     CompilerCommand command;
 } CompilerOptions;
@@ -54,6 +54,7 @@ struct ASTConditionStmtData {
 struct ASTLoopStmtData {
     ASTNode* expr;
     Vector stmts;
+    bool is_until;  // 'loop until' exits when the expression is true
 };
 
 struct ASTReturnData {
@@ -22,6 +22,9 @@ const Token* ast_parser_expect_next(ASTParser* parser, const bool consume, bool
 
 void ast_parser_skip_to_the_end_of_a_file(ASTParser* parser);
 
+// Drops the tokens of already parsed items, the returned nodes own copies of everything they need.
+void ast_parser_release_consumed_tokens(ASTParser* parser);
+
 ASTNode* ast_parser_parse_ast_funcdef_node(ASTParser* parser);
 
 ASTNode* ast_parser_parse_ast_identifier_node(ASTParser* parser);
@@ -4,22 +4,23 @@
 #include "vanec/frontend/cfg/cfg_node.h"
 #include "vanec/frontend/cfg/cfg_context.h"
 
-CFGNode* build_cfg_for_function(CFGContext* ctx, const ASTNode* ast);
+// Returns the id of the function entry node or CFG_NULL_NODE on failure.
+u32 build_cfg_for_function(CFGContext* ctx, const ASTNode* ast);
 
-bool build_cfg_for_statements_block(CFGContext* ctx, const Vector* block, CFGNode** first, CFGNode** last);
+bool build_cfg_for_statements_block(CFGContext* ctx, const Vector* block, u32* first, u32* last);
 
-bool build_cfg_for_statement(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool build_cfg_for_statement(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool prepare_basic_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool prepare_basic_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool prepare_condition_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool prepare_condition_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool prepare_while_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool prepare_while_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool prepare_do_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool prepare_do_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool handle_break_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool handle_break_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool handle_continue_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
+bool handle_continue_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
 
-bool handle_return_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last);
\ No newline at end of file
+bool handle_return_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last);
\ No newline at end of file
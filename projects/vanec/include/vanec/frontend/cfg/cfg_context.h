@@ -4,14 +4,32 @@
 
 #include "vanec/diagnostic/diagnostic.h"
 
+#include "vanec/ir/ir_function.h"
+
 #include "vanec/frontend/cfg/cfg_node.h"
 #include "vanec/frontend/cfg/cfg_scope.h"
+#include "vanec/frontend/cfg/cfg_graph.h"
+
+#include "vanec/analysis/dominator_tree.h"
+#include "vanec/analysis/loop_forest.h"
 
+// Owns every node and scope of one function in two contiguous pools.
+// cfg_context_clear keeps the pools' memory, so a single context is meant to be reused
+// for all the functions of a file without any per node heap traffic.
+// Pointers returned by the getters are invalidated by the next node or scope creation.
 typedef struct {
     Vector scopes;
     Vector nodes;
+    Vector symbols;
+
+    IRFunction ir;
+    CFGGraph graph;
 
-    CFGScope* curr_scope;
+    // Analyses are computed on first use and kept until the graph changes.
+    DominatorTree dom_tree;
+    LoopForest loops;
+
+    u32 curr_scope;
     DiagnosticEngine* diag;
 } CFGContext;
 
@@ -25,4 +43,33 @@ void cfg_context_enter_scope(CFGContext* ctx, const CFGScopeKind kind);
 
 void cfg_context_leave_scope(CFGContext* ctx);
 
-CFGNode* cfg_context_create_cfg_node(CFGContext* ctx, const CFGNodeKind kind);
\ No newline at end of file
+u32 cfg_context_create_cfg_node(CFGContext* ctx, const CFGNodeKind kind);
+
+CFGNode* cfg_context_get_node(const CFGContext* ctx, const u32 id);
+
+CFGScope* cfg_context_get_scope(const CFGContext* ctx, const u32 id);
+
+CFGScope* cfg_context_get_curr_scope(const CFGContext* ctx);
+
+u32 cfg_context_get_nodes_count(const CFGContext* ctx);
+
+// Appends an instruction to the block. A block is filled in one go, while it is the last one being built.
+void cfg_context_emit_instr(CFGContext* ctx, const u32 block, const IRInstr* instr);
+
+IRInstr* cfg_context_get_instr(const CFGContext* ctx, const u32 block, const u32 index);
+
+IRInstr* cfg_context_get_terminator(const CFGContext* ctx, const u32 block);
+
+void cfg_context_declare_symbol(CFGContext* ctx, const char* name, const u32 reg);
+
+// Returns the register of the innermost visible symbol or IR_NULL_REG.
+u32 cfg_context_find_symbol(const CFGContext* ctx, const char* name);
+
+// Recomputes the edge lists and the orders from the terminators of all the blocks.
+void cfg_context_build_graph(CFGContext* ctx, const u32 entry);
+
+const DominatorTree* cfg_context_get_dominator_tree(CFGContext* ctx);
+
+const LoopForest* cfg_context_get_loop_forest(CFGContext* ctx);
+
+u32 chain_cfg_nodes(CFGContext* ctx, const u32 prev, const u32 next);
\ No newline at end of file
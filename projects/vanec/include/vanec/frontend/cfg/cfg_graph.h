@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/ir/ir_function.h"
+
+#include "vanec/frontend/cfg/cfg_node.h"
+
+// Successor and predecessor lists of one function in CSR form, derived from the block terminators,
+// so no traversal has to know the kind specific payloads of the nodes.
+// The successors of a block are succs[succ_offsets[id] .. succ_offsets[id + 1]) in terminator order,
+// the predecessors are laid out the same way. Post-order and RPO only cover the blocks reachable from the entry.
+typedef struct {
+    Vector succ_offsets;    // u32, nodes count + 1
+    Vector succs;           // u32
+    Vector pred_offsets;    // u32, nodes count + 1
+    Vector preds;           // u32
+    Vector succ_pred_index; // u32 per successor edge, the position of the edge among the predecessors of its target
+
+    Vector post_order;      // u32, reachable blocks
+    Vector rpo;             // u32, reachable blocks
+    Vector rpo_index;       // u32 per block, CFG_NULL_NODE for unreachable ones
+
+    Vector marks;           // u32 per block, the epoch of the last visit
+    Vector stack;           // u32 pairs of block and next successor, scratch for the depth first search
+    u32 epoch;
+
+    u32 entry;
+    u32 version;            // bumped by every build, never reset, so cached analyses can detect stale graphs
+} CFGGraph;
+
+CFGGraph cfg_graph_create(void);
+
+void cfg_graph_free(CFGGraph* graph);
+
+void cfg_graph_clear(CFGGraph* graph);
+
+// Has to be called again whenever a terminator is changed.
+void cfg_graph_build(CFGGraph* graph, const CFGNode* nodes, const u32 nodes_count, const IRFunction* ir, const u32 entry);
+
+u32 cfg_graph_get_nodes_count(const CFGGraph* graph);
+
+const u32* cfg_graph_get_succs(const CFGGraph* graph, const u32 id, u32* count);
+
+const u32* cfg_graph_get_preds(const CFGGraph* graph, const u32 id, u32* count);
+
+// Parallel to the successors of the block, CFG_NULL_NODE for the edges of unreachable blocks.
+const u32* cfg_graph_get_succ_pred_indices(const CFGGraph* graph, const u32 id, u32* count);
+
+const u32* cfg_graph_get_post_order(const CFGGraph* graph, u32* count);
+
+const u32* cfg_graph_get_rpo(const CFGGraph* graph, u32* count);
+
+u32 cfg_graph_get_rpo_index(const CFGGraph* graph, const u32 id);
+
+bool is_cfg_node_reachable(const CFGGraph* graph, const u32 id);
+
+// Starts a new traversal. The marks of the previous one are dropped in O(1) by bumping the epoch.
+void cfg_graph_begin_visit(CFGGraph* graph);
+
+// Returns false if the block was already visited during the current traversal.
+bool cfg_graph_mark_visited(CFGGraph* graph, const u32 id);
+
+bool is_cfg_node_visited(const CFGGraph* graph, const u32 id);
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "vanec/frontend/ast/ast_node.h"
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Lowering of ast statements and expressions into the three-address instructions of a cfg block.
+// On failure a diagnostic is reported and false (or IR_NULL_REG) is returned.
+// '&&', '||' and '?:' only evaluate the operands they need, so they end the block with a branch
+// and the lowering goes on in new blocks. The block is passed by reference and updated to the block
+// the evaluation ended in, every block left behind is already terminated.
+
+bool lower_funcsign_to_ir(CFGContext* ctx, const u32 block, const ASTNode* funcsign);
+
+bool lower_statement_to_ir(CFGContext* ctx, u32* block, const ASTNode* stmt);
+
+bool lower_return_to_ir(CFGContext* ctx, u32* block, const ASTNode* stmt);
+
+// Returns the register holding the value of the expression.
+u32 lower_expression_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr);
+
+// Whether the expression is a short-circuit operator or a ternary, possibly negated, which is better
+// lowered with lower_condition_to_ir when it decides a branch.
+bool is_short_circuit_expr(const ASTNode* expr);
+
+// Lowers the expression as a decision: every operand branches straight to the target it decides,
+// so no bool is computed for '&&', '||', '!' and '?:'. A target that is CFG_NULL_NODE gets a new empty block
+// on first use, which the caller has to chain. Every block of the evaluation ends with a branch.
+bool lower_condition_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr, u32* then_target, u32* else_target);
+
+IRType get_ir_type_of_typeref(CFGContext* ctx, const ASTNode* typeref, IRType* elem_type);
\ No newline at end of file
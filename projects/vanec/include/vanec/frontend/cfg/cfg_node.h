@@ -2,7 +2,8 @@
 
 #include "vanec/utils/defines.h"
 
-#include "vanec/frontend/cfg/cfg_scope.h"
+// Nodes are addressed by their index in the CFGContext node pool.
+#define CFG_NULL_NODE ((u32)-1)
 
 typedef enum {
     CFG_UNKNOWN_NODE = 0,
@@ -21,10 +22,10 @@ typedef struct CFGNode CFGNode;
 
 struct CFGChainData {
     union {
-        CFGNode* first;
-        CFGNode* next;
+        u32 first;
+        u32 next;
     };
-    CFGNode* last;
+    u32 last;
 };
 
 struct CFGFunctionData {
@@ -32,40 +33,41 @@ struct CFGFunctionData {
 };
 
 struct CFGBasicData {
-    CFGNode* next;
+    u32 next;
 };
 
 struct CFGConditionData {
     struct CFGChainData then_branch;
     struct CFGChainData else_branch;
+    u32 value;  // register tested by the terminator
 };
 
 struct CFGLoopEntryData {
     struct CFGChainData block;
-    CFGNode* exit;
+    u32 exit;
 };
 
+// The payload is stored inline, so a node is a single plain value in the pool.
+// Every node is a block of the linear IR: it owns a contiguous range of the instruction pool,
+// which ends with a terminator once the function is built.
 struct CFGNode {
     CFGNodeKind kind;
     u32 id;
-    u32 visited;
+    u32 scope;
+
+    u32 instrs_begin;
+    u32 instrs_count;
 
     union {
-        struct CFGFunctionData* func_entry;
-        struct CFGBasicData* basic_block;
-        struct CFGConditionData* condition;
-        struct CFGLoopEntryData* loop_entry;
-        struct CFGBasicData* loop_exit;
-        struct CFGBasicData* backedge;
-        struct CFGBasicData* break_;
-        struct CFGBasicData* return_;
+        struct CFGFunctionData func_entry;
+        struct CFGBasicData basic_block;
+        struct CFGConditionData condition;
+        struct CFGLoopEntryData loop_entry;
+        struct CFGBasicData loop_exit;
+        struct CFGBasicData backedge;
+        struct CFGBasicData break_;
+        struct CFGBasicData return_;
     } as;
-
-    const CFGScope* scope;
 };
 
-CFGNode* cfg_node_create(const CFGNodeKind kind, const u32 id, const CFGScope* scope);
-
-void cfg_node_free(CFGNode* node);
-
-CFGNode* chain_cfg_nodes(CFGNode* prev, CFGNode* next);
\ No newline at end of file
+CFGNode cfg_node_create(const CFGNodeKind kind, const u32 id, const u32 scope);
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <stdio.h>
+
 #include "vanec/utils/vector.h"
 
-#include "vanec/frontend/cfg/cfg_node.h"
+#include "vanec/frontend/cfg/cfg_context.h"
+
+bool write_cfg_dot_file(const char* filepath, CFGContext* ctx, const u32 entry);
+
+const char* get_cfg_node_kind_name(const CFGNodeKind kind);
 
-bool write_cfg_dot_file(const char* filepath, CFGNode* cfg);
\ No newline at end of file
+// Prints the instructions of every block of the function in the textual IR form.
+void print_cfg_ir(FILE* handle, const CFGContext* ctx, const char* name);
\ No newline at end of file
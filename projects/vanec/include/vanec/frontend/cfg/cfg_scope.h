@@ -1,9 +1,11 @@
 #pragma once
 
 #include "vanec/utils/defines.h"
-#include "vanec/utils/vector.h"
 
-typedef struct CFGNode CFGNode;
+#include "vanec/frontend/cfg/cfg_node.h"
+
+// Scopes are addressed by their index in the CFGContext scope pool.
+#define CFG_NULL_SCOPE ((u32)-1)
 
 typedef enum {
     CFG_UNKNOWN_SCOPE   = 0,
@@ -17,13 +19,18 @@ typedef struct CFGScope CFGScope;
 struct CFGScope {
     CFGScopeKind kind;
 
-    CFGScope* prev;
+    u32 prev;
+
+    u32 break_node;
+    u32 backedge_node;
+    u32 return_node;
 
-    CFGNode* break_node;
-    CFGNode* backedge_node;
-    CFGNode* return_node;
+    u32 symbols_count;  // symbols declared before the scope, the rest are dropped on leave
 };
 
-CFGScope* cfg_scope_create(const CFGScopeKind kind, CFGScope* prev);
+typedef struct {
+    const char* name;   // borrowed from the ast
+    u32 reg;
+} CFGSymbol;
 
-void cfg_scope_free(CFGScope* scope);
\ No newline at end of file
+CFGScope cfg_scope_create(const CFGScopeKind kind, const u32 prev, const u32 symbols_count);
\ No newline at end of file
@@ -33,4 +33,8 @@ const Token* token_stream_peek_next(TokenStream* ts);
 
 const Token* token_stream_consume(TokenStream* ts);
 
-void token_stream_move_back(TokenStream* ts);
\ No newline at end of file
+void token_stream_move_back(TokenStream* ts);
+
+// Frees every token before the current one. Only the current token stays reachable
+// by token_stream_move_back afterwards, so call it on boundaries the parser won't backtrack over.
+void token_stream_release_consumed(TokenStream* ts);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vanec/utils/vector.h"
+
+#include "vanec/ir/ir_instr.h"
+
+// Everything the instructions of one function refer to by index.
+// The blocks themselves are the CFG nodes, which own ranges of the instruction pool.
+typedef struct {
+    Vector instrs;      // IRInstr, grouped by block
+    Vector regs;        // IRReg
+    Vector lists;       // u32, call arguments and phi incoming pairs
+    Vector strings;     // char*, string literals, callee and register names
+
+    u32 params_count;   // the first registers are the parameters
+    u32 ret_reg;
+    IRType ret_type;
+
+    bool is_ssa;        // every register has a single definition and joins are phis
+} IRFunction;
+
+IRFunction ir_function_create(void);
+
+void ir_function_free(IRFunction* func);
+
+void ir_function_clear(IRFunction* func);
+
+u32 ir_function_create_reg(IRFunction* func, const IRType type, const u32 name);
+
+IRReg* ir_function_get_reg(const IRFunction* func, const u32 reg);
+
+u32 ir_function_get_regs_count(const IRFunction* func);
+
+IRInstr* ir_function_get_instr(const IRFunction* func, const u32 index);
+
+u32 ir_function_get_instrs_count(const IRFunction* func);
+
+u32 ir_function_add_string(IRFunction* func, const char* s);
+
+const char* ir_function_get_string(const IRFunction* func, const u32 index);
+
+u32 ir_function_add_list(IRFunction* func, const u32* items, const u32 count);
+
+u32* ir_function_get_list(const IRFunction* func, const u32 first);
+
+// Register operands are accessed through references, so passes can rewrite them in place.
+// The fixed operands a, b and c are always counted, even when they are IR_NULL_REG.
+u32 ir_function_get_uses_count(const IRFunction* func, const IRInstr* instr);
+
+u32* ir_function_get_use_ref(const IRFunction* func, IRInstr* instr, const u32 index);
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "vanec/utils/defines.h"
+
+// Virtual registers, strings and blocks are addressed by their index in the owning function.
+#define IR_NULL_REG ((u32)-1)
+#define IR_NULL_STRING ((u32)-1)
+
+typedef enum {
+#define IR_OPCODE(ID, NAME) IR_OP_##ID,
+#include "vanec/ir/ir_opcode.def"
+    IR_OPCODES_COUNT,
+} IROpcode;
+
+typedef enum {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) IR_TYPE_##ID,
+#include "vanec/ir/ir_type.def"
+    IR_TYPES_COUNT,
+} IRType;
+
+// Three-address instruction. Operands are virtual registers,
+// anything that does not fit into them lives in the payload.
+typedef struct {
+    IROpcode op;
+    IRType type;
+
+    u32 dst;
+    u32 a;
+    u32 b;
+    u32 c;
+
+    union {
+        i64 imm;
+        u32 str;
+        u32 target;
+        struct {
+            u32 then_block;
+            u32 else_block;
+        } branch;
+        struct {
+            u32 callee;     // string index
+            u32 first;      // index into the function lists
+            u32 count;
+        } call;
+        struct {
+            u32 first;      // index into the function lists, a (block, reg) pair per incoming edge, in the order of the preds
+            u32 count;
+        } phi;
+    } as;
+} IRInstr;
+
+typedef struct {
+    IRType type;
+    IRType elem_type;   // for arrays only
+    u32 name;           // string index, IR_NULL_STRING for temporaries
+} IRReg;
+
+IRInstr ir_instr_create(const IROpcode op, const IRType type, const u32 dst, const u32 a, const u32 b);
+
+const char* get_ir_opcode_name(const IROpcode op);
+
+const char* get_ir_type_name(const IRType type);
+
+u32 get_ir_type_size(const IRType type);
+
+bool is_ir_type_signed(const IRType type);
+
+bool is_ir_type_integer(const IRType type);
+
+// Brings a value into the range of the type: truncated to its width, then sign or zero extended back to 64 bits.
+// Like in C, a bool is true for any value other than zero.
+i64 normalize_ir_value(const IRType type, const i64 value);
+
+// The high half of the product of two values of the type, taken at twice its width with its signedness.
+i64 multiply_high_ir_value(const IRType type, const i64 lhs, const i64 rhs);
+
+bool is_ir_opcode_unary(const IROpcode op);
+
+bool is_ir_opcode_binary(const IROpcode op);
+
+bool is_ir_opcode_compare(const IROpcode op);
+
+bool is_ir_opcode_terminator(const IROpcode op);
+
+bool is_ir_opcode_commutative(const IROpcode op);
+
+// Instructions without side effects, which can be removed when the result is unused.
+bool is_ir_opcode_pure(const IROpcode op);
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "vanec/ir/ir_function.h"
+
+void print_ir_reg(FILE* handle, const IRFunction* func, const u32 reg);
+
+void print_ir_instr(FILE* handle, const IRFunction* func, const IRInstr* instr);
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Lowers integer divisions and remainders by constants over a function in SSA form, in every width and signedness.
+// Powers of two become shifts and masks, rounded towards zero for signed values, other divisors a multiplication
+// by a magic number taking the high half of the product, followed by shifts and fixups (Granlund and Montgomery).
+// The remainder is then 'n - q * d'. A remainder only compared with zero tests the divisibility instead: the dividend
+// times the inverse of an odd divisor is at most a limit exactly when the division has no remainder.
+// Divisions by zero and signed ones by -1 are kept, as they can trap.
+// Returns the number of instructions lowered.
+u32 lower_constant_divisions(CFGContext* ctx);
\ No newline at end of file
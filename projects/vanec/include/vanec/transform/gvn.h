@@ -0,0 +1,14 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Dominator based global value numbering over a function in SSA form. The blocks are walked in preorder
+// of the dominator tree with a hash table of the expressions computed so far, scoped so that a block
+// only sees the ones of its dominators, and an expression found there is replaced by the earlier result.
+// Operands of commutative operators are ordered and greater compares are turned around, so 'a + b' meets 'b + a'
+// and 'a > b' meets 'b < a'. Copies between registers of the same type are propagated away.
+// Element loads are numbered together with the memory state: stores and calls start a new one, as does
+// every block that can be entered from somewhere else than its dominator, and a store makes its value
+// the result of loading the element back. Phis are left alone.
+// Returns the number of instructions removed.
+u32 eliminate_common_subexpressions(CFGContext* ctx);
\ No newline at end of file
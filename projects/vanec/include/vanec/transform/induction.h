@@ -0,0 +1,15 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Induction variable optimization over a function in SSA form, loops visited innermost first after preheaders are inserted.
+// A basic induction variable is a header phi entering with some value from the preheader and stepped by a constant
+// on every latch, a derived one is a linear function 'scale * iv + offset' of one with constant coefficients,
+// built by adds, subs, muls, shifts and negations inside of the loop.
+// Strength reduction: derived muls and shifts become copies of a new basic variable, started in the preheader
+// and stepped by an add on every latch. All of it wraps around, so the rewrite is exact in every width.
+// Linear function test replacement: an exit test comparing a basic variable with a constant, run on every iteration,
+// is moved over to a reduced variable, when the start is constant too and neither one can overflow up to the exit.
+// A basic variable used by nothing but its own increment is removed afterwards.
+// Returns the number of instructions rewritten or removed.
+u32 optimize_induction_variables(CFGContext* ctx);
\ No newline at end of file
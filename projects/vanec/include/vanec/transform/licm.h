@@ -0,0 +1,13 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Loop invariant code motion over a function in SSA form. Every loop gets a preheader first, then the loops are
+// visited innermost first, so code hoisted out of a loop can leave the enclosing ones as well.
+// An instruction is invariant when all of its operands are defined outside of the loop or by invariant instructions.
+// Pure ones are hoisted into the preheader even when they would not run on every iteration, divisions only
+// by constants that cannot trap, and element loads only from loops without stores or calls, which can write the elements.
+// The single store of a loop that neither loads nor calls is sunk into its exit when it writes the same element
+// on every iteration that leaves the loop, the exit then stores the last value once.
+// Returns the number of instructions moved.
+u32 move_loop_invariant_code(CFGContext* ctx);
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// The optimization passes over a function, in the order every command runs them. The function is put in SSA form
+// first when it is not yet, as the passes past the CFG simplification need it. Divisions by constants are only
+// worth lowering for the hardware, the bytecode divides in a single instruction. The name labels the profile.
+void optimize_function(CFGContext* ctx, const bool lower_divisions, const char* name);
\ No newline at end of file
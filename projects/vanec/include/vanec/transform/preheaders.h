@@ -0,0 +1,9 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Gives every loop a preheader: a block that is the only way into the loop and jumps only to the header,
+// the place where invariant code is hoisted to. In SSA form the incoming values of the header phis
+// from outside of the loop are merged by a phi in the new block.
+// Returns the number of blocks inserted, the graph is rebuilt when it is not zero.
+u32 insert_loop_preheaders(CFGContext* ctx);
\ No newline at end of file
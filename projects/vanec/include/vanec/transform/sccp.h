@@ -0,0 +1,13 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Sparse conditional constant propagation (Wegman and Zadeck) over a function in SSA form.
+// Every register starts unknown and only moves down to a constant or to varying, while blocks only
+// become executable once an edge into them does, so values flowing around loops are assumed constant
+// until proven otherwise and the code behind branches that never go one way is ignored.
+// Values are folded in the width and signedness of the instruction type and wrap around like the hardware does,
+// divisions by zero, overflowing divisions and out of range shifts are left to run.
+// Defs of constants become consts and branches on them become jumps, the blocks no longer reached are
+// then dropped by simplify_cfg. Returns the number of instructions rewritten.
+u32 propagate_constants(CFGContext* ctx);
\ No newline at end of file
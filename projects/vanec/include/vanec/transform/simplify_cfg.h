@@ -0,0 +1,12 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Shrinks the graph the builder leaves behind, where break, return, backedge and loop exit nodes are
+// mostly blocks holding a single jump. Branches on constants and branches with both targets equal become jumps,
+// jumps through blocks holding nothing but a jump go straight to the final target, and a block is merged
+// into its pred when it is the only succ of a pred that is its only pred.
+// The reachable blocks are then renumbered in RPO, so the entry becomes block 0, and the unreachable ones are dropped.
+// Works on both forms: in SSA the phis lose the pairs of the removed edges and the phis of merged blocks become copies.
+// Returns the number of blocks removed, the graph is rebuilt in any case.
+u32 simplify_cfg(CFGContext* ctx);
\ No newline at end of file
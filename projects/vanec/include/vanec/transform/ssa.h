@@ -0,0 +1,15 @@
+#pragma once
+
+#include "vanec/frontend/cfg/cfg_context.h"
+
+// Semi-pruned SSA construction: phis are only placed for registers that are live across blocks,
+// at the iterated dominance frontiers of their definitions, and the registers are renamed
+// in one walk over the dominator tree. The first definition of a register keeps its number.
+// A phi operand is IR_NULL_REG when the register is undefined along that edge.
+// Unreachable blocks are emptied down to their terminator, as nothing in them can execute.
+void construct_ssa(CFGContext* ctx);
+
+// Replaces the phis with copies at the end of the incoming blocks. Critical edges are split first,
+// so the copies only run on their edge, and every set of parallel copies is sequentialized
+// with a temporary register per cycle.
+void destruct_ssa(CFGContext* ctx);
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vanec/utils/defines.h"
+
+// Dense bit sets packed in 64 bit words. A set is a plain span of words, so many sets of the same size
+// can live in a single array, one after the other. The bits past the size of the set in the last word
+// are always clear, none of the operations can set them.
+#define BIT_SET_WORD_BITS 64
+#define BIT_SET_NULL_BIT ((u32)-1)
+
+u32 bit_set_get_words_count(const u32 bits_count);
+
+void bit_set_add(u64* set, const u32 bit);
+
+void bit_set_remove(u64* set, const u32 bit);
+
+bool bit_set_contains(const u64* set, const u32 bit);
+
+void bit_set_fill(u64* set, const u32 bits_count, const bool value);
+
+void bit_set_copy(u64* dst, const u64* src, const u32 words_count);
+
+bool bit_set_equals(const u64* a, const u64* b, const u32 words_count);
+
+// dst |= src, returns whether dst changed.
+bool bit_set_union(u64* dst, const u64* src, const u32 words_count);
+
+// dst &= src, returns whether dst changed.
+bool bit_set_intersect(u64* dst, const u64* src, const u32 words_count);
+
+// dst = gen | (src & ~kill), the transfer function of the gen/kill dataflow problems. Returns whether dst changed.
+bool bit_set_transfer(u64* dst, const u64* src, const u64* gen, const u64* kill, const u32 words_count);
+
+u32 bit_set_count(const u64* set, const u32 words_count);
+
+// The first bit set at or after from, or BIT_SET_NULL_BIT.
+u32 bit_set_next(const u64* set, const u32 words_count, const u32 from);
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vanec/utils/defines.h"
+
+typedef struct {
+    char* name;
+    const char* category;
+    u64 start_ns;
+    u64 duration_ns;
+    u32 tid;
+} ProfilerEvent;
+
+typedef struct {
+    char* name;
+    const char* category;
+    u64 total_ns;
+    u64 count;
+} ProfilerCounter;
+
+// Scopes can be recorded from any thread, each one gets its own track in the trace.
+// Enabling, disabling and the outputs must not overlap with the threads still recording.
+void profiler_enable(void);
+
+void profiler_disable(void);
+
+bool is_profiler_enabled(void);
+
+u64 profiler_now_ns(void);
+
+u64 profiler_scope_begin(void);
+
+void profiler_scope_end(const char* category, const char* name, const u64 start_ns);
+
+void profiler_scope_accumulate(const char* category, const char* name, const u64 start_ns);
+
+void profiler_print_time_report(void);
+
+bool profiler_write_trace_file(const char* filepath);
+
+// Scoped timers. Every BEGIN must be paired with exactly one END (or ACCUMULATE) in the same block.
+// END records a trace event, ACCUMULATE only adds the elapsed time to a named counter,
+// which is meant for hot paths like per-token lexing where an event per call would flood the trace.
+#define PROFILE_SCOPE_BEGIN(scope) \
+const u64 scope##_profile_start_ns = profiler_scope_begin()
+
+#define PROFILE_SCOPE_END(scope, category, name) \
+profiler_scope_end(category, name, scope##_profile_start_ns)
+
+#define PROFILE_SCOPE_ACCUMULATE(scope, category, name) \
+profiler_scope_accumulate(category, name, scope##_profile_start_ns)
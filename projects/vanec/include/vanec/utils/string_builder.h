@@ -2,8 +2,11 @@
 
 #include "vanec/utils/vector.h"
 
+// The text lives in buffer.items[head, buffer.items_count).
+// The [0, head) gap in front of it makes left appends amortized O(1) like the right ones.
 typedef struct {
     Vector buffer;
+    u64 head;
 } StringBuilder;
 
 StringBuilder string_builder_create();
@@ -20,4 +23,8 @@ void string_builder_append_str_right(StringBuilder* sb, const char* s);
 
 void string_builder_append_format(StringBuilder* sb, const char* format, ...);
 
+u64 string_builder_get_len(const StringBuilder* sb);
+
+char string_builder_get_char(const StringBuilder* sb, const u64 index);
+
 char* string_builder_get_str(const StringBuilder* sb);
\ No newline at end of file
@@ -17,6 +17,14 @@ void vector_free(Vector* vector);
 
 void vector_clear(Vector* vector);
 
+void vector_reserve(Vector* vector, const u64 capacity);
+
+// Sets the items count, the new items are left uninitialized. Returns the items.
+void* vector_resize(Vector* vector, const u64 count);
+
+// Copies the item over every item of the vector.
+void vector_fill(Vector* vector, const void* item);
+
 void vector_push_back(Vector* vector, const void* item);
 
 void vector_push_front(Vector* vector, const void* item);
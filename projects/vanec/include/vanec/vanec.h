@@ -6,6 +6,8 @@
 #include "vanec/utils/string_utils.h"
 #include "vanec/utils/string_builder.h"
 #include "vanec/utils/file_utils.h"
+#include "vanec/utils/profiler.h"
+#include "vanec/utils/bit_set.h"
 
 #include "vanec/diagnostic/source_loc.h"
 #include "vanec/diagnostic/diagnostic.h"
@@ -20,8 +22,43 @@
 #include "vanec/frontend/ast/ast_node_utils.h"
 #include "vanec/frontend/ast/ast_parser.h"
 
+#include "vanec/ir/ir_instr.h"
+#include "vanec/ir/ir_function.h"
+#include "vanec/ir/ir_printer.h"
+
 #include "vanec/frontend/cfg/cfg_node.h"
 #include "vanec/frontend/cfg/cfg_node_utils.h"
 #include "vanec/frontend/cfg/cfg_builder.h"
 #include "vanec/frontend/cfg/cfg_context.h"
 #include "vanec/frontend/cfg/cfg_scope.h"
+#include "vanec/frontend/cfg/cfg_graph.h"
+#include "vanec/frontend/cfg/cfg_lowering.h"
+
+#include "vanec/analysis/dominator_tree.h"
+#include "vanec/analysis/loop_forest.h"
+#include "vanec/analysis/def_use.h"
+#include "vanec/analysis/dataflow.h"
+#include "vanec/analysis/liveness.h"
+#include "vanec/analysis/reaching_defs.h"
+#include "vanec/analysis/available_exprs.h"
+
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/preheaders.h"
+#include "vanec/transform/simplify_cfg.h"
+#include "vanec/transform/sccp.h"
+#include "vanec/transform/gvn.h"
+#include "vanec/transform/licm.h"
+#include "vanec/transform/induction.h"
+#include "vanec/transform/divisions.h"
+#include "vanec/transform/optimize.h"
+
+#include "vanec/backend/bytecode.h"
+#include "vanec/backend/bc_compiler.h"
+#include "vanec/backend/bc_quickening.h"
+#include "vanec/backend/vm.h"
+#include "vanec/backend/jit.h"
+#include "vanec/backend/live_intervals.h"
+#include "vanec/backend/reg_alloc.h"
+#include "vanec/backend/linear_scan.h"
+#include "vanec/backend/graph_coloring.h"
+#include "vanec/backend/x64_compiler.h"
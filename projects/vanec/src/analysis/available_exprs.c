@@ -0,0 +1,250 @@
+#include "vanec/analysis/available_exprs.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+AvailableExprs available_exprs_create(void) {
+    return (AvailableExprs) {
+        .problem = dataflow_problem_create(),
+        .instr_exprs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .expr_instrs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_expr_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_exprs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+}
+
+void available_exprs_free(AvailableExprs* exprs) {
+    if (exprs == NULL) {
+        return;
+    }
+
+    dataflow_problem_free(&exprs->problem);
+    vector_free(&exprs->instr_exprs);
+    vector_free(&exprs->expr_instrs);
+    vector_free(&exprs->reg_expr_offsets);
+    vector_free(&exprs->reg_exprs);
+}
+
+void available_exprs_clear(AvailableExprs* exprs) {
+    assert(exprs != NULL);
+
+    dataflow_problem_clear(&exprs->problem);
+    vector_clear(&exprs->instr_exprs);
+    vector_clear(&exprs->expr_instrs);
+    vector_clear(&exprs->reg_expr_offsets);
+    vector_clear(&exprs->reg_exprs);
+}
+
+typedef struct {
+    IROpcode op;
+    IRType type;
+    u32 a;
+    u32 b;
+    u32 instr;
+} ExprKey;
+
+static bool is_expr_opcode(const IROpcode op) {
+    return is_ir_opcode_unary(op) || is_ir_opcode_binary(op) || is_ir_opcode_compare(op);
+}
+
+static ExprKey create_expr_key(const IRInstr* instr, const u32 index) {
+    ExprKey key = { .op = instr->op, .type = instr->type, .a = instr->a, .b = instr->b, .instr = index };
+    if (is_ir_opcode_commutative(instr->op) && key.b < key.a) {
+        key.a = instr->b;
+        key.b = instr->a;
+    }
+    return key;
+}
+
+// Orders by the expression and then by the instruction, so the first instruction of a group is the earliest one.
+static int compare_expr_keys(const void* lhs, const void* rhs) {
+    const ExprKey* a = lhs;
+    const ExprKey* b = rhs;
+
+    if (a->op != b->op) { return a->op < b->op ? -1 : 1; }
+    if (a->type != b->type) { return a->type < b->type ? -1 : 1; }
+    if (a->a != b->a) { return a->a < b->a ? -1 : 1; }
+    if (a->b != b->b) { return a->b < b->b ? -1 : 1; }
+    if (a->instr != b->instr) { return a->instr < b->instr ? -1 : 1; }
+    return 0;
+}
+
+static bool is_same_expr(const ExprKey* a, const ExprKey* b) {
+    return a->op == b->op && a->type == b->type && a->a == b->a && a->b == b->b;
+}
+
+// Gives the same number to the instructions computing the same expression, by sorting them.
+static void number_exprs(AvailableExprs* exprs, const CFGContext* ctx) {
+    const IRFunction* func = &ctx->ir;
+
+    Vector keys = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ExprKey), NULL, false);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            const IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + j);
+            if (is_expr_opcode(instr->op)) {
+                const ExprKey key = create_expr_key(instr, node->instrs_begin + j);
+                vector_push_back(&keys, &key);
+            }
+        }
+    }
+
+    qsort(keys.items, keys.items_count, sizeof(ExprKey), &compare_expr_keys);
+
+    u32* instr_exprs = vector_resize(&exprs->instr_exprs, ir_function_get_instrs_count(func));
+    memset(instr_exprs, 0xFF, exprs->instr_exprs.items_count * sizeof(u32));
+    vector_clear(&exprs->expr_instrs);
+
+    const ExprKey* items = (const ExprKey*)keys.items;
+    for (u64 i = 0; i < keys.items_count; ++i) {
+        if (i == 0 || !is_same_expr(&items[i - 1], &items[i])) {
+            vector_push_back(&exprs->expr_instrs, &items[i].instr);
+        }
+        instr_exprs[items[i].instr] = (u32)exprs->expr_instrs.items_count - 1;
+    }
+
+    vector_free(&keys);
+}
+
+static void group_exprs_by_reg(AvailableExprs* exprs, const CFGContext* ctx) {
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+    const u32 exprs_count = available_exprs_get_exprs_count(exprs);
+    const u32* expr_instrs = (const u32*)exprs->expr_instrs.items;
+
+    u32* offsets = vector_resize(&exprs->reg_expr_offsets, regs_count + 1);
+    memset(offsets, 0, (regs_count + 1) * sizeof(u32));
+
+    // An expression reading the same register twice is listed once.
+    for (u32 expr = 0; expr < exprs_count; ++expr) {
+        const IRInstr* instr = ir_function_get_instr(func, expr_instrs[expr]);
+        if (instr->a != IR_NULL_REG) {
+            ++offsets[instr->a + 1];
+        }
+        if (instr->b != IR_NULL_REG && instr->b != instr->a) {
+            ++offsets[instr->b + 1];
+        }
+    }
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        offsets[reg + 1] += offsets[reg];
+    }
+
+    u32* reg_exprs = vector_resize(&exprs->reg_exprs, offsets[regs_count]);
+    for (u32 expr = 0; expr < exprs_count; ++expr) {
+        const IRInstr* instr = ir_function_get_instr(func, expr_instrs[expr]);
+        if (instr->a != IR_NULL_REG) {
+            reg_exprs[offsets[instr->a]++] = expr;
+        }
+        if (instr->b != IR_NULL_REG && instr->b != instr->a) {
+            reg_exprs[offsets[instr->b]++] = expr;
+        }
+    }
+
+    for (u32 reg = regs_count; reg > 0; --reg) {
+        offsets[reg] = offsets[reg - 1];
+    }
+    offsets[0] = 0;
+}
+
+// kill holds the expressions reading a register defined in the block. The block is walked backwards,
+// an expression is generated when none of its operands is defined at or after it.
+static void build_block_sets(AvailableExprs* exprs, const CFGContext* ctx, const u32 block, u32* stamps) {
+    const IRFunction* func = &ctx->ir;
+    const u32* instr_exprs = (const u32*)exprs->instr_exprs.items;
+    const u32* offsets = (const u32*)exprs->reg_expr_offsets.items;
+    const u32* reg_exprs = (const u32*)exprs->reg_exprs.items;
+
+    u64* gen = dataflow_get_gen(&exprs->problem, block);
+    u64* kill = dataflow_get_kill(&exprs->problem, block);
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    for (u32 i = node->instrs_count; i > 0; --i) {
+        const u32 index = node->instrs_begin + i - 1;
+        const IRInstr* instr = ir_function_get_instr(func, index);
+
+        if (instr->dst != IR_NULL_REG && stamps[instr->dst] != block) {
+            stamps[instr->dst] = block;
+            for (u32 j = offsets[instr->dst]; j < offsets[instr->dst + 1]; ++j) {
+                bit_set_add(kill, reg_exprs[j]);
+            }
+        }
+
+        const u32 expr = instr_exprs[index];
+        if (expr == IR_NULL_REG) {
+            continue;
+        }
+
+        const bool is_a_killed = instr->a != IR_NULL_REG && stamps[instr->a] == block;
+        const bool is_b_killed = instr->b != IR_NULL_REG && stamps[instr->b] == block;
+        if (!is_a_killed && !is_b_killed) {
+            bit_set_add(gen, expr);
+        }
+    }
+}
+
+void available_exprs_build(AvailableExprs* exprs, const CFGContext* ctx) {
+    assert(exprs != NULL && ctx != NULL);
+
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+
+    number_exprs(exprs, ctx);
+    group_exprs_by_reg(exprs, ctx);
+    dataflow_problem_init(&exprs->problem, DATAFLOW_FORWARD, DATAFLOW_INTERSECTION, nodes_count, available_exprs_get_exprs_count(exprs));
+
+    Vector stamps = vector_create(regs_count + 1, sizeof(u32), NULL, false);
+    u32* reg_stamps = vector_resize(&stamps, regs_count);
+    memset(reg_stamps, 0xFF, regs_count * sizeof(u32));
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    for (u32 i = 0; i < rpo_count; ++i) {
+        build_block_sets(exprs, ctx, rpo[i], reg_stamps);
+    }
+
+    vector_free(&stamps);
+
+    dataflow_solve(&exprs->problem, graph);
+}
+
+u32 available_exprs_get_exprs_count(const AvailableExprs* exprs) {
+    assert(exprs != NULL);
+
+    return (u32)exprs->expr_instrs.items_count;
+}
+
+u32 available_exprs_get_instr_expr(const AvailableExprs* exprs, const u32 instr) {
+    assert(exprs != NULL && instr < exprs->instr_exprs.items_count);
+
+    return ((const u32*)exprs->instr_exprs.items)[instr];
+}
+
+u32 available_exprs_get_expr_instr(const AvailableExprs* exprs, const u32 expr) {
+    assert(exprs != NULL && expr < exprs->expr_instrs.items_count);
+
+    return ((const u32*)exprs->expr_instrs.items)[expr];
+}
+
+bool is_expr_available_in(const AvailableExprs* exprs, const u32 block, const u32 expr) {
+    assert(exprs != NULL && expr < available_exprs_get_exprs_count(exprs));
+
+    return bit_set_contains(dataflow_get_in(&exprs->problem, block), expr);
+}
+
+const u64* available_exprs_get_in(const AvailableExprs* exprs, const u32 block) {
+    assert(exprs != NULL);
+
+    return dataflow_get_in(&exprs->problem, block);
+}
+
+const u64* available_exprs_get_out(const AvailableExprs* exprs, const u32 block) {
+    assert(exprs != NULL);
+
+    return dataflow_get_out(&exprs->problem, block);
+}
\ No newline at end of file
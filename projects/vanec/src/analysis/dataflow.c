@@ -0,0 +1,246 @@
+#include "vanec/analysis/dataflow.h"
+
+#include <assert.h>
+#include <string.h>
+
+DataflowProblem dataflow_problem_create(void) {
+    return (DataflowProblem) {
+        .direction = DATAFLOW_FORWARD,
+        .meet = DATAFLOW_UNION,
+        .nodes_count = 0,
+        .bits_count = 0,
+        .words_count = 0,
+        .in = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .out = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .gen = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .kill = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .seed = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .pending = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .visits = 0,
+    };
+}
+
+void dataflow_problem_free(DataflowProblem* problem) {
+    if (problem == NULL) {
+        return;
+    }
+
+    vector_free(&problem->in);
+    vector_free(&problem->out);
+    vector_free(&problem->gen);
+    vector_free(&problem->kill);
+    vector_free(&problem->seed);
+    vector_free(&problem->pending);
+}
+
+void dataflow_problem_clear(DataflowProblem* problem) {
+    assert(problem != NULL);
+
+    vector_clear(&problem->in);
+    vector_clear(&problem->out);
+    vector_clear(&problem->gen);
+    vector_clear(&problem->kill);
+    vector_clear(&problem->seed);
+    vector_clear(&problem->pending);
+
+    problem->nodes_count = 0;
+    problem->bits_count = 0;
+    problem->words_count = 0;
+    problem->visits = 0;
+}
+
+void dataflow_problem_init(DataflowProblem* problem, const DataflowDirection direction, const DataflowMeet meet, const u32 nodes_count, const u32 bits_count) {
+    assert(problem != NULL);
+
+    problem->direction = direction;
+    problem->meet = meet;
+    problem->nodes_count = nodes_count;
+    problem->bits_count = bits_count;
+    problem->words_count = bit_set_get_words_count(bits_count);
+    problem->visits = 0;
+
+    const u64 words_count = (u64)problem->words_count * nodes_count;
+    memset(vector_resize(&problem->in, words_count), 0, words_count * sizeof(u64));
+    memset(vector_resize(&problem->out, words_count), 0, words_count * sizeof(u64));
+    memset(vector_resize(&problem->gen, words_count), 0, words_count * sizeof(u64));
+    memset(vector_resize(&problem->kill, words_count), 0, words_count * sizeof(u64));
+    memset(vector_resize(&problem->seed, words_count), 0, words_count * sizeof(u64));
+}
+
+static u64* get_set(const Vector* sets, const DataflowProblem* problem, const u32 block) {
+    assert(block < problem->nodes_count);
+
+    return (u64*)sets->items + (u64)block * problem->words_count;
+}
+
+u64* dataflow_get_in(const DataflowProblem* problem, const u32 block) {
+    assert(problem != NULL);
+
+    return get_set(&problem->in, problem, block);
+}
+
+u64* dataflow_get_out(const DataflowProblem* problem, const u32 block) {
+    assert(problem != NULL);
+
+    return get_set(&problem->out, problem, block);
+}
+
+u64* dataflow_get_gen(const DataflowProblem* problem, const u32 block) {
+    assert(problem != NULL);
+
+    return get_set(&problem->gen, problem, block);
+}
+
+u64* dataflow_get_kill(const DataflowProblem* problem, const u32 block) {
+    assert(problem != NULL);
+
+    return get_set(&problem->kill, problem, block);
+}
+
+u64* dataflow_get_seed(const DataflowProblem* problem, const u32 block) {
+    assert(problem != NULL);
+
+    return get_set(&problem->seed, problem, block);
+}
+
+// Meets the sets the block depends on into dst, the empty set when there are none.
+static void meet_block(const DataflowProblem* problem, u64* dst, const Vector* sources, const u32* neighbors, const u32 count) {
+    if (count == 0) {
+        bit_set_fill(dst, problem->bits_count, false);
+        return;
+    }
+
+    bit_set_copy(dst, get_set(sources, problem, neighbors[0]), problem->words_count);
+    for (u32 i = 1; i < count; ++i) {
+        const u64* src = get_set(sources, problem, neighbors[i]);
+        if (problem->meet == DATAFLOW_UNION) {
+            bit_set_union(dst, src, problem->words_count);
+        }
+        else {
+            bit_set_intersect(dst, src, problem->words_count);
+        }
+    }
+}
+
+void dataflow_solve(DataflowProblem* problem, const CFGGraph* graph) {
+    assert(problem != NULL && graph != NULL);
+    assert(problem->nodes_count == cfg_graph_get_nodes_count(graph));
+
+    const bool is_forward = problem->direction == DATAFLOW_FORWARD;
+
+    // Forward problems meet into in and produce out, backward ones the other way around.
+    Vector* meets = is_forward ? &problem->in : &problem->out;
+    Vector* results = is_forward ? &problem->out : &problem->in;
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+
+    u8* pending = vector_resize(&problem->pending, rpo_count);
+    memset(pending, true, rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        bit_set_fill(get_set(results, problem, rpo[i]), problem->bits_count, problem->meet == DATAFLOW_INTERSECTION);
+    }
+
+    problem->visits = 0;
+    bool is_pending = true;
+
+    while (is_pending) {
+        is_pending = false;
+
+        for (u32 position = 0; position < rpo_count; ++position) {
+            if (!pending[position]) {
+                continue;
+            }
+            pending[position] = false;
+            ++problem->visits;
+
+            const u32 block = is_forward ? rpo[position] : rpo[rpo_count - 1 - position];
+
+            u32 sources_count = 0;
+            const u32* sources = is_forward ? cfg_graph_get_preds(graph, block, &sources_count) : cfg_graph_get_succs(graph, block, &sources_count);
+
+            u64* meet = get_set(meets, problem, block);
+            meet_block(problem, meet, results, sources, sources_count);
+            bit_set_union(meet, dataflow_get_seed(problem, block), problem->words_count);
+
+            const bool changed = bit_set_transfer(get_set(results, problem, block), meet,
+                dataflow_get_gen(problem, block), dataflow_get_kill(problem, block), problem->words_count);
+            if (!changed) {
+                continue;
+            }
+
+            u32 dependents_count = 0;
+            const u32* dependents = is_forward ? cfg_graph_get_succs(graph, block, &dependents_count) : cfg_graph_get_preds(graph, block, &dependents_count);
+
+            // A dependent before the current position is only reached by the next pass.
+            for (u32 i = 0; i < dependents_count; ++i) {
+                const u32 index = cfg_graph_get_rpo_index(graph, dependents[i]);
+                const u32 dependent = is_forward ? index : rpo_count - 1 - index;
+
+                pending[dependent] = true;
+                is_pending |= dependent <= position;
+            }
+        }
+    }
+}
+
+u32 dataflow_number_global_regs(const CFGContext* ctx, Vector* reg_bits, Vector* bit_regs) {
+    assert(ctx != NULL && reg_bits != NULL && bit_regs != NULL);
+
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+
+    // The bits double as the block defining the register last, until they are numbered.
+    u32* bits = vector_resize(reg_bits, regs_count);
+
+    Vector globals = vector_create(regs_count + 1, sizeof(u8), NULL, false);
+    u8* is_global = vector_resize(&globals, regs_count);
+    memset(is_global, false, regs_count);
+    memset(bits, 0xFF, regs_count * sizeof(u32));
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + j);
+
+            if (instr->op == IR_OP_PHI) {
+                const u32* incoming = ir_function_get_list(func, instr->as.phi.first);
+                for (u32 k = 0; k < instr->as.phi.count; ++k) {
+                    if (incoming[k * 2 + 1] != IR_NULL_REG) {
+                        is_global[incoming[k * 2 + 1]] = true;
+                    }
+                }
+            }
+            else {
+                const u32 uses_count = ir_function_get_uses_count(func, instr);
+                for (u32 k = 0; k < uses_count; ++k) {
+                    const u32 reg = *ir_function_get_use_ref(func, instr, k);
+                    if (reg != IR_NULL_REG && bits[reg] != rpo[i]) {
+                        is_global[reg] = true;
+                    }
+                }
+            }
+
+            if (instr->dst != IR_NULL_REG) {
+                bits[instr->dst] = rpo[i];
+            }
+        }
+    }
+
+    vector_clear(bit_regs);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        bits[reg] = IR_NULL_REG;
+        if (is_global[reg]) {
+            bits[reg] = (u32)bit_regs->items_count;
+            vector_push_back(bit_regs, &reg);
+        }
+    }
+
+    vector_free(&globals);
+    return (u32)bit_regs->items_count;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include "vanec/analysis/def_use.h"
+
+#include <assert.h>
+#include <string.h>
+
+DefUseChains def_use_chains_create(void) {
+    return (DefUseChains) {
+        .defs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .use_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .uses = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .instr_blocks = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+}
+
+void def_use_chains_free(DefUseChains* chains) {
+    if (chains == NULL) {
+        return;
+    }
+
+    vector_free(&chains->defs);
+    vector_free(&chains->use_offsets);
+    vector_free(&chains->uses);
+    vector_free(&chains->instr_blocks);
+}
+
+void def_use_chains_clear(DefUseChains* chains) {
+    assert(chains != NULL);
+
+    vector_clear(&chains->defs);
+    vector_clear(&chains->use_offsets);
+    vector_clear(&chains->uses);
+    vector_clear(&chains->instr_blocks);
+}
+
+void def_use_chains_build(DefUseChains* chains, const CFGContext* ctx) {
+    assert(chains != NULL && ctx != NULL);
+
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+    const u32 instrs_count = ir_function_get_instrs_count(func);
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    u32* blocks = vector_resize(&chains->instr_blocks, instrs_count);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            blocks[node->instrs_begin + i] = id;
+        }
+    }
+
+    u32* defs = vector_resize(&chains->defs, regs_count);
+    u32* offsets = vector_resize(&chains->use_offsets, regs_count + 1);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        defs[reg] = IR_NULL_REG;
+    }
+    memset(offsets, 0, (regs_count + 1) * sizeof(u32));
+
+    for (u32 index = 0; index < instrs_count; ++index) {
+        IRInstr* instr = ir_function_get_instr(func, index);
+        if (instr->dst != IR_NULL_REG) {
+            defs[instr->dst] = index;
+        }
+
+        const u32 count = ir_function_get_uses_count(func, instr);
+        for (u32 i = 0; i < count; ++i) {
+            const u32 reg = *ir_function_get_use_ref(func, instr, i);
+            if (reg != IR_NULL_REG) {
+                ++offsets[reg + 1];
+            }
+        }
+    }
+
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        offsets[reg + 1] += offsets[reg];
+    }
+
+    // Offsets are used as the insertion cursors and shifted back afterwards.
+    u32* uses = vector_resize(&chains->uses, offsets[regs_count]);
+    for (u32 index = 0; index < instrs_count; ++index) {
+        IRInstr* instr = ir_function_get_instr(func, index);
+
+        const u32 count = ir_function_get_uses_count(func, instr);
+        for (u32 i = 0; i < count; ++i) {
+            const u32 reg = *ir_function_get_use_ref(func, instr, i);
+            if (reg != IR_NULL_REG) {
+                uses[offsets[reg]++] = index;
+            }
+        }
+    }
+
+    for (u32 reg = regs_count; reg > 0; --reg) {
+        offsets[reg] = offsets[reg - 1];
+    }
+    offsets[0] = 0;
+}
+
+u32 def_use_chains_get_def(const DefUseChains* chains, const u32 reg) {
+    assert(chains != NULL && reg < chains->defs.items_count);
+
+    return ((const u32*)chains->defs.items)[reg];
+}
+
+const u32* def_use_chains_get_uses(const DefUseChains* chains, const u32 reg, u32* count) {
+    assert(chains != NULL && count != NULL);
+    assert(reg + 1 < chains->use_offsets.items_count);
+
+    const u32* offsets = (const u32*)chains->use_offsets.items;
+    *count = offsets[reg + 1] - offsets[reg];
+
+    return (const u32*)chains->uses.items + offsets[reg];
+}
+
+u32 def_use_chains_get_block(const DefUseChains* chains, const u32 instr) {
+    assert(chains != NULL && instr < chains->instr_blocks.items_count);
+
+    return ((const u32*)chains->instr_blocks.items)[instr];
+}
\ No newline at end of file
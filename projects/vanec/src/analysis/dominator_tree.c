@@ -0,0 +1,425 @@
+#include "vanec/analysis/dominator_tree.h"
+
+#include <assert.h>
+#include <string.h>
+
+DominatorTree dominator_tree_create(void) {
+    return (DominatorTree) {
+        .idom = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .depth = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .child_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .children = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .preorder = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .pre = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .post = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .frontier_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .frontiers = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .scratch = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .entry = CFG_NULL_NODE,
+        .graph_version = 0,
+    };
+}
+
+void dominator_tree_free(DominatorTree* tree) {
+    if (tree == NULL) {
+        return;
+    }
+
+    vector_free(&tree->idom);
+    vector_free(&tree->depth);
+    vector_free(&tree->child_offsets);
+    vector_free(&tree->children);
+    vector_free(&tree->preorder);
+    vector_free(&tree->pre);
+    vector_free(&tree->post);
+    vector_free(&tree->frontier_offsets);
+    vector_free(&tree->frontiers);
+    vector_free(&tree->stack);
+    vector_free(&tree->scratch);
+}
+
+void dominator_tree_clear(DominatorTree* tree) {
+    assert(tree != NULL);
+
+    vector_clear(&tree->idom);
+    vector_clear(&tree->depth);
+    vector_clear(&tree->child_offsets);
+    vector_clear(&tree->children);
+    vector_clear(&tree->preorder);
+    vector_clear(&tree->pre);
+    vector_clear(&tree->post);
+    vector_clear(&tree->frontier_offsets);
+    vector_clear(&tree->frontiers);
+    vector_clear(&tree->stack);
+    vector_clear(&tree->scratch);
+
+    tree->entry = CFG_NULL_NODE;
+    tree->graph_version = 0;
+}
+
+// Numbers the reachable blocks in preorder of an iterative depth first walk and records the parent of each
+// in the spanning tree. Returns the number of reachable blocks.
+static u32 number_blocks(DominatorTree* tree, const CFGGraph* graph, u32* num, u32* vertex, u32* parent) {
+    vector_clear(&tree->stack);
+
+    u32 count = 0;
+    const u32 zero = 0;
+
+    num[graph->entry] = count;
+    vertex[count] = graph->entry;
+    parent[count++] = CFG_NULL_NODE;
+    vector_push_back(&tree->stack, &graph->entry);
+    vector_push_back(&tree->stack, &zero);
+
+    while (tree->stack.items_count > 0) {
+        u32* top = (u32*)tree->stack.items + tree->stack.items_count - 2;
+        const u32 id = top[0];
+
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, id, &succs_count);
+
+        if (top[1] == succs_count) {
+            tree->stack.items_count -= 2;
+            continue;
+        }
+
+        const u32 succ = succs[top[1]++];
+        if (num[succ] != CFG_NULL_NODE) {
+            continue;
+        }
+
+        num[succ] = count;
+        vertex[count] = succ;
+        parent[count++] = num[id];
+        vector_push_back(&tree->stack, &succ);
+        vector_push_back(&tree->stack, &zero);
+    }
+
+    return count;
+}
+
+typedef struct {
+    u32* semi;
+    u32* ancestor;
+    u32* label;
+    Vector* path;
+} DominatorForest;
+
+// Path compression of the forest, iterative so long chains can not exhaust the stack.
+static u32 eval(DominatorForest* forest, const u32 v) {
+    u32* ancestor = forest->ancestor;
+    u32* label = forest->label;
+    const u32* semi = forest->semi;
+
+    if (ancestor[v] == CFG_NULL_NODE) {
+        return v;
+    }
+
+    vector_clear(forest->path);
+    for (u32 x = v; ancestor[ancestor[x]] != CFG_NULL_NODE; x = ancestor[x]) {
+        vector_push_back(forest->path, &x);
+    }
+
+    // The nodes closest to the root are compressed first, so every node sees a compressed ancestor.
+    const u32* path = (const u32*)forest->path->items;
+    for (u64 i = forest->path->items_count; i > 0; --i) {
+        const u32 x = path[i - 1];
+        const u32 a = ancestor[x];
+        if (semi[label[a]] < semi[label[x]]) {
+            label[x] = label[a];
+        }
+        ancestor[x] = ancestor[a];
+    }
+
+    return label[v];
+}
+
+// Lengauer-Tarjan with path compression, in O(m log n). The iterative Cooper-Harvey-Kennedy algorithm
+// is quadratic when one join block has many predecessors along a chain,
+// which is what consecutive "end if"s lower to.
+static void build_idoms(DominatorTree* tree, const CFGGraph* graph, const u32 nodes_count) {
+    enum { NUM, VERTEX, PARENT, SEMI, IDOM, ANCESTOR, LABEL, BUCKET_HEAD, BUCKET_NEXT, ARRAYS_COUNT };
+
+    u32* scratch = vector_resize(&tree->scratch, (u64)nodes_count * ARRAYS_COUNT);
+    u32* arrays[ARRAYS_COUNT] = { 0 };
+    for (u32 i = 0; i < ARRAYS_COUNT; ++i) {
+        arrays[i] = scratch + (u64)nodes_count * i;
+    }
+
+    u32* num = arrays[NUM];
+    u32* vertex = arrays[VERTEX];
+    u32* parent = arrays[PARENT];
+    u32* semi = arrays[SEMI];
+    u32* doms = arrays[IDOM];
+    u32* bucket_head = arrays[BUCKET_HEAD];
+    u32* bucket_next = arrays[BUCKET_NEXT];
+
+    for (u32 id = 0; id < nodes_count; ++id) {
+        num[id] = CFG_NULL_NODE;
+    }
+
+    // Everything below works on the preorder numbers.
+    const u32 count = number_blocks(tree, graph, num, vertex, parent);
+    for (u32 w = 0; w < count; ++w) {
+        semi[w] = w;
+        arrays[LABEL][w] = w;
+        arrays[ANCESTOR][w] = CFG_NULL_NODE;
+        bucket_head[w] = CFG_NULL_NODE;
+        doms[w] = CFG_NULL_NODE;
+    }
+
+    DominatorForest forest = {
+        .semi = semi,
+        .ancestor = arrays[ANCESTOR],
+        .label = arrays[LABEL],
+        .path = &tree->stack,
+    };
+
+    for (u32 w = count - 1; w > 0; --w) {
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(graph, vertex[w], &preds_count);
+
+        for (u32 i = 0; i < preds_count; ++i) {
+            const u32 u = eval(&forest, num[preds[i]]);
+            if (semi[u] < semi[w]) {
+                semi[w] = semi[u];
+            }
+        }
+
+        bucket_next[w] = bucket_head[semi[w]];
+        bucket_head[semi[w]] = w;
+
+        const u32 p = parent[w];
+        forest.ancestor[w] = p;
+
+        for (u32 v = bucket_head[p]; v != CFG_NULL_NODE; v = bucket_next[v]) {
+            const u32 u = eval(&forest, v);
+            doms[v] = semi[u] < semi[v] ? u : p;
+        }
+        bucket_head[p] = CFG_NULL_NODE;
+    }
+
+    // The dominators of the blocks whose idom was deferred precede them in preorder.
+    for (u32 w = 1; w < count; ++w) {
+        if (doms[w] != semi[w]) {
+            doms[w] = doms[doms[w]];
+        }
+    }
+
+    const u32 null_node = CFG_NULL_NODE;
+    const u32 zero = 0;
+    u32* idom = vector_resize(&tree->idom, nodes_count);
+    u32* depth = vector_resize(&tree->depth, nodes_count);
+    vector_fill(&tree->idom, &null_node);
+    vector_fill(&tree->depth, &zero);
+
+    // A dominator always precedes the block in preorder, so its depth is already known.
+    for (u32 w = 1; w < count; ++w) {
+        idom[vertex[w]] = vertex[doms[w]];
+        depth[vertex[w]] = depth[vertex[doms[w]]] + 1;
+    }
+}
+
+static void build_children(DominatorTree* tree, const CFGGraph* graph, const u32 nodes_count) {
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    const u32* idom = (const u32*)tree->idom.items;
+
+    u32* offsets = vector_resize(&tree->child_offsets, nodes_count + 1);
+    memset(offsets, 0, (nodes_count + 1) * sizeof(u32));
+
+    for (u32 i = 1; i < rpo_count; ++i) {
+        ++offsets[idom[rpo[i]] + 1];
+    }
+    for (u32 id = 0; id < nodes_count; ++id) {
+        offsets[id + 1] += offsets[id];
+    }
+
+    // Offsets are used as the insertion cursors and shifted back afterwards.
+    u32* children = vector_resize(&tree->children, offsets[nodes_count]);
+    for (u32 i = 1; i < rpo_count; ++i) {
+        children[offsets[idom[rpo[i]]]++] = rpo[i];
+    }
+
+    for (u32 id = nodes_count; id > 0; --id) {
+        offsets[id] = offsets[id - 1];
+    }
+    offsets[0] = 0;
+}
+
+// Iterative depth first walk of the tree, which numbers the intervals and records the preorder.
+static void build_intervals(DominatorTree* tree, const u32 nodes_count) {
+    const u32 null_node = CFG_NULL_NODE;
+    u32* pre = vector_resize(&tree->pre, nodes_count);
+    u32* post = vector_resize(&tree->post, nodes_count);
+    vector_fill(&tree->pre, &null_node);
+    vector_fill(&tree->post, &null_node);
+
+    vector_clear(&tree->preorder);
+    vector_clear(&tree->stack);
+
+    u32 pre_count = 0;
+    u32 post_count = 0;
+
+    const u32 zero = 0;
+    pre[tree->entry] = pre_count++;
+    vector_push_back(&tree->preorder, &tree->entry);
+    vector_push_back(&tree->stack, &tree->entry);
+    vector_push_back(&tree->stack, &zero);
+
+    while (tree->stack.items_count > 0) {
+        u32* top = (u32*)tree->stack.items + tree->stack.items_count - 2;
+        const u32 id = top[0];
+
+        u32 count = 0;
+        const u32* children = dominator_tree_get_children(tree, id, &count);
+
+        if (top[1] == count) {
+            post[id] = post_count++;
+            tree->stack.items_count -= 2;
+            continue;
+        }
+
+        const u32 child = children[top[1]++];
+        pre[child] = pre_count++;
+        vector_push_back(&tree->preorder, &child);
+        vector_push_back(&tree->stack, &child);
+        vector_push_back(&tree->stack, &zero);
+    }
+}
+
+// Cooper-Harvey-Kennedy: every predecessor of a join point walks up to the idom of the join,
+// and the join is in the frontier of every block passed on the way.
+static void build_frontiers(DominatorTree* tree, const CFGGraph* graph, const u32 nodes_count) {
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    const u32* idom = (const u32*)tree->idom.items;
+
+    // The offsets double as the last join added to each frontier, which drops duplicates.
+    u32* offsets = vector_resize(&tree->frontier_offsets, nodes_count + 1);
+    for (u32 id = 0; id <= nodes_count; ++id) {
+        offsets[id] = CFG_NULL_NODE;
+    }
+
+    vector_clear(&tree->stack);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 join = rpo[i];
+
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(graph, join, &preds_count);
+        if (preds_count < 2) {
+            continue;
+        }
+
+        for (u32 j = 0; j < preds_count; ++j) {
+            for (u32 runner = preds[j]; runner != idom[join] && runner != CFG_NULL_NODE; runner = idom[runner]) {
+                if (offsets[runner] == join) {
+                    break;
+                }
+                offsets[runner] = join;
+
+                vector_push_back(&tree->stack, &runner);
+                vector_push_back(&tree->stack, &join);
+            }
+        }
+    }
+
+    const u32 pairs_count = (u32)(tree->stack.items_count / 2);
+    const u32* pairs = (const u32*)tree->stack.items;
+
+    memset(offsets, 0, (nodes_count + 1) * sizeof(u32));
+    for (u32 i = 0; i < pairs_count; ++i) {
+        ++offsets[pairs[i * 2] + 1];
+    }
+    for (u32 id = 0; id < nodes_count; ++id) {
+        offsets[id + 1] += offsets[id];
+    }
+
+    u32* frontiers = vector_resize(&tree->frontiers, pairs_count);
+    for (u32 i = 0; i < pairs_count; ++i) {
+        frontiers[offsets[pairs[i * 2]]++] = pairs[i * 2 + 1];
+    }
+
+    for (u32 id = nodes_count; id > 0; --id) {
+        offsets[id] = offsets[id - 1];
+    }
+    offsets[0] = 0;
+}
+
+void dominator_tree_build(DominatorTree* tree, const CFGGraph* graph) {
+    assert(tree != NULL && graph != NULL);
+    assert(graph->entry != CFG_NULL_NODE);
+
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+
+    tree->entry = graph->entry;
+    tree->graph_version = graph->version;
+
+    build_idoms(tree, graph, nodes_count);
+    build_children(tree, graph, nodes_count);
+    build_intervals(tree, nodes_count);
+    build_frontiers(tree, graph, nodes_count);
+}
+
+bool is_dominator_tree_valid(const DominatorTree* tree, const CFGGraph* graph) {
+    assert(tree != NULL && graph != NULL);
+
+    return tree->entry != CFG_NULL_NODE && tree->graph_version == graph->version;
+}
+
+u32 dominator_tree_get_idom(const DominatorTree* tree, const u32 id) {
+    assert(tree != NULL && id < tree->idom.items_count);
+
+    return ((const u32*)tree->idom.items)[id];
+}
+
+u32 dominator_tree_get_depth(const DominatorTree* tree, const u32 id) {
+    assert(tree != NULL && id < tree->depth.items_count);
+
+    return ((const u32*)tree->depth.items)[id];
+}
+
+const u32* dominator_tree_get_children(const DominatorTree* tree, const u32 id, u32* count) {
+    assert(tree != NULL && count != NULL);
+    assert(id + 1 < tree->child_offsets.items_count);
+
+    const u32* offsets = (const u32*)tree->child_offsets.items;
+    *count = offsets[id + 1] - offsets[id];
+
+    return (const u32*)tree->children.items + offsets[id];
+}
+
+const u32* dominator_tree_get_preorder(const DominatorTree* tree, u32* count) {
+    assert(tree != NULL && count != NULL);
+
+    *count = (u32)tree->preorder.items_count;
+    return (const u32*)tree->preorder.items;
+}
+
+const u32* dominator_tree_get_frontier(const DominatorTree* tree, const u32 id, u32* count) {
+    assert(tree != NULL && count != NULL);
+    assert(id + 1 < tree->frontier_offsets.items_count);
+
+    const u32* offsets = (const u32*)tree->frontier_offsets.items;
+    *count = offsets[id + 1] - offsets[id];
+
+    return (const u32*)tree->frontiers.items + offsets[id];
+}
+
+bool dominates(const DominatorTree* tree, const u32 a, const u32 b) {
+    assert(tree != NULL && a < tree->pre.items_count && b < tree->pre.items_count);
+
+    const u32* pre = (const u32*)tree->pre.items;
+    const u32* post = (const u32*)tree->post.items;
+
+    if (pre[a] == CFG_NULL_NODE || pre[b] == CFG_NULL_NODE) {
+        return false;
+    }
+    return pre[a] <= pre[b] && post[b] <= post[a];
+}
+
+bool strictly_dominates(const DominatorTree* tree, const u32 a, const u32 b) {
+    return a != b && dominates(tree, a, b);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "vanec/analysis/liveness.h"
+
+#include <assert.h>
+
+Liveness liveness_create(void) {
+    return (Liveness) {
+        .problem = dataflow_problem_create(),
+        .reg_bits = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .bit_regs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+}
+
+void liveness_free(Liveness* liveness) {
+    if (liveness == NULL) {
+        return;
+    }
+
+    dataflow_problem_free(&liveness->problem);
+    vector_free(&liveness->reg_bits);
+    vector_free(&liveness->bit_regs);
+}
+
+void liveness_clear(Liveness* liveness) {
+    assert(liveness != NULL);
+
+    dataflow_problem_clear(&liveness->problem);
+    vector_clear(&liveness->reg_bits);
+    vector_clear(&liveness->bit_regs);
+}
+
+// gen holds the registers read before any definition in the block, kill the ones defined in it.
+static void build_block_sets(Liveness* liveness, const CFGContext* ctx, const u32 block) {
+    const IRFunction* func = &ctx->ir;
+    DataflowProblem* problem = &liveness->problem;
+    const u32* bits = (const u32*)liveness->reg_bits.items;
+
+    u64* gen = dataflow_get_gen(problem, block);
+    u64* kill = dataflow_get_kill(problem, block);
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+
+        if (instr->op == IR_OP_PHI) {
+            const u32* incoming = ir_function_get_list(func, instr->as.phi.first);
+            for (u32 j = 0; j < instr->as.phi.count; ++j) {
+                if (incoming[j * 2 + 1] != IR_NULL_REG) {
+                    bit_set_add(dataflow_get_seed(problem, incoming[j * 2]), bits[incoming[j * 2 + 1]]);
+                }
+            }
+        }
+        else {
+            const u32 uses_count = ir_function_get_uses_count(func, instr);
+            for (u32 j = 0; j < uses_count; ++j) {
+                const u32 reg = *ir_function_get_use_ref(func, instr, j);
+                if (reg != IR_NULL_REG && bits[reg] != IR_NULL_REG && !bit_set_contains(kill, bits[reg])) {
+                    bit_set_add(gen, bits[reg]);
+                }
+            }
+        }
+
+        if (instr->dst != IR_NULL_REG && bits[instr->dst] != IR_NULL_REG) {
+            bit_set_add(kill, bits[instr->dst]);
+        }
+    }
+}
+
+void liveness_build(Liveness* liveness, const CFGContext* ctx) {
+    assert(liveness != NULL && ctx != NULL);
+
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+
+    const u32 bits_count = dataflow_number_global_regs(ctx, &liveness->reg_bits, &liveness->bit_regs);
+    dataflow_problem_init(&liveness->problem, DATAFLOW_BACKWARD, DATAFLOW_UNION, nodes_count, bits_count);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    for (u32 i = 0; i < rpo_count; ++i) {
+        build_block_sets(liveness, ctx, rpo[i]);
+    }
+
+    dataflow_solve(&liveness->problem, graph);
+}
+
+bool is_live_in(const Liveness* liveness, const u32 block, const u32 reg) {
+    assert(liveness != NULL && reg < liveness->reg_bits.items_count);
+
+    const u32 bit = ((const u32*)liveness->reg_bits.items)[reg];
+    return bit != IR_NULL_REG && bit_set_contains(dataflow_get_in(&liveness->problem, block), bit);
+}
+
+bool is_live_out(const Liveness* liveness, const u32 block, const u32 reg) {
+    assert(liveness != NULL && reg < liveness->reg_bits.items_count);
+
+    const u32 bit = ((const u32*)liveness->reg_bits.items)[reg];
+    return bit != IR_NULL_REG && bit_set_contains(dataflow_get_out(&liveness->problem, block), bit);
+}
+
+u32 liveness_get_bit_reg(const Liveness* liveness, const u32 bit) {
+    assert(liveness != NULL && bit < liveness->bit_regs.items_count);
+
+    return ((const u32*)liveness->bit_regs.items)[bit];
+}
+
+const u64* liveness_get_live_in(const Liveness* liveness, const u32 block) {
+    assert(liveness != NULL);
+
+    return dataflow_get_in(&liveness->problem, block);
+}
+
+const u64* liveness_get_live_out(const Liveness* liveness, const u32 block) {
+    assert(liveness != NULL);
+
+    return dataflow_get_out(&liveness->problem, block);
+}
\ No newline at end of file
@@ -0,0 +1,419 @@
+#include "vanec/analysis/loop_forest.h"
+
+#include <assert.h>
+#include <string.h>
+
+LoopForest loop_forest_create(void) {
+    return (LoopForest) {
+        .loops = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(Loop), NULL, false),
+        .block_loops = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .blocks = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .latches = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .exits = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .scratch = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .entry = CFG_NULL_NODE,
+        .graph_version = 0,
+    };
+}
+
+void loop_forest_free(LoopForest* forest) {
+    if (forest == NULL) {
+        return;
+    }
+
+    vector_free(&forest->loops);
+    vector_free(&forest->block_loops);
+    vector_free(&forest->blocks);
+    vector_free(&forest->latches);
+    vector_free(&forest->exits);
+    vector_free(&forest->scratch);
+    vector_free(&forest->stack);
+}
+
+void loop_forest_clear(LoopForest* forest) {
+    assert(forest != NULL);
+
+    vector_clear(&forest->loops);
+    vector_clear(&forest->block_loops);
+    vector_clear(&forest->blocks);
+    vector_clear(&forest->latches);
+    vector_clear(&forest->exits);
+    vector_clear(&forest->scratch);
+    vector_clear(&forest->stack);
+
+    forest->entry = CFG_NULL_NODE;
+    forest->graph_version = 0;
+}
+
+static Loop* get_loops(const LoopForest* forest) {
+    return (Loop*)forest->loops.items;
+}
+
+// Loops found while discovering, before they are put in preorder.
+typedef struct {
+    u32* owner;     // per block, the innermost loop found so far
+    u32* header;    // per loop
+    u32* parent;    // per loop
+    u32* root;      // per loop, union-find links towards the outermost loop found so far
+    u32 count;
+} LoopDiscovery;
+
+static u32 find_root(u32* root, u32 loop) {
+    while (root[loop] != loop) {
+        root[loop] = root[root[loop]];
+        loop = root[loop];
+    }
+    return loop;
+}
+
+static void push_preds_in_loop(Vector* stack, const CFGGraph* graph, const DominatorTree* tree, const u32 header, const u32 block) {
+    u32 preds_count = 0;
+    const u32* preds = cfg_graph_get_preds(graph, block, &preds_count);
+
+    for (u32 i = 0; i < preds_count; ++i) {
+        if (dominates(tree, header, preds[i])) {
+            vector_push_back(stack, &preds[i]);
+        }
+    }
+}
+
+// Headers are visited in reverse preorder of the dominator tree, so inner loops are found first.
+// The walk back from the latches of a loop skips over the inner loops it meets
+// by continuing from their outermost header, which becomes a subloop of the loop.
+static void discover_loops(LoopForest* forest, const CFGGraph* graph, const DominatorTree* tree, LoopDiscovery* found) {
+    u32 preorder_count = 0;
+    const u32* preorder = dominator_tree_get_preorder(tree, &preorder_count);
+
+    for (u32 i = preorder_count; i > 0; --i) {
+        const u32 header = preorder[i - 1];
+
+        vector_clear(&forest->stack);
+        push_preds_in_loop(&forest->stack, graph, tree, header, header);
+        if (forest->stack.items_count == 0) {
+            continue;
+        }
+
+        const u32 loop = found->count++;
+        found->header[loop] = header;
+        found->parent[loop] = CFG_NULL_LOOP;
+        found->root[loop] = loop;
+        found->owner[header] = loop;
+
+        while (forest->stack.items_count > 0) {
+            const u32 block = ((const u32*)forest->stack.items)[--forest->stack.items_count];
+
+            if (found->owner[block] == CFG_NULL_LOOP) {
+                found->owner[block] = loop;
+                push_preds_in_loop(&forest->stack, graph, tree, header, block);
+                continue;
+            }
+
+            const u32 sub = find_root(found->root, found->owner[block]);
+            if (sub == loop) {
+                continue;
+            }
+
+            found->parent[sub] = loop;
+            found->root[sub] = loop;
+            push_preds_in_loop(&forest->stack, graph, tree, header, found->header[sub]);
+        }
+    }
+}
+
+// Numbers the loops in preorder of the forest, the children of a loop in preorder of their headers.
+static void order_loops(LoopForest* forest, const LoopDiscovery* found, u32* offsets, u32* children, u32* index) {
+    const u32 count = found->count;
+
+    // The outermost loops are the children of a virtual root numbered count.
+    memset(offsets, 0, (count + 2) * sizeof(u32));
+    for (u32 loop = 0; loop < count; ++loop) {
+        const u32 parent = found->parent[loop] == CFG_NULL_LOOP ? count : found->parent[loop];
+        ++offsets[parent + 1];
+    }
+    for (u32 loop = 0; loop <= count; ++loop) {
+        offsets[loop + 1] += offsets[loop];
+    }
+    for (u32 loop = count; loop > 0; --loop) {
+        const u32 parent = found->parent[loop - 1] == CFG_NULL_LOOP ? count : found->parent[loop - 1];
+        children[offsets[parent]++] = loop - 1;
+    }
+    for (u32 loop = count + 1; loop > 0; --loop) {
+        offsets[loop] = offsets[loop - 1];
+    }
+    offsets[0] = 0;
+
+    vector_clear(&forest->loops);
+    vector_clear(&forest->stack);
+
+    const u32 root = count;
+    vector_push_back(&forest->stack, &root);
+    vector_push_back(&forest->stack, &offsets[count]);
+
+    while (forest->stack.items_count > 0) {
+        u32* top = (u32*)forest->stack.items + forest->stack.items_count - 2;
+        const u32 loop = top[0];
+
+        if (top[1] == offsets[loop + 1]) {
+            if (loop != root) {
+                get_loops(forest)[index[loop]].end = (u32)forest->loops.items_count;
+            }
+            forest->stack.items_count -= 2;
+            continue;
+        }
+
+        const u32 child = children[top[1]++];
+        const u32 parent = loop == root ? CFG_NULL_LOOP : index[loop];
+
+        index[child] = (u32)forest->loops.items_count;
+        const Loop item = {
+            .header = found->header[child],
+            .parent = parent,
+            .depth = parent == CFG_NULL_LOOP ? 1 : get_loops(forest)[parent].depth + 1,
+            .preheader = CFG_NULL_NODE,
+        };
+        vector_push_back(&forest->loops, &item);
+
+        vector_push_back(&forest->stack, &child);
+        vector_push_back(&forest->stack, &offsets[child]);
+    }
+}
+
+// Sorts the blocks by their innermost loop, in RPO inside of every loop, so the header comes first.
+static void collect_blocks(LoopForest* forest, const CFGGraph* graph, u32* offsets) {
+    const u32 loops_count = loop_forest_get_loops_count(forest);
+    const u32* block_loops = (const u32*)forest->block_loops.items;
+    Loop* loops = get_loops(forest);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+
+    memset(offsets, 0, (loops_count + 1) * sizeof(u32));
+    for (u32 i = 0; i < rpo_count; ++i) {
+        if (block_loops[rpo[i]] != CFG_NULL_LOOP) {
+            ++offsets[block_loops[rpo[i]] + 1];
+        }
+    }
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        offsets[loop + 1] += offsets[loop];
+    }
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        loops[loop].blocks_begin = offsets[loop];
+        loops[loop].blocks_count = offsets[loops[loop].end] - offsets[loop];
+    }
+
+    u32* blocks = vector_resize(&forest->blocks, offsets[loops_count]);
+    for (u32 i = 0; i < rpo_count; ++i) {
+        if (block_loops[rpo[i]] != CFG_NULL_LOOP) {
+            blocks[offsets[block_loops[rpo[i]]]++] = rpo[i];
+        }
+    }
+}
+
+static void collect_latches_and_preheaders(LoopForest* forest, const CFGGraph* graph) {
+    const u32 loops_count = loop_forest_get_loops_count(forest);
+    vector_clear(&forest->latches);
+
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        Loop* item = get_loops(forest) + loop;
+        item->latches_begin = (u32)forest->latches.items_count;
+
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(graph, item->header, &preds_count);
+
+        u32 outside_count = 0;
+        u32 outside = CFG_NULL_NODE;
+        for (u32 i = 0; i < preds_count; ++i) {
+            if (loop_contains_block(forest, loop, preds[i])) {
+                vector_push_back(&forest->latches, &preds[i]);
+            }
+            else {
+                ++outside_count;
+                outside = preds[i];
+            }
+        }
+        item->latches_count = (u32)forest->latches.items_count - item->latches_begin;
+
+        u32 succs_count = 0;
+        if (outside_count == 1) {
+            cfg_graph_get_succs(graph, outside, &succs_count);
+        }
+        item->preheader = succs_count == 1 ? outside : CFG_NULL_NODE;
+    }
+}
+
+// An edge leaving a block exits its innermost loop and the loops around it up to the first one
+// containing the target, so every exit is found from a single pass over the edges.
+static void collect_exits(LoopForest* forest, const CFGGraph* graph, const u32 nodes_count) {
+    const u32 loops_count = loop_forest_get_loops_count(forest);
+    const u32* block_loops = (const u32*)forest->block_loops.items;
+
+    vector_clear(&forest->stack);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 innermost = block_loops[rpo[i]];
+        if (innermost == CFG_NULL_LOOP) {
+            continue;
+        }
+
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, rpo[i], &succs_count);
+
+        for (u32 j = 0; j < succs_count; ++j) {
+            for (u32 loop = innermost; loop != CFG_NULL_LOOP && !loop_contains_block(forest, loop, succs[j]); loop = get_loops(forest)[loop].parent) {
+                vector_push_back(&forest->stack, &loop);
+                vector_push_back(&forest->stack, &succs[j]);
+            }
+        }
+    }
+
+    const u32 pairs_count = (u32)(forest->stack.items_count / 2);
+    const u32* pairs = (const u32*)forest->stack.items;
+
+    u32* offsets = vector_resize(&forest->scratch, (u64)loops_count + 1 + nodes_count);
+    u32* stamps = offsets + loops_count + 1;
+
+    memset(offsets, 0, (loops_count + 1) * sizeof(u32));
+    for (u32 i = 0; i < pairs_count; ++i) {
+        ++offsets[pairs[i * 2] + 1];
+    }
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        offsets[loop + 1] += offsets[loop];
+    }
+
+    u32* exits = vector_resize(&forest->exits, pairs_count);
+    for (u32 i = 0; i < pairs_count; ++i) {
+        exits[offsets[pairs[i * 2]]++] = pairs[i * 2 + 1];
+    }
+
+    // The cursors ended at the start of the next loop, the duplicates are dropped in place.
+    for (u32 id = 0; id < nodes_count; ++id) {
+        stamps[id] = CFG_NULL_LOOP;
+    }
+
+    u32 written = 0;
+    u32 begin = 0;
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        Loop* item = get_loops(forest) + loop;
+        item->exits_begin = written;
+
+        for (u32 i = begin; i < offsets[loop]; ++i) {
+            if (stamps[exits[i]] != loop) {
+                stamps[exits[i]] = loop;
+                exits[written++] = exits[i];
+            }
+        }
+
+        item->exits_count = written - item->exits_begin;
+        begin = offsets[loop];
+    }
+    forest->exits.items_count = written;
+}
+
+void loop_forest_build(LoopForest* forest, const CFGGraph* graph, const DominatorTree* tree) {
+    assert(forest != NULL && graph != NULL && tree != NULL);
+    assert(is_dominator_tree_valid(tree, graph));
+
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+
+    forest->entry = graph->entry;
+    forest->graph_version = graph->version;
+
+    // There is at most one loop per block.
+    u32* scratch = vector_resize(&forest->scratch, (u64)nodes_count * 7 + 2);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        scratch[id] = CFG_NULL_LOOP;
+    }
+
+    LoopDiscovery found = {
+        .owner = scratch,
+        .header = scratch + nodes_count,
+        .parent = scratch + nodes_count * 2,
+        .root = scratch + nodes_count * 3,
+        .count = 0,
+    };
+    discover_loops(forest, graph, tree, &found);
+
+    u32* index = scratch + nodes_count * 4;
+    u32* children = scratch + nodes_count * 5;
+    u32* offsets = scratch + nodes_count * 6;
+    order_loops(forest, &found, offsets, children, index);
+
+    u32* block_loops = vector_resize(&forest->block_loops, nodes_count);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        block_loops[id] = found.owner[id] == CFG_NULL_LOOP ? CFG_NULL_LOOP : index[found.owner[id]];
+    }
+
+    collect_blocks(forest, graph, offsets);
+    collect_latches_and_preheaders(forest, graph);
+    collect_exits(forest, graph, nodes_count);
+}
+
+bool is_loop_forest_valid(const LoopForest* forest, const CFGGraph* graph) {
+    assert(forest != NULL && graph != NULL);
+
+    return forest->entry != CFG_NULL_NODE && forest->graph_version == graph->version;
+}
+
+u32 loop_forest_get_loops_count(const LoopForest* forest) {
+    assert(forest != NULL);
+
+    return (u32)forest->loops.items_count;
+}
+
+const Loop* loop_forest_get_loop(const LoopForest* forest, const u32 loop) {
+    assert(forest != NULL && loop < forest->loops.items_count);
+
+    return get_loops(forest) + loop;
+}
+
+u32 loop_forest_get_block_loop(const LoopForest* forest, const u32 block) {
+    assert(forest != NULL && block < forest->block_loops.items_count);
+
+    return ((const u32*)forest->block_loops.items)[block];
+}
+
+u32 loop_forest_get_block_depth(const LoopForest* forest, const u32 block) {
+    const u32 loop = loop_forest_get_block_loop(forest, block);
+    return loop == CFG_NULL_LOOP ? 0 : get_loops(forest)[loop].depth;
+}
+
+const u32* loop_forest_get_blocks(const LoopForest* forest, const u32 loop, u32* count) {
+    assert(count != NULL);
+
+    const Loop* item = loop_forest_get_loop(forest, loop);
+    *count = item->blocks_count;
+
+    return (const u32*)forest->blocks.items + item->blocks_begin;
+}
+
+const u32* loop_forest_get_latches(const LoopForest* forest, const u32 loop, u32* count) {
+    assert(count != NULL);
+
+    const Loop* item = loop_forest_get_loop(forest, loop);
+    *count = item->latches_count;
+
+    return (const u32*)forest->latches.items + item->latches_begin;
+}
+
+const u32* loop_forest_get_exits(const LoopForest* forest, const u32 loop, u32* count) {
+    assert(count != NULL);
+
+    const Loop* item = loop_forest_get_loop(forest, loop);
+    *count = item->exits_count;
+
+    return (const u32*)forest->exits.items + item->exits_begin;
+}
+
+bool loop_contains_loop(const LoopForest* forest, const u32 outer, const u32 inner) {
+    assert(forest != NULL && outer < forest->loops.items_count);
+
+    return inner != CFG_NULL_LOOP && outer <= inner && inner < get_loops(forest)[outer].end;
+}
+
+bool loop_contains_block(const LoopForest* forest, const u32 loop, const u32 block) {
+    return loop_contains_loop(forest, loop, loop_forest_get_block_loop(forest, block));
+}
\ No newline at end of file
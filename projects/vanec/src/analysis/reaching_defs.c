@@ -0,0 +1,192 @@
+#include "vanec/analysis/reaching_defs.h"
+
+#include <assert.h>
+#include <string.h>
+
+ReachingDefs reaching_defs_create(void) {
+    return (ReachingDefs) {
+        .problem = dataflow_problem_create(),
+        .def_instrs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .instr_defs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_def_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_defs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_bits = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .bit_regs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+}
+
+void reaching_defs_free(ReachingDefs* defs) {
+    if (defs == NULL) {
+        return;
+    }
+
+    dataflow_problem_free(&defs->problem);
+    vector_free(&defs->def_instrs);
+    vector_free(&defs->instr_defs);
+    vector_free(&defs->reg_def_offsets);
+    vector_free(&defs->reg_defs);
+    vector_free(&defs->reg_bits);
+    vector_free(&defs->bit_regs);
+}
+
+void reaching_defs_clear(ReachingDefs* defs) {
+    assert(defs != NULL);
+
+    dataflow_problem_clear(&defs->problem);
+    vector_clear(&defs->def_instrs);
+    vector_clear(&defs->instr_defs);
+    vector_clear(&defs->reg_def_offsets);
+    vector_clear(&defs->reg_defs);
+    vector_clear(&defs->reg_bits);
+    vector_clear(&defs->bit_regs);
+}
+
+// Numbers the definitions of the global registers in the reachable blocks and groups them by register.
+static void number_defs(ReachingDefs* defs, const CFGContext* ctx) {
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+
+    dataflow_number_global_regs(ctx, &defs->reg_bits, &defs->bit_regs);
+    const u32* reg_bits = (const u32*)defs->reg_bits.items;
+
+    u32* instr_defs = vector_resize(&defs->instr_defs, ir_function_get_instrs_count(func));
+    memset(instr_defs, 0xFF, defs->instr_defs.items_count * sizeof(u32));
+    vector_clear(&defs->def_instrs);
+
+    u32* offsets = vector_resize(&defs->reg_def_offsets, regs_count + 1);
+    memset(offsets, 0, (regs_count + 1) * sizeof(u32));
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            const u32 index = node->instrs_begin + j;
+            const IRInstr* instr = ir_function_get_instr(func, index);
+            if (instr->dst == IR_NULL_REG || reg_bits[instr->dst] == IR_NULL_REG) {
+                continue;
+            }
+
+            instr_defs[index] = (u32)defs->def_instrs.items_count;
+            vector_push_back(&defs->def_instrs, &index);
+            ++offsets[instr->dst + 1];
+        }
+    }
+
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        offsets[reg + 1] += offsets[reg];
+    }
+
+    const u32 defs_count = reaching_defs_get_defs_count(defs);
+    const u32* def_instrs = (const u32*)defs->def_instrs.items;
+    u32* reg_defs = vector_resize(&defs->reg_defs, defs_count);
+
+    for (u32 def = 0; def < defs_count; ++def) {
+        reg_defs[offsets[ir_function_get_instr(func, def_instrs[def])->dst]++] = def;
+    }
+
+    for (u32 reg = regs_count; reg > 0; --reg) {
+        offsets[reg] = offsets[reg - 1];
+    }
+    offsets[0] = 0;
+}
+
+// gen holds the last definition of every register defined in the block, kill all the definitions of those registers.
+// The block is walked backwards, a definition is generated when its register is not defined again after it.
+static void build_block_sets(ReachingDefs* defs, const CFGContext* ctx, const u32 block, u32* stamps) {
+    const IRFunction* func = &ctx->ir;
+    const u32* instr_defs = (const u32*)defs->instr_defs.items;
+
+    u64* gen = dataflow_get_gen(&defs->problem, block);
+    u64* kill = dataflow_get_kill(&defs->problem, block);
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    for (u32 i = node->instrs_count; i > 0; --i) {
+        const u32 index = node->instrs_begin + i - 1;
+        const u32 reg = ir_function_get_instr(func, index)->dst;
+        if (reg == IR_NULL_REG || instr_defs[index] == IR_NULL_REG || stamps[reg] == block) {
+            continue;
+        }
+        stamps[reg] = block;
+
+        bit_set_add(gen, instr_defs[index]);
+
+        u32 count = 0;
+        const u32* reg_defs = reaching_defs_get_reg_defs(defs, reg, &count);
+        for (u32 j = 0; j < count; ++j) {
+            bit_set_add(kill, reg_defs[j]);
+        }
+    }
+}
+
+void reaching_defs_build(ReachingDefs* defs, const CFGContext* ctx) {
+    assert(defs != NULL && ctx != NULL);
+
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_graph_get_nodes_count(graph);
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+
+    number_defs(defs, ctx);
+    dataflow_problem_init(&defs->problem, DATAFLOW_FORWARD, DATAFLOW_UNION, nodes_count, reaching_defs_get_defs_count(defs));
+
+    Vector stamps = vector_create(regs_count + 1, sizeof(u32), NULL, false);
+    u32* reg_stamps = vector_resize(&stamps, regs_count);
+    memset(reg_stamps, 0xFF, regs_count * sizeof(u32));
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+    for (u32 i = 0; i < rpo_count; ++i) {
+        build_block_sets(defs, ctx, rpo[i], reg_stamps);
+    }
+
+    vector_free(&stamps);
+
+    dataflow_solve(&defs->problem, graph);
+}
+
+u32 reaching_defs_get_defs_count(const ReachingDefs* defs) {
+    assert(defs != NULL);
+
+    return (u32)defs->def_instrs.items_count;
+}
+
+u32 reaching_defs_get_def_instr(const ReachingDefs* defs, const u32 def) {
+    assert(defs != NULL && def < defs->def_instrs.items_count);
+
+    return ((const u32*)defs->def_instrs.items)[def];
+}
+
+u32 reaching_defs_get_instr_def(const ReachingDefs* defs, const u32 instr) {
+    assert(defs != NULL && instr < defs->instr_defs.items_count);
+
+    return ((const u32*)defs->instr_defs.items)[instr];
+}
+
+const u32* reaching_defs_get_reg_defs(const ReachingDefs* defs, const u32 reg, u32* count) {
+    assert(defs != NULL && count != NULL);
+    assert(reg + 1 < defs->reg_def_offsets.items_count);
+
+    const u32* offsets = (const u32*)defs->reg_def_offsets.items;
+    *count = offsets[reg + 1] - offsets[reg];
+
+    return (const u32*)defs->reg_defs.items + offsets[reg];
+}
+
+bool does_def_reach_block(const ReachingDefs* defs, const u32 def, const u32 block) {
+    assert(defs != NULL && def < reaching_defs_get_defs_count(defs));
+
+    return bit_set_contains(dataflow_get_in(&defs->problem, block), def);
+}
+
+const u64* reaching_defs_get_in(const ReachingDefs* defs, const u32 block) {
+    assert(defs != NULL);
+
+    return dataflow_get_in(&defs->problem, block);
+}
+
+const u64* reaching_defs_get_out(const ReachingDefs* defs, const u32 block) {
+    assert(defs != NULL);
+
+    return dataflow_get_out(&defs->problem, block);
+}
\ No newline at end of file
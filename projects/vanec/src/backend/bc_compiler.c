@@ -0,0 +1,355 @@
+#include "vanec/backend/bc_compiler.h"
+
+#include <assert.h>
+
+typedef struct {
+    u32 dst;
+    u32 src;
+    IRType type;
+} EdgeMove;
+
+typedef struct {
+    BCModule* module;
+    BCFunction* func;
+    const CFGContext* ctx;
+
+    Vector block_offsets;   // u32 per block, the first instruction of the block
+    Vector fixups;          // u32 pairs of a jump and its target block, patched once all the blocks are laid out
+    Vector moves;           // EdgeMove, the pending copies of one edge
+    u32 scratch;            // the extra slot past the registers, breaks the cycles of the copies
+} BCCompiler;
+
+static u16 to_bc_reg(const u32 reg) {
+    return reg == IR_NULL_REG ? BC_NULL_REG : (u16)reg;
+}
+
+static void set_bc_instr_index(BCInstr* instr, const u32 index) {
+    instr->b = (u16)(index & 0xFFFF);
+    instr->c = (u16)(index >> 16);
+}
+
+static BCInstr* get_bc_instr(const BCCompiler* compiler, const u32 index) {
+    return vector_get_ref(&compiler->func->code, index);
+}
+
+static u32 get_code_size(const BCCompiler* compiler) {
+    return (u32)compiler->func->code.items_count;
+}
+
+static u32 emit(BCCompiler* compiler, const BCOpcode op, const IRType type, const u32 a, const u32 b, const u32 c) {
+    const BCInstr instr = {
+        .op = (u8)op,
+        .type = (u8)type,
+        .a = to_bc_reg(a),
+        .b = to_bc_reg(b),
+        .c = to_bc_reg(c),
+    };
+    vector_push_back(&compiler->func->code, &instr);
+
+    return get_code_size(compiler) - 1;
+}
+
+static u32 emit_indexed(BCCompiler* compiler, const BCOpcode op, const IRType type, const u32 a, const u32 index) {
+    const u32 result = emit(compiler, op, type, a, IR_NULL_REG, IR_NULL_REG);
+    set_bc_instr_index(get_bc_instr(compiler, result), index);
+    return result;
+}
+
+static void emit_jump(BCCompiler* compiler, const BCOpcode op, const u32 cond, const u32 block) {
+    const u32 index = emit_indexed(compiler, op, IR_TYPE_VOID, cond, 0);
+
+    vector_push_back(&compiler->fixups, &index);
+    vector_push_back(&compiler->fixups, &block);
+}
+
+// Sets the target of a jump within the function to the next instruction emitted.
+static void patch_jump_here(BCCompiler* compiler, const u32 jump) {
+    set_bc_instr_index(get_bc_instr(compiler, jump), get_code_size(compiler));
+}
+
+static BCOpcode get_bc_opcode(const IROpcode op) {
+    switch (op) {
+    case IR_OP_COPY: return BC_OP_COPY;
+    case IR_OP_NEG: return BC_OP_NEG;
+    case IR_OP_NOT: return BC_OP_NOT;
+    case IR_OP_LNOT: return BC_OP_LNOT;
+    case IR_OP_ADD: return BC_OP_ADD;
+    case IR_OP_SUB: return BC_OP_SUB;
+    case IR_OP_MUL: return BC_OP_MUL;
+    case IR_OP_MULH: return BC_OP_MULH;
+    case IR_OP_DIV: return BC_OP_DIV;
+    case IR_OP_REM: return BC_OP_REM;
+    case IR_OP_AND: return BC_OP_AND;
+    case IR_OP_OR: return BC_OP_OR;
+    case IR_OP_XOR: return BC_OP_XOR;
+    case IR_OP_SHL: return BC_OP_SHL;
+    case IR_OP_SHR: return BC_OP_SHR;
+    case IR_OP_LAND: return BC_OP_LAND;
+    case IR_OP_LOR: return BC_OP_LOR;
+    case IR_OP_EQ: return BC_OP_EQ;
+    case IR_OP_NE: return BC_OP_NE;
+    case IR_OP_LT: return BC_OP_LT;
+    case IR_OP_LE: return BC_OP_LE;
+    case IR_OP_GT: return BC_OP_GT;
+    case IR_OP_GE: return BC_OP_GE;
+    default: return BC_OP_NOP;
+    };
+}
+
+#pragma region EDGES
+
+// Collects the copies the phis of the target need on one edge out of the block.
+// Copies of a register into itself and of undefined values are dropped.
+static u32 collect_edge_moves(BCCompiler* compiler, const u32 block, const u32 slot) {
+    const CFGContext* ctx = compiler->ctx;
+
+    vector_clear(&compiler->moves);
+
+    u32 succs_count = 0;
+    const u32* succs = cfg_graph_get_succs(&ctx->graph, block, &succs_count);
+    const u32* pred_indices = cfg_graph_get_succ_pred_indices(&ctx->graph, block, &succs_count);
+    assert(slot < succs_count);
+
+    const CFGNode* succ = cfg_context_get_node(ctx, succs[slot]);
+    for (u32 i = 0; i < succ->instrs_count; ++i) {
+        const IRInstr* phi = ir_function_get_instr(&ctx->ir, succ->instrs_begin + i);
+        if (phi->op != IR_OP_PHI) {
+            break;
+        }
+
+        const u32 src = ir_function_get_list(&ctx->ir, phi->as.phi.first)[pred_indices[slot] * 2 + 1];
+        if (src == IR_NULL_REG || src == phi->dst) {
+            continue;
+        }
+
+        const EdgeMove move = { .dst = phi->dst, .src = src, .type = phi->type };
+        vector_push_back(&compiler->moves, &move);
+    }
+
+    return (u32)compiler->moves.items_count;
+}
+
+static bool is_move_source(const EdgeMove* moves, const u32 count, const u32 reg) {
+    for (u32 i = 0; i < count; ++i) {
+        if (moves[i].src == reg) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The copies of an edge happen at once, so a copy is only emitted when no other one still reads its destination.
+// When only cycles are left, the value of one destination is saved into the scratch slot and read from there.
+static void emit_edge_moves(BCCompiler* compiler) {
+    EdgeMove* moves = (EdgeMove*)compiler->moves.items;
+    u32 count = (u32)compiler->moves.items_count;
+
+    while (count > 0) {
+        bool is_progress = false;
+
+        for (u32 i = 0; i < count;) {
+            if (is_move_source(moves, count, moves[i].dst)) {
+                ++i;
+                continue;
+            }
+
+            emit(compiler, BC_OP_COPY, moves[i].type, moves[i].dst, moves[i].src, IR_NULL_REG);
+            moves[i] = moves[--count];
+            is_progress = true;
+        }
+
+        if (!is_progress) {
+            const u32 saved = moves[0].dst;
+            emit(compiler, BC_OP_COPY, ir_function_get_reg(&compiler->ctx->ir, saved)->type, compiler->scratch, saved, IR_NULL_REG);
+
+            for (u32 i = 0; i < count; ++i) {
+                if (moves[i].src == saved) {
+                    moves[i].src = compiler->scratch;
+                }
+            }
+        }
+    }
+
+    vector_clear(&compiler->moves);
+}
+
+// Emits the copies of the edge and a jump to its target, unless the target is laid out next.
+static void emit_edge(BCCompiler* compiler, const u32 block, const u32 slot, const u32 target, const u32 next) {
+    collect_edge_moves(compiler, block, slot);
+    emit_edge_moves(compiler);
+
+    if (target != next) {
+        emit_jump(compiler, BC_OP_JMP, IR_NULL_REG, target);
+    }
+}
+
+// The conditional jump goes straight to the target of an edge without copies,
+// only when both edges have them the copies of the taken one are skipped over locally.
+static void compile_branch(BCCompiler* compiler, const u32 block, const IRInstr* instr, const u32 next) {
+    const u32 then_block = instr->as.branch.then_block;
+    const u32 else_block = instr->as.branch.else_block;
+
+    const bool has_then_moves = collect_edge_moves(compiler, block, 0) > 0;
+    const bool has_else_moves = collect_edge_moves(compiler, block, 1) > 0;
+
+    if (!has_else_moves && (has_then_moves || then_block == next)) {
+        emit_jump(compiler, BC_OP_BR_FALSE, instr->a, else_block);
+        emit_edge(compiler, block, 0, then_block, next);
+    }
+    else if (!has_then_moves) {
+        emit_jump(compiler, BC_OP_BR_TRUE, instr->a, then_block);
+        emit_edge(compiler, block, 1, else_block, next);
+    }
+    else {
+        const u32 jump = emit_indexed(compiler, BC_OP_BR_FALSE, IR_TYPE_VOID, instr->a, 0);
+        emit_edge(compiler, block, 0, then_block, CFG_NULL_NODE);
+
+        patch_jump_here(compiler, jump);
+        emit_edge(compiler, block, 1, else_block, next);
+    }
+}
+
+#pragma endregion
+
+#pragma region INSTRUCTIONS
+
+static void compile_const(BCCompiler* compiler, const IRInstr* instr) {
+    const i64 value = normalize_ir_value(instr->type, instr->as.imm);
+
+    if (value >= -(i64)0x80000000 && value <= (i64)0x7FFFFFFF) {
+        emit_indexed(compiler, BC_OP_CONST, instr->type, instr->dst, (u32)(value & 0xFFFFFFFF));
+        return;
+    }
+
+    vector_push_back(&compiler->func->constants, &value);
+    emit_indexed(compiler, BC_OP_CONST_WIDE, instr->type, instr->dst, (u32)(compiler->func->constants.items_count - 1));
+}
+
+static void compile_call(BCCompiler* compiler, const IRInstr* instr) {
+    const IRFunction* ir = &compiler->ctx->ir;
+    BCFunction* func = compiler->func;
+
+    const BCCall call = {
+        .callee = bc_module_add_symbol(compiler->module, ir_function_get_string(ir, instr->as.call.callee)),
+        .first = (u32)func->call_args.items_count,
+        .count = instr->as.call.count,
+    };
+
+    const u32* args = ir_function_get_list(ir, instr->as.call.first);
+    for (u32 i = 0; i < instr->as.call.count; ++i) {
+        const u16 arg = to_bc_reg(args[i]);
+        vector_push_back(&func->call_args, &arg);
+    }
+
+    vector_push_back(&func->calls, &call);
+    emit_indexed(compiler, BC_OP_CALL, instr->type, instr->dst, (u32)(func->calls.items_count - 1));
+}
+
+// 'dst = a ? b : c' becomes a branch over two copies.
+static void compile_select(BCCompiler* compiler, const IRInstr* instr) {
+    const u32 branch = emit_indexed(compiler, BC_OP_BR_FALSE, IR_TYPE_VOID, instr->a, 0);
+    emit(compiler, BC_OP_COPY, instr->type, instr->dst, instr->b, IR_NULL_REG);
+    const u32 jump = emit_indexed(compiler, BC_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, 0);
+
+    patch_jump_here(compiler, branch);
+    emit(compiler, BC_OP_COPY, instr->type, instr->dst, instr->c, IR_NULL_REG);
+    patch_jump_here(compiler, jump);
+}
+
+static void compile_instr(BCCompiler* compiler, const u32 block, const IRInstr* instr, const u32 next) {
+    switch (instr->op) {
+    case IR_OP_NOP:
+    case IR_OP_PHI: { /* DO NOTHING */ } break;
+    case IR_OP_CONST: { compile_const(compiler, instr); } break;
+    case IR_OP_STR: {
+        const u32 index = bc_module_add_string(compiler->module, ir_function_get_string(&compiler->ctx->ir, instr->as.str));
+        emit_indexed(compiler, BC_OP_STR, instr->type, instr->dst, index);
+    } break;
+    case IR_OP_SELECT: { compile_select(compiler, instr); } break;
+    case IR_OP_CALL: { compile_call(compiler, instr); } break;
+    case IR_OP_LOAD_ELEM: { emit(compiler, BC_OP_LOAD_ELEM, instr->type, instr->dst, instr->a, instr->b); } break;
+    case IR_OP_STORE_ELEM: { emit(compiler, BC_OP_STORE_ELEM, instr->type, instr->a, instr->b, instr->c); } break;
+    case IR_OP_JMP: {
+        collect_edge_moves(compiler, block, 0);
+        emit_edge_moves(compiler);
+
+        if (instr->as.target != next) {
+            emit_jump(compiler, BC_OP_JMP, IR_NULL_REG, instr->as.target);
+        }
+    } break;
+    case IR_OP_BR: { compile_branch(compiler, block, instr, next); } break;
+    case IR_OP_RET: { emit(compiler, BC_OP_RET, instr->type, instr->a, IR_NULL_REG, IR_NULL_REG); } break;
+    default: {
+        const BCOpcode op = get_bc_opcode(instr->op);
+        assert(op != BC_OP_NOP && "Unreachable");
+
+        emit(compiler, op, instr->type, instr->dst, instr->a, instr->b);
+    } break;
+    };
+}
+
+#pragma endregion
+
+u32 compile_bytecode_function(BCModule* module, const CFGContext* ctx, const char* name, const SourceLoc loc) {
+    assert(module != NULL && ctx != NULL && name != NULL);
+
+    const IRFunction* ir = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(ir);
+
+    if (regs_count + 1 > BC_MAX_REGS_COUNT) {
+        if (module->diag != NULL) {
+            diagnostic_engine_report(module->diag, ERR_FUNCTION_IS_TOO_LARGE, loc, name);
+        }
+        return BC_NULL_FUNCTION;
+    }
+
+    BCCompiler compiler = {
+        .module = module,
+        .func = bc_module_add_function(module, name, loc),
+        .ctx = ctx,
+        .block_offsets = vector_create(cfg_context_get_nodes_count(ctx) + 1, sizeof(u32), NULL, false),
+        .fixups = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(EdgeMove), NULL, false),
+        .scratch = regs_count,
+    };
+
+    BCFunction* func = compiler.func;
+    func->params_count = ir->params_count;
+    func->frame_size = regs_count + 1;
+    func->ret_type = ir->ret_type;
+
+    for (u32 i = 0; i < regs_count; ++i) {
+        const u8 type = (u8)ir_function_get_reg(ir, i)->type;
+        vector_push_back(&func->reg_types, &type);
+    }
+    const u8 scratch_type = IR_TYPE_VOID;
+    vector_push_back(&func->reg_types, &scratch_type);
+
+    u32* block_offsets = vector_resize(&compiler.block_offsets, cfg_context_get_nodes_count(ctx));
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 block = rpo[i];
+        const u32 next = i + 1 < rpo_count ? rpo[i + 1] : CFG_NULL_NODE;
+
+        block_offsets[block] = get_code_size(&compiler);
+
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            compile_instr(&compiler, block, ir_function_get_instr(ir, node->instrs_begin + j), next);
+        }
+    }
+
+    const u32* fixups = (const u32*)compiler.fixups.items;
+    for (u32 i = 0; i < (u32)compiler.fixups.items_count; i += 2) {
+        set_bc_instr_index(get_bc_instr(&compiler, fixups[i]), block_offsets[fixups[i + 1]]);
+    }
+
+    vector_free(&compiler.block_offsets);
+    vector_free(&compiler.fixups);
+    vector_free(&compiler.moves);
+
+    return bc_module_get_functions_count(module) - 1;
+}
\ No newline at end of file
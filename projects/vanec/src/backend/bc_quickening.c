@@ -0,0 +1,32 @@
+#include "vanec/backend/bc_quickening.h"
+
+#include <assert.h>
+
+#define BC_MAX_SEQUENCE_LENGTH 3
+
+void quicken_bytecode_function(BCFunction* func) {
+    assert(func != NULL);
+
+    BCInstr* code = (BCInstr*)func->code.items;
+    const u32 code_size = (u32)func->code.items_count;
+
+    // Going forward every sequence is still made of the compiled opcodes, only the ones behind have been rewritten.
+    // The sequences may overlap, the one that starts at a jump target is then fused too.
+    for (u32 i = 0; i < code_size; ++i) {
+        BCOpcode ops[BC_MAX_SEQUENCE_LENGTH] = { BC_OP_NOP };
+        BCOpcode fused = BC_OP_NOP;
+
+        for (u32 length = BC_MAX_SEQUENCE_LENGTH; length >= 2 && fused == BC_OP_NOP; --length) {
+            if (i + length > code_size) {
+                continue;
+            }
+
+            for (u32 j = 0; j < length; ++j) {
+                ops[j] = (BCOpcode)code[i + j].op;
+            }
+            fused = get_bc_fused_opcode(ops, length);
+        }
+
+        code[i].op = (u8)(fused != BC_OP_NOP ? fused : get_bc_quick_opcode((BCOpcode)code[i].op, (IRType)code[i].type));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,385 @@
+#include "vanec/backend/bytecode.h"
+
+#include <assert.h>
+
+#include "vanec/utils/string_utils.h"
+
+const char* get_bc_opcode_name(const BCOpcode op) {
+    switch (op) {
+#define BC_OPCODE(ID, NAME) case BC_OP_##ID: return NAME;
+#include "vanec/backend/bytecode.def"
+    default: return NULL;
+    };
+}
+
+const char* get_bc_native_name(const BCNative native) {
+    switch (native) {
+#define BC_NATIVE(ID, NAME) case BC_NATIVE_##ID: return NAME;
+#include "vanec/backend/bytecode.def"
+    default: return NULL;
+    };
+}
+
+typedef struct {
+    u8 ops[3];
+    u8 length;
+    u8 fused;
+} BCSequence;
+
+static const BCSequence bc_sequences[] = {
+#define BC_OPCODE(ID, NAME)
+#define BC_FUSED_PAIR(ID, NAME, FIRST, SECOND) { { BC_OP_##FIRST, BC_OP_##SECOND, BC_OP_NOP }, 2, BC_OP_##ID },
+#define BC_FUSED_TRIPLE(ID, NAME, FIRST, SECOND, THIRD) { { BC_OP_##FIRST, BC_OP_##SECOND, BC_OP_##THIRD }, 3, BC_OP_##ID },
+#include "vanec/backend/bytecode.def"
+};
+
+#define BC_SEQUENCES_COUNT (sizeof(bc_sequences) / sizeof(bc_sequences[0]))
+
+typedef struct {
+    u8 base;
+    u8 type;
+    u8 quick;
+} BCQuickVariant;
+
+static const BCQuickVariant bc_quick_variants[] = {
+#define BC_OPCODE(ID, NAME)
+#define BC_QUICK_OPCODE(ID, NAME, BASE, TYPE) { BC_OP_##BASE, IR_TYPE_##TYPE, BC_OP_##ID },
+#include "vanec/backend/bytecode.def"
+};
+
+#define BC_QUICK_VARIANTS_COUNT (sizeof(bc_quick_variants) / sizeof(bc_quick_variants[0]))
+
+BCOpcode get_bc_fused_opcode(const BCOpcode* ops, const u32 count) {
+    assert(ops != NULL);
+
+    for (u32 i = 0; i < BC_SEQUENCES_COUNT; ++i) {
+        const BCSequence* sequence = &bc_sequences[i];
+        if (sequence->length != count) {
+            continue;
+        }
+
+        u32 j = 0;
+        while (j < count && sequence->ops[j] == ops[j]) {
+            ++j;
+        }
+        if (j == count) {
+            return (BCOpcode)sequence->fused;
+        }
+    }
+    return BC_OP_NOP;
+}
+
+BCOpcode get_bc_quick_opcode(const BCOpcode op, const IRType type) {
+    for (u32 i = 0; i < BC_QUICK_VARIANTS_COUNT; ++i) {
+        if (bc_quick_variants[i].base == op && bc_quick_variants[i].type == type) {
+            return (BCOpcode)bc_quick_variants[i].quick;
+        }
+    }
+    return op;
+}
+
+BCOpcode get_bc_base_opcode(const BCOpcode op) {
+    for (u32 i = 0; i < BC_SEQUENCES_COUNT; ++i) {
+        if (bc_sequences[i].fused == op) {
+            return (BCOpcode)bc_sequences[i].ops[0];
+        }
+    }
+    for (u32 i = 0; i < BC_QUICK_VARIANTS_COUNT; ++i) {
+        if (bc_quick_variants[i].quick == op) {
+            return (BCOpcode)bc_quick_variants[i].base;
+        }
+    }
+    return op;
+}
+
+bool is_bc_opcode_quick(const BCOpcode op) {
+    for (u32 i = 0; i < BC_QUICK_VARIANTS_COUNT; ++i) {
+        if (bc_quick_variants[i].quick == op) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void bc_function_free(void* item) {
+    BCFunction* func = item;
+
+    str_free(func->name);
+    vector_free(&func->code);
+    vector_free(&func->constants);
+    vector_free(&func->calls);
+    vector_free(&func->call_args);
+    vector_free(&func->reg_types);
+}
+
+BCModule bc_module_create(DiagnosticEngine* diag) {
+    return (BCModule) {
+        .functions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(BCFunction), &bc_function_free, false),
+        .strings = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char*), &str_free, true),
+        .symbols = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char*), &str_free, true),
+        .diag = diag,
+        .is_linked = false,
+    };
+}
+
+void bc_module_free(BCModule* module) {
+    if (module == NULL) {
+        return;
+    }
+
+    vector_free(&module->functions);
+    vector_free(&module->strings);
+    vector_free(&module->symbols);
+}
+
+void bc_module_clear(BCModule* module) {
+    assert(module != NULL);
+
+    vector_clear(&module->functions);
+    vector_clear(&module->strings);
+    vector_clear(&module->symbols);
+
+    module->is_linked = false;
+}
+
+BCFunction* bc_module_add_function(BCModule* module, const char* name, const SourceLoc loc) {
+    assert(module != NULL && name != NULL);
+    assert(!module->is_linked);
+
+    const BCFunction func = {
+        .name = str_dup(name),
+        .loc = loc,
+        .code = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(BCInstr), NULL, false),
+        .constants = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(i64), NULL, false),
+        .calls = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(BCCall), NULL, false),
+        .call_args = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u16), NULL, false),
+        .reg_types = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .params_count = 0,
+        .frame_size = 0,
+        .ret_type = IR_TYPE_VOID,
+    };
+    vector_push_back(&module->functions, &func);
+
+    return vector_get_ref(&module->functions, module->functions.items_count - 1);
+}
+
+BCFunction* bc_module_get_function(const BCModule* module, const u32 index) {
+    assert(module != NULL);
+    assert(index < module->functions.items_count);
+
+    return vector_get_ref(&module->functions, index);
+}
+
+u32 bc_module_get_functions_count(const BCModule* module) {
+    assert(module != NULL);
+
+    return (u32)module->functions.items_count;
+}
+
+u32 bc_module_find_function(const BCModule* module, const char* name) {
+    assert(module != NULL && name != NULL);
+
+    for (u32 i = 0; i < bc_module_get_functions_count(module); ++i) {
+        if (str_eq(bc_module_get_function(module, i)->name, name)) {
+            return i;
+        }
+    }
+    return BC_NULL_FUNCTION;
+}
+
+u32 bc_module_add_string(BCModule* module, const char* s) {
+    assert(module != NULL && s != NULL);
+
+    char* copy = str_dup(s);
+    vector_push_back(&module->strings, &copy);
+
+    return (u32)(module->strings.items_count - 1);
+}
+
+const char* bc_module_get_string(const BCModule* module, const u32 index) {
+    assert(module != NULL);
+    assert(index < module->strings.items_count);
+
+    return vector_get_ref(&module->strings, index);
+}
+
+u32 bc_module_add_symbol(BCModule* module, const char* name) {
+    assert(module != NULL && name != NULL);
+
+    for (u32 i = 0; i < (u32)module->symbols.items_count; ++i) {
+        if (str_eq(vector_get_ref(&module->symbols, i), name)) {
+            return i;
+        }
+    }
+
+    char* copy = str_dup(name);
+    vector_push_back(&module->symbols, &copy);
+
+    return (u32)(module->symbols.items_count - 1);
+}
+
+static u32 find_native(const char* name) {
+    for (u32 i = 0; i < BC_NATIVES_COUNT; ++i) {
+        if (str_eq(get_bc_native_name((BCNative)i), name)) {
+            return i;
+        }
+    }
+    return BC_NULL_FUNCTION;
+}
+
+bool bc_module_link(BCModule* module) {
+    assert(module != NULL);
+    assert(!module->is_linked);
+
+    // Every symbol is resolved once, the calls then only map their symbol.
+    const u32 symbols_count = (u32)module->symbols.items_count;
+    Vector targets = vector_create(symbols_count + 1, sizeof(u32), NULL, false);
+    Vector is_native = vector_create(symbols_count + 1, sizeof(u8), NULL, false);
+
+    bool result = true;
+    for (u32 i = 0; i < symbols_count; ++i) {
+        const char* name = vector_get_ref(&module->symbols, i);
+
+        u32 target = bc_module_find_function(module, name);
+        u8 native = false;
+        if (target == BC_NULL_FUNCTION) {
+            target = find_native(name);
+            native = target != BC_NULL_FUNCTION;
+        }
+
+        vector_push_back(&targets, &target);
+        vector_push_back(&is_native, &native);
+    }
+
+    for (u32 i = 0; i < bc_module_get_functions_count(module); ++i) {
+        BCFunction* func = bc_module_get_function(module, i);
+
+        BCInstr* code = (BCInstr*)func->code.items;
+        BCCall* calls = (BCCall*)func->calls.items;
+
+        for (u64 j = 0; j < func->code.items_count; ++j) {
+            if (code[j].op != BC_OP_CALL) {
+                continue;
+            }
+
+            BCCall* call = &calls[BC_INSTR_INDEX(&code[j])];
+            const u32 symbol = call->callee;
+
+            call->callee = ((const u32*)targets.items)[symbol];
+            if (call->callee == BC_NULL_FUNCTION) {
+                if (module->diag != NULL) {
+                    diagnostic_engine_report(module->diag, ERR_UNDEFINED_FUNCTION, func->loc, vector_get_ref(&module->symbols, symbol));
+                }
+                result = false;
+                continue;
+            }
+
+            if (((const u8*)is_native.items)[symbol]) {
+                code[j].op = BC_OP_CALL_NATIVE;
+            }
+        }
+    }
+
+    vector_free(&targets);
+    vector_free(&is_native);
+
+    module->is_linked = result;
+    return result;
+}
+
+static void print_bc_reg(FILE* handle, const u16 reg) {
+    if (reg == BC_NULL_REG) {
+        fputs("_", handle);
+        return;
+    }
+    fprintf(handle, "r%u", (unsigned)reg);
+}
+
+static void print_bc_call(FILE* handle, const BCModule* module, const BCFunction* func, const BCInstr* instr) {
+    const BCCall* call = vector_get_ref(&func->calls, BC_INSTR_INDEX(instr));
+
+    const char* callee = NULL;
+    if (!module->is_linked) {
+        callee = vector_get_ref(&module->symbols, call->callee);
+    }
+    else if (instr->op == BC_OP_CALL_NATIVE) {
+        callee = get_bc_native_name((BCNative)call->callee);
+    }
+    else {
+        callee = bc_module_get_function(module, call->callee)->name;
+    }
+
+    fprintf(handle, " %s(", callee);
+
+    const u16* args = (const u16*)func->call_args.items + call->first;
+    for (u32 i = 0; i < call->count; ++i) {
+        if (i != 0) {
+            fputs(", ", handle);
+        }
+        print_bc_reg(handle, args[i]);
+    }
+    putc(')', handle);
+}
+
+void print_bc_function(FILE* handle, const BCModule* module, const BCFunction* func) {
+    assert(handle != NULL && module != NULL && func != NULL);
+
+    fprintf(handle, "function %s, %lu params, %lu slots:\n", func->name, func->params_count, func->frame_size);
+
+    const BCInstr* code = (const BCInstr*)func->code.items;
+    for (u32 i = 0; i < (u32)func->code.items_count; ++i) {
+        const BCInstr* instr = &code[i];
+
+        fprintf(handle, "  %04lu  %s", i, get_bc_opcode_name((BCOpcode)instr->op));
+        if (instr->type != IR_TYPE_VOID && !is_bc_opcode_quick((BCOpcode)instr->op)) {
+            fprintf(handle, ".%s", get_ir_type_name((IRType)instr->type));
+        }
+        putc(' ', handle);
+
+        switch (get_bc_base_opcode((BCOpcode)instr->op)) {
+        case BC_OP_NOP: { /* DO NOTHING */ } break;
+        case BC_OP_CONST: {
+            print_bc_reg(handle, instr->a);
+            fprintf(handle, ", %lld", BC_INSTR_IMM(instr));
+        } break;
+        case BC_OP_CONST_WIDE: {
+            print_bc_reg(handle, instr->a);
+            fprintf(handle, ", %lld", *(const i64*)vector_get_ref(&func->constants, BC_INSTR_INDEX(instr)));
+        } break;
+        case BC_OP_STR: {
+            print_bc_reg(handle, instr->a);
+            fprintf(handle, ", s%lu", BC_INSTR_INDEX(instr));
+        } break;
+        case BC_OP_CALL:
+        case BC_OP_CALL_NATIVE: {
+            print_bc_reg(handle, instr->a);
+            fputs(",", handle);
+            print_bc_call(handle, module, func, instr);
+        } break;
+        case BC_OP_JMP: { fprintf(handle, "@%lu", BC_INSTR_INDEX(instr)); } break;
+        case BC_OP_BR_TRUE:
+        case BC_OP_BR_FALSE: {
+            print_bc_reg(handle, instr->a);
+            fprintf(handle, ", @%lu", BC_INSTR_INDEX(instr));
+        } break;
+        case BC_OP_RET: { print_bc_reg(handle, instr->a); } break;
+        case BC_OP_COPY:
+        case BC_OP_NEG:
+        case BC_OP_NOT:
+        case BC_OP_LNOT: {
+            print_bc_reg(handle, instr->a);
+            fputs(", ", handle);
+            print_bc_reg(handle, instr->b);
+        } break;
+        default: {
+            print_bc_reg(handle, instr->a);
+            fputs(", ", handle);
+            print_bc_reg(handle, instr->b);
+            fputs(", ", handle);
+            print_bc_reg(handle, instr->c);
+        } break;
+        };
+
+        putc('\n', handle);
+    }
+}
\ No newline at end of file
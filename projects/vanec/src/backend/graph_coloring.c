@@ -0,0 +1,769 @@
+#include "vanec/backend/graph_coloring.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vanec/utils/bit_set.h"
+
+#include "vanec/backend/linear_scan.h"
+
+// The bit matrix takes the square of the nodes over two bits, 4 MB at the limit.
+#define GRAPH_COLORING_MAX_NODES 8192
+
+// A use inside a loop costs as much as this many uses outside of it, up to the max depth.
+#define GRAPH_COLORING_LOOP_WEIGHT 10
+#define GRAPH_COLORING_MAX_LOOP_DEPTH 6
+
+#define NULL_NODE ((u32)-1)
+#define NULL_LINK ((u32)-1)
+#define INFINITE_DEGREE ((u32)-1 / 2)
+
+// Every node is in exactly one of the sets of the algorithm, the worklists keep stale entries that are skipped.
+typedef enum {
+    NODE_UNUSED,
+    NODE_PRECOLORED,
+    NODE_SIMPLIFY,
+    NODE_FREEZE,
+    NODE_SPILL,
+    NODE_SELECTED,
+    NODE_COALESCED,
+    NODE_COLORED,
+    NODE_SPILLED,
+} NodeState;
+
+typedef enum {
+    MOVE_WORKLIST,
+    MOVE_ACTIVE,
+    MOVE_COALESCED,
+    MOVE_CONSTRAINED,
+    MOVE_FROZEN,
+} MoveState;
+
+typedef struct {
+    u32 dst;
+    u32 src;
+    u64 weight;
+    MoveState state;
+} Move;
+
+// An item of the adjacency or move list of a node, the lists share one pool.
+typedef struct {
+    u32 value;
+    u32 next;
+} Link;
+
+// The first nodes are the registers of the target, then one per virtual register.
+typedef struct {
+    LiveIntervals* intervals;
+    const RegAllocTarget* target;
+    u32 k;
+    u32 nodes_count;
+
+    Vector adj_matrix;      // u64, a bit per pair of nodes in the lower triangle
+    Vector links;           // Link
+    Vector moves;           // Move
+
+    Vector adj_heads;       // u32 per node, never filled for the precolored ones
+    Vector move_heads;      // u32 per node
+    Vector move_tails;      // u32 per node, so the lists of coalesced nodes are joined at once
+    Vector degrees;         // u32 per node
+    Vector states;          // NodeState per node
+    Vector aliases;         // u32 per node, the node a coalesced one was merged into
+    Vector colors;          // u32 per node, the register or the spill slot
+    Vector costs;           // u64 per node
+    Vector marks;           // u32 per node, the last union of neighbors it was counted in
+
+    Vector simplify_worklist;   // u32 node
+    Vector freeze_worklist;     // u32 node
+    Vector spill_worklist;      // u32 node
+    Vector move_worklist;       // u32 move, the heaviest last
+    Vector select_stack;        // u32 node
+    Vector spilled;             // u32 node
+
+    u32 mark;
+    u32 slots_count;
+} GraphColoring;
+
+static Link* get_link(const GraphColoring* gc, const u32 link) {
+    return (Link*)gc->links.items + link;
+}
+
+static Move* get_move(const GraphColoring* gc, const u32 move) {
+    return (Move*)gc->moves.items + move;
+}
+
+static NodeState get_state(const GraphColoring* gc, const u32 node) {
+    return ((const NodeState*)gc->states.items)[node];
+}
+
+static void set_state(GraphColoring* gc, const u32 node, const NodeState state) {
+    ((NodeState*)gc->states.items)[node] = state;
+}
+
+static u32 get_reg_node(const GraphColoring* gc, const u32 reg) {
+    return gc->k + reg;
+}
+
+static void push_node(Vector* worklist, const u32 node) {
+    vector_push_back(worklist, &node);
+}
+
+// Pops the last node of the worklist still in its set, NULL_NODE when there is none.
+static u32 pop_node(GraphColoring* gc, Vector* worklist, const NodeState state) {
+    while (worklist->items_count > 0) {
+        const u32 node = ((const u32*)worklist->items)[--worklist->items_count];
+        if (get_state(gc, node) == state) {
+            return node;
+        }
+    }
+    return NULL_NODE;
+}
+
+static u64 get_use_weight(const GraphColoring* gc, const u32 position) {
+    const u32 depth = get_live_loop_depth(gc->intervals, position);
+
+    u64 weight = 1;
+    for (u32 i = 0; i < depth && i < GRAPH_COLORING_MAX_LOOP_DEPTH; ++i) {
+        weight *= GRAPH_COLORING_LOOP_WEIGHT;
+    }
+    return weight;
+}
+
+#pragma region GRAPH
+
+static u64 get_matrix_bit(const u32 u, const u32 v) {
+    const u64 hi = u > v ? u : v;
+    const u64 lo = u > v ? v : u;
+    return hi * (hi - 1) / 2 + lo;
+}
+
+static bool is_adjacent(const GraphColoring* gc, const u32 u, const u32 v) {
+    const u64 bit = get_matrix_bit(u, v);
+    return (((const u64*)gc->adj_matrix.items)[bit / BIT_SET_WORD_BITS] >> (bit % BIT_SET_WORD_BITS)) & 1;
+}
+
+static void push_link(GraphColoring* gc, u32* head, const u32 value) {
+    const Link link = { .value = value, .next = *head };
+    vector_push_back(&gc->links, &link);
+    *head = (u32)(gc->links.items_count - 1);
+}
+
+static void add_edge(GraphColoring* gc, const u32 u, const u32 v) {
+    if (u == v || is_adjacent(gc, u, v)) {
+        return;
+    }
+
+    const u64 bit = get_matrix_bit(u, v);
+    ((u64*)gc->adj_matrix.items)[bit / BIT_SET_WORD_BITS] |= (u64)1 << (bit % BIT_SET_WORD_BITS);
+
+    if (get_state(gc, u) != NODE_PRECOLORED) {
+        push_link(gc, (u32*)gc->adj_heads.items + u, v);
+        ++((u32*)gc->degrees.items)[u];
+    }
+    if (get_state(gc, v) != NODE_PRECOLORED) {
+        push_link(gc, (u32*)gc->adj_heads.items + v, u);
+        ++((u32*)gc->degrees.items)[v];
+    }
+}
+
+// A neighbor that is not removed from the graph yet.
+static bool is_adjacent_in_graph(const GraphColoring* gc, const u32 node) {
+    const NodeState state = get_state(gc, node);
+    return state != NODE_SELECTED && state != NODE_COALESCED;
+}
+
+typedef struct {
+    u32 node;
+    u32 from;
+    u32 to;
+} RangeItem;
+
+static int compare_range_items(const void* lhs, const void* rhs) {
+    const RangeItem* a = lhs;
+    const RangeItem* b = rhs;
+    return a->from < b->from ? -1 : (a->from > b->from ? 1 : 0);
+}
+
+// The ranges are swept in the order of their starts, every one interferes with the ranges still open at its start.
+static void build_interferences(GraphColoring* gc) {
+    const LiveIntervals* intervals = gc->intervals;
+
+    Vector items = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RangeItem), NULL, false);
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        const LiveInterval* interval = live_intervals_get(intervals, reg);
+        for (u32 range = interval->first_range; range != LIVE_NULL_INDEX; range = live_intervals_get_range(intervals, range)->next) {
+            const LiveRange* r = live_intervals_get_range(intervals, range);
+            const RangeItem item = { .node = get_reg_node(gc, reg), .from = r->from, .to = r->to };
+            vector_push_back(&items, &item);
+        }
+    }
+    qsort(items.items, items.items_count, sizeof(RangeItem), &compare_range_items);
+
+    const RangeItem* sorted = (const RangeItem*)items.items;
+    Vector open = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    for (u64 i = 0; i < items.items_count; ++i) {
+        u32* open_items = (u32*)open.items;
+        for (u64 j = 0; j < open.items_count;) {
+            if (sorted[open_items[j]].to <= sorted[i].from) {
+                open_items[j] = open_items[--open.items_count];
+            }
+            else {
+                add_edge(gc, sorted[open_items[j]].node, sorted[i].node);
+                ++j;
+            }
+        }
+
+        const u32 item = (u32)i;
+        vector_push_back(&open, &item);
+    }
+    vector_free(&open);
+    vector_free(&items);
+
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        if (live_intervals_get(intervals, reg)->first_range == LIVE_NULL_INDEX
+            || get_live_interval_next_call(intervals, reg, 0, LIVE_MAX_POSITION) == LIVE_MAX_POSITION) {
+            continue;
+        }
+
+        for (u32 r = 0; r < gc->k; ++r) {
+            if ((gc->target->caller_saved >> r) & 1) {
+                add_edge(gc, get_reg_node(gc, reg), r);
+            }
+        }
+    }
+}
+
+static void add_move_link(GraphColoring* gc, const u32 node, const u32 move) {
+    u32* head = (u32*)gc->move_heads.items + node;
+    u32* tail = (u32*)gc->move_tails.items + node;
+
+    push_link(gc, head, move);
+    if (*tail == NULL_LINK) {
+        *tail = *head;
+    }
+}
+
+static int compare_moves_by_weight(const void* lhs, const void* rhs) {
+    const Move* a = lhs;
+    const Move* b = rhs;
+    return a->weight < b->weight ? -1 : (a->weight > b->weight ? 1 : 0);
+}
+
+// The copies in the deepest loops are last in the worklist, so they are coalesced first.
+static void build_moves(GraphColoring* gc) {
+    const LiveIntervals* intervals = gc->intervals;
+
+    for (u64 i = 0; i < intervals->copies.items_count; ++i) {
+        const LiveCopy* copy = vector_get_ref(&intervals->copies, i);
+        if (copy->dst == copy->src
+            || live_intervals_get(intervals, copy->dst)->first_range == LIVE_NULL_INDEX
+            || live_intervals_get(intervals, copy->src)->first_range == LIVE_NULL_INDEX) {
+            continue;
+        }
+
+        const Move move = {
+            .dst = get_reg_node(gc, copy->dst),
+            .src = get_reg_node(gc, copy->src),
+            .weight = get_use_weight(gc, copy->position),
+            .state = MOVE_WORKLIST,
+        };
+        vector_push_back(&gc->moves, &move);
+    }
+    qsort(gc->moves.items, gc->moves.items_count, sizeof(Move), &compare_moves_by_weight);
+
+    for (u32 i = 0; i < gc->moves.items_count; ++i) {
+        add_move_link(gc, get_move(gc, i)->dst, i);
+        add_move_link(gc, get_move(gc, i)->src, i);
+        vector_push_back(&gc->move_worklist, &i);
+    }
+}
+
+// The uses weighted by the loops around them, and the definition.
+static void build_costs(GraphColoring* gc) {
+    const LiveIntervals* intervals = gc->intervals;
+
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        const LiveInterval* interval = live_intervals_get(intervals, reg);
+        if (interval->first_range == LIVE_NULL_INDEX) {
+            continue;
+        }
+
+        u64 cost = get_use_weight(gc, interval->start);
+        for (u32 use = interval->first_use; use != LIVE_NULL_INDEX; use = live_intervals_get_use(intervals, use)->next) {
+            cost += get_use_weight(gc, live_intervals_get_use(intervals, use)->position);
+        }
+        ((u64*)gc->costs.items)[get_reg_node(gc, reg)] = cost;
+    }
+}
+
+#pragma endregion
+
+#pragma region WORKLISTS
+
+// The moves of the node that may still be coalesced.
+static bool is_move_related(const GraphColoring* gc, const u32 node) {
+    for (u32 link = ((const u32*)gc->move_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const MoveState state = get_move(gc, get_link(gc, link)->value)->state;
+        if (state == MOVE_WORKLIST || state == MOVE_ACTIVE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void make_worklists(GraphColoring* gc) {
+    for (u32 node = gc->k; node < gc->nodes_count; ++node) {
+        if (get_state(gc, node) == NODE_UNUSED) {
+            continue;
+        }
+
+        if (((const u32*)gc->degrees.items)[node] >= gc->k) {
+            set_state(gc, node, NODE_SPILL);
+            push_node(&gc->spill_worklist, node);
+        }
+        else if (is_move_related(gc, node)) {
+            set_state(gc, node, NODE_FREEZE);
+            push_node(&gc->freeze_worklist, node);
+        }
+        else {
+            set_state(gc, node, NODE_SIMPLIFY);
+            push_node(&gc->simplify_worklist, node);
+        }
+    }
+}
+
+static void enable_moves(GraphColoring* gc, const u32 node) {
+    for (u32 link = ((const u32*)gc->move_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const u32 index = get_link(gc, link)->value;
+        Move* move = get_move(gc, index);
+        if (move->state == MOVE_ACTIVE) {
+            move->state = MOVE_WORKLIST;
+            vector_push_back(&gc->move_worklist, &index);
+        }
+    }
+}
+
+// A node going below k neighbors may make its moves and the ones of its neighbors coalescable again.
+static void decrement_degree(GraphColoring* gc, const u32 node) {
+    if (get_state(gc, node) == NODE_PRECOLORED) {
+        return;
+    }
+
+    const u32 degree = ((u32*)gc->degrees.items)[node]--;
+    if (degree != gc->k) {
+        return;
+    }
+
+    enable_moves(gc, node);
+    for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        if (is_adjacent_in_graph(gc, get_link(gc, link)->value)) {
+            enable_moves(gc, get_link(gc, link)->value);
+        }
+    }
+
+    if (get_state(gc, node) == NODE_SPILL) {
+        const NodeState state = is_move_related(gc, node) ? NODE_FREEZE : NODE_SIMPLIFY;
+        set_state(gc, node, state);
+        push_node(state == NODE_FREEZE ? &gc->freeze_worklist : &gc->simplify_worklist, node);
+    }
+}
+
+static void simplify(GraphColoring* gc, const u32 node) {
+    set_state(gc, node, NODE_SELECTED);
+    push_node(&gc->select_stack, node);
+
+    for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        if (is_adjacent_in_graph(gc, get_link(gc, link)->value)) {
+            decrement_degree(gc, get_link(gc, link)->value);
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region COALESCING
+
+static u32 get_alias(const GraphColoring* gc, u32 node) {
+    while (get_state(gc, node) == NODE_COALESCED) {
+        node = ((const u32*)gc->aliases.items)[node];
+    }
+    return node;
+}
+
+// A node that is done with its moves and has few neighbors can be simplified.
+static void add_worklist(GraphColoring* gc, const u32 node) {
+    if (get_state(gc, node) == NODE_FREEZE && ((const u32*)gc->degrees.items)[node] < gc->k && !is_move_related(gc, node)) {
+        set_state(gc, node, NODE_SIMPLIFY);
+        push_node(&gc->simplify_worklist, node);
+    }
+}
+
+// George: every neighbor of the node is insignificant or already interferes with the precolored one.
+static bool is_george_safe(const GraphColoring* gc, const u32 node, const u32 precolored) {
+    for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const u32 t = get_link(gc, link)->value;
+        if (is_adjacent_in_graph(gc, t) && ((const u32*)gc->degrees.items)[t] >= gc->k
+            && get_state(gc, t) != NODE_PRECOLORED && !is_adjacent(gc, t, precolored)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static u32 count_significant_neighbors(GraphColoring* gc, const u32 node) {
+    u32* marks = (u32*)gc->marks.items;
+
+    u32 count = 0;
+    for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const u32 t = get_link(gc, link)->value;
+        if (marks[t] != gc->mark && is_adjacent_in_graph(gc, t)) {
+            marks[t] = gc->mark;
+            count += ((const u32*)gc->degrees.items)[t] >= gc->k;
+        }
+    }
+    return count;
+}
+
+// Briggs: the merged node has fewer than k significant neighbors, so it can still be simplified.
+static bool is_briggs_safe(GraphColoring* gc, const u32 u, const u32 v) {
+    ++gc->mark;
+    return count_significant_neighbors(gc, u) + count_significant_neighbors(gc, v) < gc->k;
+}
+
+static void combine(GraphColoring* gc, const u32 u, const u32 v) {
+    set_state(gc, v, NODE_COALESCED);
+    ((u32*)gc->aliases.items)[v] = u;
+
+    u32* move_heads = (u32*)gc->move_heads.items;
+    u32* move_tails = (u32*)gc->move_tails.items;
+    if (move_heads[v] != NULL_LINK) {
+        if (move_tails[u] == NULL_LINK) {
+            move_heads[u] = move_heads[v];
+        }
+        else {
+            get_link(gc, move_tails[u])->next = move_heads[v];
+        }
+        move_tails[u] = move_tails[v];
+    }
+    enable_moves(gc, v);
+
+    for (u32 link = ((const u32*)gc->adj_heads.items)[v]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const u32 t = get_link(gc, link)->value;
+        if (is_adjacent_in_graph(gc, t)) {
+            add_edge(gc, t, u);
+            decrement_degree(gc, t);
+        }
+    }
+
+    if (((const u32*)gc->degrees.items)[u] >= gc->k && get_state(gc, u) == NODE_FREEZE) {
+        set_state(gc, u, NODE_SPILL);
+        push_node(&gc->spill_worklist, u);
+    }
+}
+
+static void coalesce(GraphColoring* gc, const u32 index) {
+    Move* move = get_move(gc, index);
+    u32 u = get_alias(gc, move->dst);
+    u32 v = get_alias(gc, move->src);
+    if (get_state(gc, v) == NODE_PRECOLORED) {
+        const u32 t = u;
+        u = v;
+        v = t;
+    }
+
+    if (u == v) {
+        move->state = MOVE_COALESCED;
+        add_worklist(gc, u);
+    }
+    else if (get_state(gc, v) == NODE_PRECOLORED || is_adjacent(gc, u, v)) {
+        move->state = MOVE_CONSTRAINED;
+        add_worklist(gc, u);
+        add_worklist(gc, v);
+    }
+    else if (get_state(gc, u) == NODE_PRECOLORED ? is_george_safe(gc, v, u) : is_briggs_safe(gc, u, v)) {
+        move->state = MOVE_COALESCED;
+        combine(gc, u, v);
+        add_worklist(gc, u);
+    }
+    else {
+        move->state = MOVE_ACTIVE;
+    }
+}
+
+// Gives up on the moves of the node, the other nodes of the moves may become simplifiable.
+static void freeze_moves(GraphColoring* gc, const u32 node) {
+    for (u32 link = ((const u32*)gc->move_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        Move* move = get_move(gc, get_link(gc, link)->value);
+        if (move->state != MOVE_WORKLIST && move->state != MOVE_ACTIVE) {
+            continue;
+        }
+        move->state = MOVE_FROZEN;
+
+        const u32 src = get_alias(gc, move->src);
+        const u32 other = src == get_alias(gc, node) ? get_alias(gc, move->dst) : src;
+        if (get_state(gc, other) == NODE_FREEZE && ((const u32*)gc->degrees.items)[other] < gc->k && !is_move_related(gc, other)) {
+            set_state(gc, other, NODE_SIMPLIFY);
+            push_node(&gc->simplify_worklist, other);
+        }
+    }
+}
+
+static void freeze(GraphColoring* gc, const u32 node) {
+    set_state(gc, node, NODE_SIMPLIFY);
+    push_node(&gc->simplify_worklist, node);
+    freeze_moves(gc, node);
+}
+
+// The cheapest node to keep in memory per neighbor it would leave a register to. Returns false when there is none.
+static bool select_spill(GraphColoring* gc) {
+    u32* worklist = (u32*)gc->spill_worklist.items;
+    const u64* costs = (const u64*)gc->costs.items;
+    const u32* degrees = (const u32*)gc->degrees.items;
+
+    u32 best = NULL_NODE;
+    double best_cost = 0.0;
+    for (u64 i = 0; i < gc->spill_worklist.items_count;) {
+        const u32 node = worklist[i];
+        if (get_state(gc, node) != NODE_SPILL) {
+            worklist[i] = worklist[--gc->spill_worklist.items_count];
+            continue;
+        }
+
+        const double cost = (double)costs[node] / (double)degrees[node];
+        if (best == NULL_NODE || cost < best_cost) {
+            best = node;
+            best_cost = cost;
+        }
+        ++i;
+    }
+
+    if (best == NULL_NODE) {
+        return false;
+    }
+
+    set_state(gc, best, NODE_SIMPLIFY);
+    push_node(&gc->simplify_worklist, best);
+    freeze_moves(gc, best);
+    return true;
+}
+
+#pragma endregion
+
+#pragma region COLORING
+
+// The color of a node the move ties it to, when it is still free, saves the copy the freeze gave up on.
+static u32 get_move_color(const GraphColoring* gc, const u32 node, const u64 free_colors) {
+    for (u32 link = ((const u32*)gc->move_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+        const Move* move = get_move(gc, get_link(gc, link)->value);
+        const u32 src = get_alias(gc, move->src);
+        const u32 other = src == node ? get_alias(gc, move->dst) : src;
+        if (other == node) {
+            continue;
+        }
+
+        const NodeState state = get_state(gc, other);
+        if (state == NODE_COLORED || state == NODE_PRECOLORED) {
+            const u32 color = ((const u32*)gc->colors.items)[other];
+            if ((free_colors >> color) & 1) {
+                return color;
+            }
+        }
+    }
+
+    // The lowest free register, the target lists the cheaper ones first.
+    u32 color = 0;
+    while (((free_colors >> color) & 1) == 0) {
+        ++color;
+    }
+    return color;
+}
+
+static void assign_colors(GraphColoring* gc) {
+    const u64 all_colors = gc->k == 64 ? ~(u64)0 : ((u64)1 << gc->k) - 1;
+    u32* colors = (u32*)gc->colors.items;
+
+    while (gc->select_stack.items_count > 0) {
+        const u32 node = ((const u32*)gc->select_stack.items)[--gc->select_stack.items_count];
+
+        u64 free_colors = all_colors;
+        for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+            const u32 w = get_alias(gc, get_link(gc, link)->value);
+            if (get_state(gc, w) == NODE_COLORED || get_state(gc, w) == NODE_PRECOLORED) {
+                free_colors &= ~((u64)1 << colors[w]);
+            }
+        }
+
+        if (free_colors == 0) {
+            set_state(gc, node, NODE_SPILLED);
+            push_node(&gc->spilled, node);
+        }
+        else {
+            set_state(gc, node, NODE_COLORED);
+            colors[node] = get_move_color(gc, node, free_colors);
+        }
+    }
+}
+
+// The spilled nodes are colored again with the slots, the first slot none of the spilled neighbors took.
+static void assign_slots(GraphColoring* gc) {
+    Vector slot_marks = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    u32* colors = (u32*)gc->colors.items;
+
+    for (u64 i = 0; i < gc->spilled.items_count; ++i) {
+        const u32 node = ((const u32*)gc->spilled.items)[i];
+
+        for (u32 link = ((const u32*)gc->adj_heads.items)[node]; link != NULL_LINK; link = get_link(gc, link)->next) {
+            const u32 w = get_alias(gc, get_link(gc, link)->value);
+            if (get_state(gc, w) == NODE_SPILLED && colors[w] != NULL_NODE) {
+                ((u32*)slot_marks.items)[colors[w]] = node;
+            }
+        }
+
+        u32 slot = 0;
+        while (slot < gc->slots_count && ((const u32*)slot_marks.items)[slot] == node) {
+            ++slot;
+        }
+        if (slot == gc->slots_count) {
+            const u32 mark = NULL_NODE;
+            vector_push_back(&slot_marks, &mark);
+            ++gc->slots_count;
+        }
+        colors[node] = slot;
+    }
+
+    vector_free(&slot_marks);
+}
+
+#pragma endregion
+
+static Vector create_node_vector(const u64 item_size, const u32 count, const void* value) {
+    Vector vector = vector_create(DEFAULT_VECTOR_CAPACITY, item_size, NULL, false);
+    vector_resize(&vector, count);
+    vector_fill(&vector, value);
+    return vector;
+}
+
+void allocate_registers_graph_coloring(RegAllocation* allocation, LiveIntervals* intervals, const RegAllocTarget* target) {
+    assert(allocation != NULL && intervals != NULL && target != NULL);
+    assert(target->regs_count > 0 && target->regs_count <= REG_ALLOC_MAX_REGS);
+    assert(live_intervals_get_count(intervals) == intervals->regs_count);
+
+    const u32 nodes_count = target->regs_count + intervals->regs_count;
+    if (nodes_count > GRAPH_COLORING_MAX_NODES) {
+        allocate_registers_linear_scan(allocation, intervals, target);
+        return;
+    }
+
+    const u32 null_link = NULL_LINK;
+    const u32 null_node = NULL_NODE;
+    const u32 zero = 0;
+    const u64 zero_cost = 0;
+    const NodeState unused = NODE_UNUSED;
+
+    GraphColoring gc = {
+        .intervals = intervals,
+        .target = target,
+        .k = target->regs_count,
+        .nodes_count = nodes_count,
+        .adj_matrix = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u64), NULL, false),
+        .links = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(Link), NULL, false),
+        .moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(Move), NULL, false),
+        .adj_heads = create_node_vector(sizeof(u32), nodes_count, &null_link),
+        .move_heads = create_node_vector(sizeof(u32), nodes_count, &null_link),
+        .move_tails = create_node_vector(sizeof(u32), nodes_count, &null_link),
+        .degrees = create_node_vector(sizeof(u32), nodes_count, &zero),
+        .states = create_node_vector(sizeof(NodeState), nodes_count, &unused),
+        .aliases = create_node_vector(sizeof(u32), nodes_count, &null_node),
+        .colors = create_node_vector(sizeof(u32), nodes_count, &null_node),
+        .costs = create_node_vector(sizeof(u64), nodes_count, &zero_cost),
+        .marks = create_node_vector(sizeof(u32), nodes_count, &zero),
+        .simplify_worklist = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .freeze_worklist = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .spill_worklist = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .move_worklist = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .select_stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .spilled = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .mark = 0,
+        .slots_count = 0,
+    };
+
+    const u64 matrix_words = ((u64)nodes_count * (nodes_count - 1) / 2 + BIT_SET_WORD_BITS - 1) / BIT_SET_WORD_BITS;
+    memset(vector_resize(&gc.adj_matrix, matrix_words), 0, matrix_words * sizeof(u64));
+
+    for (u32 r = 0; r < gc.k; ++r) {
+        set_state(&gc, r, NODE_PRECOLORED);
+        ((u32*)gc.colors.items)[r] = r;
+        ((u32*)gc.degrees.items)[r] = INFINITE_DEGREE;
+    }
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        if (live_intervals_get(intervals, reg)->first_range != LIVE_NULL_INDEX) {
+            set_state(&gc, get_reg_node(&gc, reg), NODE_SIMPLIFY);
+        }
+    }
+
+    build_interferences(&gc);
+    build_moves(&gc);
+    build_costs(&gc);
+    make_worklists(&gc);
+
+    while (true) {
+        u32 node = pop_node(&gc, &gc.simplify_worklist, NODE_SIMPLIFY);
+        if (node != NULL_NODE) {
+            simplify(&gc, node);
+            continue;
+        }
+
+        if (gc.move_worklist.items_count > 0) {
+            const u32 move = ((const u32*)gc.move_worklist.items)[--gc.move_worklist.items_count];
+            if (get_move(&gc, move)->state == MOVE_WORKLIST) {
+                coalesce(&gc, move);
+            }
+            continue;
+        }
+
+        node = pop_node(&gc, &gc.freeze_worklist, NODE_FREEZE);
+        if (node != NULL_NODE) {
+            freeze(&gc, node);
+            continue;
+        }
+
+        if (!select_spill(&gc)) {
+            break;
+        }
+    }
+
+    assign_colors(&gc);
+    assign_slots(&gc);
+
+    Vector locations = vector_create(intervals->regs_count > 0 ? intervals->regs_count : DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocLocation), NULL, false);
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        const u32 node = get_alias(&gc, get_reg_node(&gc, reg));
+        const RegAllocLocation location = {
+            .kind = get_state(&gc, node) == NODE_SPILLED ? REG_ALLOC_SLOT : REG_ALLOC_REGISTER,
+            .index = ((const u32*)gc.colors.items)[node],
+        };
+        vector_push_back(&locations, &location);
+    }
+    reg_allocation_build(allocation, intervals, (const RegAllocLocation*)locations.items, gc.slots_count);
+    vector_free(&locations);
+
+    vector_free(&gc.adj_matrix);
+    vector_free(&gc.links);
+    vector_free(&gc.moves);
+    vector_free(&gc.adj_heads);
+    vector_free(&gc.move_heads);
+    vector_free(&gc.move_tails);
+    vector_free(&gc.degrees);
+    vector_free(&gc.states);
+    vector_free(&gc.aliases);
+    vector_free(&gc.colors);
+    vector_free(&gc.costs);
+    vector_free(&gc.marks);
+    vector_free(&gc.simplify_worklist);
+    vector_free(&gc.freeze_worklist);
+    vector_free(&gc.spill_worklist);
+    vector_free(&gc.move_worklist);
+    vector_free(&gc.select_stack);
+    vector_free(&gc.spilled);
+}
\ No newline at end of file
@@ -0,0 +1,977 @@
+#include "vanec/backend/jit.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X86_64
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define JIT_CODE_ALIGNMENT 16
+#define JIT_NATIVE_FRAME_SIZE 40    // the shadow space of Win64 and the alignment of the native stack to 16 bytes
+#define JIT_ZERO_LOOP_THRESHOLD 8   // slots, larger parts of a frame are zeroed with 'rep stosq'
+
+bool is_jit_supported(void) {
+#ifdef JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+#pragma region EXECUTABLE MEMORY
+
+static u8* code_pages_alloc(const u64 size) {
+#ifdef _WIN32
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return memory != MAP_FAILED ? memory : NULL;
+#endif
+}
+
+static void code_pages_free(u8* memory, const u64 size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// The pages are either writable or executable, never both.
+static bool code_pages_protect(u8* memory, const u64 size, const bool is_writable) {
+#ifdef _WIN32
+    DWORD old_protect = 0;
+    if (!VirtualProtect(memory, size, is_writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &old_protect)) {
+        return false;
+    }
+    return is_writable || FlushInstructionCache(GetCurrentProcess(), memory, size);
+#else
+    return mprotect(memory, size, is_writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+#endif
+}
+
+static bool jit_begin_write(JIT* jit) {
+    return code_pages_protect(jit->memory, jit->capacity, true);
+}
+
+static void jit_end_write(JIT* jit) {
+    const bool result = code_pages_protect(jit->memory, jit->capacity, false);
+    assert(result && "The code pages can not be made executable again");
+    (void)result;
+}
+
+#pragma endregion
+
+#pragma region ASSEMBLER
+
+typedef enum {
+    JIT_RAX = 0,
+    JIT_RCX,
+    JIT_RDX,
+    JIT_RBX,
+    JIT_RSP,
+    JIT_RBP,
+    JIT_RSI,
+    JIT_RDI,
+    JIT_R8,
+    JIT_R9,
+    JIT_R10,
+    JIT_R11,
+    JIT_R12,
+    JIT_R13,
+    JIT_R14,
+    JIT_R15,
+} JITReg;
+
+// The condition codes of jcc and setcc.
+typedef enum {
+    JIT_CC_B = 0x2,
+    JIT_CC_AE = 0x3,
+    JIT_CC_E = 0x4,
+    JIT_CC_NE = 0x5,
+    JIT_CC_BE = 0x6,
+    JIT_CC_A = 0x7,
+    JIT_CC_L = 0xC,
+    JIT_CC_GE = 0xD,
+    JIT_CC_LE = 0xE,
+    JIT_CC_G = 0xF,
+} JITCondition;
+
+// The frame base of the running function and the context stay in callee saved registers all along.
+#define JIT_BASE JIT_RBX
+#define JIT_CONTEXT JIT_R12
+// The index of the callee at a call site, for the bridge.
+#define JIT_CALLEE JIT_R10
+
+#ifdef _WIN32
+static const JITReg jit_arg_regs[] = { JIT_RCX, JIT_RDX, JIT_R8, JIT_R9 };
+#else
+static const JITReg jit_arg_regs[] = { JIT_RDI, JIT_RSI, JIT_RDX, JIT_RCX };
+#endif
+
+#define JIT_CONTEXT_OFFSET(field) ((u32)offsetof(JITContext, field))
+#define JIT_SLOT_OFFSET(reg) ((u32)(reg) * (u32)sizeof(i64))
+
+static void emit_u8(Vector* code, const u8 byte) {
+    vector_push_back(code, &byte);
+}
+
+static void emit_u32(Vector* code, const u64 value) {
+    for (u32 i = 0; i < 4; ++i) {
+        emit_u8(code, (u8)(value >> (8 * i)));
+    }
+}
+
+static void emit_u64(Vector* code, const u64 value) {
+    for (u32 i = 0; i < 8; ++i) {
+        emit_u8(code, (u8)(value >> (8 * i)));
+    }
+}
+
+static void write_u32(u8* bytes, const u64 value) {
+    for (u32 i = 0; i < 4; ++i) {
+        bytes[i] = (u8)(value >> (8 * i));
+    }
+}
+
+static void emit_rex(Vector* code, const bool is_wide, const u32 reg, const u32 index, const u32 base) {
+    const u8 rex = 0x40 | (is_wide ? 0x8 : 0) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+    if (rex != 0x40) {
+        emit_u8(code, rex);
+    }
+}
+
+// The opcodes of two bytes are written with their escape byte first, like 0x0FAF.
+static void emit_opcode(Vector* code, const u32 opcode) {
+    if (opcode > 0xFF) {
+        emit_u8(code, (u8)(opcode >> 8));
+    }
+    emit_u8(code, (u8)opcode);
+}
+
+// op reg, rm
+static void emit_rr(Vector* code, const bool is_wide, const u32 opcode, const u32 reg, const u32 rm) {
+    emit_rex(code, is_wide, reg, 0, rm);
+    emit_opcode(code, opcode);
+    emit_u8(code, (u8)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+// The byte registers of setcc need a REX prefix past the first four to not be the high bytes.
+static void emit_setcc(Vector* code, const JITCondition cc, const JITReg reg) {
+    if (reg >= JIT_RSP) {
+        emit_u8(code, 0x40 | ((reg & 8) >> 3));
+    }
+    emit_opcode(code, 0x0F90 | cc);
+    emit_u8(code, (u8)(0xC0 | (reg & 7)));
+}
+
+// op reg, [base + disp32]
+static void emit_rm(Vector* code, const bool is_wide, const u32 opcode, const u32 reg, const u32 base, const u32 disp) {
+    emit_rex(code, is_wide, reg, 0, base);
+    emit_opcode(code, opcode);
+    emit_u8(code, (u8)(0x80 | ((reg & 7) << 3) | (base & 7)));
+    if ((base & 7) == JIT_RSP) {
+        emit_u8(code, 0x24);
+    }
+    emit_u32(code, disp);
+}
+
+// op reg, [base + index * 8]
+static void emit_rm_indexed(Vector* code, const bool is_wide, const u32 opcode, const u32 reg, const u32 base, const u32 index) {
+    assert((base & 7) != JIT_RBP && index != JIT_RSP);
+
+    emit_rex(code, is_wide, reg, index, base);
+    emit_opcode(code, opcode);
+    emit_u8(code, (u8)(0x04 | ((reg & 7) << 3)));
+    emit_u8(code, (u8)(0xC0 | ((index & 7) << 3) | (base & 7)));
+}
+
+static void emit_push(Vector* code, const JITReg reg) {
+    emit_rex(code, false, 0, 0, reg);
+    emit_u8(code, (u8)(0x50 | (reg & 7)));
+}
+
+static void emit_pop(Vector* code, const JITReg reg) {
+    emit_rex(code, false, 0, 0, reg);
+    emit_u8(code, (u8)(0x58 | (reg & 7)));
+}
+
+static void emit_mov(Vector* code, const JITReg dst, const JITReg src) {
+    emit_rr(code, true, 0x89, src, dst);
+}
+
+static void emit_mov_imm(Vector* code, const JITReg reg, const i64 value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+        emit_rr(code, true, 0xC7, 0, reg);
+        emit_u32(code, (u64)value);
+        return;
+    }
+    emit_rex(code, true, 0, 0, reg);
+    emit_u8(code, (u8)(0xB8 | (reg & 7)));
+    emit_u64(code, (u64)value);
+}
+
+static void emit_load(Vector* code, const JITReg reg, const u16 slot) {
+    emit_rm(code, true, 0x8B, reg, JIT_BASE, JIT_SLOT_OFFSET(slot));
+}
+
+static void emit_store(Vector* code, const u16 slot, const JITReg reg) {
+    emit_rm(code, true, 0x89, reg, JIT_BASE, JIT_SLOT_OFFSET(slot));
+}
+
+// rsp += delta
+static void emit_add_rsp(Vector* code, const i64 delta) {
+    emit_rr(code, true, 0x81, delta >= 0 ? 0 : 5, JIT_RSP);
+    emit_u32(code, (u64)(delta >= 0 ? delta : -delta));
+}
+
+static void emit_ret(Vector* code) {
+    emit_u8(code, 0xC3);
+}
+
+// Calls a C function through rax, the native stack must be aligned.
+static void emit_call_abs(Vector* code, const void* target) {
+    emit_mov_imm(code, JIT_RAX, (i64)(uintptr_t)target);
+    emit_rr(code, false, 0xFF, 2, JIT_RAX);
+}
+
+static void emit_jmp_abs(Vector* code, const void* target) {
+    emit_mov_imm(code, JIT_RAX, (i64)(uintptr_t)target);
+    emit_rr(code, false, 0xFF, 4, JIT_RAX);
+}
+
+// The jumps and calls with a 32 bit displacement return the offset of it, to be patched once the target is known.
+static u32 emit_jmp(Vector* code) {
+    emit_u8(code, 0xE9);
+    const u32 at = (u32)code->items_count;
+    emit_u32(code, 0);
+    return at;
+}
+
+static u32 emit_jcc(Vector* code, const JITCondition cc) {
+    emit_opcode(code, 0x0F80 | cc);
+    const u32 at = (u32)code->items_count;
+    emit_u32(code, 0);
+    return at;
+}
+
+static u32 emit_call(Vector* code) {
+    emit_u8(code, 0xE8);
+    const u32 at = (u32)code->items_count;
+    emit_u32(code, 0);
+    return at;
+}
+
+// The displacement is relative to the end of itself, 'at' and 'target' are in the same address space.
+static void patch_rel32(u8* bytes, const u64 at, const u64 target) {
+    write_u32(bytes + at, target - (at + 4));
+}
+
+#pragma endregion
+
+#pragma region RUNTIME
+
+typedef i64(*JITEntry)(i64* base, JITContext* ctx, const u8* body);
+
+static JIT* get_context_jit(JITContext* ctx) {
+    return (JIT*)((u8*)ctx - offsetof(JIT, context));
+}
+
+// Called by the bridge, returns the native code of the callee and patches the call site to go there directly,
+// or returns NULL when the callee stays interpreted.
+static const u8* jit_resolve_call(JITContext* ctx, const u32 callee, u8* ret_address) {
+    JIT* jit = get_context_jit(ctx);
+    if (!jit_tier_up(jit, callee)) {
+        return NULL;
+    }
+
+    if (jit_begin_write(jit)) {
+        write_u32(ret_address - 4, (u64)(jit->functions[callee] - ret_address));
+        jit_end_write(jit);
+    }
+    return jit->functions[callee];
+}
+
+// Called by the bridge with the frame of the callee already filled, a runtime error is left in the context.
+static i64 jit_interpret_call(JITContext* ctx, const u32 callee, i64* base) {
+    VM* vm = ctx->vm;
+
+    i64 result = 0;
+    const VMStatus status = vm_run_frame(vm, callee, base, ctx->depth, &result);
+    if (status != VM_STATUS_OK) {
+        ctx->status = status;
+        ctx->fault_function = (u32)(vm->fault_function - (const BCFunction*)vm->module->functions.items);
+    }
+    return result;
+}
+
+static i64 jit_call_native(JITContext* ctx, const BCFunction* func, const BCInstr* instr, const i64* base) {
+    return vm_call_native(ctx->vm, func, instr, base);
+}
+
+static i64 jit_multiply_high(const i64 type, const i64 lhs, const i64 rhs) {
+    return multiply_high_ir_value((IRType)type, lhs, rhs);
+}
+
+// The entry from C saves the callee saved registers, the ones of both ABIs, and the native stack the traps unwind to.
+// The previous one is kept on the stack, so the entries nest through the interpreter.
+static void emit_entry_stub(Vector* code) {
+    static const JITReg saved[] = { JIT_RBP, JIT_RBX, JIT_R12, JIT_R13, JIT_R14, JIT_R15, JIT_RDI, JIT_RSI };
+    const u32 saved_count = sizeof(saved) / sizeof(saved[0]);
+
+    for (u32 i = 0; i < saved_count; ++i) {
+        emit_push(code, saved[i]);
+    }
+    emit_mov(code, JIT_BASE, jit_arg_regs[0]);
+    emit_mov(code, JIT_CONTEXT, jit_arg_regs[1]);
+    emit_mov(code, JIT_RAX, jit_arg_regs[2]);
+
+    emit_rm(code, false, 0xFF, 6, JIT_CONTEXT, JIT_CONTEXT_OFFSET(entry_rsp));    // push [ctx.entry_rsp]
+    emit_rm(code, true, 0x89, JIT_RSP, JIT_CONTEXT, JIT_CONTEXT_OFFSET(entry_rsp));
+    emit_rr(code, false, 0xFF, 2, JIT_RAX);                                         // call rax
+    emit_rm(code, false, 0x8F, 0, JIT_CONTEXT, JIT_CONTEXT_OFFSET(entry_rsp));    // pop [ctx.entry_rsp]
+
+    for (u32 i = saved_count; i > 0; --i) {
+        emit_pop(code, saved[i - 1]);
+    }
+    emit_ret(code);
+}
+
+// Drops all the native frames of the entry and returns from its call with the status in the context.
+static void emit_unwind_stub(Vector* code) {
+    emit_rm(code, true, 0x8B, JIT_RSP, JIT_CONTEXT, JIT_CONTEXT_OFFSET(entry_rsp));
+    emit_add_rsp(code, -8);
+    emit_ret(code);
+}
+
+// The call sites of the callees without native code go here, with the frame of the callee filled.
+static void emit_bridge_stub(Vector* code, const u32 unwind_offset) {
+    emit_add_rsp(code, -JIT_NATIVE_FRAME_SIZE);
+    emit_rm(code, true, 0x89, JIT_CALLEE, JIT_RSP, 32);
+
+    emit_mov(code, jit_arg_regs[0], JIT_CONTEXT);
+    emit_mov(code, jit_arg_regs[1], JIT_CALLEE);
+    emit_rm(code, true, 0x8B, jit_arg_regs[2], JIT_RSP, JIT_NATIVE_FRAME_SIZE);     // the return address
+    emit_call_abs(code, &jit_resolve_call);
+
+    emit_rr(code, true, 0x85, JIT_RAX, JIT_RAX);
+    const u32 interpret = emit_jcc(code, JIT_CC_E);
+    emit_add_rsp(code, JIT_NATIVE_FRAME_SIZE);
+    emit_rr(code, false, 0xFF, 4, JIT_RAX);                                         // jmp rax
+
+    patch_rel32(code->items, interpret, code->items_count);
+    emit_mov(code, jit_arg_regs[0], JIT_CONTEXT);
+    emit_rm(code, true, 0x8B, jit_arg_regs[1], JIT_RSP, 32);
+    emit_mov(code, jit_arg_regs[2], JIT_BASE);
+    emit_call_abs(code, &jit_interpret_call);
+    emit_add_rsp(code, JIT_NATIVE_FRAME_SIZE);
+
+    emit_rm(code, false, 0x81, 7, JIT_CONTEXT, JIT_CONTEXT_OFFSET(status));         // cmp [ctx.status], 0
+    emit_u32(code, 0);
+    patch_rel32(code->items, emit_jcc(code, JIT_CC_NE), unwind_offset);
+    emit_ret(code);
+}
+
+JIT jit_create(const BCModule* module, const u32 threshold, const u64 capacity) {
+    assert(module != NULL && module->is_linked);
+
+    const u32 count = bc_module_get_functions_count(module);
+    JIT jit = {
+        .module = module,
+        .memory = NULL,
+        .capacity = capacity,
+        .size = 0,
+        .entry = NULL,
+        .bridge = NULL,
+        .unwind = NULL,
+        .functions = calloc(count + 1, sizeof(const u8*)),
+        .call_counts = calloc(count + 1, sizeof(u32)),
+        .is_rejected = calloc(count + 1, sizeof(bool)),
+        .threshold = threshold,
+        .compiled_count = 0,
+        .context = { 0 },
+    };
+    assert(jit.functions != NULL && jit.call_counts != NULL && jit.is_rejected != NULL);
+
+    if (!is_jit_supported() || capacity == 0) {
+        return jit;
+    }
+
+    Vector code = vector_create(256, sizeof(u8), NULL, false);
+
+    const u32 entry_offset = (u32)code.items_count;
+    emit_entry_stub(&code);
+    const u32 unwind_offset = (u32)code.items_count;
+    emit_unwind_stub(&code);
+    const u32 bridge_offset = (u32)code.items_count;
+    emit_bridge_stub(&code, unwind_offset);
+
+    // Without the room for the stubs every function stays interpreted.
+    jit.memory = code.items_count <= capacity ? code_pages_alloc(capacity) : NULL;
+    if (jit.memory != NULL) {
+        memcpy(jit.memory, code.items, code.items_count);
+        jit_end_write(&jit);
+
+        jit.size = code.items_count;
+        jit.entry = jit.memory + entry_offset;
+        jit.unwind = jit.memory + unwind_offset;
+        jit.bridge = jit.memory + bridge_offset;
+    }
+
+    vector_free(&code);
+    return jit;
+}
+
+void jit_free(JIT* jit) {
+    if (jit == NULL) {
+        return;
+    }
+
+    if (jit->memory != NULL) {
+        code_pages_free(jit->memory, jit->capacity);
+    }
+    free((void*)jit->functions);
+    free(jit->call_counts);
+    free(jit->is_rejected);
+
+    jit->memory = NULL;
+    jit->functions = NULL;
+    jit->call_counts = NULL;
+    jit->is_rejected = NULL;
+}
+
+bool jit_tier_up(JIT* jit, const u32 func) {
+    assert(jit != NULL && func < bc_module_get_functions_count(jit->module));
+
+    if (jit->functions[func] != NULL) {
+        return true;
+    }
+    if (jit->memory == NULL || jit->is_rejected[func]) {
+        return false;
+    }
+    if (++jit->call_counts[func] < jit->threshold) {
+        return false;
+    }
+    return jit_compile_function(jit, func);
+}
+
+VMStatus jit_run(JIT* jit, VM* vm, const u32 func, i64* base, const u32 depth, i64* result) {
+    assert(jit != NULL && vm != NULL && vm->module == jit->module);
+    assert(jit->functions[func] != NULL);
+
+    JITContext* ctx = &jit->context;
+    const JITContext saved = *ctx;
+
+    ctx->vm = vm;
+    ctx->stack_end = vm->stack + vm->stack_size;
+    ctx->max_frames = vm->max_frames;
+    ctx->depth = depth;
+    ctx->status = VM_STATUS_OK;
+
+    const JITEntry entry = (JITEntry)(uintptr_t)jit->entry;
+    const i64 value = entry(base, ctx, jit->functions[func]);
+
+    const VMStatus status = (VMStatus)ctx->status;
+    const u32 fault_function = ctx->fault_function;
+    *ctx = saved;
+
+    vm->status = status;
+    vm->fault_function = status != VM_STATUS_OK ? bc_module_get_function(jit->module, fault_function) : NULL;
+
+    if (status == VM_STATUS_OK && result != NULL) {
+        *result = value;
+    }
+    return status;
+}
+
+#pragma endregion
+
+#pragma region TEMPLATES
+
+typedef enum {
+    JIT_FIXUP_JUMP,     // to an instruction of the function
+    JIT_FIXUP_CALL,     // to a function of the module
+    JIT_FIXUP_TRAP,     // to the trap of a status
+} JITFixupKind;
+
+typedef struct {
+    u32 at;             // the offset of the displacement in the code of the function
+    u32 target;
+    JITFixupKind kind;
+} JITFixup;
+
+typedef struct {
+    JIT* jit;
+    const BCFunction* func;
+    u32 func_index;
+
+    Vector code;        // u8
+    Vector fixups;      // JITFixup
+    u32* offsets;       // the offset of the code of every instruction
+} JITCompiler;
+
+static const u32 jit_type_sizes[IR_TYPES_COUNT] = {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) (SIZE),
+#include "vanec/ir/ir_type.def"
+};
+
+static const bool jit_type_signs[IR_TYPES_COUNT] = {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) (IS_SIGNED),
+#include "vanec/ir/ir_type.def"
+};
+
+static void add_fixup(JITCompiler* compiler, const u32 at, const u32 target, const JITFixupKind kind) {
+    const JITFixup fixup = { .at = at, .target = target, .kind = kind };
+    vector_push_back(&compiler->fixups, &fixup);
+}
+
+static void emit_jcc_trap(JITCompiler* compiler, const JITCondition cc, const VMStatus status) {
+    add_fixup(compiler, emit_jcc(&compiler->code, cc), status, JIT_FIXUP_TRAP);
+}
+
+// The same normalization as the interpreter's, a single extension or nothing.
+static void emit_normalize(Vector* code, const JITReg reg, const IRType type) {
+    if (type == IR_TYPE_BOOL) {
+        emit_rr(code, true, 0x85, reg, reg);                    // test reg, reg
+        emit_setcc(code, JIT_CC_NE, reg);
+        emit_rr(code, false, 0x0FB6, reg, reg);                 // movzx reg32, reg8
+        return;
+    }
+
+    const bool is_signed = jit_type_signs[type];
+    switch (jit_type_sizes[type]) {
+    case 1: {
+        emit_rex(code, is_signed, reg, 0, reg);
+        if (!is_signed && reg >= JIT_RSP && reg < JIT_R8) {
+            emit_u8(code, 0x40);
+        }
+        emit_opcode(code, is_signed ? 0x0FBE : 0x0FB6);         // movsx reg64, reg8 / movzx reg32, reg8
+        emit_u8(code, (u8)(0xC0 | ((reg & 7) << 3) | (reg & 7)));
+    } break;
+    case 2: {
+        emit_rr(code, is_signed, is_signed ? 0x0FBF : 0x0FB7, reg, reg);
+    } break;
+    case 4: {
+        if (is_signed) {
+            emit_rr(code, true, 0x63, reg, reg);                // movsxd reg64, reg32
+        }
+        else {
+            emit_rr(code, false, 0x89, reg, reg);               // mov reg32, reg32
+        }
+    } break;
+    default: break;
+    };
+}
+
+static void emit_load_normalized(Vector* code, const JITReg reg, const u16 slot, const IRType type) {
+    emit_load(code, reg, slot);
+    emit_normalize(code, reg, type);
+}
+
+static void emit_division(JITCompiler* compiler, const BCInstr* instr, const bool is_rem) {
+    Vector* code = &compiler->code;
+    const IRType type = (IRType)instr->type;
+    const bool is_signed = jit_type_signs[type];
+
+    emit_load_normalized(code, JIT_RAX, instr->b, type);
+    emit_load_normalized(code, JIT_RCX, instr->c, type);
+
+    emit_rr(code, true, 0x85, JIT_RCX, JIT_RCX);
+    emit_jcc_trap(compiler, JIT_CC_E, VM_STATUS_DIVISION_BY_ZERO);
+
+    if (is_signed) {
+        // The minimum of the type over -1, the division itself faults for 64 bits and overflows the type for the rest.
+        const u32 bits = jit_type_sizes[type] == 0 ? 64 : jit_type_sizes[type] * 8;
+        emit_rr(code, true, 0x83, 7, JIT_RCX);                  // cmp rcx, -1
+        emit_u8(code, 0xFF);
+        const u32 skip = emit_jcc(code, JIT_CC_NE);
+        emit_mov_imm(code, JIT_RDX, (i64)((u64)0 - ((u64)1 << (bits - 1))));
+        emit_rr(code, true, 0x39, JIT_RDX, JIT_RAX);            // cmp rax, rdx
+        emit_jcc_trap(compiler, JIT_CC_E, VM_STATUS_DIVISION_OVERFLOW);
+        patch_rel32(code->items, skip, code->items_count);
+
+        emit_u8(code, 0x48);                                    // cqo
+        emit_u8(code, 0x99);
+        emit_rr(code, true, 0xF7, 7, JIT_RCX);                  // idiv rcx
+    }
+    else {
+        emit_rr(code, false, 0x31, JIT_RDX, JIT_RDX);           // xor edx, edx
+        emit_rr(code, true, 0xF7, 6, JIT_RCX);                  // div rcx
+    }
+    emit_store(code, instr->a, is_rem ? JIT_RDX : JIT_RAX);
+}
+
+// The amount is masked by the hardware like by the interpreter.
+static void emit_shift(Vector* code, const BCInstr* instr, const bool is_left) {
+    const IRType type = (IRType)instr->type;
+
+    emit_load(code, JIT_RCX, instr->c);
+    if (is_left) {
+        emit_load(code, JIT_RAX, instr->b);
+        emit_rr(code, true, 0xD3, 4, JIT_RAX);                  // shl rax, cl
+        emit_normalize(code, JIT_RAX, type);
+    }
+    else {
+        emit_load_normalized(code, JIT_RAX, instr->b, type);
+        emit_rr(code, true, 0xD3, jit_type_signs[type] ? 7 : 5, JIT_RAX);   // sar / shr rax, cl
+    }
+    emit_store(code, instr->a, JIT_RAX);
+}
+
+static void emit_compare(Vector* code, const BCInstr* instr, const BCOpcode op) {
+    const IRType type = (IRType)instr->type;
+    const bool is_signed = jit_type_signs[type];
+
+    JITCondition cc = JIT_CC_E;
+    switch (op) {
+    case BC_OP_EQ: cc = JIT_CC_E; break;
+    case BC_OP_NE: cc = JIT_CC_NE; break;
+    case BC_OP_LT: cc = is_signed ? JIT_CC_L : JIT_CC_B; break;
+    case BC_OP_LE: cc = is_signed ? JIT_CC_LE : JIT_CC_BE; break;
+    case BC_OP_GT: cc = is_signed ? JIT_CC_G : JIT_CC_A; break;
+    case BC_OP_GE: cc = is_signed ? JIT_CC_GE : JIT_CC_AE; break;
+    default: assert(false && "Unreachable"); break;
+    };
+
+    emit_load_normalized(code, JIT_RAX, instr->b, type);
+    emit_load_normalized(code, JIT_RCX, instr->c, type);
+    emit_rr(code, true, 0x39, JIT_RCX, JIT_RAX);                // cmp rax, rcx
+    emit_setcc(code, cc, JIT_RAX);
+    emit_rr(code, false, 0x0FB6, JIT_RAX, JIT_RAX);             // movzx eax, al
+    emit_store(code, instr->a, JIT_RAX);
+}
+
+// rax = b op c, for the ops that work on the low bits only, so the operands need no normalization.
+static void emit_binary(Vector* code, const BCInstr* instr, const u32 opcode) {
+    emit_load(code, JIT_RAX, instr->b);
+    emit_load(code, JIT_RCX, instr->c);
+    if (opcode == 0x0FAF) {
+        emit_rr(code, true, opcode, JIT_RAX, JIT_RCX);          // imul rax, rcx
+    }
+    else {
+        emit_rr(code, true, opcode, JIT_RCX, JIT_RAX);          // op rax, rcx
+    }
+    emit_normalize(code, JIT_RAX, (IRType)instr->type);
+    emit_store(code, instr->a, JIT_RAX);
+}
+
+// rax = (b op c) as bool
+static void emit_logical(Vector* code, const BCInstr* instr, const bool is_and) {
+    emit_load(code, JIT_RAX, instr->b);
+    emit_normalize(code, JIT_RAX, IR_TYPE_BOOL);
+    emit_load(code, JIT_RCX, instr->c);
+    emit_normalize(code, JIT_RCX, IR_TYPE_BOOL);
+    emit_rr(code, true, is_and ? 0x21 : 0x09, JIT_RCX, JIT_RAX);
+    emit_store(code, instr->a, JIT_RAX);
+}
+
+// rdx = the items of the array, rcx = the index, both checked.
+static void emit_element_address(JITCompiler* compiler, const u16 array, const u16 index) {
+    Vector* code = &compiler->code;
+
+    emit_load(code, JIT_RDX, array);
+    emit_load(code, JIT_RCX, index);
+    emit_rr(code, true, 0x85, JIT_RDX, JIT_RDX);
+    emit_jcc_trap(compiler, JIT_CC_E, VM_STATUS_INDEX_OUT_OF_RANGE);
+    emit_rm(code, true, 0x3B, JIT_RCX, JIT_RDX, (u32)offsetof(VMArray, count));
+    emit_jcc_trap(compiler, JIT_CC_AE, VM_STATUS_INDEX_OUT_OF_RANGE);
+    emit_rm(code, true, 0x8B, JIT_RDX, JIT_RDX, (u32)offsetof(VMArray, items));
+}
+
+// The frame of the callee starts right past the one of the caller, like in the interpreter.
+static void emit_call_function(JITCompiler* compiler, const BCInstr* instr) {
+    Vector* code = &compiler->code;
+    const BCFunction* func = compiler->func;
+    const BCCall* call = vector_get_ref(&func->calls, BC_INSTR_INDEX(instr));
+    const BCFunction* callee = bc_module_get_function(compiler->jit->module, call->callee);
+    const u16* args = (const u16*)func->call_args.items + call->first;
+    const u8* callee_types = (const u8*)callee->reg_types.items;
+
+    const u32 callee_base = JIT_SLOT_OFFSET(func->frame_size);
+    const u32 params_count = call->count < callee->params_count ? call->count : callee->params_count;
+
+    emit_rm(code, true, 0x8D, JIT_RAX, JIT_BASE, JIT_SLOT_OFFSET(func->frame_size + callee->frame_size));  // lea
+    emit_rm(code, true, 0x3B, JIT_RAX, JIT_CONTEXT, JIT_CONTEXT_OFFSET(stack_end));
+    emit_jcc_trap(compiler, JIT_CC_A, VM_STATUS_STACK_OVERFLOW);
+    emit_rm(code, false, 0x8B, JIT_RAX, JIT_CONTEXT, JIT_CONTEXT_OFFSET(depth));
+    emit_rm(code, false, 0x3B, JIT_RAX, JIT_CONTEXT, JIT_CONTEXT_OFFSET(max_frames));
+    emit_jcc_trap(compiler, JIT_CC_AE, VM_STATUS_STACK_OVERFLOW);
+    emit_rm(code, false, 0xFF, 0, JIT_CONTEXT, JIT_CONTEXT_OFFSET(depth));                   // inc [ctx.depth]
+
+    for (u32 i = 0; i < params_count; ++i) {
+        emit_load_normalized(code, JIT_RAX, args[i], (IRType)callee_types[i]);
+        emit_rm(code, true, 0x89, JIT_RAX, JIT_BASE, callee_base + JIT_SLOT_OFFSET(i));
+    }
+
+    const u32 zero_count = callee->frame_size - params_count;
+    if (zero_count > 0) {
+        emit_rr(code, false, 0x31, JIT_RAX, JIT_RAX);                                       // xor eax, eax
+    }
+    if (zero_count > JIT_ZERO_LOOP_THRESHOLD) {
+        emit_rm(code, true, 0x8D, JIT_RDI, JIT_BASE, callee_base + JIT_SLOT_OFFSET(params_count));
+        emit_u8(code, 0xB8 | JIT_RCX);                                                      // mov ecx, count
+        emit_u32(code, zero_count);
+        emit_u8(code, 0xF3);                                                                // rep stosq
+        emit_u8(code, 0x48);
+        emit_u8(code, 0xAB);
+    }
+    else {
+        for (u32 i = params_count; i < callee->frame_size; ++i) {
+            emit_rm(code, true, 0x89, JIT_RAX, JIT_BASE, callee_base + JIT_SLOT_OFFSET(i));
+        }
+    }
+
+    emit_rr(code, true, 0x81, 0, JIT_BASE);                                                 // add rbx, base
+    emit_u32(code, callee_base);
+    emit_rex(code, false, 0, 0, JIT_CALLEE);                                                // mov r10d, callee
+    emit_u8(code, (u8)(0xB8 | (JIT_CALLEE & 7)));
+    emit_u32(code, call->callee);
+    add_fixup(compiler, emit_call(code), call->callee, JIT_FIXUP_CALL);
+    emit_rr(code, true, 0x81, 5, JIT_BASE);                                                 // sub rbx, base
+    emit_u32(code, callee_base);
+    emit_rm(code, false, 0xFF, 1, JIT_CONTEXT, JIT_CONTEXT_OFFSET(depth));                   // dec [ctx.depth]
+
+    if (instr->a != BC_NULL_REG) {
+        emit_normalize(code, JIT_RAX, (IRType)instr->type);
+        emit_store(code, instr->a, JIT_RAX);
+    }
+}
+
+static void emit_call_native(JITCompiler* compiler, const BCInstr* instr) {
+    Vector* code = &compiler->code;
+
+    emit_mov(code, jit_arg_regs[0], JIT_CONTEXT);
+    emit_mov_imm(code, jit_arg_regs[1], (i64)(uintptr_t)compiler->func);
+    emit_mov_imm(code, jit_arg_regs[2], (i64)(uintptr_t)instr);
+    emit_mov(code, jit_arg_regs[3], JIT_BASE);
+    emit_call_abs(code, &jit_call_native);
+
+    if (instr->a != BC_NULL_REG) {
+        emit_normalize(code, JIT_RAX, (IRType)instr->type);
+        emit_store(code, instr->a, JIT_RAX);
+    }
+}
+
+static bool emit_instr(JITCompiler* compiler, const BCInstr* instr) {
+    Vector* code = &compiler->code;
+    const BCOpcode op = get_bc_base_opcode((BCOpcode)instr->op);
+    const IRType type = (IRType)instr->type;
+
+    switch (op) {
+    case BC_OP_NOP: break;
+    case BC_OP_CONST: {
+        emit_mov_imm(code, JIT_RAX, BC_INSTR_IMM(instr));
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_CONST_WIDE: {
+        emit_mov_imm(code, JIT_RAX, *(const i64*)vector_get_ref(&compiler->func->constants, BC_INSTR_INDEX(instr)));
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_STR: {
+        emit_mov_imm(code, JIT_RAX, (i64)(uintptr_t)bc_module_get_string(compiler->jit->module, BC_INSTR_INDEX(instr)));
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_COPY: {
+        emit_load_normalized(code, JIT_RAX, instr->b, type);
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_NEG:
+    case BC_OP_NOT: {
+        emit_load(code, JIT_RAX, instr->b);
+        emit_rr(code, true, 0xF7, op == BC_OP_NEG ? 3 : 2, JIT_RAX);
+        emit_normalize(code, JIT_RAX, type);
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_LNOT: {
+        emit_load(code, JIT_RAX, instr->b);
+        emit_rr(code, true, 0x85, JIT_RAX, JIT_RAX);
+        emit_setcc(code, JIT_CC_E, JIT_RAX);
+        emit_rr(code, false, 0x0FB6, JIT_RAX, JIT_RAX);
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_ADD: emit_binary(code, instr, 0x01); break;
+    case BC_OP_SUB: emit_binary(code, instr, 0x29); break;
+    case BC_OP_MUL: emit_binary(code, instr, 0x0FAF); break;
+    case BC_OP_AND: emit_binary(code, instr, 0x21); break;
+    case BC_OP_OR: emit_binary(code, instr, 0x09); break;
+    case BC_OP_XOR: emit_binary(code, instr, 0x31); break;
+    case BC_OP_MULH: {
+        emit_mov_imm(code, jit_arg_regs[0], type);
+        emit_load(code, jit_arg_regs[1], instr->b);
+        emit_load(code, jit_arg_regs[2], instr->c);
+        emit_call_abs(code, &jit_multiply_high);
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_DIV: emit_division(compiler, instr, false); break;
+    case BC_OP_REM: emit_division(compiler, instr, true); break;
+    case BC_OP_SHL: emit_shift(code, instr, true); break;
+    case BC_OP_SHR: emit_shift(code, instr, false); break;
+    case BC_OP_LAND: emit_logical(code, instr, true); break;
+    case BC_OP_LOR: emit_logical(code, instr, false); break;
+    case BC_OP_EQ:
+    case BC_OP_NE:
+    case BC_OP_LT:
+    case BC_OP_LE:
+    case BC_OP_GT:
+    case BC_OP_GE: emit_compare(code, instr, op); break;
+    case BC_OP_LOAD_ELEM: {
+        emit_element_address(compiler, instr->b, instr->c);
+        emit_rm_indexed(code, true, 0x8B, JIT_RAX, JIT_RDX, JIT_RCX);
+        emit_normalize(code, JIT_RAX, type);
+        emit_store(code, instr->a, JIT_RAX);
+    } break;
+    case BC_OP_STORE_ELEM: {
+        emit_element_address(compiler, instr->a, instr->b);
+        emit_load_normalized(code, JIT_RAX, instr->c, type);
+        emit_rm_indexed(code, true, 0x89, JIT_RAX, JIT_RDX, JIT_RCX);
+    } break;
+    case BC_OP_CALL: emit_call_function(compiler, instr); break;
+    case BC_OP_CALL_NATIVE: emit_call_native(compiler, instr); break;
+    case BC_OP_JMP: {
+        add_fixup(compiler, emit_jmp(code), BC_INSTR_INDEX(instr), JIT_FIXUP_JUMP);
+    } break;
+    case BC_OP_BR_TRUE:
+    case BC_OP_BR_FALSE: {
+        emit_load(code, JIT_RAX, instr->a);
+        emit_rr(code, true, 0x85, JIT_RAX, JIT_RAX);
+        add_fixup(compiler, emit_jcc(code, op == BC_OP_BR_TRUE ? JIT_CC_NE : JIT_CC_E), BC_INSTR_INDEX(instr), JIT_FIXUP_JUMP);
+    } break;
+    case BC_OP_RET: {
+        if (instr->a != BC_NULL_REG) {
+            emit_load(code, JIT_RAX, instr->a);
+        }
+        else {
+            emit_rr(code, false, 0x31, JIT_RAX, JIT_RAX);
+        }
+        emit_add_rsp(code, JIT_NATIVE_FRAME_SIZE);
+        emit_ret(code);
+    } break;
+    default: return false;
+    };
+    return true;
+}
+
+// A trap records its status and the function, then unwinds to the entry.
+static void emit_trap(JITCompiler* compiler, const VMStatus status) {
+    Vector* code = &compiler->code;
+
+    emit_rm(code, false, 0xC7, 0, JIT_CONTEXT, JIT_CONTEXT_OFFSET(status));
+    emit_u32(code, status);
+    emit_rm(code, false, 0xC7, 0, JIT_CONTEXT, JIT_CONTEXT_OFFSET(fault_function));
+    emit_u32(code, compiler->func_index);
+    emit_jmp_abs(code, compiler->jit->unwind);
+}
+
+// Every instruction gets the code of its base opcode, the superinstructions are only a shape of the dispatch.
+static bool compile_function_code(JITCompiler* compiler) {
+    const BCFunction* func = compiler->func;
+    const BCInstr* code = (const BCInstr*)func->code.items;
+    const u32 count = (u32)func->code.items_count;
+
+    emit_add_rsp(&compiler->code, -JIT_NATIVE_FRAME_SIZE);
+
+    for (u32 i = 0; i < count; ++i) {
+        compiler->offsets[i] = (u32)compiler->code.items_count;
+        if (!emit_instr(compiler, &code[i])) {
+            return false;
+        }
+    }
+
+    u32 traps[VM_STATUS_STACK_OVERFLOW + 1] = { 0 };
+    for (u64 i = 0; i < compiler->fixups.items_count; ++i) {
+        const JITFixup* fixup = vector_get_ref(&compiler->fixups, i);
+        if (fixup->kind == JIT_FIXUP_TRAP && traps[fixup->target] == 0) {
+            traps[fixup->target] = (u32)compiler->code.items_count;
+            emit_trap(compiler, (VMStatus)fixup->target);
+        }
+    }
+
+    for (u64 i = 0; i < compiler->fixups.items_count; ++i) {
+        const JITFixup* fixup = vector_get_ref(&compiler->fixups, i);
+        if (fixup->kind == JIT_FIXUP_JUMP) {
+            assert(fixup->target < count);
+            patch_rel32(compiler->code.items, fixup->at, compiler->offsets[fixup->target]);
+        }
+        else if (fixup->kind == JIT_FIXUP_TRAP) {
+            patch_rel32(compiler->code.items, fixup->at, traps[fixup->target]);
+        }
+    }
+    return true;
+}
+
+// Copies the code into the pages and points its calls at their callees, the ones still interpreted at the bridge.
+// The function is registered first, so its own recursive calls go straight to it.
+static bool place_function_code(JITCompiler* compiler) {
+    JIT* jit = compiler->jit;
+    const u64 start = (jit->size + JIT_CODE_ALIGNMENT - 1) & ~(u64)(JIT_CODE_ALIGNMENT - 1);
+    const u64 size = compiler->code.items_count;
+
+    if (start + size > jit->capacity || !jit_begin_write(jit)) {
+        return false;
+    }
+
+    u8* body = jit->memory + start;
+    memcpy(body, compiler->code.items, size);
+    jit->functions[compiler->func_index] = body;
+
+    for (u64 i = 0; i < compiler->fixups.items_count; ++i) {
+        const JITFixup* fixup = vector_get_ref(&compiler->fixups, i);
+        if (fixup->kind == JIT_FIXUP_CALL) {
+            const u8* target = jit->functions[fixup->target] != NULL ? jit->functions[fixup->target] : jit->bridge;
+            patch_rel32(body, fixup->at, (u64)(target - body));
+        }
+    }
+
+    jit_end_write(jit);
+
+    jit->size = start + size;
+    ++jit->compiled_count;
+    return true;
+}
+
+bool jit_compile_function(JIT* jit, const u32 func_index) {
+    assert(jit != NULL && func_index < bc_module_get_functions_count(jit->module));
+
+    if (jit->functions[func_index] != NULL) {
+        return true;
+    }
+    if (jit->memory == NULL || jit->is_rejected[func_index]) {
+        return false;
+    }
+
+    const BCFunction* func = bc_module_get_function(jit->module, func_index);
+    JITCompiler compiler = {
+        .jit = jit,
+        .func = func,
+        .func_index = func_index,
+        .code = vector_create(func->code.items_count * 16 + 64, sizeof(u8), NULL, false),
+        .fixups = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(JITFixup), NULL, false),
+        .offsets = calloc(func->code.items_count + 1, sizeof(u32)),
+    };
+    assert(compiler.offsets != NULL);
+
+    const bool result = compile_function_code(&compiler) && place_function_code(&compiler);
+    if (!result) {
+        jit->is_rejected[func_index] = true;
+    }
+
+    vector_free(&compiler.code);
+    vector_free(&compiler.fixups);
+    free(compiler.offsets);
+
+    return result;
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,489 @@
+#include "vanec/backend/linear_scan.h"
+
+#include <assert.h>
+
+#define NULL_HOME ((u32)-1)
+
+// The positions of an interval given a register at once, the rest is split off and comes back with its home as the hint.
+// Long intervals with many lifetime holes are only compared with the others over this span, which keeps the scan
+// linear in the size of the function.
+#define LINEAR_SCAN_WINDOW 1024
+
+typedef struct {
+    LiveIntervals* intervals;
+    const RegAllocTarget* target;
+
+    Vector unhandled;       // u32 interval, a min heap by start
+    Vector active;          // u32 interval, in a register and covering the position
+    Vector inactive;        // u32 interval, in a register but in a lifetime hole at the position
+    Vector locations;       // RegAllocLocation per interval
+    Vector range_cursors;   // u32 per interval, its first range not ending before the position
+    Vector use_cursors;     // u32 per interval, its first use not before the position
+
+    Vector reg_slots;       // u32 per register, its spill slot or LIVE_NULL_INDEX
+    Vector reg_ends;        // u32 per register, the end of its whole lifetime
+    Vector reg_homes;       // u32 per register, the target register of its last piece or NULL_HOME, for the hints
+    Vector slot_ends;       // u32 per slot, where the register using it dies
+
+    u32 position;           // the start of the current interval
+    u32 window_end;         // the end of the part of the current interval allocated now
+} LinearScan;
+
+static LiveInterval* get_interval(const LinearScan* scan, const u32 interval) {
+    return live_intervals_get(scan->intervals, interval);
+}
+
+static RegAllocLocation* get_location(const LinearScan* scan, const u32 interval) {
+    return (RegAllocLocation*)scan->locations.items + interval;
+}
+
+static void remove_at(Vector* vector, const u64 index) {
+    u32* items = (u32*)vector->items;
+    items[index] = items[--vector->items_count];
+}
+
+#pragma region UNHANDLED
+
+static bool is_before(const LinearScan* scan, const u32 lhs, const u32 rhs) {
+    const u32 lhs_start = get_interval(scan, lhs)->start;
+    const u32 rhs_start = get_interval(scan, rhs)->start;
+    return lhs_start < rhs_start || (lhs_start == rhs_start && lhs < rhs);
+}
+
+static void push_unhandled(LinearScan* scan, const u32 interval) {
+    vector_push_back(&scan->unhandled, &interval);
+
+    u32* heap = (u32*)scan->unhandled.items;
+    for (u64 i = scan->unhandled.items_count - 1; i > 0;) {
+        const u64 parent = (i - 1) / 2;
+        if (!is_before(scan, heap[i], heap[parent])) {
+            break;
+        }
+
+        const u32 item = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = item;
+        i = parent;
+    }
+}
+
+static u32 pop_unhandled(LinearScan* scan) {
+    u32* heap = (u32*)scan->unhandled.items;
+    const u32 top = heap[0];
+    heap[0] = heap[--scan->unhandled.items_count];
+
+    const u64 count = scan->unhandled.items_count;
+    for (u64 i = 0;;) {
+        const u64 left = i * 2 + 1;
+        const u64 right = left + 1;
+
+        u64 min = i;
+        if (left < count && is_before(scan, heap[left], heap[min])) {
+            min = left;
+        }
+        if (right < count && is_before(scan, heap[right], heap[min])) {
+            min = right;
+        }
+        if (min == i) {
+            break;
+        }
+
+        const u32 item = heap[i];
+        heap[i] = heap[min];
+        heap[min] = item;
+        i = min;
+    }
+    return top;
+}
+
+#pragma endregion
+
+#pragma region INTERVALS
+
+// The cursors only move forward with the position, so the lists of ranges and uses are walked about once.
+static bool is_covering(LinearScan* scan, const u32 interval, const u32 position) {
+    u32* cursor = (u32*)scan->range_cursors.items + interval;
+    while (*cursor != LIVE_NULL_INDEX && live_intervals_get_range(scan->intervals, *cursor)->to <= position) {
+        *cursor = live_intervals_get_range(scan->intervals, *cursor)->next;
+    }
+    return *cursor != LIVE_NULL_INDEX && live_intervals_get_range(scan->intervals, *cursor)->from <= position;
+}
+
+static u32 get_next_use(LinearScan* scan, const u32 interval, const u32 position) {
+    u32* cursor = (u32*)scan->use_cursors.items + interval;
+    while (*cursor != LIVE_NULL_INDEX && live_intervals_get_use(scan->intervals, *cursor)->position < scan->position) {
+        *cursor = live_intervals_get_use(scan->intervals, *cursor)->next;
+    }
+
+    for (u32 use = *cursor; use != LIVE_NULL_INDEX; use = live_intervals_get_use(scan->intervals, use)->next) {
+        if (live_intervals_get_use(scan->intervals, use)->position >= position) {
+            return live_intervals_get_use(scan->intervals, use)->position;
+        }
+    }
+    return LIVE_MAX_POSITION;
+}
+
+// The first position an allocated interval shares with the current one, which starts at the position,
+// LIVE_MAX_POSITION when there is none before the end of the window.
+static u32 get_intersection(LinearScan* scan, const u32 allocated, const u32 current) {
+    is_covering(scan, allocated, scan->position);
+
+    u32 a = ((const u32*)scan->range_cursors.items)[allocated];
+    u32 b = get_interval(scan, current)->first_range;
+    while (a != LIVE_NULL_INDEX && b != LIVE_NULL_INDEX) {
+        const LiveRange* ra = live_intervals_get_range(scan->intervals, a);
+        const LiveRange* rb = live_intervals_get_range(scan->intervals, b);
+
+        if (rb->from >= scan->window_end) {
+            break;
+        }
+        if (ra->to <= rb->from) {
+            a = ra->next;
+        }
+        else if (rb->to <= ra->from) {
+            b = rb->next;
+        }
+        else {
+            return ra->from > rb->from ? ra->from : rb->from;
+        }
+    }
+    return LIVE_MAX_POSITION;
+}
+
+static void track_interval(LinearScan* scan, const u32 interval) {
+    const LiveInterval* it = get_interval(scan, interval);
+    const RegAllocLocation location = { .kind = REG_ALLOC_SLOT, .index = LIVE_NULL_INDEX };
+
+    vector_push_back(&scan->locations, &location);
+    vector_push_back(&scan->range_cursors, &it->first_range);
+    vector_push_back(&scan->use_cursors, &it->first_use);
+}
+
+static u32 split_interval(LinearScan* scan, const u32 interval, const u32 position) {
+    const u32 child = split_live_interval(scan->intervals, interval, position);
+    track_interval(scan, child);
+
+    ((u32*)scan->range_cursors.items)[interval] = get_interval(scan, interval)->first_range;
+    ((u32*)scan->use_cursors.items)[interval] = get_interval(scan, interval)->first_use;
+    return child;
+}
+
+static void assign_reg(LinearScan* scan, const u32 interval, const u32 reg) {
+    *get_location(scan, interval) = (RegAllocLocation) { .kind = REG_ALLOC_REGISTER, .index = reg };
+    ((u32*)scan->reg_homes.items)[get_interval(scan, interval)->reg] = reg;
+}
+
+// All the pieces of a register share its slot, a slot is taken over once the register using it is dead.
+static void assign_slot(LinearScan* scan, const u32 interval) {
+    const LiveInterval* it = get_interval(scan, interval);
+    u32* slot = (u32*)scan->reg_slots.items + it->reg;
+
+    if (*slot == LIVE_NULL_INDEX) {
+        u32* slot_ends = (u32*)scan->slot_ends.items;
+        for (u32 i = 0; i < scan->slot_ends.items_count && *slot == LIVE_NULL_INDEX; ++i) {
+            if (slot_ends[i] <= it->start) {
+                *slot = i;
+            }
+        }
+
+        if (*slot == LIVE_NULL_INDEX) {
+            *slot = (u32)scan->slot_ends.items_count;
+            vector_push_back(&scan->slot_ends, &it->end);
+        }
+        ((u32*)scan->slot_ends.items)[*slot] = ((const u32*)scan->reg_ends.items)[it->reg];
+    }
+
+    *get_location(scan, interval) = (RegAllocLocation) { .kind = REG_ALLOC_SLOT, .index = *slot };
+}
+
+// A spilled interval comes back for a register at its next use after the position.
+static void reload_at_next_use(LinearScan* scan, const u32 interval) {
+    const u32 use = get_next_use(scan, interval, scan->position + 1);
+    if (use == LIVE_MAX_POSITION) {
+        return;
+    }
+
+    const u32 position = get_live_boundary_position(use);
+    if (position > get_interval(scan, interval)->start) {
+        push_unhandled(scan, split_interval(scan, interval, position));
+    }
+}
+
+// The part of an active interval from the current instruction on goes to memory.
+static void spill_active(LinearScan* scan, const u32 interval) {
+    const u32 position = get_live_boundary_position(scan->position);
+
+    u32 spilled = interval;
+    if (position > get_interval(scan, interval)->start) {
+        spilled = split_interval(scan, interval, position);
+    }
+
+    assign_slot(scan, spilled);
+    reload_at_next_use(scan, spilled);
+}
+
+// An inactive interval is in a lifetime hole at the position, so it is split there without a move.
+static void spill_inactive(LinearScan* scan, const u32 interval) {
+    const u32 spilled = split_interval(scan, interval, scan->position);
+
+    assign_slot(scan, spilled);
+    reload_at_next_use(scan, spilled);
+}
+
+#pragma endregion
+
+#pragma region ALLOCATION
+
+static void block_calls(const LinearScan* scan, const u32 current, u32* until) {
+    const u32 call = get_live_interval_next_call(scan->intervals, current, scan->position, scan->window_end);
+    if (call == LIVE_MAX_POSITION) {
+        return;
+    }
+
+    for (u32 reg = 0; reg < scan->target->regs_count; ++reg) {
+        if ((scan->target->caller_saved & ((u64)1 << reg)) != 0 && call < until[reg]) {
+            until[reg] = call;
+        }
+    }
+}
+
+// The part of an interval given a register ends where the register stops being free or at the end of the window.
+static void split_allocated(LinearScan* scan, const u32 interval, const u32 position) {
+    if (position < get_interval(scan, interval)->end) {
+        push_unhandled(scan, split_interval(scan, interval, position));
+    }
+}
+
+static bool try_allocate_free_reg(LinearScan* scan, const u32 current) {
+    const u32 regs_count = scan->target->regs_count;
+
+    u32 free_until[REG_ALLOC_MAX_REGS];
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        free_until[reg] = LIVE_MAX_POSITION;
+    }
+
+    for (u64 i = 0; i < scan->active.items_count; ++i) {
+        free_until[get_location(scan, ((const u32*)scan->active.items)[i])->index] = 0;
+    }
+    for (u64 i = 0; i < scan->inactive.items_count; ++i) {
+        const u32 interval = ((const u32*)scan->inactive.items)[i];
+        const u32 reg = get_location(scan, interval)->index;
+        if (free_until[reg] != 0) {
+            const u32 intersection = get_intersection(scan, interval, current);
+            free_until[reg] = intersection < free_until[reg] ? intersection : free_until[reg];
+        }
+    }
+    block_calls(scan, current, free_until);
+
+    const LiveInterval* it = get_interval(scan, current);
+    const u32 start = it->start;
+    const u32 end = scan->window_end;
+
+    // The register of the previous piece first, then the one of the register it is copied from or into.
+    const u32* homes = (const u32*)scan->reg_homes.items;
+    const u32 hints[] = { homes[it->reg], it->hint != IR_NULL_REG ? homes[it->hint] : NULL_HOME };
+
+    u32 reg = NULL_HOME;
+    for (u32 i = 0; i < sizeof(hints) / sizeof(hints[0]) && reg == NULL_HOME; ++i) {
+        if (hints[i] != NULL_HOME && free_until[hints[i]] >= end) {
+            reg = hints[i];
+        }
+    }
+    for (u32 i = 0; i < regs_count && reg == NULL_HOME; ++i) {
+        if (free_until[i] >= end) {
+            reg = i;
+        }
+    }
+    if (reg == NULL_HOME) {
+        u32 max = 0;
+        for (u32 i = 0; i < regs_count; ++i) {
+            if (free_until[i] > max) {
+                max = free_until[i];
+                reg = i;
+            }
+        }
+    }
+
+    // A register free for a part of the interval only is worth it when the split comes after the start.
+    if (reg == NULL_HOME || (free_until[reg] < end && get_live_boundary_position(free_until[reg]) <= start)) {
+        return false;
+    }
+
+    assign_reg(scan, current, reg);
+    split_allocated(scan, current, free_until[reg] < end ? get_live_boundary_position(free_until[reg]) : end);
+    return true;
+}
+
+// Takes the register whose next use is the farthest, or spills the current interval when it is needed later than all of them.
+static void allocate_blocked_reg(LinearScan* scan, const u32 current) {
+    const u32 regs_count = scan->target->regs_count;
+
+    u32 use_pos[REG_ALLOC_MAX_REGS];
+    u32 block_pos[REG_ALLOC_MAX_REGS];
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        use_pos[reg] = LIVE_MAX_POSITION;
+        block_pos[reg] = LIVE_MAX_POSITION;
+    }
+
+    for (u64 i = 0; i < scan->active.items_count; ++i) {
+        const u32 interval = ((const u32*)scan->active.items)[i];
+        const u32 reg = get_location(scan, interval)->index;
+        const u32 use = get_next_use(scan, interval, scan->position);
+        use_pos[reg] = use < use_pos[reg] ? use : use_pos[reg];
+    }
+    for (u64 i = 0; i < scan->inactive.items_count; ++i) {
+        const u32 interval = ((const u32*)scan->inactive.items)[i];
+        const u32 reg = get_location(scan, interval)->index;
+        if (get_intersection(scan, interval, current) != LIVE_MAX_POSITION) {
+            const u32 use = get_next_use(scan, interval, scan->position);
+            use_pos[reg] = use < use_pos[reg] ? use : use_pos[reg];
+        }
+    }
+    block_calls(scan, current, block_pos);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        use_pos[reg] = block_pos[reg] < use_pos[reg] ? block_pos[reg] : use_pos[reg];
+    }
+
+    u32 reg = 0;
+    for (u32 i = 1; i < regs_count; ++i) {
+        if (use_pos[i] > use_pos[reg]) {
+            reg = i;
+        }
+    }
+
+    const u32 start = get_interval(scan, current)->start;
+    const u32 end = scan->window_end;
+    const u32 first_use = get_next_use(scan, current, scan->position);
+
+    if (use_pos[reg] <= first_use || (block_pos[reg] < end && get_live_boundary_position(block_pos[reg]) <= start)) {
+        assign_slot(scan, current);
+        reload_at_next_use(scan, current);
+        return;
+    }
+
+    assign_reg(scan, current, reg);
+    split_allocated(scan, current, block_pos[reg] < end ? get_live_boundary_position(block_pos[reg]) : end);
+
+    for (u64 i = 0; i < scan->active.items_count;) {
+        const u32 interval = ((const u32*)scan->active.items)[i];
+        if (get_location(scan, interval)->index != reg) {
+            ++i;
+            continue;
+        }
+
+        remove_at(&scan->active, i);
+        spill_active(scan, interval);
+    }
+    for (u64 i = 0; i < scan->inactive.items_count;) {
+        const u32 interval = ((const u32*)scan->inactive.items)[i];
+        if (get_location(scan, interval)->index != reg || get_intersection(scan, interval, current) == LIVE_MAX_POSITION) {
+            ++i;
+            continue;
+        }
+
+        remove_at(&scan->inactive, i);
+        spill_inactive(scan, interval);
+    }
+}
+
+// Moves the intervals that ended to handled and the ones entering or leaving a lifetime hole between active and inactive.
+static void advance(LinearScan* scan) {
+    for (u64 i = 0; i < scan->active.items_count;) {
+        const u32 interval = ((const u32*)scan->active.items)[i];
+        if (get_interval(scan, interval)->end <= scan->position) {
+            remove_at(&scan->active, i);
+        }
+        else if (!is_covering(scan, interval, scan->position)) {
+            remove_at(&scan->active, i);
+            vector_push_back(&scan->inactive, &interval);
+        }
+        else {
+            ++i;
+        }
+    }
+
+    for (u64 i = 0; i < scan->inactive.items_count;) {
+        const u32 interval = ((const u32*)scan->inactive.items)[i];
+        if (get_interval(scan, interval)->end <= scan->position) {
+            remove_at(&scan->inactive, i);
+        }
+        else if (is_covering(scan, interval, scan->position)) {
+            remove_at(&scan->inactive, i);
+            vector_push_back(&scan->active, &interval);
+        }
+        else {
+            ++i;
+        }
+    }
+}
+
+#pragma endregion
+
+void allocate_registers_linear_scan(RegAllocation* allocation, LiveIntervals* intervals, const RegAllocTarget* target) {
+    assert(allocation != NULL && intervals != NULL && target != NULL);
+    assert(target->regs_count > 0 && target->regs_count <= REG_ALLOC_MAX_REGS);
+
+    LinearScan scan = {
+        .intervals = intervals,
+        .target = target,
+        .unhandled = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .active = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .inactive = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .locations = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocLocation), NULL, false),
+        .range_cursors = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .use_cursors = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_slots = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_ends = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_homes = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .slot_ends = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .position = 0,
+        .window_end = 0,
+    };
+
+    const u32 null_index = LIVE_NULL_INDEX;
+    const u32 null_home = NULL_HOME;
+    for (u32 i = 0; i < live_intervals_get_count(intervals); ++i) {
+        track_interval(&scan, i);
+    }
+    for (u32 reg = 0; reg < intervals->regs_count; ++reg) {
+        const LiveInterval* it = live_intervals_get(intervals, reg);
+
+        vector_push_back(&scan.reg_slots, &null_index);
+        vector_push_back(&scan.reg_ends, &it->end);
+        vector_push_back(&scan.reg_homes, &null_home);
+
+        if (it->first_range != LIVE_NULL_INDEX) {
+            push_unhandled(&scan, reg);
+        }
+    }
+
+    while (scan.unhandled.items_count > 0) {
+        const u32 current = pop_unhandled(&scan);
+        scan.position = get_interval(&scan, current)->start;
+
+        const u32 window_end = get_live_boundary_position(scan.position + LINEAR_SCAN_WINDOW);
+        scan.window_end = window_end < get_interval(&scan, current)->end ? window_end : get_interval(&scan, current)->end;
+
+        advance(&scan);
+
+        if (!try_allocate_free_reg(&scan, current)) {
+            allocate_blocked_reg(&scan, current);
+        }
+        if (get_location(&scan, current)->kind == REG_ALLOC_REGISTER) {
+            vector_push_back(&scan.active, &current);
+        }
+    }
+
+    reg_allocation_build(allocation, intervals, (const RegAllocLocation*)scan.locations.items, (u32)scan.slot_ends.items_count);
+
+    vector_free(&scan.unhandled);
+    vector_free(&scan.active);
+    vector_free(&scan.inactive);
+    vector_free(&scan.locations);
+    vector_free(&scan.range_cursors);
+    vector_free(&scan.use_cursors);
+    vector_free(&scan.reg_slots);
+    vector_free(&scan.reg_ends);
+    vector_free(&scan.reg_homes);
+    vector_free(&scan.slot_ends);
+}
\ No newline at end of file
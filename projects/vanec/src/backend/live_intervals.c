@@ -0,0 +1,509 @@
+#include "vanec/backend/live_intervals.h"
+
+#include <assert.h>
+#include <string.h>
+
+LiveIntervals live_intervals_create(void) {
+    return (LiveIntervals) {
+        .liveness = liveness_create(),
+        .intervals = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LiveInterval), NULL, false),
+        .ranges = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LiveRange), NULL, false),
+        .uses = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LiveUse), NULL, false),
+        .block_starts = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .block_ends = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .is_block_first = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(bool), NULL, false),
+        .calls = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .copies = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LiveCopy), NULL, false),
+        .loop_depths = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .regs_count = 0,
+        .instrs_count = 0,
+    };
+}
+
+void live_intervals_free(LiveIntervals* intervals) {
+    if (intervals == NULL) {
+        return;
+    }
+
+    liveness_free(&intervals->liveness);
+    vector_free(&intervals->intervals);
+    vector_free(&intervals->ranges);
+    vector_free(&intervals->uses);
+    vector_free(&intervals->block_starts);
+    vector_free(&intervals->block_ends);
+    vector_free(&intervals->is_block_first);
+    vector_free(&intervals->calls);
+    vector_free(&intervals->copies);
+    vector_free(&intervals->loop_depths);
+}
+
+void live_intervals_clear(LiveIntervals* intervals) {
+    assert(intervals != NULL);
+
+    liveness_clear(&intervals->liveness);
+    vector_clear(&intervals->intervals);
+    vector_clear(&intervals->ranges);
+    vector_clear(&intervals->uses);
+    vector_clear(&intervals->block_starts);
+    vector_clear(&intervals->block_ends);
+    vector_clear(&intervals->is_block_first);
+    vector_clear(&intervals->calls);
+    vector_clear(&intervals->copies);
+    vector_clear(&intervals->loop_depths);
+    intervals->regs_count = 0;
+    intervals->instrs_count = 0;
+}
+
+static LiveRange* get_range(const LiveIntervals* intervals, const u32 range) {
+    return (LiveRange*)intervals->ranges.items + range;
+}
+
+static LiveUse* get_use(const LiveIntervals* intervals, const u32 use) {
+    return (LiveUse*)intervals->uses.items + use;
+}
+
+#pragma region BUILDING
+
+// The blocks are walked backwards, so a new range is never after the first one of the interval and merges with it when they touch.
+static void add_range(LiveIntervals* intervals, const u32 reg, const u32 from, const u32 to) {
+    LiveInterval* interval = live_intervals_get(intervals, reg);
+
+    if (interval->first_range != LIVE_NULL_INDEX) {
+        LiveRange* first = get_range(intervals, interval->first_range);
+        if (to >= first->from) {
+            first->from = from < first->from ? from : first->from;
+            first->to = to > first->to ? to : first->to;
+            return;
+        }
+    }
+
+    const LiveRange range = { .from = from, .to = to, .next = interval->first_range };
+    vector_push_back(&intervals->ranges, &range);
+    interval->first_range = (u32)(intervals->ranges.items_count - 1);
+}
+
+// A definition starts the range it falls in, a dead one gets a range of its own.
+static void add_def(LiveIntervals* intervals, const u32 reg, const u32 position) {
+    LiveInterval* interval = live_intervals_get(intervals, reg);
+
+    if (interval->first_range != LIVE_NULL_INDEX && get_range(intervals, interval->first_range)->from <= position) {
+        get_range(intervals, interval->first_range)->from = position;
+        return;
+    }
+    add_range(intervals, reg, position, position + 1);
+}
+
+static void add_use(LiveIntervals* intervals, const u32 reg, const u32 position) {
+    LiveInterval* interval = live_intervals_get(intervals, reg);
+
+    const LiveUse use = { .position = position, .next = interval->first_use };
+    vector_push_back(&intervals->uses, &use);
+    interval->first_use = (u32)(intervals->uses.items_count - 1);
+}
+
+// The registers live out of the block are live over all of it, then the instructions shorten them backwards.
+static void build_block_intervals(LiveIntervals* intervals, const CFGContext* ctx, const u32 block) {
+    const IRFunction* func = &ctx->ir;
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    if (node->instrs_count == 0) {
+        return;
+    }
+
+    const u32 from = live_intervals_get_block_start(intervals, block);
+    const u32 to = live_intervals_get_block_end(intervals, block);
+    const u32 first_index = from / LIVE_POSITIONS_PER_INSTR;
+
+    const u64* live_out = liveness_get_live_out(&intervals->liveness, block);
+    const u32 words_count = intervals->liveness.problem.words_count;
+    for (u32 bit = bit_set_next(live_out, words_count, 0); bit != BIT_SET_NULL_BIT; bit = bit_set_next(live_out, words_count, bit + 1)) {
+        add_range(intervals, liveness_get_bit_reg(&intervals->liveness, bit), from, to);
+    }
+
+    // The phis of the succs read their operands on the edges, after the last instruction.
+    u32 succs_count = 0;
+    const u32* succs = cfg_graph_get_succs(&ctx->graph, block, &succs_count);
+    const u32* pred_indices = cfg_graph_get_succ_pred_indices(&ctx->graph, block, &succs_count);
+    const u32 last_use = get_live_use_position(first_index + node->instrs_count - 1);
+
+    for (u32 i = 0; i < succs_count; ++i) {
+        const CFGNode* succ = cfg_context_get_node(ctx, succs[i]);
+        for (u32 j = 0; j < succ->instrs_count; ++j) {
+            const IRInstr* phi = ir_function_get_instr(func, succ->instrs_begin + j);
+            if (phi->op != IR_OP_PHI) {
+                break;
+            }
+
+            const u32 src = ir_function_get_list(func, phi->as.phi.first)[pred_indices[i] * 2 + 1];
+            if (src != IR_NULL_REG) {
+                add_use(intervals, src, last_use);
+            }
+        }
+    }
+
+    for (u32 i = node->instrs_count; i-- > 0;) {
+        IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+        const u32 index = first_index + i;
+
+        if (instr->op == IR_OP_NOP) {
+            continue;
+        }
+        if (instr->op == IR_OP_PHI) {
+            add_def(intervals, instr->dst, from);
+            continue;
+        }
+
+        if (instr->op == IR_OP_CALL) {
+            const u32 position = get_live_clobber_position(index);
+            vector_push_back(&intervals->calls, &position);
+        }
+
+        if (instr->dst != IR_NULL_REG) {
+            add_def(intervals, instr->dst, get_live_def_position(index));
+        }
+
+        const u32 uses_count = ir_function_get_uses_count(func, instr);
+        for (u32 j = 0; j < uses_count; ++j) {
+            const u32 reg = *ir_function_get_use_ref(func, instr, j);
+            if (reg != IR_NULL_REG) {
+                add_range(intervals, reg, from, get_live_use_position(index) + 1);
+                add_use(intervals, reg, get_live_use_position(index));
+            }
+        }
+    }
+}
+
+static void add_copy(LiveIntervals* intervals, const u32 dst, const u32 src, const u32 position) {
+    LiveInterval* dst_interval = live_intervals_get(intervals, dst);
+    LiveInterval* src_interval = live_intervals_get(intervals, src);
+    dst_interval->hint = dst_interval->hint == IR_NULL_REG ? src : dst_interval->hint;
+    src_interval->hint = src_interval->hint == IR_NULL_REG ? dst : src_interval->hint;
+
+    const LiveCopy copy = { .dst = dst, .src = src, .position = position };
+    vector_push_back(&intervals->copies, &copy);
+}
+
+// Copies hint their two registers to each other, a phi its result to its first operand and the operands to the result.
+// The operands of a phi are read at the last instruction of their pred.
+static void add_copies(LiveIntervals* intervals, const CFGContext* ctx, const u32* rpo, const u32 rpo_count) {
+    const IRFunction* func = &ctx->ir;
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+        const u32 first_index = live_intervals_get_block_start(intervals, rpo[i]) / LIVE_POSITIONS_PER_INSTR;
+
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            const IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + j);
+
+            if (instr->op == IR_OP_COPY && instr->a != IR_NULL_REG) {
+                add_copy(intervals, instr->dst, instr->a, get_live_use_position(first_index + j));
+            }
+            else if (instr->op == IR_OP_PHI) {
+                const u32* incoming = ir_function_get_list(func, instr->as.phi.first);
+                for (u32 k = 0; k < instr->as.phi.count; ++k) {
+                    const u32 end = live_intervals_get_block_end(intervals, incoming[k * 2]);
+                    if (incoming[k * 2 + 1] != IR_NULL_REG && end != LIVE_MAX_POSITION && end > 0) {
+                        add_copy(intervals, instr->dst, incoming[k * 2 + 1], end - LIVE_POSITIONS_PER_INSTR);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// A jump to a block laid out at or before its own block goes back over all the instructions in between.
+// The depths are counted as differences at the ends of the spans first and summed up once.
+static void add_loop_depths(LiveIntervals* intervals, const CFGContext* ctx, const u32* rpo, const u32 rpo_count) {
+    const u32 depths_count = intervals->instrs_count + 1;
+    u32* depths = memset(vector_resize(&intervals->loop_depths, depths_count), 0, depths_count * sizeof(u32));
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 start = live_intervals_get_block_start(intervals, rpo[i]);
+        const u32 end = live_intervals_get_block_end(intervals, rpo[i]);
+
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(&ctx->graph, rpo[i], &succs_count);
+        for (u32 j = 0; j < succs_count; ++j) {
+            const u32 target = live_intervals_get_block_start(intervals, succs[j]);
+            if (target <= start && target < end) {
+                ++depths[target / LIVE_POSITIONS_PER_INSTR];
+                --depths[end / LIVE_POSITIONS_PER_INSTR];
+            }
+        }
+    }
+
+    for (u32 i = 1; i < intervals->instrs_count; ++i) {
+        depths[i] += depths[i - 1];
+    }
+    intervals->loop_depths.items_count = intervals->instrs_count;
+}
+
+void live_intervals_build(LiveIntervals* intervals, const CFGContext* ctx) {
+    assert(intervals != NULL && ctx != NULL);
+
+    live_intervals_clear(intervals);
+    liveness_build(&intervals->liveness, ctx);
+
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    intervals->regs_count = regs_count;
+    vector_reserve(&intervals->intervals, regs_count);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        const LiveInterval interval = {
+            .reg = reg,
+            .first_range = LIVE_NULL_INDEX,
+            .first_use = LIVE_NULL_INDEX,
+            .start = LIVE_MAX_POSITION,
+            .end = LIVE_MAX_POSITION,
+            .hint = IR_NULL_REG,
+        };
+        vector_push_back(&intervals->intervals, &interval);
+    }
+
+    const u32 max_position = LIVE_MAX_POSITION;
+    vector_resize(&intervals->block_starts, nodes_count);
+    vector_fill(&intervals->block_starts, &max_position);
+    vector_resize(&intervals->block_ends, nodes_count);
+    vector_fill(&intervals->block_ends, &max_position);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    u32 index = 0;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        ((u32*)intervals->block_starts.items)[rpo[i]] = get_live_use_position(index);
+        index += cfg_context_get_node(ctx, rpo[i])->instrs_count;
+        ((u32*)intervals->block_ends.items)[rpo[i]] = get_live_use_position(index);
+    }
+    intervals->instrs_count = index;
+
+    memset(vector_resize(&intervals->is_block_first, index), false, index * sizeof(bool));
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 start = live_intervals_get_block_start(intervals, rpo[i]) / LIVE_POSITIONS_PER_INSTR;
+        if (start < index) {
+            ((bool*)intervals->is_block_first.items)[start] = true;
+        }
+    }
+
+    for (u32 i = rpo_count; i-- > 0;) {
+        build_block_intervals(intervals, ctx, rpo[i]);
+    }
+
+    // The calls were found backwards.
+    u32* calls = (u32*)intervals->calls.items;
+    for (u64 i = 0, j = intervals->calls.items_count; i + 1 < j; ++i, --j) {
+        const u32 call = calls[i];
+        calls[i] = calls[j - 1];
+        calls[j - 1] = call;
+    }
+
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        LiveInterval* interval = live_intervals_get(intervals, reg);
+        if (interval->first_range == LIVE_NULL_INDEX) {
+            continue;
+        }
+
+        u32 range = interval->first_range;
+        interval->start = get_range(intervals, range)->from;
+        while (get_range(intervals, range)->next != LIVE_NULL_INDEX) {
+            range = get_range(intervals, range)->next;
+        }
+        interval->end = get_range(intervals, range)->to;
+    }
+
+    add_copies(intervals, ctx, rpo, rpo_count);
+    add_loop_depths(intervals, ctx, rpo, rpo_count);
+}
+
+#pragma endregion
+
+#pragma region QUERIES
+
+u32 live_intervals_get_count(const LiveIntervals* intervals) {
+    assert(intervals != NULL);
+
+    return (u32)intervals->intervals.items_count;
+}
+
+LiveInterval* live_intervals_get(const LiveIntervals* intervals, const u32 index) {
+    assert(intervals != NULL && index < intervals->intervals.items_count);
+
+    return (LiveInterval*)intervals->intervals.items + index;
+}
+
+const LiveRange* live_intervals_get_range(const LiveIntervals* intervals, const u32 range) {
+    assert(intervals != NULL && range < intervals->ranges.items_count);
+
+    return get_range(intervals, range);
+}
+
+const LiveUse* live_intervals_get_use(const LiveIntervals* intervals, const u32 use) {
+    assert(intervals != NULL && use < intervals->uses.items_count);
+
+    return get_use(intervals, use);
+}
+
+u32 live_intervals_get_block_start(const LiveIntervals* intervals, const u32 block) {
+    assert(intervals != NULL && block < intervals->block_starts.items_count);
+
+    return ((const u32*)intervals->block_starts.items)[block];
+}
+
+u32 live_intervals_get_block_end(const LiveIntervals* intervals, const u32 block) {
+    assert(intervals != NULL && block < intervals->block_ends.items_count);
+
+    return ((const u32*)intervals->block_ends.items)[block];
+}
+
+bool is_live_block_start(const LiveIntervals* intervals, const u32 position) {
+    assert(intervals != NULL);
+
+    const u32 index = position / LIVE_POSITIONS_PER_INSTR;
+    return position % LIVE_POSITIONS_PER_INSTR == 0 && index < intervals->instrs_count
+        && ((const bool*)intervals->is_block_first.items)[index];
+}
+
+u32 get_live_loop_depth(const LiveIntervals* intervals, const u32 position) {
+    assert(intervals != NULL);
+
+    const u32 index = position / LIVE_POSITIONS_PER_INSTR;
+    return index < intervals->instrs_count ? ((const u32*)intervals->loop_depths.items)[index] : 0;
+}
+
+bool is_live_interval_covering(const LiveIntervals* intervals, const u32 interval, const u32 position) {
+    for (u32 range = live_intervals_get(intervals, interval)->first_range; range != LIVE_NULL_INDEX; range = get_range(intervals, range)->next) {
+        const LiveRange* r = get_range(intervals, range);
+        if (position < r->from) {
+            return false;
+        }
+        if (position < r->to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u32 get_live_intervals_intersection(const LiveIntervals* intervals, const u32 lhs, const u32 rhs) {
+    u32 a = live_intervals_get(intervals, lhs)->first_range;
+    u32 b = live_intervals_get(intervals, rhs)->first_range;
+
+    while (a != LIVE_NULL_INDEX && b != LIVE_NULL_INDEX) {
+        const LiveRange* ra = get_range(intervals, a);
+        const LiveRange* rb = get_range(intervals, b);
+
+        if (ra->to <= rb->from) {
+            a = ra->next;
+        }
+        else if (rb->to <= ra->from) {
+            b = rb->next;
+        }
+        else {
+            return ra->from > rb->from ? ra->from : rb->from;
+        }
+    }
+    return LIVE_MAX_POSITION;
+}
+
+u32 get_live_interval_next_use(const LiveIntervals* intervals, const u32 interval, const u32 position) {
+    for (u32 use = live_intervals_get(intervals, interval)->first_use; use != LIVE_NULL_INDEX; use = get_use(intervals, use)->next) {
+        if (get_use(intervals, use)->position >= position) {
+            return get_use(intervals, use)->position;
+        }
+    }
+    return LIVE_MAX_POSITION;
+}
+
+// The first call at or after the position.
+static u32 find_call(const LiveIntervals* intervals, const u32 position) {
+    const u32* calls = (const u32*)intervals->calls.items;
+
+    u32 lo = 0;
+    u32 hi = (u32)intervals->calls.items_count;
+    while (lo < hi) {
+        const u32 mid = lo + (hi - lo) / 2;
+        if (calls[mid] < position) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo < intervals->calls.items_count ? calls[lo] : LIVE_MAX_POSITION;
+}
+
+// The ranges and the calls are walked together, each skipping to the other, and the walk stops at the end of the span.
+u32 get_live_interval_next_call(const LiveIntervals* intervals, const u32 interval, const u32 from, const u32 to) {
+    u32 range = live_intervals_get(intervals, interval)->first_range;
+    u32 call = find_call(intervals, from);
+
+    while (range != LIVE_NULL_INDEX && call < to) {
+        const LiveRange* r = get_range(intervals, range);
+        if (r->to <= call) {
+            range = r->next;
+        }
+        else if (r->from > call) {
+            call = find_call(intervals, r->from);
+        }
+        else {
+            return call;
+        }
+    }
+    return LIVE_MAX_POSITION;
+}
+
+#pragma endregion
+
+u32 split_live_interval(LiveIntervals* intervals, const u32 interval, const u32 position) {
+    LiveInterval* parent = live_intervals_get(intervals, interval);
+    assert(position > parent->start && position < parent->end);
+
+    u32 prev = LIVE_NULL_INDEX;
+    u32 range = parent->first_range;
+    while (get_range(intervals, range)->to <= position) {
+        prev = range;
+        range = get_range(intervals, range)->next;
+    }
+
+    u32 child_first = range;
+    u32 parent_end = 0;
+    if (get_range(intervals, range)->from < position) {
+        const LiveRange tail = { .from = position, .to = get_range(intervals, range)->to, .next = get_range(intervals, range)->next };
+        vector_push_back(&intervals->ranges, &tail);
+        child_first = (u32)(intervals->ranges.items_count - 1);
+
+        get_range(intervals, range)->to = position;
+        get_range(intervals, range)->next = LIVE_NULL_INDEX;
+        parent_end = position;
+    }
+    else {
+        assert(prev != LIVE_NULL_INDEX);
+        get_range(intervals, prev)->next = LIVE_NULL_INDEX;
+        parent_end = get_range(intervals, prev)->to;
+    }
+
+    u32 prev_use = LIVE_NULL_INDEX;
+    u32 use = parent->first_use;
+    while (use != LIVE_NULL_INDEX && get_use(intervals, use)->position < position) {
+        prev_use = use;
+        use = get_use(intervals, use)->next;
+    }
+    if (prev_use == LIVE_NULL_INDEX) {
+        parent->first_use = LIVE_NULL_INDEX;
+    }
+    else {
+        get_use(intervals, prev_use)->next = LIVE_NULL_INDEX;
+    }
+
+    const LiveInterval child = {
+        .reg = parent->reg,
+        .first_range = child_first,
+        .first_use = use,
+        .start = get_range(intervals, child_first)->from,
+        .end = parent->end,
+        .hint = parent->hint,
+    };
+    parent->end = parent_end;
+
+    vector_push_back(&intervals->intervals, &child);
+    return (u32)(intervals->intervals.items_count - 1);
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "vanec/backend/reg_alloc.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+RegAllocation reg_allocation_create(void) {
+    return (RegAllocation) {
+        .pieces = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocPiece), NULL, false),
+        .first_pieces = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .slots_count = 0,
+        .used_regs = 0,
+        .spilled_count = 0,
+        .split_count = 0,
+    };
+}
+
+void reg_allocation_free(RegAllocation* allocation) {
+    if (allocation == NULL) {
+        return;
+    }
+
+    vector_free(&allocation->pieces);
+    vector_free(&allocation->first_pieces);
+}
+
+void reg_allocation_clear(RegAllocation* allocation) {
+    assert(allocation != NULL);
+
+    vector_clear(&allocation->pieces);
+    vector_clear(&allocation->first_pieces);
+    allocation->slots_count = 0;
+    allocation->used_regs = 0;
+    allocation->spilled_count = 0;
+    allocation->split_count = 0;
+}
+
+bool is_same_reg_alloc_location(const RegAllocLocation lhs, const RegAllocLocation rhs) {
+    return lhs.kind == rhs.kind && lhs.index == rhs.index;
+}
+
+static int compare_pieces(const void* lhs, const void* rhs) {
+    const RegAllocPiece* a = lhs;
+    const RegAllocPiece* b = rhs;
+
+    if (a->reg != b->reg) {
+        return a->reg < b->reg ? -1 : 1;
+    }
+    return a->start < b->start ? -1 : (a->start > b->start ? 1 : 0);
+}
+
+// Consecutive pieces of a register in the same location are merged, so the counts only see the splits that move a value.
+void reg_allocation_build(RegAllocation* allocation, const LiveIntervals* intervals, const RegAllocLocation* locations, const u32 slots_count) {
+    assert(allocation != NULL && intervals != NULL && locations != NULL);
+
+    reg_allocation_clear(allocation);
+    allocation->slots_count = slots_count;
+
+    const u32 count = live_intervals_get_count(intervals);
+    for (u32 i = 0; i < count; ++i) {
+        const LiveInterval* interval = live_intervals_get(intervals, i);
+        if (interval->first_range != LIVE_NULL_INDEX) {
+            const RegAllocPiece piece = { .reg = interval->reg, .start = interval->start, .location = locations[i] };
+            vector_push_back(&allocation->pieces, &piece);
+        }
+    }
+
+    qsort(allocation->pieces.items, allocation->pieces.items_count, sizeof(RegAllocPiece), &compare_pieces);
+
+    RegAllocPiece* pieces = (RegAllocPiece*)allocation->pieces.items;
+    u64 pieces_count = 0;
+    for (u64 i = 0; i < allocation->pieces.items_count; ++i) {
+        const RegAllocPiece* piece = &pieces[i];
+        if (pieces_count > 0 && pieces[pieces_count - 1].reg == piece->reg
+            && is_same_reg_alloc_location(pieces[pieces_count - 1].location, piece->location)) {
+            continue;
+        }
+
+        if (piece->location.kind == REG_ALLOC_REGISTER) {
+            allocation->used_regs |= (u64)1 << piece->location.index;
+        }
+        else {
+            ++allocation->spilled_count;
+        }
+        allocation->split_count += pieces_count > 0 && pieces[pieces_count - 1].reg == piece->reg;
+
+        pieces[pieces_count++] = *piece;
+    }
+    allocation->pieces.items_count = pieces_count;
+
+    u32* first_pieces = vector_resize(&allocation->first_pieces, (u64)intervals->regs_count + 1);
+    u32 piece = 0;
+    for (u32 reg = 0; reg <= intervals->regs_count; ++reg) {
+        while (piece < pieces_count && pieces[piece].reg < reg) {
+            ++piece;
+        }
+        first_pieces[reg] = piece;
+    }
+}
+
+bool is_reg_allocated(const RegAllocation* allocation, const u32 reg) {
+    assert(allocation != NULL && reg + 1 < allocation->first_pieces.items_count);
+
+    const u32* first_pieces = (const u32*)allocation->first_pieces.items;
+    return first_pieces[reg] != first_pieces[reg + 1];
+}
+
+RegAllocLocation reg_allocation_get_location(const RegAllocation* allocation, const u32 reg, const u32 position) {
+    assert(is_reg_allocated(allocation, reg));
+
+    const u32* first_pieces = (const u32*)allocation->first_pieces.items;
+    const RegAllocPiece* pieces = (const RegAllocPiece*)allocation->pieces.items;
+
+    // The last piece starting at or before the position.
+    u32 lo = first_pieces[reg] + 1;
+    u32 hi = first_pieces[reg + 1];
+    while (lo < hi) {
+        const u32 mid = lo + (hi - lo) / 2;
+        if (pieces[mid].start <= position) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return pieces[lo - 1].location;
+}
+
+static int compare_moves(const void* lhs, const void* rhs) {
+    const RegAllocMove* a = lhs;
+    const RegAllocMove* b = rhs;
+
+    if (a->position != b->position) {
+        return a->position < b->position ? -1 : 1;
+    }
+    return a->reg < b->reg ? -1 : (a->reg > b->reg ? 1 : 0);
+}
+
+void reg_allocation_collect_split_moves(const RegAllocation* allocation, const LiveIntervals* intervals, Vector* moves) {
+    assert(allocation != NULL && intervals != NULL && moves != NULL);
+
+    vector_clear(moves);
+
+    // A piece starting at a definition or after a lifetime hole has no value to move.
+    const RegAllocPiece* pieces = (const RegAllocPiece*)allocation->pieces.items;
+    for (u64 i = 1; i < allocation->pieces.items_count; ++i) {
+        const RegAllocPiece* prev = &pieces[i - 1];
+        const RegAllocPiece* piece = &pieces[i];
+
+        if (prev->reg != piece->reg || is_same_reg_alloc_location(prev->location, piece->location)
+            || piece->start % LIVE_POSITIONS_PER_INSTR != 0 || is_live_block_start(intervals, piece->start)) {
+            continue;
+        }
+
+        const RegAllocMove move = { .position = piece->start, .reg = piece->reg, .from = prev->location, .to = piece->location };
+        vector_push_back(moves, &move);
+    }
+
+    qsort(moves->items, moves->items_count, sizeof(RegAllocMove), &compare_moves);
+}
\ No newline at end of file
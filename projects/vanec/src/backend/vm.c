@@ -0,0 +1,742 @@
+#include "vanec/backend/vm.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vanec/backend/jit.h"
+
+#include "vanec/utils/string_utils.h"
+
+// Computed goto threads the dispatch through the handlers, every one of them jumps to the next on its own.
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_THREADED_DISPATCH
+#endif
+
+#define VM_TYPE_BITS(SIZE) ((SIZE) == 0 ? 64 : (SIZE) * 8)
+
+// A value is normalized to its type as '((value & mask) ^ sign) - sign', which also sign extends it.
+static const u64 vm_type_masks[IR_TYPES_COUNT] = {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) (~(u64)0 >> (64 - VM_TYPE_BITS(SIZE))),
+#include "vanec/ir/ir_type.def"
+};
+
+static const u64 vm_type_signs[IR_TYPES_COUNT] = {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) ((u64)(IS_SIGNED) << (VM_TYPE_BITS(SIZE) - 1)),
+#include "vanec/ir/ir_type.def"
+};
+
+static inline i64 vm_normalize(const u8 type, const i64 value) {
+    if (type == IR_TYPE_BOOL) {
+        return value != 0;
+    }
+    return (i64)((((u64)value & vm_type_masks[type]) ^ vm_type_signs[type]) - vm_type_signs[type]);
+}
+
+VM vm_create(const BCModule* module, FILE* out, const u32 stack_size, const u32 max_frames) {
+    assert(module != NULL && out != NULL);
+    assert(stack_size > 0 && max_frames > 0);
+
+    i64* stack = malloc(stack_size * sizeof(i64));
+    VMFrame* frames = malloc(max_frames * sizeof(VMFrame));
+    assert(stack != NULL && frames != NULL);
+
+    return (VM) {
+        .module = module,
+        .out = out,
+        .stack = stack,
+        .stack_size = stack_size,
+        .frames = frames,
+        .max_frames = max_frames,
+        .executed_count = 0,
+        .profile = NULL,
+        .jit = NULL,
+        .status = VM_STATUS_OK,
+        .fault_function = NULL,
+    };
+}
+
+void vm_free(VM* vm) {
+    if (vm == NULL) {
+        return;
+    }
+
+    free(vm->stack);
+    free(vm->frames);
+
+    vm->stack = NULL;
+    vm->frames = NULL;
+}
+
+const char* get_vm_status_text(const VMStatus status) {
+    switch (status) {
+    case VM_STATUS_OK: return "ok";
+    case VM_STATUS_DIVISION_BY_ZERO: return "division by zero";
+    case VM_STATUS_DIVISION_OVERFLOW: return "division overflow";
+    case VM_STATUS_INDEX_OUT_OF_RANGE: return "index out of range";
+    case VM_STATUS_STACK_OVERFLOW: return "stack overflow";
+    default: return NULL;
+    };
+}
+
+#pragma region NATIVES
+
+// The arguments of a native stay in the slots of the caller.
+typedef struct {
+    const i64* slots;
+    const u8* types;
+    const u16* regs;
+    u32 count;
+} VMNativeArgs;
+
+typedef i64(*VMNative)(VM* vm, const VMNativeArgs* args);
+
+static i64 get_native_arg(const VMNativeArgs* args, const u32 index) {
+    return index < args->count ? args->slots[args->regs[index]] : 0;
+}
+
+static IRType get_native_arg_type(const VMNativeArgs* args, const u32 index) {
+    return index < args->count ? (IRType)args->types[args->regs[index]] : IR_TYPE_INT;
+}
+
+static const char* get_native_arg_string(const VMNativeArgs* args, const u32 index) {
+    if (get_native_arg_type(args, index) != IR_TYPE_STRING) {
+        return NULL;
+    }
+    return (const char*)(uintptr_t)get_native_arg(args, index);
+}
+
+// Values other than strings are printed as numbers.
+static i64 print_native_arg(VM* vm, const VMNativeArgs* args, const u32 index) {
+    const char* s = get_native_arg_string(args, index);
+    if (s != NULL) {
+        fputs(s, vm->out);
+        return (i64)str_len(s);
+    }
+
+    const IRType type = get_native_arg_type(args, index);
+    const i64 value = get_native_arg(args, index);
+    return is_ir_type_signed(type)
+        ? fprintf(vm->out, "%lld", value)
+        : fprintf(vm->out, "%llu", (unsigned long long)value);
+}
+
+// Every conversion is handed to fprintf with the width of the argument, the length modifiers of the format are ignored.
+// Unsigned conversions see the bits of the argument's own type, so '%u' of -1 as int is 4294967295 like in C.
+static i64 native_printf(VM* vm, const VMNativeArgs* args) {
+    const char* format = get_native_arg_string(args, 0);
+    if (format == NULL) {
+        return 0;
+    }
+
+    char spec[32] = { 0 };
+    u32 next = 1;
+    i64 written = 0;
+
+    for (const char* p = format; *p != '\0'; ++p) {
+        if (*p != '%') {
+            putc(*p, vm->out);
+            ++written;
+            continue;
+        }
+
+        const char* s = p + 1;
+        u32 len = 0;
+        spec[len++] = '%';
+
+        while (*s != '\0' && strchr("-+ #0", *s) != NULL && len < 8) { spec[len++] = *s++; }
+        while (is_digit(*s) && len < 16) { spec[len++] = *s++; }
+        if (*s == '.') {
+            spec[len++] = *s++;
+            while (is_digit(*s) && len < 24) { spec[len++] = *s++; }
+        }
+        while (*s == 'l' || *s == 'h' || *s == 'z') { ++s; }
+
+        if (*s == '\0') {
+            written += fprintf(vm->out, "%s", p);
+            break;
+        }
+
+        const char* start = p;
+        p = s;
+
+        const IRType type = get_native_arg_type(args, next);
+        const i64 value = get_native_arg(args, next);
+
+        switch (*s) {
+        case '%': {
+            putc('%', vm->out);
+            ++written;
+        } break;
+        case 'd':
+        case 'i': {
+            memcpy(spec + len, "lld", 4);
+            written += fprintf(vm->out, spec, (long long)value);
+            ++next;
+        } break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            memcpy(spec + len, "ll", 2);
+            spec[len + 2] = *s;
+            spec[len + 3] = '\0';
+            written += fprintf(vm->out, spec, (unsigned long long)((u64)value & vm_type_masks[type]));
+            ++next;
+        } break;
+        case 'c': {
+            memcpy(spec + len, "c", 2);
+            written += fprintf(vm->out, spec, (int)(value & 0xFF));
+            ++next;
+        } break;
+        case 's': {
+            const char* str = get_native_arg_string(args, next);
+            if (str != NULL) {
+                memcpy(spec + len, "s", 2);
+                written += fprintf(vm->out, spec, str);
+            }
+            else {
+                written += print_native_arg(vm, args, next);
+            }
+            ++next;
+        } break;
+        default: {
+            // An unknown conversion is printed as it is.
+            written += fprintf(vm->out, "%.*s", (int)(s - start + 1), start);
+        } break;
+        };
+    }
+
+    return written;
+}
+
+static i64 native_print(VM* vm, const VMNativeArgs* args) {
+    i64 written = 0;
+    for (u32 i = 0; i < args->count; ++i) {
+        written += print_native_arg(vm, args, i);
+    }
+    return written;
+}
+
+static i64 native_println(VM* vm, const VMNativeArgs* args) {
+    const i64 written = native_print(vm, args);
+    putc('\n', vm->out);
+    return written + 1;
+}
+
+static const VMNative vm_natives[BC_NATIVES_COUNT] = {
+    [BC_NATIVE_PRINTF] = &native_printf,
+    [BC_NATIVE_PRINT] = &native_print,
+    [BC_NATIVE_PRINTLN] = &native_println,
+};
+
+i64 vm_call_native(VM* vm, const BCFunction* func, const BCInstr* instr, const i64* base) {
+    const BCCall* call = vector_get_ref(&func->calls, BC_INSTR_INDEX(instr));
+    const VMNativeArgs native_args = {
+        .slots = base,
+        .types = (const u8*)func->reg_types.items,
+        .regs = (const u16*)func->call_args.items + call->first,
+        .count = call->count,
+    };
+
+    return vm_natives[call->callee](vm, &native_args);
+}
+
+#pragma endregion
+
+#pragma region PROFILE
+
+#define VM_PAIR_INDEX(first, second) ((u64)(first) * BC_OPCODES_COUNT + (second))
+#define VM_TRIPLE_INDEX(first, second, third) (VM_PAIR_INDEX(first, second) * BC_OPCODES_COUNT + (third))
+
+VMProfile vm_profile_create(void) {
+    VMProfile profile = {
+        .counts = { 0 },
+        .pairs = calloc(BC_OPCODES_COUNT * BC_OPCODES_COUNT, sizeof(u64)),
+        .triples = calloc(BC_OPCODES_COUNT * BC_OPCODES_COUNT * BC_OPCODES_COUNT, sizeof(u64)),
+        .last = { 0 },
+        .trace_length = 0,
+    };
+    assert(profile.pairs != NULL && profile.triples != NULL);
+
+    return profile;
+}
+
+void vm_profile_free(VMProfile* profile) {
+    if (profile == NULL) {
+        return;
+    }
+
+    free(profile->pairs);
+    free(profile->triples);
+
+    profile->pairs = NULL;
+    profile->triples = NULL;
+}
+
+static void vm_profile_record(VMProfile* profile, const u8 op) {
+    ++profile->counts[op];
+
+    if (profile->trace_length >= 1) {
+        ++profile->pairs[VM_PAIR_INDEX(profile->last[0], op)];
+    }
+    if (profile->trace_length >= 2) {
+        ++profile->triples[VM_TRIPLE_INDEX(profile->last[1], profile->last[0], op)];
+    }
+
+    profile->last[1] = profile->last[0];
+    profile->last[0] = op;
+    profile->trace_length += profile->trace_length < 2;
+}
+
+typedef struct {
+    u64 count;
+    u32 index;
+} VMProfileEntry;
+
+// Keeps the top entries sorted by count, ties keep the first one seen.
+static void vm_profile_insert_entry(VMProfileEntry* top, const u32 top_count, const u64 count, const u32 index) {
+    if (count == 0 || count <= top[top_count - 1].count) {
+        return;
+    }
+
+    u32 i = top_count - 1;
+    while (i > 0 && top[i - 1].count < count) {
+        top[i] = top[i - 1];
+        --i;
+    }
+    top[i] = (VMProfileEntry) { .count = count, .index = index };
+}
+
+static void print_vm_profile_table(FILE* handle, const char* title, const u64* counts, const u32 counts_size,
+                                   const u32 length, const u32 top_count, const u64 total) {
+    VMProfileEntry* top = calloc(top_count, sizeof(VMProfileEntry));
+    assert(top != NULL);
+
+    for (u32 i = 0; i < counts_size; ++i) {
+        vm_profile_insert_entry(top, top_count, counts[i], i);
+    }
+
+    fprintf(handle, "%s:\n", title);
+    for (u32 i = 0; i < top_count && top[i].count != 0; ++i) {
+        fprintf(handle, "  %12llu %6.2f%%  ", top[i].count, total != 0 ? 100.0 * (double)top[i].count / (double)total : 0.0);
+
+        // The index is the opcodes as digits of base BC_OPCODES_COUNT, the first one is the most significant.
+        u32 divisor = 1;
+        for (u32 j = 1; j < length; ++j) {
+            divisor *= BC_OPCODES_COUNT;
+        }
+        for (u32 j = 0; j < length; ++j) {
+            fprintf(handle, j == 0 ? "%s" : " + %s", get_bc_opcode_name((BCOpcode)(top[i].index / divisor % BC_OPCODES_COUNT)));
+            divisor /= BC_OPCODES_COUNT;
+        }
+        putc('\n', handle);
+    }
+
+    free(top);
+}
+
+void print_vm_profile(FILE* handle, const VMProfile* profile, const u32 top_count) {
+    assert(handle != NULL && profile != NULL && top_count > 0);
+
+    u64 total = 0;
+    for (u32 i = 0; i < BC_OPCODES_COUNT; ++i) {
+        total += profile->counts[i];
+    }
+
+    fprintf(handle, "%llu dispatches.\n", total);
+    print_vm_profile_table(handle, "Opcodes", profile->counts, BC_OPCODES_COUNT, 1, top_count, total);
+    print_vm_profile_table(handle, "Pairs", profile->pairs, BC_OPCODES_COUNT * BC_OPCODES_COUNT, 2, top_count, total);
+    print_vm_profile_table(handle, "Triples", profile->triples, BC_OPCODES_COUNT * BC_OPCODES_COUNT * BC_OPCODES_COUNT, 3, top_count, total);
+}
+
+#undef VM_PAIR_INDEX
+#undef VM_TRIPLE_INDEX
+
+#pragma endregion
+
+#pragma region INTERPRETER
+
+// Converts the arguments and zeroes the rest of the frame, the locals start at zero like after 'dim'.
+static void vm_enter_frame(i64* base, const BCFunction* func, const i64* values, const u16* regs, const u32 count) {
+    const u8* types = (const u8*)func->reg_types.items;
+    const u32 params_count = count < func->params_count ? count : func->params_count;
+
+    for (u32 i = 0; i < params_count; ++i) {
+        base[i] = vm_normalize(types[i], regs != NULL ? values[regs[i]] : values[i]);
+    }
+    memset(base + params_count, 0, (func->frame_size - params_count) * sizeof(i64));
+}
+
+// The semantics of the opcodes, shared by their own handlers, the superinstructions and the quickened variants.
+// They expand inside vm_call, 'I' is the instruction and 'T' the type it computes in. The type is a constant
+// for the quickened variants, so their normalization folds into a single extension or into nothing.
+#define VM_BODY_NOP(I, T)
+#define VM_BODY_CONST(I, T) R[(I)->a] = BC_INSTR_IMM(I)
+#define VM_BODY_CONST_WIDE(I, T) R[(I)->a] = constants[BC_INSTR_INDEX(I)]
+#define VM_BODY_STR(I, T) R[(I)->a] = (i64)(uintptr_t)strings[BC_INSTR_INDEX(I)]
+#define VM_BODY_COPY(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b])
+
+#define VM_BODY_NEG(I, T) R[(I)->a] = vm_normalize((T), (i64)(0 - (u64)R[(I)->b]))
+#define VM_BODY_NOT(I, T) R[(I)->a] = vm_normalize((T), ~R[(I)->b])
+#define VM_BODY_LNOT(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] == 0)
+
+// Wrapping arithmetic is done on unsigned values, where it is well defined.
+#define VM_BODY_ADD(I, T) R[(I)->a] = vm_normalize((T), (i64)((u64)R[(I)->b] + (u64)R[(I)->c]))
+#define VM_BODY_SUB(I, T) R[(I)->a] = vm_normalize((T), (i64)((u64)R[(I)->b] - (u64)R[(I)->c]))
+#define VM_BODY_MUL(I, T) R[(I)->a] = vm_normalize((T), (i64)((u64)R[(I)->b] * (u64)R[(I)->c]))
+#define VM_BODY_MULH(I, T) R[(I)->a] = multiply_high_ir_value((IRType)(T), R[(I)->b], R[(I)->c])
+
+#define VM_BODY_DIVISION(I, T, OP)                                                  \
+    do {                                                                            \
+        const i64 lhs = vm_normalize((T), R[(I)->b]);                               \
+        const i64 rhs = vm_normalize((T), R[(I)->c]);                               \
+        const u64 sign = vm_type_signs[(T)];                                        \
+                                                                                    \
+        if (rhs == 0) {                                                             \
+            VM_FAIL(VM_STATUS_DIVISION_BY_ZERO);                                    \
+        }                                                                           \
+        if (sign != 0 && lhs == (i64)(0 - sign) && rhs == -1) {                     \
+            VM_FAIL(VM_STATUS_DIVISION_OVERFLOW);                                   \
+        }                                                                           \
+                                                                                    \
+        R[(I)->a] = sign != 0 ? lhs OP rhs : (i64)((u64)lhs OP (u64)rhs);           \
+    } while (false)
+
+#define VM_BODY_DIV(I, T) VM_BODY_DIVISION(I, T, /)
+#define VM_BODY_REM(I, T) VM_BODY_DIVISION(I, T, %)
+#define VM_BODY_AND(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] & R[(I)->c])
+#define VM_BODY_OR(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] | R[(I)->c])
+#define VM_BODY_XOR(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] ^ R[(I)->c])
+
+// The amount keeps the value of its own register, only its low bits are taken, like on the hardware.
+#define VM_BODY_SHL(I, T) R[(I)->a] = vm_normalize((T), (i64)((u64)R[(I)->b] << (R[(I)->c] & 63)))
+#define VM_BODY_SHR(I, T)                                                           \
+    do {                                                                            \
+        const i64 lhs = vm_normalize((T), R[(I)->b]);                               \
+        const u32 amount = (u32)(R[(I)->c] & 63);                                   \
+                                                                                    \
+        if (vm_type_signs[(T)] != 0 && lhs < 0) {                                   \
+            R[(I)->a] = ~(i64)(~(u64)lhs >> amount);                                \
+        }                                                                           \
+        else {                                                                      \
+            R[(I)->a] = (i64)((u64)lhs >> amount);                                  \
+        }                                                                           \
+    } while (false)
+
+#define VM_BODY_LAND(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] != 0 && R[(I)->c] != 0)
+#define VM_BODY_LOR(I, T) R[(I)->a] = vm_normalize((T), R[(I)->b] != 0 || R[(I)->c] != 0)
+
+// Compares are typed by their operands, unsigned ones compare the bits.
+#define VM_BODY_COMPARE(I, T, OP)                                                   \
+    do {                                                                            \
+        const i64 lhs = vm_normalize((T), R[(I)->b]);                               \
+        const i64 rhs = vm_normalize((T), R[(I)->c]);                               \
+        R[(I)->a] = vm_type_signs[(T)] != 0                                         \
+            ? lhs OP rhs                                                            \
+            : (u64)lhs OP (u64)rhs;                                                 \
+    } while (false)
+
+#define VM_BODY_EQ(I, T) VM_BODY_COMPARE(I, T, ==)
+#define VM_BODY_NE(I, T) VM_BODY_COMPARE(I, T, !=)
+#define VM_BODY_LT(I, T) VM_BODY_COMPARE(I, T, <)
+#define VM_BODY_LE(I, T) VM_BODY_COMPARE(I, T, <=)
+#define VM_BODY_GT(I, T) VM_BODY_COMPARE(I, T, >)
+#define VM_BODY_GE(I, T) VM_BODY_COMPARE(I, T, >=)
+
+#define VM_BODY_JMP(I, T) pc = code + BC_INSTR_INDEX(I)
+#define VM_BODY_BR_TRUE(I, T) if (R[(I)->a] != 0) { pc = code + BC_INSTR_INDEX(I); }
+#define VM_BODY_BR_FALSE(I, T) if (R[(I)->a] == 0) { pc = code + BC_INSTR_INDEX(I); }
+
+VMStatus vm_run_frame(VM* vm, const u32 func_index, i64* base, const u32 first_depth, i64* result) {
+    assert(vm != NULL && vm->module->is_linked);
+    assert(base != NULL);
+
+    const BCModule* module = vm->module;
+    const BCFunction* functions = (const BCFunction*)module->functions.items;
+    const char* const* strings = (const char* const*)module->strings.items;
+    const i64* stack_end = vm->stack + vm->stack_size;
+
+    assert(func_index < module->functions.items_count);
+
+    const BCFunction* func = &functions[func_index];
+    const BCInstr* code = NULL;
+    const i64* constants = NULL;
+    const BCCall* calls = NULL;
+    const u16* call_args = NULL;
+
+#define VM_LOAD_FUNCTION(f)                             \
+    do {                                                \
+        func = (f);                                     \
+        code = (const BCInstr*)func->code.items;        \
+        constants = (const i64*)func->constants.items;  \
+        calls = (const BCCall*)func->calls.items;       \
+        call_args = (const u16*)func->call_args.items;  \
+    } while (false)
+
+    VM_LOAD_FUNCTION(func);
+
+    VMStatus status = VM_STATUS_OK;
+    i64* R = base;
+    u32 depth = first_depth;
+    u64 executed = 0;
+    i64 value = 0;
+
+    const BCInstr* pc = code;
+    const BCInstr* instr = NULL;
+
+#define VM_FAIL(s)      \
+    do {                \
+        status = (s);   \
+        goto vm_exit;   \
+    } while (false)
+
+    VMProfile* profile = vm->profile;
+
+#ifdef VM_THREADED_DISPATCH
+    static const void* handlers_table[BC_OPCODES_COUNT] = {
+#define BC_OPCODE(ID, NAME) &&vm_op_##ID,
+#include "vanec/backend/bytecode.def"
+    };
+
+    // While profiling every opcode goes through the recorder first, so the plain dispatch pays nothing for it.
+    static const void* profile_table[BC_OPCODES_COUNT] = {
+#define BC_OPCODE(ID, NAME) &&vm_profile,
+#include "vanec/backend/bytecode.def"
+    };
+
+    const void* const* dispatch_table = profile != NULL ? profile_table : handlers_table;
+
+#define VM_CASE(ID) vm_op_##ID:
+#define VM_NEXT()                               \
+    do {                                        \
+        instr = pc++;                           \
+        ++executed;                             \
+        goto *dispatch_table[instr->op];        \
+    } while (false)
+
+    VM_NEXT();
+
+vm_profile:
+    vm_profile_record(profile, instr->op);
+    goto *handlers_table[instr->op];
+#else
+#define VM_CASE(ID) case BC_OP_##ID:
+#define VM_NEXT() continue
+
+    for (;;) {
+        instr = pc++;
+        ++executed;
+
+        if (profile != NULL) {
+            vm_profile_record(profile, instr->op);
+        }
+
+        switch (instr->op) {
+#endif
+
+#define VM_SIMPLE_CASE(ID)                      \
+    VM_CASE(ID) {                               \
+        VM_BODY_##ID(instr, instr->type);       \
+        VM_NEXT();                              \
+    }
+
+    VM_SIMPLE_CASE(NOP)
+    VM_SIMPLE_CASE(CONST)
+    VM_SIMPLE_CASE(CONST_WIDE)
+    VM_SIMPLE_CASE(STR)
+    VM_SIMPLE_CASE(COPY)
+
+    VM_SIMPLE_CASE(NEG)
+    VM_SIMPLE_CASE(NOT)
+    VM_SIMPLE_CASE(LNOT)
+
+    VM_SIMPLE_CASE(ADD)
+    VM_SIMPLE_CASE(SUB)
+    VM_SIMPLE_CASE(MUL)
+    VM_SIMPLE_CASE(MULH)
+    VM_SIMPLE_CASE(DIV)
+    VM_SIMPLE_CASE(REM)
+    VM_SIMPLE_CASE(AND)
+    VM_SIMPLE_CASE(OR)
+    VM_SIMPLE_CASE(XOR)
+    VM_SIMPLE_CASE(SHL)
+    VM_SIMPLE_CASE(SHR)
+    VM_SIMPLE_CASE(LAND)
+    VM_SIMPLE_CASE(LOR)
+
+    VM_SIMPLE_CASE(EQ)
+    VM_SIMPLE_CASE(NE)
+    VM_SIMPLE_CASE(LT)
+    VM_SIMPLE_CASE(LE)
+    VM_SIMPLE_CASE(GT)
+    VM_SIMPLE_CASE(GE)
+
+    VM_CASE(LOAD_ELEM) {
+        const VMArray* array = (const VMArray*)(uintptr_t)R[instr->b];
+        const u64 index = (u64)R[instr->c];
+
+        if (array == NULL || index >= array->count) {
+            VM_FAIL(VM_STATUS_INDEX_OUT_OF_RANGE);
+        }
+
+        R[instr->a] = vm_normalize(instr->type, array->items[index]);
+        VM_NEXT();
+    }
+    VM_CASE(STORE_ELEM) {
+        const VMArray* array = (const VMArray*)(uintptr_t)R[instr->a];
+        const u64 index = (u64)R[instr->b];
+
+        if (array == NULL || index >= array->count) {
+            VM_FAIL(VM_STATUS_INDEX_OUT_OF_RANGE);
+        }
+
+        array->items[index] = vm_normalize(instr->type, R[instr->c]);
+        VM_NEXT();
+    }
+    VM_CASE(CALL) {
+        const BCCall* call = &calls[BC_INSTR_INDEX(instr)];
+        const BCFunction* callee = &functions[call->callee];
+        i64* callee_base = R + func->frame_size;
+
+        if (depth >= vm->max_frames || callee_base + callee->frame_size > stack_end) {
+            VM_FAIL(VM_STATUS_STACK_OVERFLOW);
+        }
+
+        vm_enter_frame(callee_base, callee, R, call_args + call->first, call->count);
+
+        // A callee with native code runs there, it gets back here through the interpreter bridge when it calls
+        // a function still interpreted.
+        if (vm->jit != NULL && jit_tier_up(vm->jit, call->callee)) {
+            status = jit_run(vm->jit, vm, call->callee, callee_base, depth + 1, &value);
+            if (status != VM_STATUS_OK) {
+                func = vm->fault_function;
+                VM_FAIL(status);
+            }
+
+            if (instr->a != BC_NULL_REG) {
+                R[instr->a] = vm_normalize(instr->type, value);
+            }
+            VM_NEXT();
+        }
+
+        VMFrame* frame = &vm->frames[depth++];
+        frame->func = func;
+        frame->ret_pc = pc;
+        frame->base = R;
+        frame->dst = instr->a;
+        frame->type = instr->type;
+
+        VM_LOAD_FUNCTION(callee);
+        R = callee_base;
+        pc = code;
+        VM_NEXT();
+    }
+    VM_CASE(CALL_NATIVE) {
+        value = vm_call_native(vm, func, instr, R);
+        if (instr->a != BC_NULL_REG) {
+            R[instr->a] = vm_normalize(instr->type, value);
+        }
+        VM_NEXT();
+    }
+
+    VM_SIMPLE_CASE(JMP)
+    VM_SIMPLE_CASE(BR_TRUE)
+    VM_SIMPLE_CASE(BR_FALSE)
+
+#undef VM_SIMPLE_CASE
+
+    // A superinstruction runs the bodies of its sequence in order and steps over the rest of it,
+    // a jump at its end then goes from there like the one in the sequence would.
+#define BC_OPCODE(ID, NAME)
+#define BC_FUSED_PAIR(ID, NAME, FIRST, SECOND)          \
+    VM_CASE(ID) {                                       \
+        const BCInstr* second = pc++;                   \
+        VM_BODY_##FIRST(instr, instr->type);            \
+        VM_BODY_##SECOND(second, second->type);         \
+        VM_NEXT();                                      \
+    }
+#define BC_FUSED_TRIPLE(ID, NAME, FIRST, SECOND, THIRD) \
+    VM_CASE(ID) {                                       \
+        const BCInstr* second = pc++;                   \
+        const BCInstr* third = pc++;                    \
+        VM_BODY_##FIRST(instr, instr->type);            \
+        VM_BODY_##SECOND(second, second->type);         \
+        VM_BODY_##THIRD(third, third->type);            \
+        VM_NEXT();                                      \
+    }
+#define BC_QUICK_OPCODE(ID, NAME, BASE, TYPE)           \
+    VM_CASE(ID) {                                       \
+        VM_BODY_##BASE(instr, IR_TYPE_##TYPE);          \
+        VM_NEXT();                                      \
+    }
+#include "vanec/backend/bytecode.def"
+
+    VM_CASE(RET) {
+        value = instr->a != BC_NULL_REG ? R[instr->a] : 0;
+        if (depth == first_depth) {
+            goto vm_exit;
+        }
+
+        const VMFrame* frame = &vm->frames[--depth];
+        VM_LOAD_FUNCTION(frame->func);
+        R = frame->base;
+        pc = frame->ret_pc;
+
+        if (frame->dst != BC_NULL_REG) {
+            R[frame->dst] = vm_normalize(frame->type, value);
+        }
+        VM_NEXT();
+    }
+
+#ifndef VM_THREADED_DISPATCH
+        default: {
+            assert(false && "Unreachable");
+        } break;
+        };
+    }
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_FAIL
+#undef VM_LOAD_FUNCTION
+
+vm_exit:
+    vm->executed_count += executed;
+    vm->status = status;
+    vm->fault_function = status != VM_STATUS_OK ? func : NULL;
+
+    if (status == VM_STATUS_OK && result != NULL) {
+        *result = value;
+    }
+    return status;
+}
+
+VMStatus vm_call(VM* vm, const u32 func_index, const i64* args, const u32 count, i64* result) {
+    assert(vm != NULL && vm->module->is_linked);
+    assert(args != NULL || count == 0);
+    assert(func_index < vm->module->functions.items_count);
+
+    const BCFunction* func = bc_module_get_function(vm->module, func_index);
+    if (func->frame_size > vm->stack_size) {
+        vm->status = VM_STATUS_STACK_OVERFLOW;
+        vm->fault_function = func;
+        return vm->status;
+    }
+    vm_enter_frame(vm->stack, func, args, NULL, count);
+
+    if (vm->jit != NULL && jit_tier_up(vm->jit, func_index)) {
+        i64 value = 0;
+        vm->status = jit_run(vm->jit, vm, func_index, vm->stack, 0, &value);
+
+        if (vm->status == VM_STATUS_OK && result != NULL) {
+            *result = value;
+        }
+        return vm->status;
+    }
+    return vm_run_frame(vm, func_index, vm->stack, 0, result);
+}
+
+#pragma endregion
\ No newline at end of file
@@ -0,0 +1,1366 @@
+#include "vanec/backend/x64_compiler.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vanec/utils/string_utils.h"
+
+#include "vanec/backend/bytecode.h"
+#include "vanec/backend/linear_scan.h"
+#include "vanec/backend/graph_coloring.h"
+#include "vanec/backend/vm.h"
+
+#define X64_ARG_REGS_COUNT 6
+#define X64_ALLOC_REGS_COUNT 11
+#define X64_LINE_CAPACITY 256
+
+typedef enum {
+    X64_RAX = 0,
+    X64_RCX,
+    X64_RDX,
+    X64_RBX,
+    X64_RSP,
+    X64_RBP,
+    X64_RSI,
+    X64_RDI,
+    X64_R8,
+    X64_R9,
+    X64_R10,
+    X64_R11,
+    X64_R12,
+    X64_R13,
+    X64_R14,
+    X64_R15,
+    X64_REGS_COUNT,
+} X64Reg;
+
+typedef enum {
+    X64_WIDTH_64 = 0,
+    X64_WIDTH_32,
+    X64_WIDTH_16,
+    X64_WIDTH_8,
+} X64Width;
+
+static const char* x64_reg_names[X64_REGS_COUNT][4] = {
+    { "rax", "eax", "ax", "al" },
+    { "rcx", "ecx", "cx", "cl" },
+    { "rdx", "edx", "dx", "dl" },
+    { "rbx", "ebx", "bx", "bl" },
+    { "rsp", "esp", "sp", "spl" },
+    { "rbp", "ebp", "bp", "bpl" },
+    { "rsi", "esi", "si", "sil" },
+    { "rdi", "edi", "di", "dil" },
+    { "r8", "r8d", "r8w", "r8b" },
+    { "r9", "r9d", "r9w", "r9b" },
+    { "r10", "r10d", "r10w", "r10b" },
+    { "r11", "r11d", "r11w", "r11b" },
+    { "r12", "r12d", "r12w", "r12b" },
+    { "r13", "r13d", "r13w", "r13b" },
+    { "r14", "r14d", "r14w", "r14b" },
+    { "r15", "r15d", "r15w", "r15b" },
+};
+
+static const X64Reg x64_arg_regs[X64_ARG_REGS_COUNT] = { X64_RDI, X64_RSI, X64_RDX, X64_RCX, X64_R8, X64_R9 };
+
+// The registers the allocator hands out, the six caller-saved ones first. rax, rcx and rdx stay free
+// as the scratch registers of the instructions, the divisions and the shifts need them anyway.
+static const X64Reg x64_alloc_regs[X64_ALLOC_REGS_COUNT] = {
+    X64_R10, X64_R11, X64_RSI, X64_RDI, X64_R8, X64_R9,
+    X64_RBX, X64_R12, X64_R13, X64_R14, X64_R15,
+};
+
+static const RegAllocTarget x64_alloc_target = { .regs_count = X64_ALLOC_REGS_COUNT, .caller_saved = 0x3F };
+
+static const char* get_x64_reg_name(const X64Reg reg, const X64Width width) {
+    return x64_reg_names[reg][width];
+}
+
+#pragma region MODULE
+
+static void free_x64_declaration(void* item) {
+    str_free(((X64Declaration*)item)->name);
+}
+
+X64Module x64_module_create(DiagnosticEngine* diag) {
+    return (X64Module) {
+        .text = string_builder_create(),
+        .strings = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char*), &str_free, true),
+        .declarations = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(X64Declaration), &free_x64_declaration, false),
+        .functions_count = 0,
+        .intervals = live_intervals_create(),
+        .allocation = reg_allocation_create(),
+        .diag = diag,
+    };
+}
+
+void x64_module_free(X64Module* module) {
+    if (module == NULL) {
+        return;
+    }
+
+    string_builder_free(&module->text);
+    vector_free(&module->strings);
+    vector_free(&module->declarations);
+    live_intervals_free(&module->intervals);
+    reg_allocation_free(&module->allocation);
+}
+
+void x64_module_declare_function(X64Module* module, const char* name, const u32 params_count) {
+    assert(module != NULL && name != NULL);
+
+    const X64Declaration declaration = { .name = str_dup(name), .params_count = params_count };
+    vector_push_back(&module->declarations, &declaration);
+}
+
+const X64Declaration* x64_module_find_declaration(const X64Module* module, const char* name) {
+    assert(module != NULL && name != NULL);
+
+    for (u64 i = 0; i < module->declarations.items_count; ++i) {
+        const X64Declaration* declaration = vector_get_ref(&module->declarations, i);
+        if (str_eq(declaration->name, name)) {
+            return declaration;
+        }
+    }
+    return NULL;
+}
+
+// Equal literals share their label.
+static u32 x64_module_add_string(X64Module* module, const char* s) {
+    for (u64 i = 0; i < module->strings.items_count; ++i) {
+        if (str_eq(vector_get_ref(&module->strings, i), s)) {
+            return (u32)i;
+        }
+    }
+
+    char* copy = str_dup(s);
+    vector_push_back(&module->strings, &copy);
+
+    return (u32)(module->strings.items_count - 1);
+}
+
+#pragma endregion
+
+#pragma region EMITTER
+
+// A register of the machine or a slot of the frame.
+typedef struct {
+    X64Reg reg;         // X64_RBP for a slot
+    i64 offset;         // of the slot from rbp
+} X64Location;
+
+// One of the copies that happen at once on an edge, at a split or on the entry.
+typedef struct {
+    X64Location dst;
+    X64Location src;
+    IRType type;        // the value is normalized to it, IR_TYPE_VOID copies the bits
+} X64Move;
+
+typedef enum {
+    X64_ARG_VALUE,      // the value of a register
+    X64_ARG_MASKED,     // the bits of a register in its own type, zero extended
+    X64_ARG_LOW_BYTE,   // the low byte of a register
+    X64_ARG_ZERO,
+    X64_ARG_STRING,     // the address of a literal of the module
+} X64ArgKind;
+
+typedef struct {
+    X64ArgKind kind;
+    u32 value;          // the register or the literal
+} X64Arg;
+
+typedef struct {
+    X64Module* module;
+    const CFGContext* ctx;
+    const IRFunction* ir;
+    const char* name;
+    SourceLoc loc;
+
+    u32 index;          // of the function in the module, its labels start with it
+    u32 labels_count;   // the local labels past the ones of the blocks
+    u32 instr;          // the laid out index of the instruction being compiled, its positions in the intervals
+    u32 saved_count;    // the callee-saved registers the function uses, their slots come first in the frame
+    u32* literals;      // per register, the literal it holds for its whole life or IR_NULL_STRING
+    u32 traps;          // a bit per VMStatus the function traps with
+
+    Vector moves;       // X64Move, the pending copies
+    Vector split_moves; // RegAllocMove, by position
+    u32 next_split_move;
+    Vector args;        // X64Arg, the arguments of one call
+    bool is_valid;
+} X64Compiler;
+
+// A memory or register operand in the syntax of GNU as.
+typedef struct {
+    char text[32];
+} X64Operand;
+
+// Emits one indented instruction.
+static void emit(X64Compiler* compiler, const char* format, ...) {
+    char line[X64_LINE_CAPACITY];
+
+    va_list args;
+    va_start(args, format);
+    const int count = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    assert(count >= 0 && count < (int)sizeof(line));
+    (void)count;
+
+    string_builder_append_char_right(&compiler->module->text, '\t');
+    string_builder_append_str_right(&compiler->module->text, line);
+    string_builder_append_char_right(&compiler->module->text, '\n');
+}
+
+static void emit_block_label(X64Compiler* compiler, const u32 block) {
+    string_builder_append_format(&compiler->module->text, ".L%llu_%llu:\n", (unsigned long long)compiler->index, (unsigned long long)block);
+}
+
+static u32 create_local_label(X64Compiler* compiler) {
+    return compiler->labels_count++;
+}
+
+static void emit_local_label(X64Compiler* compiler, const u32 label) {
+    string_builder_append_format(&compiler->module->text, ".L%llu_x%llu:\n", (unsigned long long)compiler->index, (unsigned long long)label);
+}
+
+static void emit_jump_to_block(X64Compiler* compiler, const char* jump, const u32 block) {
+    emit(compiler, "%s .L%llu_%llu", jump, (unsigned long long)compiler->index, (unsigned long long)block);
+}
+
+static void emit_jump_to_local(X64Compiler* compiler, const char* jump, const u32 label) {
+    emit(compiler, "%s .L%llu_x%llu", jump, (unsigned long long)compiler->index, (unsigned long long)label);
+}
+
+static void emit_jump_to_trap(X64Compiler* compiler, const char* jump, const VMStatus status) {
+    compiler->traps |= 1u << status;
+    emit(compiler, "%s .L%llu_trap%llu", jump, (unsigned long long)compiler->index, (unsigned long long)status);
+}
+
+static bool is_same_x64_location(const X64Location lhs, const X64Location rhs) {
+    return lhs.reg == rhs.reg && (lhs.reg != X64_RBP || lhs.offset == rhs.offset);
+}
+
+static X64Location get_frame_location(const i64 offset) {
+    return (X64Location) { .reg = X64_RBP, .offset = offset };
+}
+
+// The frame holds the saved callee-saved registers, then the scratch slot and the spill slots.
+static X64Location get_scratch_location(const X64Compiler* compiler) {
+    return get_frame_location(-8 * ((i64)compiler->saved_count + 1));
+}
+
+static X64Location get_spill_location(const X64Compiler* compiler, const u32 slot) {
+    return get_frame_location(-8 * ((i64)compiler->saved_count + 2 + slot));
+}
+
+static u32 get_frame_size(const X64Compiler* compiler) {
+    const u32 size = (compiler->saved_count + 1 + compiler->module->allocation.slots_count) * 8;
+    return (size + 15) & ~(u32)15;
+}
+
+static X64Location get_alloc_location(const X64Compiler* compiler, const RegAllocLocation location) {
+    if (location.kind == REG_ALLOC_SLOT) {
+        return get_spill_location(compiler, location.index);
+    }
+    return (X64Location) { .reg = x64_alloc_regs[location.index], .offset = 0 };
+}
+
+static X64Location get_location(const X64Compiler* compiler, const u32 reg, const u32 position) {
+    return get_alloc_location(compiler, reg_allocation_get_location(&compiler->module->allocation, reg, position));
+}
+
+static X64Operand get_location_operand(const X64Location location) {
+    X64Operand operand = { 0 };
+    if (location.reg == X64_RBP) {
+        snprintf(operand.text, sizeof(operand.text), "%lld(%%rbp)", (long long)location.offset);
+    }
+    else {
+        snprintf(operand.text, sizeof(operand.text), "%%%s", get_x64_reg_name(location.reg, X64_WIDTH_64));
+    }
+    return operand;
+}
+
+// Where the current instruction reads a register.
+static X64Operand get_use_operand(const X64Compiler* compiler, const u32 reg) {
+    return get_location_operand(get_location(compiler, reg, get_live_use_position(compiler->instr)));
+}
+
+// Where the current instruction writes a register.
+static X64Operand get_def_operand(const X64Compiler* compiler, const u32 reg) {
+    return get_location_operand(get_location(compiler, reg, get_live_def_position(compiler->instr)));
+}
+
+static IRType get_reg_type(const X64Compiler* compiler, const u32 reg) {
+    return ir_function_get_reg(compiler->ir, reg)->type;
+}
+
+static void emit_load(X64Compiler* compiler, const X64Reg dst, const u32 reg) {
+    emit(compiler, "movq %s, %%%s", get_use_operand(compiler, reg).text, get_x64_reg_name(dst, X64_WIDTH_64));
+}
+
+static void emit_store(X64Compiler* compiler, const u32 reg, const X64Reg src) {
+    emit(compiler, "movq %%%s, %s", get_x64_reg_name(src, X64_WIDTH_64), get_def_operand(compiler, reg).text);
+}
+
+static void emit_mov_imm(X64Compiler* compiler, const X64Reg dst, const i64 value) {
+    const char* name = get_x64_reg_name(dst, X64_WIDTH_64);
+
+    if (value == 0) {
+        emit(compiler, "xorl %%%s, %%%s", get_x64_reg_name(dst, X64_WIDTH_32), get_x64_reg_name(dst, X64_WIDTH_32));
+    }
+    else if (value >= -(i64)0x80000000 && value <= (i64)0x7FFFFFFF) {
+        emit(compiler, "movq $%lld, %%%s", (long long)value, name);
+    }
+    else {
+        emit(compiler, "movabsq $%lld, %%%s", (long long)value, name);
+    }
+}
+
+// The same normalization as the interpreter's, a single extension or nothing.
+static void emit_normalize(X64Compiler* compiler, const X64Reg reg, const IRType type) {
+    const char* q = get_x64_reg_name(reg, X64_WIDTH_64);
+    const char* d = get_x64_reg_name(reg, X64_WIDTH_32);
+    const char* w = get_x64_reg_name(reg, X64_WIDTH_16);
+    const char* b = get_x64_reg_name(reg, X64_WIDTH_8);
+
+    if (type == IR_TYPE_BOOL) {
+        emit(compiler, "testq %%%s, %%%s", q, q);
+        emit(compiler, "setne %%%s", b);
+        emit(compiler, "movzbl %%%s, %%%s", b, d);
+        return;
+    }
+
+    const bool is_signed = is_ir_type_signed(type);
+    switch (get_ir_type_size(type)) {
+    case 1: {
+        if (is_signed) {
+            emit(compiler, "movsbq %%%s, %%%s", b, q);
+        }
+        else {
+            emit(compiler, "movzbl %%%s, %%%s", b, d);
+        }
+    } break;
+    case 2: {
+        if (is_signed) {
+            emit(compiler, "movswq %%%s, %%%s", w, q);
+        }
+        else {
+            emit(compiler, "movzwl %%%s, %%%s", w, d);
+        }
+    } break;
+    case 4: {
+        if (is_signed) {
+            emit(compiler, "movslq %%%s, %%%s", d, q);
+        }
+        else {
+            emit(compiler, "movl %%%s, %%%s", d, d);
+        }
+    } break;
+    default: break;
+    };
+}
+
+static void emit_load_normalized(X64Compiler* compiler, const X64Reg dst, const u32 reg, const IRType type) {
+    emit_load(compiler, dst, reg);
+    emit_normalize(compiler, dst, type);
+}
+
+static bool is_x64_normalizing(const IRType type) {
+    return type == IR_TYPE_BOOL || (get_ir_type_size(type) != 0 && get_ir_type_size(type) < 8);
+}
+
+// Memory to memory goes through rax.
+static void emit_move(X64Compiler* compiler, const X64Move* move) {
+    const bool is_normalizing = is_x64_normalizing(move->type);
+    const bool is_same = is_same_x64_location(move->dst, move->src);
+    if (is_same && !is_normalizing) {
+        return;
+    }
+
+    const X64Operand src = get_location_operand(move->src);
+    const X64Operand dst = get_location_operand(move->dst);
+
+    if (move->dst.reg != X64_RBP) {
+        if (!is_same) {
+            emit(compiler, "movq %s, %s", src.text, dst.text);
+        }
+        emit_normalize(compiler, move->dst.reg, move->type);
+    }
+    else if (move->src.reg != X64_RBP && !is_normalizing) {
+        emit(compiler, "movq %s, %s", src.text, dst.text);
+    }
+    else {
+        emit(compiler, "movq %s, %%rax", src.text);
+        emit_normalize(compiler, X64_RAX, move->type);
+        emit(compiler, "movq %%rax, %s", dst.text);
+    }
+}
+
+static void push_move(X64Compiler* compiler, const X64Location dst, const X64Location src, const IRType type) {
+    if (is_same_x64_location(dst, src) && !is_x64_normalizing(type)) {
+        return;
+    }
+
+    const X64Move move = { .dst = dst, .src = src, .type = type };
+    vector_push_back(&compiler->moves, &move);
+}
+
+// Whether another pending move still reads the destination of one.
+static bool is_move_source(const X64Move* moves, const u32 count, const u32 index) {
+    for (u32 i = 0; i < count; ++i) {
+        if (i != index && is_same_x64_location(moves[i].src, moves[index].dst)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The pending moves happen at once, so a move is only emitted when no other one still reads its destination.
+// When only cycles are left, the value of one destination is saved into the scratch slot and read from there.
+static void emit_pending_moves(X64Compiler* compiler) {
+    X64Move* moves = (X64Move*)compiler->moves.items;
+    u32 count = (u32)compiler->moves.items_count;
+
+    while (count > 0) {
+        bool is_progress = false;
+
+        for (u32 i = 0; i < count;) {
+            if (is_move_source(moves, count, i)) {
+                ++i;
+                continue;
+            }
+
+            emit_move(compiler, &moves[i]);
+            moves[i] = moves[--count];
+            is_progress = true;
+        }
+
+        if (!is_progress) {
+            const X64Move save = { .dst = get_scratch_location(compiler), .src = moves[0].dst, .type = IR_TYPE_VOID };
+            emit_move(compiler, &save);
+
+            for (u32 i = 0; i < count; ++i) {
+                if (is_same_x64_location(moves[i].src, save.src)) {
+                    moves[i].src = save.dst;
+                }
+            }
+        }
+    }
+
+    vector_clear(&compiler->moves);
+}
+
+// The moves of the intervals split before the current instruction.
+static void emit_split_moves(X64Compiler* compiler) {
+    const RegAllocMove* moves = (const RegAllocMove*)compiler->split_moves.items;
+    const u32 position = get_live_use_position(compiler->instr);
+
+    for (; compiler->next_split_move < compiler->split_moves.items_count; ++compiler->next_split_move) {
+        const RegAllocMove* move = &moves[compiler->next_split_move];
+        if (move->position != position) {
+            break;
+        }
+
+        push_move(compiler, get_alloc_location(compiler, move->to), get_alloc_location(compiler, move->from), IR_TYPE_VOID);
+    }
+    emit_pending_moves(compiler);
+}
+
+#pragma endregion
+
+#pragma region CALLS
+
+static void emit_arg(X64Compiler* compiler, const X64Reg dst, const X64Arg* arg) {
+    switch (arg->kind) {
+    case X64_ARG_VALUE: {
+        emit_load(compiler, dst, arg->value);
+    } break;
+    case X64_ARG_MASKED: {
+        const IRType type = get_reg_type(compiler, arg->value);
+        emit_load(compiler, dst, arg->value);
+        if (type == IR_TYPE_BOOL || !is_ir_type_signed(type)) {
+            break;
+        }
+        if (get_ir_type_size(type) == 1) {
+            emit(compiler, "movzbl %%%s, %%%s", get_x64_reg_name(dst, X64_WIDTH_8), get_x64_reg_name(dst, X64_WIDTH_32));
+        }
+        else if (get_ir_type_size(type) == 2) {
+            emit(compiler, "movzwl %%%s, %%%s", get_x64_reg_name(dst, X64_WIDTH_16), get_x64_reg_name(dst, X64_WIDTH_32));
+        }
+        else if (get_ir_type_size(type) == 4) {
+            emit(compiler, "movl %%%s, %%%s", get_x64_reg_name(dst, X64_WIDTH_32), get_x64_reg_name(dst, X64_WIDTH_32));
+        }
+    } break;
+    case X64_ARG_LOW_BYTE: {
+        emit_load(compiler, dst, arg->value);
+        emit(compiler, "movzbl %%%s, %%%s", get_x64_reg_name(dst, X64_WIDTH_8), get_x64_reg_name(dst, X64_WIDTH_32));
+    } break;
+    case X64_ARG_ZERO: {
+        emit_mov_imm(compiler, dst, 0);
+    } break;
+    case X64_ARG_STRING: {
+        emit(compiler, "leaq .Lstr%llu(%%rip), %%%s", (unsigned long long)arg->value, get_x64_reg_name(dst, X64_WIDTH_64));
+    } break;
+    default: assert(false && "Unreachable"); break;
+    };
+}
+
+static void push_arg(X64Compiler* compiler, const X64ArgKind kind, const u32 value) {
+    const X64Arg arg = { .kind = kind, .value = value };
+    vector_push_back(&compiler->args, &arg);
+}
+
+// Whether an argument reads a register that also passes arguments.
+static bool is_arg_reg_source(const X64Compiler* compiler, const X64Arg* arg) {
+    if (arg->kind == X64_ARG_ZERO || arg->kind == X64_ARG_STRING) {
+        return false;
+    }
+
+    const X64Location location = get_location(compiler, arg->value, get_live_use_position(compiler->instr));
+    for (u32 i = 0; i < X64_ARG_REGS_COUNT; ++i) {
+        if (location.reg == x64_arg_regs[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Calls with the pending arguments, the ones past the registers go on the stack, which stays aligned to 16 bytes.
+// When an argument is read from a register that passes another one, the arguments of the registers
+// are staged on the stack first. Variadic callees get the count of the vector registers in al, always zero.
+static void emit_call(X64Compiler* compiler, const char* symbol, const bool is_variadic) {
+    const X64Arg* args = (const X64Arg*)compiler->args.items;
+    const u32 count = (u32)compiler->args.items_count;
+    const u32 regs_count = count < X64_ARG_REGS_COUNT ? count : X64_ARG_REGS_COUNT;
+    const u32 stack_count = count - regs_count;
+    const u32 padding = stack_count % 2;
+
+    bool is_staged = false;
+    for (u32 i = 0; i < regs_count && !is_staged; ++i) {
+        is_staged = is_arg_reg_source(compiler, &args[i]);
+    }
+
+    if (padding != 0) {
+        emit(compiler, "subq $8, %%rsp");
+    }
+    for (u32 i = count; i > X64_ARG_REGS_COUNT; --i) {
+        emit_arg(compiler, X64_RAX, &args[i - 1]);
+        emit(compiler, "pushq %%rax");
+    }
+    if (is_staged) {
+        for (u32 i = 0; i < regs_count; ++i) {
+            emit_arg(compiler, X64_RAX, &args[i]);
+            emit(compiler, "pushq %%rax");
+        }
+        for (u32 i = regs_count; i-- > 0;) {
+            emit(compiler, "popq %%%s", get_x64_reg_name(x64_arg_regs[i], X64_WIDTH_64));
+        }
+    }
+    else {
+        for (u32 i = 0; i < regs_count; ++i) {
+            emit_arg(compiler, x64_arg_regs[i], &args[i]);
+        }
+    }
+
+    if (is_variadic) {
+        emit(compiler, "xorl %%eax, %%eax");
+    }
+    emit(compiler, "call %s", symbol);
+
+    if (stack_count + padding != 0) {
+        emit(compiler, "addq $%llu, %%rsp", (unsigned long long)(8 * (stack_count + padding)));
+    }
+    vector_clear(&compiler->args);
+}
+
+static IRType get_call_arg_type(const X64Compiler* compiler, const u32* args, const u32 count, const u32 index) {
+    return index < count ? get_reg_type(compiler, args[index]) : IR_TYPE_INT;
+}
+
+// A missing argument is a zero of type int, like in the interpreter.
+static void push_format_arg(X64Compiler* compiler, const X64ArgKind kind, const u32* args, const u32 count, const u32 index) {
+    if (index < count) {
+        push_arg(compiler, kind, args[index]);
+    }
+    else {
+        push_arg(compiler, X64_ARG_ZERO, 0);
+    }
+}
+
+static void append_format_text(StringBuilder* sb, const char* text, const u64 length) {
+    for (u64 i = 0; i < length; ++i) {
+        if (text[i] == '%') {
+            string_builder_append_char_right(sb, '%');
+        }
+        string_builder_append_char_right(sb, text[i]);
+    }
+}
+
+// Rewrites a format of the interpreter's printf into one of the C library, with the same parsing of the conversions.
+// Every conversion gets the length modifier of a 64 bit argument and the argument it prints, converted like the
+// interpreter converts it, so the output is the same.
+static void rewrite_printf_format(X64Compiler* compiler, const char* format, const u32* args, const u32 count, StringBuilder* sb) {
+    char spec[32] = { 0 };
+    u32 next = 1;
+
+    for (const char* p = format; *p != '\0'; ++p) {
+        if (*p != '%') {
+            string_builder_append_char_right(sb, *p);
+            continue;
+        }
+
+        const char* s = p + 1;
+        u32 len = 0;
+        spec[len++] = '%';
+
+        while (*s != '\0' && strchr("-+ #0", *s) != NULL && len < 8) { spec[len++] = *s++; }
+        while (is_digit(*s) && len < 16) { spec[len++] = *s++; }
+        if (*s == '.') {
+            spec[len++] = *s++;
+            while (is_digit(*s) && len < 24) { spec[len++] = *s++; }
+        }
+        while (*s == 'l' || *s == 'h' || *s == 'z') { ++s; }
+
+        if (*s == '\0') {
+            append_format_text(sb, p, str_len(p));
+            break;
+        }
+
+        const char* start = p;
+        p = s;
+
+        spec[len] = '\0';
+        switch (*s) {
+        case '%': {
+            string_builder_append_str_right(sb, "%%");
+        } break;
+        case 'd':
+        case 'i': {
+            string_builder_append_format(sb, "%slld", spec);
+            push_format_arg(compiler, X64_ARG_VALUE, args, count, next++);
+        } break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            string_builder_append_format(sb, "%sll%c", spec, *s);
+            push_format_arg(compiler, X64_ARG_MASKED, args, count, next++);
+        } break;
+        case 'c': {
+            string_builder_append_format(sb, "%sc", spec);
+            push_format_arg(compiler, X64_ARG_LOW_BYTE, args, count, next++);
+        } break;
+        case 's': {
+            // Values other than strings are printed as numbers, without the width of the conversion.
+            const IRType type = get_call_arg_type(compiler, args, count, next);
+            if (type == IR_TYPE_STRING) {
+                string_builder_append_format(sb, "%ss", spec);
+            }
+            else {
+                string_builder_append_str_right(sb, is_ir_type_signed(type) ? "%lld" : "%llu");
+            }
+            push_format_arg(compiler, X64_ARG_VALUE, args, count, next++);
+        } break;
+        default: {
+            // An unknown conversion is printed as it is.
+            append_format_text(sb, start, (u64)(s - start + 1));
+        } break;
+        };
+    }
+}
+
+// A format that is not a literal is handed to the C library as it is, with the arguments as 64 bit values.
+static bool push_printf_args(X64Compiler* compiler, const u32* args, const u32 count) {
+    if (count == 0 || get_reg_type(compiler, args[0]) != IR_TYPE_STRING) {
+        return false;
+    }
+
+    const u32 literal = compiler->literals[args[0]];
+    if (literal == IR_NULL_STRING) {
+        for (u32 i = 0; i < count; ++i) {
+            push_arg(compiler, X64_ARG_VALUE, args[i]);
+        }
+        return true;
+    }
+
+    StringBuilder sb = string_builder_create();
+    push_arg(compiler, X64_ARG_STRING, 0);
+    rewrite_printf_format(compiler, ir_function_get_string(compiler->ir, literal), args, count, &sb);
+
+    char* format = string_builder_get_str(&sb);
+    ((X64Arg*)compiler->args.items)[0].value = x64_module_add_string(compiler->module, format);
+
+    str_free(format);
+    string_builder_free(&sb);
+    return true;
+}
+
+// Strings are printed as they are and the rest as numbers.
+static void push_print_args(X64Compiler* compiler, const u32* args, const u32 count, const bool is_line) {
+    StringBuilder sb = string_builder_create();
+    push_arg(compiler, X64_ARG_STRING, 0);
+
+    for (u32 i = 0; i < count; ++i) {
+        const IRType type = get_reg_type(compiler, args[i]);
+        if (type == IR_TYPE_STRING) {
+            string_builder_append_str_right(&sb, "%s");
+        }
+        else {
+            string_builder_append_str_right(&sb, is_ir_type_signed(type) ? "%lld" : "%llu");
+        }
+        push_arg(compiler, X64_ARG_VALUE, args[i]);
+    }
+    if (is_line) {
+        string_builder_append_char_right(&sb, '\n');
+    }
+
+    char* format = string_builder_get_str(&sb);
+    ((X64Arg*)compiler->args.items)[0].value = x64_module_add_string(compiler->module, format);
+
+    str_free(format);
+    string_builder_free(&sb);
+}
+
+static BCNative find_x64_native(const char* name) {
+    for (u32 i = 0; i < BC_NATIVES_COUNT; ++i) {
+        if (str_eq(get_bc_native_name((BCNative)i), name)) {
+            return (BCNative)i;
+        }
+    }
+    return BC_NATIVES_COUNT;
+}
+
+// Functions of the program come before natives of the same name, like in the bytecode.
+static void compile_call(X64Compiler* compiler, const IRInstr* instr) {
+    const char* callee = ir_function_get_string(compiler->ir, instr->as.call.callee);
+    const u32* args = ir_function_get_list(compiler->ir, instr->as.call.first);
+    const u32 count = instr->as.call.count;
+
+    const X64Declaration* declaration = x64_module_find_declaration(compiler->module, callee);
+    const BCNative native = declaration == NULL ? find_x64_native(callee) : BC_NATIVES_COUNT;
+
+    if (declaration != NULL) {
+        // The missing arguments are zero and the extra ones are dropped, the callee converts the rest.
+        for (u32 i = 0; i < declaration->params_count; ++i) {
+            push_arg(compiler, i < count ? X64_ARG_VALUE : X64_ARG_ZERO, i < count ? args[i] : 0);
+        }
+
+        char* symbol = str_format("vane_%s", callee);
+        emit_call(compiler, symbol, false);
+        str_free(symbol);
+    }
+    else if (native != BC_NATIVES_COUNT) {
+        const bool has_call = native == BC_NATIVE_PRINTF
+            ? push_printf_args(compiler, args, count)
+            : (push_print_args(compiler, args, count, native == BC_NATIVE_PRINTLN), true);
+
+        if (!has_call) {
+            vector_clear(&compiler->args);
+            emit_mov_imm(compiler, X64_RAX, 0);
+        }
+        else {
+            emit_call(compiler, "printf@PLT", true);
+            emit(compiler, "movslq %%eax, %%rax");
+        }
+    }
+    else {
+        if (compiler->module->diag != NULL) {
+            diagnostic_engine_report(compiler->module->diag, ERR_UNDEFINED_FUNCTION, compiler->loc, callee);
+        }
+        compiler->is_valid = false;
+        return;
+    }
+
+    if (instr->dst != IR_NULL_REG) {
+        emit_normalize(compiler, X64_RAX, instr->type);
+        emit_store(compiler, instr->dst, X64_RAX);
+    }
+}
+
+#pragma endregion
+
+#pragma region EDGES
+
+// Collects the copies one edge out of the block needs: the phis of the target read their operands where the block
+// leaves them, and the registers live into the target move when the allocator split them between the two blocks.
+// Copies into the location the value is already in are dropped.
+static u32 collect_edge_moves(X64Compiler* compiler, const u32 block, const u32 slot) {
+    const CFGContext* ctx = compiler->ctx;
+    const LiveIntervals* intervals = &compiler->module->intervals;
+
+    vector_clear(&compiler->moves);
+
+    u32 succs_count = 0;
+    const u32* succs = cfg_graph_get_succs(&ctx->graph, block, &succs_count);
+    const u32* pred_indices = cfg_graph_get_succ_pred_indices(&ctx->graph, block, &succs_count);
+    assert(slot < succs_count);
+
+    // The operands of the phis are read at the last instruction of the block.
+    const u32 from = live_intervals_get_block_end(intervals, block) - LIVE_POSITIONS_PER_INSTR;
+    const u32 to = live_intervals_get_block_start(intervals, succs[slot]);
+
+    const CFGNode* succ = cfg_context_get_node(ctx, succs[slot]);
+    for (u32 i = 0; i < succ->instrs_count; ++i) {
+        const IRInstr* phi = ir_function_get_instr(compiler->ir, succ->instrs_begin + i);
+        if (phi->op != IR_OP_PHI) {
+            break;
+        }
+
+        const u32 src = ir_function_get_list(compiler->ir, phi->as.phi.first)[pred_indices[slot] * 2 + 1];
+        if (src == IR_NULL_REG) {
+            continue;
+        }
+
+        const IRType type = get_reg_type(compiler, src) == phi->type ? IR_TYPE_VOID : phi->type;
+        push_move(compiler, get_location(compiler, phi->dst, to), get_location(compiler, src, from), type);
+    }
+
+    const Liveness* liveness = &intervals->liveness;
+    const u64* live_in = liveness_get_live_in(liveness, succs[slot]);
+    const u32 words_count = liveness->problem.words_count;
+    for (u32 bit = bit_set_next(live_in, words_count, 0); bit != BIT_SET_NULL_BIT; bit = bit_set_next(live_in, words_count, bit + 1)) {
+        const u32 reg = liveness_get_bit_reg(liveness, bit);
+        push_move(compiler, get_location(compiler, reg, to), get_location(compiler, reg, from), IR_TYPE_VOID);
+    }
+
+    return (u32)compiler->moves.items_count;
+}
+
+// Emits the copies of the edge and a jump to its target, unless the target is laid out next.
+static void emit_edge(X64Compiler* compiler, const u32 block, const u32 slot, const u32 target, const u32 next) {
+    collect_edge_moves(compiler, block, slot);
+    emit_pending_moves(compiler);
+
+    if (target != next) {
+        emit_jump_to_block(compiler, "jmp", target);
+    }
+}
+
+// The conditional jump goes straight to the target of an edge without copies,
+// only when both edges have them the copies of the taken one are skipped over locally.
+static void compile_branch(X64Compiler* compiler, const u32 block, const IRInstr* instr, const u32 next) {
+    const u32 then_block = instr->as.branch.then_block;
+    const u32 else_block = instr->as.branch.else_block;
+
+    const bool has_then_moves = collect_edge_moves(compiler, block, 0) > 0;
+    const bool has_else_moves = collect_edge_moves(compiler, block, 1) > 0;
+
+    emit(compiler, "cmpq $0, %s", get_use_operand(compiler, instr->a).text);
+
+    if (!has_else_moves && (has_then_moves || then_block == next)) {
+        emit_jump_to_block(compiler, "je", else_block);
+        emit_edge(compiler, block, 0, then_block, next);
+    }
+    else if (!has_then_moves) {
+        emit_jump_to_block(compiler, "jne", then_block);
+        emit_edge(compiler, block, 1, else_block, next);
+    }
+    else {
+        const u32 label = create_local_label(compiler);
+        emit_jump_to_local(compiler, "je", label);
+        emit_edge(compiler, block, 0, then_block, CFG_NULL_NODE);
+
+        emit_local_label(compiler, label);
+        emit_edge(compiler, block, 1, else_block, next);
+    }
+}
+
+#pragma endregion
+
+#pragma region INSTRUCTIONS
+
+static void compile_const(X64Compiler* compiler, const IRInstr* instr) {
+    const i64 value = normalize_ir_value(instr->type, instr->as.imm);
+
+    if (value >= -(i64)0x80000000 && value <= (i64)0x7FFFFFFF) {
+        emit(compiler, "movq $%lld, %s", (long long)value, get_def_operand(compiler, instr->dst).text);
+        return;
+    }
+
+    emit_mov_imm(compiler, X64_RAX, value);
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+// 'dst = a ? b : c' selects without a branch.
+static void compile_select(X64Compiler* compiler, const IRInstr* instr) {
+    emit_load_normalized(compiler, X64_RAX, instr->b, instr->type);
+    emit_load_normalized(compiler, X64_RCX, instr->c, instr->type);
+    emit(compiler, "cmpq $0, %s", get_use_operand(compiler, instr->a).text);
+    emit(compiler, "cmoveq %%rcx, %%rax");
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+// The copies of the non-SSA form, values already in the type of their destination are copied as they are.
+static void compile_copy(X64Compiler* compiler, const IRInstr* instr) {
+    const IRType type = get_reg_type(compiler, instr->a) == instr->type ? IR_TYPE_VOID : instr->type;
+    const u32 position = get_live_use_position(compiler->instr);
+
+    push_move(compiler, get_location(compiler, instr->dst, get_live_def_position(compiler->instr)), get_location(compiler, instr->a, position), type);
+    emit_pending_moves(compiler);
+}
+
+// rax = a op b, for the ops that only work on the low bits, so the operands need no normalization.
+static void compile_binary(X64Compiler* compiler, const IRInstr* instr, const char* op) {
+    emit_load(compiler, X64_RAX, instr->a);
+    emit(compiler, "%s %s, %%rax", op, get_use_operand(compiler, instr->b).text);
+    emit_normalize(compiler, X64_RAX, instr->type);
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+static void compile_unary(X64Compiler* compiler, const IRInstr* instr) {
+    emit_load(compiler, X64_RAX, instr->a);
+
+    if (instr->op == IR_OP_LNOT) {
+        emit(compiler, "testq %%rax, %%rax");
+        emit(compiler, "sete %%al");
+        emit(compiler, "movzbl %%al, %%eax");
+    }
+    else {
+        emit(compiler, instr->op == IR_OP_NEG ? "negq %%rax" : "notq %%rax");
+        emit_normalize(compiler, X64_RAX, instr->type);
+    }
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+static void compile_logical(X64Compiler* compiler, const IRInstr* instr) {
+    emit_load_normalized(compiler, X64_RAX, instr->a, IR_TYPE_BOOL);
+    emit_load_normalized(compiler, X64_RCX, instr->b, IR_TYPE_BOOL);
+    emit(compiler, instr->op == IR_OP_LAND ? "andq %%rcx, %%rax" : "orq %%rcx, %%rax");
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+// The high half of the product at twice the width of the type, the 64 bit ones take it from rdx.
+static void compile_mulh(X64Compiler* compiler, const IRInstr* instr) {
+    const bool is_signed = is_ir_type_signed(instr->type);
+    const u32 bits = get_ir_type_size(instr->type) * 8;
+
+    emit_load_normalized(compiler, X64_RAX, instr->a, instr->type);
+    emit_load_normalized(compiler, X64_RCX, instr->b, instr->type);
+
+    if (bits <= 32) {
+        emit(compiler, "imulq %%rcx, %%rax");
+        emit(compiler, "%s $%llu, %%rax", is_signed ? "sarq" : "shrq", (unsigned long long)bits);
+        emit_normalize(compiler, X64_RAX, instr->type);
+        emit_store(compiler, instr->dst, X64_RAX);
+        return;
+    }
+
+    emit(compiler, is_signed ? "imulq %%rcx" : "mulq %%rcx");
+    emit_store(compiler, instr->dst, X64_RDX);
+}
+
+static void compile_division(X64Compiler* compiler, const IRInstr* instr) {
+    const IRType type = instr->type;
+    const bool is_signed = is_ir_type_signed(type);
+
+    emit_load_normalized(compiler, X64_RAX, instr->a, type);
+    emit_load_normalized(compiler, X64_RCX, instr->b, type);
+
+    emit(compiler, "testq %%rcx, %%rcx");
+    emit_jump_to_trap(compiler, "je", VM_STATUS_DIVISION_BY_ZERO);
+
+    if (is_signed) {
+        // The minimum of the type over -1, the division itself faults for 64 bits and overflows the type for the rest.
+        const u32 size = get_ir_type_size(type);
+        const u32 bits = size == 0 ? 64 : size * 8;
+        const u32 label = create_local_label(compiler);
+
+        emit(compiler, "cmpq $-1, %%rcx");
+        emit_jump_to_local(compiler, "jne", label);
+        emit_mov_imm(compiler, X64_RDX, (i64)((u64)0 - ((u64)1 << (bits - 1))));
+        emit(compiler, "cmpq %%rdx, %%rax");
+        emit_jump_to_trap(compiler, "je", VM_STATUS_DIVISION_OVERFLOW);
+        emit_local_label(compiler, label);
+
+        emit(compiler, "cqto");
+        emit(compiler, "idivq %%rcx");
+    }
+    else {
+        emit(compiler, "xorl %%edx, %%edx");
+        emit(compiler, "divq %%rcx");
+    }
+    emit_store(compiler, instr->dst, instr->op == IR_OP_REM ? X64_RDX : X64_RAX);
+}
+
+// The amount is masked by the hardware like by the interpreter.
+static void compile_shift(X64Compiler* compiler, const IRInstr* instr) {
+    emit_load(compiler, X64_RCX, instr->b);
+
+    if (instr->op == IR_OP_SHL) {
+        emit_load(compiler, X64_RAX, instr->a);
+        emit(compiler, "shlq %%cl, %%rax");
+        emit_normalize(compiler, X64_RAX, instr->type);
+    }
+    else {
+        emit_load_normalized(compiler, X64_RAX, instr->a, instr->type);
+        emit(compiler, is_ir_type_signed(instr->type) ? "sarq %%cl, %%rax" : "shrq %%cl, %%rax");
+    }
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+// Compares are typed by their operands, unsigned ones compare the bits.
+static void compile_compare(X64Compiler* compiler, const IRInstr* instr) {
+    const bool is_signed = is_ir_type_signed(instr->type);
+
+    const char* set = NULL;
+    switch (instr->op) {
+    case IR_OP_EQ: set = "sete"; break;
+    case IR_OP_NE: set = "setne"; break;
+    case IR_OP_LT: set = is_signed ? "setl" : "setb"; break;
+    case IR_OP_LE: set = is_signed ? "setle" : "setbe"; break;
+    case IR_OP_GT: set = is_signed ? "setg" : "seta"; break;
+    case IR_OP_GE: set = is_signed ? "setge" : "setae"; break;
+    default: assert(false && "Unreachable"); break;
+    };
+
+    emit_load_normalized(compiler, X64_RAX, instr->a, instr->type);
+    emit_load_normalized(compiler, X64_RCX, instr->b, instr->type);
+    emit(compiler, "cmpq %%rcx, %%rax");
+    emit(compiler, "%s %%al", set);
+    emit(compiler, "movzbl %%al, %%eax");
+    emit_store(compiler, instr->dst, X64_RAX);
+}
+
+// rdx = the items of the array, rcx = the index, both checked.
+static void emit_element_address(X64Compiler* compiler, const u32 array, const u32 index) {
+    emit_load(compiler, X64_RDX, array);
+    emit_load(compiler, X64_RCX, index);
+    emit(compiler, "testq %%rdx, %%rdx");
+    emit_jump_to_trap(compiler, "je", VM_STATUS_INDEX_OUT_OF_RANGE);
+    emit(compiler, "cmpq %llu(%%rdx), %%rcx", (unsigned long long)offsetof(VMArray, count));
+    emit_jump_to_trap(compiler, "jae", VM_STATUS_INDEX_OUT_OF_RANGE);
+    emit(compiler, "movq %llu(%%rdx), %%rdx", (unsigned long long)offsetof(VMArray, items));
+}
+
+// Saves the callee-saved registers the function uses into the first slots of the frame or restores them.
+static void emit_saved_regs(X64Compiler* compiler, const bool is_restore) {
+    const u64 used_regs = compiler->module->allocation.used_regs & ~x64_alloc_target.caller_saved;
+
+    u32 saved = 0;
+    for (u32 i = 0; i < X64_ALLOC_REGS_COUNT; ++i) {
+        if ((used_regs & ((u64)1 << i)) == 0) {
+            continue;
+        }
+
+        const char* name = get_x64_reg_name(x64_alloc_regs[i], X64_WIDTH_64);
+        const long long offset = -8 * ((long long)saved++ + 1);
+        if (is_restore) {
+            emit(compiler, "movq %lld(%%rbp), %%%s", offset, name);
+        }
+        else {
+            emit(compiler, "movq %%%s, %lld(%%rbp)", name, offset);
+        }
+    }
+}
+
+static void compile_ret(X64Compiler* compiler, const IRInstr* instr) {
+    if (instr->a != IR_NULL_REG) {
+        emit_load(compiler, X64_RAX, instr->a);
+    }
+    else {
+        emit_mov_imm(compiler, X64_RAX, 0);
+    }
+    emit_saved_regs(compiler, true);
+    emit(compiler, "leave");
+    emit(compiler, "ret");
+}
+
+static void compile_instr(X64Compiler* compiler, const u32 block, const IRInstr* instr, const u32 next) {
+    switch (instr->op) {
+    case IR_OP_NOP:
+    case IR_OP_PHI: { /* DO NOTHING */ } break;
+    case IR_OP_CONST: { compile_const(compiler, instr); } break;
+    case IR_OP_STR: {
+        const u32 index = x64_module_add_string(compiler->module, ir_function_get_string(compiler->ir, instr->as.str));
+        emit(compiler, "leaq .Lstr%llu(%%rip), %%rax", (unsigned long long)index);
+        emit_store(compiler, instr->dst, X64_RAX);
+    } break;
+    case IR_OP_COPY: { compile_copy(compiler, instr); } break;
+    case IR_OP_SELECT: { compile_select(compiler, instr); } break;
+    case IR_OP_CALL: { compile_call(compiler, instr); } break;
+    case IR_OP_LOAD_ELEM: {
+        emit_element_address(compiler, instr->a, instr->b);
+        emit(compiler, "movq (%%rdx,%%rcx,8), %%rax");
+        emit_normalize(compiler, X64_RAX, instr->type);
+        emit_store(compiler, instr->dst, X64_RAX);
+    } break;
+    case IR_OP_STORE_ELEM: {
+        emit_element_address(compiler, instr->a, instr->b);
+        emit_load_normalized(compiler, X64_RAX, instr->c, instr->type);
+        emit(compiler, "movq %%rax, (%%rdx,%%rcx,8)");
+    } break;
+    case IR_OP_NEG:
+    case IR_OP_NOT:
+    case IR_OP_LNOT: { compile_unary(compiler, instr); } break;
+    case IR_OP_ADD: { compile_binary(compiler, instr, "addq"); } break;
+    case IR_OP_SUB: { compile_binary(compiler, instr, "subq"); } break;
+    case IR_OP_MUL: { compile_binary(compiler, instr, "imulq"); } break;
+    case IR_OP_AND: { compile_binary(compiler, instr, "andq"); } break;
+    case IR_OP_OR: { compile_binary(compiler, instr, "orq"); } break;
+    case IR_OP_XOR: { compile_binary(compiler, instr, "xorq"); } break;
+    case IR_OP_MULH: { compile_mulh(compiler, instr); } break;
+    case IR_OP_DIV:
+    case IR_OP_REM: { compile_division(compiler, instr); } break;
+    case IR_OP_SHL:
+    case IR_OP_SHR: { compile_shift(compiler, instr); } break;
+    case IR_OP_LAND:
+    case IR_OP_LOR: { compile_logical(compiler, instr); } break;
+    case IR_OP_EQ:
+    case IR_OP_NE:
+    case IR_OP_LT:
+    case IR_OP_LE:
+    case IR_OP_GT:
+    case IR_OP_GE: { compile_compare(compiler, instr); } break;
+    case IR_OP_JMP: {
+        emit_edge(compiler, block, 0, instr->as.target, next);
+    } break;
+    case IR_OP_BR: { compile_branch(compiler, block, instr, next); } break;
+    case IR_OP_RET: { compile_ret(compiler, instr); } break;
+    default: assert(false && "Unreachable"); break;
+    };
+}
+
+#pragma endregion
+
+#pragma region FUNCTION
+
+// The literal a register holds when a 'str' is its only definition, the formats of printf are rewritten from it.
+// The parameters are defined on the entry.
+static u32* collect_literals(const IRFunction* ir) {
+    const u32 regs_count = ir_function_get_regs_count(ir);
+    u32* literals = malloc((regs_count + 1) * sizeof(u32));
+    u32* defs_counts = calloc(regs_count + 1, sizeof(u32));
+    assert(literals != NULL && defs_counts != NULL);
+
+    for (u32 i = 0; i < regs_count; ++i) {
+        literals[i] = IR_NULL_STRING;
+        defs_counts[i] = i < ir->params_count;
+    }
+
+    for (u32 i = 0; i < ir_function_get_instrs_count(ir); ++i) {
+        const IRInstr* instr = ir_function_get_instr(ir, i);
+        if (instr->op == IR_OP_NOP || instr->dst == IR_NULL_REG) {
+            continue;
+        }
+
+        ++defs_counts[instr->dst];
+        if (instr->op == IR_OP_STR) {
+            literals[instr->dst] = instr->as.str;
+        }
+    }
+
+    for (u32 i = 0; i < regs_count; ++i) {
+        if (defs_counts[i] != 1) {
+            literals[i] = IR_NULL_STRING;
+        }
+    }
+
+    free(defs_counts);
+    return literals;
+}
+
+// The parameters move from where the ABI passes them into their locations, converted to their types,
+// the System V ABI leaves the upper bits of the narrow ones undefined. The other registers live on the entry
+// start at zero, like the locals after 'dim'.
+static void emit_prologue(X64Compiler* compiler) {
+    const LiveIntervals* intervals = &compiler->module->intervals;
+    const u32 params_count = compiler->ir->params_count;
+
+    string_builder_append_format(&compiler->module->text, "\n\t.globl vane_%s\n\t.type vane_%s, @function\nvane_%s:\n",
+        compiler->name, compiler->name, compiler->name);
+
+    emit(compiler, "pushq %%rbp");
+    emit(compiler, "movq %%rsp, %%rbp");
+    emit(compiler, "subq $%llu, %%rsp", (unsigned long long)get_frame_size(compiler));
+    emit_saved_regs(compiler, false);
+
+    // A register is live on the entry when its interval starts at the first position.
+    for (u32 reg = 0; reg < params_count; ++reg) {
+        if (live_intervals_get(intervals, reg)->start != 0) {
+            continue;
+        }
+
+        const X64Location src = reg < X64_ARG_REGS_COUNT
+            ? (X64Location) { .reg = x64_arg_regs[reg], .offset = 0 }
+            : get_frame_location(16 + 8 * ((i64)reg - X64_ARG_REGS_COUNT));
+        push_move(compiler, get_location(compiler, reg, 0), src, get_reg_type(compiler, reg));
+    }
+    emit_pending_moves(compiler);
+
+    for (u32 reg = params_count; reg < intervals->regs_count; ++reg) {
+        if (live_intervals_get(intervals, reg)->start != 0) {
+            continue;
+        }
+
+        const X64Location dst = get_location(compiler, reg, 0);
+        if (dst.reg != X64_RBP) {
+            emit_mov_imm(compiler, dst.reg, 0);
+        }
+        else {
+            emit(compiler, "movq $0, %s", get_location_operand(dst).text);
+        }
+    }
+}
+
+// A trap passes the text of its status and the name of the function to the runtime, which does not return.
+static void emit_traps(X64Compiler* compiler) {
+    const u32 name = x64_module_add_string(compiler->module, compiler->name);
+
+    for (u32 status = VM_STATUS_OK + 1; status <= VM_STATUS_STACK_OVERFLOW; ++status) {
+        if ((compiler->traps & (1u << status)) == 0) {
+            continue;
+        }
+
+        const u32 text = x64_module_add_string(compiler->module, get_vm_status_text((VMStatus)status));
+        string_builder_append_format(&compiler->module->text, ".L%llu_trap%llu:\n", (unsigned long long)compiler->index, (unsigned long long)status);
+        emit(compiler, "leaq .Lstr%llu(%%rip), %%rdi", (unsigned long long)text);
+        emit(compiler, "leaq .Lstr%llu(%%rip), %%rsi", (unsigned long long)name);
+        emit(compiler, "call vane_trap");
+    }
+}
+
+bool compile_x64_function(X64Module* module, const CFGContext* ctx, const char* name, const SourceLoc loc, const RegAllocator allocator) {
+    assert(module != NULL && ctx != NULL && name != NULL);
+
+    const IRFunction* ir = &ctx->ir;
+
+    live_intervals_build(&module->intervals, ctx);
+    if (allocator == REG_ALLOCATOR_GRAPH_COLORING) {
+        allocate_registers_graph_coloring(&module->allocation, &module->intervals, &x64_alloc_target);
+    }
+    else {
+        allocate_registers_linear_scan(&module->allocation, &module->intervals, &x64_alloc_target);
+    }
+
+    u32 saved_count = 0;
+    for (u32 i = 0; i < X64_ALLOC_REGS_COUNT; ++i) {
+        saved_count += (module->allocation.used_regs & ~x64_alloc_target.caller_saved & ((u64)1 << i)) != 0;
+    }
+
+    X64Compiler compiler = {
+        .module = module,
+        .ctx = ctx,
+        .ir = ir,
+        .name = name,
+        .loc = loc,
+        .index = module->functions_count,
+        .labels_count = 0,
+        .instr = 0,
+        .saved_count = saved_count,
+        .literals = collect_literals(ir),
+        .traps = 0,
+        .moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(X64Move), NULL, false),
+        .split_moves = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(RegAllocMove), NULL, false),
+        .next_split_move = 0,
+        .args = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(X64Arg), NULL, false),
+        .is_valid = true,
+    };
+    reg_allocation_collect_split_moves(&module->allocation, &module->intervals, &compiler.split_moves);
+
+    emit_prologue(&compiler);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 block = rpo[i];
+        const u32 next = i + 1 < rpo_count ? rpo[i + 1] : CFG_NULL_NODE;
+
+        emit_block_label(&compiler, block);
+
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+        for (u32 j = 0; j < node->instrs_count; ++j, ++compiler.instr) {
+            emit_split_moves(&compiler);
+            compile_instr(&compiler, block, ir_function_get_instr(ir, node->instrs_begin + j), next);
+        }
+    }
+
+    emit_traps(&compiler);
+    string_builder_append_format(&module->text, "\t.size vane_%s, .-vane_%s\n", name, name);
+    ++module->functions_count;
+
+    free(compiler.literals);
+    vector_free(&compiler.moves);
+    vector_free(&compiler.split_moves);
+    vector_free(&compiler.args);
+
+    return compiler.is_valid;
+}
+
+#pragma endregion
+
+#pragma region RUNTIME
+
+static const char* x64_runtime_text =
+    "\n"
+    "# The runtime, the C library does the rest.\n"
+    "\t.globl main\n"
+    "\t.type main, @function\n"
+    "main:\n"
+    "\tpushq %rbp\n"
+    "\tmovq %rsp, %rbp\n"
+    "\tsubq $16, %rsp\n"
+    "\tmovq $0, -16(%rbp)\n"
+    "\tmovq $0, -8(%rbp)\n"
+    "\tleaq -16(%rbp), %rdi\n"
+    "\tcall vane_main\n"
+    "\tleave\n"
+    "\tret\n"
+    "\t.size main, .-main\n"
+    "\n"
+    "\t.type vane_trap, @function\n"
+    "vane_trap:\n"
+    "\tpushq %rbp\n"
+    "\tmovq %rsp, %rbp\n"
+    "\tmovq %rsi, %rdx\n"
+    "\tmovq %rdi, %rsi\n"
+    "\tleaq .Ltrap_format(%rip), %rdi\n"
+    "\txorl %eax, %eax\n"
+    "\tcall printf@PLT\n"
+    "\tmovl $1, %edi\n"
+    "\tcall exit@PLT\n"
+    "\t.size vane_trap, .-vane_trap\n";
+
+// Bytes other than the printable ones are written as octal escapes.
+static void write_x64_string(FILE* handle, const char* s) {
+    fputs("\t.string \"", handle);
+    for (const u8* p = (const u8*)s; *p != '\0'; ++p) {
+        if (*p < 0x20 || *p >= 0x7F || *p == '"' || *p == '\\') {
+            fprintf(handle, "\\%03o", (unsigned)*p);
+        }
+        else {
+            fputc(*p, handle);
+        }
+    }
+    fputs("\"\n", handle);
+}
+
+void write_x64_module(FILE* handle, const X64Module* module) {
+    assert(handle != NULL && module != NULL);
+
+    fputs("\t.text\n", handle);
+
+    char* text = string_builder_get_str(&module->text);
+    fputs(text, handle);
+    str_free(text);
+
+    // 'main(args as string())' gets an empty array.
+    if (x64_module_find_declaration(module, "main") != NULL) {
+        fputs(x64_runtime_text, handle);
+    }
+
+    fputs("\n\t.section .rodata\n", handle);
+    fputs(".Ltrap_format:\n", handle);
+    write_x64_string(handle, "\nRuntime error: %s in function '%s'.\n");
+
+    for (u64 i = 0; i < module->strings.items_count; ++i) {
+        fprintf(handle, ".Lstr%llu:\n", (unsigned long long)i);
+        write_x64_string(handle, vector_get_ref(&module->strings, i));
+    }
+
+    fputs("\n\t.section .note.GNU-stack,\"\",@progbits\n", handle);
+}
+
+#pragma endregion
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "vanec/utils/string_utils.h"
 
+#include "vanec/backend/jit.h"
+
 void compiler_options_init(CompilerOptions* options) {
     if (options == NULL) {
         return;
@@ -15,6 +17,14 @@ void compiler_options_init(CompilerOptions* options) {
     options->files = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char*), &str_free, true);
     options->stream_chunk_capacity = MIN_STREAM_CHUNK_CAPACITY;
     options->output_dir = NULL;
+    options->trace_filepath = NULL;
+    options->time_report = false;
+    options->output_ssa = false;
+    options->opt_level = COMPILER_OPT_LEVEL_NONE;
+    options->output_bytecode = false;
+    options->profile_vm = false;
+    options->jit = false;
+    options->jit_threshold = JIT_DEFAULT_THRESHOLD;
 }
 
 typedef struct {
@@ -39,10 +49,24 @@ static void print_usage(const char* path) {
     PRINT("  lex <file> [<file> ...]   Lex a file(s) into tokens.");
     PRINT("  ast <file> [<file> ...]   Parse a file(s) into an abstract syntax tree.");
     PRINT("  cfg <file> [<file> ...]   Build control flow graph(s) for functions in a file(s).");
+    PRINT("  ir <file> [<file> ...]    Print the linear IR of functions in a file(s).");
+    PRINT("  run <file>                Compile a file to bytecode and run its main function.");
+    PRINT("  compile <file> [<file> ...] Compile a file(s) to x86-64 assembly for GNU as, one '.s' file each.");
     PRINT("");
     PRINT("General options:");
     PRINT("  --chunk_cap <number>   - set stream chunk capacity.");
     PRINT("  --output_dir <dirpath> - set output directory path.");
+    PRINT("  --ssa                  - print the ir in SSA form.");
+    PRINT("  --optimize             - run the optimization passes on the cfg and the ir, quicken the bytecode.");
+    PRINT("  --opt_level <n>        - set the optimization level, 1 is '--optimize', 2 also colors the registers of 'compile'.");
+    PRINT("  --bytecode             - print the bytecode of the functions before running them.");
+    PRINT("  --jit                  - compile the functions 'run' calls often to native code.");
+    PRINT("  --jit_threshold <n>    - set the calls before a function is compiled by the jit, 0 compiles it on the first one.");
+    PRINT("");
+    PRINT("Profiling options:");
+    PRINT("  --time-report          - print a per phase and per function time table.");
+    PRINT("  --trace <filepath>     - write phase timings as a Chrome trace_event JSON file.");
+    PRINT("  --vm-profile           - print the most frequent opcodes, pairs and triples dispatched by 'run'.");
 }
 
 static inline bool is_option(const char* arg) {
@@ -92,6 +116,62 @@ static inline void parse_option(ArgParserContext* ctx) {
             ctx->options->stream_chunk_capacity = cap;
             return;
         }
+        else if (match_arg(opt, "ssa")) {
+            ctx->options->output_ssa = true;
+            return;
+        }
+        else if (match_arg(opt, "optimize")) {
+            if (ctx->options->opt_level < COMPILER_OPT_LEVEL_PASSES) {
+                ctx->options->opt_level = COMPILER_OPT_LEVEL_PASSES;
+            }
+            return;
+        }
+        else if (match_arg(opt, "opt_level")) {
+            if (!has_next(ctx) || is_next_opt(ctx)) {
+                PRINT_ERROR_AND_EXIT(-1, "The argument for the \"opt_level\" option was not provided");
+            }
+
+            const u32 level = (u32)atoi(ctx->args[++ctx->arg_index]);
+            if (level > COMPILER_OPT_LEVEL_FULL) {
+                PRINT_ERROR_AND_EXIT(-1, "The \"opt_level\" option must be at most %d", COMPILER_OPT_LEVEL_FULL);
+            }
+
+            ctx->options->opt_level = (CompilerOptLevel)level;
+            return;
+        }
+        else if (match_arg(opt, "bytecode")) {
+            ctx->options->output_bytecode = true;
+            return;
+        }
+        else if (match_arg(opt, "jit")) {
+            ctx->options->jit = true;
+            return;
+        }
+        else if (match_arg(opt, "jit_threshold")) {
+            if (!has_next(ctx) || is_next_opt(ctx)) {
+                PRINT_ERROR_AND_EXIT(-1, "The argument for the \"jit_threshold\" option was not provided");
+            }
+
+            ctx->options->jit_threshold = (u32)atoi(ctx->args[++ctx->arg_index]);
+            return;
+        }
+        else if (match_arg(opt, "vm-profile")) {
+            ctx->options->profile_vm = true;
+            return;
+        }
+        else if (match_arg(opt, "time-report")) {
+            ctx->options->time_report = true;
+            return;
+        }
+        else if (match_arg(opt, "trace")) {
+            if (!has_next(ctx) || is_next_opt(ctx)) {
+                PRINT_ERROR_AND_EXIT(-1, "The argument for the \"trace\" option was not provided");
+            }
+
+            str_free(ctx->options->trace_filepath);
+            ctx->options->trace_filepath = str_dup(ctx->args[++ctx->arg_index]);
+            return;
+        }
     }
     PRINT_ERROR_AND_EXIT(-1, "Unknown option \"%s\".", ctx->current_arg);
 }
@@ -131,6 +211,33 @@ static inline void parse_command(ArgParserContext* ctx) {
         }
         return;
     }
+    if (match_arg(ctx->current_arg, "ir")) {
+        ctx->options->command = COMPILER_COMMAND_BUILD_IR_ONLY;
+
+        append_arg_files(ctx, &ctx->options->files);
+        if (ctx->options->files.items_count == 0) {
+            PRINT_ERROR_AND_EXIT(-1, "The \"ir\" command need at least one file.");
+        }
+        return;
+    }
+    if (match_arg(ctx->current_arg, "run")) {
+        ctx->options->command = COMPILER_COMMAND_RUN;
+
+        append_arg_files(ctx, &ctx->options->files);
+        if (ctx->options->files.items_count != 1) {
+            PRINT_ERROR_AND_EXIT(-1, "The \"run\" command need exactly one file.");
+        }
+        return;
+    }
+    if (match_arg(ctx->current_arg, "compile")) {
+        ctx->options->command = COMPILER_COMMAND_COMPILE;
+
+        append_arg_files(ctx, &ctx->options->files);
+        if (ctx->options->files.items_count == 0) {
+            PRINT_ERROR_AND_EXIT(-1, "The \"compile\" command need at least one file.");
+        }
+        return;
+    }
     PRINT_ERROR_AND_EXIT(-1, "Unknown command \"%s\".", ctx->current_arg);
 }
 
@@ -174,6 +281,9 @@ void compiler_options_free(CompilerOptions* options) {
 
     vector_free(&options->files);
     str_free(options->output_dir);
+    str_free(options->trace_filepath);
 
     options->output_dir = NULL;
+    options->trace_filepath = NULL;
+    options->time_report = false;
 }
\ No newline at end of file
@@ -103,9 +103,16 @@ void ast_parser_skip_to_the_end_of_a_file(ASTParser* parser) {
 
     while (token_stream_peek_next(&parser->ts)->kind != TOKEN_END_OF_FILE) {
         token_stream_consume(&parser->ts);
+        token_stream_release_consumed(&parser->ts);
     }
 }
 
+void ast_parser_release_consumed_tokens(ASTParser* parser) {
+    assert(parser != NULL);
+
+    token_stream_release_consumed(&parser->ts);
+}
+
 ASTNode* ast_parser_parse_ast_funcdef_node(ASTParser* parser) {
     assert(parser != NULL);
 
@@ -600,6 +607,7 @@ ASTNode* ast_parser_parse_ast_while_stmt_node(ASTParser* parser) {
     while_loop->loc = loc;
     while_loop->as.while_stmt->expr = expr;
     while_loop->as.while_stmt->stmts = stmts;
+    while_loop->as.while_stmt->is_until = false;
 
     return while_loop;
 }
@@ -640,6 +648,8 @@ ASTNode* ast_parser_parse_ast_do_while_stmt_node(ASTParser* parser) {
         return NULL;
     }
 
+    const bool is_until = token->kind == TOKEN_UNTIL_KEYWORD;
+
     ASTNode* expr = ast_parser_parse_ast_expression_node(parser, PREC_NONE);
 
     if (expr == NULL) {
@@ -654,6 +664,7 @@ ASTNode* ast_parser_parse_ast_do_while_stmt_node(ASTParser* parser) {
     do_while->loc = loc;
     do_while->as.do_while_stmt->expr = expr;
     do_while->as.do_while_stmt->stmts = stmts;
+    do_while->as.do_while_stmt->is_until = is_until;
 
     return do_while;
 }
@@ -753,7 +764,10 @@ ASTNode* ast_parser_parse_ast_unary_expr_node(ASTParser* parser) {
 
     char* op = str_dup(get_token_kind_value(token->kind));
 
-    ASTNode* rhs = ast_parser_parse_ast_expression_node(parser, PREC_NONE);
+    // The operand binds tighter than any binary operator, only calls and indexers are taken.
+    // Parsing it with PREC_NONE swallowed the rest of the expression (-a + b was -(a + b))
+    // and made every following unary a level deeper in the tree.
+    ASTNode* rhs = ast_parser_parse_ast_expression_node(parser, PREC_MULTIPLICATIVE);
 
     if (rhs == NULL) {
         str_free(op);
@@ -2,32 +2,179 @@
 
 #include <assert.h>
 
-CFGNode* build_cfg_for_function(CFGContext* ctx, const ASTNode* ast) {
+#include "vanec/frontend/cfg/cfg_lowering.h"
+
+// Node pointers are re-fetched by id after every creation, since it may grow the pool.
+#define CFG_NODE(id) cfg_context_get_node(ctx, (id))
+
+static bool is_jump_cfg_node(const CFGContext* ctx, const u32 id) {
+    const CFGNodeKind kind = CFG_NODE(id)->kind;
+    return kind == CFG_BREAK_NODE || kind == CFG_BACKEDGE_NODE;
+}
+
+static u32 find_enclosing_scope(const CFGContext* ctx, const CFGScopeKind kind) {
+    u32 scope_it = ctx->curr_scope;
+    while (scope_it != CFG_NULL_SCOPE && cfg_context_get_scope(ctx, scope_it)->kind != kind) {
+        scope_it = cfg_context_get_scope(ctx, scope_it)->prev;
+    }
+    return scope_it;
+}
+
+static IRInstr create_jump(const u32 target) {
+    assert(target != CFG_NULL_NODE && "Every block must have a successor.");
+
+    IRInstr instr = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+    instr.as.target = target;
+
+    return instr;
+}
+
+static IRInstr create_cfg_node_terminator(const CFGContext* ctx, const CFGNode* node) {
+    switch (node->kind) {
+    case CFG_FUNC_ENTRY_NODE: { return create_jump(node->as.func_entry.block.first); } break;
+    case CFG_FUNC_EXIT_NODE: {
+        return ir_instr_create(IR_OP_RET, ctx->ir.ret_type, IR_NULL_REG, ctx->ir.ret_reg, IR_NULL_REG);
+    } break;
+    case CFG_BASIC_BLOCK_NODE: { return create_jump(node->as.basic_block.next); } break;
+    case CFG_CONDITION_NODE: {
+        assert(node->as.condition.then_branch.first != CFG_NULL_NODE && node->as.condition.else_branch.first != CFG_NULL_NODE);
+
+        IRInstr instr = ir_instr_create(IR_OP_BR, IR_TYPE_BOOL, IR_NULL_REG, node->as.condition.value, IR_NULL_REG);
+        instr.as.branch.then_block = node->as.condition.then_branch.first;
+        instr.as.branch.else_block = node->as.condition.else_branch.first;
+
+        return instr;
+    } break;
+    case CFG_LOOP_ENTRY_NODE: { return create_jump(node->as.loop_entry.block.first); } break;
+    case CFG_LOOP_EXIT_NODE: { return create_jump(node->as.loop_exit.next); } break;
+    case CFG_BACKEDGE_NODE: { return create_jump(node->as.backedge.next); } break;
+    case CFG_BREAK_NODE: { return create_jump(node->as.break_.next); } break;
+    case CFG_RETURN_NODE: { return create_jump(node->as.return_.next); } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    return ir_instr_create(IR_OP_NOP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+}
+
+// The successors are only known once the whole function is chained, so the terminators are added last,
+// except in the blocks of short-circuit evaluations, which are terminated by the lowering.
+// The instruction pool is rebuilt block by block on the way, which also makes it ordered by block id.
+static void append_cfg_terminators(CFGContext* ctx) {
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    Vector instrs = vector_create(ctx->ir.instrs.items_count + nodes_count + 1, sizeof(IRInstr), NULL, false);
+
+    for (u32 id = 0; id < nodes_count; ++id) {
+        CFGNode* node = CFG_NODE(id);
+        const u32 begin = (u32)instrs.items_count;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            vector_push_back(&instrs, ir_function_get_instr(&ctx->ir, node->instrs_begin + i));
+        }
+
+        if (cfg_context_get_terminator(ctx, id) == NULL) {
+            const IRInstr terminator = create_cfg_node_terminator(ctx, node);
+            vector_push_back(&instrs, &terminator);
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&ctx->ir.instrs);
+    ctx->ir.instrs = instrs;
+}
+
+// When the lowering of a node splits it, the node keeps the start of the evaluation, which is what gets jumped to,
+// and the block the evaluation ended in takes over its kind and payload, so the terminator derived from them comes last.
+static void move_cfg_node_kind(CFGContext* ctx, const u32 head, const u32 tail) {
+    if (head == tail) {
+        return;
+    }
+
+    CFGNode* head_node = CFG_NODE(head);
+    CFGNode* tail_node = CFG_NODE(tail);
+    tail_node->kind = head_node->kind;
+    tail_node->as = head_node->as;
+
+    head_node->kind = CFG_BASIC_BLOCK_NODE;
+    head_node->as.basic_block.next = CFG_NULL_NODE;
+}
+
+static void prepend_cfg_node(CFGContext* ctx, const u32 node, u32* first, u32* last) {
+    if (*first == CFG_NULL_NODE) {
+        *last = node;
+    }
+    else {
+        chain_cfg_nodes(ctx, node, *first);
+    }
+    *first = node;
+}
+
+// Returns the node holding the payload of the condition, CFG_NULL_NODE on failure.
+// A short-circuit condition branches to the targets itself, the node keeps its payload only for the chaining
+// and an unknown target gets an empty block the caller puts in front of the branch. Any other condition is
+// left in *value for the terminator derived from the payload.
+static u32 lower_cfg_condition(CFGContext* ctx, const u32 condition, const ASTNode* expr, u32* then_target, u32* else_target, u32* value) {
+    u32 block = condition;
+    *value = IR_NULL_REG;
+
+    if (is_short_circuit_expr(expr)) {
+        return lower_condition_to_ir(ctx, &block, expr, then_target, else_target) ? condition : CFG_NULL_NODE;
+    }
+
+    *value = lower_expression_to_ir(ctx, &block, expr);
+    if (*value == IR_NULL_REG) {
+        return CFG_NULL_NODE;
+    }
+
+    move_cfg_node_kind(ctx, condition, block);
+    return block;
+}
+
+u32 build_cfg_for_function(CFGContext* ctx, const ASTNode* ast) {
     assert(ctx != NULL && ast != NULL);
 
-    CFGNode* func_entry = cfg_context_create_cfg_node(ctx, CFG_FUNC_ENTRY_NODE);
-    CFGNode* func_exit = cfg_context_create_cfg_node(ctx, CFG_FUNC_EXIT_NODE);
+    const u32 func_entry = cfg_context_create_cfg_node(ctx, CFG_FUNC_ENTRY_NODE);
+    const u32 func_exit = cfg_context_create_cfg_node(ctx, CFG_FUNC_EXIT_NODE);
 
     cfg_context_enter_scope(ctx, CFG_FUNCTION_SCOPE);
 
-    ctx->curr_scope->return_node = func_exit;
+    cfg_context_get_curr_scope(ctx)->return_node = func_exit;
+
+    if (!lower_funcsign_to_ir(ctx, func_entry, ast->as.funcdef->funcsign)) {
+        return CFG_NULL_NODE;
+    }
+
+    u32 first = CFG_NULL_NODE;
+    u32 last = CFG_NULL_NODE;
 
     const Vector* stmts = &ast->as.funcdef->stmts;
-    if (!build_cfg_for_statements_block(ctx, stmts, &func_entry->as.func_entry->block.first, &func_entry->as.func_entry->block.last)) {
-        return false;
+    if (!build_cfg_for_statements_block(ctx, stmts, &first, &last)) {
+        return CFG_NULL_NODE;
     }
 
     cfg_context_leave_scope(ctx);
 
-    if (func_entry->as.func_entry->block.first == NULL) {
-        func_entry->as.func_entry->block.first = func_exit;
+    if (first == CFG_NULL_NODE) {
+        first = func_exit;
+    }
+    else {
+        last = chain_cfg_nodes(ctx, last, func_exit);
     }
-    func_entry->as.func_entry->block.last = chain_cfg_nodes(func_entry->as.func_entry->block.last, func_exit);
+
+    CFG_NODE(func_entry)->as.func_entry.block.first = first;
+    CFG_NODE(func_entry)->as.func_entry.block.last = last == CFG_NULL_NODE ? func_exit : last;
+
+    append_cfg_terminators(ctx);
+    cfg_context_build_graph(ctx, func_entry);
 
     return func_entry;
 }
 
-bool build_cfg_for_statements_block(CFGContext* ctx, const Vector* block, CFGNode** first, CFGNode** last) {
+bool build_cfg_for_statements_block(CFGContext* ctx, const Vector* block, u32* first, u32* last) {
     assert(ctx != NULL && block != NULL && first != NULL && last != NULL);
 
     for (u64 i = 0; i < block->items_count; ++i) {
@@ -48,7 +195,7 @@ bool build_cfg_for_statements_block(CFGContext* ctx, const Vector* block, CFGNod
     return true;
 }
 
-bool build_cfg_for_statement(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool build_cfg_for_statement(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
     switch (ast->kind) {
@@ -68,34 +215,46 @@ bool build_cfg_for_statement(CFGContext* ctx, const ASTNode* ast, CFGNode** firs
     return true;
 }
 
-bool prepare_basic_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool prepare_basic_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    if (*last == NULL) {
-        CFGNode* cfg = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+    if (*last == CFG_NULL_NODE) {
+        const u32 cfg = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
         *first = cfg;
         *last = cfg;
     }
-    else if ((*last)->kind != CFG_BASIC_BLOCK_NODE) {
-        CFGNode* cfg = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
-        *last = chain_cfg_nodes(*last, cfg);
+    else if (CFG_NODE(*last)->kind != CFG_BASIC_BLOCK_NODE) {
+        const u32 cfg = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+        *last = chain_cfg_nodes(ctx, *last, cfg);
     }
 
-    return true;
+    return lower_statement_to_ir(ctx, last, ast);
 }
 
-bool prepare_condition_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool prepare_condition_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    const ASTNode* expr = ast->as.condition_stmt->expr;
+    const u32 condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
+
+    u32 then_target = CFG_NULL_NODE;
+    u32 else_target = CFG_NULL_NODE;
+    u32 value = IR_NULL_REG;
+
+    const u32 tail = lower_cfg_condition(ctx, condition, ast->as.condition_stmt->expr, &then_target, &else_target, &value);
+    if (tail == CFG_NULL_NODE) {
+        return false;
+    }
 
-    CFGNode* condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
+    u32 then_first = CFG_NULL_NODE;
+    u32 then_last = CFG_NULL_NODE;
+    u32 else_first = CFG_NULL_NODE;
+    u32 else_last = CFG_NULL_NODE;
 
     // THEN BRANCH
     cfg_context_enter_scope(ctx, CFG_BASIC_SCOPE);
 
     const Vector* stmts = &ast->as.condition_stmt->then_branch;
-    if (!build_cfg_for_statements_block(ctx, stmts, &condition->as.condition->then_branch.first, &condition->as.condition->then_branch.last)) {
+    if (!build_cfg_for_statements_block(ctx, stmts, &then_first, &then_last)) {
         return false;
     }
 
@@ -105,185 +264,238 @@ bool prepare_condition_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** f
     cfg_context_enter_scope(ctx, CFG_BASIC_SCOPE);
 
     stmts = &ast->as.condition_stmt->else_branch;
-    if (!build_cfg_for_statements_block(ctx, stmts, &condition->as.condition->else_branch.first, &condition->as.condition->else_branch.last)) {
+    if (!build_cfg_for_statements_block(ctx, stmts, &else_first, &else_last)) {
         return false;
     }
 
     cfg_context_leave_scope(ctx);
 
-    if (*first == NULL) {
+    if (then_target != CFG_NULL_NODE) {
+        prepend_cfg_node(ctx, then_target, &then_first, &then_last);
+    }
+    if (else_target != CFG_NULL_NODE) {
+        prepend_cfg_node(ctx, else_target, &else_first, &else_last);
+    }
+
+    CFGNode* node = CFG_NODE(tail);
+    node->as.condition.value = value;
+    node->as.condition.then_branch.first = then_first;
+    node->as.condition.then_branch.last = then_last;
+    node->as.condition.else_branch.first = else_first;
+    node->as.condition.else_branch.last = else_last;
+
+    if (*first == CFG_NULL_NODE) {
         *first = condition;
     }
-    *last = chain_cfg_nodes(*last, condition);
+    chain_cfg_nodes(ctx, *last, condition);
+    *last = tail;
 
     return true;
 }
 
-bool prepare_while_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool prepare_while_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    const ASTNode* expr = ast->as.condition_stmt->expr;
+    const u32 loop_entry = cfg_context_create_cfg_node(ctx, CFG_LOOP_ENTRY_NODE);
+    const u32 loop_exit = cfg_context_create_cfg_node(ctx, CFG_LOOP_EXIT_NODE);
+    const u32 condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
+
+    u32 then_target = CFG_NULL_NODE;
+    u32 else_target = loop_exit;
+    u32 value = IR_NULL_REG;
+
+    const u32 tail = lower_cfg_condition(ctx, condition, ast->as.while_stmt->expr, &then_target, &else_target, &value);
+    if (tail == CFG_NULL_NODE) {
+        return false;
+    }
 
-    CFGNode* loop_entry = cfg_context_create_cfg_node(ctx, CFG_LOOP_ENTRY_NODE);
-    CFGNode* loop_exit = cfg_context_create_cfg_node(ctx, CFG_LOOP_EXIT_NODE);
-    CFGNode* condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
+    u32 then_first = CFG_NULL_NODE;
+    u32 then_last = CFG_NULL_NODE;
 
     // THEN BRANCH
     cfg_context_enter_scope(ctx, CFG_LOOP_SCOPE);
 
-    ctx->curr_scope->break_node = loop_exit;
-    ctx->curr_scope->backedge_node = condition;
+    cfg_context_get_curr_scope(ctx)->break_node = loop_exit;
+    cfg_context_get_curr_scope(ctx)->backedge_node = condition;
 
     const Vector* stmts = &ast->as.while_stmt->stmts;
-    if (!build_cfg_for_statements_block(ctx, stmts, &condition->as.condition->then_branch.first, &condition->as.condition->then_branch.last)) {
+    if (!build_cfg_for_statements_block(ctx, stmts, &then_first, &then_last)) {
         return false;
     }
 
     // ADD BACKEDGE
-    if (condition->as.condition->then_branch.last == NULL) {
-        CFGNode* backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
-        condition->as.condition->then_branch.first = backedge;
-        condition->as.condition->then_branch.last = backedge;
-        backedge->as.backedge->next = condition;
+    if (then_last == CFG_NULL_NODE) {
+        const u32 backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
+        then_first = backedge;
+        then_last = backedge;
+        CFG_NODE(backedge)->as.backedge.next = condition;
     }
-    else if (condition->as.condition->then_branch.last->kind != CFG_BREAK_NODE && condition->as.condition->then_branch.last->kind != CFG_BACKEDGE_NODE) {
-        CFGNode* backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
-        condition->as.condition->then_branch.last = chain_cfg_nodes(condition->as.condition->then_branch.last, backedge);
-        backedge->as.backedge->next = condition;
+    else if (!is_jump_cfg_node(ctx, then_last)) {
+        const u32 backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
+        then_last = chain_cfg_nodes(ctx, then_last, backedge);
+        CFG_NODE(backedge)->as.backedge.next = condition;
     }
 
     cfg_context_leave_scope(ctx);
 
-    condition->as.condition->else_branch.first = loop_exit;
-    condition->as.condition->else_branch.last = loop_exit;
+    if (then_target != CFG_NULL_NODE) {
+        prepend_cfg_node(ctx, then_target, &then_first, &then_last);
+    }
 
-    loop_entry->as.loop_entry->block.first = condition;
-    loop_entry->as.loop_entry->block.last = condition;
-    loop_entry->as.loop_entry->exit = loop_exit;
+    CFGNode* node = CFG_NODE(tail);
+    node->as.condition.value = value;
+    node->as.condition.then_branch.first = then_first;
+    node->as.condition.then_branch.last = then_last;
+    node->as.condition.else_branch.first = loop_exit;
+    node->as.condition.else_branch.last = loop_exit;
 
-    if (*first == NULL) {
+    node = CFG_NODE(loop_entry);
+    node->as.loop_entry.block.first = condition;
+    node->as.loop_entry.block.last = tail;
+    node->as.loop_entry.exit = loop_exit;
+
+    if (*first == CFG_NULL_NODE) {
         *first = loop_entry;
     }
-    *last = chain_cfg_nodes(*last, loop_entry);
+    *last = chain_cfg_nodes(ctx, *last, loop_entry);
 
     return true;
 }
 
-bool prepare_do_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool prepare_do_loop_cfg_node(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    const ASTNode* expr = ast->as.condition_stmt->expr;
+    const u32 loop_entry = cfg_context_create_cfg_node(ctx, CFG_LOOP_ENTRY_NODE);
+    const u32 loop_exit = cfg_context_create_cfg_node(ctx, CFG_LOOP_EXIT_NODE);
+    const u32 condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
 
-    CFGNode* loop_entry = cfg_context_create_cfg_node(ctx, CFG_LOOP_ENTRY_NODE);
-    CFGNode* loop_exit = cfg_context_create_cfg_node(ctx, CFG_LOOP_EXIT_NODE);
-    CFGNode* condition = cfg_context_create_cfg_node(ctx, CFG_CONDITION_NODE);
+    u32 block_first = CFG_NULL_NODE;
+    u32 block_last = CFG_NULL_NODE;
 
     // THEN BRANCH
     cfg_context_enter_scope(ctx, CFG_LOOP_SCOPE);
 
-    ctx->curr_scope->break_node = loop_exit;
-    ctx->curr_scope->backedge_node = condition;
+    cfg_context_get_curr_scope(ctx)->break_node = loop_exit;
+    cfg_context_get_curr_scope(ctx)->backedge_node = condition;
 
     const Vector* stmts = &ast->as.do_while_stmt->stmts;
-    if (!build_cfg_for_statements_block(ctx, stmts, &loop_entry->as.loop_entry->block.first, &loop_entry->as.loop_entry->block.last)) {
+    if (!build_cfg_for_statements_block(ctx, stmts, &block_first, &block_last)) {
         return false;
     }
 
     // ADD BACKEDGE
-    CFGNode* backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
+    const u32 backedge = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
+
+    // 'loop until' leaves the loop when the condition is true.
+    const bool is_until = ast->as.do_while_stmt->is_until;
+
+    // The condition is evaluated after the body.
+    u32 then_target = is_until ? loop_exit : backedge;
+    u32 else_target = is_until ? backedge : loop_exit;
+    u32 value = IR_NULL_REG;
 
-    condition->as.condition->else_branch.first = loop_exit;
-    condition->as.condition->else_branch.last = loop_exit;
-    condition->as.condition->then_branch.first = backedge;
-    condition->as.condition->then_branch.last = backedge;
+    const u32 tail = lower_cfg_condition(ctx, condition, ast->as.do_while_stmt->expr, &then_target, &else_target, &value);
+    if (tail == CFG_NULL_NODE) {
+        return false;
+    }
+
+    CFGNode* node = CFG_NODE(tail);
+    node->as.condition.value = value;
+    node->as.condition.else_branch.first = is_until ? backedge : loop_exit;
+    node->as.condition.else_branch.last = is_until ? backedge : loop_exit;
+    node->as.condition.then_branch.first = is_until ? loop_exit : backedge;
+    node->as.condition.then_branch.last = is_until ? loop_exit : backedge;
 
     cfg_context_leave_scope(ctx);
-    if (loop_entry->as.loop_entry->block.first == NULL) {
-        loop_entry->as.loop_entry->block.first = condition;
-        loop_entry->as.loop_entry->block.last = condition;
+
+    // An empty body must not chain the condition onto itself.
+    if (block_first == CFG_NULL_NODE) {
+        block_first = condition;
+        block_last = condition;
+    }
+    else {
+        chain_cfg_nodes(ctx, block_last, condition);
     }
-    loop_entry->as.loop_entry->block.last = chain_cfg_nodes(loop_entry->as.loop_entry->block.last, condition);
-    backedge->as.backedge->next = loop_entry->as.loop_entry->block.first;
+    block_last = tail;
+    CFG_NODE(backedge)->as.backedge.next = block_first;
 
-    loop_entry->as.loop_entry->exit = loop_exit;
+    node = CFG_NODE(loop_entry);
+    node->as.loop_entry.block.first = block_first;
+    node->as.loop_entry.block.last = block_last;
+    node->as.loop_entry.exit = loop_exit;
 
-    if (*first == NULL) {
+    if (*first == CFG_NULL_NODE) {
         *first = loop_entry;
     }
-    *last = chain_cfg_nodes(*last, loop_entry);
+    *last = chain_cfg_nodes(ctx, *last, loop_entry);
 
     return true;
 }
 
-bool handle_break_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool handle_break_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    CFGScope* scope_it = ctx->curr_scope;
-    while (scope_it != NULL && scope_it->kind != CFG_LOOP_SCOPE) {
-        scope_it = scope_it->prev;
-    }
-
-    if (scope_it == NULL) {
+    const u32 scope_it = find_enclosing_scope(ctx, CFG_LOOP_SCOPE);
+    if (scope_it == CFG_NULL_SCOPE) {
         if (ctx->diag != NULL) {
             diagnostic_engine_report(ctx->diag, ERR_INVALID_BREAK_USAGE, ast->loc);
         }
         return false;
     }
 
-    CFGNode* cfg = cfg_context_create_cfg_node(ctx, CFG_BREAK_NODE);
-    cfg->as.break_->next = scope_it->break_node;
+    const u32 cfg = cfg_context_create_cfg_node(ctx, CFG_BREAK_NODE);
+    CFG_NODE(cfg)->as.break_.next = cfg_context_get_scope(ctx, scope_it)->break_node;
 
-    if (*first == NULL) {
+    if (*first == CFG_NULL_NODE) {
         *first = cfg;
     }
-    *last = chain_cfg_nodes(*last, cfg);
+    *last = chain_cfg_nodes(ctx, *last, cfg);
 
     return true;
 }
 
-bool handle_continue_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool handle_continue_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    CFGScope* scope_it = ctx->curr_scope;
-    while (scope_it != NULL && scope_it->kind != CFG_LOOP_SCOPE) {
-        scope_it = scope_it->prev;
-    }
-
-    if (scope_it == NULL) {
+    const u32 scope_it = find_enclosing_scope(ctx, CFG_LOOP_SCOPE);
+    if (scope_it == CFG_NULL_SCOPE) {
         if (ctx->diag != NULL) {
             diagnostic_engine_report(ctx->diag, ERR_INVALID_CONTINUE_USAGE, ast->loc);
         }
         return false;
     }
 
-    CFGNode* cfg = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
-    cfg->as.backedge->next = scope_it->backedge_node;
+    const u32 cfg = cfg_context_create_cfg_node(ctx, CFG_BACKEDGE_NODE);
+    CFG_NODE(cfg)->as.backedge.next = cfg_context_get_scope(ctx, scope_it)->backedge_node;
 
-    if (*first == NULL) {
+    if (*first == CFG_NULL_NODE) {
         *first = cfg;
     }
-    *last = chain_cfg_nodes(*last, cfg);
+    *last = chain_cfg_nodes(ctx, *last, cfg);
 
     return true;
 }
 
-bool handle_return_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, CFGNode** first, CFGNode** last) {
+bool handle_return_stmt_in_cfg(CFGContext* ctx, const ASTNode* ast, u32* first, u32* last) {
     assert(ctx != NULL && ast != NULL && first != NULL && last != NULL);
 
-    CFGScope* scope_it = ctx->curr_scope;
-    while (scope_it != NULL && scope_it->kind != CFG_FUNCTION_SCOPE) {
-        scope_it = scope_it->prev;
-    }
+    const u32 scope_it = find_enclosing_scope(ctx, CFG_FUNCTION_SCOPE);
+    assert(scope_it != CFG_NULL_SCOPE && "WTF");
 
-    assert(scope_it != NULL && "WTF");
+    const u32 cfg = cfg_context_create_cfg_node(ctx, CFG_RETURN_NODE);
+    CFG_NODE(cfg)->as.return_.next = cfg_context_get_scope(ctx, scope_it)->return_node;
 
-    CFGNode* cfg = cfg_context_create_cfg_node(ctx, CFG_RETURN_NODE);
-    cfg->as.return_->next = scope_it->return_node;
+    u32 block = cfg;
+    if (!lower_return_to_ir(ctx, &block, ast)) {
+        return false;
+    }
+    move_cfg_node_kind(ctx, cfg, block);
 
-    if (*first == NULL) {
+    if (*first == CFG_NULL_NODE) {
         *first = cfg;
     }
-    *last = chain_cfg_nodes(*last, cfg);
+    chain_cfg_nodes(ctx, *last, cfg);
+    *last = block;
 
     return true;
 }
\ No newline at end of file
@@ -3,15 +3,23 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "vanec/utils/string_utils.h"
+
 CFGContext* cfg_context_create(DiagnosticEngine* diag) {
     CFGContext* ctx = malloc(sizeof(CFGContext));
     assert(ctx != NULL);
 
     ctx->diag = diag;
-    ctx->curr_scope = NULL;
+    ctx->curr_scope = CFG_NULL_SCOPE;
+
+    ctx->nodes = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(CFGNode), NULL, false);
+    ctx->scopes = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(CFGScope), NULL, false);
+    ctx->symbols = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(CFGSymbol), NULL, false);
 
-    ctx->nodes = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(CFGNode*), &cfg_node_free, true);
-    ctx->scopes = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(CFGScope*), &cfg_scope_free, true);
+    ctx->ir = ir_function_create();
+    ctx->graph = cfg_graph_create();
+    ctx->dom_tree = dominator_tree_create();
+    ctx->loops = loop_forest_create();
 
     return ctx;
 }
@@ -21,6 +29,12 @@ void cfg_context_free(CFGContext* ctx) {
         return;
     }
 
+    loop_forest_free(&ctx->loops);
+    dominator_tree_free(&ctx->dom_tree);
+    cfg_graph_free(&ctx->graph);
+    ir_function_free(&ctx->ir);
+
+    vector_free(&ctx->symbols);
     vector_free(&ctx->scopes);
     vector_free(&ctx->nodes);
     free(ctx);
@@ -29,34 +43,237 @@ void cfg_context_free(CFGContext* ctx) {
 void cfg_context_clear(CFGContext* ctx) {
     assert(ctx != NULL);
 
+    vector_clear(&ctx->symbols);
     vector_clear(&ctx->scopes);
     vector_clear(&ctx->nodes);
+
+    ir_function_clear(&ctx->ir);
+    cfg_graph_clear(&ctx->graph);
+    dominator_tree_clear(&ctx->dom_tree);
+    loop_forest_clear(&ctx->loops);
+
+    ctx->curr_scope = CFG_NULL_SCOPE;
 }
 
 void cfg_context_enter_scope(CFGContext* ctx, const CFGScopeKind kind) {
     assert(ctx != NULL);
 
-    CFGScope* scope = cfg_scope_create(kind, ctx->curr_scope);
+    CFGScope scope = cfg_scope_create(kind, ctx->curr_scope, (u32)ctx->symbols.items_count);
     vector_push_back(&ctx->scopes, &scope);
 
-    ctx->curr_scope = scope;
+    ctx->curr_scope = (u32)(ctx->scopes.items_count - 1);
 }
 
 void cfg_context_leave_scope(CFGContext* ctx) {
     assert(ctx != NULL);
 
-    if (ctx->curr_scope == NULL) {
+    if (ctx->curr_scope == CFG_NULL_SCOPE) {
         return;
     }
 
-    ctx->curr_scope = ctx->curr_scope->prev;
+    const CFGScope* scope = cfg_context_get_curr_scope(ctx);
+
+    ctx->symbols.items_count = scope->symbols_count;
+    ctx->curr_scope = scope->prev;
 }
 
-CFGNode* cfg_context_create_cfg_node(CFGContext* ctx, const CFGNodeKind kind) {
+u32 cfg_context_create_cfg_node(CFGContext* ctx, const CFGNodeKind kind) {
     assert(ctx != NULL);
 
-    CFGNode* node = cfg_node_create(kind, (u32)ctx->nodes.items_count, ctx->curr_scope);
+    const u32 id = (u32)ctx->nodes.items_count;
+
+    CFGNode node = cfg_node_create(kind, id, ctx->curr_scope);
     vector_push_back(&ctx->nodes, &node);
 
-    return node;
+    return id;
+}
+
+CFGNode* cfg_context_get_node(const CFGContext* ctx, const u32 id) {
+    assert(ctx != NULL && id != CFG_NULL_NODE);
+
+    return vector_get_ref(&ctx->nodes, id);
+}
+
+CFGScope* cfg_context_get_scope(const CFGContext* ctx, const u32 id) {
+    assert(ctx != NULL && id != CFG_NULL_SCOPE);
+
+    return vector_get_ref(&ctx->scopes, id);
+}
+
+CFGScope* cfg_context_get_curr_scope(const CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    return ctx->curr_scope == CFG_NULL_SCOPE ? NULL : cfg_context_get_scope(ctx, ctx->curr_scope);
+}
+
+u32 cfg_context_get_nodes_count(const CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    return (u32)ctx->nodes.items_count;
+}
+
+void cfg_context_emit_instr(CFGContext* ctx, const u32 block, const IRInstr* instr) {
+    assert(ctx != NULL && instr != NULL);
+
+    CFGNode* node = cfg_context_get_node(ctx, block);
+    const u32 count = ir_function_get_instrs_count(&ctx->ir);
+
+    if (node->instrs_count == 0) {
+        node->instrs_begin = count;
+    }
+    assert(node->instrs_begin + node->instrs_count == count && "The block is not the last one being filled.");
+
+    vector_push_back(&ctx->ir.instrs, instr);
+    ++node->instrs_count;
+}
+
+IRInstr* cfg_context_get_instr(const CFGContext* ctx, const u32 block, const u32 index) {
+    assert(ctx != NULL);
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    assert(index < node->instrs_count);
+
+    return ir_function_get_instr(&ctx->ir, node->instrs_begin + index);
+}
+
+IRInstr* cfg_context_get_terminator(const CFGContext* ctx, const u32 block) {
+    assert(ctx != NULL);
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    if (node->instrs_count == 0) {
+        return NULL;
+    }
+
+    IRInstr* instr = ir_function_get_instr(&ctx->ir, node->instrs_begin + node->instrs_count - 1);
+    return is_ir_opcode_terminator(instr->op) ? instr : NULL;
+}
+
+void cfg_context_declare_symbol(CFGContext* ctx, const char* name, const u32 reg) {
+    assert(ctx != NULL && name != NULL);
+
+    CFGSymbol symbol = {
+        .name = name,
+        .reg = reg,
+    };
+    vector_push_back(&ctx->symbols, &symbol);
+}
+
+u32 cfg_context_find_symbol(const CFGContext* ctx, const char* name) {
+    assert(ctx != NULL && name != NULL);
+
+    // Backwards, so the innermost declaration shadows the outer ones.
+    for (u64 i = ctx->symbols.items_count; i > 0; --i) {
+        const CFGSymbol* symbol = vector_get_ref(&ctx->symbols, i - 1);
+        if (str_eq(symbol->name, name)) {
+            return symbol->reg;
+        }
+    }
+
+    return IR_NULL_REG;
+}
+
+void cfg_context_build_graph(CFGContext* ctx, const u32 entry) {
+    assert(ctx != NULL);
+
+    cfg_graph_build(&ctx->graph, (const CFGNode*)ctx->nodes.items, cfg_context_get_nodes_count(ctx), &ctx->ir, entry);
+}
+
+const DominatorTree* cfg_context_get_dominator_tree(CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    if (!is_dominator_tree_valid(&ctx->dom_tree, &ctx->graph)) {
+        dominator_tree_build(&ctx->dom_tree, &ctx->graph);
+    }
+    return &ctx->dom_tree;
+}
+
+const LoopForest* cfg_context_get_loop_forest(CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    if (!is_loop_forest_valid(&ctx->loops, &ctx->graph)) {
+        loop_forest_build(&ctx->loops, &ctx->graph, cfg_context_get_dominator_tree(ctx));
+    }
+    return &ctx->loops;
+}
+
+static bool is_jump_cfg_node(const CFGContext* ctx, const u32 id) {
+    const CFGNodeKind kind = cfg_context_get_node(ctx, id)->kind;
+    return kind == CFG_BACKEDGE_NODE || kind == CFG_BREAK_NODE;
+}
+
+u32 chain_cfg_nodes(CFGContext* ctx, const u32 prev, const u32 next) {
+    assert(ctx != NULL);
+
+    if (prev == CFG_NULL_NODE) {
+        return next;
+    }
+
+    CFGNode* node = cfg_context_get_node(ctx, prev);
+
+    switch (node->kind) {
+    case CFG_FUNC_ENTRY_NODE: {
+        if (node->as.func_entry.block.next == CFG_NULL_NODE) {
+            node->as.func_entry.block.next = next;
+        }
+        else {
+            chain_cfg_nodes(ctx, node->as.func_entry.block.last, next);
+        }
+    } break;
+    case CFG_FUNC_EXIT_NODE: {
+        assert(false && "It is not possible to add any node after function exit node.");
+    } break;
+    case CFG_BASIC_BLOCK_NODE: {
+        if (node->as.basic_block.next == CFG_NULL_NODE) {
+            node->as.basic_block.next = next;
+        }
+        else {
+            chain_cfg_nodes(ctx, node->as.basic_block.next, next);
+        }
+    } break;
+    case CFG_CONDITION_NODE: {
+        if (node->as.condition.then_branch.next == CFG_NULL_NODE) {
+            node->as.condition.then_branch.last = node->as.condition.then_branch.next = next;
+        }
+        else if (!is_jump_cfg_node(ctx, node->as.condition.then_branch.last)) {
+            chain_cfg_nodes(ctx, node->as.condition.then_branch.last, next);
+        }
+        //
+        if (node->as.condition.else_branch.next == CFG_NULL_NODE) {
+            node->as.condition.else_branch.last = node->as.condition.else_branch.next = next;
+        }
+        else if (!is_jump_cfg_node(ctx, node->as.condition.else_branch.last)) {
+            chain_cfg_nodes(ctx, node->as.condition.else_branch.last, next);
+        }
+    } break;
+    case CFG_LOOP_ENTRY_NODE: {
+        if (node->as.loop_entry.exit == CFG_NULL_NODE) {
+            node->as.loop_entry.exit = next;
+        }
+        else {
+            chain_cfg_nodes(ctx, node->as.loop_entry.exit, next);
+        }
+    } break;
+    case CFG_LOOP_EXIT_NODE: {
+        if (node->as.loop_exit.next == CFG_NULL_NODE) {
+            node->as.loop_exit.next = next;
+        }
+        else {
+            chain_cfg_nodes(ctx, node->as.loop_exit.next, next);
+        }
+    } break;
+    case CFG_BACKEDGE_NODE: {
+        /* DO NOTHING, CAUSE IT'S DONE MANUALY */
+    } break;
+    case CFG_BREAK_NODE: {
+        /* DO NOTHING, CAUSE IT'S DONE MANUALY */
+    } break;
+    case CFG_RETURN_NODE: {
+        /* DO NOTHING, CAUSE IT'S DONE MANUALY */
+    } break;
+    default: {
+        assert(false && "Unknown node kind.");
+    } break;
+    };
+
+    return next;
 }
\ No newline at end of file
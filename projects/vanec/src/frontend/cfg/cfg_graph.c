@@ -0,0 +1,296 @@
+#include "vanec/frontend/cfg/cfg_graph.h"
+
+#include <assert.h>
+#include <string.h>
+
+CFGGraph cfg_graph_create(void) {
+    return (CFGGraph) {
+        .succ_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .succs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .pred_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .preds = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .succ_pred_index = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .post_order = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .rpo = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .rpo_index = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .marks = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .epoch = 0,
+        .entry = CFG_NULL_NODE,
+        .version = 0,
+    };
+}
+
+void cfg_graph_free(CFGGraph* graph) {
+    if (graph == NULL) {
+        return;
+    }
+
+    vector_free(&graph->succ_offsets);
+    vector_free(&graph->succs);
+    vector_free(&graph->pred_offsets);
+    vector_free(&graph->preds);
+    vector_free(&graph->succ_pred_index);
+    vector_free(&graph->post_order);
+    vector_free(&graph->rpo);
+    vector_free(&graph->rpo_index);
+    vector_free(&graph->marks);
+    vector_free(&graph->stack);
+}
+
+void cfg_graph_clear(CFGGraph* graph) {
+    assert(graph != NULL);
+
+    vector_clear(&graph->succ_offsets);
+    vector_clear(&graph->succs);
+    vector_clear(&graph->pred_offsets);
+    vector_clear(&graph->preds);
+    vector_clear(&graph->succ_pred_index);
+    vector_clear(&graph->post_order);
+    vector_clear(&graph->rpo);
+    vector_clear(&graph->rpo_index);
+    vector_clear(&graph->marks);
+    vector_clear(&graph->stack);
+
+    graph->epoch = 0;
+    graph->entry = CFG_NULL_NODE;
+}
+
+static u32 get_node_succs(const CFGNode* node, const IRFunction* ir, u32 succs[2]) {
+    if (node->instrs_count == 0) {
+        return 0;
+    }
+
+    const IRInstr* terminator = ir_function_get_instr(ir, node->instrs_begin + node->instrs_count - 1);
+    switch (terminator->op) {
+    case IR_OP_JMP: {
+        succs[0] = terminator->as.target;
+        return 1;
+    } break;
+    case IR_OP_BR: {
+        succs[0] = terminator->as.branch.then_block;
+        succs[1] = terminator->as.branch.else_block;
+        return 2;
+    } break;
+    default: {
+        return 0;
+    } break;
+    };
+}
+
+static void build_succs(CFGGraph* graph, const CFGNode* nodes, const u32 nodes_count, const IRFunction* ir) {
+    u32* offsets = vector_resize(&graph->succ_offsets, nodes_count + 1);
+    vector_reserve(&graph->succs, nodes_count * 2);
+    graph->succs.items_count = 0;
+
+    offsets[0] = 0;
+    for (u32 id = 0; id < nodes_count; ++id) {
+        u32 succs[2] = { 0 };
+        const u32 count = get_node_succs(&nodes[id], ir, succs);
+
+        for (u32 i = 0; i < count; ++i) {
+            vector_push_back(&graph->succs, &succs[i]);
+        }
+        offsets[id + 1] = offsets[id] + count;
+    }
+}
+
+// Iterative, so deeply nested functions can not exhaust the stack.
+static void build_orders(CFGGraph* graph, const u32 nodes_count) {
+    u32* rpo_index = vector_resize(&graph->rpo_index, nodes_count);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        rpo_index[id] = CFG_NULL_NODE;
+    }
+
+    vector_clear(&graph->post_order);
+    vector_clear(&graph->stack);
+
+    cfg_graph_begin_visit(graph);
+    cfg_graph_mark_visited(graph, graph->entry);
+
+    const u32 zero = 0;
+    vector_push_back(&graph->stack, &graph->entry);
+    vector_push_back(&graph->stack, &zero);
+
+    while (graph->stack.items_count > 0) {
+        u32* top = (u32*)graph->stack.items + graph->stack.items_count - 2;
+        const u32 id = top[0];
+
+        u32 count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, id, &count);
+
+        if (top[1] == count) {
+            vector_push_back(&graph->post_order, &id);
+            graph->stack.items_count -= 2;
+            continue;
+        }
+
+        const u32 succ = succs[top[1]++];
+        if (cfg_graph_mark_visited(graph, succ)) {
+            vector_push_back(&graph->stack, &succ);
+            vector_push_back(&graph->stack, &zero);
+        }
+    }
+
+    const u32 reachable_count = (u32)graph->post_order.items_count;
+    const u32* post_order = (const u32*)graph->post_order.items;
+    u32* rpo = vector_resize(&graph->rpo, reachable_count);
+
+    for (u32 i = 0; i < reachable_count; ++i) {
+        rpo[i] = post_order[reachable_count - 1 - i];
+        rpo_index[rpo[i]] = i;
+    }
+}
+
+// Edges leaving unreachable blocks are left out, so the analyses never see them as predecessors.
+static void build_preds(CFGGraph* graph, const u32 nodes_count) {
+    u32* offsets = vector_resize(&graph->pred_offsets, nodes_count + 1);
+    memset(offsets, 0, (nodes_count + 1) * sizeof(u32));
+
+    const u32* succ_offsets = (const u32*)graph->succ_offsets.items;
+    const u32* succs = (const u32*)graph->succs.items;
+    const u32* rpo_index = (const u32*)graph->rpo_index.items;
+
+    for (u32 id = 0; id < nodes_count; ++id) {
+        if (rpo_index[id] == CFG_NULL_NODE) {
+            continue;
+        }
+        for (u32 i = succ_offsets[id]; i < succ_offsets[id + 1]; ++i) {
+            ++offsets[succs[i] + 1];
+        }
+    }
+
+    for (u32 id = 0; id < nodes_count; ++id) {
+        offsets[id + 1] += offsets[id];
+    }
+
+    // Offsets are used as the insertion cursors and shifted back afterwards.
+    u32* preds = vector_resize(&graph->preds, offsets[nodes_count]);
+    u32* pred_index = vector_resize(&graph->succ_pred_index, graph->succs.items_count);
+    for (u32 id = 0; id < nodes_count; ++id) {
+        for (u32 i = succ_offsets[id]; i < succ_offsets[id + 1]; ++i) {
+            if (rpo_index[id] == CFG_NULL_NODE) {
+                pred_index[i] = CFG_NULL_NODE;
+                continue;
+            }
+            pred_index[i] = offsets[succs[i]];
+            preds[offsets[succs[i]]++] = id;
+        }
+    }
+
+    for (u32 id = nodes_count; id > 0; --id) {
+        offsets[id] = offsets[id - 1];
+    }
+    offsets[0] = 0;
+
+    for (u32 i = 0; i < graph->succs.items_count; ++i) {
+        if (pred_index[i] != CFG_NULL_NODE) {
+            pred_index[i] -= offsets[succs[i]];
+        }
+    }
+}
+
+void cfg_graph_build(CFGGraph* graph, const CFGNode* nodes, const u32 nodes_count, const IRFunction* ir, const u32 entry) {
+    assert(graph != NULL && nodes != NULL && ir != NULL);
+    assert(entry < nodes_count);
+
+    graph->entry = entry;
+    ++graph->version;
+
+    // The marks are reset here, which also covers the blocks added since the previous build.
+    u32* marks = vector_resize(&graph->marks, nodes_count);
+    memset(marks, 0, nodes_count * sizeof(u32));
+    graph->epoch = 0;
+
+    build_succs(graph, nodes, nodes_count, ir);
+    build_orders(graph, nodes_count);
+    build_preds(graph, nodes_count);
+}
+
+u32 cfg_graph_get_nodes_count(const CFGGraph* graph) {
+    assert(graph != NULL);
+
+    return (u32)graph->rpo_index.items_count;
+}
+
+const u32* cfg_graph_get_succs(const CFGGraph* graph, const u32 id, u32* count) {
+    assert(graph != NULL && count != NULL);
+    assert(id + 1 < graph->succ_offsets.items_count);
+
+    const u32* offsets = (const u32*)graph->succ_offsets.items;
+    *count = offsets[id + 1] - offsets[id];
+
+    return (const u32*)graph->succs.items + offsets[id];
+}
+
+const u32* cfg_graph_get_preds(const CFGGraph* graph, const u32 id, u32* count) {
+    assert(graph != NULL && count != NULL);
+    assert(id + 1 < graph->pred_offsets.items_count);
+
+    const u32* offsets = (const u32*)graph->pred_offsets.items;
+    *count = offsets[id + 1] - offsets[id];
+
+    return (const u32*)graph->preds.items + offsets[id];
+}
+
+const u32* cfg_graph_get_succ_pred_indices(const CFGGraph* graph, const u32 id, u32* count) {
+    assert(graph != NULL && count != NULL);
+    assert(id + 1 < graph->succ_offsets.items_count);
+
+    const u32* offsets = (const u32*)graph->succ_offsets.items;
+    *count = offsets[id + 1] - offsets[id];
+
+    return (const u32*)graph->succ_pred_index.items + offsets[id];
+}
+
+const u32* cfg_graph_get_post_order(const CFGGraph* graph, u32* count) {
+    assert(graph != NULL && count != NULL);
+
+    *count = (u32)graph->post_order.items_count;
+    return (const u32*)graph->post_order.items;
+}
+
+const u32* cfg_graph_get_rpo(const CFGGraph* graph, u32* count) {
+    assert(graph != NULL && count != NULL);
+
+    *count = (u32)graph->rpo.items_count;
+    return (const u32*)graph->rpo.items;
+}
+
+u32 cfg_graph_get_rpo_index(const CFGGraph* graph, const u32 id) {
+    assert(graph != NULL && id < graph->rpo_index.items_count);
+
+    return ((const u32*)graph->rpo_index.items)[id];
+}
+
+bool is_cfg_node_reachable(const CFGGraph* graph, const u32 id) {
+    return cfg_graph_get_rpo_index(graph, id) != CFG_NULL_NODE;
+}
+
+void cfg_graph_begin_visit(CFGGraph* graph) {
+    assert(graph != NULL);
+
+    // Zero is never a live epoch, so on overflow the marks are reset once.
+    if (++graph->epoch == 0) {
+        memset(graph->marks.items, 0, graph->marks.items_count * sizeof(u32));
+        graph->epoch = 1;
+    }
+}
+
+bool cfg_graph_mark_visited(CFGGraph* graph, const u32 id) {
+    assert(graph != NULL && id < graph->marks.items_count);
+
+    u32* mark = (u32*)graph->marks.items + id;
+    if (*mark == graph->epoch) {
+        return false;
+    }
+
+    *mark = graph->epoch;
+    return true;
+}
+
+bool is_cfg_node_visited(const CFGGraph* graph, const u32 id) {
+    assert(graph != NULL && id < graph->marks.items_count);
+
+    return ((const u32*)graph->marks.items)[id] == graph->epoch;
+}
\ No newline at end of file
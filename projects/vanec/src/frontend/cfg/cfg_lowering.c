@@ -0,0 +1,814 @@
+#include "vanec/frontend/cfg/cfg_lowering.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "vanec/utils/string_utils.h"
+#include "vanec/utils/string_builder.h"
+
+#define INT32_MAX_VALUE ((u64)0x7FFFFFFF)
+#define INT64_MAX_VALUE ((u64)0x7FFFFFFFFFFFFFFF)
+
+static void report(CFGContext* ctx, const DiagnosticId id, const ASTNode* ast, const char* arg) {
+    if (ctx->diag != NULL) {
+        diagnostic_engine_report(ctx->diag, id, ast->loc, arg);
+    }
+}
+
+static u32 emit(CFGContext* ctx, const u32 block, const IRInstr instr) {
+    cfg_context_emit_instr(ctx, block, &instr);
+    return instr.dst;
+}
+
+static u32 create_temp(CFGContext* ctx, const IRType type) {
+    return ir_function_create_reg(&ctx->ir, type, IR_NULL_STRING);
+}
+
+static IRType get_reg_type(const CFGContext* ctx, const u32 reg) {
+    return ir_function_get_reg(&ctx->ir, reg)->type;
+}
+
+static bool is_temp_reg(const CFGContext* ctx, const u32 reg) {
+    return ir_function_get_reg(&ctx->ir, reg)->name == IR_NULL_STRING;
+}
+
+static u32 emit_const(CFGContext* ctx, const u32 block, const IRType type, const i64 value) {
+    IRInstr instr = ir_instr_create(IR_OP_CONST, type, create_temp(ctx, type), IR_NULL_REG, IR_NULL_REG);
+    instr.as.imm = value;
+    return emit(ctx, block, instr);
+}
+
+// Small integers are computed as int, like in C.
+static IRType promote_type(const IRType type) {
+    switch (type) {
+    case IR_TYPE_BOOL:
+    case IR_TYPE_BYTE:
+    case IR_TYPE_CHAR: return IR_TYPE_INT;
+    case IR_TYPE_STRING:
+    case IR_TYPE_ARRAY: return IR_TYPE_ULONG;
+    default: return type;
+    };
+}
+
+static IRType get_common_type(const IRType lhs, const IRType rhs) {
+    const IRType a = promote_type(lhs);
+    const IRType b = promote_type(rhs);
+
+    if (a == IR_TYPE_ULONG || b == IR_TYPE_ULONG) { return IR_TYPE_ULONG; }
+    if (a == IR_TYPE_LONG || b == IR_TYPE_LONG) { return IR_TYPE_LONG; }
+    if (a == IR_TYPE_UINT || b == IR_TYPE_UINT) { return IR_TYPE_UINT; }
+    return IR_TYPE_INT;
+}
+
+// Stores the value into a variable. When the value is the fresh result of the last instruction
+// of the block, that instruction is retargeted instead of emitting a copy.
+static void emit_move(CFGContext* ctx, const u32 block, const u32 dst, const u32 value) {
+    if (dst == value) {
+        return;
+    }
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    if (node->instrs_count > 0 && is_temp_reg(ctx, value)) {
+        IRInstr* last = cfg_context_get_instr(ctx, block, node->instrs_count - 1);
+
+        if (last->dst == value && !is_ir_opcode_compare(last->op) && last->type == get_reg_type(ctx, dst)) {
+            last->dst = dst;
+            return;
+        }
+    }
+
+    emit(ctx, block, ir_instr_create(IR_OP_COPY, get_reg_type(ctx, dst), dst, value, IR_NULL_REG));
+}
+
+static bool is_assignment_op(const char* op) {
+    return
+        str_eq(op, "=") || str_eq(op, "+=") || str_eq(op, "-=") ||
+        str_eq(op, "*=") || str_eq(op, "/=") || str_eq(op, "%=") ||
+        str_eq(op, "<<=") || str_eq(op, ">>=") || str_eq(op, "&=") ||
+        str_eq(op, "|=") || str_eq(op, "^=");
+}
+
+static bool is_short_circuit_op(const char* op) {
+    return str_eq(op, "&&") || str_eq(op, "||");
+}
+
+// Whether evaluating the expression may write a variable, which forces the operands
+// evaluated before it to be copied out of the variables.
+static bool is_plain_binary_expr(const ASTNode* expr) {
+    return expr->kind == AST_BINARY_EXPR_NODE && !is_assignment_op(expr->as.binary_expr->op) && !is_short_circuit_op(expr->as.binary_expr->op);
+}
+
+static bool has_assignments(const ASTNode* expr) {
+    switch (expr->kind) {
+    case AST_BINARY_EXPR_NODE: {
+        return is_assignment_op(expr->as.binary_expr->op) || has_assignments(expr->as.binary_expr->lhs) || has_assignments(expr->as.binary_expr->rhs);
+    } break;
+    case AST_UNARY_EXPR_NODE: {
+        const char* op = expr->as.unary_expr->op;
+        return str_eq(op, "++") || str_eq(op, "--") || has_assignments(expr->as.unary_expr->rhs);
+    } break;
+    case AST_BRACES_EXPR_NODE: { return has_assignments(expr->as.braces_expr->expr); } break;
+    case AST_CALL_OR_INDEXER_EXPR_NODE: {
+        const Vector* args = &expr->as.call_or_indexer_expr->args;
+        for (u64 i = 0; i < args->items_count; ++i) {
+            if (has_assignments(vector_get_ref(args, i))) {
+                return true;
+            }
+        }
+        return false;
+    } break;
+    case AST_TERNARY_EXPR_NODE: {
+        return
+            has_assignments(expr->as.ternary_expr->expr) ||
+            has_assignments(expr->as.ternary_expr->then_expr) ||
+            has_assignments(expr->as.ternary_expr->else_expr);
+    } break;
+    default: {
+        return false;
+    } break;
+    };
+}
+
+static u32 protect_operand(CFGContext* ctx, const u32 block, const u32 reg, const ASTNode* later) {
+    if (is_temp_reg(ctx, reg) || !has_assignments(later)) {
+        return reg;
+    }
+    return emit(ctx, block, ir_instr_create(IR_OP_COPY, get_reg_type(ctx, reg), create_temp(ctx, get_reg_type(ctx, reg)), reg, IR_NULL_REG));
+}
+
+IRType get_ir_type_of_typeref(CFGContext* ctx, const ASTNode* typeref, IRType* elem_type) {
+    assert(ctx != NULL);
+
+    if (elem_type != NULL) {
+        *elem_type = IR_TYPE_VOID;
+    }
+
+    if (typeref == NULL) {
+        return IR_TYPE_VOID;
+    }
+
+    switch (typeref->kind) {
+    case AST_BUILTIN_TYPEREF_NODE: {
+        const char* name = typeref->as.builtin_typeref->value;
+
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) if (str_eq(name, NAME)) { return IR_TYPE_##ID; }
+#include "vanec/ir/ir_type.def"
+    } break;
+    case AST_ARRAY_TYPEREF_NODE: {
+        const IRType type = get_ir_type_of_typeref(ctx, typeref->as.array_typeref->typeref, NULL);
+        if (type == IR_TYPE_VOID) {
+            return IR_TYPE_VOID;
+        }
+        if (elem_type != NULL) {
+            *elem_type = type;
+        }
+        return IR_TYPE_ARRAY;
+    } break;
+    case AST_CUSTOM_TYPEREF_NODE: {
+        report(ctx, ERR_UNKNOWN_TYPE, typeref, typeref->as.custom_typeref->id->as.identifier->value);
+    } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    return IR_TYPE_VOID;
+}
+
+static u32 declare_variable(CFGContext* ctx, const ASTNode* id, const IRType type, const IRType elem_type) {
+    const char* name = id->as.identifier->value;
+
+    const u32 reg = ir_function_create_reg(&ctx->ir, type, ir_function_add_string(&ctx->ir, name));
+    ir_function_get_reg(&ctx->ir, reg)->elem_type = elem_type;
+
+    cfg_context_declare_symbol(ctx, name, reg);
+
+    return reg;
+}
+
+bool lower_funcsign_to_ir(CFGContext* ctx, const u32 block, const ASTNode* funcsign) {
+    assert(ctx != NULL && funcsign != NULL);
+
+    const Vector* args = &funcsign->as.funcsign->args;
+    for (u64 i = 0; i < args->items_count; ++i) {
+        const ASTNode* arg = vector_get_ref(args, i);
+
+        IRType elem_type = IR_TYPE_VOID;
+        const IRType type = get_ir_type_of_typeref(ctx, arg->as.argdef->typeref, &elem_type);
+        if (type == IR_TYPE_VOID) {
+            if (arg->as.argdef->typeref != NULL) {
+                return false;
+            }
+            declare_variable(ctx, arg->as.argdef->id, IR_TYPE_INT, IR_TYPE_VOID);
+            continue;
+        }
+
+        declare_variable(ctx, arg->as.argdef->id, type, elem_type);
+    }
+
+    ctx->ir.params_count = (u32)args->items_count;
+    ctx->ir.ret_type = get_ir_type_of_typeref(ctx, funcsign->as.funcsign->typeref, NULL);
+
+    if (ctx->ir.ret_type != IR_TYPE_VOID) {
+        // Falling off the end of a function returns zero.
+        ctx->ir.ret_reg = emit_const(ctx, block, ctx->ir.ret_type, 0);
+    }
+    else if (funcsign->as.funcsign->typeref != NULL) {
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_integer_literal(const ASTNode* literal, u64* value) {
+    const char* s = literal->as.literal->value;
+    u64 base = 10;
+
+    switch (literal->kind) {
+    case AST_DEC_LITERAL_NODE: { base = 10; } break;
+    case AST_HEX_LITERAL_NODE: { base = 16; s += 2; } break;
+    case AST_OCT_LITERAL_NODE: { base = 8; s += 1; } break;
+    case AST_BITS_LITERAL_NODE: { base = 2; s += 2; } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    u64 result = 0;
+    for (; *s != '\0'; ++s) {
+        const char ch = *s;
+        const u64 digit =
+            is_digit(ch) ? (u64)(ch - '0') :
+            ('a' <= ch && ch <= 'f') ? (u64)(ch - 'a' + 10) :
+            (u64)(ch - 'A' + 10);
+
+        if (result > (~(u64)0 - digit) / base) {
+            return false;
+        }
+        result = result * base + digit;
+    }
+
+    *value = result;
+    return true;
+}
+
+static char unescape_char(const char ch) {
+    switch (ch) {
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case '0': return '\0';
+    default: return ch;
+    };
+}
+
+// Escapes are kept by the lexer as written and resolved once here.
+static char* unescape_literal(const char* s) {
+    StringBuilder sb = string_builder_create();
+
+    for (; *s != '\0'; ++s) {
+        if (*s == '\\' && s[1] != '\0') {
+            ++s;
+            string_builder_append_char_right(&sb, unescape_char(*s));
+            continue;
+        }
+        string_builder_append_char_right(&sb, *s);
+    }
+
+    char* result = string_builder_get_str(&sb);
+    string_builder_free(&sb);
+
+    return result;
+}
+
+static u32 lower_literal_to_ir(CFGContext* ctx, const u32 block, const ASTNode* literal) {
+    const char* value = literal->as.literal->value;
+
+    switch (literal->kind) {
+    case AST_DEC_LITERAL_NODE:
+    case AST_HEX_LITERAL_NODE:
+    case AST_OCT_LITERAL_NODE:
+    case AST_BITS_LITERAL_NODE: {
+        u64 number = 0;
+        if (!parse_integer_literal(literal, &number)) {
+            report(ctx, ERR_LITERAL_IS_OUT_OF_RANGE, literal, value);
+            return IR_NULL_REG;
+        }
+
+        const IRType type =
+            number <= INT32_MAX_VALUE ? IR_TYPE_INT :
+            number <= INT64_MAX_VALUE ? IR_TYPE_LONG :
+            IR_TYPE_ULONG;
+
+        return emit_const(ctx, block, type, (i64)number);
+    } break;
+    case AST_BOOL_LITERAL_NODE: {
+        return emit_const(ctx, block, IR_TYPE_BOOL, str_eq(value, "true") ? 1 : 0);
+    } break;
+    case AST_CHAR_LITERAL_NODE: {
+        const char ch = value[0] == '\\' ? unescape_char(value[1]) : value[0];
+        return emit_const(ctx, block, IR_TYPE_CHAR, (i64)ch);
+    } break;
+    case AST_STRING_LITERAL_NODE: {
+        char* str = unescape_literal(value);
+
+        IRInstr instr = ir_instr_create(IR_OP_STR, IR_TYPE_STRING, create_temp(ctx, IR_TYPE_STRING), IR_NULL_REG, IR_NULL_REG);
+        instr.as.str = ir_function_add_string(&ctx->ir, str);
+
+        str_free(str);
+        return emit(ctx, block, instr);
+    } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    return IR_NULL_REG;
+}
+
+static u32 lower_place_to_ir(CFGContext* ctx, const ASTNode* place) {
+    const char* name = place->as.place_expr->id->as.identifier->value;
+
+    const u32 reg = cfg_context_find_symbol(ctx, name);
+    if (reg == IR_NULL_REG) {
+        report(ctx, ERR_UNDECLARED_IDENTIFIER, place, name);
+    }
+
+    return reg;
+}
+
+// Returns the array register when the expression indexes a local array, IR_NULL_REG otherwise.
+static u32 get_indexed_array(CFGContext* ctx, const ASTNode* expr) {
+    if (expr->kind != AST_CALL_OR_INDEXER_EXPR_NODE) {
+        return IR_NULL_REG;
+    }
+
+    const ASTNode* callee = expr->as.call_or_indexer_expr->callee;
+    if (callee->kind != AST_PLACE_EXPR_NODE) {
+        return IR_NULL_REG;
+    }
+
+    const u32 reg = cfg_context_find_symbol(ctx, callee->as.place_expr->id->as.identifier->value);
+    if (reg == IR_NULL_REG || get_reg_type(ctx, reg) != IR_TYPE_ARRAY) {
+        return IR_NULL_REG;
+    }
+
+    return reg;
+}
+
+static IROpcode get_binary_opcode(const char* op) {
+    if (str_eq(op, "+") || str_eq(op, "+=")) { return IR_OP_ADD; }
+    if (str_eq(op, "-") || str_eq(op, "-=")) { return IR_OP_SUB; }
+    if (str_eq(op, "*") || str_eq(op, "*=")) { return IR_OP_MUL; }
+    if (str_eq(op, "/") || str_eq(op, "/=")) { return IR_OP_DIV; }
+    if (str_eq(op, "%") || str_eq(op, "%=")) { return IR_OP_REM; }
+    if (str_eq(op, "&") || str_eq(op, "&=")) { return IR_OP_AND; }
+    if (str_eq(op, "|") || str_eq(op, "|=")) { return IR_OP_OR; }
+    if (str_eq(op, "^") || str_eq(op, "^=")) { return IR_OP_XOR; }
+    if (str_eq(op, "<<") || str_eq(op, "<<=")) { return IR_OP_SHL; }
+    if (str_eq(op, ">>") || str_eq(op, ">>=")) { return IR_OP_SHR; }
+    if (str_eq(op, "==")) { return IR_OP_EQ; }
+    if (str_eq(op, "!=")) { return IR_OP_NE; }
+    if (str_eq(op, "<")) { return IR_OP_LT; }
+    if (str_eq(op, "<=")) { return IR_OP_LE; }
+    if (str_eq(op, ">")) { return IR_OP_GT; }
+    if (str_eq(op, ">=")) { return IR_OP_GE; }
+    return IR_OP_NOP;
+}
+
+static u32 emit_binary(CFGContext* ctx, const u32 block, const IROpcode op, const u32 lhs, const u32 rhs) {
+    const IRType lhs_type = get_reg_type(ctx, lhs);
+    const IRType rhs_type = get_reg_type(ctx, rhs);
+
+    if (is_ir_opcode_compare(op)) {
+        // Compares are typed by their operands, the result is always a bool.
+        return emit(ctx, block, ir_instr_create(op, get_common_type(lhs_type, rhs_type), create_temp(ctx, IR_TYPE_BOOL), lhs, rhs));
+    }
+
+    const IRType type = (op == IR_OP_SHL || op == IR_OP_SHR) ? promote_type(lhs_type) : get_common_type(lhs_type, rhs_type);
+    return emit(ctx, block, ir_instr_create(op, type, create_temp(ctx, type), lhs, rhs));
+}
+
+// Lowers 'target op= value', op is IR_OP_NOP for the plain assignment.
+// The value is lowered by the caller, so '++' and '--' can share the code.
+static u32 lower_store_to_ir(CFGContext* ctx, u32* block, const ASTNode* target, const IROpcode op, const u32 value) {
+    while (target->kind == AST_BRACES_EXPR_NODE) {
+        target = target->as.braces_expr->expr;
+    }
+
+    if (target->kind == AST_PLACE_EXPR_NODE) {
+        const u32 var = lower_place_to_ir(ctx, target);
+        if (var == IR_NULL_REG) {
+            return IR_NULL_REG;
+        }
+
+        if (op == IR_OP_NOP) {
+            emit_move(ctx, *block, var, value);
+        }
+        else {
+            emit(ctx, *block, ir_instr_create(op, get_reg_type(ctx, var), var, var, value));
+        }
+        return var;
+    }
+
+    const u32 array = get_indexed_array(ctx, target);
+    if (array != IR_NULL_REG && target->as.call_or_indexer_expr->args.items_count == 1) {
+        const IRType elem_type = ir_function_get_reg(&ctx->ir, array)->elem_type;
+
+        const u32 index = lower_expression_to_ir(ctx, block, vector_get_ref(&target->as.call_or_indexer_expr->args, 0));
+        if (index == IR_NULL_REG) {
+            return IR_NULL_REG;
+        }
+
+        u32 result = value;
+        if (op != IR_OP_NOP) {
+            const u32 old = emit(ctx, *block, ir_instr_create(IR_OP_LOAD_ELEM, elem_type, create_temp(ctx, elem_type), array, index));
+            result = emit(ctx, *block, ir_instr_create(op, elem_type, create_temp(ctx, elem_type), old, value));
+        }
+
+        IRInstr store = ir_instr_create(IR_OP_STORE_ELEM, elem_type, IR_NULL_REG, array, index);
+        store.c = result;
+        emit(ctx, *block, store);
+
+        return result;
+    }
+
+    report(ctx, ERR_EXPRESSION_IS_NOT_ASSIGNABLE, target, NULL);
+    return IR_NULL_REG;
+}
+
+static u32 lower_unary_to_ir(CFGContext* ctx, u32* block, const ASTNode* unary) {
+    const char* op = unary->as.unary_expr->op;
+    const ASTNode* rhs = unary->as.unary_expr->rhs;
+
+    if (str_eq(op, "++") || str_eq(op, "--")) {
+        const u32 one = emit_const(ctx, *block, IR_TYPE_INT, 1);
+        return lower_store_to_ir(ctx, block, rhs, str_eq(op, "++") ? IR_OP_ADD : IR_OP_SUB, one);
+    }
+
+    const u32 value = lower_expression_to_ir(ctx, block, rhs);
+    if (value == IR_NULL_REG) {
+        return IR_NULL_REG;
+    }
+
+    const IRType type = promote_type(get_reg_type(ctx, value));
+
+    if (str_eq(op, "+")) { return value; }
+    if (str_eq(op, "-")) { return emit(ctx, *block, ir_instr_create(IR_OP_NEG, type, create_temp(ctx, type), value, IR_NULL_REG)); }
+    if (str_eq(op, "~")) { return emit(ctx, *block, ir_instr_create(IR_OP_NOT, type, create_temp(ctx, type), value, IR_NULL_REG)); }
+    if (str_eq(op, "!")) { return emit(ctx, *block, ir_instr_create(IR_OP_LNOT, IR_TYPE_BOOL, create_temp(ctx, IR_TYPE_BOOL), value, IR_NULL_REG)); }
+
+    assert(false && "Unknown unary operator.");
+    return IR_NULL_REG;
+}
+
+static IRInstr create_jump(const u32 target) {
+    IRInstr instr = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+    instr.as.target = target;
+    return instr;
+}
+
+// An unknown target gets a new block, which the caller places afterwards.
+static u32 get_branch_target(CFGContext* ctx, u32* target) {
+    if (*target == CFG_NULL_NODE) {
+        *target = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+    }
+    return *target;
+}
+
+bool is_short_circuit_expr(const ASTNode* expr) {
+    assert(expr != NULL);
+
+    while (expr->kind == AST_BRACES_EXPR_NODE) {
+        expr = expr->as.braces_expr->expr;
+    }
+
+    switch (expr->kind) {
+    case AST_BINARY_EXPR_NODE: { return is_short_circuit_op(expr->as.binary_expr->op); } break;
+    case AST_UNARY_EXPR_NODE: { return str_eq(expr->as.unary_expr->op, "!") && is_short_circuit_expr(expr->as.unary_expr->rhs); } break;
+    case AST_TERNARY_EXPR_NODE: { return true; } break;
+    default: {
+        return false;
+    } break;
+    };
+}
+
+bool lower_condition_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr, u32* then_target, u32* else_target) {
+    assert(ctx != NULL && block != NULL && expr != NULL && then_target != NULL && else_target != NULL);
+
+    while (expr->kind == AST_BRACES_EXPR_NODE) {
+        expr = expr->as.braces_expr->expr;
+    }
+
+    if (expr->kind == AST_BINARY_EXPR_NODE && is_short_circuit_op(expr->as.binary_expr->op)) {
+        // The rhs is only reached when the lhs does not decide the result.
+        u32 rhs_block = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+
+        const bool is_and = str_eq(expr->as.binary_expr->op, "&&");
+        if (!lower_condition_to_ir(ctx, block, expr->as.binary_expr->lhs, is_and ? &rhs_block : then_target, is_and ? else_target : &rhs_block)) {
+            return false;
+        }
+
+        *block = rhs_block;
+        return lower_condition_to_ir(ctx, block, expr->as.binary_expr->rhs, then_target, else_target);
+    }
+
+    if (expr->kind == AST_UNARY_EXPR_NODE && str_eq(expr->as.unary_expr->op, "!")) {
+        return lower_condition_to_ir(ctx, block, expr->as.unary_expr->rhs, else_target, then_target);
+    }
+
+    if (expr->kind == AST_TERNARY_EXPR_NODE) {
+        u32 then_block = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+        u32 else_block = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+
+        if (!lower_condition_to_ir(ctx, block, expr->as.ternary_expr->expr, &then_block, &else_block)) {
+            return false;
+        }
+
+        *block = then_block;
+        if (!lower_condition_to_ir(ctx, block, expr->as.ternary_expr->then_expr, then_target, else_target)) {
+            return false;
+        }
+
+        *block = else_block;
+        return lower_condition_to_ir(ctx, block, expr->as.ternary_expr->else_expr, then_target, else_target);
+    }
+
+    // Any other operand is computed and branched on right away, a compare is never turned into a bool first.
+    const u32 value = lower_expression_to_ir(ctx, block, expr);
+    if (value == IR_NULL_REG) {
+        return false;
+    }
+
+    IRInstr branch = ir_instr_create(IR_OP_BR, IR_TYPE_BOOL, IR_NULL_REG, value, IR_NULL_REG);
+    branch.as.branch.then_block = get_branch_target(ctx, then_target);
+    branch.as.branch.else_block = get_branch_target(ctx, else_target);
+    emit(ctx, *block, branch);
+
+    return true;
+}
+
+// The value of a short-circuit operator is only materialized where it is used as a value:
+// the condition jumps to a block setting the result to true or to false, and both go on in a new block.
+static u32 lower_short_circuit_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr) {
+    u32 then_block = CFG_NULL_NODE;
+    u32 else_block = CFG_NULL_NODE;
+
+    if (!lower_condition_to_ir(ctx, block, expr, &then_block, &else_block)) {
+        return IR_NULL_REG;
+    }
+
+    const u32 join = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+    const u32 result = create_temp(ctx, IR_TYPE_BOOL);
+
+    IRInstr value = ir_instr_create(IR_OP_CONST, IR_TYPE_BOOL, result, IR_NULL_REG, IR_NULL_REG);
+
+    value.as.imm = 1;
+    emit(ctx, then_block, value);
+    emit(ctx, then_block, create_jump(join));
+
+    value.as.imm = 0;
+    emit(ctx, else_block, value);
+    emit(ctx, else_block, create_jump(join));
+
+    *block = join;
+    return result;
+}
+
+static u32 lower_binary_to_ir(CFGContext* ctx, u32* block, const ASTNode* binary) {
+    const char* op = binary->as.binary_expr->op;
+    const ASTNode* lhs_expr = binary->as.binary_expr->lhs;
+    const ASTNode* rhs_expr = binary->as.binary_expr->rhs;
+
+    if (is_short_circuit_op(op)) {
+        return lower_short_circuit_to_ir(ctx, block, binary);
+    }
+
+    if (is_assignment_op(op)) {
+        const u32 value = lower_expression_to_ir(ctx, block, rhs_expr);
+        if (value == IR_NULL_REG) {
+            return IR_NULL_REG;
+        }
+        return lower_store_to_ir(ctx, block, lhs_expr, str_eq(op, "=") ? IR_OP_NOP : get_binary_opcode(op), value);
+    }
+
+    // Long chains like `a + 1 - a + 1 ...` nest to the left, so the lhs spine is
+    // walked with a loop instead of recursion to keep the stack depth constant.
+    u64 depth = 1;
+    for (const ASTNode* it = lhs_expr; is_plain_binary_expr(it); it = it->as.binary_expr->lhs) {
+        ++depth;
+    }
+
+    const ASTNode* inline_spine[16] = { 0 };
+    const ASTNode** spine = depth <= 16 ? inline_spine : malloc(depth * sizeof(ASTNode*));
+    assert(spine != NULL);
+
+    const ASTNode* leaf = binary;
+    for (u64 i = depth; i > 0; --i) {
+        spine[i - 1] = leaf;
+        leaf = leaf->as.binary_expr->lhs;
+    }
+
+    u32 lhs = lower_expression_to_ir(ctx, block, leaf);
+    for (u64 i = 0; lhs != IR_NULL_REG && i < depth; ++i) {
+        const ASTNode* operand = spine[i]->as.binary_expr->rhs;
+        lhs = protect_operand(ctx, *block, lhs, operand);
+
+        const u32 rhs = lower_expression_to_ir(ctx, block, operand);
+        if (rhs == IR_NULL_REG) {
+            lhs = IR_NULL_REG;
+            break;
+        }
+
+        const IROpcode opcode = get_binary_opcode(spine[i]->as.binary_expr->op);
+        assert(opcode != IR_OP_NOP && "Unknown binary operator.");
+
+        lhs = emit_binary(ctx, *block, opcode, lhs, rhs);
+    }
+
+    if (spine != inline_spine) {
+        free((void*)spine);
+    }
+
+    return lhs;
+}
+
+static u32 lower_call_or_indexer_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr) {
+    const ASTNode* callee = expr->as.call_or_indexer_expr->callee;
+    const Vector* args = &expr->as.call_or_indexer_expr->args;
+
+    const u32 array = get_indexed_array(ctx, expr);
+    if (array != IR_NULL_REG) {
+        if (args->items_count != 1) {
+            report(ctx, ERR_EXPRESSION_IS_NOT_ASSIGNABLE, expr, NULL);
+            return IR_NULL_REG;
+        }
+
+        const u32 index = lower_expression_to_ir(ctx, block, vector_get_ref(args, 0));
+        if (index == IR_NULL_REG) {
+            return IR_NULL_REG;
+        }
+
+        const IRType elem_type = ir_function_get_reg(&ctx->ir, array)->elem_type;
+        return emit(ctx, *block, ir_instr_create(IR_OP_LOAD_ELEM, elem_type, create_temp(ctx, elem_type), array, index));
+    }
+
+    if (callee->kind != AST_PLACE_EXPR_NODE) {
+        report(ctx, ERR_EXPRESSION_IS_NOT_ASSIGNABLE, callee, NULL);
+        return IR_NULL_REG;
+    }
+
+    // Arguments are lowered first and then stored as one contiguous list.
+    u32 inline_regs[8] = { 0 };
+    u32* regs = args->items_count <= 8 ? inline_regs : malloc(args->items_count * sizeof(u32));
+    assert(regs != NULL);
+
+    bool result = true;
+    for (u64 i = 0; result && i < args->items_count; ++i) {
+        regs[i] = lower_expression_to_ir(ctx, block, vector_get_ref(args, i));
+        result = regs[i] != IR_NULL_REG;
+
+        if (result && i + 1 < args->items_count && !is_temp_reg(ctx, regs[i])) {
+            for (u64 j = i + 1; j < args->items_count; ++j) {
+                regs[i] = protect_operand(ctx, *block, regs[i], vector_get_ref(args, j));
+            }
+        }
+    }
+
+    u32 dst = IR_NULL_REG;
+    if (result) {
+        IRInstr call = ir_instr_create(IR_OP_CALL, IR_TYPE_INT, create_temp(ctx, IR_TYPE_INT), IR_NULL_REG, IR_NULL_REG);
+        call.as.call.callee = ir_function_add_string(&ctx->ir, callee->as.place_expr->id->as.identifier->value);
+        call.as.call.first = ir_function_add_list(&ctx->ir, regs, (u32)args->items_count);
+        call.as.call.count = (u32)args->items_count;
+
+        dst = emit(ctx, *block, call);
+    }
+
+    if (regs != inline_regs) {
+        free(regs);
+    }
+
+    return dst;
+}
+
+// Only the selected side is evaluated, each one in its own block copying its value into the result.
+// The type of the result is known once both sides are lowered, so the copies are retyped at the end.
+static u32 lower_ternary_to_ir(CFGContext* ctx, u32* block, const ASTNode* ternary) {
+    u32 then_block = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+    u32 else_block = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+
+    if (!lower_condition_to_ir(ctx, block, ternary->as.ternary_expr->expr, &then_block, &else_block)) {
+        return IR_NULL_REG;
+    }
+
+    const u32 join = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+    const u32 result = create_temp(ctx, IR_TYPE_INT);
+
+    *block = then_block;
+    const u32 then_value = lower_expression_to_ir(ctx, block, ternary->as.ternary_expr->then_expr);
+    if (then_value == IR_NULL_REG) {
+        return IR_NULL_REG;
+    }
+
+    const u32 then_copy = ir_function_get_instrs_count(&ctx->ir);
+    emit(ctx, *block, ir_instr_create(IR_OP_COPY, IR_TYPE_INT, result, then_value, IR_NULL_REG));
+    emit(ctx, *block, create_jump(join));
+
+    *block = else_block;
+    const u32 else_value = lower_expression_to_ir(ctx, block, ternary->as.ternary_expr->else_expr);
+    if (else_value == IR_NULL_REG) {
+        return IR_NULL_REG;
+    }
+
+    const u32 else_copy = ir_function_get_instrs_count(&ctx->ir);
+    emit(ctx, *block, ir_instr_create(IR_OP_COPY, IR_TYPE_INT, result, else_value, IR_NULL_REG));
+    emit(ctx, *block, create_jump(join));
+
+    const IRType type = get_common_type(get_reg_type(ctx, then_value), get_reg_type(ctx, else_value));
+    ir_function_get_reg(&ctx->ir, result)->type = type;
+    ir_function_get_instr(&ctx->ir, then_copy)->type = type;
+    ir_function_get_instr(&ctx->ir, else_copy)->type = type;
+
+    *block = join;
+    return result;
+}
+
+u32 lower_expression_to_ir(CFGContext* ctx, u32* block, const ASTNode* expr) {
+    assert(ctx != NULL && expr != NULL);
+
+    switch (expr->kind) {
+    case AST_BINARY_EXPR_NODE: { return lower_binary_to_ir(ctx, block, expr); } break;
+    case AST_UNARY_EXPR_NODE: { return lower_unary_to_ir(ctx, block, expr); } break;
+    case AST_BRACES_EXPR_NODE: { return lower_expression_to_ir(ctx, block, expr->as.braces_expr->expr); } break;
+    case AST_CALL_OR_INDEXER_EXPR_NODE: { return lower_call_or_indexer_to_ir(ctx, block, expr); } break;
+    case AST_PLACE_EXPR_NODE: { return lower_place_to_ir(ctx, expr); } break;
+    case AST_TERNARY_EXPR_NODE: { return lower_ternary_to_ir(ctx, block, expr); } break;
+    case AST_STRING_LITERAL_NODE:
+    case AST_CHAR_LITERAL_NODE:
+    case AST_DEC_LITERAL_NODE:
+    case AST_HEX_LITERAL_NODE:
+    case AST_OCT_LITERAL_NODE:
+    case AST_BITS_LITERAL_NODE:
+    case AST_BOOL_LITERAL_NODE: { return lower_literal_to_ir(ctx, *block, expr); } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    return IR_NULL_REG;
+}
+
+bool lower_statement_to_ir(CFGContext* ctx, u32* block, const ASTNode* stmt) {
+    assert(ctx != NULL && stmt != NULL);
+
+    switch (stmt->kind) {
+    case AST_VARDECL_STMT_NODE: {
+        IRType elem_type = IR_TYPE_VOID;
+        const IRType type = get_ir_type_of_typeref(ctx, stmt->as.vardecl_stmt->typeref, &elem_type);
+        if (type == IR_TYPE_VOID) {
+            return false;
+        }
+
+        const Vector* ids = &stmt->as.vardecl_stmt->ids;
+        for (u64 i = 0; i < ids->items_count; ++i) {
+            const u32 reg = declare_variable(ctx, vector_get_ref(ids, i), type, elem_type);
+
+            // 'dim' zero initializes, on every execution of the statement.
+            IRInstr instr = ir_instr_create(IR_OP_CONST, type, reg, IR_NULL_REG, IR_NULL_REG);
+            instr.as.imm = 0;
+            emit(ctx, *block, instr);
+        }
+        return true;
+    } break;
+    case AST_EXPRESSION_STMT_NODE: {
+        return lower_expression_to_ir(ctx, block, stmt->as.expression_stmt->expr) != IR_NULL_REG;
+    } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    return false;
+}
+
+bool lower_return_to_ir(CFGContext* ctx, u32* block, const ASTNode* stmt) {
+    assert(ctx != NULL && stmt != NULL);
+
+    const ASTNode* expr = stmt->as.return_stmt->expr;
+    if (expr == NULL) {
+        return true;
+    }
+
+    const u32 value = lower_expression_to_ir(ctx, block, expr);
+    if (value == IR_NULL_REG) {
+        return false;
+    }
+
+    // The value of a function without a return type is evaluated and dropped.
+    if (ctx->ir.ret_reg != IR_NULL_REG) {
+        emit_move(ctx, *block, ctx->ir.ret_reg, value);
+    }
+
+    return true;
+}
\ No newline at end of file
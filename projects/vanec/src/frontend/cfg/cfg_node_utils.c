@@ -6,6 +6,8 @@
 #include "vanec/utils/string_utils.h"
 #include "vanec/utils/string_builder.h"
 
+#include "vanec/ir/ir_printer.h"
+
 static void write_dot_header(FILE* handle) {
     assert(handle != NULL);
 
@@ -65,123 +67,66 @@ static void write_cfg_node_decl(FILE* handle, const CFGNode* node) {
     };
 }
 
-static void write_cfg_node_to_dot_file(
-    FILE* handle,
-    const u64 visited_count,
-    const u32 prev_node_id,
-    const char* edge_label,
-    const char* edge_color,
-    const char* edge_style,
-    CFGNode* node
-) {
-    assert(handle != NULL && node != NULL);
+static void write_cfg_edge_decl(FILE* handle, const CFGNode* from, const u32 index, const u32 count, const u32 to) {
+    const char* label = "";
+    const char* color = "";
+    const char* style = "";
 
-    switch (node->kind) {
-    case CFG_FUNC_ENTRY_NODE: {
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+    // Short-circuit evaluations branch from plain blocks too.
+    if (count == 2) {
+        label = index == 0 ? "true" : "false";
+        color = index == 0 ? "palegreen" : "tomato";
+    }
+    else if (from->kind == CFG_BACKEDGE_NODE || from->kind == CFG_BREAK_NODE || from->kind == CFG_RETURN_NODE) {
+        style = "dashed";
+    }
 
-        write_cfg_node_decl(handle, node);
+    fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", from->id, to, label, color, style);
+}
 
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "", node->as.func_entry->block.next);
-    } break;
-    case CFG_FUNC_EXIT_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+// Depth first, every edge is written when it is walked and every block when it is reached first.
+static void write_cfg_nodes_to_dot_file(FILE* handle, CFGContext* ctx, const u32 entry) {
+    CFGGraph* graph = &ctx->graph;
 
-        write_cfg_node_decl(handle, node);
-    } break;
-    case CFG_BASIC_BLOCK_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+    // The scratch stack of the graph is free once the graph is built.
+    Vector* stack = &graph->stack;
+    vector_clear(stack);
 
-        write_cfg_node_decl(handle, node);
+    const u32 zero = 0;
 
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "", node->as.basic_block->next);
-    } break;
-    case CFG_CONDITION_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+    cfg_graph_begin_visit(graph);
+    cfg_graph_mark_visited(graph, entry);
+    write_cfg_node_decl(handle, cfg_context_get_node(ctx, entry));
 
-        write_cfg_node_decl(handle, node);
+    vector_push_back(stack, &entry);
+    vector_push_back(stack, &zero);
 
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "true", "palegreen", "", node->as.condition->then_branch.next);
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "false", "tomato", "", node->as.condition->else_branch.next);
-    } break;
-    case CFG_LOOP_ENTRY_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+    while (stack->items_count > 0) {
+        u32* top = (u32*)stack->items + stack->items_count - 2;
+        const u32 id = top[0];
+        const u32 index = top[1]++;
 
-        write_cfg_node_decl(handle, node);
+        u32 count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, id, &count);
 
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "", node->as.loop_entry->block.next);
-    } break;
-    case CFG_LOOP_EXIT_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
+        if (index == count) {
+            stack->items_count -= 2;
+            continue;
         }
-        ++node->visited;
 
-        write_cfg_node_decl(handle, node);
+        write_cfg_edge_decl(handle, cfg_context_get_node(ctx, id), index, count, succs[index]);
 
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "", node->as.loop_exit->next);
-    } break;
-    case CFG_BACKEDGE_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
+        if (cfg_graph_mark_visited(graph, succs[index])) {
+            write_cfg_node_decl(handle, cfg_context_get_node(ctx, succs[index]));
 
-        write_cfg_node_decl(handle, node);
-
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "dashed", node->as.backedge->next);
-    } break;
-    case CFG_BREAK_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
+            vector_push_back(stack, &succs[index]);
+            vector_push_back(stack, &zero);
         }
-        ++node->visited;
-
-        write_cfg_node_decl(handle, node);
-
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "dashed", node->as.break_->next);
-    } break;
-    case CFG_RETURN_NODE: {
-        fprintf(handle, "\tcfg_node%ld -> cfg_node%ld [label=\"%s\", color=\"%s\", style=\"%s\"];\n", prev_node_id, node->id, edge_label, edge_color, edge_style);
-        if (visited_count != node->visited) {
-            break;
-        }
-        ++node->visited;
-
-        write_cfg_node_decl(handle, node);
-
-        write_cfg_node_to_dot_file(handle, visited_count, node->id, "", "", "dashed", node->as.break_->next);
-    } break;
-    default: {
-        assert(false && "Unreachable");
-    } break;
-    };
+    }
 }
 
-bool write_cfg_dot_file(const char* filepath, CFGNode* cfg) {
-    assert(filepath != NULL);
+bool write_cfg_dot_file(const char* filepath, CFGContext* ctx, const u32 entry) {
+    assert(filepath != NULL && ctx != NULL && entry != CFG_NULL_NODE);
 
     FILE* file = NULL;
     i32 status = fopen_s(&file, filepath, "wb");
@@ -192,7 +137,7 @@ bool write_cfg_dot_file(const char* filepath, CFGNode* cfg) {
 
     write_dot_header(file);
 
-    write_cfg_node_to_dot_file(file, cfg->visited, 0, "", "", "", cfg);
+    write_cfg_nodes_to_dot_file(file, ctx, entry);
 
     putc('}', file);
 
@@ -201,4 +146,47 @@ bool write_cfg_dot_file(const char* filepath, CFGNode* cfg) {
     printf("Saved CFG graph to \"%s\".\n", filepath);
 
     return true;
+}
+
+const char* get_cfg_node_kind_name(const CFGNodeKind kind) {
+    switch (kind) {
+    case CFG_FUNC_ENTRY_NODE: return "func_entry";
+    case CFG_FUNC_EXIT_NODE: return "func_exit";
+    case CFG_BASIC_BLOCK_NODE: return "bb";
+    case CFG_CONDITION_NODE: return "condition";
+    case CFG_LOOP_ENTRY_NODE: return "loop_entry";
+    case CFG_LOOP_EXIT_NODE: return "loop_exit";
+    case CFG_BACKEDGE_NODE: return "backedge";
+    case CFG_BREAK_NODE: return "break";
+    case CFG_RETURN_NODE: return "return";
+    default: return "unknown";
+    };
+}
+
+void print_cfg_ir(FILE* handle, const CFGContext* ctx, const char* name) {
+    assert(handle != NULL && ctx != NULL && name != NULL);
+
+    const IRFunction* func = &ctx->ir;
+
+    fprintf(handle, "function %s(", name);
+    for (u32 i = 0; i < func->params_count; ++i) {
+        if (i != 0) {
+            fputs(", ", handle);
+        }
+        print_ir_reg(handle, func, i);
+        fprintf(handle, " as %s", get_ir_type_name(ir_function_get_reg(func, i)->type));
+    }
+    fprintf(handle, ") as %s\n", get_ir_type_name(func->ret_type));
+
+    for (u32 id = 0; id < cfg_context_get_nodes_count(ctx); ++id) {
+        const CFGNode* node = cfg_context_get_node(ctx, id);
+
+        fprintf(handle, "bb%ld: ; %s\n", id, get_cfg_node_kind_name(node->kind));
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            fputs("    ", handle);
+            print_ir_instr(handle, func, cfg_context_get_instr(ctx, id, i));
+        }
+    }
+
+    fputs("end function\n\n", handle);
 }
\ No newline at end of file
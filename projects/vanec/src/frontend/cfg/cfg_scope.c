@@ -1,25 +1,12 @@
 #include "vanec/frontend/cfg/cfg_scope.h"
 
-#include <assert.h>
-#include <stdlib.h>
-
-CFGScope* cfg_scope_create(const CFGScopeKind kind, CFGScope* prev) {
-    CFGScope* scope = malloc(sizeof(CFGScope));
-    assert(scope != NULL);
-
-    scope->kind = kind;
-    scope->prev = prev;
-    scope->break_node = NULL;
-    scope->backedge_node = NULL;
-    scope->return_node = NULL;
-
-    return scope;
-}
-
-void cfg_scope_free(CFGScope* scope) {
-    if (scope == NULL) {
-        return;
-    }
-
-    free(scope);
+CFGScope cfg_scope_create(const CFGScopeKind kind, const u32 prev, const u32 symbols_count) {
+    return (CFGScope) {
+        .kind = kind,
+        .prev = prev,
+        .break_node = CFG_NULL_NODE,
+        .backedge_node = CFG_NULL_NODE,
+        .return_node = CFG_NULL_NODE,
+        .symbols_count = symbols_count,
+    };
 }
\ No newline at end of file
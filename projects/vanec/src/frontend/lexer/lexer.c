@@ -484,7 +484,7 @@ Token lexer_parse_char_literal(Lexer* lexer) {
         return token_create(TOKEN_INVALID, NULL, lexer->loc);
     }
     // There is no characters in char literal body
-    else if (sb.buffer.items_count == 0) {
+    else if (string_builder_get_len(&sb) == 0) {
         string_builder_free(&sb);
 
         if (lexer->diag != NULL) {
@@ -492,7 +492,7 @@ Token lexer_parse_char_literal(Lexer* lexer) {
         }
         return token_create(TOKEN_INVALID, NULL, lexer->loc);
     }
-    else if (sb.buffer.items_count >= 2 && ((char*)sb.buffer.items)[0] != '\\') {
+    else if (string_builder_get_len(&sb) >= 2 && string_builder_get_char(&sb, 0) != '\\') {
         string_builder_free(&sb);
 
         if (lexer->diag != NULL) {
@@ -528,7 +528,7 @@ Token lexer_parse_hex_literal(Lexer* lexer) {
         consume_char(lexer);
     }
     // 0x
-    if (sb.buffer.items_count == 2) {
+    if (string_builder_get_len(&sb) == 2) {
         string_builder_free(&sb);
 
         if (lexer->diag != NULL) {
@@ -572,7 +572,7 @@ Token lexer_parse_bits_literal(Lexer* lexer) {
         consume_char(lexer);
     }
     // 0b
-    if (sb.buffer.items_count == 2) {
+    if (string_builder_get_len(&sb) == 2) {
         string_builder_free(&sb);
 
         if (lexer->diag != NULL) {
@@ -619,7 +619,7 @@ Token lexer_parse_dec_or_oct_literal(Lexer* lexer, const char prev_ch) {
     }
 
     char* value = string_builder_get_str(&sb);
-    u64 len = sb.buffer.items_count;
+    u64 len = string_builder_get_len(&sb);
     string_builder_free(&sb);
 
     if (prev_ch == '0') {
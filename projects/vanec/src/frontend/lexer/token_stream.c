@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <stdlib.h>
 
+#include "vanec/utils/profiler.h"
+
 static TokenStreamIterator* token_stream_iterator_create(const Token token, TokenStreamIterator* prev) {
     TokenStreamIterator* it = malloc(sizeof(TokenStreamIterator));
     assert(it != NULL);
@@ -63,7 +65,9 @@ void token_stream_clear (TokenStream* ts) {
 static inline TokenStreamIterator* token_stream_parse_next(TokenStream* ts) {
     assert(ts != NULL);
 
+    PROFILE_SCOPE_BEGIN(lex);
     Token token = lexer_parse_next_token(ts->lexer);
+    PROFILE_SCOPE_ACCUMULATE(lex, "lex", "lexer_parse_next_token");
     ++ts->count;
 
     TokenStreamIterator* it = token_stream_iterator_create(token, ts->curr);
@@ -114,4 +118,25 @@ void token_stream_move_back(TokenStream* ts) {
         ts->next = ts->curr;
         ts->curr = ts->curr->prev;
     }
+}
+
+void token_stream_release_consumed(TokenStream* ts) {
+    assert(ts != NULL);
+
+    if (ts->curr == NULL) {
+        return;
+    }
+
+    TokenStreamIterator* it = ts->head;
+    while (it != ts->curr) {
+        TokenStreamIterator* next = it->next;
+
+        token_free(&it->token);
+        free(it);
+
+        it = next;
+    }
+
+    ts->curr->prev = NULL;
+    ts->head = ts->curr;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "vanec/ir/ir_function.h"
+
+#include <assert.h>
+
+#include "vanec/utils/string_utils.h"
+
+IRFunction ir_function_create(void) {
+    return (IRFunction) {
+        .instrs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(IRInstr), NULL, false),
+        .regs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(IRReg), NULL, false),
+        .lists = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .strings = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char*), &str_free, true),
+        .params_count = 0,
+        .ret_reg = IR_NULL_REG,
+        .ret_type = IR_TYPE_VOID,
+        .is_ssa = false,
+    };
+}
+
+void ir_function_free(IRFunction* func) {
+    if (func == NULL) {
+        return;
+    }
+
+    vector_free(&func->instrs);
+    vector_free(&func->regs);
+    vector_free(&func->lists);
+    vector_free(&func->strings);
+}
+
+void ir_function_clear(IRFunction* func) {
+    assert(func != NULL);
+
+    vector_clear(&func->instrs);
+    vector_clear(&func->regs);
+    vector_clear(&func->lists);
+    vector_clear(&func->strings);
+
+    func->params_count = 0;
+    func->ret_reg = IR_NULL_REG;
+    func->ret_type = IR_TYPE_VOID;
+    func->is_ssa = false;
+}
+
+u32 ir_function_create_reg(IRFunction* func, const IRType type, const u32 name) {
+    assert(func != NULL);
+
+    IRReg reg = {
+        .type = type,
+        .elem_type = IR_TYPE_VOID,
+        .name = name,
+    };
+    vector_push_back(&func->regs, &reg);
+
+    return (u32)(func->regs.items_count - 1);
+}
+
+IRReg* ir_function_get_reg(const IRFunction* func, const u32 reg) {
+    assert(func != NULL && reg != IR_NULL_REG);
+
+    return vector_get_ref(&func->regs, reg);
+}
+
+u32 ir_function_get_regs_count(const IRFunction* func) {
+    assert(func != NULL);
+
+    return (u32)func->regs.items_count;
+}
+
+IRInstr* ir_function_get_instr(const IRFunction* func, const u32 index) {
+    assert(func != NULL);
+
+    return vector_get_ref(&func->instrs, index);
+}
+
+u32 ir_function_get_instrs_count(const IRFunction* func) {
+    assert(func != NULL);
+
+    return (u32)func->instrs.items_count;
+}
+
+u32 ir_function_add_string(IRFunction* func, const char* s) {
+    assert(func != NULL && s != NULL);
+
+    char* copy = str_dup(s);
+    vector_push_back(&func->strings, &copy);
+
+    return (u32)(func->strings.items_count - 1);
+}
+
+const char* ir_function_get_string(const IRFunction* func, const u32 index) {
+    assert(func != NULL);
+
+    if (index == IR_NULL_STRING) {
+        return NULL;
+    }
+    return vector_get_ref(&func->strings, index);
+}
+
+u32 ir_function_add_list(IRFunction* func, const u32* items, const u32 count) {
+    assert(func != NULL && (items != NULL || count == 0));
+
+    const u32 first = (u32)func->lists.items_count;
+    for (u32 i = 0; i < count; ++i) {
+        vector_push_back(&func->lists, &items[i]);
+    }
+
+    return first;
+}
+
+u32* ir_function_get_list(const IRFunction* func, const u32 first) {
+    assert(func != NULL);
+
+    return (u32*)(func->lists.items + first * func->lists.item_size);
+}
+
+u32 ir_function_get_uses_count(const IRFunction* func, const IRInstr* instr) {
+    assert(func != NULL && instr != NULL);
+
+    switch (instr->op) {
+    case IR_OP_CALL: { return instr->as.call.count; } break;
+    case IR_OP_PHI: { return instr->as.phi.count; } break;
+    default: { return 3; } break;
+    };
+}
+
+u32* ir_function_get_use_ref(const IRFunction* func, IRInstr* instr, const u32 index) {
+    assert(func != NULL && instr != NULL);
+    assert(index < ir_function_get_uses_count(func, instr));
+
+    switch (instr->op) {
+    case IR_OP_CALL: { return ir_function_get_list(func, instr->as.call.first) + index; } break;
+    case IR_OP_PHI: { return ir_function_get_list(func, instr->as.phi.first) + index * 2 + 1; } break;
+    default: {
+        u32* operands[] = { &instr->a, &instr->b, &instr->c };
+        return operands[index];
+    } break;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "vanec/ir/ir_instr.h"
+
+IRInstr ir_instr_create(const IROpcode op, const IRType type, const u32 dst, const u32 a, const u32 b) {
+    return (IRInstr) {
+        .op = op,
+        .type = type,
+        .dst = dst,
+        .a = a,
+        .b = b,
+        .c = IR_NULL_REG,
+        .as.imm = 0,
+    };
+}
+
+const char* get_ir_opcode_name(const IROpcode op) {
+    switch (op) {
+#define IR_OPCODE(ID, NAME) case IR_OP_##ID: return NAME;
+#include "vanec/ir/ir_opcode.def"
+    default: break;
+    };
+    return NULL;
+}
+
+const char* get_ir_type_name(const IRType type) {
+    switch (type) {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) case IR_TYPE_##ID: return NAME;
+#include "vanec/ir/ir_type.def"
+    default: break;
+    };
+    return NULL;
+}
+
+u32 get_ir_type_size(const IRType type) {
+    switch (type) {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) case IR_TYPE_##ID: return SIZE;
+#include "vanec/ir/ir_type.def"
+    default: break;
+    };
+    return 0;
+}
+
+bool is_ir_type_signed(const IRType type) {
+    switch (type) {
+#define IR_TYPE(ID, NAME, SIZE, IS_SIGNED) case IR_TYPE_##ID: return IS_SIGNED;
+#include "vanec/ir/ir_type.def"
+    default: break;
+    };
+    return false;
+}
+
+bool is_ir_type_integer(const IRType type) {
+    return type != IR_TYPE_VOID && type != IR_TYPE_STRING && type != IR_TYPE_ARRAY;
+}
+
+i64 normalize_ir_value(const IRType type, const i64 value) {
+    if (type == IR_TYPE_BOOL) {
+        return value != 0;
+    }
+
+    const u32 bits = get_ir_type_size(type) * 8;
+    if (bits == 0 || bits >= 64) {
+        return value;
+    }
+
+    const u64 mask = ((u64)1 << bits) - 1;
+    u64 result = (u64)value & mask;
+    if (is_ir_type_signed(type) && ((result >> (bits - 1)) & 1) != 0) {
+        result |= ~mask;
+    }
+    return (i64)result;
+}
+
+i64 multiply_high_ir_value(const IRType type, const i64 lhs, const i64 rhs) {
+    const u32 bits = get_ir_type_size(type) * 8;
+    const i64 a = normalize_ir_value(type, lhs);
+    const i64 b = normalize_ir_value(type, rhs);
+
+    // Up to 32 bits the whole product fits into 64 of them.
+    if (bits <= 32) {
+        const i64 product = is_ir_type_signed(type) ? a * b : (i64)((u64)a * (u64)b);
+        return normalize_ir_value(type, is_ir_type_signed(type) ? product >> bits : (i64)((u64)product >> bits));
+    }
+
+    // Schoolbook multiplication on 32 bit halves, then the signed high half is corrected from the unsigned one.
+    const u64 a_lo = (u64)a & 0xFFFFFFFF;
+    const u64 a_hi = (u64)a >> 32;
+    const u64 b_lo = (u64)b & 0xFFFFFFFF;
+    const u64 b_hi = (u64)b >> 32;
+
+    const u64 lo_lo = a_lo * b_lo;
+    const u64 hi_lo = a_hi * b_lo;
+    const u64 lo_hi = a_lo * b_hi;
+    const u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+
+    u64 high = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+    if (is_ir_type_signed(type)) {
+        high -= (a < 0 ? (u64)b : 0) + (b < 0 ? (u64)a : 0);
+    }
+    return (i64)high;
+}
+
+bool is_ir_opcode_unary(const IROpcode op) {
+    switch (op) {
+#define IR_UNARY_OPCODE(ID, NAME) case IR_OP_##ID: return true;
+#include "vanec/ir/ir_opcode.def"
+    default: break;
+    };
+    return false;
+}
+
+bool is_ir_opcode_binary(const IROpcode op) {
+    switch (op) {
+#define IR_BINARY_OPCODE(ID, NAME) case IR_OP_##ID: return true;
+#include "vanec/ir/ir_opcode.def"
+    default: break;
+    };
+    return false;
+}
+
+bool is_ir_opcode_compare(const IROpcode op) {
+    switch (op) {
+#define IR_COMPARE_OPCODE(ID, NAME) case IR_OP_##ID: return true;
+#include "vanec/ir/ir_opcode.def"
+    default: break;
+    };
+    return false;
+}
+
+bool is_ir_opcode_terminator(const IROpcode op) {
+    switch (op) {
+#define IR_TERMINATOR_OPCODE(ID, NAME) case IR_OP_##ID: return true;
+#include "vanec/ir/ir_opcode.def"
+    default: break;
+    };
+    return false;
+}
+
+bool is_ir_opcode_commutative(const IROpcode op) {
+    return
+        op == IR_OP_ADD ||
+        op == IR_OP_MUL ||
+        op == IR_OP_MULH ||
+        op == IR_OP_AND ||
+        op == IR_OP_OR ||
+        op == IR_OP_XOR ||
+        op == IR_OP_LAND ||
+        op == IR_OP_LOR ||
+        op == IR_OP_EQ ||
+        op == IR_OP_NE;
+}
+
+bool is_ir_opcode_pure(const IROpcode op) {
+    // Division traps on zero, so it is kept even when unused.
+    return
+        op != IR_OP_CALL &&
+        op != IR_OP_STORE_ELEM &&
+        op != IR_OP_DIV &&
+        op != IR_OP_REM &&
+        !is_ir_opcode_terminator(op);
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "vanec/ir/ir_printer.h"
+
+#include <assert.h>
+
+static void print_ir_string(FILE* handle, const char* s) {
+    putc('\"', handle);
+    for (; *s != '\0'; ++s) {
+        switch (*s) {
+        case '\n': { fputs("\\n", handle); } break;
+        case '\t': { fputs("\\t", handle); } break;
+        case '\r': { fputs("\\r", handle); } break;
+        case '\"': { fputs("\\\"", handle); } break;
+        case '\\': { fputs("\\\\", handle); } break;
+        default: { putc(*s, handle); } break;
+        };
+    }
+    putc('\"', handle);
+}
+
+void print_ir_reg(FILE* handle, const IRFunction* func, const u32 reg) {
+    assert(handle != NULL && func != NULL);
+
+    if (reg == IR_NULL_REG) {
+        fputs("_", handle);
+        return;
+    }
+
+    const char* name = ir_function_get_string(func, ir_function_get_reg(func, reg)->name);
+    if (name != NULL) {
+        fprintf(handle, "%%%s.%ld", name, reg);
+    }
+    else {
+        fprintf(handle, "%%%ld", reg);
+    }
+}
+
+void print_ir_instr(FILE* handle, const IRFunction* func, const IRInstr* instr) {
+    assert(handle != NULL && func != NULL && instr != NULL);
+
+    if (instr->dst != IR_NULL_REG) {
+        print_ir_reg(handle, func, instr->dst);
+        fputs(" = ", handle);
+    }
+
+    fputs(get_ir_opcode_name(instr->op), handle);
+    if (instr->type != IR_TYPE_VOID && instr->op != IR_OP_BR) {
+        fprintf(handle, ".%s", get_ir_type_name(instr->type));
+    }
+
+    switch (instr->op) {
+    case IR_OP_NOP: { /* DO NOTHING */ } break;
+    case IR_OP_CONST: { fprintf(handle, " %lld", instr->as.imm); } break;
+    case IR_OP_STR: {
+        putc(' ', handle);
+        print_ir_string(handle, ir_function_get_string(func, instr->as.str));
+    } break;
+    case IR_OP_CALL: {
+        fprintf(handle, " %s(", ir_function_get_string(func, instr->as.call.callee));
+
+        const u32* args = ir_function_get_list(func, instr->as.call.first);
+        for (u32 i = 0; i < instr->as.call.count; ++i) {
+            if (i != 0) {
+                fputs(", ", handle);
+            }
+            print_ir_reg(handle, func, args[i]);
+        }
+        putc(')', handle);
+    } break;
+    case IR_OP_PHI: {
+        const u32* incoming = ir_function_get_list(func, instr->as.phi.first);
+        for (u32 i = 0; i < instr->as.phi.count; ++i) {
+            fprintf(handle, "%s[bb%ld: ", i == 0 ? " " : ", ", incoming[i * 2]);
+            print_ir_reg(handle, func, incoming[i * 2 + 1]);
+            putc(']', handle);
+        }
+    } break;
+    case IR_OP_LOAD_ELEM: {
+        putc(' ', handle);
+        print_ir_reg(handle, func, instr->a);
+        putc('(', handle);
+        print_ir_reg(handle, func, instr->b);
+        putc(')', handle);
+    } break;
+    case IR_OP_STORE_ELEM: {
+        putc(' ', handle);
+        print_ir_reg(handle, func, instr->a);
+        putc('(', handle);
+        print_ir_reg(handle, func, instr->b);
+        fputs("), ", handle);
+        print_ir_reg(handle, func, instr->c);
+    } break;
+    case IR_OP_JMP: { fprintf(handle, " bb%ld", instr->as.target); } break;
+    case IR_OP_BR: {
+        putc(' ', handle);
+        print_ir_reg(handle, func, instr->a);
+        fprintf(handle, ", bb%ld, bb%ld", instr->as.branch.then_block, instr->as.branch.else_block);
+    } break;
+    case IR_OP_RET: {
+        if (instr->a != IR_NULL_REG) {
+            putc(' ', handle);
+            print_ir_reg(handle, func, instr->a);
+        }
+    } break;
+    default: {
+        const u32 operands[] = { instr->a, instr->b, instr->c };
+        for (u32 i = 0; i < 3 && operands[i] != IR_NULL_REG; ++i) {
+            fputs(i == 0 ? " " : ", ", handle);
+            print_ir_reg(handle, func, operands[i]);
+        }
+    } break;
+    };
+
+    putc('\n', handle);
+}
\ No newline at end of file
@@ -0,0 +1,460 @@
+#include "vanec/transform/divisions.h"
+
+#include "vanec/analysis/def_use.h"
+
+#include <assert.h>
+
+typedef struct {
+    u64 multiplier;
+    u32 shift;
+    bool is_add;        // the multiplier takes one more bit than the type, the dividend is added back
+} DivisionMagic;
+
+typedef struct {
+    u32 value;          // the register compared instead of the remainder or IR_NULL_REG
+    u32 limit;
+    IRType type;
+} DivisibilityTest;
+
+typedef struct {
+    CFGContext* ctx;
+    DefUseChains chains;
+    Vector instrs;      // IRInstr, the new pool
+    Vector tests;       // DivisibilityTest per instruction
+} DivisionLowering;
+
+static u64 get_type_mask(const u32 bits) {
+    return bits >= 64 ? ~(u64)0 : ((u64)1 << bits) - 1;
+}
+
+static bool is_power_of_two(const u64 value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static u32 count_trailing_zeros(u64 value) {
+    u32 count = 0;
+    for (; value != 0 && (value & 1) == 0; value >>= 1) {
+        ++count;
+    }
+    return count;
+}
+
+static IRType get_unsigned_type(const IRType type) {
+    switch (type) {
+    case IR_TYPE_CHAR: return IR_TYPE_BYTE;
+    case IR_TYPE_INT: return IR_TYPE_UINT;
+    case IR_TYPE_LONG: return IR_TYPE_ULONG;
+    default: return type;
+    };
+}
+
+#pragma region MAGIC NUMBERS
+
+// The smallest multiplier m and shift s with 'n / d == (m * n) >> (bits + s)' for every unsigned n, after Hacker's Delight.
+// Only 'bits' wide arithmetic is used, so it works up to 64 bits. When m needs 'bits + 1' bits, its top bit
+// is dropped and 'is_add' is set, the dividend is then added back to the high half of the product.
+static DivisionMagic get_unsigned_magic(const u64 divisor, const u32 bits) {
+    assert(divisor > 1);
+
+    const u64 mask = get_type_mask(bits);
+    const u64 top = (u64)1 << (bits - 1);
+    const u64 nc = mask - ((0 - divisor) & mask) % divisor;
+
+    DivisionMagic magic = { .is_add = false };
+    u32 p = bits - 1;
+    u64 q1 = top / nc;
+    u64 r1 = top - q1 * nc;
+    u64 q2 = (top - 1) / divisor;
+    u64 r2 = (top - 1) - q2 * divisor;
+    u64 delta = 0;
+
+    do {
+        ++p;
+        if (r1 >= nc - r1) {
+            q1 = (2 * q1 + 1) & mask;
+            r1 = (2 * r1 - nc) & mask;
+        }
+        else {
+            q1 = (2 * q1) & mask;
+            r1 = (2 * r1) & mask;
+        }
+
+        if (r2 + 1 >= divisor - r2) {
+            magic.is_add |= q2 >= top - 1;
+            q2 = (2 * q2 + 1) & mask;
+            r2 = (2 * r2 + 1 - divisor) & mask;
+        }
+        else {
+            magic.is_add |= q2 >= top;
+            q2 = (2 * q2) & mask;
+            r2 = (2 * r2 + 1) & mask;
+        }
+        delta = divisor - 1 - r2;
+    } while (p < 2 * bits && (q1 < delta || (q1 == delta && r1 == 0)));
+
+    magic.multiplier = (q2 + 1) & mask;
+    magic.shift = p - bits;
+    return magic;
+}
+
+// The multiplier and shift of a signed divisor with an absolute value of at least 3, after Hacker's Delight.
+// The multiplier is a signed value of the width, its sign differs from the one of the divisor when the dividend
+// has to be added to the high half of the product or subtracted from it.
+static DivisionMagic get_signed_magic(const i64 divisor, const u32 bits) {
+    const u64 mask = get_type_mask(bits);
+    const u64 top = (u64)1 << (bits - 1);
+    const u64 ad = divisor < 0 ? 0 - (u64)divisor : (u64)divisor;
+    const u64 t = top + (divisor < 0);
+    const u64 anc = t - 1 - t % ad;
+
+    u32 p = bits - 1;
+    u64 q1 = top / anc;
+    u64 r1 = top - q1 * anc;
+    u64 q2 = top / ad;
+    u64 r2 = top - q2 * ad;
+    u64 delta = 0;
+
+    do {
+        ++p;
+        q1 = (2 * q1) & mask;
+        r1 = (2 * r1) & mask;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+
+        q2 = (2 * q2) & mask;
+        r2 = (2 * r2) & mask;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    DivisionMagic magic = { .multiplier = (q2 + 1) & mask, .shift = p - bits, .is_add = false };
+    if (divisor < 0) {
+        magic.multiplier = (0 - magic.multiplier) & mask;
+    }
+    return magic;
+}
+
+// The inverse of an odd value modulo 2^64 by Newton's iteration, every step doubles the correct low bits.
+static u64 get_multiplicative_inverse(const u64 value) {
+    assert((value & 1) != 0);
+
+    u64 inverse = value;
+    for (u32 i = 0; i < 5; ++i) {
+        inverse *= 2 - value * inverse;
+    }
+    return inverse;
+}
+
+#pragma endregion
+
+#pragma region EMISSION
+
+static u32 emit(DivisionLowering* lowering, const IROpcode op, const IRType type, const u32 a, const u32 b) {
+    const IRType dst_type = is_ir_opcode_compare(op) ? IR_TYPE_BOOL : type;
+    const IRInstr instr = ir_instr_create(op, type, ir_function_create_reg(&lowering->ctx->ir, dst_type, IR_NULL_STRING), a, b);
+    vector_push_back(&lowering->instrs, &instr);
+    return instr.dst;
+}
+
+static u32 emit_const(DivisionLowering* lowering, const IRType type, const i64 value) {
+    const u32 dst = emit(lowering, IR_OP_CONST, type, IR_NULL_REG, IR_NULL_REG);
+    ((IRInstr*)lowering->instrs.items)[lowering->instrs.items_count - 1].as.imm = normalize_ir_value(type, value);
+    return dst;
+}
+
+// The sequences compute into temporaries, the last one is then retargeted to the register of the result.
+static void retarget_last(DivisionLowering* lowering, const u32 dst) {
+    ((IRInstr*)lowering->instrs.items)[lowering->instrs.items_count - 1].dst = dst;
+}
+
+static u32 emit_unsigned_division(DivisionLowering* lowering, const IRType type, const u32 dividend, const u64 divisor) {
+    const u32 bits = get_ir_type_size(type) * 8;
+
+    if (divisor == 1) {
+        return emit(lowering, IR_OP_COPY, type, dividend, IR_NULL_REG);
+    }
+    if (is_power_of_two(divisor)) {
+        return emit(lowering, IR_OP_SHR, type, dividend, emit_const(lowering, type, count_trailing_zeros(divisor)));
+    }
+
+    // Only 0 and 1 are left as quotients.
+    if (divisor >= (u64)1 << (bits - 1)) {
+        const u32 is_greater = emit(lowering, IR_OP_GE, type, dividend, emit_const(lowering, type, (i64)divisor));
+        return emit(lowering, IR_OP_COPY, type, is_greater, IR_NULL_REG);
+    }
+
+    const DivisionMagic magic = get_unsigned_magic(divisor, bits);
+    const u32 high = emit(lowering, IR_OP_MULH, type, dividend, emit_const(lowering, type, (i64)magic.multiplier));
+
+    if (!magic.is_add) {
+        return magic.shift == 0 ? high : emit(lowering, IR_OP_SHR, type, high, emit_const(lowering, type, magic.shift));
+    }
+
+    // '(((n - high) >> 1) + high) >> (s - 1)' adds the dividend back without overflowing.
+    const u32 one = emit_const(lowering, type, 1);
+    const u32 half = emit(lowering, IR_OP_SHR, type, emit(lowering, IR_OP_SUB, type, dividend, high), one);
+    const u32 sum = emit(lowering, IR_OP_ADD, type, half, high);
+    return magic.shift == 1 ? sum : emit(lowering, IR_OP_SHR, type, sum, emit_const(lowering, type, magic.shift - 1));
+}
+
+// The dividend rounded towards zero to a multiple of 2^k: negative values get '2^k - 1' added before the shift.
+static u32 emit_signed_bias(DivisionLowering* lowering, const IRType type, const u32 dividend, const u32 log) {
+    const u32 bits = get_ir_type_size(type) * 8;
+    const u32 sign = emit(lowering, IR_OP_SHR, type, dividend, emit_const(lowering, type, bits - 1));
+    const u32 bias = emit(lowering, IR_OP_AND, type, sign, emit_const(lowering, type, (i64)(((u64)1 << log) - 1)));
+    return emit(lowering, IR_OP_ADD, type, dividend, bias);
+}
+
+static u32 emit_signed_division(DivisionLowering* lowering, const IRType type, const u32 dividend, const i64 divisor) {
+    const u32 bits = get_ir_type_size(type) * 8;
+    const u64 ad = divisor < 0 ? 0 - (u64)divisor : (u64)divisor;
+
+    if (divisor == 1) {
+        return emit(lowering, IR_OP_COPY, type, dividend, IR_NULL_REG);
+    }
+    if (is_power_of_two(ad)) {
+        const u32 log = count_trailing_zeros(ad);
+        const u32 biased = emit_signed_bias(lowering, type, dividend, log);
+        const u32 quotient = emit(lowering, IR_OP_SHR, type, biased, emit_const(lowering, type, log));
+        return divisor < 0 ? emit(lowering, IR_OP_NEG, type, quotient, IR_NULL_REG) : quotient;
+    }
+
+    const DivisionMagic magic = get_signed_magic(divisor, bits);
+    const i64 multiplier = normalize_ir_value(type, (i64)magic.multiplier);
+    u32 quotient = emit(lowering, IR_OP_MULH, type, dividend, emit_const(lowering, type, multiplier));
+
+    if (divisor > 0 && multiplier < 0) {
+        quotient = emit(lowering, IR_OP_ADD, type, quotient, dividend);
+    }
+    else if (divisor < 0 && multiplier > 0) {
+        quotient = emit(lowering, IR_OP_SUB, type, quotient, dividend);
+    }
+    if (magic.shift > 0) {
+        quotient = emit(lowering, IR_OP_SHR, type, quotient, emit_const(lowering, type, magic.shift));
+    }
+
+    // Rounds towards zero, a negative quotient is one too small.
+    const u32 sign = emit(lowering, IR_OP_SHR, type, quotient, emit_const(lowering, type, bits - 1));
+    return emit(lowering, IR_OP_SUB, type, quotient, sign);
+}
+
+static u32 emit_remainder(DivisionLowering* lowering, const IRType type, const u32 dividend, const i64 divisor) {
+    const bool is_signed = is_ir_type_signed(type);
+    const u64 ad = is_signed && divisor < 0 ? 0 - (u64)divisor : (u64)divisor;
+
+    if (ad == 1) {
+        return emit_const(lowering, type, 0);
+    }
+    if (is_power_of_two(ad) && !is_signed) {
+        return emit(lowering, IR_OP_AND, type, dividend, emit_const(lowering, type, (i64)(ad - 1)));
+    }
+    if (is_power_of_two(ad)) {
+        const u32 biased = emit_signed_bias(lowering, type, dividend, count_trailing_zeros(ad));
+        const u32 multiple = emit(lowering, IR_OP_AND, type, biased, emit_const(lowering, type, (i64)(0 - ad)));
+        return emit(lowering, IR_OP_SUB, type, dividend, multiple);
+    }
+
+    const u32 quotient = is_signed ?
+        emit_signed_division(lowering, type, dividend, divisor) :
+        emit_unsigned_division(lowering, type, dividend, (u64)divisor);
+    const u32 product = emit(lowering, IR_OP_MUL, type, quotient, emit_const(lowering, type, divisor));
+    return emit(lowering, IR_OP_SUB, type, dividend, product);
+}
+
+// With 'd = d0 * 2^k' for an odd d0, 'n * inverse(d0)' rotated right by k is at most '(2^bits - 1) / d'
+// exactly for the unsigned multiples of d. Signed values are offset by '(2^(bits-1) - 1) / d0' first,
+// which maps the multiples onto the unsigned range up to twice of it, for odd divisors only.
+static void emit_divisibility_test(DivisionLowering* lowering, const IRType type, const u32 dividend, const i64 divisor, const DivisibilityTest* test) {
+    const u32 bits = get_ir_type_size(type) * 8;
+    const u64 mask = get_type_mask(bits);
+
+    if (!is_ir_type_signed(type)) {
+        const u32 log = count_trailing_zeros((u64)divisor);
+        const i64 inverse = (i64)(get_multiplicative_inverse((u64)divisor >> log) & mask);
+
+        u32 value = emit(lowering, IR_OP_MUL, type, dividend, emit_const(lowering, type, inverse));
+        if (log > 0) {
+            const u32 low = emit(lowering, IR_OP_SHR, type, value, emit_const(lowering, type, log));
+            const u32 high = emit(lowering, IR_OP_SHL, type, value, emit_const(lowering, type, bits - log));
+            value = emit(lowering, IR_OP_OR, type, low, high);
+        }
+        retarget_last(lowering, test->value);
+
+        emit_const(lowering, type, (i64)(mask / (u64)divisor));
+        retarget_last(lowering, test->limit);
+        return;
+    }
+
+    const u64 ad = divisor < 0 ? 0 - (u64)divisor : (u64)divisor;
+    const u64 offset = (((u64)1 << (bits - 1)) - 1) / ad;
+    const i64 inverse = normalize_ir_value(type, (i64)get_multiplicative_inverse(ad));
+
+    const u32 product = emit(lowering, IR_OP_MUL, type, dividend, emit_const(lowering, type, inverse));
+    const u32 value = emit(lowering, IR_OP_ADD, type, product, emit_const(lowering, type, (i64)offset));
+    emit(lowering, IR_OP_COPY, test->type, value, IR_NULL_REG);
+    retarget_last(lowering, test->value);
+
+    emit_const(lowering, test->type, (i64)(2 * offset));
+    retarget_last(lowering, test->limit);
+}
+
+#pragma endregion
+
+// The divisor normalized to the type of the instruction, when it is a constant that can be lowered.
+static bool get_lowered_divisor(const DivisionLowering* lowering, const IRInstr* instr, i64* divisor) {
+    if ((instr->op != IR_OP_DIV && instr->op != IR_OP_REM) || !is_ir_type_integer(instr->type) || instr->type == IR_TYPE_BOOL) {
+        return false;
+    }
+
+    const u32 def = instr->b == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&lowering->chains, instr->b);
+    if (def == IR_NULL_REG) {
+        return false;
+    }
+
+    const IRInstr* constant = ir_function_get_instr(&lowering->ctx->ir, def);
+    if (constant->op != IR_OP_CONST) {
+        return false;
+    }
+
+    *divisor = normalize_ir_value(instr->type, constant->as.imm);
+    return *divisor != 0 && !(is_ir_type_signed(instr->type) && *divisor == -1);
+}
+
+// A remainder read by nothing but 'r == 0' and 'r != 0' in its own type is turned into a divisibility test:
+// the compares are rewritten in place to 'value <= limit' and 'value > limit', the remainder is lowered later.
+// Remainders by powers of two are masks already, the same ones the tests would compute.
+static bool find_divisibility_test(DivisionLowering* lowering, const u32 index, const i64 divisor) {
+    IRFunction* func = &lowering->ctx->ir;
+    const IRInstr* rem = ir_function_get_instr(func, index);
+    const bool is_signed = is_ir_type_signed(rem->type);
+    const u64 ad = is_signed && divisor < 0 ? 0 - (u64)divisor : (u64)divisor;
+
+    if (rem->op != IR_OP_REM || ad == 1 || is_power_of_two(ad) || (is_signed && (ad & 1) == 0)) {
+        return false;
+    }
+
+    u32 uses_count = 0;
+    const u32* uses = def_use_chains_get_uses(&lowering->chains, rem->dst, &uses_count);
+    if (uses_count == 0) {
+        return false;
+    }
+
+    for (u32 i = 0; i < uses_count; ++i) {
+        const IRInstr* use = ir_function_get_instr(func, uses[i]);
+        const u32 other = use->a == rem->dst ? use->b : use->a;
+
+        i64 value = 0;
+        const u32 def = other == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&lowering->chains, other);
+        if (def != IR_NULL_REG) {
+            const IRInstr* constant = ir_function_get_instr(func, def);
+            value = constant->op == IR_OP_CONST ? normalize_ir_value(rem->type, constant->as.imm) : 1;
+        }
+
+        if ((use->op != IR_OP_EQ && use->op != IR_OP_NE) || use->type != rem->type || other == rem->dst || def == IR_NULL_REG || value != 0) {
+            return false;
+        }
+    }
+
+    const IRType type = is_signed ? get_unsigned_type(rem->type) : rem->type;
+    const DivisibilityTest test = {
+        .value = ir_function_create_reg(func, type, IR_NULL_STRING),
+        .limit = ir_function_create_reg(func, type, IR_NULL_STRING),
+        .type = type,
+    };
+    ((DivisibilityTest*)lowering->tests.items)[index] = test;
+
+    for (u32 i = 0; i < uses_count; ++i) {
+        IRInstr* use = ir_function_get_instr(func, uses[i]);
+        use->op = use->op == IR_OP_EQ ? IR_OP_LE : IR_OP_GT;
+        use->type = type;
+        use->a = test.value;
+        use->b = test.limit;
+    }
+    return true;
+}
+
+u32 lower_constant_divisions(CFGContext* ctx) {
+    assert(ctx != NULL);
+    assert(ctx->ir.is_ssa && "Divisions are lowered in SSA form only.");
+
+    IRFunction* func = &ctx->ir;
+    const u32 instrs_count = ir_function_get_instrs_count(func);
+
+    DivisionLowering lowering = {
+        .ctx = ctx,
+        .chains = def_use_chains_create(),
+        .instrs = vector_create(instrs_count + 1, sizeof(IRInstr), NULL, false),
+        .tests = vector_create(instrs_count + 1, sizeof(DivisibilityTest), NULL, false),
+    };
+
+    def_use_chains_build(&lowering.chains, ctx);
+
+    const DivisibilityTest no_test = { .value = IR_NULL_REG, .limit = IR_NULL_REG, .type = IR_TYPE_VOID };
+    for (u32 i = 0; i < instrs_count; ++i) {
+        vector_push_back(&lowering.tests, &no_test);
+    }
+
+    u32 count = 0;
+    for (u32 i = 0; i < instrs_count; ++i) {
+        i64 divisor = 0;
+        if (get_lowered_divisor(&lowering, ir_function_get_instr(func, i), &divisor)) {
+            find_divisibility_test(&lowering, i, divisor);
+            ++count;
+        }
+    }
+
+    if (count == 0) {
+        def_use_chains_free(&lowering.chains);
+        vector_free(&lowering.instrs);
+        vector_free(&lowering.tests);
+        return 0;
+    }
+
+    // The pool is rebuilt in block order with the sequences in place of the divisions.
+    for (u32 block = 0; block < cfg_context_get_nodes_count(ctx); ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)lowering.instrs.items_count;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const u32 index = node->instrs_begin + i;
+            const IRInstr instr = *ir_function_get_instr(func, index);
+            const DivisibilityTest* test = (const DivisibilityTest*)lowering.tests.items + index;
+
+            i64 divisor = 0;
+            if (!get_lowered_divisor(&lowering, &instr, &divisor)) {
+                vector_push_back(&lowering.instrs, &instr);
+            }
+            else if (test->value != IR_NULL_REG) {
+                emit_divisibility_test(&lowering, instr.type, instr.a, divisor, test);
+            }
+            else {
+                if (instr.op == IR_OP_DIV && is_ir_type_signed(instr.type)) {
+                    emit_signed_division(&lowering, instr.type, instr.a, divisor);
+                }
+                else if (instr.op == IR_OP_DIV) {
+                    emit_unsigned_division(&lowering, instr.type, instr.a, (u64)divisor);
+                }
+                else {
+                    emit_remainder(&lowering, instr.type, instr.a, divisor);
+                }
+                retarget_last(&lowering, instr.dst);
+            }
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)lowering.instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = lowering.instrs;
+
+    def_use_chains_free(&lowering.chains);
+    vector_free(&lowering.tests);
+
+    return count;
+}
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "vanec/transform/gvn.h"
+
+#include <assert.h>
+#include <string.h>
+
+typedef struct {
+    IROpcode op;
+    IRType type;
+    u32 a;
+    u32 b;
+    u32 c;
+    i64 imm;
+    u32 memory;         // the memory state of loads, 0 for everything else
+} ValueKey;
+
+typedef struct {
+    ValueKey key;
+    u32 hash;
+    u32 next;           // the entry shadowed in the same bucket or IR_NULL_REG
+    u32 reg;
+} ValueEntry;
+
+typedef struct {
+    u32 block;
+    u32 next_child;
+    u32 entries_mark;   // the entries of the block are the ones above it
+    u32 memory;         // the memory state at the end of the block
+} DomFrame;
+
+typedef struct {
+    CFGContext* ctx;
+
+    Vector replace;     // u32 per register, the register holding the same value
+    Vector removed;     // u8 per instruction
+    Vector buckets;     // u32, the newest entry of every bucket or IR_NULL_REG
+    Vector entries;     // ValueEntry, a stack unwound when a subtree of the dominator tree is left
+    Vector frames;      // DomFrame
+
+    u32 memory;
+    u32 memory_count;
+    u32 removed_count;
+} ValueNumbering;
+
+#pragma region VALUE TABLE
+
+static u32 hash_key(const ValueKey* key) {
+    u64 hash = 0xCBF29CE484222325ull;
+    const u64 parts[] = { key->op, key->type, key->a, key->b, key->c, (u64)key->imm, key->memory };
+
+    for (u32 i = 0; i < sizeof(parts) / sizeof(parts[0]); ++i) {
+        hash = (hash ^ parts[i]) * 0x100000001B3ull;
+    }
+    return (u32)(hash ^ (hash >> 32));
+}
+
+static bool are_keys_equal(const ValueKey* lhs, const ValueKey* rhs) {
+    return
+        lhs->op == rhs->op &&
+        lhs->type == rhs->type &&
+        lhs->a == rhs->a &&
+        lhs->b == rhs->b &&
+        lhs->c == rhs->c &&
+        lhs->imm == rhs->imm &&
+        lhs->memory == rhs->memory;
+}
+
+static u32 get_bucket(const ValueNumbering* numbering, const u32 hash) {
+    return hash & (u32)(numbering->buckets.items_count - 1);
+}
+
+static u32 find_value(const ValueNumbering* numbering, const ValueKey* key, const u32 hash) {
+    const ValueEntry* entries = (const ValueEntry*)numbering->entries.items;
+
+    u32 it = ((const u32*)numbering->buckets.items)[get_bucket(numbering, hash)];
+    for (; it != IR_NULL_REG; it = entries[it].next) {
+        if (entries[it].hash == hash && are_keys_equal(&entries[it].key, key)) {
+            return entries[it].reg;
+        }
+    }
+    return IR_NULL_REG;
+}
+
+static void add_value(ValueNumbering* numbering, const ValueKey* key, const u32 hash, const u32 reg) {
+    u32* bucket = (u32*)numbering->buckets.items + get_bucket(numbering, hash);
+
+    const ValueEntry entry = { .key = *key, .hash = hash, .next = *bucket, .reg = reg };
+    *bucket = (u32)numbering->entries.items_count;
+    vector_push_back(&numbering->entries, &entry);
+}
+
+// Entries are dropped newest first, so each one is still the head of its bucket when it goes.
+static void unwind_values(ValueNumbering* numbering, const u32 mark) {
+    u32* buckets = (u32*)numbering->buckets.items;
+    const ValueEntry* entries = (const ValueEntry*)numbering->entries.items;
+
+    while (numbering->entries.items_count > mark) {
+        const ValueEntry* entry = &entries[--numbering->entries.items_count];
+        buckets[get_bucket(numbering, entry->hash)] = entry->next;
+    }
+}
+
+#pragma endregion
+
+#pragma region NUMBERING
+
+static u32 get_leader(const ValueNumbering* numbering, const u32 reg) {
+    return reg == IR_NULL_REG ? reg : ((const u32*)numbering->replace.items)[reg];
+}
+
+static void replace_uses(const ValueNumbering* numbering, IRInstr* instr) {
+    const IRFunction* func = &numbering->ctx->ir;
+
+    const u32 uses_count = ir_function_get_uses_count(func, instr);
+    for (u32 i = 0; i < uses_count; ++i) {
+        u32* use = ir_function_get_use_ref(func, instr, i);
+        *use = get_leader(numbering, *use);
+    }
+}
+
+// Returns false for the instructions that are not numbered: the ones with side effects, phis and strings,
+// which are separate objects even when they are equal.
+static bool make_value_key(const ValueNumbering* numbering, const IRInstr* instr, ValueKey* key) {
+    *key = (ValueKey) {
+        .op = instr->op,
+        .type = instr->type,
+        .a = instr->a,
+        .b = instr->b,
+        .c = instr->c,
+        .imm = 0,
+        .memory = 0,
+    };
+
+    if (instr->op == IR_OP_CONST) {
+        key->imm = instr->as.imm;
+        return true;
+    }
+    if (instr->op == IR_OP_LOAD_ELEM) {
+        key->memory = numbering->memory;
+        return true;
+    }
+
+    const bool is_numbered =
+        instr->op == IR_OP_COPY ||
+        instr->op == IR_OP_SELECT ||
+        is_ir_opcode_unary(instr->op) ||
+        is_ir_opcode_binary(instr->op) ||
+        is_ir_opcode_compare(instr->op);
+    if (!is_numbered) {
+        return false;
+    }
+
+    if (instr->op == IR_OP_GT || instr->op == IR_OP_GE) {
+        key->op = instr->op == IR_OP_GT ? IR_OP_LT : IR_OP_LE;
+        key->a = instr->b;
+        key->b = instr->a;
+    }
+    else if (is_ir_opcode_commutative(instr->op) && key->a > key->b) {
+        key->a = instr->b;
+        key->b = instr->a;
+    }
+    return true;
+}
+
+static void remove_instr(ValueNumbering* numbering, const u32 index, const u32 dst, const u32 leader) {
+    ((u32*)numbering->replace.items)[dst] = leader;
+    ((u8*)numbering->removed.items)[index] = true;
+    ++numbering->removed_count;
+}
+
+static void number_block(ValueNumbering* numbering, const u32 block) {
+    const CFGContext* ctx = numbering->ctx;
+    const IRFunction* func = &ctx->ir;
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        const u32 index = node->instrs_begin + i;
+        IRInstr* instr = ir_function_get_instr(func, index);
+
+        // The operands of phis can be defined later in the walk, they are replaced at the end.
+        if (instr->op == IR_OP_PHI) {
+            continue;
+        }
+        replace_uses(numbering, instr);
+
+        if (instr->op == IR_OP_CALL || instr->op == IR_OP_STORE_ELEM) {
+            numbering->memory = ++numbering->memory_count;
+        }
+
+        // Loading the element back gives the stored value, unless the store converts it.
+        if (instr->op == IR_OP_STORE_ELEM && instr->c != IR_NULL_REG && ir_function_get_reg(func, instr->c)->type == instr->type) {
+            IRInstr load = ir_instr_create(IR_OP_LOAD_ELEM, instr->type, IR_NULL_REG, instr->a, instr->b);
+
+            ValueKey key = { 0 };
+            make_value_key(numbering, &load, &key);
+            add_value(numbering, &key, hash_key(&key), instr->c);
+        }
+
+        if (instr->dst == IR_NULL_REG) {
+            continue;
+        }
+
+        const IRType dst_type = ir_function_get_reg(func, instr->dst)->type;
+        if (instr->op == IR_OP_COPY && instr->a != IR_NULL_REG && ir_function_get_reg(func, instr->a)->type == dst_type) {
+            remove_instr(numbering, index, instr->dst, instr->a);
+            continue;
+        }
+
+        ValueKey key = { 0 };
+        if (!make_value_key(numbering, instr, &key)) {
+            continue;
+        }
+
+        // The types of the results can differ for the same operation, a compare into a bool or into an int.
+        const u32 hash = hash_key(&key);
+        const u32 leader = find_value(numbering, &key, hash);
+        if (leader != IR_NULL_REG && ir_function_get_reg(func, leader)->type == dst_type) {
+            remove_instr(numbering, index, instr->dst, leader);
+        }
+        else {
+            add_value(numbering, &key, hash, instr->dst);
+        }
+    }
+}
+
+// A block reached only from its dominator continues its memory state, a join or a loop header
+// can see stores from other paths.
+static u32 get_entry_memory(ValueNumbering* numbering, const u32 block, const u32 idom_memory) {
+    u32 preds_count = 0;
+    cfg_graph_get_preds(&numbering->ctx->graph, block, &preds_count);
+    return preds_count == 1 ? idom_memory : ++numbering->memory_count;
+}
+
+static void enter_block(ValueNumbering* numbering, const u32 block, const u32 memory) {
+    const DomFrame frame = {
+        .block = block,
+        .next_child = 0,
+        .entries_mark = (u32)numbering->entries.items_count,
+        .memory = 0,
+    };
+    vector_push_back(&numbering->frames, &frame);
+
+    numbering->memory = memory;
+    number_block(numbering, block);
+
+    DomFrame* top = vector_get_ref(&numbering->frames, numbering->frames.items_count - 1);
+    top->memory = numbering->memory;
+}
+
+static void walk_dominator_tree(ValueNumbering* numbering, const DominatorTree* tree) {
+    enter_block(numbering, numbering->ctx->graph.entry, ++numbering->memory_count);
+
+    while (numbering->frames.items_count > 0) {
+        DomFrame* top = vector_get_ref(&numbering->frames, numbering->frames.items_count - 1);
+
+        u32 children_count = 0;
+        const u32* children = dominator_tree_get_children(tree, top->block, &children_count);
+
+        if (top->next_child < children_count) {
+            const u32 child = children[top->next_child++];
+            enter_block(numbering, child, get_entry_memory(numbering, child, top->memory));
+            continue;
+        }
+
+        unwind_values(numbering, top->entries_mark);
+        --numbering->frames.items_count;
+    }
+}
+
+#pragma endregion
+
+// Leaders never get replaced themselves, so one lookup per use is enough. Unreachable blocks,
+// which are not in the dominator tree, are rewritten as well, they are still part of the pool.
+static void remove_redundant_instrs(ValueNumbering* numbering) {
+    CFGContext* ctx = numbering->ctx;
+    IRFunction* func = &ctx->ir;
+    const u8* removed = (const u8*)numbering->removed.items;
+
+    Vector instrs = vector_create(ir_function_get_instrs_count(func) - numbering->removed_count + 1, sizeof(IRInstr), NULL, false);
+
+    for (u32 block = 0; block < cfg_context_get_nodes_count(ctx); ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)instrs.items_count;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            if (removed[node->instrs_begin + i]) {
+                continue;
+            }
+
+            IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+            replace_uses(numbering, instr);
+            vector_push_back(&instrs, instr);
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+}
+
+u32 eliminate_common_subexpressions(CFGContext* ctx) {
+    assert(ctx != NULL);
+    assert(ctx->ir.is_ssa && "Values are numbered in SSA form only.");
+
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+    const u32 instrs_count = ir_function_get_instrs_count(func);
+
+    ValueNumbering numbering = {
+        .ctx = ctx,
+        .replace = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .removed = vector_create(instrs_count + 1, sizeof(u8), NULL, false),
+        .buckets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .entries = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ValueEntry), NULL, false),
+        .frames = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(DomFrame), NULL, false),
+        .memory = 0,
+        .memory_count = 0,
+        .removed_count = 0,
+    };
+
+    u32* replace = vector_resize(&numbering.replace, regs_count);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        replace[reg] = reg;
+    }
+
+    memset(vector_resize(&numbering.removed, instrs_count), false, instrs_count);
+
+    // At least twice as many buckets as instructions, a power of two for masking.
+    u64 buckets_count = 16;
+    while (buckets_count < (u64)instrs_count * 2) {
+        buckets_count *= 2;
+    }
+    const u32 null_reg = IR_NULL_REG;
+    vector_resize(&numbering.buckets, buckets_count);
+    vector_fill(&numbering.buckets, &null_reg);
+
+    walk_dominator_tree(&numbering, cfg_context_get_dominator_tree(ctx));
+    remove_redundant_instrs(&numbering);
+
+    vector_free(&numbering.replace);
+    vector_free(&numbering.removed);
+    vector_free(&numbering.buckets);
+    vector_free(&numbering.entries);
+    vector_free(&numbering.frames);
+
+    return numbering.removed_count;
+}
\ No newline at end of file
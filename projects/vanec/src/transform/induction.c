@@ -0,0 +1,668 @@
+#include "vanec/transform/induction.h"
+#include "vanec/transform/preheaders.h"
+
+#include "vanec/analysis/def_use.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Keeps the products of the range checks of the test replacement far away from 64 bits.
+#define MAX_TEST_COEFFICIENT ((i64)1 << 24)
+
+typedef struct {
+    u32 phi;            // the instruction of the header phi
+    u32 reg;
+    u32 init;           // the value entering from the preheader
+    u32 next;           // the value of every latch, 'reg + step'
+    i64 step;
+    IRType type;
+    u32 reduction;      // the first variable reduced from it or IR_NULL_REG
+} BasicIV;
+
+typedef struct {
+    u32 iv;             // the basic variable or IR_NULL_REG
+    i64 scale;
+    i64 offset;
+} LinearForm;
+
+typedef struct {
+    LinearForm form;
+    u32 reg;            // the phi of the reduced variable
+} Reduction;
+
+typedef struct {
+    u32 block;
+    IRInstr instr;      // phis go behind the phis of the block, everything else before its terminator
+} PendingInstr;
+
+typedef struct {
+    CFGContext* ctx;
+    const LoopForest* forest;
+    const DominatorTree* tree;
+    DefUseChains chains;
+
+    u32 loop;
+    u32 header;
+    u32 preheader;
+
+    Vector ivs;         // BasicIV
+    Vector forms;       // LinearForm per register
+    Vector reductions;  // Reduction
+    Vector pending;     // PendingInstr
+    Vector removed;     // u8 per instruction
+    Vector pairs;       // u32, scratch for the phi lists
+} IVOptimizer;
+
+static BasicIV* get_iv(const IVOptimizer* opt, const u32 iv) {
+    return (BasicIV*)opt->ivs.items + iv;
+}
+
+static LinearForm get_form(const IVOptimizer* opt, const u32 reg) {
+    if (reg == IR_NULL_REG || reg >= opt->forms.items_count) {
+        return (LinearForm) { .iv = IR_NULL_REG, .scale = 0, .offset = 0 };
+    }
+    return ((const LinearForm*)opt->forms.items)[reg];
+}
+
+static bool get_const_value(const IVOptimizer* opt, const u32 reg, i64* value) {
+    const u32 def = reg == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&opt->chains, reg);
+    if (def == IR_NULL_REG) {
+        return false;
+    }
+
+    const IRInstr* instr = ir_function_get_instr(&opt->ctx->ir, def);
+    if (instr->op != IR_OP_CONST) {
+        return false;
+    }
+
+    *value = instr->as.imm;
+    return true;
+}
+
+static bool is_loop_block(const IVOptimizer* opt, const u32 block) {
+    return loop_contains_block(opt->forest, opt->loop, block);
+}
+
+#pragma region INSERTION
+
+static u32 add_pending(IVOptimizer* opt, const u32 block, const IRInstr* instr) {
+    const PendingInstr pending = { .block = block, .instr = *instr };
+    vector_push_back(&opt->pending, &pending);
+    return instr->dst;
+}
+
+static u32 add_pending_binary(IVOptimizer* opt, const u32 block, const IROpcode op, const IRType type, const u32 lhs, const u32 rhs) {
+    const IRInstr instr = ir_instr_create(op, type, ir_function_create_reg(&opt->ctx->ir, type, IR_NULL_STRING), lhs, rhs);
+    return add_pending(opt, block, &instr);
+}
+
+static u32 add_pending_const(IVOptimizer* opt, const IRType type, const i64 value) {
+    IRInstr instr = ir_instr_create(IR_OP_CONST, type, ir_function_create_reg(&opt->ctx->ir, type, IR_NULL_STRING), IR_NULL_REG, IR_NULL_REG);
+    instr.as.imm = normalize_ir_value(type, value);
+    return add_pending(opt, opt->preheader, &instr);
+}
+
+// Rebuilds the pool with the pending instructions in place and without the removed ones.
+static void apply_changes(IVOptimizer* opt) {
+    CFGContext* ctx = opt->ctx;
+    IRFunction* func = &ctx->ir;
+    const u8* removed = (const u8*)opt->removed.items;
+    const PendingInstr* pending = (const PendingInstr*)opt->pending.items;
+
+    Vector instrs = vector_create(ir_function_get_instrs_count(func) + opt->pending.items_count + 1, sizeof(IRInstr), NULL, false);
+
+    for (u32 block = 0; block < cfg_context_get_nodes_count(ctx); ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)instrs.items_count;
+        bool are_phis_pending = true;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+
+            for (u32 j = 0; j < opt->pending.items_count; ++j) {
+                if (pending[j].block != block) {
+                    continue;
+                }
+
+                const bool is_phi = pending[j].instr.op == IR_OP_PHI;
+                if ((is_phi && are_phis_pending && instr->op != IR_OP_PHI) || (!is_phi && is_ir_opcode_terminator(instr->op))) {
+                    vector_push_back(&instrs, &pending[j].instr);
+                }
+            }
+            are_phis_pending &= instr->op == IR_OP_PHI;
+
+            if (!removed[node->instrs_begin + i]) {
+                vector_push_back(&instrs, instr);
+            }
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+}
+
+#pragma endregion
+
+#pragma region RECOGNITION
+
+// The increment has to be 'iv + c', 'c + iv' or 'iv - c', in the type of the variable.
+static bool find_step(const IVOptimizer* opt, const IRInstr* phi, const u32 next, i64* step) {
+    const u32 def = next == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&opt->chains, next);
+    if (def == IR_NULL_REG || !is_loop_block(opt, def_use_chains_get_block(&opt->chains, def))) {
+        return false;
+    }
+
+    const IRInstr* instr = ir_function_get_instr(&opt->ctx->ir, def);
+    if (instr->type != phi->type) {
+        return false;
+    }
+
+    i64 value = 0;
+    if (instr->op == IR_OP_ADD && instr->a == phi->dst && get_const_value(opt, instr->b, &value)) {
+        *step = normalize_ir_value(phi->type, value);
+        return true;
+    }
+    if (instr->op == IR_OP_ADD && instr->b == phi->dst && get_const_value(opt, instr->a, &value)) {
+        *step = normalize_ir_value(phi->type, value);
+        return true;
+    }
+    if (instr->op == IR_OP_SUB && instr->a == phi->dst && get_const_value(opt, instr->b, &value)) {
+        *step = normalize_ir_value(phi->type, (i64)(0 - (u64)value));
+        return true;
+    }
+    return false;
+}
+
+static void find_basic_ivs(IVOptimizer* opt) {
+    const CFGContext* ctx = opt->ctx;
+    const CFGNode* node = cfg_context_get_node(ctx, opt->header);
+
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        const IRInstr* phi = cfg_context_get_instr(ctx, opt->header, i);
+        if (phi->op != IR_OP_PHI) {
+            break;
+        }
+        if (!is_ir_type_integer(phi->type) || phi->type == IR_TYPE_BOOL) {
+            continue;
+        }
+
+        const u32* incoming = ir_function_get_list(&ctx->ir, phi->as.phi.first);
+        u32 init = IR_NULL_REG;
+        u32 next = IR_NULL_REG;
+        bool is_valid = true;
+
+        for (u32 j = 0; j < phi->as.phi.count; ++j) {
+            const u32 pred = incoming[j * 2];
+            const u32 value = incoming[j * 2 + 1];
+
+            if (pred == opt->preheader) {
+                init = value;
+            }
+            else {
+                is_valid &= next == IR_NULL_REG || next == value;
+                next = value;
+            }
+        }
+
+        i64 step = 0;
+        if (!is_valid || init == IR_NULL_REG || !find_step(opt, phi, next, &step) || step == 0) {
+            continue;
+        }
+
+        const BasicIV iv = {
+            .phi = node->instrs_begin + i,
+            .reg = phi->dst,
+            .init = init,
+            .next = next,
+            .step = step,
+            .type = phi->type,
+            .reduction = IR_NULL_REG,
+        };
+        ((LinearForm*)opt->forms.items)[phi->dst] = (LinearForm) { .iv = (u32)opt->ivs.items_count, .scale = 1, .offset = 0 };
+        vector_push_back(&opt->ivs, &iv);
+    }
+}
+
+static i64 wrap_mul(const IRType type, const i64 lhs, const i64 rhs) {
+    return normalize_ir_value(type, (i64)((u64)lhs * (u64)rhs));
+}
+
+static i64 wrap_add(const IRType type, const i64 lhs, const i64 rhs) {
+    return normalize_ir_value(type, (i64)((u64)lhs + (u64)rhs));
+}
+
+// Returns false when the result is not a linear function of a single basic variable.
+static bool derive_form(const IVOptimizer* opt, const IRInstr* instr, LinearForm* form) {
+    const LinearForm lhs = get_form(opt, instr->a);
+    const LinearForm rhs = get_form(opt, instr->b);
+    const bool is_lhs_iv = lhs.iv != IR_NULL_REG;
+    const bool is_rhs_iv = rhs.iv != IR_NULL_REG;
+
+    if (is_lhs_iv == is_rhs_iv) {
+        return false;
+    }
+
+    *form = is_lhs_iv ? lhs : rhs;
+    const IRType type = get_iv(opt, form->iv)->type;
+    if (instr->type != type) {
+        return false;
+    }
+
+    i64 value = 0;
+    const bool has_const = get_const_value(opt, is_lhs_iv ? instr->b : instr->a, &value);
+
+    switch (instr->op) {
+    case IR_OP_COPY: {
+        return is_lhs_iv;
+    } break;
+    case IR_OP_NEG: {
+        form->scale = wrap_mul(type, form->scale, -1);
+        form->offset = wrap_mul(type, form->offset, -1);
+    } break;
+    case IR_OP_ADD: {
+        if (!has_const) {
+            return false;
+        }
+        form->offset = wrap_add(type, form->offset, value);
+    } break;
+    case IR_OP_SUB: {
+        if (!has_const) {
+            return false;
+        }
+
+        // 'c - iv' turns the variable around.
+        if (is_rhs_iv) {
+            form->scale = wrap_mul(type, form->scale, -1);
+            form->offset = wrap_add(type, wrap_mul(type, form->offset, -1), value);
+        }
+        else {
+            form->offset = wrap_add(type, form->offset, (i64)(0 - (u64)value));
+        }
+    } break;
+    case IR_OP_MUL: {
+        if (!has_const) {
+            return false;
+        }
+        form->scale = wrap_mul(type, form->scale, value);
+        form->offset = wrap_mul(type, form->offset, value);
+    } break;
+    case IR_OP_SHL: {
+        if (!has_const || !is_lhs_iv || value < 0 || value >= (i64)get_ir_type_size(type) * 8) {
+            return false;
+        }
+        form->scale = wrap_mul(type, form->scale, (i64)((u64)1 << value));
+        form->offset = wrap_mul(type, form->offset, (i64)((u64)1 << value));
+    } break;
+    default: {
+        return false;
+    } break;
+    };
+
+    return true;
+}
+
+// Blocks are visited in RPO, so the forms of the operands are known before their uses.
+static void derive_forms(IVOptimizer* opt) {
+    const CFGContext* ctx = opt->ctx;
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        if (!is_loop_block(opt, rpo[i])) {
+            continue;
+        }
+
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            const IRInstr* instr = cfg_context_get_instr(ctx, rpo[i], j);
+            if (instr->dst == IR_NULL_REG || instr->op == IR_OP_PHI) {
+                continue;
+            }
+
+            LinearForm form = { 0 };
+            if (derive_form(opt, instr, &form)) {
+                ((LinearForm*)opt->forms.items)[instr->dst] = form;
+            }
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region STRENGTH REDUCTION
+
+// A new variable starting at 'scale * init + offset' in the preheader and stepped by 'scale * step'
+// on every latch, next to the basic one, so its phi takes the pairs in the same order.
+static u32 create_reduction(IVOptimizer* opt, const LinearForm* form) {
+    IRFunction* func = &opt->ctx->ir;
+    BasicIV* iv = get_iv(opt, form->iv);
+    const IRType type = iv->type;
+
+    // A constant start is folded right away.
+    i64 init = 0;
+    u32 start = IR_NULL_REG;
+    if (get_const_value(opt, iv->init, &init)) {
+        start = add_pending_const(opt, type, wrap_add(type, wrap_mul(type, form->scale, init), form->offset));
+    }
+    else {
+        start = add_pending_binary(opt, opt->preheader, IR_OP_MUL, type, iv->init, add_pending_const(opt, type, form->scale));
+        if (form->offset != 0) {
+            start = add_pending_binary(opt, opt->preheader, IR_OP_ADD, type, start, add_pending_const(opt, type, form->offset));
+        }
+    }
+    const u32 step = add_pending_const(opt, type, wrap_mul(type, form->scale, iv->step));
+
+    const u32 reg = ir_function_create_reg(func, type, IR_NULL_STRING);
+    const IRInstr* iv_phi = ir_function_get_instr(func, iv->phi);
+
+    vector_clear(&opt->pairs);
+    for (u32 i = 0; i < iv_phi->as.phi.count; ++i) {
+        const u32 pred = ir_function_get_list(func, iv_phi->as.phi.first)[i * 2];
+        const u32 value = pred == opt->preheader ? start : add_pending_binary(opt, pred, IR_OP_ADD, type, reg, step);
+
+        vector_push_back(&opt->pairs, &pred);
+        vector_push_back(&opt->pairs, &value);
+    }
+
+    IRInstr phi = ir_instr_create(IR_OP_PHI, type, reg, IR_NULL_REG, IR_NULL_REG);
+    phi.as.phi.count = iv_phi->as.phi.count;
+    phi.as.phi.first = ir_function_add_list(func, (const u32*)opt->pairs.items, (u32)opt->pairs.items_count);
+    add_pending(opt, opt->header, &phi);
+
+    const Reduction reduction = { .form = *form, .reg = reg };
+    if (iv->reduction == IR_NULL_REG) {
+        iv->reduction = (u32)opt->reductions.items_count;
+    }
+    vector_push_back(&opt->reductions, &reduction);
+
+    return reg;
+}
+
+static u32 get_reduction(IVOptimizer* opt, const LinearForm* form) {
+    const Reduction* reductions = (const Reduction*)opt->reductions.items;
+
+    for (u32 i = 0; i < opt->reductions.items_count; ++i) {
+        const LinearForm* it = &reductions[i].form;
+        if (it->iv == form->iv && it->scale == form->scale && it->offset == form->offset) {
+            return reductions[i].reg;
+        }
+    }
+    return create_reduction(opt, form);
+}
+
+static u32 reduce_strength(IVOptimizer* opt) {
+    const CFGContext* ctx = opt->ctx;
+
+    u32 blocks_count = 0;
+    const u32* blocks = loop_forest_get_blocks(opt->forest, opt->loop, &blocks_count);
+
+    u32 count = 0;
+    for (u32 i = 0; i < blocks_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, blocks[i]);
+
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            IRInstr* instr = cfg_context_get_instr(ctx, blocks[i], j);
+            if (instr->op != IR_OP_MUL && instr->op != IR_OP_SHL) {
+                continue;
+            }
+
+            const LinearForm form = get_form(opt, instr->dst);
+            if (form.iv == IR_NULL_REG) {
+                continue;
+            }
+
+            const u32 reg = get_reduction(opt, &form);
+            *instr = ir_instr_create(IR_OP_COPY, instr->type, instr->dst, reg, IR_NULL_REG);
+            ++count;
+        }
+    }
+    return count;
+}
+
+#pragma endregion
+
+#pragma region TEST REPLACEMENT
+
+static IROpcode swap_compare(const IROpcode op) {
+    switch (op) {
+    case IR_OP_LT: return IR_OP_GT;
+    case IR_OP_LE: return IR_OP_GE;
+    case IR_OP_GT: return IR_OP_LT;
+    case IR_OP_GE: return IR_OP_LE;
+    default: return op;
+    };
+}
+
+static IROpcode negate_compare(const IROpcode op) {
+    switch (op) {
+    case IR_OP_LT: return IR_OP_GE;
+    case IR_OP_LE: return IR_OP_GT;
+    case IR_OP_GT: return IR_OP_LE;
+    case IR_OP_GE: return IR_OP_LT;
+    case IR_OP_EQ: return IR_OP_NE;
+    case IR_OP_NE: return IR_OP_EQ;
+    default: return op;
+    };
+}
+
+static bool is_in_type_range(const IRType type, const i64 value) {
+    const u32 bits = get_ir_type_size(type) * 8;
+    const i64 min = is_ir_type_signed(type) ? -((i64)1 << (bits - 1)) : 0;
+    const i64 max = is_ir_type_signed(type) ? ((i64)1 << (bits - 1)) - 1 : ((i64)1 << bits) - 1;
+    return min <= value && value <= max;
+}
+
+static i64 abs_i64(const i64 value) {
+    return value < 0 ? -value : value;
+}
+
+// The loop goes on while the variable moves towards the bound and leaves once it steps over it, so every value
+// the test sees lies between the start and the bound, widened by a step. When none of them, nor their images
+// under the reduced variable, can overflow, comparing the images is the same as comparing the values.
+static bool replace_exit_test(IVOptimizer* opt, IRInstr* compare, const bool continues_when_true) {
+    const bool is_lhs_iv = get_form(opt, compare->a).iv != IR_NULL_REG && get_form(opt, compare->a).scale == 1 && get_form(opt, compare->a).offset == 0;
+    const u32 iv_reg = is_lhs_iv ? compare->a : compare->b;
+    const LinearForm iv_form = get_form(opt, iv_reg);
+
+    if (iv_form.iv == IR_NULL_REG || iv_form.scale != 1 || iv_form.offset != 0 || get_iv(opt, iv_form.iv)->reg != iv_reg) {
+        return false;
+    }
+
+    const BasicIV* iv = get_iv(opt, iv_form.iv);
+    i64 bound = 0;
+    i64 init = 0;
+    if (iv->reduction == IR_NULL_REG || compare->type != iv->type || get_ir_type_size(iv->type) > 4 ||
+        !get_const_value(opt, is_lhs_iv ? compare->b : compare->a, &bound) || !get_const_value(opt, iv->init, &init)) {
+        return false;
+    }
+
+    const IROpcode op = is_lhs_iv ? compare->op : swap_compare(compare->op);
+    const IROpcode continue_op = continues_when_true ? op : negate_compare(op);
+    const bool is_towards_bound = iv->step > 0 ?
+        continue_op == IR_OP_LT || continue_op == IR_OP_LE :
+        continue_op == IR_OP_GT || continue_op == IR_OP_GE;
+    if (!is_towards_bound) {
+        return false;
+    }
+
+    const LinearForm* form = &((const Reduction*)opt->reductions.items)[iv->reduction].form;
+    if (form->scale == 0 || abs_i64(form->scale) > MAX_TEST_COEFFICIENT || abs_i64(form->offset) > MAX_TEST_COEFFICIENT || abs_i64(iv->step) > MAX_TEST_COEFFICIENT) {
+        return false;
+    }
+
+    bound = normalize_ir_value(iv->type, bound);
+    init = normalize_ir_value(iv->type, init);
+    const i64 low = (init < bound ? init : bound) - abs_i64(iv->step);
+    const i64 high = (init < bound ? bound : init) + abs_i64(iv->step);
+
+    if (!is_in_type_range(iv->type, low) || !is_in_type_range(iv->type, high) ||
+        !is_in_type_range(iv->type, form->scale * low + form->offset) || !is_in_type_range(iv->type, form->scale * high + form->offset)) {
+        return false;
+    }
+
+    // A negative scale turns the order around.
+    compare->op = form->scale > 0 ? op : swap_compare(op);
+    compare->a = ((const Reduction*)opt->reductions.items)[iv->reduction].reg;
+    compare->b = add_pending_const(opt, iv->type, form->scale * bound + form->offset);
+    return true;
+}
+
+// Only tests run on every iteration qualify, so their block has to dominate all the latches.
+static u32 replace_exit_tests(IVOptimizer* opt) {
+    const CFGContext* ctx = opt->ctx;
+
+    u32 blocks_count = 0;
+    const u32* blocks = loop_forest_get_blocks(opt->forest, opt->loop, &blocks_count);
+
+    u32 latches_count = 0;
+    const u32* latches = loop_forest_get_latches(opt->forest, opt->loop, &latches_count);
+
+    u32 count = 0;
+    for (u32 i = 0; i < blocks_count; ++i) {
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, blocks[i]);
+        if (terminator == NULL || terminator->op != IR_OP_BR) {
+            continue;
+        }
+
+        const bool is_then_inside = is_loop_block(opt, terminator->as.branch.then_block);
+        if (is_then_inside == is_loop_block(opt, terminator->as.branch.else_block)) {
+            continue;
+        }
+
+        bool is_every_iteration = true;
+        for (u32 j = 0; j < latches_count; ++j) {
+            is_every_iteration &= dominates(opt->tree, blocks[i], latches[j]);
+        }
+
+        const u32 def = terminator->a == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&opt->chains, terminator->a);
+        if (!is_every_iteration || def == IR_NULL_REG) {
+            continue;
+        }
+
+        IRInstr* compare = ir_function_get_instr(&ctx->ir, def);
+        if (is_ir_opcode_compare(compare->op) && replace_exit_test(opt, compare, is_then_inside)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+#pragma endregion
+
+// A variable whose phi only feeds its increment, which only feeds the phi back, computes nothing.
+static u32 remove_dead_ivs(IVOptimizer* opt) {
+    def_use_chains_build(&opt->chains, opt->ctx);
+    u8* removed = (u8*)opt->removed.items;
+
+    u32 count = 0;
+    for (u32 i = 0; i < opt->ivs.items_count; ++i) {
+        const BasicIV* iv = get_iv(opt, i);
+        const u32 increment = def_use_chains_get_def(&opt->chains, iv->next);
+
+        u32 uses_count = 0;
+        const u32* uses = def_use_chains_get_uses(&opt->chains, iv->reg, &uses_count);
+
+        bool is_dead = true;
+        for (u32 j = 0; j < uses_count; ++j) {
+            is_dead &= uses[j] == increment;
+        }
+
+        uses = def_use_chains_get_uses(&opt->chains, iv->next, &uses_count);
+        for (u32 j = 0; j < uses_count; ++j) {
+            is_dead &= uses[j] == iv->phi;
+        }
+
+        if (is_dead) {
+            removed[iv->phi] = true;
+            removed[increment] = true;
+            count += 2;
+        }
+    }
+    return count;
+}
+
+static u32 optimize_loop(IVOptimizer* opt, const u32 loop) {
+    CFGContext* ctx = opt->ctx;
+    const Loop* item = loop_forest_get_loop(opt->forest, loop);
+    if (item->preheader == CFG_NULL_NODE) {
+        return 0;
+    }
+
+    opt->loop = loop;
+    opt->header = item->header;
+    opt->preheader = item->preheader;
+
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+    const u32 instrs_count = ir_function_get_instrs_count(&ctx->ir);
+
+    vector_clear(&opt->ivs);
+    vector_clear(&opt->reductions);
+    vector_clear(&opt->pending);
+
+    LinearForm* forms = vector_resize(&opt->forms, regs_count);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        forms[reg] = (LinearForm) { .iv = IR_NULL_REG, .scale = 0, .offset = 0 };
+    }
+
+    memset(vector_resize(&opt->removed, instrs_count), false, instrs_count);
+
+    def_use_chains_build(&opt->chains, ctx);
+    find_basic_ivs(opt);
+    if (opt->ivs.items_count == 0) {
+        return 0;
+    }
+    derive_forms(opt);
+
+    u32 count = reduce_strength(opt);
+    count += replace_exit_tests(opt);
+    count += remove_dead_ivs(opt);
+
+    if (count > 0) {
+        apply_changes(opt);
+    }
+    return count;
+}
+
+u32 optimize_induction_variables(CFGContext* ctx) {
+    assert(ctx != NULL);
+    assert(ctx->ir.is_ssa && "Induction variables are optimized in SSA form only.");
+
+    insert_loop_preheaders(ctx);
+
+    // Rewriting instructions keeps the graph, so the analyses stay valid for all the loops.
+    IVOptimizer opt = {
+        .ctx = ctx,
+        .forest = cfg_context_get_loop_forest(ctx),
+        .tree = cfg_context_get_dominator_tree(ctx),
+        .chains = def_use_chains_create(),
+        .loop = CFG_NULL_LOOP,
+        .header = CFG_NULL_NODE,
+        .preheader = CFG_NULL_NODE,
+        .ivs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(BasicIV), NULL, false),
+        .forms = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LinearForm), NULL, false),
+        .reductions = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(Reduction), NULL, false),
+        .pending = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(PendingInstr), NULL, false),
+        .removed = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .pairs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+
+    // Inner loops follow their parents in the forest, going backwards visits them first.
+    u32 count = 0;
+    for (u32 loop = loop_forest_get_loops_count(opt.forest); loop > 0; --loop) {
+        count += optimize_loop(&opt, loop - 1);
+    }
+
+    def_use_chains_free(&opt.chains);
+    vector_free(&opt.ivs);
+    vector_free(&opt.forms);
+    vector_free(&opt.reductions);
+    vector_free(&opt.pending);
+    vector_free(&opt.removed);
+    vector_free(&opt.pairs);
+
+    return count;
+}
\ No newline at end of file
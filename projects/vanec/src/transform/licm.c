@@ -0,0 +1,315 @@
+#include "vanec/transform/licm.h"
+#include "vanec/transform/preheaders.h"
+
+#include "vanec/analysis/def_use.h"
+
+#include <assert.h>
+#include <string.h>
+
+typedef struct {
+    u32 stores_count;
+    u32 loads_count;
+    u32 calls_count;
+    u32 returns_count;
+    u32 store;          // the instruction of the last store
+    u32 store_block;
+} LoopEffects;
+
+typedef struct {
+    CFGContext* ctx;
+    const LoopForest* forest;
+    const DominatorTree* tree;
+    DefUseChains chains;
+
+    Vector is_invariant;    // u8 per register, defined by an instruction hoisted out of the current loop
+    Vector is_moved;        // u8 per instruction
+    Vector hoisted;         // u32, the instructions moved into the preheader in their order
+    u32 sunk;               // the store moved into the exit or IR_NULL_REG
+    u32 exit;
+} LoopMotion;
+
+#pragma region INVARIANTS
+
+static LoopEffects find_loop_effects(const LoopMotion* motion, const u32 loop) {
+    const CFGContext* ctx = motion->ctx;
+    LoopEffects effects = { .store = IR_NULL_REG, .store_block = CFG_NULL_NODE };
+
+    u32 blocks_count = 0;
+    const u32* blocks = loop_forest_get_blocks(motion->forest, loop, &blocks_count);
+
+    for (u32 i = 0; i < blocks_count; ++i) {
+        const CFGNode* node = cfg_context_get_node(ctx, blocks[i]);
+
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            switch (cfg_context_get_instr(ctx, blocks[i], j)->op) {
+            case IR_OP_STORE_ELEM: {
+                ++effects.stores_count;
+                effects.store = node->instrs_begin + j;
+                effects.store_block = blocks[i];
+            } break;
+            case IR_OP_LOAD_ELEM: { ++effects.loads_count; } break;
+            case IR_OP_CALL: { ++effects.calls_count; } break;
+            case IR_OP_RET: { ++effects.returns_count; } break;
+            default: break;
+            };
+        }
+    }
+
+    return effects;
+}
+
+static bool is_invariant_operand(const LoopMotion* motion, const u32 loop, const u32 reg) {
+    if (reg == IR_NULL_REG || ((const u8*)motion->is_invariant.items)[reg]) {
+        return true;
+    }
+
+    const u32 def = def_use_chains_get_def(&motion->chains, reg);
+    return def == IR_NULL_REG || !loop_contains_block(motion->forest, loop, def_use_chains_get_block(&motion->chains, def));
+}
+
+// Divisions trap on zero and on the minimum divided by -1, so they are only hoisted when the divisor rules both out.
+static bool is_safe_divisor(const LoopMotion* motion, const u32 reg) {
+    const u32 def = reg == IR_NULL_REG ? IR_NULL_REG : def_use_chains_get_def(&motion->chains, reg);
+    if (def == IR_NULL_REG) {
+        return false;
+    }
+
+    const IRInstr* instr = ir_function_get_instr(&motion->ctx->ir, def);
+    return instr->op == IR_OP_CONST && instr->as.imm != 0 && instr->as.imm != -1;
+}
+
+static bool is_trapping_instr(const LoopMotion* motion, const IRInstr* instr) {
+    if (instr->op == IR_OP_DIV || instr->op == IR_OP_REM) {
+        return !is_safe_divisor(motion, instr->b);
+    }
+    return instr->op == IR_OP_LOAD_ELEM;
+}
+
+// A load traps when the index is out of range, so it is only hoisted when the loop runs it on its first iteration.
+// That is when its block dominates every block leaving the loop, which a while loop never does for its body.
+static bool is_run_on_entry(const LoopMotion* motion, const LoopEffects* effects, const u32 loop, const u32 block) {
+    if (effects->returns_count > 0) {
+        return false;
+    }
+
+    u32 exits_count = 0;
+    const u32* exits = loop_forest_get_exits(motion->forest, loop, &exits_count);
+    if (exits_count == 0) {
+        return false;
+    }
+
+    for (u32 i = 0; i < exits_count; ++i) {
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(&motion->ctx->graph, exits[i], &preds_count);
+
+        for (u32 j = 0; j < preds_count; ++j) {
+            if (loop_contains_block(motion->forest, loop, preds[j]) && !dominates(motion->tree, block, preds[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The trap of a hoisted load must not come before the one of an instruction left in the loop, hence is_trap_pending.
+static bool can_hoist(const LoopMotion* motion, const LoopEffects* effects, const u32 loop, const u32 block, const bool is_trap_pending, IRInstr* instr) {
+    if (instr->dst == IR_NULL_REG || instr->op == IR_OP_PHI) {
+        return false;
+    }
+
+    switch (instr->op) {
+    case IR_OP_DIV:
+    case IR_OP_REM: {
+        if (!is_safe_divisor(motion, instr->b)) {
+            return false;
+        }
+    } break;
+    case IR_OP_LOAD_ELEM: {
+        if (effects->stores_count > 0 || effects->calls_count > 0 || is_trap_pending) {
+            return false;
+        }
+        if (!is_run_on_entry(motion, effects, loop, block)) {
+            return false;
+        }
+    } break;
+    default: {
+        if (!is_ir_opcode_pure(instr->op)) {
+            return false;
+        }
+    } break;
+    };
+
+    const IRFunction* func = &motion->ctx->ir;
+    const u32 uses_count = ir_function_get_uses_count(func, instr);
+    for (u32 i = 0; i < uses_count; ++i) {
+        if (!is_invariant_operand(motion, loop, *ir_function_get_use_ref(func, instr, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Blocks are visited in RPO, so the defs of the operands are decided on before their uses.
+static void hoist_invariants(LoopMotion* motion, const LoopEffects* effects, const u32 loop) {
+    const CFGContext* ctx = motion->ctx;
+    u8* is_invariant = (u8*)motion->is_invariant.items;
+    u8* is_moved = (u8*)motion->is_moved.items;
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    bool is_trap_pending = false;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        if (!loop_contains_block(motion->forest, loop, rpo[i])) {
+            continue;
+        }
+
+        const CFGNode* node = cfg_context_get_node(ctx, rpo[i]);
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            IRInstr* instr = cfg_context_get_instr(ctx, rpo[i], j);
+            if (!can_hoist(motion, effects, loop, rpo[i], is_trap_pending, instr)) {
+                is_trap_pending = is_trap_pending || is_trapping_instr(motion, instr);
+                continue;
+            }
+
+            const u32 index = node->instrs_begin + j;
+            is_moved[index] = true;
+            is_invariant[instr->dst] = true;
+            vector_push_back(&motion->hoisted, &index);
+        }
+    }
+}
+
+// Without loads and calls nothing in the loop can observe the element, so only the last store counts.
+// It is the one of the iteration leaving the loop when its block dominates every block jumping to the exit,
+// and with a single exit entered only from the loop, storing there runs exactly when the loop is left.
+static void sink_store(LoopMotion* motion, const LoopEffects* effects, const u32 loop) {
+    if (effects->stores_count != 1 || effects->loads_count > 0 || effects->calls_count > 0 || effects->returns_count > 0) {
+        return;
+    }
+
+    u32 exits_count = 0;
+    const u32* exits = loop_forest_get_exits(motion->forest, loop, &exits_count);
+    if (exits_count != 1) {
+        return;
+    }
+
+    const IRInstr* store = ir_function_get_instr(&motion->ctx->ir, effects->store);
+    if (!is_invariant_operand(motion, loop, store->a) || !is_invariant_operand(motion, loop, store->b)) {
+        return;
+    }
+
+    u32 preds_count = 0;
+    const u32* preds = cfg_graph_get_preds(&motion->ctx->graph, exits[0], &preds_count);
+    for (u32 i = 0; i < preds_count; ++i) {
+        if (!loop_contains_block(motion->forest, loop, preds[i]) || !dominates(motion->tree, effects->store_block, preds[i])) {
+            return;
+        }
+    }
+
+    ((u8*)motion->is_moved.items)[effects->store] = true;
+    motion->sunk = effects->store;
+    motion->exit = exits[0];
+}
+
+#pragma endregion
+
+// The hoisted instructions go right before the jump of the preheader, the sunk store right after the phis of the exit.
+static void move_instrs(LoopMotion* motion, const u32 preheader) {
+    CFGContext* ctx = motion->ctx;
+    IRFunction* func = &ctx->ir;
+    const u8* is_moved = (const u8*)motion->is_moved.items;
+    const u32* hoisted = (const u32*)motion->hoisted.items;
+
+    Vector instrs = vector_create(ir_function_get_instrs_count(func) + 1, sizeof(IRInstr), NULL, false);
+
+    for (u32 block = 0; block < cfg_context_get_nodes_count(ctx); ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)instrs.items_count;
+        bool is_store_pending = block == motion->exit && motion->sunk != IR_NULL_REG;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+            if (is_moved[node->instrs_begin + i]) {
+                continue;
+            }
+
+            if (block == preheader && is_ir_opcode_terminator(instr->op)) {
+                for (u32 j = 0; j < motion->hoisted.items_count; ++j) {
+                    vector_push_back(&instrs, ir_function_get_instr(func, hoisted[j]));
+                }
+            }
+            if (is_store_pending && instr->op != IR_OP_PHI) {
+                vector_push_back(&instrs, ir_function_get_instr(func, motion->sunk));
+                is_store_pending = false;
+            }
+            vector_push_back(&instrs, instr);
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+}
+
+static u32 move_loop_code(LoopMotion* motion, const u32 loop) {
+    const CFGContext* ctx = motion->ctx;
+    const u32 preheader = loop_forest_get_loop(motion->forest, loop)->preheader;
+    if (preheader == CFG_NULL_NODE) {
+        return 0;
+    }
+
+    def_use_chains_build(&motion->chains, ctx);
+    const u32 regs_count = ir_function_get_regs_count(&ctx->ir);
+    const u32 instrs_count = ir_function_get_instrs_count(&ctx->ir);
+    memset(vector_resize(&motion->is_invariant, regs_count), false, regs_count);
+    memset(vector_resize(&motion->is_moved, instrs_count), false, instrs_count);
+    vector_clear(&motion->hoisted);
+    motion->sunk = IR_NULL_REG;
+    motion->exit = CFG_NULL_NODE;
+
+    const LoopEffects effects = find_loop_effects(motion, loop);
+    hoist_invariants(motion, &effects, loop);
+    sink_store(motion, &effects, loop);
+
+    const u32 moved = (u32)motion->hoisted.items_count + (motion->sunk != IR_NULL_REG);
+    if (moved > 0) {
+        move_instrs(motion, preheader);
+    }
+    return moved;
+}
+
+u32 move_loop_invariant_code(CFGContext* ctx) {
+    assert(ctx != NULL);
+    assert(ctx->ir.is_ssa && "Loop invariant code is moved in SSA form only.");
+
+    insert_loop_preheaders(ctx);
+
+    // Moving instructions keeps the graph, so the analyses stay valid for all the loops.
+    LoopMotion motion = {
+        .ctx = ctx,
+        .forest = cfg_context_get_loop_forest(ctx),
+        .tree = cfg_context_get_dominator_tree(ctx),
+        .chains = def_use_chains_create(),
+        .is_invariant = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .is_moved = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .hoisted = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .sunk = IR_NULL_REG,
+        .exit = CFG_NULL_NODE,
+    };
+
+    // Inner loops follow their parents in the forest, going backwards visits them first.
+    u32 moved = 0;
+    for (u32 loop = loop_forest_get_loops_count(motion.forest); loop > 0; --loop) {
+        moved += move_loop_code(&motion, loop - 1);
+    }
+
+    def_use_chains_free(&motion.chains);
+    vector_free(&motion.is_invariant);
+    vector_free(&motion.is_moved);
+    vector_free(&motion.hoisted);
+
+    return moved;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "vanec/transform/optimize.h"
+
+#include <assert.h>
+
+#include "vanec/utils/profiler.h"
+#include "vanec/transform/ssa.h"
+#include "vanec/transform/simplify_cfg.h"
+#include "vanec/transform/sccp.h"
+#include "vanec/transform/gvn.h"
+#include "vanec/transform/licm.h"
+#include "vanec/transform/induction.h"
+#include "vanec/transform/divisions.h"
+
+void optimize_function(CFGContext* ctx, const bool lower_divisions, const char* name) {
+    assert(ctx != NULL && name != NULL);
+
+    if (!ctx->ir.is_ssa) {
+        PROFILE_SCOPE_BEGIN(ssa);
+        construct_ssa(ctx);
+        PROFILE_SCOPE_END(ssa, "ssa", name);
+    }
+
+    PROFILE_SCOPE_BEGIN(sccp);
+    propagate_constants(ctx);
+    PROFILE_SCOPE_END(sccp, "sccp", name);
+
+    PROFILE_SCOPE_BEGIN(gvn);
+    eliminate_common_subexpressions(ctx);
+    PROFILE_SCOPE_END(gvn, "gvn", name);
+
+    PROFILE_SCOPE_BEGIN(licm);
+    move_loop_invariant_code(ctx);
+    PROFILE_SCOPE_END(licm, "licm", name);
+
+    PROFILE_SCOPE_BEGIN(iv);
+    optimize_induction_variables(ctx);
+    PROFILE_SCOPE_END(iv, "iv", name);
+
+    if (lower_divisions) {
+        PROFILE_SCOPE_BEGIN(divisions);
+        lower_constant_divisions(ctx);
+        PROFILE_SCOPE_END(divisions, "divisions", name);
+    }
+
+    PROFILE_SCOPE_BEGIN(simplify);
+    simplify_cfg(ctx);
+    PROFILE_SCOPE_END(simplify, "simplify", name);
+}
\ No newline at end of file
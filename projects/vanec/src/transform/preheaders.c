@@ -0,0 +1,116 @@
+#include "vanec/transform/preheaders.h"
+
+#include <assert.h>
+
+static void redirect_terminator(CFGContext* ctx, const u32 block, const u32 from, const u32 to) {
+    IRInstr* terminator = cfg_context_get_terminator(ctx, block);
+    assert(terminator != NULL);
+
+    switch (terminator->op) {
+    case IR_OP_JMP: {
+        terminator->as.target = terminator->as.target == from ? to : terminator->as.target;
+    } break;
+    case IR_OP_BR: {
+        terminator->as.branch.then_block = terminator->as.branch.then_block == from ? to : terminator->as.branch.then_block;
+        terminator->as.branch.else_block = terminator->as.branch.else_block == from ? to : terminator->as.branch.else_block;
+    } break;
+    default: {
+        assert(false && "A predecessor must end with a jump.");
+    } break;
+    };
+}
+
+static void copy_phi_pairs(CFGContext* ctx, const LoopForest* forest, const u32 loop, const IRInstr* phi, const bool inside) {
+    for (u32 i = 0; i < phi->as.phi.count; ++i) {
+        const u32* incoming = ir_function_get_list(&ctx->ir, phi->as.phi.first) + i * 2;
+        if (loop_contains_block(forest, loop, incoming[0]) == inside) {
+            const u32 pair[2] = { incoming[0], incoming[1] };
+            ir_function_add_list(&ctx->ir, pair, 2);
+        }
+    }
+}
+
+// The incoming values of every header phi from outside of the loop are merged by a phi in the preheader,
+// or forwarded as they are when there is a single one. The pairs stay in the order of the preds,
+// as the preheader is the newest block it comes last.
+static void split_header_phis(CFGContext* ctx, const LoopForest* forest, const u32 loop, const u32 preheader) {
+    IRFunction* func = &ctx->ir;
+    const u32 header = loop_forest_get_loop(forest, loop)->header;
+    const u32 instrs_count = cfg_context_get_node(ctx, header)->instrs_count;
+
+    for (u32 i = 0; i < instrs_count; ++i) {
+        const IRInstr phi = *cfg_context_get_instr(ctx, header, i);
+        if (phi.op != IR_OP_PHI) {
+            break;
+        }
+
+        const u32 outside_first = (u32)func->lists.items_count;
+        copy_phi_pairs(ctx, forest, loop, &phi, false);
+        const u32 outside_count = ((u32)func->lists.items_count - outside_first) / 2;
+
+        u32 value = ir_function_get_list(func, outside_first)[1];
+        if (outside_count > 1) {
+            const IRReg original = *ir_function_get_reg(func, phi.dst);
+            value = ir_function_create_reg(func, original.type, original.name);
+            ir_function_get_reg(func, value)->elem_type = original.elem_type;
+
+            IRInstr merge = ir_instr_create(IR_OP_PHI, phi.type, value, IR_NULL_REG, IR_NULL_REG);
+            merge.as.phi.first = outside_first;
+            merge.as.phi.count = outside_count;
+            cfg_context_emit_instr(ctx, preheader, &merge);
+        }
+
+        const u32 header_first = (u32)func->lists.items_count;
+        copy_phi_pairs(ctx, forest, loop, &phi, true);
+
+        const u32 entry[2] = { preheader, value };
+        ir_function_add_list(func, entry, 2);
+
+        IRInstr* header_phi = cfg_context_get_instr(ctx, header, i);
+        header_phi->as.phi.first = header_first;
+        header_phi->as.phi.count = ((u32)func->lists.items_count - header_first) / 2;
+    }
+}
+
+u32 insert_loop_preheaders(CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    const LoopForest* forest = cfg_context_get_loop_forest(ctx);
+    const CFGGraph* graph = &ctx->graph;
+    const u32 loops_count = loop_forest_get_loops_count(forest);
+
+    u32 inserted = 0;
+    for (u32 loop = 0; loop < loops_count; ++loop) {
+        const Loop* item = loop_forest_get_loop(forest, loop);
+        if (item->preheader != CFG_NULL_NODE || item->latches_count == 0) {
+            continue;
+        }
+
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(graph, item->header, &preds_count);
+        if (preds_count == item->latches_count) {
+            continue;
+        }
+
+        const u32 preheader = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+        if (ctx->ir.is_ssa) {
+            split_header_phis(ctx, forest, loop, preheader);
+        }
+
+        IRInstr jump = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+        jump.as.target = item->header;
+        cfg_context_emit_instr(ctx, preheader, &jump);
+
+        for (u32 i = 0; i < preds_count; ++i) {
+            if (!loop_contains_block(forest, loop, preds[i])) {
+                redirect_terminator(ctx, preds[i], item->header, preheader);
+            }
+        }
+        ++inserted;
+    }
+
+    if (inserted > 0) {
+        cfg_context_build_graph(ctx, graph->entry);
+    }
+    return inserted;
+}
\ No newline at end of file
@@ -0,0 +1,476 @@
+#include "vanec/transform/sccp.h"
+#include "vanec/transform/simplify_cfg.h"
+
+#include "vanec/analysis/def_use.h"
+
+#include <assert.h>
+#include <string.h>
+
+typedef enum {
+    LATTICE_UNKNOWN,    // not computed by any executable instruction yet
+    LATTICE_CONSTANT,
+    LATTICE_VARYING,
+} LatticeState;
+
+typedef struct {
+    LatticeState state;
+    i64 value;          // normalized to the type of the defining instruction
+} LatticeValue;
+
+typedef struct {
+    CFGContext* ctx;
+    DefUseChains chains;
+
+    Vector values;          // LatticeValue per register
+    Vector is_executable;   // u8 per block
+    Vector edges;           // u8 per block and successor slot, a terminator has two successors at most
+    Vector flow_list;       // u32 pairs of the source and the target of an edge that became executable
+    Vector reg_list;        // u32, registers whose value moved down
+    Vector scratch;         // IRInstr, for reordering the phis of a block
+} SCCPSolver;
+
+static const LatticeValue VARYING_VALUE = { .state = LATTICE_VARYING, .value = 0 };
+static const LatticeValue UNKNOWN_VALUE = { .state = LATTICE_UNKNOWN, .value = 0 };
+
+static LatticeValue make_constant(const i64 value) {
+    return (LatticeValue) { .state = LATTICE_CONSTANT, .value = value };
+}
+
+#pragma region FOLDING
+
+static bool fold_compare(const IROpcode op, const bool is_signed, const i64 lhs, const i64 rhs) {
+    const bool is_less = is_signed ? lhs < rhs : (u64)lhs < (u64)rhs;
+    const bool is_equal = lhs == rhs;
+
+    switch (op) {
+    case IR_OP_EQ: return is_equal;
+    case IR_OP_NE: return !is_equal;
+    case IR_OP_LT: return is_less;
+    case IR_OP_LE: return is_less || is_equal;
+    case IR_OP_GT: return !is_less && !is_equal;
+    case IR_OP_GE: return !is_less;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+    return false;
+}
+
+// Returns false for what has to be left to run: divisions by zero and of the minimum by -1 trap,
+// and shifts by a negative amount or by the width of the type or more have no single meaning.
+static bool fold_binary(const IROpcode op, const IRType type, const i64 lhs, const i64 rhs, i64* result) {
+    const bool is_signed = is_ir_type_signed(type);
+    const u32 bits = get_ir_type_size(type) * 8;
+
+    const i64 a = normalize_ir_value(type, lhs);
+    const i64 b = normalize_ir_value(type, rhs);
+
+    // Wrapping arithmetic is done on unsigned values, where it is well defined.
+    switch (op) {
+    case IR_OP_ADD: { *result = (i64)((u64)a + (u64)b); } break;
+    case IR_OP_SUB: { *result = (i64)((u64)a - (u64)b); } break;
+    case IR_OP_MUL: { *result = (i64)((u64)a * (u64)b); } break;
+    case IR_OP_MULH: { *result = multiply_high_ir_value(type, a, b); } break;
+    case IR_OP_AND: { *result = a & b; } break;
+    case IR_OP_OR: { *result = a | b; } break;
+    case IR_OP_XOR: { *result = a ^ b; } break;
+    case IR_OP_LAND: { *result = a != 0 && b != 0; } break;
+    case IR_OP_LOR: { *result = a != 0 || b != 0; } break;
+    case IR_OP_DIV:
+    case IR_OP_REM: {
+        const i64 min = normalize_ir_value(type, (i64)((u64)1 << (bits - 1)));
+        if (b == 0 || (is_signed && a == min && b == -1)) {
+            return false;
+        }
+
+        if (is_signed) {
+            *result = op == IR_OP_DIV ? a / b : a % b;
+        }
+        else {
+            *result = (i64)(op == IR_OP_DIV ? (u64)a / (u64)b : (u64)a % (u64)b);
+        }
+    } break;
+    case IR_OP_SHL:
+    case IR_OP_SHR: {
+        // The amount keeps the value of its own register.
+        if (rhs < 0 || rhs >= (i64)bits) {
+            return false;
+        }
+
+        if (op == IR_OP_SHL) {
+            *result = (i64)((u64)a << rhs);
+        }
+        else if (is_signed && a < 0) {
+            *result = ~(i64)(~(u64)a >> rhs);
+        }
+        else {
+            *result = (i64)((u64)a >> rhs);
+        }
+    } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    *result = normalize_ir_value(type, *result);
+    return true;
+}
+
+static bool fold_unary(const IROpcode op, const IRType type, const i64 operand, i64* result) {
+    const i64 a = normalize_ir_value(type, operand);
+
+    switch (op) {
+    case IR_OP_NEG: { *result = (i64)(0 - (u64)a); } break;
+    case IR_OP_NOT: { *result = ~a; } break;
+    case IR_OP_LNOT: { *result = operand == 0; } break;
+    default: {
+        assert(false && "Unreachable");
+    } break;
+    };
+
+    *result = normalize_ir_value(type, *result);
+    return true;
+}
+
+#pragma endregion
+
+#pragma region SOLVER
+
+static LatticeValue get_value(const SCCPSolver* solver, const u32 reg) {
+    if (reg == IR_NULL_REG) {
+        return VARYING_VALUE;
+    }
+    return ((const LatticeValue*)solver->values.items)[reg];
+}
+
+static bool is_block_executable(const SCCPSolver* solver, const u32 block) {
+    return ((const u8*)solver->is_executable.items)[block];
+}
+
+static bool is_edge_executable(const SCCPSolver* solver, const u32 from, const u32 to) {
+    const IRInstr* terminator = cfg_context_get_terminator(solver->ctx, from);
+    const u8* edges = (const u8*)solver->edges.items + (u64)from * 2;
+
+    switch (terminator->op) {
+    case IR_OP_JMP: return edges[0] && terminator->as.target == to;
+    case IR_OP_BR: return (edges[0] && terminator->as.branch.then_block == to) || (edges[1] && terminator->as.branch.else_block == to);
+    default: return false;
+    };
+}
+
+static void mark_edge(SCCPSolver* solver, const u32 from, const u32 slot, const u32 to) {
+    u8* edge = (u8*)solver->edges.items + (u64)from * 2 + slot;
+    if (*edge) {
+        return;
+    }
+    *edge = true;
+
+    vector_push_back(&solver->flow_list, &from);
+    vector_push_back(&solver->flow_list, &to);
+}
+
+// Values only ever move down the lattice, two different constants meet in varying.
+static void lower_value(SCCPSolver* solver, const u32 reg, const LatticeValue value) {
+    LatticeValue* current = (LatticeValue*)solver->values.items + reg;
+
+    if (value.state == LATTICE_UNKNOWN || current->state == LATTICE_VARYING) {
+        return;
+    }
+    if (current->state == LATTICE_CONSTANT && value.state == LATTICE_CONSTANT && current->value == value.value) {
+        return;
+    }
+
+    *current = current->state == LATTICE_UNKNOWN ? value : VARYING_VALUE;
+    vector_push_back(&solver->reg_list, &reg);
+}
+
+// Only the incoming values along executable edges count, the others may never arrive.
+static LatticeValue evaluate_phi(const SCCPSolver* solver, const u32 block, const IRInstr* phi) {
+    const u32* incoming = ir_function_get_list(&solver->ctx->ir, phi->as.phi.first);
+
+    LatticeValue result = UNKNOWN_VALUE;
+    for (u32 i = 0; i < phi->as.phi.count; ++i) {
+        if (!is_edge_executable(solver, incoming[i * 2], block)) {
+            continue;
+        }
+
+        const LatticeValue value = get_value(solver, incoming[i * 2 + 1]);
+        if (value.state == LATTICE_VARYING || (result.state == LATTICE_CONSTANT && value.state == LATTICE_CONSTANT && result.value != value.value)) {
+            return VARYING_VALUE;
+        }
+        if (value.state == LATTICE_CONSTANT) {
+            result = value;
+        }
+    }
+
+    return result;
+}
+
+static LatticeValue evaluate_select(const SCCPSolver* solver, const IRInstr* instr) {
+    const LatticeValue condition = get_value(solver, instr->a);
+    const LatticeValue lhs = get_value(solver, instr->b);
+    const LatticeValue rhs = get_value(solver, instr->c);
+
+    if (condition.state == LATTICE_UNKNOWN) {
+        return UNKNOWN_VALUE;
+    }
+
+    if (condition.state == LATTICE_CONSTANT) {
+        const LatticeValue chosen = condition.value != 0 ? lhs : rhs;
+        return chosen.state == LATTICE_CONSTANT ? make_constant(normalize_ir_value(instr->type, chosen.value)) : chosen;
+    }
+
+    if (lhs.state == LATTICE_CONSTANT && rhs.state == LATTICE_CONSTANT && lhs.value == rhs.value) {
+        return make_constant(normalize_ir_value(instr->type, lhs.value));
+    }
+    return lhs.state == LATTICE_UNKNOWN || rhs.state == LATTICE_UNKNOWN ? UNKNOWN_VALUE : VARYING_VALUE;
+}
+
+static LatticeValue evaluate_instr(const SCCPSolver* solver, const u32 block, const IRInstr* instr) {
+    if (instr->op == IR_OP_PHI) {
+        return evaluate_phi(solver, block, instr);
+    }
+    if (instr->op == IR_OP_SELECT) {
+        return evaluate_select(solver, instr);
+    }
+
+    const bool is_unary = instr->op == IR_OP_COPY || is_ir_opcode_unary(instr->op);
+    const bool is_binary = is_ir_opcode_binary(instr->op) || is_ir_opcode_compare(instr->op);
+
+    if (!is_ir_type_integer(instr->type) || (instr->op != IR_OP_CONST && !is_unary && !is_binary)) {
+        return VARYING_VALUE;
+    }
+    if (instr->op == IR_OP_CONST) {
+        return make_constant(normalize_ir_value(instr->type, instr->as.imm));
+    }
+
+    const LatticeValue lhs = get_value(solver, instr->a);
+    const LatticeValue rhs = is_binary ? get_value(solver, instr->b) : lhs;
+
+    if (lhs.state == LATTICE_VARYING || rhs.state == LATTICE_VARYING) {
+        return VARYING_VALUE;
+    }
+    if (lhs.state == LATTICE_UNKNOWN || rhs.state == LATTICE_UNKNOWN) {
+        return UNKNOWN_VALUE;
+    }
+
+    // Compares are typed by their operands.
+    if (is_ir_opcode_compare(instr->op)) {
+        const i64 a = normalize_ir_value(instr->type, lhs.value);
+        const i64 b = normalize_ir_value(instr->type, rhs.value);
+        return make_constant(fold_compare(instr->op, is_ir_type_signed(instr->type), a, b));
+    }
+
+    i64 result = normalize_ir_value(instr->type, lhs.value);
+    bool is_folded = true;
+    if (instr->op != IR_OP_COPY) {
+        is_folded = is_unary ?
+            fold_unary(instr->op, instr->type, lhs.value, &result) :
+            fold_binary(instr->op, instr->type, lhs.value, rhs.value, &result);
+    }
+
+    return is_folded ? make_constant(result) : VARYING_VALUE;
+}
+
+static void visit_terminator(SCCPSolver* solver, const u32 block, const IRInstr* terminator) {
+    switch (terminator->op) {
+    case IR_OP_JMP: {
+        mark_edge(solver, block, 0, terminator->as.target);
+    } break;
+    case IR_OP_BR: {
+        const LatticeValue condition = get_value(solver, terminator->a);
+        if (condition.state == LATTICE_UNKNOWN) {
+            break;
+        }
+
+        if (condition.state == LATTICE_VARYING || condition.value != 0) {
+            mark_edge(solver, block, 0, terminator->as.branch.then_block);
+        }
+        if (condition.state == LATTICE_VARYING || condition.value == 0) {
+            mark_edge(solver, block, 1, terminator->as.branch.else_block);
+        }
+    } break;
+    default: break;
+    };
+}
+
+static void visit_instr(SCCPSolver* solver, const u32 block, const IRInstr* instr) {
+    if (is_ir_opcode_terminator(instr->op)) {
+        visit_terminator(solver, block, instr);
+    }
+    else if (instr->dst != IR_NULL_REG) {
+        lower_value(solver, instr->dst, evaluate_instr(solver, block, instr));
+    }
+}
+
+// A block is evaluated in full when its first edge becomes executable, later edges only change its phis.
+static void visit_edge(SCCPSolver* solver, const u32 to) {
+    const CFGContext* ctx = solver->ctx;
+    const CFGNode* node = cfg_context_get_node(ctx, to);
+    u8* is_executable = (u8*)solver->is_executable.items + to;
+
+    const bool is_first = !*is_executable;
+    *is_executable = true;
+
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        const IRInstr* instr = cfg_context_get_instr(ctx, to, i);
+        if (!is_first && instr->op != IR_OP_PHI) {
+            break;
+        }
+        visit_instr(solver, to, instr);
+    }
+}
+
+static void solve(SCCPSolver* solver) {
+    const CFGContext* ctx = solver->ctx;
+    const IRFunction* func = &ctx->ir;
+    const u32 regs_count = ir_function_get_regs_count(func);
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    def_use_chains_build(&solver->chains, ctx);
+
+    // Parameters and registers without a def, read where they are undefined, can hold anything.
+    LatticeValue* values = vector_resize(&solver->values, regs_count);
+    for (u32 reg = 0; reg < regs_count; ++reg) {
+        values[reg] = def_use_chains_get_def(&solver->chains, reg) == IR_NULL_REG ? VARYING_VALUE : UNKNOWN_VALUE;
+    }
+
+    memset(vector_resize(&solver->is_executable, nodes_count), false, nodes_count);
+
+    memset(vector_resize(&solver->edges, (u64)nodes_count * 2), false, (u64)nodes_count * 2);
+
+    visit_edge(solver, ctx->graph.entry);
+
+    while (solver->flow_list.items_count > 0 || solver->reg_list.items_count > 0) {
+        while (solver->flow_list.items_count > 0) {
+            solver->flow_list.items_count -= 2;
+            visit_edge(solver, ((const u32*)solver->flow_list.items)[solver->flow_list.items_count + 1]);
+        }
+
+        while (solver->reg_list.items_count > 0) {
+            const u32 reg = ((const u32*)solver->reg_list.items)[--solver->reg_list.items_count];
+
+            u32 uses_count = 0;
+            const u32* uses = def_use_chains_get_uses(&solver->chains, reg, &uses_count);
+            for (u32 i = 0; i < uses_count; ++i) {
+                const u32 block = def_use_chains_get_block(&solver->chains, uses[i]);
+                if (is_block_executable(solver, block)) {
+                    visit_instr(solver, block, ir_function_get_instr(func, uses[i]));
+                }
+            }
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region REWRITING
+
+// Phis turned into consts are moved behind the remaining ones, which have to stay at the start of the block.
+static void reorder_phis(SCCPSolver* solver, const u32 block, const u32 phis_count) {
+    const CFGContext* ctx = solver->ctx;
+    IRInstr* instrs = cfg_context_get_instr(ctx, block, 0);
+
+    vector_clear(&solver->scratch);
+    for (u32 pass = 0; pass < 2; ++pass) {
+        for (u32 i = 0; i < phis_count; ++i) {
+            if ((instrs[i].op == IR_OP_PHI) == (pass == 0)) {
+                vector_push_back(&solver->scratch, &instrs[i]);
+            }
+        }
+    }
+    memcpy(instrs, solver->scratch.items, phis_count * sizeof(IRInstr));
+}
+
+// Returns the number of rewritten instructions, the count of folded branches is added to the second one.
+static u32 rewrite_block(SCCPSolver* solver, const u32 block, u32* branches_count) {
+    CFGContext* ctx = solver->ctx;
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+
+    u32 phis_count = 0;
+    bool has_const_phis = false;
+    u32 count = 0;
+
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        IRInstr* instr = cfg_context_get_instr(ctx, block, i);
+        phis_count += instr->op == IR_OP_PHI && phis_count == i;
+
+        if (instr->op == IR_OP_BR) {
+            const LatticeValue condition = get_value(solver, instr->a);
+            if (condition.state == LATTICE_CONSTANT) {
+                const u32 target = condition.value != 0 ? instr->as.branch.then_block : instr->as.branch.else_block;
+                *instr = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+                instr->as.target = target;
+
+                ++*branches_count;
+                ++count;
+            }
+            continue;
+        }
+
+        if (instr->dst == IR_NULL_REG || instr->op == IR_OP_CONST) {
+            continue;
+        }
+
+        const LatticeValue value = get_value(solver, instr->dst);
+        if (value.state != LATTICE_CONSTANT) {
+            continue;
+        }
+
+        // Compares are typed by their operands, the const takes the type of the register.
+        const IRType type = ir_function_get_reg(&ctx->ir, instr->dst)->type;
+        has_const_phis |= instr->op == IR_OP_PHI;
+
+        *instr = ir_instr_create(IR_OP_CONST, type, instr->dst, IR_NULL_REG, IR_NULL_REG);
+        instr->as.imm = normalize_ir_value(type, value.value);
+        ++count;
+    }
+
+    if (has_const_phis) {
+        reorder_phis(solver, block, phis_count);
+    }
+    return count;
+}
+
+#pragma endregion
+
+u32 propagate_constants(CFGContext* ctx) {
+    assert(ctx != NULL);
+    assert(ctx->ir.is_ssa && "Constants are propagated in SSA form only.");
+
+    SCCPSolver solver = {
+        .ctx = ctx,
+        .chains = def_use_chains_create(),
+        .values = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(LatticeValue), NULL, false),
+        .is_executable = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .edges = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .flow_list = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .reg_list = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .scratch = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(IRInstr), NULL, false),
+    };
+
+    solve(&solver);
+
+    // Blocks that never execute are left alone, the jumps around them make them unreachable.
+    u32 count = 0;
+    u32 branches_count = 0;
+    for (u32 block = 0; block < cfg_context_get_nodes_count(ctx); ++block) {
+        if (is_block_executable(&solver, block)) {
+            count += rewrite_block(&solver, block, &branches_count);
+        }
+    }
+
+    def_use_chains_free(&solver.chains);
+    vector_free(&solver.values);
+    vector_free(&solver.is_executable);
+    vector_free(&solver.edges);
+    vector_free(&solver.flow_list);
+    vector_free(&solver.reg_list);
+    vector_free(&solver.scratch);
+
+    if (branches_count > 0) {
+        cfg_context_build_graph(ctx, ctx->graph.entry);
+        simplify_cfg(ctx);
+    }
+    return count;
+}
\ No newline at end of file
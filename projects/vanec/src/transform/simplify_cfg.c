@@ -0,0 +1,438 @@
+#include "vanec/transform/simplify_cfg.h"
+
+#include <assert.h>
+#include <string.h>
+
+static bool is_phi_block(const CFGContext* ctx, const u32 block) {
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    return node->instrs_count > 0 && ir_function_get_instr(&ctx->ir, node->instrs_begin)->op == IR_OP_PHI;
+}
+
+static void make_jump(IRInstr* terminator, const u32 target) {
+    *terminator = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+    terminator->as.target = target;
+}
+
+typedef struct {
+    CFGContext* ctx;
+    u32 nodes_count;
+
+    Vector defs;        // u32 per register, the instruction defining it in SSA form
+    Vector forward;     // u32 per block, the final target of a jump into it or CFG_NULL_NODE
+    Vector next;        // u32 per block, the succ merged into it or CFG_NULL_NODE
+    Vector is_merged;   // u8 per block
+    Vector new_ids;     // u32 per block, the block it ends up in or CFG_NULL_NODE
+    Vector stamps;      // u32 per block, scratch for the pred lookups
+    Vector seen;        // u32 per block, scratch for the phi pairs
+    Vector stack;       // u32
+} CFGSimplifier;
+
+#pragma region BRANCHES
+
+// The instruction defining the condition of the branch: the last one before it in the block,
+// or in SSA the only one anywhere.
+static const IRInstr* find_condition_def(const CFGSimplifier* simplifier, const u32 block, const u32 reg) {
+    const CFGContext* ctx = simplifier->ctx;
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+
+    for (u32 i = node->instrs_count - 1; i > 0; --i) {
+        const IRInstr* instr = cfg_context_get_instr(ctx, block, i - 1);
+        if (instr->dst == reg) {
+            return instr;
+        }
+    }
+
+    if (!ctx->ir.is_ssa) {
+        return NULL;
+    }
+
+    const u32 def = ((const u32*)simplifier->defs.items)[reg];
+    return def == IR_NULL_REG ? NULL : ir_function_get_instr(&ctx->ir, def);
+}
+
+// Returns whether any branch was turned into a jump.
+static bool fold_branches(CFGSimplifier* simplifier) {
+    CFGContext* ctx = simplifier->ctx;
+    const IRFunction* func = &ctx->ir;
+
+    if (func->is_ssa) {
+        const u32 null_reg = IR_NULL_REG;
+        u32* defs = vector_resize(&simplifier->defs, ir_function_get_regs_count(func));
+        vector_fill(&simplifier->defs, &null_reg);
+
+        const u32 instrs_count = ir_function_get_instrs_count(func);
+        for (u32 i = 0; i < instrs_count; ++i) {
+            const u32 dst = ir_function_get_instr(func, i)->dst;
+            if (dst != IR_NULL_REG) {
+                defs[dst] = i;
+            }
+        }
+    }
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    bool changed = false;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        IRInstr* terminator = cfg_context_get_terminator(ctx, rpo[i]);
+        if (terminator == NULL || terminator->op != IR_OP_BR) {
+            continue;
+        }
+
+        const u32 then_block = terminator->as.branch.then_block;
+        const u32 else_block = terminator->as.branch.else_block;
+        const IRInstr* def = find_condition_def(simplifier, rpo[i], terminator->a);
+
+        if (then_block == else_block) {
+            make_jump(terminator, then_block);
+            changed = true;
+        }
+        else if (def != NULL && def->op == IR_OP_CONST) {
+            make_jump(terminator, def->as.imm != 0 ? then_block : else_block);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+#pragma endregion
+
+#pragma region JUMP THREADING
+
+// A block holding nothing but a jump somewhere else. In SSA the edges into a phi block are named
+// by the phi pairs, so jumps are never rerouted into one.
+static bool is_forwarding_block(const CFGContext* ctx, const u32 block) {
+    if (block == ctx->graph.entry || cfg_context_get_node(ctx, block)->instrs_count != 1) {
+        return false;
+    }
+
+    const IRInstr* terminator = cfg_context_get_terminator(ctx, block);
+    if (terminator == NULL || terminator->op != IR_OP_JMP || terminator->as.target == block) {
+        return false;
+    }
+    return !ctx->ir.is_ssa || !is_phi_block(ctx, terminator->as.target);
+}
+
+// Follows a chain of forwarding blocks to its end, compressing the path on the way back.
+// A cycle made only of forwarding blocks stops at the block closing it, which stays as an empty loop.
+static u32 resolve_target(CFGSimplifier* simplifier, const u32 block) {
+    const CFGContext* ctx = simplifier->ctx;
+    u32* forward = (u32*)simplifier->forward.items;
+
+    vector_clear(&simplifier->stack);
+
+    u32 it = block;
+    while (forward[it] == CFG_NULL_NODE && is_forwarding_block(ctx, it)) {
+        forward[it] = it;
+        vector_push_back(&simplifier->stack, &it);
+        it = cfg_context_get_terminator(ctx, it)->as.target;
+    }
+
+    const u32 target = forward[it] == CFG_NULL_NODE ? it : forward[it];
+
+    const u32* stack = (const u32*)simplifier->stack.items;
+    for (u64 i = 0; i < simplifier->stack.items_count; ++i) {
+        forward[stack[i]] = target;
+    }
+    return target;
+}
+
+// Returns whether any terminator was changed.
+static bool thread_jumps(CFGSimplifier* simplifier) {
+    CFGContext* ctx = simplifier->ctx;
+
+    const u32 null_node = CFG_NULL_NODE;
+    vector_resize(&simplifier->forward, simplifier->nodes_count);
+    vector_fill(&simplifier->forward, &null_node);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    bool changed = false;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        IRInstr* terminator = cfg_context_get_terminator(ctx, rpo[i]);
+        if (terminator == NULL) {
+            continue;
+        }
+
+        if (terminator->op == IR_OP_JMP) {
+            const u32 target = resolve_target(simplifier, terminator->as.target);
+            changed |= target != terminator->as.target;
+            terminator->as.target = target;
+        }
+        else if (terminator->op == IR_OP_BR) {
+            const u32 then_block = resolve_target(simplifier, terminator->as.branch.then_block);
+            const u32 else_block = resolve_target(simplifier, terminator->as.branch.else_block);
+
+            changed |= then_block != terminator->as.branch.then_block || else_block != terminator->as.branch.else_block;
+            terminator->as.branch.then_block = then_block;
+            terminator->as.branch.else_block = else_block;
+
+            if (then_block == else_block) {
+                make_jump(terminator, then_block);
+            }
+        }
+    }
+
+    return changed;
+}
+
+#pragma endregion
+
+#pragma region MERGING
+
+static u32 find_incoming_value(const IRFunction* func, const IRInstr* phi, const u32 pred) {
+    const u32* incoming = ir_function_get_list(func, phi->as.phi.first);
+    for (u32 i = 0; i < phi->as.phi.count; ++i) {
+        if (incoming[i * 2] == pred) {
+            return incoming[i * 2 + 1];
+        }
+    }
+    return IR_NULL_REG;
+}
+
+// The phis of a merged block turn into copies, which needs a defined value for every one of them.
+static bool can_merge_blocks(const CFGContext* ctx, const u32 pred, const u32 block) {
+    if (block == pred || block == ctx->graph.entry) {
+        return false;
+    }
+
+    u32 preds_count = 0;
+    cfg_graph_get_preds(&ctx->graph, block, &preds_count);
+    if (preds_count != 1) {
+        return false;
+    }
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        const IRInstr* phi = cfg_context_get_instr(ctx, block, i);
+        if (phi->op != IR_OP_PHI) {
+            break;
+        }
+        if (find_incoming_value(&ctx->ir, phi, pred) == IR_NULL_REG) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Links every block to the succ merged into it, the chains start at the blocks that are not merged themselves.
+static void find_merges(CFGSimplifier* simplifier) {
+    const CFGContext* ctx = simplifier->ctx;
+
+    const u32 null_node = CFG_NULL_NODE;
+    u32* next = vector_resize(&simplifier->next, simplifier->nodes_count);
+    vector_fill(&simplifier->next, &null_node);
+
+    u8* is_merged = vector_resize(&simplifier->is_merged, simplifier->nodes_count);
+    memset(is_merged, false, simplifier->nodes_count);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(&ctx->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const IRInstr* terminator = cfg_context_get_terminator(ctx, rpo[i]);
+        if (terminator == NULL || terminator->op != IR_OP_JMP || !can_merge_blocks(ctx, rpo[i], terminator->as.target)) {
+            continue;
+        }
+
+        next[rpo[i]] = terminator->as.target;
+        is_merged[terminator->as.target] = true;
+    }
+}
+
+#pragma endregion
+
+#pragma region RELAYOUT
+
+static void remap_terminator(IRInstr* terminator, const u32* new_ids) {
+    if (terminator->op == IR_OP_JMP) {
+        terminator->as.target = new_ids[terminator->as.target];
+    }
+    else if (terminator->op == IR_OP_BR) {
+        terminator->as.branch.then_block = new_ids[terminator->as.branch.then_block];
+        terminator->as.branch.else_block = new_ids[terminator->as.branch.else_block];
+    }
+}
+
+// Keeps the first pair of every pred still leading to the block and renames it,
+// the pairs are then sorted by the new ids, which is the order of the new preds.
+static void remap_phi(CFGSimplifier* simplifier, IRInstr* phi, const u32 block, const u32 phi_stamp) {
+    IRFunction* func = &simplifier->ctx->ir;
+    const u32* new_ids = (const u32*)simplifier->new_ids.items;
+    const u32* stamps = (const u32*)simplifier->stamps.items;
+    u32* seen = (u32*)simplifier->seen.items;
+
+    const u32 first = (u32)func->lists.items_count;
+    for (u32 i = 0; i < phi->as.phi.count; ++i) {
+        const u32* incoming = ir_function_get_list(func, phi->as.phi.first) + i * 2;
+        if (stamps[incoming[0]] != block || seen[incoming[0]] == phi_stamp) {
+            continue;
+        }
+        seen[incoming[0]] = phi_stamp;
+
+        const u32 pair[2] = { new_ids[incoming[0]], incoming[1] };
+        ir_function_add_list(func, pair, 2);
+    }
+
+    const u32 count = ((u32)func->lists.items_count - first) / 2;
+    u32* pairs = ir_function_get_list(func, first);
+
+    for (u32 i = 1; i < count; ++i) {
+        const u32 pair[2] = { pairs[i * 2], pairs[i * 2 + 1] };
+
+        u32 j = i;
+        for (; j > 0 && pairs[(j - 1) * 2] > pair[0]; --j) {
+            pairs[j * 2] = pairs[(j - 1) * 2];
+            pairs[j * 2 + 1] = pairs[(j - 1) * 2 + 1];
+        }
+        pairs[j * 2] = pair[0];
+        pairs[j * 2 + 1] = pair[1];
+    }
+
+    phi->as.phi.first = first;
+    phi->as.phi.count = count;
+}
+
+// Rebuilds the node and the instruction pools with a block per chain, in RPO.
+// Only the last block of a chain keeps its terminator, the phis of the others become copies.
+static void relayout_blocks(CFGSimplifier* simplifier) {
+    CFGContext* ctx = simplifier->ctx;
+    IRFunction* func = &ctx->ir;
+    const CFGGraph* graph = &ctx->graph;
+
+    const u32* next = (const u32*)simplifier->next.items;
+    const u8* is_merged = simplifier->is_merged.items;
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(graph, &rpo_count);
+
+    const u32 null_node = CFG_NULL_NODE;
+    u32* new_ids = vector_resize(&simplifier->new_ids, simplifier->nodes_count);
+    vector_fill(&simplifier->new_ids, &null_node);
+
+    u32 new_count = 0;
+    for (u32 i = 0; i < rpo_count; ++i) {
+        if (is_merged[rpo[i]]) {
+            continue;
+        }
+        for (u32 it = rpo[i]; it != CFG_NULL_NODE; it = next[it]) {
+            new_ids[it] = new_count;
+        }
+        ++new_count;
+    }
+
+    const u32 zero = 0;
+    u32* stamps = vector_resize(&simplifier->stamps, simplifier->nodes_count);
+    vector_fill(&simplifier->stamps, &null_node);
+    vector_resize(&simplifier->seen, simplifier->nodes_count);
+    vector_fill(&simplifier->seen, &zero);
+    u32 phi_stamp = 0;
+
+    Vector nodes = vector_create(new_count + 1, sizeof(CFGNode), NULL, false);
+    Vector instrs = vector_create(func->instrs.items_count + 1, sizeof(IRInstr), NULL, false);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 head = rpo[i];
+        if (is_merged[head]) {
+            continue;
+        }
+
+        if (is_phi_block(ctx, head)) {
+            u32 preds_count = 0;
+            const u32* preds = cfg_graph_get_preds(graph, head, &preds_count);
+            for (u32 j = 0; j < preds_count; ++j) {
+                stamps[preds[j]] = head;
+            }
+        }
+
+        const CFGNode* head_node = cfg_context_get_node(ctx, head);
+        CFGNode node = cfg_node_create(head_node->kind, new_ids[head], head_node->scope);
+        node.instrs_begin = (u32)instrs.items_count;
+
+        for (u32 it = head, prev = CFG_NULL_NODE; it != CFG_NULL_NODE; prev = it, it = next[it]) {
+            const CFGNode* it_node = cfg_context_get_node(ctx, it);
+
+            for (u32 j = 0; j < it_node->instrs_count; ++j) {
+                IRInstr instr = *ir_function_get_instr(func, it_node->instrs_begin + j);
+
+                if (is_ir_opcode_terminator(instr.op)) {
+                    if (next[it] != CFG_NULL_NODE) {
+                        continue;
+                    }
+                    remap_terminator(&instr, new_ids);
+                }
+                else if (instr.op == IR_OP_PHI && it != head) {
+                    instr = ir_instr_create(IR_OP_COPY, instr.type, instr.dst, find_incoming_value(func, &instr, prev), IR_NULL_REG);
+                }
+                else if (instr.op == IR_OP_PHI) {
+                    remap_phi(simplifier, &instr, head, ++phi_stamp);
+                }
+
+                vector_push_back(&instrs, &instr);
+            }
+        }
+
+        node.instrs_count = (u32)instrs.items_count - node.instrs_begin;
+        vector_push_back(&nodes, &node);
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+
+    vector_free(&ctx->nodes);
+    ctx->nodes = nodes;
+}
+
+#pragma endregion
+
+u32 simplify_cfg(CFGContext* ctx) {
+    assert(ctx != NULL);
+
+    const u32 initial_count = cfg_context_get_nodes_count(ctx);
+
+    CFGSimplifier simplifier = {
+        .ctx = ctx,
+        .nodes_count = 0,
+        .defs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .forward = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .next = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .is_merged = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u8), NULL, false),
+        .new_ids = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .stamps = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .seen = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+
+    // Merging can bring a constant and the branch on it into one block, so the steps are repeated
+    // until a round changes nothing. A round is linear in the size of the function.
+    bool changed = true;
+    while (changed) {
+        simplifier.nodes_count = cfg_context_get_nodes_count(ctx);
+
+        changed = fold_branches(&simplifier);
+        changed |= thread_jumps(&simplifier);
+        if (changed) {
+            cfg_context_build_graph(ctx, ctx->graph.entry);
+        }
+
+        find_merges(&simplifier);
+        relayout_blocks(&simplifier);
+
+        const u32 entry = ((const u32*)simplifier.new_ids.items)[ctx->graph.entry];
+        changed |= cfg_context_get_nodes_count(ctx) != simplifier.nodes_count;
+        cfg_context_build_graph(ctx, entry);
+    }
+
+    vector_free(&simplifier.defs);
+    vector_free(&simplifier.forward);
+    vector_free(&simplifier.next);
+    vector_free(&simplifier.is_merged);
+    vector_free(&simplifier.new_ids);
+    vector_free(&simplifier.stamps);
+    vector_free(&simplifier.seen);
+    vector_free(&simplifier.stack);
+
+    return initial_count - cfg_context_get_nodes_count(ctx);
+}
\ No newline at end of file
@@ -0,0 +1,619 @@
+#include "vanec/transform/ssa.h"
+
+#include <assert.h>
+#include <string.h>
+
+static void push_u32_pair(Vector* vector, const u32 first, const u32 second) {
+    vector_push_back(vector, &first);
+    vector_push_back(vector, &second);
+}
+
+// Sorts (key, value) pairs into CSR form by key, keeping the order of the values of each key.
+static void build_csr(const Vector* pairs, const u32 keys_count, Vector* offsets_vector, Vector* values_vector) {
+    const u32 pairs_count = (u32)(pairs->items_count / 2);
+    const u32* items = (const u32*)pairs->items;
+
+    u32* offsets = vector_resize(offsets_vector, keys_count + 1);
+    memset(offsets, 0, (keys_count + 1) * sizeof(u32));
+
+    for (u32 i = 0; i < pairs_count; ++i) {
+        ++offsets[items[i * 2] + 1];
+    }
+    for (u32 key = 0; key < keys_count; ++key) {
+        offsets[key + 1] += offsets[key];
+    }
+
+    u32* values = vector_resize(values_vector, pairs_count);
+    for (u32 i = 0; i < pairs_count; ++i) {
+        values[offsets[items[i * 2]]++] = items[i * 2 + 1];
+    }
+
+    for (u32 key = keys_count; key > 0; --key) {
+        offsets[key] = offsets[key - 1];
+    }
+    offsets[0] = 0;
+}
+
+static bool is_phi_block(const CFGContext* ctx, const u32 block) {
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+    return node->instrs_count > 0 && ir_function_get_instr(&ctx->ir, node->instrs_begin)->op == IR_OP_PHI;
+}
+
+#pragma region CONSTRUCTION
+
+typedef struct {
+    CFGContext* ctx;
+    const CFGGraph* graph;
+    const DominatorTree* tree;
+
+    u32 nodes_count;
+    u32 regs_count;     // registers before the renaming, the only ones with several definitions
+
+    Vector def_block_offsets;
+    Vector def_blocks;
+    Vector phi_offsets;
+    Vector phi_regs;
+    Vector phi_vars;    // u32 per instruction, the register a phi was placed for
+
+    Vector curr;        // u32 per register, the version visible at the current point of the walk
+    Vector undo;        // (register, previous version) pairs
+    Vector has_def;     // u32 per register, whether the original number is taken
+} SSABuilder;
+
+// A register is global if it is read in a block before being defined there,
+// only those can need a phi. The blocks defining every register are collected on the way.
+static void find_globals_and_def_blocks(SSABuilder* builder, u8* is_global) {
+    const IRFunction* func = &builder->ctx->ir;
+
+    Vector pairs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector defined_in = vector_create(builder->regs_count + 1, sizeof(u32), NULL, false);
+
+    const u32 null_node = CFG_NULL_NODE;
+    u32* last_def_block = vector_resize(&defined_in, builder->regs_count);
+    vector_fill(&defined_in, &null_node);
+
+    u32 rpo_count = 0;
+    const u32* rpo = cfg_graph_get_rpo(builder->graph, &rpo_count);
+
+    for (u32 i = 0; i < rpo_count; ++i) {
+        const u32 block = rpo[i];
+        const CFGNode* node = cfg_context_get_node(builder->ctx, block);
+
+        for (u32 j = 0; j < node->instrs_count; ++j) {
+            IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + j);
+
+            const u32 uses_count = ir_function_get_uses_count(func, instr);
+            for (u32 k = 0; k < uses_count; ++k) {
+                const u32 reg = *ir_function_get_use_ref(func, instr, k);
+                if (reg != IR_NULL_REG && last_def_block[reg] != block) {
+                    is_global[reg] = true;
+                }
+            }
+
+            if (instr->dst != IR_NULL_REG && last_def_block[instr->dst] != block) {
+                last_def_block[instr->dst] = block;
+                push_u32_pair(&pairs, instr->dst, block);
+            }
+        }
+    }
+
+    build_csr(&pairs, builder->regs_count, &builder->def_block_offsets, &builder->def_blocks);
+
+    vector_free(&defined_in);
+    vector_free(&pairs);
+}
+
+// Iterated dominance frontier of the definitions of every global register, with a worklist per register.
+static void place_phis(SSABuilder* builder, const u8* is_global) {
+    Vector pairs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector worklist = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector stamps = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+
+    const u32 null_reg = IR_NULL_REG;
+    u32* has_phi = vector_resize(&stamps, builder->nodes_count * 2);
+    u32* in_worklist = has_phi + builder->nodes_count;
+    vector_fill(&stamps, &null_reg);
+
+    const u32* def_offsets = (const u32*)builder->def_block_offsets.items;
+    const u32* def_blocks = (const u32*)builder->def_blocks.items;
+
+    for (u32 reg = 0; reg < builder->regs_count; ++reg) {
+        if (!is_global[reg]) {
+            continue;
+        }
+
+        vector_clear(&worklist);
+        for (u32 i = def_offsets[reg]; i < def_offsets[reg + 1]; ++i) {
+            in_worklist[def_blocks[i]] = reg;
+            vector_push_back(&worklist, &def_blocks[i]);
+        }
+
+        while (worklist.items_count > 0) {
+            const u32 block = ((const u32*)worklist.items)[--worklist.items_count];
+
+            u32 frontier_count = 0;
+            const u32* frontier = dominator_tree_get_frontier(builder->tree, block, &frontier_count);
+
+            for (u32 i = 0; i < frontier_count; ++i) {
+                const u32 join = frontier[i];
+                if (has_phi[join] == reg) {
+                    continue;
+                }
+                has_phi[join] = reg;
+                push_u32_pair(&pairs, join, reg);
+
+                if (in_worklist[join] != reg) {
+                    in_worklist[join] = reg;
+                    vector_push_back(&worklist, &join);
+                }
+            }
+        }
+    }
+
+    build_csr(&pairs, builder->nodes_count, &builder->phi_offsets, &builder->phi_regs);
+
+    vector_free(&stamps);
+    vector_free(&worklist);
+    vector_free(&pairs);
+}
+
+// Rebuilds the pool with the phis in front of every block. The incoming blocks are set here,
+// the incoming registers are filled by the renaming.
+static void insert_phis(SSABuilder* builder) {
+    CFGContext* ctx = builder->ctx;
+    IRFunction* func = &ctx->ir;
+
+    const u32* phi_offsets = (const u32*)builder->phi_offsets.items;
+    const u32* phi_regs = (const u32*)builder->phi_regs.items;
+
+    Vector instrs = vector_create(func->instrs.items_count + builder->phi_regs.items_count + 1, sizeof(IRInstr), NULL, false);
+    vector_clear(&builder->phi_vars);
+
+    for (u32 block = 0; block < builder->nodes_count; ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)instrs.items_count;
+
+        u32 preds_count = 0;
+        const u32* preds = cfg_graph_get_preds(builder->graph, block, &preds_count);
+
+        for (u32 i = phi_offsets[block]; i < phi_offsets[block + 1]; ++i) {
+            const u32 reg = phi_regs[i];
+
+            IRInstr phi = ir_instr_create(IR_OP_PHI, ir_function_get_reg(func, reg)->type, reg, IR_NULL_REG, IR_NULL_REG);
+            phi.as.phi.first = (u32)func->lists.items_count;
+            phi.as.phi.count = preds_count;
+
+            for (u32 j = 0; j < preds_count; ++j) {
+                push_u32_pair(&func->lists, preds[j], IR_NULL_REG);
+            }
+
+            vector_push_back(&instrs, &phi);
+            vector_push_back(&builder->phi_vars, &reg);
+        }
+
+        // Nothing in an unreachable block can run, only the terminator is kept to preserve the shape of the graph.
+        const bool is_reachable = is_cfg_node_reachable(builder->graph, block);
+        const u32 first = is_reachable || node->instrs_count == 0 ? 0 : node->instrs_count - 1;
+
+        for (u32 i = first; i < node->instrs_count; ++i) {
+            IRInstr instr = *ir_function_get_instr(func, node->instrs_begin + i);
+            if (!is_reachable) {
+                instr.a = IR_NULL_REG;
+            }
+
+            const u32 none = IR_NULL_REG;
+            vector_push_back(&instrs, &instr);
+            vector_push_back(&builder->phi_vars, &none);
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+}
+
+static u32 create_version(SSABuilder* builder, const u32 reg) {
+    u32* has_def = (u32*)builder->has_def.items;
+    if (!has_def[reg]) {
+        has_def[reg] = true;
+        return reg;
+    }
+
+    IRFunction* func = &builder->ctx->ir;
+    const IRReg original = *ir_function_get_reg(func, reg);
+
+    const u32 version = ir_function_create_reg(func, original.type, original.name);
+    ir_function_get_reg(func, version)->elem_type = original.elem_type;
+
+    return version;
+}
+
+static void push_version(SSABuilder* builder, const u32 reg, const u32 version) {
+    u32* curr = (u32*)builder->curr.items;
+
+    push_u32_pair(&builder->undo, reg, curr[reg]);
+    curr[reg] = version;
+}
+
+static void rename_block(SSABuilder* builder, const u32 block) {
+    CFGContext* ctx = builder->ctx;
+    IRFunction* func = &ctx->ir;
+    const u32* phi_vars = (const u32*)builder->phi_vars.items;
+    const u32* curr = (const u32*)builder->curr.items;
+
+    const CFGNode* node = cfg_context_get_node(ctx, block);
+
+    for (u32 i = 0; i < node->instrs_count; ++i) {
+        const u32 index = node->instrs_begin + i;
+        IRInstr* instr = ir_function_get_instr(func, index);
+
+        if (instr->op != IR_OP_PHI) {
+            const u32 uses_count = ir_function_get_uses_count(func, instr);
+            for (u32 j = 0; j < uses_count; ++j) {
+                u32* reg = ir_function_get_use_ref(func, instr, j);
+                if (*reg != IR_NULL_REG) {
+                    *reg = curr[*reg];
+                }
+            }
+        }
+
+        if (instr->dst != IR_NULL_REG) {
+            const u32 reg = instr->op == IR_OP_PHI ? phi_vars[index] : instr->dst;
+            const u32 version = create_version(builder, reg);
+
+            push_version(builder, reg, version);
+            curr = (const u32*)builder->curr.items;
+
+            ir_function_get_instr(func, index)->dst = version;
+        }
+    }
+
+    u32 succs_count = 0;
+    const u32* succs = cfg_graph_get_succs(builder->graph, block, &succs_count);
+    const u32* pred_indices = cfg_graph_get_succ_pred_indices(builder->graph, block, &succs_count);
+
+    for (u32 i = 0; i < succs_count; ++i) {
+        const CFGNode* succ = cfg_context_get_node(ctx, succs[i]);
+
+        for (u32 j = 0; j < succ->instrs_count; ++j) {
+            const u32 index = succ->instrs_begin + j;
+            const IRInstr* phi = ir_function_get_instr(func, index);
+            if (phi->op != IR_OP_PHI) {
+                break;
+            }
+
+            u32* incoming = ir_function_get_list(func, phi->as.phi.first);
+            incoming[pred_indices[i] * 2 + 1] = curr[phi_vars[index]];
+        }
+    }
+}
+
+// Preorder walk of the dominator tree. The versions pushed by a block are undone when its subtree is done.
+static void rename_registers(SSABuilder* builder) {
+    const IRFunction* func = &builder->ctx->ir;
+
+    const u32 null_reg = IR_NULL_REG;
+    const u32 zero = 0;
+    u32* curr = vector_resize(&builder->curr, builder->regs_count);
+    u32* has_def = vector_resize(&builder->has_def, builder->regs_count);
+    vector_fill(&builder->curr, &null_reg);
+    vector_fill(&builder->has_def, &zero);
+
+    for (u32 reg = 0; reg < func->params_count; ++reg) {
+        curr[reg] = reg;
+        has_def[reg] = true;
+    }
+
+    Vector stack = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+
+    const u32 entry = builder->tree->entry;
+    const u32 mark = 0;
+
+    rename_block(builder, entry);
+    vector_push_back(&stack, &entry);
+    vector_push_back(&stack, &zero);
+    vector_push_back(&stack, &mark);
+
+    while (stack.items_count > 0) {
+        u32* top = (u32*)stack.items + stack.items_count - 3;
+
+        u32 children_count = 0;
+        const u32* children = dominator_tree_get_children(builder->tree, top[0], &children_count);
+
+        if (top[1] == children_count) {
+            curr = (u32*)builder->curr.items;
+
+            const u32* undo = (const u32*)builder->undo.items;
+            for (u64 i = builder->undo.items_count; i > top[2]; i -= 2) {
+                curr[undo[i - 2]] = undo[i - 1];
+            }
+            builder->undo.items_count = top[2];
+
+            stack.items_count -= 3;
+            continue;
+        }
+
+        const u32 child = children[top[1]++];
+        const u32 child_mark = (u32)builder->undo.items_count;
+
+        rename_block(builder, child);
+        vector_push_back(&stack, &child);
+        vector_push_back(&stack, &zero);
+        vector_push_back(&stack, &child_mark);
+    }
+
+    vector_free(&stack);
+}
+
+void construct_ssa(CFGContext* ctx) {
+    assert(ctx != NULL && !ctx->ir.is_ssa);
+
+    SSABuilder builder = {
+        .ctx = ctx,
+        .graph = &ctx->graph,
+        .tree = cfg_context_get_dominator_tree(ctx),
+        .nodes_count = cfg_context_get_nodes_count(ctx),
+        .regs_count = ir_function_get_regs_count(&ctx->ir),
+        .def_block_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .def_blocks = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .phi_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .phi_regs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .phi_vars = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .curr = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .undo = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .has_def = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+
+    Vector globals = vector_create(builder.regs_count + 1, sizeof(u8), NULL, false);
+    u8* is_global = vector_resize(&globals, builder.regs_count);
+    memset(is_global, 0, builder.regs_count);
+
+    find_globals_and_def_blocks(&builder, is_global);
+    place_phis(&builder, is_global);
+    insert_phis(&builder);
+    rename_registers(&builder);
+
+    vector_free(&globals);
+    vector_free(&builder.def_block_offsets);
+    vector_free(&builder.def_blocks);
+    vector_free(&builder.phi_offsets);
+    vector_free(&builder.phi_regs);
+    vector_free(&builder.phi_vars);
+    vector_free(&builder.curr);
+    vector_free(&builder.undo);
+    vector_free(&builder.has_def);
+
+    ctx->ir.is_ssa = true;
+}
+
+#pragma endregion
+
+#pragma region DESTRUCTION
+
+// Blocks ending with a branch get a new block on every edge into a phi block,
+// so the copies of an edge are never executed on the other one.
+static void split_critical_edges(CFGContext* ctx) {
+    const CFGGraph* graph = &ctx->graph;
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+
+    for (u32 block = 0; block < nodes_count; ++block) {
+        if (!is_cfg_node_reachable(graph, block)) {
+            continue;
+        }
+
+        u32 succs_count = 0;
+        const u32* succs = cfg_graph_get_succs(graph, block, &succs_count);
+        const u32* pred_indices = cfg_graph_get_succ_pred_indices(graph, block, &succs_count);
+        if (succs_count < 2) {
+            continue;
+        }
+
+        for (u32 i = 0; i < succs_count; ++i) {
+            if (!is_phi_block(ctx, succs[i])) {
+                continue;
+            }
+
+            const u32 split = cfg_context_create_cfg_node(ctx, CFG_BASIC_BLOCK_NODE);
+
+            IRInstr jump = ir_instr_create(IR_OP_JMP, IR_TYPE_VOID, IR_NULL_REG, IR_NULL_REG, IR_NULL_REG);
+            jump.as.target = succs[i];
+            cfg_context_emit_instr(ctx, split, &jump);
+
+            IRInstr* terminator = cfg_context_get_terminator(ctx, block);
+            assert(terminator != NULL && terminator->op == IR_OP_BR);
+            if (i == 0) {
+                terminator->as.branch.then_block = split;
+            }
+            else {
+                terminator->as.branch.else_block = split;
+            }
+
+            const CFGNode* succ = cfg_context_get_node(ctx, succs[i]);
+            for (u32 j = 0; j < succ->instrs_count; ++j) {
+                const IRInstr* phi = cfg_context_get_instr(ctx, succs[i], j);
+                if (phi->op != IR_OP_PHI) {
+                    break;
+                }
+                ir_function_get_list(&ctx->ir, phi->as.phi.first)[pred_indices[i] * 2] = split;
+            }
+        }
+    }
+}
+
+typedef struct {
+    CFGContext* ctx;
+    Vector* instrs;
+
+    u32* loc;           // per register, where the value the register had before the copies is now
+    u32* pred;          // per register, the source of the copy into it
+    Vector ready;
+    Vector todo;
+} CopySequencer;
+
+static void emit_copy(CopySequencer* seq, const u32 dst, const u32 src) {
+    const IRType type = ir_function_get_reg(&seq->ctx->ir, dst)->type;
+
+    const IRInstr copy = ir_instr_create(IR_OP_COPY, type, dst, src, IR_NULL_REG);
+    vector_push_back(seq->instrs, &copy);
+}
+
+// Sequentializes the parallel copies (dst, src) of one block, a cycle is broken with a new temporary register.
+static void emit_parallel_copies(CopySequencer* seq, const u32* copies, const u32 count) {
+    vector_clear(&seq->ready);
+    vector_clear(&seq->todo);
+
+    for (u32 i = 0; i < count; ++i) {
+        const u32 dst = copies[i * 2];
+        const u32 src = copies[i * 2 + 1];
+
+        seq->loc[src] = src;
+        seq->pred[dst] = src;
+        vector_push_back(&seq->todo, &dst);
+    }
+
+    // Registers no other copy reads from can be overwritten right away.
+    for (u32 i = 0; i < count; ++i) {
+        const u32 dst = copies[i * 2];
+        if (seq->loc[dst] == IR_NULL_REG) {
+            vector_push_back(&seq->ready, &dst);
+        }
+    }
+
+    while (seq->todo.items_count > 0) {
+        while (seq->ready.items_count > 0) {
+            const u32 dst = ((const u32*)seq->ready.items)[--seq->ready.items_count];
+            const u32 src = seq->pred[dst];
+            const u32 from = seq->loc[src];
+
+            emit_copy(seq, dst, from);
+            seq->loc[src] = dst;
+
+            if (src == from && seq->pred[src] != IR_NULL_REG) {
+                vector_push_back(&seq->ready, &src);
+            }
+        }
+
+        const u32 dst = ((const u32*)seq->todo.items)[--seq->todo.items_count];
+        if (dst != seq->loc[seq->pred[dst]]) {
+            const IRReg* reg = ir_function_get_reg(&seq->ctx->ir, dst);
+            const u32 temp = ir_function_create_reg(&seq->ctx->ir, reg->type, IR_NULL_STRING);
+
+            emit_copy(seq, temp, dst);
+            seq->loc[dst] = temp;
+            vector_push_back(&seq->ready, &dst);
+        }
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        seq->loc[copies[i * 2]] = IR_NULL_REG;
+        seq->loc[copies[i * 2 + 1]] = IR_NULL_REG;
+        seq->pred[copies[i * 2]] = IR_NULL_REG;
+    }
+}
+
+void destruct_ssa(CFGContext* ctx) {
+    assert(ctx != NULL && ctx->ir.is_ssa);
+
+    split_critical_edges(ctx);
+
+    IRFunction* func = &ctx->ir;
+    const u32 nodes_count = cfg_context_get_nodes_count(ctx);
+    const u32 regs_count = ir_function_get_regs_count(func);
+
+    // (block, dst, src) triples, grouped by the block the copies are placed in.
+    Vector pairs = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector copy_offsets = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector copy_indices = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector copies = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+
+    for (u32 block = 0; block < nodes_count; ++block) {
+        const CFGNode* node = cfg_context_get_node(ctx, block);
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* phi = cfg_context_get_instr(ctx, block, i);
+            if (phi->op != IR_OP_PHI) {
+                break;
+            }
+
+            const u32* incoming = ir_function_get_list(func, phi->as.phi.first);
+            for (u32 j = 0; j < phi->as.phi.count; ++j) {
+                const u32 src = incoming[j * 2 + 1];
+                if (src == IR_NULL_REG || src == phi->dst) {
+                    continue;
+                }
+
+                push_u32_pair(&pairs, incoming[j * 2], (u32)(copies.items_count / 2));
+                push_u32_pair(&copies, phi->dst, src);
+            }
+        }
+    }
+
+    build_csr(&pairs, nodes_count, &copy_offsets, &copy_indices);
+
+    Vector group = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector state = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false);
+    Vector instrs = vector_create(func->instrs.items_count + copies.items_count + 1, sizeof(IRInstr), NULL, false);
+
+    const u32 null_reg = IR_NULL_REG;
+    u32* loc = vector_resize(&state, regs_count * 2);
+    vector_fill(&state, &null_reg);
+
+    CopySequencer seq = {
+        .ctx = ctx,
+        .instrs = &instrs,
+        .loc = loc,
+        .pred = loc + regs_count,
+        .ready = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+        .todo = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(u32), NULL, false),
+    };
+
+    const u32* offsets = (const u32*)copy_offsets.items;
+    const u32* indices = (const u32*)copy_indices.items;
+    const u32* all_copies = (const u32*)copies.items;
+
+    for (u32 block = 0; block < nodes_count; ++block) {
+        CFGNode* node = cfg_context_get_node(ctx, block);
+        const u32 begin = (u32)instrs.items_count;
+
+        for (u32 i = 0; i < node->instrs_count; ++i) {
+            const IRInstr* instr = ir_function_get_instr(func, node->instrs_begin + i);
+            if (instr->op == IR_OP_PHI) {
+                continue;
+            }
+
+            if (is_ir_opcode_terminator(instr->op) && offsets[block] != offsets[block + 1]) {
+                assert(instr->op == IR_OP_JMP && "The copies must be on a non critical edge.");
+
+                vector_clear(&group);
+                for (u32 j = offsets[block]; j < offsets[block + 1]; ++j) {
+                    push_u32_pair(&group, all_copies[indices[j] * 2], all_copies[indices[j] * 2 + 1]);
+                }
+                emit_parallel_copies(&seq, (const u32*)group.items, offsets[block + 1] - offsets[block]);
+            }
+
+            vector_push_back(&instrs, instr);
+        }
+
+        node->instrs_begin = begin;
+        node->instrs_count = (u32)instrs.items_count - begin;
+    }
+
+    vector_free(&func->instrs);
+    func->instrs = instrs;
+    func->is_ssa = false;
+
+    vector_free(&seq.ready);
+    vector_free(&seq.todo);
+    vector_free(&state);
+    vector_free(&group);
+    vector_free(&copies);
+    vector_free(&copy_indices);
+    vector_free(&copy_offsets);
+    vector_free(&pairs);
+
+    cfg_context_build_graph(ctx, ctx->graph.entry);
+}
+
+#pragma endregion
\ No newline at end of file
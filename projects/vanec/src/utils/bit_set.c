@@ -0,0 +1,197 @@
+#include "vanec/utils/bit_set.h"
+
+#include <assert.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The set operations are written for two words at a time with SSE2, which every x64 target has,
+// and fall back to a word at a time elsewhere and for the odd word at the end.
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BIT_SET_USE_SSE2
+#endif
+
+static u32 count_word_bits(const u64 word) {
+#ifdef _MSC_VER
+    return (u32)__popcnt64(word);
+#else
+    return (u32)__builtin_popcountll(word);
+#endif
+}
+
+static u32 get_lowest_bit(const u64 word) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, word);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctzll(word);
+#endif
+}
+
+#ifdef BIT_SET_USE_SSE2
+static bool is_vector_zero(const __m128i v) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
+u32 bit_set_get_words_count(const u32 bits_count) {
+    return (bits_count + BIT_SET_WORD_BITS - 1) / BIT_SET_WORD_BITS;
+}
+
+void bit_set_add(u64* set, const u32 bit) {
+    assert(set != NULL);
+
+    set[bit / BIT_SET_WORD_BITS] |= (u64)1 << (bit % BIT_SET_WORD_BITS);
+}
+
+void bit_set_remove(u64* set, const u32 bit) {
+    assert(set != NULL);
+
+    set[bit / BIT_SET_WORD_BITS] &= ~((u64)1 << (bit % BIT_SET_WORD_BITS));
+}
+
+bool bit_set_contains(const u64* set, const u32 bit) {
+    assert(set != NULL);
+
+    return (set[bit / BIT_SET_WORD_BITS] >> (bit % BIT_SET_WORD_BITS)) & 1;
+}
+
+void bit_set_fill(u64* set, const u32 bits_count, const bool value) {
+    const u32 words_count = bit_set_get_words_count(bits_count);
+    assert(set != NULL || words_count == 0);
+
+    memset(set, value ? 0xFF : 0, words_count * sizeof(u64));
+
+    // The bits past the size stay clear, so they are never found by bit_set_next.
+    if (value && bits_count % BIT_SET_WORD_BITS != 0) {
+        set[words_count - 1] &= ((u64)1 << (bits_count % BIT_SET_WORD_BITS)) - 1;
+    }
+}
+
+void bit_set_copy(u64* dst, const u64* src, const u32 words_count) {
+    assert((dst != NULL && src != NULL) || words_count == 0);
+
+    memcpy(dst, src, words_count * sizeof(u64));
+}
+
+bool bit_set_equals(const u64* a, const u64* b, const u32 words_count) {
+    assert((a != NULL && b != NULL) || words_count == 0);
+
+    return memcmp(a, b, words_count * sizeof(u64)) == 0;
+}
+
+bool bit_set_union(u64* dst, const u64* src, const u32 words_count) {
+    assert((dst != NULL && src != NULL) || words_count == 0);
+
+    u32 i = 0;
+    u64 changed = 0;
+
+#ifdef BIT_SET_USE_SSE2
+    __m128i changed_bits = _mm_setzero_si128();
+    for (; i + 2 <= words_count; i += 2) {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i result = _mm_or_si128(old, _mm_loadu_si128((const __m128i*)(src + i)));
+
+        changed_bits = _mm_or_si128(changed_bits, _mm_xor_si128(old, result));
+        _mm_storeu_si128((__m128i*)(dst + i), result);
+    }
+    changed = !is_vector_zero(changed_bits);
+#endif
+
+    for (; i < words_count; ++i) {
+        const u64 result = dst[i] | src[i];
+        changed |= dst[i] ^ result;
+        dst[i] = result;
+    }
+
+    return changed != 0;
+}
+
+bool bit_set_intersect(u64* dst, const u64* src, const u32 words_count) {
+    assert((dst != NULL && src != NULL) || words_count == 0);
+
+    u32 i = 0;
+    u64 changed = 0;
+
+#ifdef BIT_SET_USE_SSE2
+    __m128i changed_bits = _mm_setzero_si128();
+    for (; i + 2 <= words_count; i += 2) {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i result = _mm_and_si128(old, _mm_loadu_si128((const __m128i*)(src + i)));
+
+        changed_bits = _mm_or_si128(changed_bits, _mm_xor_si128(old, result));
+        _mm_storeu_si128((__m128i*)(dst + i), result);
+    }
+    changed = !is_vector_zero(changed_bits);
+#endif
+
+    for (; i < words_count; ++i) {
+        const u64 result = dst[i] & src[i];
+        changed |= dst[i] ^ result;
+        dst[i] = result;
+    }
+
+    return changed != 0;
+}
+
+bool bit_set_transfer(u64* dst, const u64* src, const u64* gen, const u64* kill, const u32 words_count) {
+    assert((dst != NULL && src != NULL && gen != NULL && kill != NULL) || words_count == 0);
+
+    u32 i = 0;
+    u64 changed = 0;
+
+#ifdef BIT_SET_USE_SSE2
+    __m128i changed_bits = _mm_setzero_si128();
+    for (; i + 2 <= words_count; i += 2) {
+        const __m128i old = _mm_loadu_si128((const __m128i*)(dst + i));
+        const __m128i kept = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(kill + i)), _mm_loadu_si128((const __m128i*)(src + i)));
+        const __m128i result = _mm_or_si128(_mm_loadu_si128((const __m128i*)(gen + i)), kept);
+
+        changed_bits = _mm_or_si128(changed_bits, _mm_xor_si128(old, result));
+        _mm_storeu_si128((__m128i*)(dst + i), result);
+    }
+    changed = !is_vector_zero(changed_bits);
+#endif
+
+    for (; i < words_count; ++i) {
+        const u64 result = gen[i] | (src[i] & ~kill[i]);
+        changed |= dst[i] ^ result;
+        dst[i] = result;
+    }
+
+    return changed != 0;
+}
+
+u32 bit_set_count(const u64* set, const u32 words_count) {
+    assert(set != NULL || words_count == 0);
+
+    u32 count = 0;
+    for (u32 i = 0; i < words_count; ++i) {
+        count += count_word_bits(set[i]);
+    }
+    return count;
+}
+
+u32 bit_set_next(const u64* set, const u32 words_count, const u32 from) {
+    assert(set != NULL || words_count == 0);
+
+    u32 i = from / BIT_SET_WORD_BITS;
+    if (i >= words_count) {
+        return BIT_SET_NULL_BIT;
+    }
+
+    // The bits before from are masked off in the first word.
+    u64 word = set[i] & (~(u64)0 << (from % BIT_SET_WORD_BITS));
+    while (word == 0) {
+        if (++i == words_count) {
+            return BIT_SET_NULL_BIT;
+        }
+        word = set[i];
+    }
+
+    return i * BIT_SET_WORD_BITS + get_lowest_bit(word);
+}
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "vanec/utils/profiler.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vanec/utils/vector.h"
+#include "vanec/utils/string_utils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <stdatomic.h>
+#include <time.h>
+#endif
+
+#define TIME_REPORT_TOP_FUNCTIONS_COUNT 10
+
+typedef struct {
+    Vector events;
+    Vector counters;
+    u64 origin_ns;
+    bool enabled;
+} Profiler;
+
+static Profiler profiler = { 0 };
+
+#ifdef _WIN32
+static volatile LONG next_thread_id = 0;
+#else
+static atomic_ulong next_thread_id = 0;
+#endif
+static _Thread_local u32 thread_id = 0;
+
+// The threads get their ids on first use, which may happen on several of them at once.
+static u32 get_thread_id(void) {
+    if (thread_id == 0) {
+#ifdef _WIN32
+        thread_id = (u32)InterlockedIncrement(&next_thread_id);
+#else
+        thread_id = atomic_fetch_add(&next_thread_id, 1) + 1;
+#endif
+    }
+    return thread_id;
+}
+
+// The events and counters are shared by the threads. Recording only holds the lock around the push or the counter update.
+#ifdef _WIN32
+static volatile LONG is_profiler_locked = 0;
+
+static void profiler_lock(void) {
+    while (InterlockedExchange(&is_profiler_locked, 1) != 0) {
+        YieldProcessor();
+    }
+}
+
+static void profiler_unlock(void) {
+    InterlockedExchange(&is_profiler_locked, 0);
+}
+#else
+static atomic_flag is_profiler_locked = ATOMIC_FLAG_INIT;
+
+static void profiler_lock(void) {
+    while (atomic_flag_test_and_set_explicit(&is_profiler_locked, memory_order_acquire)) {
+    }
+}
+
+static void profiler_unlock(void) {
+    atomic_flag_clear_explicit(&is_profiler_locked, memory_order_release);
+}
+#endif
+
+static void profiler_event_free(ProfilerEvent* event) {
+    if (event == NULL) {
+        return;
+    }
+    str_free(event->name);
+}
+
+static void profiler_counter_free(ProfilerCounter* counter) {
+    if (counter == NULL) {
+        return;
+    }
+    str_free(counter->name);
+}
+
+void profiler_enable(void) {
+    if (profiler.enabled) {
+        return;
+    }
+
+    profiler.events = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ProfilerEvent), &profiler_event_free, false);
+    profiler.counters = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ProfilerCounter), &profiler_counter_free, false);
+    profiler.origin_ns = profiler_now_ns();
+    profiler.enabled = true;
+}
+
+void profiler_disable(void) {
+    if (!profiler.enabled) {
+        return;
+    }
+
+    vector_free(&profiler.events);
+    vector_free(&profiler.counters);
+    profiler.enabled = false;
+}
+
+bool is_profiler_enabled(void) {
+    return profiler.enabled;
+}
+
+u64 profiler_now_ns(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = { 0 };
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    const u64 seconds = (u64)(counter.QuadPart / frequency.QuadPart);
+    const u64 rest = (u64)(counter.QuadPart % frequency.QuadPart);
+
+    return seconds * 1000000000ull + (rest * 1000000000ull) / (u64)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+#endif
+}
+
+u64 profiler_scope_begin(void) {
+    if (!profiler.enabled) {
+        return 0;
+    }
+    return profiler_now_ns();
+}
+
+void profiler_scope_end(const char* category, const char* name, const u64 start_ns) {
+    if (!profiler.enabled) {
+        return;
+    }
+    assert(category != NULL && name != NULL);
+
+    const u64 end_ns = profiler_now_ns();
+
+    ProfilerEvent event = {
+        .name = str_dup(name),
+        .category = category,
+        .start_ns = start_ns - profiler.origin_ns,
+        .duration_ns = end_ns - start_ns,
+        .tid = get_thread_id(),
+    };
+
+    profiler_lock();
+    vector_push_back(&profiler.events, &event);
+    profiler_unlock();
+}
+
+void profiler_scope_accumulate(const char* category, const char* name, const u64 start_ns) {
+    if (!profiler.enabled) {
+        return;
+    }
+    assert(category != NULL && name != NULL);
+
+    const u64 duration_ns = profiler_now_ns() - start_ns;
+
+    profiler_lock();
+    for (u64 i = 0; i < profiler.counters.items_count; ++i) {
+        ProfilerCounter* counter = vector_get_ref(&profiler.counters, i);
+
+        if (counter->category == category || str_eq(counter->category, category)) {
+            if (str_eq(counter->name, name)) {
+                counter->total_ns += duration_ns;
+                ++counter->count;
+                profiler_unlock();
+                return;
+            }
+        }
+    }
+
+    ProfilerCounter counter = {
+        .name = str_dup(name),
+        .category = category,
+        .total_ns = duration_ns,
+        .count = 1,
+    };
+
+    vector_push_back(&profiler.counters, &counter);
+    profiler_unlock();
+}
+
+typedef struct {
+    const char* name;
+    u64 total_ns;
+    u64 count;
+} ProfilerSummaryRow;
+
+static int compare_events_by_category(const void* lhs, const void* rhs) {
+    const ProfilerEvent* a = *(const ProfilerEvent**)lhs;
+    const ProfilerEvent* b = *(const ProfilerEvent**)rhs;
+    return strcmp(a->category, b->category);
+}
+
+static int compare_events_by_name(const void* lhs, const void* rhs) {
+    const ProfilerEvent* a = *(const ProfilerEvent**)lhs;
+    const ProfilerEvent* b = *(const ProfilerEvent**)rhs;
+    return strcmp(a->name, b->name);
+}
+
+static int compare_summary_rows(const void* lhs, const void* rhs) {
+    const ProfilerSummaryRow* a = lhs;
+    const ProfilerSummaryRow* b = rhs;
+    if (a->total_ns == b->total_ns) {
+        return 0;
+    }
+    return a->total_ns < b->total_ns ? 1 : -1;
+}
+
+// Groups the events by the given key (events are sorted by that key first),
+// so the report stays O(n log n) even for hundreds of thousands of functions.
+static Vector summarize_events(const ProfilerEvent** events, const u64 count, const bool by_category, const char* skip_category) {
+    Vector rows = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(ProfilerSummaryRow), NULL, false);
+
+    qsort((void*)events, count, sizeof(ProfilerEvent*), by_category ? &compare_events_by_category : &compare_events_by_name);
+
+    for (u64 i = 0; i < count; ++i) {
+        const ProfilerEvent* event = events[i];
+        if (skip_category != NULL && str_eq(event->category, skip_category)) {
+            continue;
+        }
+
+        const char* key = by_category ? event->category : event->name;
+
+        ProfilerSummaryRow* last = rows.items_count > 0 ? vector_get_ref(&rows, rows.items_count - 1) : NULL;
+        if (last != NULL && str_eq(last->name, key)) {
+            last->total_ns += event->duration_ns;
+            ++last->count;
+            continue;
+        }
+
+        ProfilerSummaryRow row = {
+            .name = key,
+            .total_ns = event->duration_ns,
+            .count = 1,
+        };
+        vector_push_back(&rows, &row);
+    }
+
+    qsort(rows.items, rows.items_count, sizeof(ProfilerSummaryRow), &compare_summary_rows);
+
+    return rows;
+}
+
+static void print_summary_row(const char* name, const u64 total_ns, const u64 count, const u64 wall_ns) {
+    const double total_ms = (double)total_ns / 1e6;
+    const double percent = wall_ns == 0 ? 0.0 : (double)total_ns * 100.0 / (double)wall_ns;
+
+    printf("  %-44s %12.3f %10lld %7.2f%%\n", name, total_ms, count, percent);
+}
+
+void profiler_print_time_report(void) {
+    if (!profiler.enabled) {
+        return;
+    }
+
+    const u64 wall_ns = profiler_now_ns() - profiler.origin_ns;
+
+    const u64 count = profiler.events.items_count;
+    const ProfilerEvent** events = malloc((count + 1) * sizeof(ProfilerEvent*));
+    assert(events != NULL);
+
+    for (u64 i = 0; i < count; ++i) {
+        events[i] = vector_get_ref(&profiler.events, i);
+    }
+
+    printf("\n===== Time report (wall %.3f ms) =====\n", (double)wall_ns / 1e6);
+    printf("  %-44s %12s %10s %8s\n", "phase", "total, ms", "count", "wall");
+
+    Vector phases = summarize_events(events, count, true, NULL);
+    for (u64 i = 0; i < phases.items_count; ++i) {
+        const ProfilerSummaryRow* row = vector_get_ref(&phases, i);
+        print_summary_row(row->name, row->total_ns, row->count, wall_ns);
+    }
+    vector_free(&phases);
+
+    for (u64 i = 0; i < profiler.counters.items_count; ++i) {
+        const ProfilerCounter* counter = vector_get_ref(&profiler.counters, i);
+        char* name = str_format("%s (%s, accumulated)", counter->category, counter->name);
+        print_summary_row(name, counter->total_ns, counter->count, wall_ns);
+        str_free(name);
+    }
+
+    // Per function rows merge every phase recorded under the function name.
+    Vector functions = summarize_events(events, count, false, "file");
+    if (functions.items_count > 0) {
+        printf("\n  %-44s %12s %10s %8s\n", "top functions", "total, ms", "events", "wall");
+
+        for (u64 i = 0; i < functions.items_count && i < TIME_REPORT_TOP_FUNCTIONS_COUNT; ++i) {
+            const ProfilerSummaryRow* row = vector_get_ref(&functions, i);
+            print_summary_row(row->name, row->total_ns, row->count, wall_ns);
+        }
+    }
+    vector_free(&functions);
+
+    free((void*)events);
+}
+
+static void write_json_string(FILE* handle, const char* s) {
+    putc('\"', handle);
+    for (; *s != '\0'; ++s) {
+        const char ch = *s;
+        switch (ch) {
+        case '\"':  { fputs("\\\"", handle); } break;
+        case '\\':  { fputs("\\\\", handle); } break;
+        case '\n':  { fputs("\\n", handle); } break;
+        case '\r':  { fputs("\\r", handle); } break;
+        case '\t':  { fputs("\\t", handle); } break;
+        default: {
+            if ((u8)ch < 0x20) {
+                fprintf(handle, "\\u%04x", (u32)(u8)ch);
+            }
+            else {
+                putc(ch, handle);
+            }
+        } break;
+        };
+    }
+    putc('\"', handle);
+}
+
+bool profiler_write_trace_file(const char* filepath) {
+    assert(filepath != NULL);
+
+    if (!profiler.enabled) {
+        return false;
+    }
+
+    FILE* file = NULL;
+    i32 status = fopen_s(&file, filepath, "wb");
+    if (status != 0 || file == NULL) {
+        printf("Error: failed to open file \"%s\".\n", filepath);
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+    u32 max_tid = 0;
+    u64 last_ts_ns = 0;
+
+    for (u64 i = 0; i < profiler.events.items_count; ++i) {
+        const ProfilerEvent* event = vector_get_ref(&profiler.events, i);
+
+        fputs("{\"name\":", file);
+        write_json_string(file, event->name);
+        fputs(",\"cat\":", file);
+        write_json_string(file, event->category);
+        fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%ld},\n",
+            (double)event->start_ns / 1e3,
+            (double)event->duration_ns / 1e3,
+            event->tid
+        );
+
+        if (event->tid > max_tid) {
+            max_tid = event->tid;
+        }
+        if (event->start_ns + event->duration_ns > last_ts_ns) {
+            last_ts_ns = event->start_ns + event->duration_ns;
+        }
+    }
+
+    for (u64 i = 0; i < profiler.counters.items_count; ++i) {
+        const ProfilerCounter* counter = vector_get_ref(&profiler.counters, i);
+
+        fputs("{\"name\":", file);
+        write_json_string(file, counter->category);
+        fprintf(file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{", (double)last_ts_ns / 1e3);
+        write_json_string(file, counter->name);
+        fprintf(file, ":%.3f}},\n", (double)counter->total_ns / 1e6);
+    }
+
+    for (u32 tid = 1; tid <= max_tid; ++tid) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":\"vanec thread #%ld\"}},\n", tid, tid);
+    }
+
+    fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"vanec\"}}\n]}\n", file);
+
+    fclose(file);
+
+    printf("Saved trace to \"%s\".\n", filepath);
+
+    return true;
+}
\ No newline at end of file
@@ -9,6 +9,7 @@
 StringBuilder string_builder_create(void) {
     return (StringBuilder) {
         .buffer = vector_create(DEFAULT_VECTOR_CAPACITY, sizeof(char), NULL, false),
+        .head = 0,
     };
 }
 
@@ -18,13 +19,39 @@ void string_builder_free(StringBuilder* sb) {
     }
 
     vector_free(&sb->buffer);
+    sb->head = 0;
+}
+
+// Makes at least `count` free bytes in front of the text.
+// The gap grows with the text, so a sequence of left appends moves every byte O(1) times.
+static void string_builder_reserve_left(StringBuilder* sb, const u64 count) {
+    if (sb->head >= count) {
+        return;
+    }
+
+    const u64 len = string_builder_get_len(sb);
+
+    u64 gap = len > DEFAULT_VECTOR_CAPACITY ? len : DEFAULT_VECTOR_CAPACITY;
+    if (gap < count) {
+        gap = count;
+    }
+
+    const u64 new_head = sb->head + gap;
+
+    vector_reserve(&sb->buffer, new_head + len + 1);
+    memmove(sb->buffer.items + new_head, sb->buffer.items + sb->head, len);
+
+    sb->buffer.items_count = new_head + len;
+    sb->head = new_head;
 }
 
 void string_builder_append_char_left(StringBuilder* sb, const char ch) {
     assert(sb != NULL);
     assert(ch != '\0');
 
-    vector_push_front(&sb->buffer, &ch);
+    string_builder_reserve_left(sb, 1);
+
+    sb->buffer.items[--sb->head] = (u8)ch;
 }
 
 void string_builder_append_char_right(StringBuilder* sb, const char ch) {
@@ -39,13 +66,23 @@ void string_builder_append_str_left(StringBuilder* sb, const char* s) {
 
     const u64 slen = strlen(s);
 
-    vector_insert(&sb->buffer, sb->buffer.items, s, slen);
+    if (slen == 0) {
+        return;
+    }
+
+    string_builder_reserve_left(sb, slen);
+
+    sb->head -= slen;
+    memcpy(sb->buffer.items + sb->head, s, slen);
 }
 
 void string_builder_append_str_right(StringBuilder* sb, const char* s) {
     assert(sb != NULL && s != NULL);
 
     const u64 slen = strlen(s);
+    if (slen == 0) {
+        return;
+    }
 
     vector_insert(&sb->buffer, (u8*)sb->buffer.items + sb->buffer.items_count, s, slen);
 }
@@ -70,19 +107,36 @@ void string_builder_append_format(StringBuilder* sb, const char* format, ...) {
 
     assert(count >= 0);
 
-    vector_insert(&sb->buffer, (u8*)sb->buffer.items + sb->buffer.items_count, buffer, (u64)count);
+    if (count > 0) {
+        vector_insert(&sb->buffer, (u8*)sb->buffer.items + sb->buffer.items_count, buffer, (u64)count);
+    }
 
     free(buffer);
 }
 
+u64 string_builder_get_len(const StringBuilder* sb) {
+    assert(sb != NULL);
+
+    return sb->buffer.items_count - sb->head;
+}
+
+char string_builder_get_char(const StringBuilder* sb, const u64 index) {
+    assert(sb != NULL);
+    assert(index < string_builder_get_len(sb));
+
+    return (char)sb->buffer.items[sb->head + index];
+}
+
 char* string_builder_get_str(const StringBuilder* sb) {
     assert(sb != NULL);
 
-    char* res = malloc(sb->buffer.items_count + 1);
+    const u64 len = string_builder_get_len(sb);
+
+    char* res = malloc(len + 1);
     assert(res != NULL);
 
-    memcpy(res, sb->buffer.items, sb->buffer.items_count);
-    res[sb->buffer.items_count] = '\0';
+    memcpy(res, sb->buffer.items + sb->head, len);
+    res[len] = '\0';
 
     return res;
 }
\ No newline at end of file
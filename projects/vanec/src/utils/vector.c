@@ -4,7 +4,7 @@
 #include <string.h>
 #include <stdlib.h>
 
-static void vector_resize(Vector* vector, const u64 capacity) {
+static void vector_grow(Vector* vector, const u64 capacity) {
     assert(vector != NULL);
     assert(capacity > vector->capacity);
 
@@ -62,13 +62,44 @@ void vector_clear(Vector* vector) {
     vector->items_count = 0;
 }
 
+void vector_reserve(Vector* vector, const u64 capacity) {
+    assert(vector != NULL);
+
+    if (capacity <= vector->capacity) {
+        return;
+    }
+
+    u64 new_capacity = vector->capacity;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+    vector_grow(vector, new_capacity);
+}
+
+void* vector_resize(Vector* vector, const u64 count) {
+    assert(vector != NULL);
+    assert(vector->free == NULL);
+
+    vector_reserve(vector, count);
+    vector->items_count = count;
+    return vector->items;
+}
+
+void vector_fill(Vector* vector, const void* item) {
+    assert(vector != NULL);
+    assert(item != NULL);
+
+    for (u64 i = 0; i < vector->items_count; ++i) {
+        memcpy((u8*)vector->items + i * vector->item_size, item, vector->item_size);
+    }
+}
 
 void vector_push_back(Vector* vector, const void* item) {
     assert(vector != NULL);
     assert(item != NULL);
 
     if (vector->items_count + 1 >= vector->capacity) {
-        vector_resize(vector, vector->capacity * 2);
+        vector_grow(vector, vector->capacity * 2);
     }
 
     memcpy((u8*)vector->items + vector->items_count * vector->item_size, item, vector->item_size);
@@ -81,10 +112,10 @@ void vector_push_front(Vector* vector, const void* item) {
     assert(item != NULL);
 
     if (vector->items_count + 1 >= vector->capacity) {
-        vector_resize(vector, vector->capacity * 2);
+        vector_grow(vector, vector->capacity * 2);
     }
 
-    memcpy((u8*)vector->items + vector->item_size, vector->items, vector->items_count * vector->item_size);
+    memmove((u8*)vector->items + vector->item_size, vector->items, vector->items_count * vector->item_size);
     memcpy((u8*)vector->items, item, vector->item_size);
 
     ++vector->items_count;
@@ -102,10 +133,14 @@ void vector_insert(Vector* vector, const void* where, const void* items, const u
         while (capacity <= vector->items_count + count) {
             capacity *= 2;
         }
-        vector_resize(vector, capacity);
+        vector_grow(vector, capacity);
     }
 
-    memcpy((u8*)vector->items + offset + (count * vector->item_size), (u8*)vector->items + offset, (vector->items_count * vector->item_size) - offset);
+    // Appending at the end is the common case (string builder), there is nothing to shift then.
+    const u64 tail_size = (vector->items_count * vector->item_size) - offset;
+    if (tail_size != 0) {
+        memmove((u8*)vector->items + offset + (count * vector->item_size), (u8*)vector->items + offset, tail_size);
+    }
     memcpy((u8*)vector->items + offset, items, count * vector->item_size);
 
     vector->items_count += count;
@@ -30,4 +30,5 @@ workspace ("vane-compiler")
     -- projects
     include(PROJECTS_DIR_PATH .. "vanec")
     include(PROJECTS_DIR_PATH .. "tests")
-    include(PROJECTS_DIR_PATH .. "testbed")
\ No newline at end of file
+    include(PROJECTS_DIR_PATH .. "testbed")
+    include(PROJECTS_DIR_PATH .. "bench")
\ No newline at end of file